@@ -0,0 +1,262 @@
+/**
+ * Profiling harness for notification ingestion.
+ *
+ * Replays a captured notification stream through the allocation-free path
+ * useBluetooth uses (StreamIngest, then samples handed out through reused
+ * objects) and through the path it replaced (a Uint8Array and a DataView
+ * per notification and frame, a parsed object and a toFixed message per
+ * sample), and reports the time per notification and sample for each.
+ *
+ * A capture is either a gateway notification log (SFLOG1, see
+ * scripts/firmware/host/stream_merge.hpp), replayed with the notification
+ * boundaries it was received with, or raw stream bytes such as a UART
+ * capture, cut into MTU-sized notifications. Only `next dev` serves the
+ * page that runs it (/dev/ingest, see next.config.ts), so none of this is
+ * in the production bundle.
+ */
+
+import {
+    StreamFrameDecoder,
+    FRAME_TYPE_QUATERNION,
+    FRAME_TYPE_MAGNETOMETER,
+    FRAME_TYPE_LINEAR_ACCEL,
+    FRAME_TYPE_BATTERY,
+} from '@/lib/streamFrame';
+import { StreamIngest } from '@/lib/streamIngest';
+
+const SFLOG_MAGIC = 'SFLOG1\n\0';
+const SFLOG_RECORD_LEN = 12; // receive_us u64 | char_uuid u16 | len u16
+const SFLOG_STREAM = 0; // char_uuid of sketch stream bytes
+
+const RAW_NOTIFICATION_SIZE = 244; // ATT payload at MTU 247
+const DEFAULT_PASSES = 5;
+
+export interface IngestPathProfile {
+    bestMs: number; // Fastest pass
+    nsPerNotification: number;
+    nsPerSample: number;
+    heapGrowthBytes: number | null; // One pass; Chrome only, GC may hide some
+}
+
+export interface IngestProfile {
+    source: 'sflog' | 'raw';
+    notifications: number;
+    bytes: number;
+    samples: number;
+    skippedRecords: number; // Log records that are not stream bytes
+    passes: number;
+    ring: IngestPathProfile;
+    legacy: IngestPathProfile;
+}
+
+interface CaptureNotifications {
+    source: IngestProfile['source'];
+    values: DataView[];
+    bytes: number;
+    skippedRecords: number;
+}
+
+/**
+ * Cut a capture into notification values (views into `capture`)
+ */
+export function splitCapture(capture: Uint8Array): CaptureNotifications {
+    const view = new DataView(capture.buffer, capture.byteOffset, capture.byteLength);
+    const values: DataView[] = [];
+    let bytes = 0;
+    let skippedRecords = 0;
+
+    let isLog = capture.length >= SFLOG_MAGIC.length;
+    for (let i = 0; isLog && i < SFLOG_MAGIC.length; i++) {
+        isLog = capture[i] === SFLOG_MAGIC.charCodeAt(i);
+    }
+
+    if (isLog) {
+        // A truncated last record ends the log, as in sf::log_reader
+        let pos = SFLOG_MAGIC.length;
+        while (capture.length - pos >= SFLOG_RECORD_LEN) {
+            const charUuid = view.getUint16(pos + 8, true);
+            const len = view.getUint16(pos + 10, true);
+            pos += SFLOG_RECORD_LEN;
+            if (capture.length - pos < len) break;
+            if (charUuid === SFLOG_STREAM) {
+                values.push(new DataView(capture.buffer, capture.byteOffset + pos, len));
+                bytes += len;
+            } else {
+                skippedRecords++;
+            }
+            pos += len;
+        }
+        return { source: 'sflog', values, bytes, skippedRecords };
+    }
+
+    for (let pos = 0; pos < capture.length; pos += RAW_NOTIFICATION_SIZE) {
+        const len = Math.min(RAW_NOTIFICATION_SIZE, capture.length - pos);
+        values.push(new DataView(capture.buffer, capture.byteOffset + pos, len));
+    }
+    return { source: 'raw', values, bytes: capture.length, skippedRecords };
+}
+
+// Consumed by both paths so the work can't be optimized away
+let sink = 0;
+
+/**
+ * StreamIngest, then every sample copied into reused objects the way
+ * useBluetooth hands them to its callbacks. Returns the samples seen.
+ */
+function ringPass(ingest: StreamIngest, values: DataView[]): number {
+    const ring = ingest.ring;
+    const quaternion = { w: 0, x: 0, y: 0, z: 0 };
+    const vector = { x: 0, y: 0, z: 0 };
+    let samples = 0;
+
+    ingest.reset();
+    for (let n = 0; n < values.length; n++) {
+        const first = ring.head;
+        ingest.push(values[n], n);
+        for (let i = first; i < ring.head; i++) {
+            const slot = ring.slot(i);
+            const v = slot * 4;
+            if (ring.type[slot] === FRAME_TYPE_QUATERNION) {
+                quaternion.w = ring.values[v];
+                quaternion.x = ring.values[v + 1];
+                quaternion.y = ring.values[v + 2];
+                quaternion.z = ring.values[v + 3];
+                sink += quaternion.w;
+            } else {
+                vector.x = ring.values[v];
+                vector.y = ring.values[v + 1];
+                vector.z = ring.values[v + 2];
+                sink += vector.x;
+            }
+            samples++;
+        }
+    }
+    return samples;
+}
+
+/**
+ * The per-notification path useBluetooth had before StreamIngest
+ */
+function legacyPass(values: DataView[]): number {
+    const decoder = new StreamFrameDecoder();
+    let samples = 0;
+
+    for (const value of values) {
+        const bytes = new Uint8Array(value.buffer, value.byteOffset, value.byteLength);
+        decoder.push(bytes, (type, _seq, payload) => {
+            switch (type) {
+                case FRAME_TYPE_QUATERNION: {
+                    if (payload.byteLength < 16) return;
+                    const q = {
+                        w: payload.getFloat32(0, true),
+                        x: payload.getFloat32(4, true),
+                        y: payload.getFloat32(8, true),
+                        z: payload.getFloat32(12, true),
+                    };
+                    const message = `Q: w=${q.w.toFixed(4)} x=${q.x.toFixed(4)} y=${q.y.toFixed(4)} z=${q.z.toFixed(4)}`;
+                    sink += q.w + message.length;
+                    break;
+                }
+                case FRAME_TYPE_MAGNETOMETER:
+                case FRAME_TYPE_LINEAR_ACCEL: {
+                    if (payload.byteLength < 12) return;
+                    const a = {
+                        x: payload.getFloat32(0, true),
+                        y: payload.getFloat32(4, true),
+                        z: payload.getFloat32(8, true),
+                    };
+                    const message = `${type === FRAME_TYPE_MAGNETOMETER ? 'M' : 'A'}: x=${a.x.toFixed(2)} y=${a.y.toFixed(2)} z=${a.z.toFixed(2)}`;
+                    sink += a.x + message.length;
+                    break;
+                }
+                case FRAME_TYPE_BATTERY: {
+                    if (payload.byteLength < 3) return;
+                    const b = { percent: payload.getUint8(0), milliVolts: payload.getUint16(1, true) };
+                    sink += b.percent;
+                    break;
+                }
+                default:
+                    return;
+            }
+            samples++;
+        });
+    }
+    return samples;
+}
+
+function usedHeap(): number | null {
+    const memory = (performance as Performance & { memory?: { usedJSHeapSize: number } }).memory;
+    return memory ? memory.usedJSHeapSize : null;
+}
+
+function profilePath(pass: () => number, passes: number, notifications: number): { profile: IngestPathProfile; samples: number } {
+    // Warm up the JIT before anything is measured
+    let samples = pass();
+
+    const heapBefore = usedHeap();
+    pass();
+    const heapAfter = usedHeap();
+
+    let bestMs = Infinity;
+    for (let p = 0; p < passes; p++) {
+        const start = performance.now();
+        samples = pass();
+        bestMs = Math.min(bestMs, performance.now() - start);
+    }
+
+    return {
+        samples,
+        profile: {
+            bestMs,
+            nsPerNotification: notifications > 0 ? (bestMs * 1e6) / notifications : 0,
+            nsPerSample: samples > 0 ? (bestMs * 1e6) / samples : 0,
+            heapGrowthBytes: heapBefore !== null && heapAfter !== null ? Math.max(0, heapAfter - heapBefore) : null,
+        },
+    };
+}
+
+/**
+ * Replay `capture` through both ingestion paths, `passes` times each.
+ * Runs synchronously; a capture of a few MB takes a few seconds.
+ */
+export function profileIngest(capture: Uint8Array, passes: number = DEFAULT_PASSES): IngestProfile {
+    const { source, values, bytes, skippedRecords } = splitCapture(capture);
+    const ingest = new StreamIngest();
+
+    const ring = profilePath(() => ringPass(ingest, values), passes, values.length);
+    const legacy = profilePath(() => legacyPass(values), passes, values.length);
+    if (ring.samples !== legacy.samples) {
+        throw new Error(`Ingestion paths disagree: ${ring.samples} vs ${legacy.samples} samples (${sink})`);
+    }
+
+    return {
+        source,
+        notifications: values.length,
+        bytes,
+        samples: ring.samples,
+        skippedRecords,
+        passes,
+        ring: ring.profile,
+        legacy: legacy.profile,
+    };
+}
+
+/**
+ * Display lines for a profile
+ */
+export function formatIngestProfile(profile: IngestProfile): string[] {
+    const heap = (p: IngestPathProfile) =>
+        p.heapGrowthBytes === null ? '' : `, heap +${(p.heapGrowthBytes / 1024).toFixed(0)} KiB per pass`;
+    const path = (name: string, p: IngestPathProfile) =>
+        `${name}: ${p.nsPerNotification.toFixed(0)} ns/notification, ${p.nsPerSample.toFixed(0)} ns/sample${heap(p)}`;
+
+    const lines = [
+        `Ingest profile (${profile.source}): ${profile.notifications} notifications, ${profile.bytes} bytes, ${profile.samples} samples, best of ${profile.passes} passes`,
+        path('Sample ring', profile.ring),
+        path('Per-sample objects', profile.legacy),
+    ];
+    if (profile.skippedRecords > 0) {
+        lines.push(`Skipped ${profile.skippedRecords} log records that are not stream bytes.`);
+    }
+    return lines;
+}
@@ -0,0 +1,41 @@
+'use client';
+
+import { useState } from "react";
+import { formatIngestProfile, profileIngest } from "./ingestProfile";
+
+/**
+ * Notification ingestion profiler. Served by `next dev` only: the
+ * .dev.tsx extension is a page extension in development alone
+ * (next.config.ts), so production builds neither route nor bundle it.
+ */
+export default function IngestProfilePage() {
+  const [lines, setLines] = useState<string[]>([]);
+
+  const handleFile = async (file: File) => {
+    try {
+      const profile = profileIngest(new Uint8Array(await file.arrayBuffer()));
+      setLines([file.name, ...formatIngestProfile(profile)]);
+    } catch (err) {
+      setLines([file.name, err instanceof Error ? err.message : "Failed to profile capture."]);
+    }
+  };
+
+  return (
+    <main className="flex-1 overflow-auto p-6 space-y-4 font-mono text-xs text-zinc-300">
+      <p className="text-zinc-400">
+        Replays a notification capture (.sflog log or raw .bin stream bytes) through the
+        sample ring and the per-sample object path.
+      </p>
+      <input
+        type="file"
+        accept=".sflog,.bin"
+        onChange={async (e) => {
+          const file = e.target.files?.[0];
+          e.target.value = "";
+          if (file) await handleFile(file);
+        }}
+      />
+      <pre className="whitespace-pre-wrap">{lines.join("\n")}</pre>
+    </main>
+  );
+}
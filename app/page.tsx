@@ -8,32 +8,82 @@ import { Terminal } from "@/components/terminal/Terminal";
 import { Quaternion, LinearAccel } from "@/components/scene/HandModel";
 import { EKFTracker } from "@/lib/EKFTracker";
 import { useCalibration } from "@/hooks/useCalibration";
-import type { ReplaySessionV1 } from "@/lib/replay";
+import { useTrackingWorker } from "@/hooks/useTrackingWorker";
+import type { ReplaySession } from "@/lib/replay";
 
 export default function Home() {
   const [quaternion, setQuaternion] = useState<Quaternion | null>(null);
   const [linearAccel, setLinearAccel] = useState<LinearAccel | null>(null);
   const [position, setPosition] = useState<{ x: number, y: number, z: number }>({ x: 0, y: 0, z: 0 });
   const [isPositionLocked, setIsPositionLocked] = useState(true);
-  const [replay, setReplay] = useState<ReplaySessionV1 | null>(null);
+  const [replay, setReplay] = useState<ReplaySession | null>(null);
   const [isReplaying, setIsReplaying] = useState(false);
   const [replayProgress, setReplayProgress] = useState<{ currentFrame: number; totalFrames: number } | null>(null);
   const [battery, setBattery] = useState<{ percent: number; milliVolts: number } | null>(null);
   const [isDeviceConnected, setIsDeviceConnected] = useState(false);
 
   const ekfTrackerRef = useRef<EKFTracker | null>(null);
+  // Copies: the sample callbacks reuse their objects for every sample
   const lastQuaternionRef = useRef<Quaternion | null>(null);
+  const lastLinearAccelRef = useRef<LinearAccel | null>(null);
+
+  // Samples arrive several times per display frame; the scene state is set
+  // once per animation frame from the latest of each
+  const sceneFrameRef = useRef<number | null>(null);
+  const pendingSceneRef = useRef<{ quaternion: boolean; linearAccel: boolean; position: { x: number, y: number, z: number } | null }>({
+    quaternion: false,
+    linearAccel: false,
+    position: null,
+  });
 
   // Initialize EKF tracker
   useEffect(() => {
     ekfTrackerRef.current = new EKFTracker();
   }, []);
 
+  const flushScene = useCallback(() => {
+    sceneFrameRef.current = null;
+    const pending = pendingSceneRef.current;
+    if (pending.quaternion && lastQuaternionRef.current) {
+      setQuaternion({ ...lastQuaternionRef.current });
+    }
+    if (pending.linearAccel && lastLinearAccelRef.current) {
+      setLinearAccel({ ...lastLinearAccelRef.current });
+    }
+    if (pending.position) {
+      setPosition(pending.position);
+    }
+    pending.quaternion = false;
+    pending.linearAccel = false;
+    pending.position = null;
+  }, []);
+
+  const scheduleScene = useCallback(() => {
+    if (sceneFrameRef.current === null) {
+      sceneFrameRef.current = requestAnimationFrame(flushScene);
+    }
+  }, [flushScene]);
+
+  // Drop a pending update so it can't overwrite a reset
+  const cancelScene = useCallback(() => {
+    if (sceneFrameRef.current !== null) {
+      cancelAnimationFrame(sceneFrameRef.current);
+      sceneFrameRef.current = null;
+    }
+    const pending = pendingSceneRef.current;
+    pending.quaternion = false;
+    pending.linearAccel = false;
+    pending.position = null;
+  }, []);
+
+  useEffect(() => cancelScene, [cancelScene]);
+
   // Initialize calibration with terminal message callback
   const {
     isCalibrating,
     hasCalibration,
     currentStep,
+    calibrationData,
     startCalibration,
     cancelCalibration,
     clearCalibration,
@@ -48,11 +98,27 @@ export default function Home() {
     }, []),
   });
 
+  // Decode, calibration and EKF in a worker when the page is cross-origin
+  // isolated; the scene then reads its pose slot, notifications are decoded
+  // there only, and the handlers below only feed calibration
+  const { pose: trackingPose, postNotification, postBridgeBatch, postSamples, subscribeSamples, reset: resetTracking } = useTrackingWorker({
+    calibration: calibrationData,
+    positionLocked: isPositionLocked,
+    calibrating: isCalibrating,
+    replaying: isReplaying,
+  });
+  const trackingInWorker = trackingPose !== null;
+
   const handleQuaternion = useCallback((q: Quaternion) => {
-    if (isReplaying) return;
-    setQuaternion(q);
-    lastQuaternionRef.current = q;
-  }, [isReplaying]);
+    if (isReplaying || trackingInWorker) return;
+    const last = lastQuaternionRef.current ?? (lastQuaternionRef.current = { w: 1, x: 0, y: 0, z: 0 });
+    last.w = q.w;
+    last.x = q.x;
+    last.y = q.y;
+    last.z = q.z;
+    pendingSceneRef.current.quaternion = true;
+    scheduleScene();
+  }, [isReplaying, trackingInWorker, scheduleScene]);
 
   const handleLinearAccel = useCallback((a: LinearAccel) => {
     // If calibrating, feed samples to calibration manager
@@ -61,7 +127,7 @@ export default function Home() {
       return; // Don't update position during calibration
     }
 
-    if (isReplaying) {
+    if (isReplaying || trackingInWorker) {
       return;
     }
 
@@ -72,18 +138,22 @@ export default function Home() {
 
     // Apply calibration transform if available
     const calibratedAccel = transformAcceleration(a);
-    setLinearAccel(calibratedAccel);
+    const last = lastLinearAccelRef.current ?? (lastLinearAccelRef.current = { x: 0, y: 0, z: 0 });
+    last.x = calibratedAccel.x;
+    last.y = calibratedAccel.y;
+    last.z = calibratedAccel.z;
+    pendingSceneRef.current.linearAccel = true;
 
     // Update EKF tracker if we have orientation data
     if (ekfTrackerRef.current && lastQuaternionRef.current) {
-      const newPos = ekfTrackerRef.current.predict(calibratedAccel, lastQuaternionRef.current);
-      setPosition(newPos);
+      pendingSceneRef.current.position = ekfTrackerRef.current.predict(calibratedAccel, lastQuaternionRef.current);
     }
-  }, [isPositionLocked, isReplaying, isCalibrating, addAccelSample, transformAcceleration]);
+    scheduleScene();
+  }, [isPositionLocked, isReplaying, isCalibrating, trackingInWorker, addAccelSample, transformAcceleration, scheduleScene]);
 
   const handleMagnetometer = useCallback((m: { x: number; y: number; z: number }) => {
     // Skip magnetometer updates when locked or calibrating
-    if (isReplaying || isPositionLocked || isCalibrating) {
+    if (isReplaying || isPositionLocked || isCalibrating || trackingInWorker) {
       return;
     }
 
@@ -91,10 +161,10 @@ export default function Home() {
     if (ekfTrackerRef.current) {
       ekfTrackerRef.current.updateMagnetometer(m);
     }
-  }, [isReplaying, isPositionLocked, isCalibrating]);
+  }, [isReplaying, isPositionLocked, isCalibrating, trackingInWorker]);
 
   const handleBattery = useCallback((b: { percent: number; milliVolts: number }) => {
-    setBattery(b);
+    setBattery({ percent: b.percent, milliVolts: b.milliVolts });
     // Mark as connected when we receive battery data
     setIsDeviceConnected(true);
   }, []);
@@ -104,6 +174,8 @@ export default function Home() {
   }, []);
 
   const handleDisconnect = useCallback(() => {
+    cancelScene();
+    resetTracking();
     if (ekfTrackerRef.current) {
       ekfTrackerRef.current.reset();
       setPosition({ x: 0, y: 0, z: 0 });
@@ -117,23 +189,25 @@ export default function Home() {
     setIsDeviceConnected(false);
     setIsReplaying(false);
     setReplay(null);
-  }, [isCalibrating, cancelCalibration]);
+  }, [isCalibrating, cancelCalibration, cancelScene, resetTracking]);
 
   const handleTogglePositionLock = useCallback(() => {
     setIsPositionLocked(prev => !prev);
   }, []);
 
-  const handleReplayLoaded = useCallback((session: ReplaySessionV1) => {
+  const handleReplayLoaded = useCallback((session: ReplaySession) => {
+    cancelScene();
     setReplay(session);
     setIsReplaying(true);
-    setReplayProgress({ currentFrame: 1, totalFrames: session.frames.length });
+    setReplayProgress({ currentFrame: 1, totalFrames: session.frames.total });
     setQuaternion(null);
     setLinearAccel(null);
     setPosition({ x: 0, y: 0, z: 0 });
     if (ekfTrackerRef.current) {
       ekfTrackerRef.current.reset();
     }
-  }, []);
+    resetTracking();
+  }, [cancelScene, resetTracking]);
 
   const handleStopReplay = useCallback(() => {
     setIsReplaying(false);
@@ -164,6 +238,7 @@ export default function Home() {
           quaternion={quaternion}
           linearAccel={linearAccel}
           position={position}
+          pose={trackingPose}
           isCalibrated={hasCalibration}
           replay={replay && isReplaying ? { frames: replay.frames, isPlaying: true, onEnded: handleStopReplay } : null}
           onReplayProgress={setReplayProgress}
@@ -180,6 +255,10 @@ export default function Home() {
           onBattery={handleBattery}
           onConnect={handleConnect}
           onDisconnect={handleDisconnect}
+          onRawNotification={postNotification}
+          onRawBridgeBatch={postBridgeBatch}
+          subscribeDecodedSamples={subscribeSamples}
+          onLegacySamples={postSamples}
           isPositionLocked={isPositionLocked}
           onTogglePositionLock={handleTogglePositionLock}
           isCalibrating={isCalibrating}
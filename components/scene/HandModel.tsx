@@ -1,6 +1,7 @@
 import { forwardRef, useEffect, useImperativeHandle, useRef } from "react";
 import { useFrame } from "@react-three/fiber";
 import * as THREE from "three";
+import { createPoseSample, POSE_FLAG_POSITION, POSE_FLAG_QUATERNION, type PoseSlotReader } from "@/lib/poseSlot";
 
 export interface Quaternion {
     w: number;
@@ -22,6 +23,9 @@ interface HandModelProps {
     linearAccel?: LinearAccel | null;
     isCalibrated?: boolean;
     mode?: "live" | "replay";
+    // Tracking worker's pose slot, read every frame instead of the props
+    pose?: PoseSlotReader | null;
+    posePositionRef?: React.RefObject<{ x: number; y: number; z: number }>;
     onQuaternionUpdate?: (quaternion: THREE.Quaternion) => void;
 }
 
@@ -55,10 +59,12 @@ function Joint({ position }: { position: [number, number, number] }) {
 
 const CALIBRATED_NEUTRAL_ROTATION = new THREE.Quaternion(Math.SQRT1_2, Math.SQRT1_2, 0, 0);
 
-export const HandModel = forwardRef<THREE.Group, HandModelProps>(function HandModel({ quaternion, linearAccel: _linearAccel, isCalibrated = false, mode = "live", onQuaternionUpdate, ...props }, ref) {
+export const HandModel = forwardRef<THREE.Group, HandModelProps>(function HandModel({ quaternion, linearAccel: _linearAccel, isCalibrated = false, mode = "live", pose, posePositionRef, onQuaternionUpdate, ...props }, ref) {
     const groupRef = useRef<THREE.Group>(null!);
     const targetQuaternion = useRef(new THREE.Quaternion());
     const hasQuaternion = quaternion !== null && quaternion !== undefined;
+    const poseSample = useRef(createPoseSample());
+    const poseHasQuaternion = useRef(false);
 
     useImperativeHandle(ref, () => groupRef.current);
 
@@ -75,6 +81,10 @@ export const HandModel = forwardRef<THREE.Group, HandModelProps>(function HandMo
         }
     }, [mode, quaternion, isCalibrated]);
 
+    useEffect(() => {
+        poseHasQuaternion.current = false;
+    }, [pose]);
+
 
 
     useFrame((state) => {
@@ -86,7 +96,27 @@ export const HandModel = forwardRef<THREE.Group, HandModelProps>(function HandMo
             return;
         }
         if (groupRef.current) {
-            if (hasQuaternion) {
+            // Worker pipeline: the latest pose, straight from its slot
+            if (pose && pose.read(poseSample.current)) {
+                const p = poseSample.current;
+                if (p.flags & POSE_FLAG_QUATERNION) {
+                    targetQuaternion.current.set(p.quaternion.x, p.quaternion.y, p.quaternion.z, p.quaternion.w).normalize();
+                    if (isCalibrated) {
+                        targetQuaternion.current.multiply(CALIBRATED_NEUTRAL_ROTATION);
+                    }
+                    poseHasQuaternion.current = true;
+                }
+                if (p.flags & POSE_FLAG_POSITION) {
+                    groupRef.current.position.set(p.position.x, p.position.y, p.position.z);
+                    if (posePositionRef?.current) {
+                        posePositionRef.current.x = p.position.x;
+                        posePositionRef.current.y = p.position.y;
+                        posePositionRef.current.z = p.position.z;
+                    }
+                }
+            }
+
+            if (hasQuaternion || poseHasQuaternion.current) {
                 // Smoothly interpolate to the target quaternion from the sensor
                 groupRef.current.quaternion.slerp(targetQuaternion.current, 0.15);
                 // Notify parent of current quaternion
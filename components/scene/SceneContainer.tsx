@@ -6,18 +6,23 @@ import { HandModel, Quaternion, LinearAccel } from "./HandModel";
 import { OriginMarker, UCSGizmoOverlay } from "./CoordinateAxes";
 import { Suspense, useRef, useEffect } from "react";
 import * as THREE from "three";
-import type { ReplayFrameV1 } from "@/lib/replay";
+import type { ReplayFrames } from "@/lib/replay";
+import type { PoseSlotReader } from "@/lib/poseSlot";
+import { FrameTimeStats, formatFrameTimeSummary } from "@/lib/frameStats";
 
 const CALIBRATED_NEUTRAL_ROTATION = new THREE.Quaternion(Math.SQRT1_2, Math.SQRT1_2, 0, 0);
+const FRAME_STATS_REPORT_MS = 5000;
 
 interface SceneContainerProps {
     quaternion?: Quaternion | null;
     linearAccel?: LinearAccel | null;
     position?: { x: number; y: number; z: number };
+    // Tracking worker's latest pose; replaces quaternion and position
+    pose?: PoseSlotReader | null;
     isCalibrated?: boolean;
     onReplayProgress?: (progress: { currentFrame: number; totalFrames: number }) => void;
     replay?: {
-        frames: ReplayFrameV1[];
+        frames: ReplayFrames;
         isPlaying: boolean;
         speed?: number;
         loop?: boolean;
@@ -123,6 +128,48 @@ function AdaptiveCamera({ handPosition, handPositionRef, orbitControlsRef }: Ada
     return null;
 }
 
+/**
+ * With ?frametimes, logs frame-interval statistics to the console every
+ * few seconds, labelled with the tracking pipeline, to compare frame-time
+ * variance with tracking on the main thread (?tracking=main) and in the
+ * worker.
+ */
+function FrameTimeProbe({ label }: { label: string }) {
+    const statsRef = useRef<FrameTimeStats | null>(null);
+    const lastReportRef = useRef(0);
+
+    useEffect(() => {
+        if (new URLSearchParams(window.location.search).has("frametimes")) {
+            statsRef.current = new FrameTimeStats();
+        }
+        return () => {
+            statsRef.current = null;
+        };
+    }, []);
+
+    // A new pipeline starts a new window
+    useEffect(() => {
+        statsRef.current?.reset();
+        lastReportRef.current = performance.now();
+    }, [label]);
+
+    useFrame((_state, delta) => {
+        const stats = statsRef.current;
+        if (!stats) return;
+
+        stats.add(delta * 1000);
+        const now = performance.now();
+        if (now - lastReportRef.current >= FRAME_STATS_REPORT_MS) {
+            const summary = stats.summary();
+            if (summary) console.info(formatFrameTimeSummary(label, summary));
+            stats.reset();
+            lastReportRef.current = now;
+        }
+    });
+
+    return null;
+}
+
 function ReplayController({
     frames,
     isPlaying,
@@ -134,7 +181,7 @@ function ReplayController({
     handRef,
     handPositionRef,
 }: {
-    frames: ReplayFrameV1[];
+    frames: ReplayFrames;
     isPlaying: boolean;
     speed?: number;
     loop?: boolean;
@@ -145,7 +192,6 @@ function ReplayController({
     handPositionRef: React.RefObject<{ x: number; y: number; z: number }>;
 }) {
     const startPerfRef = useRef<number | null>(null);
-    const indexRef = useRef(0);
     const endedRef = useRef(false);
     const onEndedRef = useRef(onEnded);
     const onProgressRef = useRef(onProgress);
@@ -161,71 +207,78 @@ function ReplayController({
     }, [onProgress]);
 
     useEffect(() => {
-        if (isPlaying && frames.length > 0) {
+        if (isPlaying && frames.total > 0) {
             startPerfRef.current = performance.now();
-            indexRef.current = 0;
             endedRef.current = false;
             lastProgressPerfRef.current = 0;
             lastProgressIndexRef.current = -1;
-            onProgressRef.current?.({ currentFrame: 1, totalFrames: frames.length });
+            onProgressRef.current?.({ currentFrame: 1, totalFrames: frames.total });
         }
     }, [isPlaying, frames]);
 
     const tmpQ0 = useRef(new THREE.Quaternion());
     const tmpQ1 = useRef(new THREE.Quaternion());
 
+    // Frames are read in place, straight from their arrays
     useFrame(() => {
         const hand = handRef.current;
-        if (!hand || !isPlaying || frames.length === 0 || startPerfRef.current === null) return;
+        const ready = frames.ready;
+        if (!hand || !isPlaying || ready === 0 || startPerfRef.current === null) return;
 
-        const durationMs = frames[frames.length - 1].tMs;
         const now = performance.now();
         let tMs = (now - startPerfRef.current) * speed;
 
-        if (tMs >= durationMs) {
-            if (loop) {
-                startPerfRef.current = performance.now();
-                indexRef.current = 0;
-                tMs = 0;
-            } else {
-                tMs = durationMs;
-                if (!endedRef.current) {
-                    endedRef.current = true;
-                    onEndedRef.current?.();
+        if (!frames.complete) {
+            // Caught up with preprocessing: hold the last ready frame
+            const readyMs = frames.tMs(ready - 1);
+            if (tMs > readyMs) {
+                startPerfRef.current = now - readyMs / speed;
+                tMs = readyMs;
+            }
+        } else {
+            const durationMs = frames.tMs(frames.total - 1);
+            if (tMs >= durationMs) {
+                if (loop) {
+                    startPerfRef.current = performance.now();
+                    tMs = 0;
+                } else {
+                    tMs = durationMs;
+                    if (!endedRef.current) {
+                        endedRef.current = true;
+                        onEndedRef.current?.();
+                    }
                 }
             }
         }
 
-        while (indexRef.current + 1 < frames.length && frames[indexRef.current + 1].tMs <= tMs) {
-            indexRef.current++;
-        }
+        const i = Math.min(ready - 1, Math.max(0, Math.floor(tMs / frames.frameIntervalMs)));
+        const j = Math.min(i + 1, ready - 1);
 
         if (
             onProgressRef.current &&
-            indexRef.current !== lastProgressIndexRef.current &&
+            i !== lastProgressIndexRef.current &&
             now - lastProgressPerfRef.current >= 80
         ) {
-            lastProgressIndexRef.current = indexRef.current;
+            lastProgressIndexRef.current = i;
             lastProgressPerfRef.current = now;
-            onProgressRef.current({ currentFrame: indexRef.current + 1, totalFrames: frames.length });
+            onProgressRef.current({ currentFrame: i + 1, totalFrames: frames.total });
         }
 
-        const a = frames[indexRef.current];
-        const b = frames[Math.min(indexRef.current + 1, frames.length - 1)];
-        const denom = b.tMs - a.tMs;
-        const alpha = denom <= 0 ? 0 : Math.min(1, Math.max(0, (tMs - a.tMs) / denom));
+        const alpha = j === i ? 0 : Math.min(1, Math.max(0, (tMs - frames.tMs(i)) / frames.frameIntervalMs));
 
-        const x = a.position.x + (b.position.x - a.position.x) * alpha;
-        const y = a.position.y + (b.position.y - a.position.y) * alpha;
-        const z = a.position.z + (b.position.z - a.position.z) * alpha;
+        const p = frames.position;
+        const x = p[i * 3] + (p[j * 3] - p[i * 3]) * alpha;
+        const y = p[i * 3 + 1] + (p[j * 3 + 1] - p[i * 3 + 1]) * alpha;
+        const z = p[i * 3 + 2] + (p[j * 3 + 2] - p[i * 3 + 2]) * alpha;
 
         hand.position.set(x, y, z);
         handPositionRef.current.x = x;
         handPositionRef.current.y = y;
         handPositionRef.current.z = z;
 
-        tmpQ0.current.set(a.quaternion.x, a.quaternion.y, a.quaternion.z, a.quaternion.w);
-        tmpQ1.current.set(b.quaternion.x, b.quaternion.y, b.quaternion.z, b.quaternion.w);
+        const q = frames.quaternion;
+        tmpQ0.current.set(q[i * 4 + 1], q[i * 4 + 2], q[i * 4 + 3], q[i * 4]);
+        tmpQ1.current.set(q[j * 4 + 1], q[j * 4 + 2], q[j * 4 + 3], q[j * 4]);
         if (isCalibrated) {
             tmpQ0.current.multiply(CALIBRATED_NEUTRAL_ROTATION);
             tmpQ1.current.multiply(CALIBRATED_NEUTRAL_ROTATION);
@@ -236,12 +289,14 @@ function ReplayController({
     return null;
 }
 
-export function SceneContainer({ quaternion, linearAccel, position, replay, onReplayProgress, isCalibrated }: SceneContainerProps) {
+export function SceneContainer({ quaternion, linearAccel, position, pose, replay, onReplayProgress, isCalibrated }: SceneContainerProps) {
     // eslint-disable-next-line @typescript-eslint/no-explicit-any
     const orbitControlsRef = useRef<any>(null);
     const handPos = position || { x: 0, y: 0, z: 0 };
     const handRef = useRef<THREE.Group>(null!);
     const replayHandPosRef = useRef({ x: 0, y: 0, z: 0 });
+    const poseHandPosRef = useRef({ x: 0, y: 0, z: 0 });
+    const livePose = replay?.isPlaying ? null : pose;
 
     // Ref to share hand quaternion with UCS overlay
     const handQuatRef = useRef(new THREE.Quaternion());
@@ -271,15 +326,17 @@ export function SceneContainer({ quaternion, linearAccel, position, replay, onRe
                     />
                     <Environment preset="city" />
 
+                    <FrameTimeProbe label={pose ? "tracking in worker" : "tracking on main thread"} />
+
 
                     {/* Adaptive camera that automatically zooms to keep hand visible */}
                     <AdaptiveCamera
                         handPosition={handPos}
-                        handPositionRef={replay?.isPlaying ? replayHandPosRef : undefined}
+                        handPositionRef={replay?.isPlaying ? replayHandPosRef : livePose ? poseHandPosRef : undefined}
                         orbitControlsRef={orbitControlsRef}
                     />
 
-                    {replay?.frames && replay.frames.length > 0 && (
+                    {replay?.frames && replay.frames.total > 0 && (
                         <ReplayController
                             frames={replay.frames}
                             isPlaying={replay.isPlaying}
@@ -304,6 +361,8 @@ export function SceneContainer({ quaternion, linearAccel, position, replay, onRe
                         linearAccel={linearAccel}
                         isCalibrated={!replay?.isPlaying && Boolean(isCalibrated)}
                         mode={replay?.isPlaying ? "replay" : "live"}
+                        pose={livePose}
+                        posePositionRef={poseHandPosRef}
                         onQuaternionUpdate={(q: THREE.Quaternion) => {
                             handQuatRef.current.copy(q);
                         }}
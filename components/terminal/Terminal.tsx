@@ -1,27 +1,17 @@
 'use client';
 
-import { Terminal as TerminalIcon, Bluetooth, BluetoothOff, Trash2, Lock, Unlock, Crosshair, X, Download, Upload, Square } from "lucide-react";
+import { Terminal as TerminalIcon, Bluetooth, BluetoothOff, Cable, Trash2, Lock, Unlock, Crosshair, X, Download, Upload, Square } from "lucide-react";
 import { cn } from "@/lib/utils";
-import { useBluetooth, TerminalEntry } from "@/hooks/useBluetooth";
+import { useBluetooth } from "@/hooks/useBluetooth";
 import { useEffect, useRef, useState } from "react";
-import { downloadJson } from "@/lib/downloadJson";
+import { downloadParts } from "@/lib/downloadJson";
+import { formatRecorderMemory } from "@/lib/recorder";
 import { CALIBRATION_STORAGE_KEY } from "@/lib/CalibrationManager";
 import { isIMURecordingV1 } from "@/lib/recording";
-import { preprocessRecordingToReplay } from "@/lib/preprocessRecording";
-import type { ReplaySessionV1 } from "@/lib/replay";
-
-function EntryIcon({ type }: { type: TerminalEntry['type'] }) {
-    switch (type) {
-        case 'system':
-            return <span className="text-blue-400">▸</span>;
-        case 'data':
-            return <span className="text-emerald-400">◆</span>;
-        case 'error':
-            return <span className="text-red-400">✖</span>;
-        default:
-            return <span className="text-zinc-500">▸</span>;
-    }
-}
+import { preprocessRecordingIncrementally, type IncrementalReplay } from "@/lib/preprocessRecording";
+import type { ReplaySession } from "@/lib/replay";
+import type { PackedSamplesHandler } from "@/lib/streamIngest";
+import { TerminalLogView, TerminalPacketCount } from "./TerminalLogView";
 
 interface TerminalProps {
     onQuaternion?: (q: { w: number; x: number; y: number; z: number }) => void;
@@ -30,6 +20,10 @@ interface TerminalProps {
     onBattery?: (b: { percent: number; milliVolts: number }) => void;
     onConnect?: () => void;
     onDisconnect?: () => void;
+    onRawNotification?: (value: DataView, receivedMs: number) => boolean;
+    onRawBridgeBatch?: (batch: ArrayBuffer, receivedMs: number) => void;
+    subscribeDecodedSamples?: (handler: PackedSamplesHandler) => () => void;
+    onLegacySamples?: PackedSamplesHandler;
     isPositionLocked?: boolean;
     onTogglePositionLock?: () => void;
     // Calibration props
@@ -40,7 +34,7 @@ interface TerminalProps {
     onClearCalibration?: () => void;
     calibrationProgress?: { current: number; total: number; label: string } | null;
     onAddEntry?: (type: 'system' | 'data' | 'error', message: string) => void;
-    onReplayLoaded?: (replay: ReplaySessionV1) => void;
+    onReplayLoaded?: (replay: ReplaySession) => void;
     isReplaying?: boolean;
     onStopReplay?: () => void;
 }
@@ -52,6 +46,10 @@ export function Terminal({
     onBattery,
     onConnect,
     onDisconnect,
+    onRawNotification,
+    onRawBridgeBatch,
+    subscribeDecodedSamples,
+    onLegacySamples,
     isPositionLocked = false,
     onTogglePositionLock,
     isCalibrating = false,
@@ -68,14 +66,14 @@ export function Terminal({
         isConnected,
         isConnecting,
         deviceName,
-        entries,
-        packetCount,
+        log,
         connect,
+        connectBridge,
         disconnect,
         clearEntries,
         addEntry,
-        exportRecording,
-    } = useBluetooth({ onQuaternion, onLinearAccel, onMagnetometer, onBattery, onDisconnect });
+        getRecorder,
+    } = useBluetooth({ onQuaternion, onLinearAccel, onMagnetometer, onBattery, onDisconnect, onRawNotification, onRawBridgeBatch, subscribeDecodedSamples, onLegacySamples });
 
     // Notify parent when connected
     useEffect(() => {
@@ -103,17 +101,28 @@ export function Terminal({
     }, [isConnected, hasCalibration, addEntry]);
 
 
-    const scrollRef = useRef<HTMLDivElement>(null);
     const uploadInputRef = useRef<HTMLInputElement>(null);
 
+    // Replay still being preprocessed; dropped when its replay stops
+    const replayJobRef = useRef<IncrementalReplay | null>(null);
+
+    useEffect(() => {
+        if (isReplaying) return;
+        replayJobRef.current?.cancel();
+        replayJobRef.current = null;
+    }, [isReplaying]);
+
+    useEffect(() => () => replayJobRef.current?.cancel(), []);
+
     const getSafeDeviceName = (name: string | null | undefined) => {
         const base = (name || "device").trim();
         return base.length > 0 ? base.replaceAll(/[^\w.-]+/g, "_") : "device";
     };
 
-    const handleDownload = () => {
-        const recording = exportRecording();
-        if (!recording) {
+    // JSON as always; Shift-click for the compact binary form (.imurec)
+    const handleDownload = async (binary: boolean) => {
+        const recorder = getRecorder();
+        if (!recorder) {
             addEntry("error", "No recording available yet. Connect to the device first.");
             return;
         }
@@ -126,11 +135,23 @@ export function Terminal({
             calibration = null;
         }
 
-        const exportData = { ...recording, calibration };
+        const meta = { ...recorder.meta, calibration };
+        const events = recorder.eventCount;
         const stamp = new Date().toISOString().replaceAll(":", "-");
-        const filename = `imu_recording_${getSafeDeviceName(recording.deviceName || deviceName)}_${stamp}.json`;
-        downloadJson(filename, exportData);
-        addEntry("system", `Downloaded recording (${exportData.events.length} events).`);
+        const base = `imu_recording_${getSafeDeviceName(meta.deviceName || deviceName)}_${stamp}`;
+        if (binary) {
+            await downloadParts(`${base}.imurec`, recorder.imurecParts(meta), "application/octet-stream");
+        } else {
+            await downloadParts(`${base}.json`, recorder.jsonParts(meta), "application/json");
+        }
+        addEntry("system", `Downloaded recording (${events} events).`);
+        addEntry("system", formatRecorderMemory(recorder.memory()));
+    };
+
+    // stream_merge --ws on this machine; ?bridge=ws://host:port picks another
+    const handleBridgeConnect = () => {
+        const url = new URLSearchParams(window.location.search).get("bridge");
+        connectBridge(url || undefined);
     };
 
     const handleUploadClick = () => {
@@ -143,17 +164,20 @@ export function Terminal({
         if (!isIMURecordingV1(parsed)) {
             throw new Error("Unsupported JSON format (expected schemaVersion=1 recording).");
         }
-        const replay = preprocessRecordingToReplay(parsed, { sourceFileName: file.name });
-        onReplayLoaded?.(replay);
-        addEntry("system", `Loaded replay from ${file.name} (${replay.frames.length} frames).`);
-    };
 
-    // Auto-scroll to bottom when new entries arrive
-    useEffect(() => {
-        if (scrollRef.current) {
-            scrollRef.current.scrollTop = scrollRef.current.scrollHeight;
+        // Playback starts on the first frames while the rest are preprocessed
+        replayJobRef.current?.cancel();
+        const job = preprocessRecordingIncrementally(parsed, { sourceFileName: file.name });
+        replayJobRef.current = job;
+        onReplayLoaded?.(job.session);
+        addEntry("system", `Loaded replay from ${file.name} (${job.session.frames.total} frames).`);
+
+        const started = performance.now();
+        if (await job.done) {
+            addEntry("system", `Replay preprocessed in ${Math.round(performance.now() - started)} ms.`);
         }
-    }, [entries]);
+        if (replayJobRef.current === job) replayJobRef.current = null;
+    };
 
     return (
         <div className={cn(
@@ -185,19 +209,35 @@ export function Terminal({
             {/* Control buttons */}
             <div className="flex items-center gap-2 px-4 py-2 border-b border-white/10 bg-zinc-900/50 flex-wrap">
                 {!isConnected ? (
-                    <button
-                        onClick={connect}
-                        disabled={isConnecting}
-                        className={cn(
-                            "flex items-center gap-2 px-3 py-1.5 rounded-md text-xs font-medium transition-all",
-                            "bg-blue-600/20 border border-blue-500/30 text-blue-400",
-                            "hover:bg-blue-600/30 hover:border-blue-500/50",
-                            "disabled:opacity-50 disabled:cursor-not-allowed"
-                        )}
-                    >
-                        <Bluetooth className="w-3.5 h-3.5" />
-                        {isConnecting ? "Connecting..." : "Connect"}
-                    </button>
+                    <>
+                        <button
+                            onClick={connect}
+                            disabled={isConnecting}
+                            className={cn(
+                                "flex items-center gap-2 px-3 py-1.5 rounded-md text-xs font-medium transition-all",
+                                "bg-blue-600/20 border border-blue-500/30 text-blue-400",
+                                "hover:bg-blue-600/30 hover:border-blue-500/50",
+                                "disabled:opacity-50 disabled:cursor-not-allowed"
+                            )}
+                        >
+                            <Bluetooth className="w-3.5 h-3.5" />
+                            {isConnecting ? "Connecting..." : "Connect"}
+                        </button>
+                        <button
+                            onClick={handleBridgeConnect}
+                            disabled={isConnecting}
+                            className={cn(
+                                "flex items-center gap-2 px-3 py-1.5 rounded-md text-xs font-medium transition-all",
+                                "bg-zinc-800/50 border border-zinc-700/50 text-zinc-400",
+                                "hover:bg-zinc-700/50 hover:text-zinc-300",
+                                "disabled:opacity-50 disabled:cursor-not-allowed"
+                            )}
+                            title="Connect to a local stream bridge (stream_merge --ws)"
+                        >
+                            <Cable className="w-3.5 h-3.5" />
+                            Bridge
+                        </button>
+                    </>
                 ) : (
                     <button
                         onClick={disconnect}
@@ -225,13 +265,13 @@ export function Terminal({
                 </button>
 
                 <button
-                    onClick={handleDownload}
+                    onClick={(e) => handleDownload(e.shiftKey)}
                     className={cn(
                         "flex items-center gap-2 px-3 py-1.5 rounded-md text-xs font-medium transition-all",
                         "bg-zinc-800/50 border border-zinc-700/50 text-zinc-400",
                         "hover:bg-zinc-700/50 hover:text-zinc-300"
                     )}
-                    title="Download all recorded events as JSON"
+                    title="Download all recorded events as JSON (Shift-click: compact .imurec)"
                 >
                     <Download className="w-3.5 h-3.5" />
                     Download
@@ -332,37 +372,12 @@ export function Terminal({
             </div>
 
             {/* Terminal output */}
-            <div
-                ref={scrollRef}
-                className="flex-1 p-4 font-mono text-xs space-y-1 overflow-y-auto text-muted-foreground/80 scrollbar-thin scrollbar-thumb-white/10 scrollbar-track-transparent"
-            >
-                {entries.length === 0 ? (
-                    <div className="flex items-center gap-2 text-zinc-600">
-                        <span className="animate-pulse">▸</span>
-                        <span>Waiting for input...</span>
-                    </div>
-                ) : (
-                    entries.map((entry) => (
-                        <div
-                            key={entry.id}
-                            className={cn(
-                                "flex gap-2 leading-relaxed",
-                                entry.type === 'error' && "text-red-400",
-                                entry.type === 'data' && "text-emerald-300/90",
-                                entry.type === 'system' && "text-zinc-400"
-                            )}
-                        >
-                            <EntryIcon type={entry.type} />
-                            <span className="flex-1 break-all">{entry.message}</span>
-                        </div>
-                    ))
-                )}
-            </div>
+            <TerminalLogView log={log} />
 
             {/* Footer with stats */}
             {isConnected && (
                 <div className="px-4 py-2 border-t border-white/5 bg-zinc-900/30 text-xs text-zinc-500 flex items-center justify-between">
-                    <span>Packets: {packetCount}</span>
+                    <TerminalPacketCount log={log} />
                     <span className="flex items-center gap-1">
                         <span className="w-1.5 h-1.5 rounded-full bg-emerald-400 animate-pulse" />
                         Live
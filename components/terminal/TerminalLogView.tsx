@@ -0,0 +1,128 @@
+'use client';
+
+import { useCallback, useEffect, useLayoutEffect, useRef, useState, useSyncExternalStore } from "react";
+import { cn } from "@/lib/utils";
+import type { TerminalLineType, TerminalLog } from "@/lib/terminalLog";
+
+// Rows are one line each (text-xs, leading-5), so row i sits at i * ROW_HEIGHT
+const ROW_HEIGHT = 20;
+// Rows rendered beyond each edge of the viewport
+const OVERSCAN = 8;
+
+function EntryIcon({ type }: { type: TerminalLineType }) {
+    switch (type) {
+        case 'system':
+            return <span className="text-blue-400">▸</span>;
+        case 'data':
+            return <span className="text-emerald-400">◆</span>;
+        case 'error':
+            return <span className="text-red-400">✖</span>;
+        default:
+            return <span className="text-zinc-500">▸</span>;
+    }
+}
+
+/**
+ * Virtualized view of a TerminalLog: only the rows in the viewport are
+ * rendered, and it re-renders when the log commits, at most once per
+ * animation frame. Follows the newest line unless scrolled up.
+ */
+export function TerminalLogView({ log }: { log: TerminalLog }) {
+    const version = useSyncExternalStore(log.subscribe, log.getVersion, log.getVersion);
+    const scrollRef = useRef<HTMLDivElement>(null);
+    const [viewport, setViewport] = useState({ top: 0, height: 0 });
+    const followRef = useRef(true);
+    const firstRef = useRef(log.first());
+
+    const measure = useCallback(() => {
+        const el = scrollRef.current;
+        if (!el) return;
+        setViewport(prev => (prev.top === el.scrollTop && prev.height === el.clientHeight)
+            ? prev
+            : { top: el.scrollTop, height: el.clientHeight });
+    }, []);
+
+    useEffect(() => {
+        const el = scrollRef.current;
+        if (!el) return;
+        const observer = new ResizeObserver(measure);
+        observer.observe(el);
+        return () => observer.disconnect();
+    }, [measure]);
+
+    const handleScroll = () => {
+        const el = scrollRef.current;
+        if (!el) return;
+        followRef.current = el.scrollTop + el.clientHeight >= el.scrollHeight - ROW_HEIGHT;
+        measure();
+    };
+
+    // After new lines: stick to the bottom, or keep the rows in view where
+    // they are although older ones were dropped above them
+    useLayoutEffect(() => {
+        const el = scrollRef.current;
+        const first = log.first();
+        const dropped = first - firstRef.current;
+        firstRef.current = first;
+        if (!el) return;
+
+        if (followRef.current) {
+            el.scrollTop = el.scrollHeight;
+        } else if (dropped !== 0) {
+            el.scrollTop -= dropped * ROW_HEIGHT;
+        }
+        measure();
+    }, [log, version, measure]);
+
+    const first = log.first();
+    const count = log.head - first;
+    const start = Math.max(0, Math.floor(viewport.top / ROW_HEIGHT) - OVERSCAN);
+    const end = Math.min(count, Math.ceil((viewport.top + viewport.height) / ROW_HEIGHT) + OVERSCAN);
+
+    const rows = [];
+    for (let i = start; i < end; i++) {
+        const index = first + i;
+        const type = log.lineType(index);
+        const message = log.message(index);
+        rows.push(
+            <div
+                key={index}
+                className={cn(
+                    "absolute left-0 right-0 flex gap-2 leading-5 whitespace-nowrap",
+                    type === 'error' && "text-red-400",
+                    type === 'data' && "text-emerald-300/90",
+                    type === 'system' && "text-zinc-400"
+                )}
+                style={{ top: i * ROW_HEIGHT, height: ROW_HEIGHT }}
+            >
+                <EntryIcon type={type} />
+                <span className="flex-1 truncate" title={message}>{message}</span>
+            </div>
+        );
+    }
+
+    return (
+        <div
+            ref={scrollRef}
+            onScroll={handleScroll}
+            className="flex-1 p-4 font-mono text-xs overflow-y-auto text-muted-foreground/80 scrollbar-thin scrollbar-thumb-white/10 scrollbar-track-transparent"
+        >
+            {count === 0 ? (
+                <div className="flex items-center gap-2 text-zinc-600">
+                    <span className="animate-pulse">▸</span>
+                    <span>Waiting for input...</span>
+                </div>
+            ) : (
+                <div className="relative" style={{ height: count * ROW_HEIGHT }}>
+                    {rows}
+                </div>
+            )}
+        </div>
+    );
+}
+
+/** Packet total from the log, refreshed with it */
+export function TerminalPacketCount({ log }: { log: TerminalLog }) {
+    useSyncExternalStore(log.subscribe, log.getVersion, log.getVersion);
+    return <span>Packets: {log.packets}</span>;
+}
@@ -1,23 +1,32 @@
 'use client';
 
 import { useState, useCallback, useRef, useEffect } from 'react';
-import type { IMURecordingV1 } from '@/lib/recording';
-
-// Nordic UART Service UUIDs
+import {
+    FRAME_TYPE_QUATERNION,
+    FRAME_TYPE_MAGNETOMETER,
+    FRAME_TYPE_LINEAR_ACCEL,
+    FRAME_TYPE_BATTERY,
+} from '@/lib/streamFrame';
+import { LegacyPacketIngest, StreamIngest, type PackedSamplesHandler, type StreamSampleRing } from '@/lib/streamIngest';
+import { Recorder, formatRecorderMemory, formatSampleMessage } from '@/lib/recorder';
+import type { RecordingEventV1 } from '@/lib/recording';
+import { TerminalLog, type TerminalLineType } from '@/lib/terminalLog';
+import {
+    openStreamBridge,
+    STREAM_BRIDGE_APP_DEVICE,
+    STREAM_BRIDGE_DEFAULT_URL,
+    type StreamBridgeConnection,
+} from '@/lib/streamBridge';
+
+// QuatStream stream service: frames sent by direct notify, MTU-sized
+const STREAM_SERVICE_UUID = '7b1e0001-5d2c-4a8f-9e61-3c0b9a7d4f12';
+const STREAM_CHARACTERISTIC_UUID = '7b1e0002-5d2c-4a8f-9e61-3c0b9a7d4f12';
+
+// Nordic UART Service UUIDs (fallback for sketches without the stream
+// service); it carries legacy '!' packets, not frames
 const UART_SERVICE_UUID = '6e400001-b5a3-f393-e0a9-e50e24dcca9e';
 const UART_TX_CHARACTERISTIC_UUID = '6e400003-b5a3-f393-e0a9-e50e24dcca9e'; // TX from device (notifications)
 
-export interface TerminalEntry {
-    id: number;
-    timestamp: Date;
-    tMs?: number;
-    type: 'system' | 'data' | 'error';
-    message: string;
-    quaternion?: { w: number; x: number; y: number; z: number };
-    linearAccel?: { x: number; y: number; z: number };
-    magnetometer?: { x: number; y: number; z: number };
-}
-
 export interface BluetoothState {
     isConnected: boolean;
     isConnecting: boolean;
@@ -26,189 +35,38 @@ export interface BluetoothState {
 }
 
 /**
- * Parse a 20-byte quaternion packet from the QuatStream device
- * Packet format:
- *   Byte 0:     '!'  (start marker)
- *   Byte 1:     'Q'  (quaternion identifier)
- *   Bytes 2-5:  w (float, 4 bytes, little-endian)
- *   Bytes 6-9:  x (float, 4 bytes, little-endian)
- *   Bytes 10-13: y (float, 4 bytes, little-endian)
- *   Bytes 14-17: z (float, 4 bytes, little-endian)
- *   Byte 18:    checksum (~sum of bytes 0-17)
- *   Byte 19:    newline '\n'
- */
-function parseQuaternionPacket(data: DataView): { w: number; x: number; y: number; z: number } | null {
-    if (data.byteLength < 20) {
-        return null;
-    }
-
-    // Verify start marker and identifier
-    const startMarker = data.getUint8(0);
-    const identifier = data.getUint8(1);
-
-    if (startMarker !== 0x21 || identifier !== 0x51) { // '!' and 'Q'
-        return null;
-    }
-
-    // Verify checksum
-    let checksum = 0;
-    for (let i = 0; i < 18; i++) {
-        checksum += data.getUint8(i);
-    }
-    checksum = (~checksum) & 0xFF;
-
-    if (data.getUint8(18) !== checksum) {
-        return null;
-    }
-
-    // Parse quaternion floats (little-endian)
-    const w = data.getFloat32(2, true);
-    const x = data.getFloat32(6, true);
-    const y = data.getFloat32(10, true);
-    const z = data.getFloat32(14, true);
-
-    return { w, x, y, z };
-}
-
-/**
- * Parse a 16-byte magnetometer packet from the QuatStream device
- * Packet format:
- *   Byte 0:     '!'  (start marker)
- *   Byte 1:     'M'  (magnetometer identifier)
- *   Bytes 2-5:  mag_x (float, 4 bytes, little-endian) - micro Tesla (µT)
- *   Bytes 6-9:  mag_y (float, 4 bytes, little-endian) - micro Tesla (µT)
- *   Bytes 10-13: mag_z (float, 4 bytes, little-endian) - micro Tesla (µT)
- *   Byte 14:    checksum (~sum of bytes 0-13)
- *   Byte 15:    newline '\n'
- */
-function parseMagnetometerPacket(data: DataView): { x: number; y: number; z: number } | null {
-    if (data.byteLength < 16) {
-        return null;
-    }
-
-    // Verify start marker and identifier
-    const startMarker = data.getUint8(0);
-    const identifier = data.getUint8(1);
-
-    if (startMarker !== 0x21 || identifier !== 0x4D) { // '!' and 'M'
-        return null;
-    }
-
-    // Verify checksum
-    let checksum = 0;
-    for (let i = 0; i < 14; i++) {
-        checksum += data.getUint8(i);
-    }
-    checksum = (~checksum) & 0xFF;
-
-    if (data.getUint8(14) !== checksum) {
-        return null;
-    }
-
-    // Parse magnetometer floats (little-endian) - values in µT
-    const x = data.getFloat32(2, true);
-    const y = data.getFloat32(6, true);
-    const z = data.getFloat32(10, true);
-
-    return { x, y, z };
-}
-
-/**
- * Parse a 16-byte linear acceleration packet from the QuatStream device
- * Packet format:
- *   Byte 0:     '!'  (start marker)
- *   Byte 1:     'A'  (linear acceleration identifier)
- *   Bytes 2-5:  accel_x (float, 4 bytes, little-endian) - m/s²
- *   Bytes 6-9:  accel_y (float, 4 bytes, little-endian) - m/s²
- *   Bytes 10-13: accel_z (float, 4 bytes, little-endian) - m/s²
- *   Byte 14:    checksum (~sum of bytes 0-13)
- *   Byte 15:    newline '\n'
- * 
- * Linear acceleration is acceleration with gravity removed.
- * Citation: BNO085 datasheet - "acceleration minus gravity" in m/s²
+ * Terminal line for sample number `index` of the ring; null for battery
+ * samples, which are too noisy to log.
  */
-function parseLinearAccelPacket(data: DataView): { x: number; y: number; z: number } | null {
-    if (data.byteLength < 16) {
-        return null;
-    }
-
-    // Verify start marker and identifier
-    const startMarker = data.getUint8(0);
-    const identifier = data.getUint8(1);
-
-    if (startMarker !== 0x21 || identifier !== 0x41) { // '!' and 'A'
-        return null;
-    }
-
-    // Verify checksum
-    let checksum = 0;
-    for (let i = 0; i < 14; i++) {
-        checksum += data.getUint8(i);
-    }
-    checksum = (~checksum) & 0xFF;
-
-    if (data.getUint8(14) !== checksum) {
-        return null;
-    }
-
-    // Parse linear acceleration floats (little-endian) - values in m/s²
-    const x = data.getFloat32(2, true);
-    const y = data.getFloat32(6, true);
-    const z = data.getFloat32(10, true);
-
-    return { x, y, z };
+function sampleMessage(ring: StreamSampleRing, index: number): string | null {
+    const slot = ring.slot(index);
+    return formatSampleMessage(ring.type[slot], ring.values, slot * 4);
 }
 
 /**
- * Parse a 6-byte battery packet from the QuatStream device
- * Packet format:
- *   Byte 0:     '!'  (start marker)
- *   Byte 1:     'B'  (battery identifier)
- *   Byte 2:     batteryPercent (uint8, 0-100)
- *   Bytes 3-4:  batteryMilliVolts (uint16, little-endian)
- *   Byte 5:     checksum (~sum of bytes 0-4)
+ * Sample callbacks get objects that are reused for every sample, so they
+ * are only valid for the duration of the call: copy what you keep.
  */
-function parseBatteryPacket(data: DataView): { percent: number; milliVolts: number } | null {
-    if (data.byteLength < 6) {
-        return null;
-    }
-
-    // Verify start marker and identifier
-    const startMarker = data.getUint8(0);
-    const identifier = data.getUint8(1);
-
-    if (startMarker !== 0x21 || identifier !== 0x42) { // '!' and 'B'
-        return null;
-    }
-
-    // Verify checksum
-    let checksum = 0;
-    for (let i = 0; i < 5; i++) {
-        checksum += data.getUint8(i);
-    }
-    checksum = (~checksum) & 0xFF;
-
-    if (data.getUint8(5) !== checksum) {
-        return null;
-    }
-
-    // Parse battery data
-    const percent = data.getUint8(2);
-    const milliVolts = data.getUint16(3, true); // little-endian
-
-    return { percent, milliVolts };
-}
-
 export interface UseBluetoothOptions {
     onQuaternion?: (q: { w: number; x: number; y: number; z: number }) => void;
     onLinearAccel?: (a: { x: number; y: number; z: number }) => void;
     onMagnetometer?: (m: { x: number; y: number; z: number }) => void;
     onBattery?: (b: { percent: number; milliVolts: number }) => void;
     onDisconnect?: () => void;
+    // Raw input for a consumer that decodes it off the main thread
+    // (hooks/useTrackingWorker.ts). Returning true hands a notification's
+    // decode over: it is not decoded here, and its samples come back
+    // through subscribeDecodedSamples.
+    onRawNotification?: (value: DataView, receivedMs: number) => boolean;
+    onRawBridgeBatch?: (batch: ArrayBuffer, receivedMs: number) => void;
+    subscribeDecodedSamples?: (handler: PackedSamplesHandler) => () => void;
+    // Samples parsed here from legacy '!' packets (BLE UART), packed, for
+    // the same consumer; those notifications are not handed over
+    onLegacySamples?: PackedSamplesHandler;
 }
 
 export function useBluetooth(options: UseBluetoothOptions = {}) {
-    const { onQuaternion, onLinearAccel, onMagnetometer, onBattery, onDisconnect } = options;
+    const { onQuaternion, onLinearAccel, onMagnetometer, onBattery, onDisconnect, onRawNotification, onRawBridgeBatch, subscribeDecodedSamples, onLegacySamples } = options;
 
     const [state, setState] = useState<BluetoothState>({
         isConnected: false,
@@ -217,22 +75,37 @@ export function useBluetooth(options: UseBluetoothOptions = {}) {
         error: null,
     });
 
-    const [entries, setEntries] = useState<TerminalEntry[]>([
-        { id: 0, timestamp: new Date(), type: 'system', message: 'Initializing system...' },
-        { id: 1, timestamp: new Date(), type: 'system', message: 'Ready to connect to QuatStream device.' },
-    ]);
-
-    // Track total packet count separately (entries list is capped at 100)
-    const [packetCount, setPacketCount] = useState(0);
+    // Scrollback and packet count live outside React state; the terminal
+    // view subscribes to them
+    const [log] = useState(() => {
+        const initial = new TerminalLog();
+        initial.push('system', 'Initializing system...');
+        initial.push('system', 'Ready to connect to QuatStream device.');
+        return initial;
+    });
 
     const deviceRef = useRef<BluetoothDevice | null>(null);
     const characteristicRef = useRef<BluetoothRemoteGATTCharacteristic | null>(null);
-    const entryIdRef = useRef(2);
-    // Persistent buffer to handle fragmented BLE packets
-    const incomingBufferRef = useRef<Uint8Array>(new Uint8Array(0));
-
-    const recordingStartPerfRef = useRef<number | null>(null);
-    const recordingRef = useRef<IMURecordingV1 | null>(null);
+    // Notification listener on characteristicRef, for removal
+    const listenerRef = useRef<((event: Event) => void) | null>(null);
+    // Local WebSocket bridge (stream_merge --ws), instead of Web Bluetooth
+    const bridgeRef = useRef<StreamBridgeConnection | null>(null);
+
+    // Notifications are decoded into a preallocated sample ring; samples
+    // reach the callbacks through the scratch objects below, allocation-free
+    const [ingest] = useState(() => new StreamIngest());
+    const [legacy] = useState(() => new LegacyPacketIngest(ingest.ring));
+    const quaternionScratchRef = useRef({ w: 0, x: 0, y: 0, z: 0 });
+    const vectorScratchRef = useRef({ x: 0, y: 0, z: 0 });
+    const batteryScratchRef = useRef({ percent: 0, milliVolts: 0 });
+
+    // The terminal log is updated once per animation frame
+    const flushRequestRef = useRef<number | null>(null);
+    const terminalCursorRef = useRef(0); // Next ring sample to show
+    const pendingEntriesRef = useRef<{ head: number; type: TerminalLineType; message: string }[]>([]);
+
+    // Samples are recorded into typed-array columns, formatted on download
+    const recorderRef = useRef<Recorder | null>(null);
 
     // Use refs for callbacks to avoid stale closures in notification handler
     const onQuaternionRef = useRef(onQuaternion);
@@ -240,6 +113,9 @@ export function useBluetooth(options: UseBluetoothOptions = {}) {
     const onMagnetometerRef = useRef(onMagnetometer);
     const onBatteryRef = useRef(onBattery);
     const onDisconnectRef = useRef(onDisconnect);
+    const onRawNotificationRef = useRef(onRawNotification);
+    const onRawBridgeBatchRef = useRef(onRawBridgeBatch);
+    const onLegacySamplesRef = useRef(onLegacySamples);
 
     // Keep refs updated with latest callbacks
     useEffect(() => {
@@ -248,39 +124,71 @@ export function useBluetooth(options: UseBluetoothOptions = {}) {
         onMagnetometerRef.current = onMagnetometer;
         onBatteryRef.current = onBattery;
         onDisconnectRef.current = onDisconnect;
-    }, [onQuaternion, onLinearAccel, onMagnetometer, onBattery, onDisconnect]);
+        onRawNotificationRef.current = onRawNotification;
+        onRawBridgeBatchRef.current = onRawBridgeBatch;
+        onLegacySamplesRef.current = onLegacySamples;
+    }, [onQuaternion, onLinearAccel, onMagnetometer, onBattery, onDisconnect, onRawNotification, onRawBridgeBatch, onLegacySamples]);
+
+    /**
+     * Append everything since the last frame to the terminal log and
+     * commit it. Samples are formatted here, not as they arrive, and only
+     * while the stream is slow enough to read them one by one; above that
+     * the log writes a rate line per second.
+     */
+    const flushTerminal = useCallback(() => {
+        flushRequestRef.current = null;
+
+        const ring = ingest.ring;
+        const head = ring.head;
+        const pending = pendingEntriesRef.current;
+
+        let i = Math.max(terminalCursorRef.current, ring.oldest());
+        let p = 0;
+        while (i < head || p < pending.length) {
+            // addEntry() messages go in after the samples that preceded them
+            if (p < pending.length && (i >= head || pending[p].head <= i)) {
+                log.push(pending[p].type, pending[p].message);
+                p++;
+                continue;
+            }
+            const slot = ring.slot(i);
+            const type = ring.type[slot];
+            if (type !== FRAME_TYPE_BATTERY && log.sample(type, ring.receivedMs[slot])) {
+                const message = sampleMessage(ring, i);
+                if (message !== null) log.push('data', message);
+            }
+            i++;
+        }
+        terminalCursorRef.current = head;
+        pendingEntriesRef.current = [];
+        log.commit(performance.now());
+    }, [ingest, log]);
+
+    const scheduleFlush = useCallback(() => {
+        if (flushRequestRef.current === null) {
+            flushRequestRef.current = requestAnimationFrame(flushTerminal);
+        }
+    }, [flushTerminal]);
 
+    useEffect(() => () => {
+        if (flushRequestRef.current !== null) cancelAnimationFrame(flushRequestRef.current);
+    }, []);
 
-    const addEntry = useCallback((type: TerminalEntry['type'], message: string, data?: { quaternion?: TerminalEntry['quaternion'], linearAccel?: TerminalEntry['linearAccel'], magnetometer?: TerminalEntry['magnetometer'] }) => {
+    const addEntry = useCallback((type: TerminalLineType, message: string, data?: Pick<RecordingEventV1, 'quaternion' | 'linearAccel' | 'magnetometer'>) => {
         const now = new Date();
-        const startPerf = recordingStartPerfRef.current;
+        const recorder = recorderRef.current;
+        const startPerf = recorder?.startPerf ?? null;
         const tMs = startPerf !== null ? performance.now() - startPerf : undefined;
-        const entry: TerminalEntry = {
-            id: entryIdRef.current++,
-            timestamp: now,
-            tMs,
-            type,
-            message,
-            quaternion: data?.quaternion,
-            linearAccel: data?.linearAccel,
-            magnetometer: data?.magnetometer,
-        };
-        setEntries(prev => {
-            // Keep only last 100 entries to prevent memory issues
-            const newEntries = [...prev, entry];
-            if (newEntries.length > 100) {
-                return newEntries.slice(-100);
-            }
-            return newEntries;
-        });
+        pendingEntriesRef.current.push({ head: ingest.ring.head, type, message });
 
-        // Increment packet count for data entries
+        // Count data entries in the packet total too
         if (type === 'data') {
-            setPacketCount(prev => prev + 1);
+            log.packets++;
         }
+        scheduleFlush();
 
-        if (recordingRef.current && typeof tMs === 'number') {
-            recordingRef.current.events.push({
+        if (recorder && typeof tMs === 'number') {
+            recorder.addEvent({
                 tMs,
                 timestamp: now.toISOString(),
                 type,
@@ -290,7 +198,67 @@ export function useBluetooth(options: UseBluetoothOptions = {}) {
                 magnetometer: data?.magnetometer,
             });
         }
-    }, []);
+    }, [ingest, log, scheduleFlush]);
+
+    /**
+     * Shared by the Bluetooth and bridge paths: record and forward ring
+     * samples [from, to), then ask for a terminal update on the next frame.
+     */
+    const dispatchSamples = useCallback((from: number, to: number) => {
+        const ring = ingest.ring;
+        const values = ring.values;
+        const recorder = recorderRef.current;
+
+        for (let i = from; i < to; i++) {
+            const slot = ring.slot(i);
+            const v = slot * 4;
+            const type = ring.type[slot];
+
+            switch (type) {
+                case FRAME_TYPE_QUATERNION: {
+                    const quaternion = quaternionScratchRef.current;
+                    quaternion.w = values[v];
+                    quaternion.x = values[v + 1];
+                    quaternion.y = values[v + 2];
+                    quaternion.z = values[v + 3];
+                    log.packets++;
+                    recorder?.addSample(type, ring.receivedMs[slot], values, v);
+                    onQuaternionRef.current?.(quaternion);
+                    break;
+                }
+
+                case FRAME_TYPE_MAGNETOMETER:
+                case FRAME_TYPE_LINEAR_ACCEL: {
+                    const vector = vectorScratchRef.current;
+                    vector.x = values[v];
+                    vector.y = values[v + 1];
+                    vector.z = values[v + 2];
+                    log.packets++;
+                    recorder?.addSample(type, ring.receivedMs[slot], values, v);
+                    if (type === FRAME_TYPE_LINEAR_ACCEL) {
+                        onLinearAccelRef.current?.(vector);
+                    } else {
+                        onMagnetometerRef.current?.(vector);
+                    }
+                    break;
+                }
+
+                case FRAME_TYPE_BATTERY: {
+                    // Don't log battery to terminal (too noisy), just call callback
+                    const battery = batteryScratchRef.current;
+                    battery.percent = values[v];
+                    battery.milliVolts = values[v + 1];
+                    onBatteryRef.current?.(battery);
+                    break;
+                }
+
+                default:
+                    break;
+            }
+        }
+
+        if (to > from) scheduleFlush();
+    }, [ingest, log, scheduleFlush]);
 
     const handleNotification = useCallback((event: Event) => {
         const characteristic = event.target as BluetoothRemoteGATTCharacteristic;
@@ -298,127 +266,62 @@ export function useBluetooth(options: UseBluetoothOptions = {}) {
 
         if (!value) return;
 
-        // Append new data to the persistent buffer
-        const newBytes = new Uint8Array(value.buffer, value.byteOffset, value.byteLength);
-        const currentBuffer = incomingBufferRef.current;
-        const newBuffer = new Uint8Array(currentBuffer.length + newBytes.length);
-        newBuffer.set(currentBuffer);
-        newBuffer.set(newBytes, currentBuffer.length);
-        incomingBufferRef.current = newBuffer;
-
-        const buffer = incomingBufferRef.current;
-        let offset = 0;
-
-        while (offset < buffer.length) {
-            // Check if we have enough bytes for at least a header (2 bytes)
-            if (offset + 1 >= buffer.length) break;
+        const receivedMs = performance.now();
+        if (onRawNotificationRef.current?.(value, receivedMs)) return;
 
-            // Look for start marker '!'
-            if (buffer[offset] !== 0x21) {
-                offset++;
-                continue;
-            }
+        const first = ingest.ring.head;
+        if (ingest.push(value, receivedMs) > 0) {
+            dispatchSamples(first, ingest.ring.head);
+        }
+    }, [ingest, dispatchSamples]);
 
-            const identifier = buffer[offset + 1];
+    // BLE UART: legacy packets are parsed here, never handed over
+    const handleLegacyNotification = useCallback((event: Event) => {
+        const characteristic = event.target as BluetoothRemoteGATTCharacteristic;
+        const value = characteristic.value;
 
-            // Try quaternion packet ('Q' = 0x51, 20 bytes)
-            if (identifier === 0x51) {
-                if (offset + 20 <= buffer.length) {
-                    const packetView = new DataView(buffer.buffer, buffer.byteOffset + offset, 20);
-                    const quaternion = parseQuaternionPacket(packetView);
+        if (!value) return;
 
-                    if (quaternion) {
-                        const message = `Q: w=${quaternion.w.toFixed(4)} x=${quaternion.x.toFixed(4)} y=${quaternion.y.toFixed(4)} z=${quaternion.z.toFixed(4)}`;
-                        addEntry('data', message, { quaternion });
+        const receivedMs = performance.now();
+        const ring = ingest.ring;
+        const first = ring.head;
+        if (legacy.push(value, receivedMs) > 0) {
+            dispatchSamples(first, ring.head);
+            onLegacySamplesRef.current?.(ring.pack(first, ring.head), receivedMs);
+        }
+    }, [ingest, legacy, dispatchSamples]);
 
-                        // Use ref to get latest callback
-                        if (onQuaternionRef.current) {
-                            onQuaternionRef.current(quaternion);
-                        }
-                        offset += 20;
-                        continue;
-                    }
-                } else {
-                    // Start marker found but packet incomplete, stop processing to wait for more data
-                    break;
-                }
-            }
+    // Samples of notifications handed over in handleNotification
+    const handleDecodedSamples = useCallback((packed: Float64Array, receivedMs: number) => {
+        const ring = ingest.ring;
+        const first = ring.head;
+        ring.writePacked(packed, receivedMs);
+        dispatchSamples(first, ring.head);
+    }, [ingest, dispatchSamples]);
 
-            // Try magnetometer packet ('M' = 0x4D, 16 bytes)
-            if (identifier === 0x4D) {
-                if (offset + 16 <= buffer.length) {
-                    const packetView = new DataView(buffer.buffer, buffer.byteOffset + offset, 16);
-                    const magnetometer = parseMagnetometerPacket(packetView);
-
-                    if (magnetometer) {
-                        const message = `M: x=${magnetometer.x.toFixed(2)} y=${magnetometer.y.toFixed(2)} z=${magnetometer.z.toFixed(2)} µT`;
-                        addEntry('data', message, { magnetometer });
-
-                        // Use ref to get latest callback
-                        if (onMagnetometerRef.current) {
-                            onMagnetometerRef.current(magnetometer);
-                        }
-                        offset += 16;
-                        continue;
-                    }
-                } else {
-                    // Start marker found but packet incomplete, stop processing to wait for more data
-                    break;
-                }
-            }
+    useEffect(() => subscribeDecodedSamples?.(handleDecodedSamples), [subscribeDecodedSamples, handleDecodedSamples]);
 
-            // Try linear acceleration packet ('A' = 0x41, 16 bytes)
-            if (identifier === 0x41) {
-                if (offset + 16 <= buffer.length) {
-                    const packetView = new DataView(buffer.buffer, buffer.byteOffset + offset, 16);
-                    const linearAccel = parseLinearAccelPacket(packetView);
-
-                    if (linearAccel) {
-                        const message = `A: x=${linearAccel.x.toFixed(2)} y=${linearAccel.y.toFixed(2)} z=${linearAccel.z.toFixed(2)} m/s²`;
-                        addEntry('data', message, { linearAccel });
-
-                        // Use ref to get latest callback
-                        if (onLinearAccelRef.current) {
-                            onLinearAccelRef.current(linearAccel);
-                        }
-                        offset += 16;
-                        continue;
-                    }
-                } else {
-                    // Start marker found but packet incomplete, stop processing to wait for more data
-                    break;
-                }
-            }
+    // Bridge samples arrive decoded, a whole display frame's worth per message
+    const handleBridgeSample = useCallback((type: number, device: number, tUs: number, v: Float32Array) => {
+        if (device !== STREAM_BRIDGE_APP_DEVICE) return;
 
-            // Try battery packet ('B' = 0x42, 6 bytes)
-            if (identifier === 0x42) {
-                if (offset + 6 <= buffer.length) {
-                    const packetView = new DataView(buffer.buffer, buffer.byteOffset + offset, 6);
-                    const battery = parseBatteryPacket(packetView);
-
-                    if (battery) {
-                        // Don't log battery to terminal (too noisy), just call callback
-                        if (onBatteryRef.current) {
-                            onBatteryRef.current(battery);
-                        }
-                        offset += 6;
-                        continue;
-                    }
-                } else {
-                    // Start marker found but packet incomplete, stop processing to wait for more data
-                    break;
-                }
-            }
+        const ring = ingest.ring;
+        ring.write(type, tUs, performance.now(), v[0], v[1], v[2], v[3]);
+        dispatchSamples(ring.head - 1, ring.head);
+    }, [ingest, dispatchSamples]);
 
-            // Unknown packet type or parsing failed, skip this byte
-            offset++;
-        }
+    const startRecording = useCallback(() => {
+        recorderRef.current = new Recorder();
+    }, []);
 
-        // Keep remaining bytes in buffer
-        if (offset > 0) {
-            incomingBufferRef.current = buffer.slice(offset);
-        }
-    }, [addEntry]); // Only depend on addEntry, callbacks accessed via refs
+    // Stamp the disconnect and say what the recording holds. Once: both
+    // disconnect() and the GATT event it causes end up here.
+    const endRecording = useCallback(() => {
+        const recorder = recorderRef.current;
+        if (!recorder || recorder.meta.disconnectedAt) return;
+        recorder.meta.disconnectedAt = new Date().toISOString();
+        addEntry('system', formatRecorderMemory(recorder.memory()));
+    }, [addEntry]);
 
     const connect = useCallback(async () => {
         // Check if Web Bluetooth is supported
@@ -428,16 +331,7 @@ export function useBluetooth(options: UseBluetoothOptions = {}) {
             return;
         }
 
-        recordingStartPerfRef.current = performance.now();
-        recordingRef.current = {
-            schemaVersion: 1,
-            recordedAt: new Date().toISOString(),
-            deviceName: null,
-            connectedAt: null,
-            disconnectedAt: null,
-            calibration: null,
-            events: [],
-        };
+        startRecording();
 
         setState(prev => ({ ...prev, isConnecting: true, error: null }));
         addEntry('system', 'Scanning for QuatStream device...');
@@ -446,7 +340,7 @@ export function useBluetooth(options: UseBluetoothOptions = {}) {
             // Request the device
             const device = await navigator.bluetooth.requestDevice({
                 filters: [{ namePrefix: 'QuatStream' }],
-                optionalServices: [UART_SERVICE_UUID],
+                optionalServices: [STREAM_SERVICE_UUID, UART_SERVICE_UUID],
             });
 
             deviceRef.current = device;
@@ -456,12 +350,12 @@ export function useBluetooth(options: UseBluetoothOptions = {}) {
             device.addEventListener('gattserverdisconnected', () => {
                 setState(prev => ({ ...prev, isConnected: false, deviceName: null }));
                 addEntry('system', 'Device disconnected.');
-                if (recordingRef.current) {
-                    recordingRef.current.disconnectedAt = new Date().toISOString();
-                }
+                endRecording();
                 characteristicRef.current = null;
-                // Reset buffer on disconnect
-                incomingBufferRef.current = new Uint8Array(0);
+                listenerRef.current = null;
+                // Drop any partial frame on disconnect
+                ingest.reset();
+                legacy.reset();
                 if (onDisconnectRef.current) onDisconnectRef.current();
             });
 
@@ -473,18 +367,30 @@ export function useBluetooth(options: UseBluetoothOptions = {}) {
                 throw new Error('Failed to connect to GATT server');
             }
 
-            // Get the UART service
-            addEntry('system', 'Getting UART service...');
-            const service = await server.getPrimaryService(UART_SERVICE_UUID);
+            // Prefer the stream service (frames); fall back to UART on older
+            // sketches, which send legacy '!' packets and get their own parser
+            let txCharacteristic: BluetoothRemoteGATTCharacteristic;
+            let listener: (event: Event) => void;
+            try {
+                const service = await server.getPrimaryService(STREAM_SERVICE_UUID);
+                addEntry('system', 'Using stream service...');
+                txCharacteristic = await service.getCharacteristic(STREAM_CHARACTERISTIC_UUID);
+                listener = handleNotification;
+            } catch {
+                addEntry('system', 'Getting UART service...');
+                const service = await server.getPrimaryService(UART_SERVICE_UUID);
+                // Get the TX characteristic (we receive notifications on this)
+                txCharacteristic = await service.getCharacteristic(UART_TX_CHARACTERISTIC_UUID);
+                listener = handleLegacyNotification;
+            }
+            characteristicRef.current = txCharacteristic;
+            listenerRef.current = listener;
 
-            // Get the TX characteristic (we receive notifications on this)
             addEntry('system', 'Setting up notifications...');
-            const txCharacteristic = await service.getCharacteristic(UART_TX_CHARACTERISTIC_UUID);
-            characteristicRef.current = txCharacteristic;
 
             // Start notifications
             await txCharacteristic.startNotifications();
-            txCharacteristic.addEventListener('characteristicvaluechanged', handleNotification);
+            txCharacteristic.addEventListener('characteristicvaluechanged', listener);
 
             setState({
                 isConnected: true,
@@ -493,9 +399,9 @@ export function useBluetooth(options: UseBluetoothOptions = {}) {
                 error: null,
             });
 
-            if (recordingRef.current) {
-                recordingRef.current.deviceName = device.name || 'QuatStream';
-                recordingRef.current.connectedAt = new Date().toISOString();
+            if (recorderRef.current) {
+                recorderRef.current.meta.deviceName = device.name || 'QuatStream';
+                recorderRef.current.meta.connectedAt = new Date().toISOString();
             }
 
             addEntry('system', `Connected to ${device.name}! Receiving quaternion, magnetometer, and acceleration data...`);
@@ -505,13 +411,65 @@ export function useBluetooth(options: UseBluetoothOptions = {}) {
             setState(prev => ({ ...prev, isConnecting: false, error: message }));
             addEntry('error', `Connection failed: ${message}`);
         }
-    }, [addEntry, handleNotification]);
+    }, [ingest, legacy, addEntry, handleNotification, handleLegacyNotification, startRecording, endRecording]);
+
+    const connectBridge = useCallback((url: string = STREAM_BRIDGE_DEFAULT_URL) => {
+        if (bridgeRef.current) return;
+
+        startRecording();
+        setState(prev => ({ ...prev, isConnecting: true, error: null }));
+        addEntry('system', `Connecting to stream bridge at ${url}...`);
+
+        let opened = false;
+        bridgeRef.current = openStreamBridge(url, {
+            onOpen: () => {
+                opened = true;
+                setState({ isConnected: true, isConnecting: false, deviceName: 'Stream bridge', error: null });
+                if (recorderRef.current) {
+                    recorderRef.current.meta.deviceName = 'Stream bridge';
+                    recorderRef.current.meta.connectedAt = new Date().toISOString();
+                }
+            },
+            onHello: (hello) => {
+                const source = hello.devices[STREAM_BRIDGE_APP_DEVICE] ?? 'unknown source';
+                setState(prev => ({ ...prev, deviceName: `Bridge: ${source}` }));
+                if (recorderRef.current) {
+                    recorderRef.current.meta.deviceName = `Bridge: ${source}`;
+                }
+                addEntry('system', `Connected to bridge (${hello.devices.length} device(s), ${hello.flushHz} Hz batches). Following ${source}...`);
+            },
+            onSample: handleBridgeSample,
+            onBatch: (batch) => onRawBridgeBatchRef.current?.(batch, performance.now()),
+            onClose: (reason) => {
+                bridgeRef.current = null;
+                if (!opened) {
+                    setState(prev => ({ ...prev, isConnecting: false, error: reason }));
+                    addEntry('error', `Connection failed: ${reason}`);
+                    return;
+                }
+                setState(prev => ({ ...prev, isConnected: false, deviceName: null }));
+                addEntry('system', `Bridge disconnected: ${reason}`);
+                endRecording();
+                if (onDisconnectRef.current) onDisconnectRef.current();
+            },
+        });
+    }, [addEntry, handleBridgeSample, startRecording, endRecording]);
+
+    // Don't leave a bridge socket delivering into an unmounted component
+    useEffect(() => () => bridgeRef.current?.close(), []);
 
     const disconnect = useCallback(async () => {
+        if (bridgeRef.current) {
+            bridgeRef.current.close();
+            bridgeRef.current = null;
+        }
+
         if (characteristicRef.current) {
             try {
                 await characteristicRef.current.stopNotifications();
-                characteristicRef.current.removeEventListener('characteristicvaluechanged', handleNotification);
+                if (listenerRef.current) {
+                    characteristicRef.current.removeEventListener('characteristicvaluechanged', listenerRef.current);
+                }
             } catch {
                 // Ignore errors during cleanup
             }
@@ -522,6 +480,7 @@ export function useBluetooth(options: UseBluetoothOptions = {}) {
         }
 
         characteristicRef.current = null;
+        listenerRef.current = null;
         deviceRef.current = null;
 
         setState({
@@ -532,38 +491,32 @@ export function useBluetooth(options: UseBluetoothOptions = {}) {
         });
 
         addEntry('system', 'Disconnected from device.');
-        if (recordingRef.current) {
-            recordingRef.current.disconnectedAt = new Date().toISOString();
-        }
+        endRecording();
 
-        // Reset buffer on disconnect
-        incomingBufferRef.current = new Uint8Array(0);
+        // Drop any partial frame on disconnect
+        ingest.reset();
+        legacy.reset();
         if (onDisconnectRef.current) onDisconnectRef.current();
-    }, [addEntry, handleNotification]); // Removed onDisconnect, using ref
+    }, [ingest, legacy, addEntry, endRecording]); // Removed onDisconnect, using ref
 
     const clearEntries = useCallback(() => {
-        setEntries([]);
-        entryIdRef.current = 0;
-        setPacketCount(0);
-    }, []);
+        pendingEntriesRef.current = [];
+        terminalCursorRef.current = ingest.ring.head;
+        log.clear();
+        log.commit(performance.now());
+    }, [ingest, log]);
 
-    const exportRecording = useCallback(() => {
-        const rec = recordingRef.current;
-        if (!rec) return null;
-        if (typeof structuredClone === 'function') {
-            return structuredClone(rec);
-        }
-        return JSON.parse(JSON.stringify(rec)) as IMURecordingV1;
-    }, []);
+    // Exported lazily by the caller (Recorder.jsonParts(), imurecParts())
+    const getRecorder = useCallback(() => recorderRef.current, []);
 
     return {
         ...state,
-        entries,
-        packetCount,
+        log,
         connect,
+        connectBridge,
         disconnect,
         clearEntries,
         addEntry,
-        exportRecording,
+        getRecorder,
     };
 }
@@ -0,0 +1,99 @@
+'use client';
+
+import { useCallback, useEffect, useRef, useState } from 'react';
+import { createPoseSlotBuffer, poseSlotSupported, PoseSlotReader } from '@/lib/poseSlot';
+import type { PackedSamplesHandler } from '@/lib/streamIngest';
+import type { TrackingWorkerConfig, TrackingWorkerReply, TrackingWorkerRequest } from '@/lib/trackingWorker';
+
+/**
+ * Run the tracking pipeline (lib/trackingWorker.ts) in a worker.
+ *
+ * `pose` is the worker's latest-pose slot once it is running. It stays
+ * null if the page is not cross-origin isolated (no SharedArrayBuffer) or
+ * was opened with ?tracking=main; the page then tracks on the main thread
+ * as before, and the post functions do nothing.
+ *
+ * While the worker is running and a handler is subscribed
+ * (subscribeSamples), it decodes notifications for the page too:
+ * postNotification() then returns true, and the notification's samples
+ * reach the handler a moment later instead of being decoded here.
+ */
+export function useTrackingWorker(config: TrackingWorkerConfig) {
+    const { calibration, positionLocked, calibrating, replaying } = config;
+    const workerRef = useRef<Worker | null>(null);
+    const [pose, setPose] = useState<PoseSlotReader | null>(null);
+    const readyRef = useRef(false);
+    const samplesHandlerRef = useRef<PackedSamplesHandler | null>(null);
+
+    const post = useCallback((request: TrackingWorkerRequest, transfer: Transferable[] = []) => {
+        workerRef.current?.postMessage(request, transfer);
+    }, []);
+
+    useEffect(() => {
+        if (!poseSlotSupported()) return;
+        if (new URLSearchParams(window.location.search).get('tracking') === 'main') return;
+
+        const buffer = createPoseSlotBuffer();
+        const worker = new Worker(new URL('../lib/trackingWorker.ts', import.meta.url), { type: 'module' });
+        worker.onmessage = (event: MessageEvent<TrackingWorkerReply>) => {
+            const reply = event.data;
+            switch (reply.kind) {
+                case 'ready':
+                    readyRef.current = true;
+                    setPose(new PoseSlotReader(buffer));
+                    break;
+                case 'samples':
+                    samplesHandlerRef.current?.(reply.packed, reply.receivedMs);
+                    break;
+            }
+        };
+        workerRef.current = worker;
+        post({ kind: 'init', pose: buffer });
+
+        return () => {
+            worker.terminate();
+            workerRef.current = null;
+            readyRef.current = false;
+            setPose(null);
+        };
+    }, [post]);
+
+    // Declared after the worker effect, so a new worker gets it right away
+    useEffect(() => {
+        post({ kind: 'config', config: { calibration, positionLocked, calibrating, replaying } });
+    }, [post, calibration, positionLocked, calibrating, replaying]);
+
+    // True if the worker decodes this notification for the page as well
+    const postNotification = useCallback((value: DataView, receivedMs: number): boolean => {
+        if (!workerRef.current) return false;
+        const reply = readyRef.current && samplesHandlerRef.current !== null;
+        // characteristic.value stays the characteristic's; transfer a copy
+        const bytes = new Uint8Array(value.buffer, value.byteOffset, value.byteLength).slice().buffer;
+        post({ kind: 'notification', bytes, receivedMs, reply }, [bytes]);
+        return reply;
+    }, [post]);
+
+    // One handler at a time; returns the unsubscribe function
+    const subscribeSamples = useCallback((handler: PackedSamplesHandler) => {
+        samplesHandlerRef.current = handler;
+        return () => {
+            if (samplesHandlerRef.current === handler) samplesHandlerRef.current = null;
+        };
+    }, []);
+
+    const postBridgeBatch = useCallback((batch: ArrayBuffer, receivedMs: number) => {
+        post({ kind: 'bridge', batch, receivedMs }, [batch]);
+    }, [post]);
+
+    // Samples the page decoded itself (legacy '!' packets)
+    const postSamples = useCallback((packed: Float64Array, receivedMs: number) => {
+        post({ kind: 'samples', packed, receivedMs }, [packed.buffer]);
+    }, [post]);
+
+    // Back to the origin, as EKFTracker.reset() on the main thread
+    const reset = useCallback(() => {
+        post({ kind: 'reset' });
+    }, [post]);
+
+    return { pose, postNotification, postBridgeBatch, postSamples, subscribeSamples, reset };
+}
@@ -48,50 +48,54 @@ export const CALIBRATION_STEPS: { step: CalibrationStep; label: string; instruct
 export const CALIBRATION_STORAGE_KEY = 'imu_calibration_data';
 const SAMPLES_PER_STEP = 25;
 
+/**
+ * Row-major 3x3 matrix taking raw IMU acceleration to calibrated axes:
+ * row i is the normalized (positive - negative) average for axis i.
+ */
+export function calibrationMatrix(calibrationData: CalibrationData): Float64Array {
+    const cal = calibrationData;
+    const m = new Float64Array(9);
+
+    // The idea: during +X calibration, the dominant acceleration axis tells us which IMU axis maps to world X
+    const rows: [Vector3Data, Vector3Data][] = [
+        [cal.posX, cal.negX],
+        [cal.posY, cal.negY],
+        [cal.posZ, cal.negZ],
+    ];
+    rows.forEach(([pos, neg], i) => {
+        // Difference vector (positive - negative = axis direction), normalized
+        const x = pos.x - neg.x;
+        const y = pos.y - neg.y;
+        const z = pos.z - neg.z;
+        const len = Math.sqrt(x * x + y * y + z * z);
+        if (len === 0) return;
+        m[i * 3] = x / len;
+        m[i * 3 + 1] = y / len;
+        m[i * 3 + 2] = z / len;
+    });
+    return m;
+}
+
+/**
+ * Apply a calibrationMatrix() to `accel`, writing the result to `out`
+ * (which may be `accel`). Returns `out`.
+ */
+export function applyCalibrationMatrix(m: Float64Array, accel: Vector3Data, out: Vector3Data): Vector3Data {
+    const x = accel.x, y = accel.y, z = accel.z;
+    out.x = x * m[0] + y * m[1] + z * m[2];
+    out.y = x * m[3] + y * m[4] + z * m[5];
+    out.z = x * m[6] + y * m[7] + z * m[8];
+    return out;
+}
+
 export function transformAccelerationWithCalibration(calibrationData: CalibrationData | null, accel: Vector3Data): Vector3Data {
     if (!calibrationData) {
         return accel; // No calibration, return as-is
     }
 
-    // Calculate the axis mapping from calibration data
-    // The idea: during +X calibration, the dominant acceleration axis tells us which IMU axis maps to world X
-    const cal = calibrationData;
-
-    // Calculate difference vectors for each axis (positive - negative = axis direction)
-    const xAxis = {
-        x: cal.posX.x - cal.negX.x,
-        y: cal.posX.y - cal.negX.y,
-        z: cal.posX.z - cal.negX.z,
-    };
-    const yAxis = {
-        x: cal.posY.x - cal.negY.x,
-        y: cal.posY.y - cal.negY.y,
-        z: cal.posY.z - cal.negY.z,
-    };
-    const zAxis = {
-        x: cal.posZ.x - cal.negZ.x,
-        y: cal.posZ.y - cal.negZ.y,
-        z: cal.posZ.z - cal.negZ.z,
-    };
-
-    // Normalize the axis vectors
-    const normalize = (v: Vector3Data): Vector3Data => {
-        const len = Math.sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
-        if (len === 0) return { x: 0, y: 0, z: 0 };
-        return { x: v.x / len, y: v.y / len, z: v.z / len };
-    };
-
-    const xNorm = normalize(xAxis);
-    const yNorm = normalize(yAxis);
-    const zNorm = normalize(zAxis);
-
     // Transform the acceleration using the calibration matrix (dot products)
     // This projects the raw acceleration onto our calibrated axes
-    return {
-        x: accel.x * xNorm.x + accel.y * xNorm.y + accel.z * xNorm.z,
-        y: accel.x * yNorm.x + accel.y * yNorm.y + accel.z * yNorm.z,
-        z: accel.x * zNorm.x + accel.y * zNorm.y + accel.z * zNorm.z,
-    };
+    return applyCalibrationMatrix(calibrationMatrix(calibrationData), accel, { x: 0, y: 0, z: 0 });
 }
 
 export class CalibrationManager {
@@ -36,8 +36,9 @@ export class EKFTracker {
     // Last update timestamp
     private lastUpdateTime: number;
 
-    // Last known orientation (from BNO085)
+    // Last known orientation (from BNO085), copied into lastQuaternionValue
     private lastQuaternion: { w: number; x: number; y: number; z: number } | null = null;
+    private readonly lastQuaternionValue = { w: 1, x: 0, y: 0, z: 0 };
 
     // Reference heading captured at start
     private referenceHeading: number | null = null;
@@ -135,8 +136,14 @@ export class EKFTracker {
         dt: number
     ): { x: number; y: number; z: number } {
 
-        // Store quaternion for magnetometer updates
-        this.lastQuaternion = quat;
+        // Store quaternion for magnetometer updates; copied, since callers
+        // may pass an object they reuse for every sample
+        const last = this.lastQuaternionValue;
+        last.w = quat.w;
+        last.x = quat.x;
+        last.y = quat.y;
+        last.z = quat.z;
+        this.lastQuaternion = last;
 
         // Skip if dt too large (prevents huge jumps after tab inactive)
         if (dt > this.MAX_DT || dt <= 0) {
@@ -1,8 +1,6 @@
 'use client';
 
-export function downloadJson(filename: string, data: unknown): void {
-    const json = JSON.stringify(data, null, 2);
-    const blob = new Blob([json], { type: "application/json" });
+function downloadBlob(filename: string, blob: Blob): void {
     const url = URL.createObjectURL(blob);
 
     const link = document.createElement("a");
@@ -15,3 +13,24 @@ export function downloadJson(filename: string, data: unknown): void {
     URL.revokeObjectURL(url);
 }
 
+export function downloadJson(filename: string, data: unknown): void {
+    const json = JSON.stringify(data, null, 2);
+    downloadBlob(filename, new Blob([json], { type: "application/json" }));
+}
+
+/**
+ * Download a file produced part by part (lib/recorder.ts), yielding to the
+ * page between parts so a long recording doesn't freeze it while the file
+ * is put together. String parts are encoded as they come, so each can be
+ * collected before the next is made.
+ */
+export async function downloadParts(filename: string, parts: Iterable<BlobPart>, type: string): Promise<void> {
+    const encoder = new TextEncoder();
+    const blobParts: BlobPart[] = [];
+
+    for (const part of parts) {
+        blobParts.push(typeof part === "string" ? encoder.encode(part) : part);
+        await new Promise(resolve => setTimeout(resolve, 0));
+    }
+    downloadBlob(filename, new Blob(blobParts, { type }));
+}
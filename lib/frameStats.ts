@@ -0,0 +1,74 @@
+/**
+ * Frame-time statistics for the render loop.
+ *
+ * Frame intervals go into a preallocated window; summary() reports their
+ * mean, standard deviation and tail, which is where tracking jitter shows:
+ * a frame delayed by a React render or a GC pause on the main thread is
+ * a long interval followed by a short one.
+ */
+
+export const FRAME_STATS_WINDOW = 1024;
+
+export interface FrameTimeSummary {
+    frames: number;
+    meanMs: number;
+    sdMs: number;
+    p50Ms: number;
+    p99Ms: number;
+    maxMs: number;
+    slowFrames: number; // Longer than 1.5x the median
+}
+
+export class FrameTimeStats {
+    private readonly intervals = new Float64Array(FRAME_STATS_WINDOW);
+    private readonly sorted = new Float64Array(FRAME_STATS_WINDOW);
+    private count = 0;
+
+    add(intervalMs: number): void {
+        this.intervals[this.count % FRAME_STATS_WINDOW] = intervalMs;
+        this.count++;
+    }
+
+    reset(): void {
+        this.count = 0;
+    }
+
+    /**
+     * Statistics over the last FRAME_STATS_WINDOW intervals, or null if
+     * there are none
+     */
+    summary(): FrameTimeSummary | null {
+        const n = Math.min(this.count, FRAME_STATS_WINDOW);
+        if (n === 0) return null;
+
+        let sum = 0;
+        for (let i = 0; i < n; i++) sum += this.intervals[i];
+        const mean = sum / n;
+        let squares = 0;
+        for (let i = 0; i < n; i++) squares += (this.intervals[i] - mean) ** 2;
+
+        const sorted = this.sorted.subarray(0, n);
+        sorted.set(this.intervals.subarray(0, n));
+        sorted.sort();
+        const p50 = sorted[Math.floor((n - 1) * 0.5)];
+
+        let slow = 0;
+        for (let i = 0; i < n; i++) if (sorted[i] > p50 * 1.5) slow++;
+
+        return {
+            frames: n,
+            meanMs: mean,
+            sdMs: Math.sqrt(squares / n),
+            p50Ms: p50,
+            p99Ms: sorted[Math.floor((n - 1) * 0.99)],
+            maxMs: sorted[n - 1],
+            slowFrames: slow,
+        };
+    }
+}
+
+export function formatFrameTimeSummary(label: string, s: FrameTimeSummary): string {
+    return `[frame-time] ${label}: ${s.frames} frames, mean ${s.meanMs.toFixed(2)} ms, ` +
+        `sd ${s.sdMs.toFixed(2)} ms, p50 ${s.p50Ms.toFixed(2)} ms, p99 ${s.p99Ms.toFixed(2)} ms, ` +
+        `max ${s.maxMs.toFixed(1)} ms, ${s.slowFrames} slow`;
+}
@@ -0,0 +1,153 @@
+/**
+ * Latest-pose slot shared between the tracking worker and the renderer.
+ *
+ * One writer (lib/trackingWorker.ts) and any number of readers share a
+ * SharedArrayBuffer:
+ *   Int32 seq | Int32 pad | f64 values[POSE_SLOT_VALUES]
+ *
+ * Seqlock, as in scripts/firmware/host/stream_shm.hpp: the writer makes
+ * seq odd, stores the values, then makes it even again. A reader copies
+ * the values between two loads of seq and keeps the copy only if both
+ * loads saw the same even number, so it never blocks the writer and never
+ * sees half of one pose and half of the next. A reader that keeps losing
+ * the race returns false and keeps what it had.
+ */
+
+export const POSE_FLAG_QUATERNION = 0x01;
+export const POSE_FLAG_POSITION = 0x02;
+
+const POSE_HEADER_BYTES = 8;
+const POSE_SLOT_VALUES = 13;
+const POSE_READ_ATTEMPTS = 4;
+
+// values[] layout
+const POSE_W = 0;
+const POSE_X = 1;
+const POSE_Y = 2;
+const POSE_Z = 3;
+const POSE_PX = 4;
+const POSE_PY = 5;
+const POSE_PZ = 6;
+const POSE_AX = 7;
+const POSE_AY = 8;
+const POSE_AZ = 9;
+const POSE_SAMPLES = 10;
+const POSE_RECEIVED_MS = 11;
+const POSE_FLAGS = 12;
+
+export const POSE_SLOT_BYTES = POSE_HEADER_BYTES + POSE_SLOT_VALUES * 8;
+
+export interface PoseSample {
+    quaternion: { w: number; x: number; y: number; z: number };
+    position: { x: number; y: number; z: number };
+    linearAccel: { x: number; y: number; z: number }; // Calibrated
+    samples: number; // Samples applied since the last reset
+    receivedMs: number; // Page clock of the newest one
+    flags: number; // POSE_FLAG_*
+}
+
+export function createPoseSample(): PoseSample {
+    return {
+        quaternion: { w: 1, x: 0, y: 0, z: 0 },
+        position: { x: 0, y: 0, z: 0 },
+        linearAccel: { x: 0, y: 0, z: 0 },
+        samples: 0,
+        receivedMs: 0,
+        flags: 0,
+    };
+}
+
+/**
+ * True if SharedArrayBuffer can be created and posted to a worker, which
+ * needs a cross-origin isolated page (next.config.ts sets the headers)
+ */
+export function poseSlotSupported(): boolean {
+    return typeof SharedArrayBuffer !== 'undefined' &&
+        typeof crossOriginIsolated !== 'undefined' && crossOriginIsolated;
+}
+
+export function createPoseSlotBuffer(): SharedArrayBuffer {
+    return new SharedArrayBuffer(POSE_SLOT_BYTES);
+}
+
+export class PoseSlotWriter {
+    private readonly seq: Int32Array;
+    private readonly values: Float64Array;
+
+    constructor(buffer: SharedArrayBuffer) {
+        this.seq = new Int32Array(buffer, 0, 1);
+        this.values = new Float64Array(buffer, POSE_HEADER_BYTES, POSE_SLOT_VALUES);
+    }
+
+    publish(pose: PoseSample): void {
+        const v = this.values;
+
+        Atomics.add(this.seq, 0, 1);
+        v[POSE_W] = pose.quaternion.w;
+        v[POSE_X] = pose.quaternion.x;
+        v[POSE_Y] = pose.quaternion.y;
+        v[POSE_Z] = pose.quaternion.z;
+        v[POSE_PX] = pose.position.x;
+        v[POSE_PY] = pose.position.y;
+        v[POSE_PZ] = pose.position.z;
+        v[POSE_AX] = pose.linearAccel.x;
+        v[POSE_AY] = pose.linearAccel.y;
+        v[POSE_AZ] = pose.linearAccel.z;
+        v[POSE_SAMPLES] = pose.samples;
+        v[POSE_RECEIVED_MS] = pose.receivedMs;
+        v[POSE_FLAGS] = pose.flags;
+        Atomics.add(this.seq, 0, 1);
+    }
+}
+
+export class PoseSlotReader {
+    private readonly seq: Int32Array;
+    private readonly values: Float64Array;
+    private lastSeq = -1;
+
+    constructor(buffer: SharedArrayBuffer) {
+        this.seq = new Int32Array(buffer, 0, 1);
+        this.values = new Float64Array(buffer, POSE_HEADER_BYTES, POSE_SLOT_VALUES);
+    }
+
+    /**
+     * Copy the latest pose into `out`. Returns false, leaving `out` as it
+     * was, if nothing was published since the last successful read or
+     * the writer kept overlapping the copy.
+     */
+    read(out: PoseSample): boolean {
+        const v = this.values;
+
+        for (let attempt = 0; attempt < POSE_READ_ATTEMPTS; attempt++) {
+            const before = Atomics.load(this.seq, 0);
+            if (before === this.lastSeq) return false;
+            if (before & 1) continue;
+
+            const w = v[POSE_W], x = v[POSE_X], y = v[POSE_Y], z = v[POSE_Z];
+            const px = v[POSE_PX], py = v[POSE_PY], pz = v[POSE_PZ];
+            const ax = v[POSE_AX], ay = v[POSE_AY], az = v[POSE_AZ];
+            const samples = v[POSE_SAMPLES];
+            const receivedMs = v[POSE_RECEIVED_MS];
+            const flags = v[POSE_FLAGS];
+
+            if (Atomics.load(this.seq, 0) !== before) continue;
+
+            this.lastSeq = before;
+            out.quaternion.w = w;
+            out.quaternion.x = x;
+            out.quaternion.y = y;
+            out.quaternion.z = z;
+            out.position.x = px;
+            out.position.y = py;
+            out.position.z = pz;
+            out.linearAccel.x = ax;
+            out.linearAccel.y = ay;
+            out.linearAccel.z = az;
+            out.samples = samples;
+            out.receivedMs = receivedMs;
+            out.flags = flags;
+            return true;
+        }
+        return false;
+    }
+}
@@ -1,7 +1,12 @@
 import { EKFTracker } from "./EKFTracker";
-import { transformAccelerationWithCalibration } from "./CalibrationManager";
-import type { IMURecordingV1, QuaternionData, RecordingEventV1 } from "./recording";
-import type { ReplayFrameV1, ReplaySessionV1, Vector3Data } from "./replay";
+import { applyCalibrationMatrix, calibrationMatrix } from "./CalibrationManager";
+import type { IMURecordingV1, RecordingEventV1 } from "./recording";
+import { ReplayFrames, type ReplaySession } from "./replay";
+
+// Time slice of incremental preprocessing before it yields to the page
+const PREPROCESS_SLICE_MS = 8;
+// Events processed between two looks at the clock
+const PREPROCESS_CHECK_EVENTS = 256;
 
 function clamp01(value: number): number {
     if (value < 0) return 0;
@@ -9,51 +14,6 @@ function clamp01(value: number): number {
     return value;
 }
 
-function normalizeQuaternion(q: QuaternionData): QuaternionData {
-    const len = Math.sqrt(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
-    if (!Number.isFinite(len) || len === 0) {
-        return { w: 1, x: 0, y: 0, z: 0 };
-    }
-    return { w: q.w / len, x: q.x / len, y: q.y / len, z: q.z / len };
-}
-
-function slerpQuaternion(aIn: QuaternionData, bIn: QuaternionData, t: number): QuaternionData {
-    const a = normalizeQuaternion(aIn);
-    let b = normalizeQuaternion(bIn);
-
-    let dot = a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
-    if (dot < 0) {
-        dot = -dot;
-        b = { w: -b.w, x: -b.x, y: -b.y, z: -b.z };
-    }
-
-    if (dot > 0.9995) {
-        const lerped = {
-            w: a.w + t * (b.w - a.w),
-            x: a.x + t * (b.x - a.x),
-            y: a.y + t * (b.y - a.y),
-            z: a.z + t * (b.z - a.z),
-        };
-        return normalizeQuaternion(lerped);
-    }
-
-    const theta0 = Math.acos(clamp01(dot));
-    const sinTheta0 = Math.sin(theta0);
-    if (sinTheta0 === 0) return a;
-
-    const theta = theta0 * t;
-    const sinTheta = Math.sin(theta);
-    const s0 = Math.cos(theta) - dot * (sinTheta / sinTheta0);
-    const s1 = sinTheta / sinTheta0;
-
-    return normalizeQuaternion({
-        w: s0 * a.w + s1 * b.w,
-        x: s0 * a.x + s1 * b.x,
-        y: s0 * a.y + s1 * b.y,
-        z: s0 * a.z + s1 * b.z,
-    });
-}
-
 function estimateAccelDtSeconds(events: RecordingEventV1[]): number {
     const accelTimes: number[] = [];
     for (const e of events) {
@@ -73,86 +33,332 @@ function estimateAccelDtSeconds(events: RecordingEventV1[]): number {
     return count > 0 ? sum / count : 1 / 60;
 }
 
-function lerp(a: number, b: number, t: number): number {
-    return a + (b - a) * t;
+// Recordings are written in time order; copy and sort only if one isn't
+function sortedByTime(events: RecordingEventV1[]): RecordingEventV1[] {
+    for (let i = 1; i < events.length; i++) {
+        if (events[i].tMs < events[i - 1].tMs) {
+            return [...events].sort((a, b) => a.tMs - b.tMs);
+        }
+    }
+    return events;
 }
 
-function lerpVec3(a: Vector3Data, b: Vector3Data, t: number): Vector3Data {
-    return { x: lerp(a.x, b.x, t), y: lerp(a.y, b.y, t), z: lerp(a.z, b.z, t) };
+/**
+ * Keyframes of one kind in time order: tMs, and `components` values each.
+ * `total` is known up front, so a reader can tell whether more will come.
+ */
+class Keyframes {
+    readonly total: number;
+    readonly t: Float64Array;
+    readonly v: Float64Array;
+    count = 0;
+
+    constructor(total: number, components: number) {
+        this.total = total;
+        this.t = new Float64Array(total);
+        this.v = new Float64Array(total * components);
+    }
+
+    get complete(): boolean {
+        return this.count === this.total;
+    }
+
+    /** True if frame time tMs has both of its neighbours here already */
+    covers(tMs: number): boolean {
+        return this.complete || (this.count > 0 && this.t[this.count - 1] > tMs);
+    }
+
+    /** Index of the keyframe to interpolate from at tMs, advancing `from` */
+    seek(from: number, tMs: number): number {
+        while (from + 1 < this.count && this.t[from + 1] <= tMs) from++;
+        return from;
+    }
+
+    alpha(index: number, next: number, tMs: number): number {
+        const t0 = this.t[index];
+        const t1 = this.t[next];
+        return t1 === t0 ? 0 : clamp01((tMs - t0) / (t1 - t0));
+    }
 }
 
-export function preprocessRecordingToReplay(
-    recording: IMURecordingV1,
-    options?: { frameRate?: number; sourceFileName?: string }
-): ReplaySessionV1 {
-    const events = [...recording.events].sort((a, b) => a.tMs - b.tMs);
+/**
+ * Turns a recording into replay frames: orientation from its quaternion
+ * events, position from running its acceleration through the EKF, both
+ * resampled to a fixed frame rate.
+ *
+ * Work is done in steps. step() processes events in time order and
+ * writes every frame whose surrounding keyframes are known by then, so
+ * the session's first frames are ready long before the last.
+ */
+export class ReplayPreprocessor {
+    readonly session: ReplaySession;
+    private readonly frames: ReplayFrames;
+    private readonly events: RecordingEventV1[];
+    private readonly quaternions: Keyframes;
+    private readonly positions: Keyframes;
+    private readonly tracker = new EKFTracker();
+    private readonly calibration: Float64Array | null;
+    private readonly defaultDt: number;
+    private readonly quat = { w: 1, x: 0, y: 0, z: 0 };
+    private readonly accel = { x: 0, y: 0, z: 0 };
+    private next = 0;
+    private lastAccelTMs: number | null = null;
+    private qIndex = 0;
+    private pIndex = 0;
 
-    const quaternionKeyframes: Array<{ tMs: number; quaternion: QuaternionData }> = [];
-    const positionKeyframes: Array<{ tMs: number; position: Vector3Data }> = [];
+    constructor(recording: IMURecordingV1, options?: { frameRate?: number; sourceFileName?: string }) {
+        const events = sortedByTime(recording.events);
+
+        // Count keyframes first, so arrays are sized once and frames know
+        // whether a later keyframe is still to come
+        let quaternionCount = 0;
+        let positionCount = 0;
+        for (const event of events) {
+            if (event.quaternion) quaternionCount++;
+            if (event.linearAccel && quaternionCount > 0) positionCount++;
+        }
 
-    const tracker = new EKFTracker();
-    const defaultDt = estimateAccelDtSeconds(events);
+        const durationMs = events.length > 0 ? Math.max(0, events[events.length - 1].tMs) : 0;
+        const frameIntervalMs = 1000 / (options?.frameRate ?? 60);
 
-    let lastQuat: QuaternionData | null = null;
-    let lastAccelTMs: number | null = null;
+        this.events = events;
+        this.quaternions = new Keyframes(quaternionCount, 4);
+        this.positions = new Keyframes(positionCount, 3);
+        this.calibration = recording.calibration ? calibrationMatrix(recording.calibration) : null;
+        this.defaultDt = estimateAccelDtSeconds(events);
+        this.frames = new ReplayFrames(Math.floor(durationMs / frameIntervalMs) + 1, frameIntervalMs);
+        this.session = {
+            sourceFileName: options?.sourceFileName,
+            deviceName: recording.deviceName ?? null,
+            durationMs,
+            frames: this.frames,
+        };
+    }
+
+    get complete(): boolean {
+        return this.frames.complete;
+    }
+
+    /**
+     * Work until performance.now() reaches deadlineMs or everything is
+     * done; returns true once it is
+     */
+    step(deadlineMs: number): boolean {
+        const events = this.events;
+
+        while (this.next < events.length) {
+            const end = Math.min(this.next + PREPROCESS_CHECK_EVENTS, events.length);
+            for (; this.next < end; this.next++) this.addEvent(events[this.next]);
+            this.writeFrames();
+            if (performance.now() >= deadlineMs) return this.complete;
+        }
+        this.writeFrames();
+        return this.complete;
+    }
+
+    private addEvent(event: RecordingEventV1): void {
+        const quaternions = this.quaternions;
+        const positions = this.positions;
 
-    for (const event of events) {
         if (event.quaternion) {
-            lastQuat = normalizeQuaternion(event.quaternion);
-            quaternionKeyframes.push({ tMs: event.tMs, quaternion: lastQuat });
+            const q = event.quaternion;
+            const len = Math.sqrt(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+            const quat = this.quat;
+            if (!Number.isFinite(len) || len === 0) {
+                quat.w = 1;
+                quat.x = 0;
+                quat.y = 0;
+                quat.z = 0;
+            } else {
+                quat.w = q.w / len;
+                quat.x = q.x / len;
+                quat.y = q.y / len;
+                quat.z = q.z / len;
+            }
+            const k = quaternions.count++;
+            quaternions.t[k] = event.tMs;
+            quaternions.v[k * 4] = quat.w;
+            quaternions.v[k * 4 + 1] = quat.x;
+            quaternions.v[k * 4 + 2] = quat.y;
+            quaternions.v[k * 4 + 3] = quat.z;
         }
 
-        if (event.linearAccel && lastQuat) {
-            const accel = transformAccelerationWithCalibration(recording.calibration ?? null, event.linearAccel);
-            const dt = lastAccelTMs === null ? defaultDt : (event.tMs - lastAccelTMs) / 1000;
-            lastAccelTMs = event.tMs;
-            const position = tracker.predictWithDt(accel, lastQuat, dt);
-            positionKeyframes.push({ tMs: event.tMs, position });
+        if (event.linearAccel && quaternions.count > 0) {
+            const accel = this.accel;
+            accel.x = event.linearAccel.x;
+            accel.y = event.linearAccel.y;
+            accel.z = event.linearAccel.z;
+            if (this.calibration) applyCalibrationMatrix(this.calibration, accel, accel);
+
+            const dt = this.lastAccelTMs === null ? this.defaultDt : (event.tMs - this.lastAccelTMs) / 1000;
+            this.lastAccelTMs = event.tMs;
+            const position = this.tracker.predictWithDt(accel, this.quat, dt);
+            const k = positions.count++;
+            positions.t[k] = event.tMs;
+            positions.v[k * 3] = position.x;
+            positions.v[k * 3 + 1] = position.y;
+            positions.v[k * 3 + 2] = position.z;
         }
 
         if (event.magnetometer) {
-            tracker.updateMagnetometer(event.magnetometer);
+            this.tracker.updateMagnetometer(event.magnetometer);
         }
     }
 
-    const lastQuatT = quaternionKeyframes.length > 0 ? quaternionKeyframes[quaternionKeyframes.length - 1].tMs : 0;
-    const lastPosT = positionKeyframes.length > 0 ? positionKeyframes[positionKeyframes.length - 1].tMs : 0;
-    const durationMs = Math.max(lastQuatT, lastPosT, events.length > 0 ? events[events.length - 1].tMs : 0);
+    // Frames whose keyframes on both sides are known
+    private writeFrames(): void {
+        const frames = this.frames;
+        const quaternions = this.quaternions;
+        const positions = this.positions;
+
+        while (frames.ready < frames.total) {
+            const f = frames.ready;
+            const tMs = frames.tMs(f);
+            if (!quaternions.covers(tMs) || !positions.covers(tMs)) return;
+
+            this.qIndex = quaternions.seek(this.qIndex, tMs);
+            this.pIndex = positions.seek(this.pIndex, tMs);
+            this.writeQuaternion(f, tMs);
+            this.writePosition(f, tMs);
+            frames.ready++;
+        }
+    }
 
-    const frameRate = options?.frameRate ?? 60;
-    const frameIntervalMs = 1000 / frameRate;
-    const frames: ReplayFrameV1[] = [];
+    private writeQuaternion(frame: number, tMs: number): void {
+        const keys = this.quaternions;
+        const out = this.frames.quaternion;
+        const o = frame * 4;
 
-    let qIndex = 0;
-    let pIndex = 0;
+        if (keys.count === 0) {
+            out[o] = 1;
+            out[o + 1] = 0;
+            out[o + 2] = 0;
+            out[o + 3] = 0;
+            return;
+        }
 
-    for (let tMs = 0; tMs <= durationMs; tMs += frameIntervalMs) {
-        while (qIndex + 1 < quaternionKeyframes.length && quaternionKeyframes[qIndex + 1].tMs <= tMs) qIndex++;
-        while (pIndex + 1 < positionKeyframes.length && positionKeyframes[pIndex + 1].tMs <= tMs) pIndex++;
+        const i = this.qIndex;
+        const j = Math.min(i + 1, keys.count - 1);
+        const t = keys.alpha(i, j, tMs);
+        const v = keys.v;
+        const aw = v[i * 4], ax = v[i * 4 + 1], ay = v[i * 4 + 2], az = v[i * 4 + 3];
+        let bw = v[j * 4], bx = v[j * 4 + 1], by = v[j * 4 + 2], bz = v[j * 4 + 3];
 
-        const q0 = quaternionKeyframes[qIndex]?.quaternion ?? { w: 1, x: 0, y: 0, z: 0 };
-        const q1 = quaternionKeyframes[Math.min(qIndex + 1, quaternionKeyframes.length - 1)]?.quaternion ?? q0;
-        const q0t = quaternionKeyframes[qIndex]?.tMs ?? 0;
-        const q1t = quaternionKeyframes[Math.min(qIndex + 1, quaternionKeyframes.length - 1)]?.tMs ?? q0t;
-        const qAlpha = q1t === q0t ? 0 : clamp01((tMs - q0t) / (q1t - q0t));
-        const quaternion = slerpQuaternion(q0, q1, qAlpha);
+        // Slerp along the shorter arc
+        let dot = aw * bw + ax * bx + ay * by + az * bz;
+        if (dot < 0) {
+            dot = -dot;
+            bw = -bw;
+            bx = -bx;
+            by = -by;
+            bz = -bz;
+        }
 
-        const p0 = positionKeyframes[pIndex]?.position ?? { x: 0, y: 0, z: 0 };
-        const p1 = positionKeyframes[Math.min(pIndex + 1, positionKeyframes.length - 1)]?.position ?? p0;
-        const p0t = positionKeyframes[pIndex]?.tMs ?? 0;
-        const p1t = positionKeyframes[Math.min(pIndex + 1, positionKeyframes.length - 1)]?.tMs ?? p0t;
-        const pAlpha = p1t === p0t ? 0 : clamp01((tMs - p0t) / (p1t - p0t));
-        const position = lerpVec3(p0, p1, pAlpha);
+        let s0 = 1 - t;
+        let s1 = t;
+        if (dot <= 0.9995) {
+            const theta0 = Math.acos(clamp01(dot));
+            const sinTheta0 = Math.sin(theta0);
+            if (sinTheta0 === 0) {
+                s0 = 1;
+                s1 = 0;
+            } else {
+                const theta = theta0 * t;
+                const sinTheta = Math.sin(theta);
+                s0 = Math.cos(theta) - dot * (sinTheta / sinTheta0);
+                s1 = sinTheta / sinTheta0;
+            }
+        }
 
-        frames.push({ tMs, position, quaternion });
+        const w = s0 * aw + s1 * bw;
+        const x = s0 * ax + s1 * bx;
+        const y = s0 * ay + s1 * by;
+        const z = s0 * az + s1 * bz;
+        const len = Math.sqrt(w * w + x * x + y * y + z * z);
+        if (!Number.isFinite(len) || len === 0) {
+            out[o] = 1;
+            out[o + 1] = 0;
+            out[o + 2] = 0;
+            out[o + 3] = 0;
+            return;
+        }
+        out[o] = w / len;
+        out[o + 1] = x / len;
+        out[o + 2] = y / len;
+        out[o + 3] = z / len;
     }
 
+    private writePosition(frame: number, tMs: number): void {
+        const keys = this.positions;
+        const out = this.frames.position;
+        const o = frame * 3;
+
+        if (keys.count === 0) {
+            out[o] = 0;
+            out[o + 1] = 0;
+            out[o + 2] = 0;
+            return;
+        }
+
+        const i = this.pIndex;
+        const j = Math.min(i + 1, keys.count - 1);
+        const t = keys.alpha(i, j, tMs);
+        const v = keys.v;
+        for (let c = 0; c < 3; c++) {
+            out[o + c] = v[i * 3 + c] + (v[j * 3 + c] - v[i * 3 + c]) * t;
+        }
+    }
+}
+
+export function preprocessRecordingToReplay(
+    recording: IMURecordingV1,
+    options?: { frameRate?: number; sourceFileName?: string }
+): ReplaySession {
+    const preprocessor = new ReplayPreprocessor(recording, options);
+    preprocessor.step(Infinity);
+    return preprocessor.session;
+}
+
+export interface IncrementalReplay {
+    session: ReplaySession;
+    // True once every frame is ready, false if cancelled first
+    done: Promise<boolean>;
+    cancel: () => void;
+}
+
+/**
+ * Preprocess in slices of PREPROCESS_SLICE_MS, yielding to the page in
+ * between. The session is returned after the first slice and can be
+ * played right away; playback waits at session.frames.ready if it
+ * catches up.
+ */
+export function preprocessRecordingIncrementally(
+    recording: IMURecordingV1,
+    options?: { frameRate?: number; sourceFileName?: string }
+): IncrementalReplay {
+    const preprocessor = new ReplayPreprocessor(recording, options);
+    let cancelled = false;
+
+    const done = new Promise<boolean>(resolve => {
+        const slice = () => {
+            if (cancelled) {
+                resolve(false);
+                return;
+            }
+            if (preprocessor.step(performance.now() + PREPROCESS_SLICE_MS)) {
+                resolve(true);
+                return;
+            }
+            setTimeout(slice, 0);
+        };
+        slice();
+    });
+
     return {
-        schemaVersion: 1,
-        sourceFileName: options?.sourceFileName,
-        deviceName: recording.deviceName ?? null,
-        durationMs,
-        frames,
+        session: preprocessor.session,
+        done,
+        cancel: () => {
+            cancelled = true;
+        },
     };
 }
-
@@ -0,0 +1,587 @@
+/**
+ * Recording store: samples in typed-array column chunks, exported lazily.
+ *
+ * Keeping a recording as RecordingEventV1 objects costs an event object,
+ * a message, an ISO timestamp and a vector object per sample, and the
+ * export cloned all of them at once. Here a sample is its receive time
+ * and its float32 values, appended to fixed-size chunks per stream:
+ * appending never copies what is already there, and nothing is formatted
+ * until export.
+ *
+ * Two exports, both produced a few thousand events at a time:
+ *   jsonParts()    the IMURecordingV1 JSON the app always downloaded,
+ *                  byte for byte
+ *   imurecParts()  the same recording as .imurec (layout:
+ *                  scripts/recording/imurec_format.hpp), which
+ *                  `imurec_tool decode` turns back into that JSON
+ *
+ * Log entries (connection messages, errors) are rare and kept as events.
+ */
+
+import type { IMURecordingV1, RecordingEventV1 } from './recording';
+import { FRAME_TYPE_QUATERNION, FRAME_TYPE_MAGNETOMETER, FRAME_TYPE_LINEAR_ACCEL } from './streamFrame';
+
+export const RECORDER_CHUNK_ROWS = 4096;
+
+// Events per .imurec chunk, IMUREC_DEFAULT_CHUNK_EVENTS
+const IMUREC_CHUNK_EVENTS = 8192;
+
+// Event kinds as in .imurec: stream in bits 0-2, type in bits 3-4
+const STREAM_LOG = 0;
+const STREAM_QUAT = 1;
+const STREAM_LINEAR_ACCEL = 2;
+const STREAM_MAG = 3;
+const STREAM_COUNT = 4;
+const KIND_RAW = 4; // Log entry carrying a vector, kept verbatim
+const KIND_MASK = 0x07;
+const TYPE_SHIFT = 3;
+const EVENT_TYPES: RecordingEventV1['type'][] = ['system', 'data', 'error'];
+
+const ENC_Q16 = 0;
+const ENC_F32 = 2;
+
+// Everything JSON.stringify(recording, null, 2) writes after the events
+const EMPTY_EVENTS_TAIL = '[]\n}';
+
+interface StreamDesc {
+    frameType: number;
+    key: 'quaternion' | 'linearAccel' | 'magnetometer';
+    names: string[];
+    q: number; // Fixed-point fraction bits of the BNO085 report
+}
+
+const STREAMS: (StreamDesc | null)[] = [
+    null,
+    { frameType: FRAME_TYPE_QUATERNION, key: 'quaternion', names: ['w', 'x', 'y', 'z'], q: 14 },
+    { frameType: FRAME_TYPE_LINEAR_ACCEL, key: 'linearAccel', names: ['x', 'y', 'z'], q: 8 },
+    { frameType: FRAME_TYPE_MAGNETOMETER, key: 'magnetometer', names: ['x', 'y', 'z'], q: 4 },
+];
+
+export type RecordingMeta = Omit<IMURecordingV1, 'events'>;
+
+export interface RecorderMemory {
+    events: number;
+    durationMs: number;
+    bytes: number; // Allocated, including the unused end of the last chunks
+    bytesPerHour: number; // At the rate recorded so far
+}
+
+/**
+ * Terminal and recording message for a sample of `type` whose values
+ * start at values[offset]; null for types that are not logged (battery)
+ */
+export function formatSampleMessage(type: number, values: ArrayLike<number>, offset: number): string | null {
+    const v = offset;
+    switch (type) {
+        case FRAME_TYPE_QUATERNION:
+            return `Q: w=${values[v].toFixed(4)} x=${values[v + 1].toFixed(4)} y=${values[v + 2].toFixed(4)} z=${values[v + 3].toFixed(4)}`;
+        case FRAME_TYPE_MAGNETOMETER:
+            return `M: x=${values[v].toFixed(2)} y=${values[v + 1].toFixed(2)} z=${values[v + 2].toFixed(2)} µT`;
+        case FRAME_TYPE_LINEAR_ACCEL:
+            return `A: x=${values[v].toFixed(2)} y=${values[v + 1].toFixed(2)} z=${values[v + 2].toFixed(2)} m/s²`;
+        default:
+            return null;
+    }
+}
+
+export function formatRecorderMemory(m: RecorderMemory): string {
+    const mb = (bytes: number) => (bytes / (1024 * 1024)).toFixed(1);
+    return `Recording: ${m.events} events in ${(m.durationMs / 60000).toFixed(1)} min, ` +
+        `${mb(m.bytes)} MB in memory (~${mb(m.bytesPerHour)} MB per hour at this rate).`;
+}
+
+function jsonNumber(n: number): string {
+    return Number.isFinite(n) ? String(n) : 'null';
+}
+
+function streamOf(frameType: number): number {
+    switch (frameType) {
+        case FRAME_TYPE_QUATERNION: return STREAM_QUAT;
+        case FRAME_TYPE_LINEAR_ACCEL: return STREAM_LINEAR_ACCEL;
+        case FRAME_TYPE_MAGNETOMETER: return STREAM_MAG;
+        default: return -1;
+    }
+}
+
+/**
+ * Rows of one sample stream: receive time (page clock) and `components`
+ * float32 values, RECORDER_CHUNK_ROWS rows per chunk
+ */
+class SampleColumns {
+    readonly received: Float64Array[] = [];
+    readonly values: Float32Array[] = [];
+    rows = 0;
+
+    constructor(readonly components: number) {}
+
+    append(receivedMs: number, src: ArrayLike<number>, offset: number): void {
+        const row = this.rows % RECORDER_CHUNK_ROWS;
+        if (row === 0) {
+            this.received.push(new Float64Array(RECORDER_CHUNK_ROWS));
+            this.values.push(new Float32Array(RECORDER_CHUNK_ROWS * this.components));
+        }
+        const chunk = this.received.length - 1;
+        const values = this.values[chunk];
+        const v = row * this.components;
+
+        this.received[chunk][row] = receivedMs;
+        for (let c = 0; c < this.components; c++) values[v + c] = src[offset + c];
+        this.rows++;
+    }
+
+    receivedAt(row: number): number {
+        return this.received[Math.floor(row / RECORDER_CHUNK_ROWS)][row % RECORDER_CHUNK_ROWS];
+    }
+
+    value(row: number, component: number): number {
+        const chunk = this.values[Math.floor(row / RECORDER_CHUNK_ROWS)];
+        return chunk[(row % RECORDER_CHUNK_ROWS) * this.components + component];
+    }
+
+    rowBytes(): number {
+        return 8 + 4 * this.components;
+    }
+}
+
+export class Recorder {
+    readonly meta: RecordingMeta;
+    readonly startPerf: number;
+    private readonly timeOrigin: number;
+    private readonly kinds: Uint8Array[] = [];
+    private readonly streams: (SampleColumns | null)[] = [
+        null, new SampleColumns(4), new SampleColumns(3), new SampleColumns(3),
+    ];
+    private readonly log: RecordingEventV1[] = [];
+    private logBytes = 0;
+    private lastMs = 0; // tMs of the newest event
+    private count = 0;
+
+    constructor(startPerf = performance.now(), timeOrigin = performance.timeOrigin) {
+        this.startPerf = startPerf;
+        this.timeOrigin = timeOrigin;
+        this.meta = {
+            schemaVersion: 1,
+            recordedAt: new Date().toISOString(),
+            deviceName: null,
+            connectedAt: null,
+            disconnectedAt: null,
+            calibration: null,
+        };
+    }
+
+    get eventCount(): number {
+        return this.count;
+    }
+
+    /**
+     * Record a sample of frame `type` received at `receivedMs` (page
+     * clock), values from values[offset]. Types without a stream
+     * (battery) are not recorded.
+     */
+    addSample(type: number, receivedMs: number, values: ArrayLike<number>, offset: number): void {
+        const stream = streamOf(type);
+        if (stream < 0) return;
+
+        this.streams[stream]!.append(receivedMs, values, offset);
+        this.pushKind(stream | (1 << TYPE_SHIFT));
+        this.lastMs = receivedMs - this.startPerf;
+    }
+
+    addEvent(event: RecordingEventV1): void {
+        const vector = event.quaternion || event.linearAccel || event.magnetometer;
+        const type = EVENT_TYPES.indexOf(event.type);
+
+        this.log.push(event);
+        // Two bytes per UTF-16 unit plus the object, roughly
+        this.logBytes += 2 * (event.message.length + event.timestamp.length) + 96;
+        this.pushKind((vector ? KIND_RAW : STREAM_LOG) | (type << TYPE_SHIFT));
+        this.lastMs = event.tMs;
+    }
+
+    memory(): RecorderMemory {
+        let bytes = this.kinds.length * RECORDER_CHUNK_ROWS + this.logBytes;
+        let used = this.count + this.logBytes;
+        for (const columns of this.streams) {
+            if (!columns) continue;
+            bytes += columns.received.length * RECORDER_CHUNK_ROWS * columns.rowBytes();
+            used += columns.rows * columns.rowBytes();
+        }
+        const durationMs = Math.max(this.lastMs, 0);
+        return {
+            events: this.count,
+            durationMs,
+            bytes,
+            bytesPerHour: durationMs > 0 ? used / durationMs * 3600000 : 0,
+        };
+    }
+
+    /**
+     * The recording as JSON.stringify({ ...meta, events }, null, 2), in
+     * parts of RECORDER_CHUNK_ROWS events. Events recorded after the
+     * first part was taken are not included.
+     */
+    *jsonParts(meta: RecordingMeta = this.meta): Generator<string> {
+        const count = this.count;
+        const head = JSON.stringify({ ...meta, events: [] }, null, 2);
+        if (count === 0) {
+            yield head;
+            return;
+        }
+
+        const rows = [0, 0, 0, 0];
+        let log = 0;
+        let part = head.slice(0, head.length - EMPTY_EVENTS_TAIL.length) + '[';
+        for (let e = 0; e < count; e++) {
+            const kind = this.kindAt(e) & KIND_MASK;
+            part += e > 0 ? ',\n    ' : '\n    ';
+            if (kind === STREAM_LOG || kind === KIND_RAW) {
+                part += JSON.stringify(this.log[log++], null, 2).replaceAll('\n', '\n    ');
+            } else {
+                part += this.sampleJson(kind, rows[kind]++);
+            }
+            if ((e + 1) % RECORDER_CHUNK_ROWS === 0) {
+                yield part;
+                part = '';
+            }
+        }
+        yield part + '\n  ]\n}';
+    }
+
+    /**
+     * The recording as .imurec, uncompressed, one part per chunk plus the
+     * header and the index. Events recorded after the first part was
+     * taken are not included.
+     */
+    *imurecParts(meta: RecordingMeta = this.meta): Generator<BlobPart> {
+        const count = this.count;
+        const metaJson = JSON.stringify(meta);
+        const metaBytes = new TextEncoder().encode(metaJson);
+        const out = new ByteWriter();
+        const body = new ByteWriter();
+        const col = new ByteWriter();
+        const index = new ByteWriter();
+        const rows = [0, 0, 0, 0];
+        let log = 0;
+        let offset = 0;
+        let chunks = 0;
+
+        out.ascii('IMUREC\r\n');
+        out.u16(1);
+        out.u16(Object.keys(JSON.parse(metaJson)).length); // "events" goes last
+        out.u32(metaBytes.length);
+        out.bytes(metaBytes);
+        offset += out.length;
+        yield out.take();
+
+        for (let e0 = 0; e0 < count; e0 += IMUREC_CHUNK_EVENTS) {
+            const e1 = Math.min(e0 + IMUREC_CHUNK_EVENTS, count);
+            const counts = [0, 0, 0, 0];
+            const logRows: RecordingEventV1[] = [];
+            const raw: RecordingEventV1[] = [];
+            const strings = new StringTable();
+            const span = { min: NaN, max: NaN };
+
+            for (let e = e0; e < e1; e++) {
+                const k = this.kindAt(e);
+                const kind = k & KIND_MASK;
+                body.u8(k);
+                if (kind === STREAM_LOG) logRows.push(this.log[log++]);
+                else if (kind === KIND_RAW) raw.push(this.log[log++]);
+                else counts[kind]++;
+            }
+
+            this.putLogStream(body, col, logRows, strings, span);
+            for (let s = 1; s < STREAM_COUNT; s++) {
+                this.putSampleStream(body, col, s, rows[s], counts[s], span);
+                rows[s] += counts[s];
+            }
+
+            body.u32(raw.length);
+            for (const event of raw) body.varint(strings.id(JSON.stringify(event)));
+            strings.put(body);
+
+            out.ascii('IRCK');
+            out.u8(0); // Codec none
+            out.u8(0);
+            out.u8(0);
+            out.u8(0);
+            out.u32(body.length);
+            out.u32(body.length);
+            out.u32(e1 - e0);
+
+            index.u64(offset);
+            index.u32(out.length + body.length);
+            index.u32(e1 - e0);
+            index.u64(e0);
+            index.f64(span.min);
+            index.f64(span.max);
+            chunks++;
+
+            offset += out.length + body.length;
+            yield out.take();
+            yield body.take();
+        }
+
+        index.u64(offset);
+        index.u32(chunks);
+        index.ascii('IRIX');
+        yield index.take();
+    }
+
+    private pushKind(kind: number): void {
+        const row = this.count % RECORDER_CHUNK_ROWS;
+        if (row === 0) this.kinds.push(new Uint8Array(RECORDER_CHUNK_ROWS));
+        this.kinds[this.kinds.length - 1][row] = kind;
+        this.count++;
+    }
+
+    private kindAt(event: number): number {
+        return this.kinds[Math.floor(event / RECORDER_CHUNK_ROWS)][event % RECORDER_CHUNK_ROWS];
+    }
+
+    // What ISO timestamp the app recorded for a sample received at receivedMs
+    private isoAt(receivedMs: number): string {
+        return new Date(this.timeOrigin + receivedMs).toISOString();
+    }
+
+    private sampleJson(stream: number, row: number): string {
+        const columns = this.streams[stream]!;
+        const desc = STREAMS[stream]!;
+        const receivedMs = columns.receivedAt(row);
+        const values = columns.values[Math.floor(row / RECORDER_CHUNK_ROWS)];
+        const v = (row % RECORDER_CHUNK_ROWS) * columns.components;
+
+        let members = '';
+        for (let c = 0; c < columns.components; c++) {
+            members += `${c > 0 ? ',' : ''}\n        "${desc.names[c]}": ${jsonNumber(values[v + c])}`;
+        }
+        // Sample messages need no escaping
+        return `{\n      "tMs": ${jsonNumber(receivedMs - this.startPerf)},` +
+            `\n      "timestamp": "${this.isoAt(receivedMs)}",` +
+            '\n      "type": "data",' +
+            `\n      "message": "${formatSampleMessage(desc.frameType, values, v)}",` +
+            `\n      "${desc.key}": {${members}\n      }\n    }`;
+    }
+
+    private putLogStream(body: ByteWriter, col: ByteWriter, events: RecordingEventV1[],
+        strings: StringTable, span: { min: number; max: number }): void {
+        body.u32(events.length);
+        if (events.length === 0) return;
+
+        const time = new TimeColumn();
+        for (const event of events) time.putMs(col, event.tMs, span);
+        body.column(col);
+
+        time.reset();
+        for (const event of events) {
+            const wall = Date.parse(event.timestamp);
+            if (Number.isFinite(wall) && new Date(wall).toISOString() === event.timestamp) {
+                time.putWall(col, wall);
+            } else {
+                col.varint(1);
+                col.varint(strings.id(event.timestamp));
+            }
+        }
+        body.column(col);
+
+        for (const event of events) col.varint(strings.id(event.message) + 1);
+        body.column(col);
+    }
+
+    private putSampleStream(body: ByteWriter, col: ByteWriter, stream: number, row0: number,
+        rows: number, span: { min: number; max: number }): void {
+        const columns = this.streams[stream]!;
+        const q = STREAMS[stream]!.q;
+
+        body.u32(rows);
+        if (rows === 0) return;
+
+        const time = new TimeColumn();
+        for (let r = row0; r < row0 + rows; r++) {
+            time.putMs(col, columns.receivedAt(r) - this.startPerf, span);
+        }
+        body.column(col);
+
+        time.reset();
+        for (let r = row0; r < row0 + rows; r++) {
+            time.putWall(col, Math.trunc(this.timeOrigin + columns.receivedAt(r)));
+        }
+        body.column(col);
+
+        // Every message is the derived one
+        for (let r = row0; r < row0 + rows; r++) col.u8(0);
+        body.column(col);
+
+        // Sensor values fit the report's fixed point; anything else is float32
+        const scale = 2 ** q;
+        const enc: number[] = [];
+        for (let c = 0; c < columns.components; c++) {
+            let q16 = true;
+            for (let r = row0; r < row0 + rows && q16; r++) {
+                const y = columns.value(r, c) * scale;
+                q16 = Number.isInteger(y) && y >= -32768 && y <= 32767;
+            }
+            enc.push(q16 ? ENC_Q16 : ENC_F32);
+            body.u8(enc[c]);
+        }
+        for (let c = 0; c < columns.components; c++) {
+            for (let r = row0; r < row0 + rows; r++) {
+                if (enc[c] === ENC_Q16) body.i16(columns.value(r, c) * scale);
+                else body.f32(columns.value(r, c));
+            }
+        }
+    }
+}
+
+/*
+ * .imurec encoding
+ */
+
+class ByteWriter {
+    private buf = new Uint8Array(1 << 16);
+    private view = new DataView(this.buf.buffer);
+    length = 0;
+
+    private reserve(n: number): void {
+        if (this.length + n <= this.buf.length) return;
+        let size = this.buf.length * 2;
+        while (size < this.length + n) size *= 2;
+        const grown = new Uint8Array(size);
+        grown.set(this.buf.subarray(0, this.length));
+        this.buf = grown;
+        this.view = new DataView(grown.buffer);
+    }
+
+    u8(v: number): void {
+        this.reserve(1);
+        this.buf[this.length++] = v;
+    }
+
+    u16(v: number): void {
+        this.reserve(2);
+        this.view.setUint16(this.length, v, true);
+        this.length += 2;
+    }
+
+    i16(v: number): void {
+        this.reserve(2);
+        this.view.setInt16(this.length, v, true);
+        this.length += 2;
+    }
+
+    u32(v: number): void {
+        this.reserve(4);
+        this.view.setUint32(this.length, v, true);
+        this.length += 4;
+    }
+
+    u64(v: number): void {
+        this.u32(v % 0x100000000);
+        this.u32(Math.floor(v / 0x100000000));
+    }
+
+    f32(v: number): void {
+        this.reserve(4);
+        this.view.setFloat32(this.length, v, true);
+        this.length += 4;
+    }
+
+    f64(v: number): void {
+        this.reserve(8);
+        this.view.setFloat64(this.length, v, true);
+        this.length += 8;
+    }
+
+    // Unsigned LEB128; exact up to 2^53
+    varint(v: number): void {
+        while (v >= 0x80) {
+            this.u8((v % 0x80) | 0x80);
+            v = Math.floor(v / 0x80);
+        }
+        this.u8(v);
+    }
+
+    ascii(s: string): void {
+        for (let i = 0; i < s.length; i++) this.u8(s.charCodeAt(i));
+    }
+
+    bytes(b: Uint8Array): void {
+        this.reserve(b.length);
+        this.buf.set(b, this.length);
+        this.length += b.length;
+    }
+
+    // `col` as a length-prefixed column; empties it
+    column(col: ByteWriter): void {
+        this.u32(col.length);
+        this.bytes(col.buf.subarray(0, col.length));
+        col.length = 0;
+    }
+
+    // Copy of the contents; empties the writer
+    take() {
+        const out = this.buf.slice(0, this.length);
+        this.length = 0;
+        return out;
+    }
+}
+
+function zigzag(v: number): number {
+    return v >= 0 ? v * 2 : -v * 2 - 1;
+}
+
+/*
+ * Time column tokens, zigzag(delta) * 2 + escape: tMs in microseconds
+ * when that is exact, else an escaped float64; wall clock in epoch ms
+ */
+class TimeColumn {
+    private prev = 0;
+
+    reset(): void {
+        this.prev = 0;
+    }
+
+    putMs(col: ByteWriter, t: number, span: { min: number; max: number }): void {
+        const q = Math.round(t * 1000);
+        if (Math.abs(t) < 1e12 && q / 1000 === t) {
+            col.varint(zigzag(q - this.prev) * 2);
+            this.prev = q;
+        } else {
+            col.varint(1);
+            col.f64(t);
+        }
+        if (!(t >= span.min)) span.min = t;
+        if (!(t <= span.max)) span.max = t;
+    }
+
+    putWall(col: ByteWriter, epochMs: number): void {
+        col.varint(zigzag(epochMs - this.prev) * 2);
+        this.prev = epochMs;
+    }
+}
+
+// Chunk-local string table
+class StringTable {
+    private readonly ids = new Map<string, number>();
+    private readonly list: string[] = [];
+
+    id(s: string): number {
+        let id = this.ids.get(s);
+        if (id === undefined) {
+            id = this.list.length;
+            this.ids.set(s, id);
+            this.list.push(s);
+        }
+        return id;
+    }
+
+    put(body: ByteWriter): void {
+        const encoder = new TextEncoder();
+        body.u32(this.list.length);
+        for (const s of this.list) {
+            const bytes = encoder.encode(s);
+            body.varint(bytes.length);
+            body.bytes(bytes);
+        }
+    }
+}
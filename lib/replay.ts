@@ -6,6 +6,7 @@ export interface Vector3Data {
     z: number;
 }
 
+/** A replay frame as stored in replay JSON files (scripts/recording/replay.hpp) */
 export interface ReplayFrameV1 {
     tMs: number;
     position: Vector3Data;
@@ -20,3 +21,42 @@ export interface ReplaySessionV1 {
     frames: ReplayFrameV1[];
 }
 
+/**
+ * Replay frames at a fixed rate, as structure of arrays: frame i is at
+ * i * frameIntervalMs, with its position at position[3i..3i+2] and its
+ * quaternion (w, x, y, z) at quaternion[4i..4i+3].
+ *
+ * Preprocessing (lib/preprocessRecording.ts) fills the frames in order
+ * while playback may already run: the first `ready` frames are final,
+ * the rest are not written yet.
+ */
+export class ReplayFrames {
+    readonly total: number;
+    readonly frameIntervalMs: number;
+    readonly position: Float32Array;
+    readonly quaternion: Float32Array;
+    ready = 0;
+
+    constructor(total: number, frameIntervalMs: number) {
+        this.total = total;
+        this.frameIntervalMs = frameIntervalMs;
+        this.position = new Float32Array(total * 3);
+        this.quaternion = new Float32Array(total * 4);
+    }
+
+    tMs(frame: number): number {
+        return frame * this.frameIntervalMs;
+    }
+
+    get complete(): boolean {
+        return this.ready === this.total;
+    }
+}
+
+/** ReplaySessionV1 in memory, as the app plays it: frames in ReplayFrames */
+export interface ReplaySession {
+    sourceFileName?: string;
+    deviceName?: string | null;
+    durationMs: number;
+    frames: ReplayFrames;
+}
@@ -0,0 +1,161 @@
+/**
+ * Client for the local WebSocket bridge (stream_merge --ws).
+ *
+ * The bridge decodes the device stream natively (UART, pty, capture or
+ * log replay) and sends samples in binary batches, one message per flush
+ * period (60 Hz by default), instead of one Web Bluetooth callback per
+ * notification. It also works in browsers without Web Bluetooth.
+ *
+ * Batch message, little-endian (scripts/firmware/host/stream_ws.hpp):
+ *   u8 version | u8 recordSize | u16 count | u32 seq | f64 baseUs
+ *   count x ( u16 device | u8 type | u8 flags | u32 dtUs | f32 v[4] )
+ *
+ * seq counts batches per connection; a gap means the bridge dropped
+ * batches because this page fell behind. The first message is a JSON
+ * text hello naming the bridge's inputs, one per device index.
+ */
+
+export const STREAM_BRIDGE_DEFAULT_URL = 'ws://127.0.0.1:8765';
+export const BRIDGE_FLAG_SENSOR_TIME = 0x01;
+// A bridge may merge several devices; the app follows the first one
+export const STREAM_BRIDGE_APP_DEVICE = 0;
+
+const BRIDGE_BATCH_VERSION = 1;
+const BRIDGE_HEADER_SIZE = 16;
+const BRIDGE_RECORD_SIZE = 24;
+
+export interface StreamBridgeHello {
+    version: number;
+    mode: 'sensor' | 'arrival';
+    flushHz: number;
+    devices: string[];
+}
+
+export interface StreamBridgeStats {
+    batches: number;
+    samples: number;
+    droppedBatches: number;
+    badBatches: number;
+}
+
+/**
+ * Called once per sample with a FRAME_TYPE_* type (lib/streamFrame.ts).
+ * `values` is decoder scratch memory, only valid for the duration of the
+ * call: w, x, y, z for 'Q'; x, y, z for 'M' and 'A'; percent, millivolts
+ * for 'B'. `tUs` is on the bridge's clock.
+ */
+export type StreamBridgeHandler = (type: number, device: number, tUs: number, values: Float32Array, flags: number) => void;
+
+export class StreamBridgeDecoder {
+    readonly stats: StreamBridgeStats = {
+        batches: 0,
+        samples: 0,
+        droppedBatches: 0,
+        badBatches: 0,
+    };
+
+    private readonly values = new Float32Array(4);
+    private nextSeq = -1;
+
+    reset(): void {
+        this.nextSeq = -1;
+    }
+
+    /**
+     * Decode one batch message.
+     * Returns the number of samples delivered.
+     */
+    push(buffer: ArrayBuffer, onSample: StreamBridgeHandler): number {
+        if (buffer.byteLength < BRIDGE_HEADER_SIZE) {
+            this.stats.badBatches++;
+            return 0;
+        }
+        const view = new DataView(buffer);
+        const count = view.getUint16(2, true);
+        if (view.getUint8(0) !== BRIDGE_BATCH_VERSION ||
+            view.getUint8(1) !== BRIDGE_RECORD_SIZE ||
+            buffer.byteLength !== BRIDGE_HEADER_SIZE + count * BRIDGE_RECORD_SIZE) {
+            this.stats.badBatches++;
+            return 0;
+        }
+
+        const seq = view.getUint32(4, true);
+        if (this.nextSeq >= 0 && seq !== this.nextSeq) {
+            this.stats.droppedBatches += (seq - this.nextSeq) >>> 0;
+        }
+        this.nextSeq = (seq + 1) >>> 0;
+        const baseUs = view.getFloat64(8, true);
+
+        const values = this.values;
+        for (let k = 0, r = BRIDGE_HEADER_SIZE; k < count; k++, r += BRIDGE_RECORD_SIZE) {
+            values[0] = view.getFloat32(r + 8, true);
+            values[1] = view.getFloat32(r + 12, true);
+            values[2] = view.getFloat32(r + 16, true);
+            values[3] = view.getFloat32(r + 20, true);
+            onSample(
+                view.getUint8(r + 2),
+                view.getUint16(r, true),
+                baseUs + view.getUint32(r + 4, true),
+                values,
+                view.getUint8(r + 3),
+            );
+        }
+
+        this.stats.batches++;
+        this.stats.samples += count;
+        return count;
+    }
+}
+
+export interface StreamBridgeOptions {
+    onOpen?: () => void;
+    onHello?: (hello: StreamBridgeHello) => void;
+    onSample: StreamBridgeHandler;
+    // After the batch was decoded; the buffer is the callee's from then on
+    onBatch?: (batch: ArrayBuffer) => void;
+    onClose?: (reason: string) => void;
+}
+
+export interface StreamBridgeConnection {
+    readonly decoder: StreamBridgeDecoder;
+    close(): void;
+}
+
+/**
+ * Connect to a bridge. Closing it (or the bridge going away) calls
+ * onClose once.
+ */
+export function openStreamBridge(url: string, options: StreamBridgeOptions): StreamBridgeConnection {
+    const decoder = new StreamBridgeDecoder();
+    const socket = new WebSocket(url);
+    let closed = false;
+
+    socket.binaryType = 'arraybuffer';
+    socket.onopen = () => options.onOpen?.();
+    socket.onmessage = (event: MessageEvent) => {
+        if (event.data instanceof ArrayBuffer) {
+            decoder.push(event.data, options.onSample);
+            options.onBatch?.(event.data);
+        } else if (typeof event.data === 'string' && options.onHello) {
+            try {
+                options.onHello(JSON.parse(event.data) as StreamBridgeHello);
+            } catch {
+                // Not a hello we understand; samples still decode
+            }
+        }
+    };
+    socket.onclose = (event: CloseEvent) => {
+        if (closed) return;
+        closed = true;
+        options.onClose?.(event.reason || (event.wasClean ? 'Bridge closed the connection' : `Cannot reach bridge at ${url}`));
+    };
+
+    return {
+        decoder,
+        close() {
+            if (closed) return;
+            closed = true;
+            socket.close();
+        },
+    };
+}
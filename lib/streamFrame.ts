@@ -0,0 +1,249 @@
+/**
+ * Streaming decoder for QuatStream COBS/CRC-16 frames.
+ *
+ * Wire format (scripts/firmware/quaternion_ble_stream/README.md):
+ *   COBS( type | seq | ts | payload | crc16_le ) 0x00
+ *
+ * ts is the sensor timestamp in microseconds as a LEB128 varint: absolute
+ * when bit 7 of type is set, otherwise a zigzag delta from the previous
+ * frame. After a sequence gap frames are delivered without a timestamp
+ * until the next absolute one.
+ *
+ * COBS guarantees 0x00 only appears as the delimiter, so a decoder that
+ * loses sync just drops bytes up to the next zero. Mirrors the reference
+ * C decoder in scripts/firmware/host/stream_frame.c.
+ */
+
+export const FRAME_TYPE_QUATERNION = 0x51; // 'Q'
+export const FRAME_TYPE_MAGNETOMETER = 0x4D; // 'M'
+export const FRAME_TYPE_LINEAR_ACCEL = 0x41; // 'A'
+export const FRAME_TYPE_BATTERY = 0x42; // 'B'
+const FRAME_TYPE_ABS_TS = 0x80;
+const FRAME_TYPE_MASK = 0x7F;
+
+const FRAME_HEADER_LEN = 2; // type, seq
+const FRAME_TS_MAX_LEN = 5; // 32-bit LEB128
+const FRAME_CRC_LEN = 2;
+const FRAME_MAX_PAYLOAD = 32;
+const FRAME_MAX_RAW = FRAME_HEADER_LEN + FRAME_TS_MAX_LEN + FRAME_MAX_PAYLOAD + FRAME_CRC_LEN;
+const FRAME_MAX_ENCODED = FRAME_MAX_RAW + 2;
+
+export interface StreamFrameStats {
+    frames: number;
+    crcErrors: number;
+    cobsErrors: number;
+    oversize: number;
+    runts: number;
+    seqGaps: number;
+    lost: number;
+    noTimestamp: number;
+}
+
+/**
+ * Called once per frame that passes the CRC. `payload` views decoder
+ * scratch memory and is only valid for the duration of the call.
+ * `timestampUs` is the sensor time (uint32, wraps), or null if unknown.
+ */
+export type StreamFrameHandler = (type: number, seq: number, payload: DataView, timestampUs: number | null) => void;
+
+/**
+ * Allocation-free variant of StreamFrameHandler for pushRaw(): the payload
+ * is frame[offset, offset + length) of a view that is reused for every
+ * frame. `timestampUs` is -1 if unknown.
+ */
+export type StreamFrameRawHandler = (type: number, seq: number, frame: DataView, offset: number, length: number, timestampUs: number) => void;
+
+/**
+ * CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+ */
+export function crc16(data: Uint8Array, len: number): number {
+    let crc = 0xFFFF;
+    for (let i = 0; i < len; i++) {
+        let x = ((crc >> 8) ^ data[i]) & 0xFF;
+        x ^= x >> 4;
+        crc = ((crc << 8) ^ (x << 12) ^ (x << 5) ^ x) & 0xFFFF;
+    }
+    return crc;
+}
+
+/**
+ * COBS-decode src[start, end) into out.
+ * Returns the decoded length, or -1 if the segment is not valid COBS.
+ */
+function cobsDecode(src: Uint8Array, start: number, end: number, out: Uint8Array): number {
+    let i = start;
+    let o = 0;
+    while (i < end) {
+        const code = src[i++];
+        if (code === 0 || i + code - 1 > end) return -1;
+        for (let j = 1; j < code; j++) out[o++] = src[i++];
+        // A code below 0xFF stands for a zero, except at the very end
+        if (code !== 0xFF && i < end) out[o++] = 0;
+    }
+    return o;
+}
+
+export class StreamFrameDecoder {
+    readonly stats: StreamFrameStats = {
+        frames: 0,
+        crcErrors: 0,
+        cobsErrors: 0,
+        oversize: 0,
+        runts: 0,
+        seqGaps: 0,
+        lost: 0,
+        noTimestamp: 0,
+    };
+
+    private readonly partial = new Uint8Array(FRAME_MAX_ENCODED);
+    private partialLen = 0;
+    private discarding = false;
+    private readonly raw = new Uint8Array(FRAME_MAX_ENCODED);
+    private readonly rawView = new DataView(this.raw.buffer);
+    private nextSeq = -1;
+    private lastTs = -1;
+    private onFrame: StreamFrameHandler | null = null;
+    private onRawFrame: StreamFrameRawHandler | null = null;
+
+    reset(): void {
+        this.partialLen = 0;
+        this.discarding = false;
+        this.nextSeq = -1;
+        this.lastTs = -1;
+    }
+
+    /**
+     * Feed received bytes; frames may span calls.
+     * Returns the number of frames delivered.
+     */
+    push(bytes: Uint8Array, onFrame: StreamFrameHandler): number {
+        this.onFrame = onFrame;
+        try {
+            return this.feed(bytes, bytes.length);
+        } finally {
+            this.onFrame = null;
+        }
+    }
+
+    /**
+     * Feed bytes[0, length) without allocating: for callers that reuse
+     * one input buffer for every notification.
+     * Returns the number of frames delivered.
+     */
+    pushRaw(bytes: Uint8Array, length: number, onFrame: StreamFrameRawHandler): number {
+        this.onRawFrame = onFrame;
+        try {
+            return this.feed(bytes, length);
+        } finally {
+            this.onRawFrame = null;
+        }
+    }
+
+    private feed(bytes: Uint8Array, length: number): number {
+        let delivered = 0;
+        let pos = 0;
+
+        while (pos < length) {
+            let zero = bytes.indexOf(0x00, pos);
+            if (zero >= length) zero = -1;
+            const end = zero < 0 ? length : zero;
+            const chunk = end - pos;
+
+            if (this.discarding) {
+                // Oversize segment: drop everything up to the next delimiter
+            } else if (this.partialLen + chunk > FRAME_MAX_ENCODED) {
+                this.stats.oversize++;
+                this.discarding = true;
+                this.partialLen = 0;
+            } else if (zero >= 0 && this.partialLen === 0) {
+                // Whole segment inside this notification: decode in place
+                delivered += this.segment(bytes, pos, end);
+            } else {
+                // At most one frame's worth; a loop avoids a subarray per call
+                for (let i = pos; i < end; i++) this.partial[this.partialLen++] = bytes[i];
+                if (zero >= 0) {
+                    delivered += this.segment(this.partial, 0, this.partialLen);
+                    this.partialLen = 0;
+                }
+            }
+
+            if (zero < 0) break;
+            this.discarding = false;
+            pos = zero + 1;
+        }
+
+        return delivered;
+    }
+
+    private segment(src: Uint8Array, start: number, end: number): number {
+        // Back-to-back delimiters: idle fill, not a frame
+        if (end === start) return 0;
+
+        const len = cobsDecode(src, start, end, this.raw);
+        if (len < 0) {
+            this.stats.cobsErrors++;
+            return 0;
+        }
+        if (len < FRAME_HEADER_LEN + 1 + FRAME_CRC_LEN) {
+            this.stats.runts++;
+            return 0;
+        }
+
+        const crc = crc16(this.raw, len - FRAME_CRC_LEN);
+        if (crc !== this.rawView.getUint16(len - FRAME_CRC_LEN, true)) {
+            this.stats.crcErrors++;
+            return 0;
+        }
+
+        // Timestamp varint
+        const tsEnd = Math.min(len - FRAME_CRC_LEN, FRAME_HEADER_LEN + FRAME_TS_MAX_LEN);
+        let tsField = 0;
+        let pos = FRAME_HEADER_LEN;
+        let shift = 0;
+        for (;;) {
+            if (pos >= tsEnd) {
+                this.stats.runts++;
+                return 0;
+            }
+            const b = this.raw[pos++];
+            tsField += (b & 0x7F) * 2 ** shift;
+            shift += 7;
+            if ((b & 0x80) === 0) break;
+        }
+        tsField >>>= 0;
+
+        const type = this.raw[0] & FRAME_TYPE_MASK;
+        const seq = this.raw[1];
+        if (this.nextSeq >= 0 && seq !== this.nextSeq) {
+            this.stats.seqGaps++;
+            this.stats.lost += (seq - this.nextSeq) & 0xFF;
+            // The delta is relative to a frame we never saw
+            this.lastTs = -1;
+        }
+        this.nextSeq = (seq + 1) & 0xFF;
+
+        if (this.raw[0] & FRAME_TYPE_ABS_TS) {
+            this.lastTs = tsField;
+        } else if (this.lastTs >= 0) {
+            // Undo zigzag, then wrap to uint32 like the device clock
+            const delta = (tsField >>> 1) ^ -(tsField & 1);
+            this.lastTs = (this.lastTs + delta) >>> 0;
+        }
+        if (this.lastTs < 0) {
+            this.stats.noTimestamp++;
+        }
+
+        this.stats.frames++;
+        if (this.onRawFrame) {
+            this.onRawFrame(type, seq, this.rawView, pos, len - pos - FRAME_CRC_LEN, this.lastTs);
+        } else if (this.onFrame) {
+            this.onFrame(
+                type,
+                seq,
+                new DataView(this.raw.buffer, pos, len - pos - FRAME_CRC_LEN),
+                this.lastTs >= 0 ? this.lastTs : null,
+            );
+        }
+        return 1;
+    }
+}
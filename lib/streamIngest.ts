@@ -0,0 +1,363 @@
+/**
+ * Allocation-free ingestion of QuatStream notifications.
+ *
+ * Each notification is copied into one preallocated input buffer and
+ * decoded in place (StreamFrameDecoder.pushRaw); every frame's values are
+ * written into a slot of a typed-array sample ring. Nothing is allocated
+ * per notification or per sample, so a 600 samples/s stream does not feed
+ * the garbage collector.
+ *
+ * The ring keeps the last `capacity` samples. Readers remember the head
+ * they last saw and read forward from it; a reader more than a ring
+ * behind has lost the oldest samples (see StreamSampleRing.oldest()).
+ * Samples from the WebSocket bridge (lib/streamBridge.ts) are written to
+ * the same ring with write(), samples the tracking worker decoded
+ * (lib/trackingWorker.ts) with writePacked(), and legacy '!' packets from
+ * the BLE UART service by LegacyPacketIngest.
+ */
+
+import {
+    StreamFrameDecoder,
+    FRAME_TYPE_QUATERNION,
+    FRAME_TYPE_MAGNETOMETER,
+    FRAME_TYPE_LINEAR_ACCEL,
+    FRAME_TYPE_BATTERY,
+} from './streamFrame';
+
+export const STREAM_INGEST_RING_CAPACITY = 1024; // Samples; a power of two
+
+// Packed samples (StreamSampleRing.pack): type, sensorUs, 4 values
+export const PACKED_SAMPLE_STRIDE = 6;
+
+/** Receives samples another thread decoded and packed, all received at receivedMs */
+export type PackedSamplesHandler = (packed: Float64Array, receivedMs: number) => void;
+
+// Larger than any ATT payload (MTU 247); longer values are fed in pieces
+const INGEST_INPUT_SIZE = 512;
+
+// Legacy '!' packets (BLE UART): '!', type, payload, ~sum of the bytes
+// before it, then '\n' except after 'B'
+const LEGACY_MARKER = 0x21; // '!'
+const LEGACY_NEWLINE = 0x0A;
+const LEGACY_MAX_PACKET = 20; // 'Q'
+
+export interface StreamIngestStats {
+    notifications: number;
+    bytes: number;
+    samples: number;
+    shortPayloads: number;
+    unknownTypes: number;
+}
+
+/**
+ * Structure-of-arrays sample store. Slot i holds sample number
+ * i + k * capacity; values are w, x, y, z for 'Q', x, y, z for 'M' and
+ * 'A', percent, millivolts for 'B'.
+ */
+export class StreamSampleRing {
+    readonly capacity: number;
+    readonly mask: number;
+    readonly type: Uint8Array;
+    readonly sensorUs: Float64Array; // NaN if unknown
+    readonly receivedMs: Float64Array; // performance.now() clock
+    readonly values: Float32Array; // 4 per slot
+
+    /** Samples ever written; the newest is head - 1 */
+    head = 0;
+
+    constructor(capacity: number = STREAM_INGEST_RING_CAPACITY) {
+        if (capacity <= 0 || (capacity & (capacity - 1)) !== 0) {
+            throw new Error('StreamSampleRing capacity must be a power of two');
+        }
+        this.capacity = capacity;
+        this.mask = capacity - 1;
+        this.type = new Uint8Array(capacity);
+        this.sensorUs = new Float64Array(capacity);
+        this.receivedMs = new Float64Array(capacity);
+        this.values = new Float32Array(capacity * 4);
+    }
+
+    /** Slot of sample number `index` */
+    slot(index: number): number {
+        return index & this.mask;
+    }
+
+    /** Oldest sample number still held */
+    oldest(): number {
+        return Math.max(0, this.head - this.capacity);
+    }
+
+    write(type: number, sensorUs: number, receivedMs: number, v0: number, v1: number, v2: number, v3: number): void {
+        const s = this.head & this.mask;
+        const v = s * 4;
+        this.type[s] = type;
+        this.sensorUs[s] = sensorUs;
+        this.receivedMs[s] = receivedMs;
+        this.values[v] = v0;
+        this.values[v + 1] = v1;
+        this.values[v + 2] = v2;
+        this.values[v + 3] = v3;
+        this.head++;
+    }
+
+    /**
+     * Samples [from, to) in one buffer, PACKED_SAMPLE_STRIDE numbers each,
+     * to transfer to another thread
+     */
+    pack(from: number, to: number): Float64Array {
+        const packed = new Float64Array((to - from) * PACKED_SAMPLE_STRIDE);
+        for (let i = from, p = 0; i < to; i++, p += PACKED_SAMPLE_STRIDE) {
+            const s = i & this.mask;
+            const v = s * 4;
+            packed[p] = this.type[s];
+            packed[p + 1] = this.sensorUs[s];
+            packed[p + 2] = this.values[v];
+            packed[p + 3] = this.values[v + 1];
+            packed[p + 4] = this.values[v + 2];
+            packed[p + 5] = this.values[v + 3];
+        }
+        return packed;
+    }
+
+    /** Write samples from pack(), received at receivedMs */
+    writePacked(packed: Float64Array, receivedMs: number): void {
+        for (let p = 0; p + PACKED_SAMPLE_STRIDE <= packed.length; p += PACKED_SAMPLE_STRIDE) {
+            this.write(packed[p], packed[p + 1], receivedMs,
+                packed[p + 2], packed[p + 3], packed[p + 4], packed[p + 5]);
+        }
+    }
+
+    reset(): void {
+        this.head = 0;
+    }
+}
+
+export class StreamIngest {
+    readonly ring: StreamSampleRing;
+    readonly decoder = new StreamFrameDecoder();
+    readonly stats: StreamIngestStats = {
+        notifications: 0,
+        bytes: 0,
+        samples: 0,
+        shortPayloads: 0,
+        unknownTypes: 0,
+    };
+
+    private readonly input = new Uint8Array(INGEST_INPUT_SIZE);
+    private receivedMs = 0;
+    // Bound once so pushRaw() gets the same function every time
+    private readonly onFrame = this.frame.bind(this);
+
+    constructor(capacity: number = STREAM_INGEST_RING_CAPACITY) {
+        this.ring = new StreamSampleRing(capacity);
+    }
+
+    /**
+     * Decode one notification value received at `receivedMs`.
+     * Returns the number of samples written to the ring.
+     */
+    push(value: DataView, receivedMs: number): number {
+        const first = this.ring.head;
+        const input = this.input;
+        const length = value.byteLength;
+
+        this.receivedMs = receivedMs;
+        for (let start = 0; start < length; start += INGEST_INPUT_SIZE) {
+            const n = Math.min(INGEST_INPUT_SIZE, length - start);
+            for (let i = 0; i < n; i++) input[i] = value.getUint8(start + i);
+            this.decoder.pushRaw(input, n, this.onFrame);
+        }
+
+        this.stats.notifications++;
+        this.stats.bytes += length;
+        return this.ring.head - first;
+    }
+
+    /** Drop any partial frame, e.g. on disconnect. The ring is kept. */
+    reset(): void {
+        this.decoder.reset();
+    }
+
+    private frame(type: number, _seq: number, frame: DataView, offset: number, length: number, timestampUs: number): void {
+        const ts = timestampUs >= 0 ? timestampUs : NaN;
+
+        switch (type) {
+            case FRAME_TYPE_QUATERNION:
+                if (length < 16) break;
+                this.ring.write(type, ts, this.receivedMs,
+                    frame.getFloat32(offset, true),
+                    frame.getFloat32(offset + 4, true),
+                    frame.getFloat32(offset + 8, true),
+                    frame.getFloat32(offset + 12, true));
+                this.stats.samples++;
+                return;
+
+            case FRAME_TYPE_MAGNETOMETER:
+            case FRAME_TYPE_LINEAR_ACCEL:
+                if (length < 12) break;
+                this.ring.write(type, ts, this.receivedMs,
+                    frame.getFloat32(offset, true),
+                    frame.getFloat32(offset + 4, true),
+                    frame.getFloat32(offset + 8, true),
+                    0);
+                this.stats.samples++;
+                return;
+
+            case FRAME_TYPE_BATTERY:
+                if (length < 3) break;
+                this.ring.write(type, ts, this.receivedMs,
+                    frame.getUint8(offset),
+                    frame.getUint16(offset + 1, true),
+                    0,
+                    0);
+                this.stats.samples++;
+                return;
+
+            default:
+                // Unknown frame type: CRC was valid, so skip it cleanly
+                this.stats.unknownTypes++;
+                return;
+        }
+        this.stats.shortPayloads++;
+    }
+}
+
+export interface LegacyIngestStats {
+    notifications: number;
+    bytes: number;
+    samples: number;
+    badPackets: number; // Marker and type found, checksum or '\n' wrong
+}
+
+/** Length of a legacy packet of `type`, 0 if it is not one */
+function legacyPacketLength(type: number): number {
+    switch (type) {
+        case FRAME_TYPE_QUATERNION: return 20;
+        case FRAME_TYPE_MAGNETOMETER:
+        case FRAME_TYPE_LINEAR_ACCEL: return 16;
+        case FRAME_TYPE_BATTERY: return 6;
+        default: return 0;
+    }
+}
+
+/**
+ * Ingestion of legacy '!' packets, what the sketch sends over BLE UART
+ * (and all a sketch without the stream service sends):
+ *   'Q' w, x, y, z floats (20 bytes); 'M', 'A' x, y, z floats (16 bytes),
+ *   each followed by the checksum and '\n';
+ *   'B' percent u8, millivolts u16, checksum (6 bytes).
+ *
+ * Packets carry no sequence number or sensor time; samples are written to
+ * `ring` untimed (sensorUs NaN). A packet split across notifications is
+ * kept until the rest arrives. Like StreamIngest, nothing is allocated per
+ * notification or per sample.
+ */
+export class LegacyPacketIngest {
+    readonly ring: StreamSampleRing;
+    readonly stats: LegacyIngestStats = {
+        notifications: 0,
+        bytes: 0,
+        samples: 0,
+        badPackets: 0,
+    };
+
+    // Unparsed bytes: the tail of the last notification, then new input
+    private readonly input = new Uint8Array(INGEST_INPUT_SIZE + LEGACY_MAX_PACKET);
+    private readonly view = new DataView(this.input.buffer);
+    private length = 0;
+
+    constructor(ring: StreamSampleRing) {
+        this.ring = ring;
+    }
+
+    /**
+     * Parse one notification value received at `receivedMs`.
+     * Returns the number of samples written to the ring.
+     */
+    push(value: DataView, receivedMs: number): number {
+        const first = this.ring.head;
+        const input = this.input;
+        const length = value.byteLength;
+
+        for (let start = 0; start < length; ) {
+            const n = Math.min(input.length - this.length, length - start);
+            for (let i = 0; i < n; i++) input[this.length + i] = value.getUint8(start + i);
+            this.length += n;
+            start += n;
+            this.parse(receivedMs);
+        }
+
+        this.stats.notifications++;
+        this.stats.bytes += length;
+        return this.ring.head - first;
+    }
+
+    /** Drop any partial packet, e.g. on disconnect. The ring is kept. */
+    reset(): void {
+        this.length = 0;
+    }
+
+    private parse(receivedMs: number): void {
+        const input = this.input;
+        const view = this.view;
+        const end = this.length;
+        let offset = 0;
+
+        while (offset + 1 < end) {
+            if (input[offset] !== LEGACY_MARKER) {
+                offset++;
+                continue;
+            }
+            const type = input[offset + 1];
+            const packetLength = legacyPacketLength(type);
+            if (packetLength === 0) {
+                offset++;
+                continue;
+            }
+            // Wait for the rest of the packet
+            if (offset + packetLength > end) break;
+
+            const newline = type !== FRAME_TYPE_BATTERY;
+            const checksumAt = offset + packetLength - (newline ? 2 : 1);
+            let sum = 0;
+            for (let i = offset; i < checksumAt; i++) sum += input[i];
+            if (input[checksumAt] !== (~sum & 0xFF) ||
+                (newline && input[checksumAt + 1] !== LEGACY_NEWLINE)) {
+                this.stats.badPackets++;
+                offset++;
+                continue;
+            }
+
+            const p = offset + 2;
+            switch (type) {
+                case FRAME_TYPE_QUATERNION:
+                    this.ring.write(type, NaN, receivedMs,
+                        view.getFloat32(p, true),
+                        view.getFloat32(p + 4, true),
+                        view.getFloat32(p + 8, true),
+                        view.getFloat32(p + 12, true));
+                    break;
+                case FRAME_TYPE_BATTERY:
+                    this.ring.write(type, NaN, receivedMs,
+                        input[p],
+                        view.getUint16(p + 1, true),
+                        0,
+                        0);
+                    break;
+                default:
+                    this.ring.write(type, NaN, receivedMs,
+                        view.getFloat32(p, true),
+                        view.getFloat32(p + 4, true),
+                        view.getFloat32(p + 8, true),
+                        0);
+                    break;
+            }
+            this.stats.samples++;
+            offset += packetLength;
+        }
+
+        // Keep what may be the start of a packet
+        input.copyWithin(0, offset, end);
+        this.length = end - offset;
+    }
+}
@@ -0,0 +1,164 @@
+/**
+ * Terminal scrollback, kept outside React state.
+ *
+ * Lines go into a fixed-size circular store; the oldest is dropped once
+ * TERMINAL_LOG_CAPACITY are held. Writers append and then commit() once
+ * per animation frame; only a commit that changed something notifies the
+ * subscribers (components/terminal/TerminalLogView.tsx), which render the
+ * rows in view and nothing else.
+ *
+ * Samples are counted per second with sample(). While a stream runs
+ * faster than TERMINAL_RATE_THRESHOLD samples/s, single samples are not
+ * worth formatting or reading: they get no line of their own, and each
+ * second ends with one rate line instead ("600 packets/s: A 200, M 200,
+ * Q 200").
+ */
+
+export const TERMINAL_LOG_CAPACITY = 1000;
+export const TERMINAL_RATE_THRESHOLD = 50; // Samples/s with a line each
+
+// The packet count alone refreshes the view at most this often
+const TERMINAL_COUNT_INTERVAL_MS = 250;
+const RATE_WINDOW_MS = 1000;
+
+export type TerminalLineType = 'system' | 'data' | 'error';
+
+const LINE_TYPES: TerminalLineType[] = ['system', 'data', 'error'];
+
+export class TerminalLog {
+    readonly capacity: number;
+    private readonly types: Uint8Array;
+    private readonly messages: string[];
+
+    /** Lines ever written; the newest is head - 1 */
+    head = 0;
+    /** Data packets received, as shown in the footer */
+    packets = 0;
+
+    private version = 0;
+    private dirty = false;
+    private publishedPackets = 0;
+    private publishedAtMs = -Infinity;
+    private countTimer: ReturnType<typeof setTimeout> | null = null;
+    private readonly listeners = new Set<() => void>();
+
+    // Current rate window: samples per frame type, and how many got a line
+    private windowStartMs = NaN;
+    private windowSamples = 0;
+    private windowShown = 0;
+    private previousWindowSamples = 0;
+    private readonly windowByType = new Uint32Array(128);
+
+    constructor(capacity: number = TERMINAL_LOG_CAPACITY) {
+        this.capacity = capacity;
+        this.types = new Uint8Array(capacity);
+        this.messages = new Array<string>(capacity).fill('');
+    }
+
+    /** Oldest line number still held */
+    first(): number {
+        return Math.max(0, this.head - this.capacity);
+    }
+
+    lineType(index: number): TerminalLineType {
+        return LINE_TYPES[this.types[index % this.capacity]];
+    }
+
+    message(index: number): string {
+        return this.messages[index % this.capacity];
+    }
+
+    push(type: TerminalLineType, message: string): void {
+        const slot = this.head % this.capacity;
+        this.types[slot] = LINE_TYPES.indexOf(type);
+        this.messages[slot] = message;
+        this.head++;
+        this.dirty = true;
+    }
+
+    /**
+     * Count a sample of frame `type` received at `receivedMs`; true if it
+     * should get a line of its own
+     */
+    sample(type: number, receivedMs: number): boolean {
+        if (!(receivedMs < this.windowStartMs + RATE_WINDOW_MS)) {
+            this.closeWindow();
+            this.windowStartMs = receivedMs;
+        }
+        this.windowSamples++;
+        this.windowByType[type & 0x7F]++;
+
+        if (this.windowSamples > TERMINAL_RATE_THRESHOLD ||
+            this.previousWindowSamples > TERMINAL_RATE_THRESHOLD) return false;
+        this.windowShown++;
+        return true;
+    }
+
+    /**
+     * Publish what was pushed since the last commit. `nowMs` is the sample
+     * clock (performance.now()); it also ends a rate window that no new
+     * sample has closed.
+     */
+    commit(nowMs: number): void {
+        if (this.windowSamples > 0 && nowMs >= this.windowStartMs + RATE_WINDOW_MS) {
+            this.closeWindow();
+            this.windowStartMs = NaN;
+        }
+
+        if (this.packets !== this.publishedPackets) {
+            if (nowMs - this.publishedAtMs >= TERMINAL_COUNT_INTERVAL_MS || this.dirty) {
+                this.publishedPackets = this.packets;
+                this.publishedAtMs = nowMs;
+                this.dirty = true;
+            } else if (this.countTimer === null) {
+                // Don't leave a stale count when the stream stops
+                this.countTimer = setTimeout(() => {
+                    this.countTimer = null;
+                    this.commit(performance.now());
+                }, TERMINAL_COUNT_INTERVAL_MS);
+            }
+        }
+
+        if (!this.dirty) return;
+        this.dirty = false;
+        this.version++;
+        for (const listener of this.listeners) listener();
+    }
+
+    clear(): void {
+        this.head = 0;
+        this.packets = 0;
+        this.windowStartMs = NaN;
+        this.windowSamples = 0;
+        this.windowShown = 0;
+        this.previousWindowSamples = 0;
+        this.windowByType.fill(0);
+        this.dirty = true;
+    }
+
+    // For useSyncExternalStore; arrow properties so they can be passed as is
+    subscribe = (listener: () => void): (() => void) => {
+        this.listeners.add(listener);
+        return () => {
+            this.listeners.delete(listener);
+        };
+    };
+
+    getVersion = (): number => this.version;
+
+    private closeWindow(): void {
+        if (this.windowSamples > this.windowShown) {
+            let perType = '';
+            for (let t = 0; t < this.windowByType.length; t++) {
+                const n = this.windowByType[t];
+                if (n === 0) continue;
+                perType += `${perType ? ', ' : ''}${String.fromCharCode(t)} ${n}`;
+            }
+            this.push('data', `${this.windowSamples} packets/s: ${perType}`);
+        }
+        this.previousWindowSamples = this.windowSamples;
+        this.windowSamples = 0;
+        this.windowShown = 0;
+        this.windowByType.fill(0);
+    }
+}
@@ -0,0 +1,179 @@
+/**
+ * Tracking pipeline worker: decode, calibrate and run the EKF off the
+ * main thread, so React renders and garbage collection there can't delay
+ * a sample, and the EKF can't take time from the render loop.
+ *
+ * Started by hooks/useTrackingWorker.ts. Notification bytes are
+ * transferred in; the worker publishes the latest pose after every
+ * notification or bridge batch into a PoseSlot (lib/poseSlot.ts) that the
+ * scene reads once per frame. Once the page has a handler for them it
+ * stops decoding notifications itself and asks for the decoded samples
+ * back (`reply`), packed into one transferred buffer per notification,
+ * for the terminal, recording and calibration. Legacy '!' packets from the
+ * BLE UART service are parsed by the page and come in already decoded
+ * (`samples`).
+ *
+ * Samples are applied the way app/page.tsx did on the main thread:
+ * quaternions always, acceleration and magnetometer only while position
+ * tracking is on (unlocked, not calibrating, not replaying).
+ */
+
+import { FRAME_TYPE_QUATERNION, FRAME_TYPE_MAGNETOMETER, FRAME_TYPE_LINEAR_ACCEL } from './streamFrame';
+import { PACKED_SAMPLE_STRIDE, StreamIngest } from './streamIngest';
+import { StreamBridgeDecoder, STREAM_BRIDGE_APP_DEVICE } from './streamBridge';
+import { EKFTracker } from './EKFTracker';
+import { applyCalibrationMatrix, calibrationMatrix, type CalibrationData } from './CalibrationManager';
+import { createPoseSample, PoseSlotWriter, POSE_FLAG_POSITION, POSE_FLAG_QUATERNION } from './poseSlot';
+
+export interface TrackingWorkerConfig {
+    calibration: CalibrationData | null;
+    positionLocked: boolean;
+    calibrating: boolean;
+    replaying: boolean;
+}
+
+export type TrackingWorkerRequest =
+    | { kind: 'init'; pose: SharedArrayBuffer }
+    | { kind: 'notification'; bytes: ArrayBuffer; receivedMs: number; reply: boolean }
+    | { kind: 'bridge'; batch: ArrayBuffer; receivedMs: number }
+    | { kind: 'samples'; packed: Float64Array; receivedMs: number }
+    | { kind: 'config'; config: TrackingWorkerConfig }
+    | { kind: 'reset' };
+
+export type TrackingWorkerReply =
+    | { kind: 'ready' }
+    | { kind: 'samples'; packed: Float64Array; receivedMs: number };
+
+const ingest = new StreamIngest();
+const bridge = new StreamBridgeDecoder();
+const ekf = new EKFTracker();
+const pose = createPoseSample();
+const magnetometer = { x: 0, y: 0, z: 0 };
+
+let writer: PoseSlotWriter | null = null;
+let calibration: Float64Array | null = null;
+let replaying = false;
+let tracking = false;
+let receivedMs = 0;
+
+function applySample(type: number, v0: number, v1: number, v2: number, v3: number): void {
+    if (replaying) return;
+
+    switch (type) {
+        case FRAME_TYPE_QUATERNION:
+            pose.quaternion.w = v0;
+            pose.quaternion.x = v1;
+            pose.quaternion.y = v2;
+            pose.quaternion.z = v3;
+            pose.flags |= POSE_FLAG_QUATERNION;
+            break;
+
+        case FRAME_TYPE_LINEAR_ACCEL: {
+            if (!tracking) return;
+            const accel = pose.linearAccel;
+            accel.x = v0;
+            accel.y = v1;
+            accel.z = v2;
+            if (calibration) applyCalibrationMatrix(calibration, accel, accel);
+            // Needs an orientation to rotate into the world frame
+            if (pose.flags & POSE_FLAG_QUATERNION) {
+                const position = ekf.predict(accel, pose.quaternion);
+                pose.position.x = position.x;
+                pose.position.y = position.y;
+                pose.position.z = position.z;
+                pose.flags |= POSE_FLAG_POSITION;
+            }
+            break;
+        }
+
+        case FRAME_TYPE_MAGNETOMETER:
+            if (!tracking) return;
+            magnetometer.x = v0;
+            magnetometer.y = v1;
+            magnetometer.z = v2;
+            ekf.updateMagnetometer(magnetometer);
+            break;
+
+        default:
+            return;
+    }
+
+    pose.samples++;
+    pose.receivedMs = receivedMs;
+}
+
+function applyBridgeSample(type: number, device: number, _tUs: number, v: Float32Array): void {
+    if (device === STREAM_BRIDGE_APP_DEVICE) applySample(type, v[0], v[1], v[2], v[3]);
+}
+
+function reset(): void {
+    ingest.reset();
+    bridge.reset();
+    ekf.reset();
+    pose.position.x = 0;
+    pose.position.y = 0;
+    pose.position.z = 0;
+    pose.samples = 0;
+    // Back at the origin; the hand keeps its last orientation
+    pose.flags |= POSE_FLAG_POSITION;
+    writer?.publish(pose);
+}
+
+self.onmessage = (event: MessageEvent<TrackingWorkerRequest>) => {
+    const message = event.data;
+
+    switch (message.kind) {
+        case 'init': {
+            writer = new PoseSlotWriter(message.pose);
+            const reply: TrackingWorkerReply = { kind: 'ready' };
+            self.postMessage(reply);
+            return;
+        }
+
+        case 'notification': {
+            const ring = ingest.ring;
+            const first = ring.head;
+            receivedMs = message.receivedMs;
+            ingest.push(new DataView(message.bytes), receivedMs);
+            for (let i = first; i < ring.head; i++) {
+                const v = ring.slot(i) * 4;
+                applySample(ring.type[ring.slot(i)], ring.values[v], ring.values[v + 1], ring.values[v + 2], ring.values[v + 3]);
+            }
+            writer?.publish(pose);
+            if (message.reply && ring.head > first) {
+                const packed = ring.pack(first, ring.head);
+                const reply: TrackingWorkerReply = { kind: 'samples', packed, receivedMs };
+                self.postMessage(reply, { transfer: [packed.buffer] });
+            }
+            return;
+        }
+
+        case 'samples': {
+            const packed = message.packed;
+            receivedMs = message.receivedMs;
+            for (let p = 0; p + PACKED_SAMPLE_STRIDE <= packed.length; p += PACKED_SAMPLE_STRIDE) {
+                applySample(packed[p], packed[p + 2], packed[p + 3], packed[p + 4], packed[p + 5]);
+            }
+            writer?.publish(pose);
+            return;
+        }
+
+        case 'bridge':
+            receivedMs = message.receivedMs;
+            bridge.push(message.batch, applyBridgeSample);
+            writer?.publish(pose);
+            return;
+
+        case 'config': {
+            const config = message.config;
+            calibration = config.calibration ? calibrationMatrix(config.calibration) : null;
+            replaying = config.replaying;
+            tracking = !config.positionLocked && !config.calibrating && !config.replaying;
+            return;
+        }
+
+        case 'reset':
+            reset();
+            return;
+    }
+};
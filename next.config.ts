@@ -1,7 +1,26 @@
 import type { NextConfig } from "next";
 
 const nextConfig: NextConfig = {
-  /* config options here */
+  // page.dev.tsx files (profiling harnesses) are routes under `next dev`
+  // only; production builds skip them and everything they import.
+  pageExtensions:
+    process.env.NODE_ENV === "development"
+      ? ["dev.tsx", "tsx", "ts", "jsx", "js"]
+      : ["tsx", "ts", "jsx", "js"],
+  // Cross-origin isolation, so the tracking worker can share its pose with
+  // the page through a SharedArrayBuffer (hooks/useTrackingWorker.ts).
+  // credentialless still lets the scene load its environment map from a CDN.
+  async headers() {
+    return [
+      {
+        source: "/:path*",
+        headers: [
+          { key: "Cross-Origin-Opener-Policy", value: "same-origin" },
+          { key: "Cross-Origin-Embedder-Policy", value: "credentialless" },
+        ],
+      },
+    ];
+  },
 };
 
 export default nextConfig;
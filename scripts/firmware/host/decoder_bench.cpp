@@ -0,0 +1,542 @@
+/**
+ * @file decoder_bench.cpp
+ * @brief Throughput of stream_decoder.hpp against the reference decoder
+ *
+ * Decodes a capture with the reference decoder (stream_frame.c), then
+ * with sf::decoder using the portable and the SIMD delimiter scanner, and
+ * prints GB/s for each. Before timing it checks that sf::decoder agrees
+ * with the reference on every counter and on the decoded samples, both
+ * for the whole capture in one feed and for notification-sized chunks.
+ *
+ * sf::legacy_decoder gets the same treatment on a generated capture of
+ * legacy '!' packets of the same size, against a byte-at-a-time parser
+ * written the way the web client's is.
+ *
+ * Usage: decoder_bench [megabytes] [seed]
+ *        decoder_bench capture.bin
+ *
+ * Without a file a capture is generated the way frame_bench does it
+ * (Q/M/A at 1:1:1, jittered timestamps) with an occasional dropped or
+ * damaged frame so the error paths are part of the comparison. The
+ * legacy capture adds a battery packet now and then, and cuts a packet
+ * short instead of dropping it (what a lost BLE UART write leaves).
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "stream_decoder.hpp"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+#define BENCH_DEFAULT_MB        64UL
+#define BENCH_DEFAULT_SEED      0x2545F491UL
+#define BENCH_PASSES            8
+
+#define DROP_EVERY              997
+#define CORRUPT_EVERY           1009
+
+#define NOTIFY_MAX              244     /* ATT payload at MTU 247 */
+
+#define LEGACY_BATTERY_EVERY    50
+
+/**
+ * @brief Order-independent summary of decoded samples
+ */
+struct sample_sums {
+    uint64_t frames;
+    uint64_t timed;
+    uint64_t timestamps;
+    double   values;
+};
+
+/*******************************************************************************
+ * Private Variables
+ ******************************************************************************/
+
+static uint32_t s_rng = BENCH_DEFAULT_SEED;
+static sample_sums s_ref;
+static sample_sums s_legacy_ref;
+static uint64_t s_legacy_bad;
+static sf::columns s_legacy_cols;
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+static uint32_t bench_rand(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+static uint64_t bench_time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void bench_generate(std::vector<uint8_t> &buf, size_t size)
+{
+    static const uint8_t types[] = {
+        SF_TYPE_QUATERNION, SF_TYPE_MAGNETOMETER, SF_TYPE_LINEAR_ACCEL
+    };
+    sf_encoder_t enc;
+    uint8_t out[SF_MAX_ENCODED];
+    float values[4];
+    uint32_t timestamp_us = bench_rand();
+
+    sf_encoder_init(&enc);
+    buf.clear();
+    buf.reserve(size);
+
+    for (uint32_t n = 1; buf.size() + SF_MAX_ENCODED <= size; n++) {
+        uint8_t type = types[n % 3];
+        uint8_t count = (type == SF_TYPE_QUATERNION) ? 4 : 3;
+
+        for (uint8_t i = 0; i < count; i++) {
+            values[i] = (float)((int32_t)bench_rand()) / 2147483648.0f;
+        }
+        timestamp_us += 1667 + (bench_rand() % 401) - 200;
+
+        size_t len = sf_encode(&enc, type, timestamp_us, values,
+                               (uint8_t)(count * sizeof(float)), out);
+        if (n % DROP_EVERY == 0) {
+            continue;
+        }
+        if (n % CORRUPT_EVERY == 0) {
+            uint8_t flipped = out[1] ^ (uint8_t)(1u << (bench_rand() & 7));
+            out[1] = flipped ? flipped : 0x80;
+        }
+        buf.insert(buf.end(), out, out + len);
+    }
+}
+
+static void bench_ref_cb(const sf_frame_t *frame, void *ctx)
+{
+    float v;
+
+    (void)ctx;
+    s_ref.frames++;
+    if (frame->has_timestamp) {
+        s_ref.timed++;
+        s_ref.timestamps += frame->timestamp_us;
+    }
+    for (uint8_t i = 0; i + sizeof(float) <= frame->len; i += sizeof(float)) {
+        memcpy(&v, &frame->payload[i], sizeof(v));
+        s_ref.values += v;
+    }
+}
+
+static void bench_sum_common(const sf::sample_columns &c, sample_sums &s)
+{
+    s.frames += c.size();
+    for (size_t i = 0; i < c.size(); i++) {
+        s.timed += c.timed[i];
+        s.timestamps += c.timestamp_us[i];
+    }
+}
+
+static void bench_sum_floats(const std::vector<float> &v, sample_sums &s)
+{
+    for (float f : v) {
+        s.values += f;
+    }
+}
+
+/* Sums in the reference callback's order would differ in the last bits,
+ * so compare float totals with a tolerance */
+static sample_sums bench_sum(const sf::columns &cols)
+{
+    sample_sums s = {};
+
+    bench_sum_common(cols.quat, s);
+    bench_sum_common(cols.mag, s);
+    bench_sum_common(cols.linear_accel, s);
+    bench_sum_floats(cols.quat.w, s);
+    bench_sum_floats(cols.quat.x, s);
+    bench_sum_floats(cols.quat.y, s);
+    bench_sum_floats(cols.quat.z, s);
+    bench_sum_floats(cols.mag.x, s);
+    bench_sum_floats(cols.mag.y, s);
+    bench_sum_floats(cols.mag.z, s);
+    bench_sum_floats(cols.linear_accel.x, s);
+    bench_sum_floats(cols.linear_accel.y, s);
+    bench_sum_floats(cols.linear_accel.z, s);
+    return s;
+}
+
+static bool bench_same(const char *what, const sf_decoder_stats_t &a,
+                       const sf_decoder_stats_t &b, const sample_sums &sa,
+                       const sample_sums &sb)
+{
+    double tol = 1e-9 * (double)(sa.frames + 1) * 4.0;
+
+    if (memcmp(&a, &b, sizeof(a)) == 0 && sa.frames == sb.frames &&
+        sa.timed == sb.timed && sa.timestamps == sb.timestamps &&
+        sa.values - sb.values < tol && sb.values - sa.values < tol) {
+        return true;
+    }
+    fprintf(stderr, "%s: mismatch with reference decoder\n", what);
+    fprintf(stderr, "  frames %lu/%lu crc %lu/%lu cobs %lu/%lu runt %lu/%lu "
+            "oversize %lu/%lu lost %lu/%lu untimed %lu/%lu\n",
+            (unsigned long)a.frames, (unsigned long)b.frames,
+            (unsigned long)a.crc_errors, (unsigned long)b.crc_errors,
+            (unsigned long)a.cobs_errors, (unsigned long)b.cobs_errors,
+            (unsigned long)a.runts, (unsigned long)b.runts,
+            (unsigned long)a.oversize, (unsigned long)b.oversize,
+            (unsigned long)a.lost, (unsigned long)b.lost,
+            (unsigned long)a.no_timestamp, (unsigned long)b.no_timestamp);
+    return false;
+}
+
+static void bench_report(const char *name, size_t len, uint64_t elapsed_ns)
+{
+    double bytes = (double)len * BENCH_PASSES;
+
+    printf("%-14s %6.2f GB/s  %6.3f ns/byte\n", name,
+           bytes / ((double)elapsed_ns / 1e9) / 1e9, (double)elapsed_ns / bytes);
+}
+
+/* Legacy packets the way the sketch's buildLegacyPacket() writes them */
+static void bench_generate_legacy(std::vector<uint8_t> &buf, size_t size)
+{
+    static const uint8_t types[] = {
+        SF_TYPE_QUATERNION, SF_TYPE_MAGNETOMETER, SF_TYPE_LINEAR_ACCEL
+    };
+    uint8_t out[SF_LEGACY_MAX_PACKET];
+
+    buf.clear();
+    buf.reserve(size);
+
+    for (uint32_t n = 1; buf.size() + SF_LEGACY_MAX_PACKET <= size; n++) {
+        uint8_t type = (n % LEGACY_BATTERY_EVERY == 0) ? SF_TYPE_BATTERY : types[n % 3];
+        size_t len = 2;
+        uint8_t sum = 0;
+
+        out[0] = SF_LEGACY_MARKER;
+        out[1] = type;
+        if (type == SF_TYPE_BATTERY) {
+            uint16_t mv = (uint16_t)(3300 + bench_rand() % 900);
+            out[len++] = (uint8_t)(bench_rand() % 101);
+            out[len++] = (uint8_t)mv;
+            out[len++] = (uint8_t)(mv >> 8);
+        } else {
+            uint8_t count = (type == SF_TYPE_QUATERNION) ? 4 : 3;
+            for (uint8_t i = 0; i < count; i++) {
+                float v = (float)((int32_t)bench_rand()) / 2147483648.0f;
+                memcpy(&out[len], &v, sizeof(v));
+                len += sizeof(v);
+            }
+        }
+        for (size_t i = 0; i < len; i++) {
+            sum = (uint8_t)(sum + out[i]);
+        }
+        out[len++] = (uint8_t)~sum;
+        if (type != SF_TYPE_BATTERY) {
+            out[len++] = SF_LEGACY_NEWLINE;
+        }
+
+        if (n % DROP_EVERY == 0) {
+            len = 1 + bench_rand() % (len - 1);
+        } else if (n % CORRUPT_EVERY == 0) {
+            out[2 + bench_rand() % 3] ^= (uint8_t)(1u << (bench_rand() & 7));
+        }
+        buf.insert(buf.end(), out, out + len);
+    }
+}
+
+/*
+ * Byte-at-a-time legacy parser: the reference for sf::legacy_decoder.
+ * With `store` it also appends to s_legacy_cols, so timed passes do the
+ * decoder's work.
+ */
+static void bench_legacy_ref(const uint8_t *p, size_t len, bool store)
+{
+    size_t off = 0;
+
+    while (off + 1 < len) {
+        if (p[off] != SF_LEGACY_MARKER) {
+            off++;
+            continue;
+        }
+
+        uint8_t type = p[off + 1];
+        size_t n;
+        if (type == SF_TYPE_QUATERNION) {
+            n = 20;
+        } else if (type == SF_TYPE_MAGNETOMETER || type == SF_TYPE_LINEAR_ACCEL) {
+            n = 16;
+        } else if (type == SF_TYPE_BATTERY) {
+            n = 6;
+        } else {
+            off++;
+            continue;
+        }
+        if (off + n > len) {
+            break;
+        }
+
+        bool newline = type != SF_TYPE_BATTERY;
+        size_t sum_at = off + n - (newline ? 2 : 1);
+        uint8_t check = 0;
+        for (size_t i = off; i < sum_at; i++) {
+            check = (uint8_t)(check + p[i]);
+        }
+        if (p[sum_at] != (uint8_t)~check || (newline && p[sum_at + 1] != '\n')) {
+            s_legacy_bad++;
+            off++;
+            continue;
+        }
+
+        if (store) {
+            float v[4] = {0, 0, 0, 0};
+            if (newline) {
+                memcpy(v, &p[off + 2], n - 4);    /* Floats between type and checksum */
+            }
+            if (type == SF_TYPE_QUATERNION) {
+                s_legacy_cols.quat.w.push_back(v[0]);
+                s_legacy_cols.quat.x.push_back(v[1]);
+                s_legacy_cols.quat.y.push_back(v[2]);
+                s_legacy_cols.quat.z.push_back(v[3]);
+                s_legacy_cols.quat.push(0, false, 0);
+            } else if (type == SF_TYPE_BATTERY) {
+                s_legacy_cols.battery.push(0, false, 0);
+                s_legacy_cols.battery.percent.push_back(p[off + 2]);
+                s_legacy_cols.battery.millivolts.push_back((uint16_t)(p[off + 3] | (p[off + 4] << 8)));
+            } else {
+                sf::vec3_columns &c = (type == SF_TYPE_MAGNETOMETER) ? s_legacy_cols.mag
+                                                                     : s_legacy_cols.linear_accel;
+                c.x.push_back(v[0]);
+                c.y.push_back(v[1]);
+                c.z.push_back(v[2]);
+                c.push(0, false, 0);
+            }
+        }
+        off += n;
+    }
+}
+
+/* bench_sum() plus battery samples */
+static sample_sums bench_legacy_sum(const sf::columns &cols)
+{
+    sample_sums s = bench_sum(cols);
+
+    bench_sum_common(cols.battery, s);
+    for (size_t i = 0; i < cols.battery.size(); i++) {
+        s.values += cols.battery.percent[i] + cols.battery.millivolts[i];
+    }
+    return s;
+}
+
+static bool bench_legacy_same(const char *what, const sf::legacy_decoder &dec,
+                              const sample_sums &s)
+{
+    double tol = 1e-9 * (double)(s.frames + 1) * 4.0;
+
+    if (dec.stats().packets == s_legacy_ref.frames && dec.stats().bad_packets == s_legacy_bad &&
+        s.frames == s_legacy_ref.frames && s.timed == 0 && s.timestamps == 0 &&
+        s.values - s_legacy_ref.values < tol && s_legacy_ref.values - s.values < tol) {
+        return true;
+    }
+    fprintf(stderr, "%s: mismatch with reference legacy parser\n", what);
+    fprintf(stderr, "  packets %lu/%lu bad %lu/%lu samples %lu\n",
+            (unsigned long)dec.stats().packets, (unsigned long)s_legacy_ref.frames,
+            (unsigned long)dec.stats().bad_packets, (unsigned long)s_legacy_bad,
+            (unsigned long)s.frames);
+    return false;
+}
+
+static bool bench_load(const char *path, std::vector<uint8_t> &buf)
+{
+    FILE *f = fopen(path, "rb");
+    long size;
+
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    buf.resize(size > 0 ? (size_t)size : 0);
+    if (size > 0 && fread(buf.data(), 1, buf.size(), f) != buf.size()) {
+        fprintf(stderr, "%s: read failed\n", path);
+        fclose(f);
+        return false;
+    }
+    fclose(f);
+    return true;
+}
+
+/*******************************************************************************
+ * Main
+ ******************************************************************************/
+
+int main(int argc, char **argv)
+{
+    std::vector<uint8_t> buf;
+    sf_decoder_t ref;
+    sf::decoder dec;
+    sf::columns cols;
+    uint64_t start_ns;
+
+    if (argc > 1 && !isdigit((unsigned char)argv[1][0])) {
+        if (!bench_load(argv[1], buf)) {
+            return 1;
+        }
+    } else {
+        unsigned long mb = (argc > 1) ? strtoul(argv[1], NULL, 0) : BENCH_DEFAULT_MB;
+
+        if (argc > 2) {
+            s_rng = (uint32_t)strtoul(argv[2], NULL, 0);
+            if (s_rng == 0) {
+                s_rng = BENCH_DEFAULT_SEED;
+            }
+        }
+        bench_generate(buf, mb << 20);
+    }
+
+    const uint8_t *data = buf.data();
+    const size_t len = buf.size();
+
+    /* Reference */
+    sf_decoder_init(&ref);
+    (void)sf_decoder_feed(&ref, data, len, bench_ref_cb, NULL);
+    printf("capture: %lu bytes, %lu frames, %lu rejected, %lu lost, "
+           "%lu untimed, scanner %s\n",
+           (unsigned long)len, (unsigned long)ref.stats.frames,
+           (unsigned long)(ref.stats.crc_errors + ref.stats.cobs_errors +
+                           ref.stats.runts + ref.stats.oversize),
+           (unsigned long)ref.stats.lost, (unsigned long)ref.stats.no_timestamp,
+           sf::simd_name());
+
+    /* Whole capture in one feed, both scanners */
+    cols.reserve_for(len);
+    (void)dec.feed(data, len, cols);
+    if (!bench_same("simd", dec.stats(), ref.stats, bench_sum(cols), s_ref)) {
+        return 1;
+    }
+    dec.reset();
+    cols.clear();
+    (void)dec.feed_scalar(data, len, cols);
+    if (!bench_same("scalar", dec.stats(), ref.stats, bench_sum(cols), s_ref)) {
+        return 1;
+    }
+
+    /* Notification-sized chunks: frames split across feeds */
+    dec.reset();
+    cols.clear();
+    for (size_t pos = 0; pos < len; ) {
+        size_t chunk = 1 + bench_rand() % NOTIFY_MAX;
+
+        if (chunk > len - pos) {
+            chunk = len - pos;
+        }
+        (void)dec.feed(data + pos, chunk, cols);
+        pos += chunk;
+    }
+    if (!bench_same("chunked", dec.stats(), ref.stats, bench_sum(cols), s_ref)) {
+        return 1;
+    }
+
+    /* Timed passes */
+    start_ns = bench_time_ns();
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        sf_decoder_init(&ref);
+        (void)sf_decoder_feed(&ref, data, len, NULL, NULL);
+    }
+    bench_report("stream_frame.c", len, bench_time_ns() - start_ns);
+
+    start_ns = bench_time_ns();
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        dec.reset();
+        cols.clear();
+        (void)dec.feed_scalar(data, len, cols);
+    }
+    bench_report("scalar", len, bench_time_ns() - start_ns);
+
+    start_ns = bench_time_ns();
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        dec.reset();
+        cols.clear();
+        (void)dec.feed(data, len, cols);
+    }
+    bench_report(sf::simd_name(), len, bench_time_ns() - start_ns);
+
+    /* Legacy '!' packets */
+    std::vector<uint8_t> legacy;
+    sf::legacy_decoder ldec;
+
+    bench_generate_legacy(legacy, len);
+    const uint8_t *ldata = legacy.data();
+    const size_t llen = legacy.size();
+
+    bench_legacy_ref(ldata, llen, true);
+    s_legacy_ref = bench_legacy_sum(s_legacy_cols);
+    printf("legacy capture: %lu bytes, %lu packets, %lu bad\n", (unsigned long)llen,
+           (unsigned long)s_legacy_ref.frames, (unsigned long)s_legacy_bad);
+
+    cols.clear();
+    (void)ldec.feed(ldata, llen, cols);
+    if (!bench_legacy_same("legacy simd", ldec, bench_legacy_sum(cols))) {
+        return 1;
+    }
+    ldec.reset();
+    cols.clear();
+    (void)ldec.feed_scalar(ldata, llen, cols);
+    if (!bench_legacy_same("legacy scalar", ldec, bench_legacy_sum(cols))) {
+        return 1;
+    }
+    ldec.reset();
+    cols.clear();
+    for (size_t pos = 0; pos < llen; ) {
+        size_t chunk = 1 + bench_rand() % NOTIFY_MAX;
+
+        if (chunk > llen - pos) {
+            chunk = llen - pos;
+        }
+        (void)ldec.feed(ldata + pos, chunk, cols);
+        pos += chunk;
+    }
+    if (!bench_legacy_same("legacy chunked", ldec, bench_legacy_sum(cols))) {
+        return 1;
+    }
+
+    start_ns = bench_time_ns();
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        s_legacy_cols.clear();
+        bench_legacy_ref(ldata, llen, true);
+    }
+    bench_report("legacy ref", llen, bench_time_ns() - start_ns);
+
+    start_ns = bench_time_ns();
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        ldec.reset();
+        cols.clear();
+        (void)ldec.feed_scalar(ldata, llen, cols);
+    }
+    bench_report("legacy scalar", llen, bench_time_ns() - start_ns);
+
+    start_ns = bench_time_ns();
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        ldec.reset();
+        cols.clear();
+        (void)ldec.feed(ldata, llen, cols);
+    }
+    bench_report("legacy simd", llen, bench_time_ns() - start_ns);
+
+    return 0;
+}
@@ -0,0 +1,357 @@
+/**
+ * @file dma_pool_stress.c
+ * @brief Host stress test for the EasyDMA buffer pool
+ *
+ * Built with -DDEBUG so ownership tracking is on. Runs a randomized
+ * alloc / transfer / free sequence against a shadow model of the pool and
+ * checks that:
+ *   - blocks are aligned, unique and never overlap (fill patterns survive)
+ *   - exhaustion returns NULL and counts an alloc failure
+ *   - in_use / high_water match the model
+ * then provokes each misuse fault once and checks it is reported.
+ *
+ * Usage: dma_pool_stress [iterations] [seed]
+ */
+
+#include "dma_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !DMA_POOL_TRACK_OWNERS
+#error "Build with -DDEBUG so ownership checks are compiled in"
+#endif
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+#define STRESS_DEFAULT_ITERATIONS   1000000UL
+#define STRESS_DEFAULT_SEED         0x2545F491UL
+#define STRESS_MAX_LIVE             64
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1); \
+        } \
+    } while (0)
+
+/**
+ * @brief Shadow record of one allocated block
+ */
+typedef struct {
+    uint8_t          *block;
+    uint16_t          size;
+    dma_pool_class_t  cls;
+    dma_pool_owner_t  owner;
+    uint8_t           fill;
+} live_block_t;
+
+/*******************************************************************************
+ * Private Variables
+ ******************************************************************************/
+
+static live_block_t s_live[STRESS_MAX_LIVE];
+static uint32_t s_live_count;
+
+static uint8_t s_in_use[DMA_POOL_CLASS_COUNT];
+static uint8_t s_high_water[DMA_POOL_CLASS_COUNT];
+static uint32_t s_failures[DMA_POOL_CLASS_COUNT];
+
+static uint32_t s_faults[4];
+static uint32_t s_rng;
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+/* Counts faults instead of stopping (overrides the weak default) */
+void dma_pool_fault_handler(const uint8_t *block, uint32_t reason)
+{
+    (void)block;
+    CHECK(reason < sizeof(s_faults) / sizeof(s_faults[0]));
+    s_faults[reason]++;
+}
+
+static uint32_t rng_next(void)
+{
+    /* xorshift32 */
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+static dma_pool_class_t class_of_size(uint16_t size)
+{
+    for (uint32_t c = 0; c < DMA_POOL_CLASS_COUNT; c++) {
+        if (dma_pool_stats((dma_pool_class_t)c)->block_size == size) {
+            return (dma_pool_class_t)c;
+        }
+    }
+    CHECK(0);
+    return DMA_POOL_CLASS_COUNT;
+}
+
+static uint32_t class_free_count(dma_pool_class_t cls)
+{
+    return dma_pool_stats(cls)->block_count - s_in_use[cls];
+}
+
+static void verify_block(const live_block_t *live)
+{
+    for (uint16_t i = 0; i < live->size; i++) {
+        if (live->block[i] != live->fill) {
+            fprintf(stderr, "block %p byte %u overwritten (0x%02X != 0x%02X)\n",
+                    (void *)live->block, i, live->block[i], live->fill);
+            exit(1);
+        }
+    }
+}
+
+static void track_alloc(uint8_t *block, dma_pool_owner_t owner)
+{
+    live_block_t *live;
+
+    CHECK(((uintptr_t)block & 3) == 0);
+    CHECK(s_live_count < STRESS_MAX_LIVE);
+    for (uint32_t i = 0; i < s_live_count; i++) {
+        CHECK(s_live[i].block != block);
+    }
+
+    live = &s_live[s_live_count++];
+    live->block = block;
+    live->size = dma_pool_block_size(block);
+    live->cls = class_of_size(live->size);
+    live->owner = owner;
+    live->fill = (uint8_t)rng_next();
+    memset(block, live->fill, live->size);
+
+    CHECK(dma_pool_owner(block) == owner);
+    if (++s_in_use[live->cls] > s_high_water[live->cls]) {
+        s_high_water[live->cls] = s_in_use[live->cls];
+    }
+}
+
+static void step_alloc(void)
+{
+    dma_pool_owner_t owner = (dma_pool_owner_t)(1 + rng_next() % (DMA_OWNER_COUNT - 1));
+    uint8_t *block;
+
+    if (rng_next() & 1) {
+        dma_pool_class_t cls = (dma_pool_class_t)(rng_next() % DMA_POOL_CLASS_COUNT);
+        bool expect = class_free_count(cls) > 0;
+
+        block = dma_pool_alloc(cls, owner);
+        CHECK((block != NULL) == expect);
+        if (block == NULL) {
+            s_failures[cls]++;
+            return;
+        }
+        CHECK(dma_pool_block_size(block) == dma_pool_stats(cls)->block_size);
+    } else {
+        uint16_t max = dma_pool_stats(DMA_POOL_SHTP)->block_size;
+        uint16_t len = (uint16_t)(1 + rng_next() % (max + 16));
+        uint16_t fit = len;
+        dma_pool_class_t expect = DMA_POOL_CLASS_COUNT;
+
+        /* Model: smallest fitting class first; each exhausted class on the
+         * way counts a failure, as dma_pool_alloc_size falls back upwards */
+        for (;;) {
+            dma_pool_class_t best = DMA_POOL_CLASS_COUNT;
+
+            for (uint32_t c = 0; c < DMA_POOL_CLASS_COUNT; c++) {
+                uint16_t size = dma_pool_stats((dma_pool_class_t)c)->block_size;
+
+                if (size >= fit && (best == DMA_POOL_CLASS_COUNT ||
+                                    size < dma_pool_stats(best)->block_size)) {
+                    best = (dma_pool_class_t)c;
+                }
+            }
+            if (best == DMA_POOL_CLASS_COUNT) {
+                break;
+            }
+            if (class_free_count(best) > 0) {
+                expect = best;
+                break;
+            }
+            s_failures[best]++;
+            fit = (uint16_t)(dma_pool_stats(best)->block_size + 1);
+        }
+
+        block = dma_pool_alloc_size(len, owner);
+        if (expect == DMA_POOL_CLASS_COUNT) {
+            CHECK(block == NULL);
+            return;
+        }
+        CHECK(block != NULL);
+        CHECK(dma_pool_block_size(block) == dma_pool_stats(expect)->block_size);
+        CHECK(dma_pool_block_size(block) >= len);
+    }
+
+    track_alloc(block, owner);
+}
+
+static void step_free(void)
+{
+    uint32_t i;
+    live_block_t live;
+
+    if (s_live_count == 0) {
+        return;
+    }
+
+    i = rng_next() % s_live_count;
+    live = s_live[i];
+    verify_block(&live);
+
+    dma_pool_free(live.block, live.owner);
+    CHECK(dma_pool_owner(live.block) == DMA_OWNER_NONE);
+    s_in_use[live.cls]--;
+    s_live[i] = s_live[--s_live_count];
+}
+
+static void step_transfer(void)
+{
+    live_block_t *live;
+    dma_pool_owner_t to;
+
+    if (s_live_count == 0) {
+        return;
+    }
+
+    live = &s_live[rng_next() % s_live_count];
+    verify_block(live);
+
+    to = (dma_pool_owner_t)(1 + rng_next() % (DMA_OWNER_COUNT - 1));
+    dma_pool_transfer(live->block, live->owner, to);
+    live->owner = to;
+    CHECK(dma_pool_owner(live->block) == to);
+}
+
+static void verify_stats(void)
+{
+    for (uint32_t c = 0; c < DMA_POOL_CLASS_COUNT; c++) {
+        const dma_pool_stats_t *stats = dma_pool_stats((dma_pool_class_t)c);
+
+        CHECK(stats->in_use == s_in_use[c]);
+        CHECK(stats->high_water == s_high_water[c]);
+        CHECK(stats->alloc_failures == s_failures[c]);
+    }
+}
+
+static void free_all(void)
+{
+    while (s_live_count > 0) {
+        live_block_t *live = &s_live[--s_live_count];
+
+        verify_block(live);
+        dma_pool_free(live->block, live->owner);
+        s_in_use[live->cls]--;
+    }
+}
+
+static void run_misuse(void)
+{
+    uint8_t *block;
+    uint32_t faults_before[4];
+
+    memcpy(faults_before, s_faults, sizeof(faults_before));
+
+    block = dma_pool_alloc(DMA_POOL_SMALL, DMA_OWNER_TEST);
+    CHECK(block != NULL);
+
+    /* Wrong owner: free and transfer are refused, block stays allocated */
+    dma_pool_free(block, DMA_OWNER_TWIM);
+    CHECK(s_faults[DMA_POOL_FAULT_WRONG_OWNER] == faults_before[DMA_POOL_FAULT_WRONG_OWNER] + 1);
+    dma_pool_transfer(block, DMA_OWNER_BLE, DMA_OWNER_TWIM);
+    CHECK(s_faults[DMA_POOL_FAULT_WRONG_OWNER] == faults_before[DMA_POOL_FAULT_WRONG_OWNER] + 2);
+    CHECK(dma_pool_owner(block) == DMA_OWNER_TEST);
+
+    /* Not a block: interior pointer and foreign memory */
+    dma_pool_free(block + 4, DMA_OWNER_TEST);
+    dma_pool_free((uint8_t *)s_faults, DMA_OWNER_TEST);
+    CHECK(s_faults[DMA_POOL_FAULT_NOT_A_BLOCK] == faults_before[DMA_POOL_FAULT_NOT_A_BLOCK] + 2);
+    CHECK(dma_pool_block_size(block + 4) == 0);
+
+    /* Double free */
+    dma_pool_free(block, DMA_OWNER_TEST);
+    dma_pool_free(block, DMA_OWNER_TEST);
+    CHECK(s_faults[DMA_POOL_FAULT_DOUBLE_FREE] == faults_before[DMA_POOL_FAULT_DOUBLE_FREE] + 1);
+
+    /* NULL is ignored */
+    dma_pool_free(NULL, DMA_OWNER_TEST);
+    CHECK(s_faults[DMA_POOL_FAULT_NOT_A_BLOCK] == faults_before[DMA_POOL_FAULT_NOT_A_BLOCK] + 2);
+
+    /* Oversized request */
+    CHECK(dma_pool_alloc_size(CONFIG_SHTP_RX_BUFFER_SIZE + 1, DMA_OWNER_TEST) == NULL);
+
+    /* Stats back to idle */
+    for (uint32_t c = 0; c < DMA_POOL_CLASS_COUNT; c++) {
+        CHECK(dma_pool_stats((dma_pool_class_t)c)->in_use == 0);
+    }
+}
+
+/*******************************************************************************
+ * Main
+ ******************************************************************************/
+
+int main(int argc, char **argv)
+{
+    unsigned long iterations = STRESS_DEFAULT_ITERATIONS;
+    unsigned long allocs = 0, frees = 0, transfers = 0;
+    uint32_t seed = STRESS_DEFAULT_SEED;
+
+    if (argc > 1) {
+        iterations = strtoul(argv[1], NULL, 0);
+    }
+    if (argc > 2 && strtoul(argv[2], NULL, 0) != 0) {
+        seed = (uint32_t)strtoul(argv[2], NULL, 0);
+    }
+    s_rng = seed;
+
+    dma_pool_init();
+
+    for (unsigned long i = 0; i < iterations; i++) {
+        uint32_t op = rng_next() % 8;
+
+        /* Bias towards allocation so the pool regularly runs dry */
+        if (op < 4) {
+            step_alloc();
+            allocs++;
+        } else if (op < 7) {
+            step_free();
+            frees++;
+        } else {
+            step_transfer();
+            transfers++;
+        }
+
+        if ((i & 0xFF) == 0) {
+            verify_stats();
+        }
+    }
+
+    verify_stats();
+    free_all();
+    CHECK(s_faults[DMA_POOL_FAULT_NOT_A_BLOCK] == 0 &&
+          s_faults[DMA_POOL_FAULT_DOUBLE_FREE] == 0 &&
+          s_faults[DMA_POOL_FAULT_WRONG_OWNER] == 0);
+
+    run_misuse();
+
+    printf("%lu iterations (%lu alloc, %lu free, %lu transfer), seed 0x%08lX\n",
+           iterations, allocs, frees, transfers, (unsigned long)seed);
+    for (uint32_t c = 0; c < DMA_POOL_CLASS_COUNT; c++) {
+        const dma_pool_stats_t *stats = dma_pool_stats((dma_pool_class_t)c);
+
+        printf("  class %lu: %3u x %u bytes, high water %u, %lu alloc failures\n",
+               (unsigned long)c, stats->block_size, stats->block_count,
+               stats->high_water, (unsigned long)stats->alloc_failures);
+    }
+    printf("PASS\n");
+
+    return 0;
+}
@@ -0,0 +1,361 @@
+/**
+ * @file frame_bench.c
+ * @brief Throughput benchmark and self-check for the stream_frame decoder
+ *
+ * Generates a capture of sketch frames (Q/M/A at 1:1:1 with jittered
+ * sensor timestamps, as the sketch sends them) and decodes it in
+ * notification-sized chunks of random length, the way a central receives
+ * them. While generating, it
+ *   - drops one frame in DROP_EVERY (a missed notification),
+ *   - flips a bit in one frame in CORRUPT_EVERY,
+ *   - swaps two bytes in the next corrupted frame (the error an additive
+ *     checksum cannot see),
+ * and then checks the decoder delivered every intact frame, rejected
+ * every damaged one, accounted for every dropped one by seq, and
+ * reconstructed every timestamp it could (all but the frames between a
+ * gap and the next absolute timestamp).
+ *
+ * Usage: frame_bench [megabytes] [seed]
+ *        frame_bench capture.bin
+ *
+ * With a file argument the file is decoded as-is (e.g. bytes logged from
+ * the TX characteristic) and only the counters and throughput are shown.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "stream_frame.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+#define BENCH_DEFAULT_MB        16UL
+#define BENCH_DEFAULT_SEED      0x2545F491UL
+#define BENCH_PASSES            8
+
+#define DROP_EVERY              997
+#define CORRUPT_EVERY           1009
+
+#define NOTIFY_MAX              244     /* ATT payload at MTU 247 */
+
+/**
+ * @brief Expected counts for a generated capture
+ */
+typedef struct {
+    size_t    len;
+    uint32_t  frames;           /* Intact frames written */
+    uint32_t  corrupted;        /* Frames written damaged */
+    uint32_t  dropped;          /* Frames built but not written */
+    uint32_t  no_timestamp;     /* Intact frames the receiver cannot time */
+    uint64_t  payload_sum;      /* Sum of intact payload bytes */
+    uint32_t *timestamps;       /* Expected timestamp of each timed frame */
+    uint32_t  timestamp_count;
+} capture_t;
+
+/*******************************************************************************
+ * Private Variables
+ ******************************************************************************/
+
+static uint32_t s_rng;
+static uint64_t s_payload_sum;
+
+/* Checked pass: next expected timestamp and mismatches */
+static const capture_t *s_check;
+static uint32_t s_check_next;
+static uint32_t s_ts_mismatch;
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+static uint32_t bench_rand(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+static uint64_t bench_time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void bench_frame_cb(const sf_frame_t *frame, void *ctx)
+{
+    (void)ctx;
+    for (uint8_t i = 0; i < frame->len; i++) {
+        s_payload_sum += frame->payload[i];
+    }
+}
+
+static void bench_check_cb(const sf_frame_t *frame, void *ctx)
+{
+    bench_frame_cb(frame, ctx);
+
+    if (!frame->has_timestamp) {
+        return;
+    }
+    if (s_check_next >= s_check->timestamp_count ||
+        frame->timestamp_us != s_check->timestamps[s_check_next]) {
+        s_ts_mismatch++;
+    }
+    s_check_next++;
+}
+
+/**
+ * @brief Damage an encoded frame without creating or removing a delimiter
+ *
+ * Skips the delimiter; a hit on a COBS code byte shows up as a COBS, runt
+ * or CRC error rather than a CRC error, which is still a rejection.
+ */
+static void bench_corrupt(uint8_t *enc, size_t len, bool swap)
+{
+    size_t i = bench_rand() % (uint32_t)(len - 2);
+
+    if (swap) {
+        /* Make the pair differ so the swap changes the frame */
+        if (enc[i] == enc[i + 1]) {
+            enc[i + 1] ^= 0x5A;
+            if (enc[i + 1] == 0) {
+                enc[i + 1] = 0x5A;
+            }
+        }
+        uint8_t t = enc[i];
+        enc[i] = enc[i + 1];
+        enc[i + 1] = t;
+    } else {
+        uint8_t flipped = enc[i] ^ (uint8_t)(1u << (bench_rand() & 7));
+        enc[i] = flipped ? flipped : 0x80;
+    }
+}
+
+/**
+ * @brief Fill buf with frames until fewer than SF_MAX_ENCODED bytes remain
+ */
+static void bench_generate(uint8_t *buf, size_t size, capture_t *cap)
+{
+    static const uint8_t types[] = {
+        SF_TYPE_QUATERNION, SF_TYPE_MAGNETOMETER, SF_TYPE_LINEAR_ACCEL
+    };
+    sf_encoder_t enc;
+    float values[4];
+    uint32_t timestamp_us = bench_rand();   /* Arbitrary epoch, exercises wrap */
+    bool rx_has_ts = false;                 /* Receiver's view after this frame */
+    bool swap = false;
+
+    memset(cap, 0, sizeof(*cap));
+    cap->timestamps = malloc((size / 16 + 1) * sizeof(uint32_t));
+    sf_encoder_init(&enc);
+
+    for (uint32_t n = 1; cap->len + SF_MAX_ENCODED <= size; n++) {
+        uint8_t type = types[n % 3];
+        uint8_t count = (type == SF_TYPE_QUATERNION) ? 4 : 3;
+        uint8_t len = (uint8_t)(count * sizeof(float));
+        bool absolute = (enc.seq % SF_ABS_TS_INTERVAL) == 0;
+        uint8_t *out = &buf[cap->len];
+        size_t out_len;
+
+        for (uint8_t i = 0; i < count; i++) {
+            values[i] = (float)((int32_t)bench_rand()) / 2147483648.0f;
+        }
+
+        /* 3 reports per 5 ms period, +-200 us jitter, occasionally reordered */
+        timestamp_us += 1667 + (bench_rand() % 401) - 200;
+        if ((n & 0xFF) == 0) {
+            timestamp_us -= 300;
+        }
+
+        out_len = sf_encode(&enc, type, timestamp_us, values, len, out);
+
+        if (n % DROP_EVERY == 0) {
+            cap->dropped++;
+            rx_has_ts = false;
+            continue;
+        }
+
+        if (n % CORRUPT_EVERY == 0) {
+            bench_corrupt(out, out_len, swap);
+            swap = !swap;
+            cap->corrupted++;
+            rx_has_ts = false;
+        } else {
+            const uint8_t *v = (const uint8_t *)values;
+
+            for (uint8_t i = 0; i < len; i++) {
+                cap->payload_sum += v[i];
+            }
+            cap->frames++;
+
+            rx_has_ts = rx_has_ts || absolute;
+            if (rx_has_ts) {
+                cap->timestamps[cap->timestamp_count++] = timestamp_us;
+            } else {
+                cap->no_timestamp++;
+            }
+        }
+
+        cap->len += out_len;
+    }
+}
+
+/**
+ * @brief Decode buf in random notification-sized chunks
+ */
+static void bench_decode(sf_decoder_t *dec, const uint8_t *buf, size_t len,
+                         sf_frame_cb_t cb)
+{
+    size_t pos = 0;
+
+    while (pos < len) {
+        size_t chunk = 1 + bench_rand() % NOTIFY_MAX;
+
+        if (chunk > len - pos) {
+            chunk = len - pos;
+        }
+        (void)sf_decoder_feed(dec, &buf[pos], chunk, cb, NULL);
+        pos += chunk;
+    }
+}
+
+static void bench_print_stats(const sf_decoder_stats_t *st)
+{
+    printf("decoder: %lu frames, %lu crc, %lu cobs, %lu oversize, %lu runt, "
+           "%lu seq gaps (%lu lost), %lu untimed\n",
+           (unsigned long)st->frames, (unsigned long)st->crc_errors,
+           (unsigned long)st->cobs_errors, (unsigned long)st->oversize,
+           (unsigned long)st->runts, (unsigned long)st->seq_gaps,
+           (unsigned long)st->lost, (unsigned long)st->no_timestamp);
+}
+
+static uint8_t *bench_load(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    uint8_t *buf;
+    long size;
+
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    buf = malloc(size > 0 ? (size_t)size : 1);
+    if (!buf || fread(buf, 1, (size_t)size, f) != (size_t)size) {
+        fprintf(stderr, "%s: read failed\n", path);
+        free(buf);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+
+    *len = (size_t)size;
+    return buf;
+}
+
+/*******************************************************************************
+ * Main
+ ******************************************************************************/
+
+int main(int argc, char **argv)
+{
+    unsigned long mb = BENCH_DEFAULT_MB;
+    sf_decoder_t dec;
+    capture_t cap;
+    uint8_t *buf;
+    int result = 0;
+    size_t len;
+    bool generated = true;
+    uint64_t start_ns, elapsed_ns;
+    double seconds;
+
+    s_rng = BENCH_DEFAULT_SEED;
+    memset(&cap, 0, sizeof(cap));
+
+    if (argc > 1 && !isdigit((unsigned char)argv[1][0])) {
+        buf = bench_load(argv[1], &len);
+        if (!buf) {
+            return 1;
+        }
+        generated = false;
+    } else {
+        if (argc > 1) {
+            mb = strtoul(argv[1], NULL, 0);
+        }
+        if (argc > 2) {
+            s_rng = (uint32_t)strtoul(argv[2], NULL, 0);
+            if (s_rng == 0) {
+                s_rng = BENCH_DEFAULT_SEED;
+            }
+        }
+
+        buf = malloc(mb << 20);
+        if (buf) {
+            bench_generate(buf, mb << 20, &cap);
+        }
+        if (!buf || !cap.timestamps) {
+            fprintf(stderr, "out of memory\n");
+            free(buf);
+            return 1;
+        }
+        len = cap.len;
+        printf("capture: %lu bytes, %lu frames, %lu corrupted, %lu dropped, "
+               "%lu untimed\n",
+               (unsigned long)cap.len, (unsigned long)cap.frames,
+               (unsigned long)cap.corrupted, (unsigned long)cap.dropped,
+               (unsigned long)cap.no_timestamp);
+    }
+
+    /* Checked pass */
+    sf_decoder_init(&dec);
+    s_payload_sum = 0;
+    s_check = &cap;
+    bench_decode(&dec, buf, len, generated ? bench_check_cb : bench_frame_cb);
+    bench_print_stats(&dec.stats);
+
+    /* A damaged COBS code byte can surface as a COBS or runt error instead
+     * of a CRC error; either way the frame must be rejected */
+    if (generated &&
+        (dec.stats.frames != cap.frames ||
+         dec.stats.crc_errors + dec.stats.cobs_errors + dec.stats.runts != cap.corrupted ||
+         dec.stats.oversize != 0 ||
+         dec.stats.lost != cap.dropped + cap.corrupted ||
+         dec.stats.no_timestamp != cap.no_timestamp ||
+         s_check_next != cap.timestamp_count || s_ts_mismatch != 0 ||
+         s_payload_sum != cap.payload_sum)) {
+        fprintf(stderr, "decode mismatch (%lu timestamp errors)\n",
+                (unsigned long)s_ts_mismatch);
+        result = 1;
+        goto done;
+    }
+
+    /* Timed passes */
+    start_ns = bench_time_ns();
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        sf_decoder_init(&dec);
+        bench_decode(&dec, buf, len, bench_frame_cb);
+    }
+    elapsed_ns = bench_time_ns() - start_ns;
+
+    seconds = (double)elapsed_ns / 1e9;
+    printf("%.1f MB/s, %.2f Mframes/s, %.2f ns/byte\n",
+           (double)len * BENCH_PASSES / seconds / (1024.0 * 1024.0),
+           (double)dec.stats.frames * BENCH_PASSES / seconds / 1e6,
+           (double)elapsed_ns / ((double)len * BENCH_PASSES));
+
+done:
+    free(cap.timestamps);
+    free(buf);
+    return result;
+}
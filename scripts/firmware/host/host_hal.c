@@ -0,0 +1,172 @@
+/**
+ * @file host_hal.c
+ * @brief Host stand-ins for board.c and the SoftDevice API
+ *
+ * Only the SoftDevice calls reached by the host-built modules are provided.
+ * GATT calls allocate handles and count notifications so benchmarks can
+ * check that the work was actually done.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "host_hal.h"
+#include "board.h"
+#include "twim.h"
+#include "ble_gatts.h"
+#include "ble_stack.h"
+#include "nrf_error.h"
+#include <string.h>
+#include <time.h>
+
+/*******************************************************************************
+ * Private Variables
+ ******************************************************************************/
+
+/* TWIM instance normally defined in board.c */
+twim_t g_twim = { .initialized = true };
+
+static host_sd_stats_t s_sd_stats = { .next_handle = 1 };
+static host_hvx_hook_t s_hvx_hook = NULL;
+
+/* Simulated DWT cycle counter, advanced by sensor time */
+static uint32_t s_cycles = 0;
+
+#define HOST_MAX_SERVICE_HANDLERS   4
+static ble_stack_service_handler_t s_service_handlers[HOST_MAX_SERVICE_HANDLERS];
+static uint8_t s_service_handler_count = 0;
+
+/*******************************************************************************
+ * Public Functions - Board
+ ******************************************************************************/
+
+uint64_t host_time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void board_delay_ms(uint32_t ms)
+{
+    (void)ms;  /* Simulated sensor answers immediately */
+}
+
+uint8_t board_gpio_read(uint8_t port, uint8_t pin)
+{
+    (void)port;
+    (void)pin;
+    return 0;
+}
+
+void board_cycle_counter_init(void)
+{
+}
+
+uint32_t board_cycle_counter_get(void)
+{
+    /* Simulated time: deterministic and far cheaper than clock_gettime(),
+     * which would otherwise dominate the passthrough path on the host */
+    return s_cycles;
+}
+
+void host_cycles_advance(uint32_t cycles)
+{
+    s_cycles += cycles;
+}
+
+/*******************************************************************************
+ * Public Functions - BLE Stack
+ ******************************************************************************/
+
+uint32_t ble_stack_service_handler_register(ble_stack_service_handler_t handler)
+{
+    if (handler == NULL) {
+        return NRF_ERROR_NULL;
+    }
+    if (s_service_handler_count >= HOST_MAX_SERVICE_HANDLERS) {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    s_service_handlers[s_service_handler_count++] = handler;
+    return NRF_SUCCESS;
+}
+
+void host_ble_evt_dispatch(const ble_evt_t *p_ble_evt)
+{
+    for (uint8_t i = 0; i < s_service_handler_count; i++) {
+        s_service_handlers[i](p_ble_evt);
+    }
+}
+
+/*******************************************************************************
+ * Public Functions - SoftDevice
+ ******************************************************************************/
+
+uint32_t sd_ble_uuid_vs_add(const ble_uuid128_t *p_vs_uuid, uint8_t *p_uuid_type)
+{
+    (void)p_vs_uuid;
+    *p_uuid_type = BLE_UUID_TYPE_VENDOR_BEGIN;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_service_add(uint8_t type, const ble_uuid_t *p_uuid,
+                                  uint16_t *p_handle)
+{
+    (void)type;
+    (void)p_uuid;
+    *p_handle = s_sd_stats.next_handle++;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_characteristic_add(uint16_t service_handle,
+                                         const ble_gatts_char_md_t *p_char_md,
+                                         const ble_gatts_attr_t *p_attr_char_value,
+                                         ble_gatts_char_handles_t *p_handles)
+{
+    (void)service_handle;
+    (void)p_attr_char_value;
+
+    /* Declaration, value and (optionally) CCCD attributes */
+    s_sd_stats.next_handle++;
+    memset(p_handles, 0, sizeof(*p_handles));
+    p_handles->value_handle = s_sd_stats.next_handle++;
+    if (p_char_md->p_cccd_md != NULL) {
+        p_handles->cccd_handle = s_sd_stats.next_handle++;
+    }
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_value_set(uint16_t conn_handle, uint16_t handle,
+                                ble_gatts_value_t *p_value)
+{
+    (void)conn_handle;
+    (void)handle;
+    (void)p_value;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t *p_hvx_params)
+{
+    (void)conn_handle;
+
+    s_sd_stats.notifications++;
+    s_sd_stats.notify_bytes += *p_hvx_params->p_len;
+    for (uint16_t i = 0; i < *p_hvx_params->p_len; i++) {
+        s_sd_stats.notify_checksum += p_hvx_params->p_data[i];
+    }
+    if (s_hvx_hook != NULL) {
+        s_hvx_hook(p_hvx_params->handle, p_hvx_params->p_data, *p_hvx_params->p_len);
+    }
+    return NRF_SUCCESS;
+}
+
+const host_sd_stats_t *host_sd_stats(void)
+{
+    return &s_sd_stats;
+}
+
+void host_sd_hvx_hook_set(host_hvx_hook_t hook)
+{
+    s_hvx_hook = hook;
+}
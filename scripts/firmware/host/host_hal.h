@@ -0,0 +1,92 @@
+/**
+ * @file host_hal.h
+ * @brief Host HAL for running firmware modules on a development machine
+ *
+ * Replaces board.c, twim.c and the SoftDevice SVC interface so the sensor
+ * and BLE modules (bno085.c, ble_imu_service.c, imu_pipeline.c) build with
+ * the host compiler. The TWIM bus is backed by a simulated BNO085 that
+ * answers the init handshake and streams the enabled reports.
+ *
+ * Build with -DNRF_HOST_HAL (see host/Makefile).
+ */
+
+#ifndef HOST_HAL_H
+#define HOST_HAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*******************************************************************************
+ * Data Structures
+ ******************************************************************************/
+
+/**
+ * @brief Counters kept by the SoftDevice stand-in
+ */
+typedef struct {
+    uint32_t notifications;     /* sd_ble_gatts_hvx calls accepted */
+    uint32_t notify_bytes;      /* Payload bytes notified */
+    uint32_t notify_checksum;   /* Running sum of payload bytes */
+    uint16_t next_handle;       /* Next attribute handle to allocate */
+} host_sd_stats_t;
+
+/**
+ * @brief Sees every accepted notification (e.g. to decode it)
+ */
+typedef void (*host_hvx_hook_t)(uint16_t handle, const uint8_t *p_data, uint16_t len);
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Reset the simulated BNO085 to power-on state
+ *
+ * The next read returns the RESET_COMPLETE advertisement, as after a real
+ * power cycle.
+ */
+void sim_bno085_reset(void);
+
+/**
+ * @brief Number of input reports the simulated sensor has sent
+ */
+uint32_t sim_bno085_reports_sent(void);
+
+/**
+ * @brief Deliver a BLE event to the services registered with the stack
+ * @param p_ble_evt Event to dispatch
+ */
+void host_ble_evt_dispatch(const ble_evt_t *p_ble_evt);
+
+/**
+ * @brief SoftDevice stand-in counters
+ */
+const host_sd_stats_t *host_sd_stats(void);
+
+/**
+ * @brief Install a hook called for every accepted notification
+ * @param hook Hook, or NULL to remove
+ */
+void host_sd_hvx_hook_set(host_hvx_hook_t hook);
+
+/**
+ * @brief Advance the simulated cycle counter (board_cycle_counter_get)
+ * @param cycles CPU cycles at BOARD_MCU_FREQUENCY_HZ
+ */
+void host_cycles_advance(uint32_t cycles);
+
+/**
+ * @brief Monotonic time in nanoseconds
+ */
+uint64_t host_time_ns(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_HAL_H */
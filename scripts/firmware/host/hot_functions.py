@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""Turn a gcov JSON profile into a linker input-section order.
+
+Reads the output of `gcov --json-format --stdout` (one JSON document per
+line) from the host training run and prints `*(.text.<fn>)` lines for the
+hot flash-resident functions in scripts/firmware/src, hottest first. The
+target linker script INCLUDEs the result inside .text, so with
+-ffunction-sections the sample path is laid out contiguously in flash.
+
+Left out, as they have no .text.<fn> section on target:
+- RAMFUNC functions, which are linked into .ramfunc (RAM has no cache
+  lines to share, so their order there does not matter)
+- inline functions, which have no body of their own
+Also left out: functions run less than HOT_FRACTION as often as the
+hottest one (init and configuration), which would otherwise be placed
+first and push the sample path back.
+"""
+import json
+import os
+import re
+import sys
+
+# Executed at least this fraction as often as the hottest function
+HOT_FRACTION = 0.01
+
+src = open(sys.argv[1]) if len(sys.argv) > 1 else sys.stdin
+
+counts = {}
+sources = set()
+for line in src:
+    line = line.strip()
+    if not line:
+        continue
+    doc = json.loads(line)
+    cwd = doc.get('current_working_directory', '')
+    for f in doc.get('files', []):
+        # Firmware sources only, not the host HAL or benchmark driver
+        if os.sep + 'src' + os.sep not in os.path.normpath(f['file']):
+            continue
+        sources.add(os.path.normpath(os.path.join(cwd, f['file'])))
+        for fn in f.get('functions', []):
+            if fn['execution_count'] > 0:
+                name = fn['name']
+                counts[name] = max(counts.get(name, 0), fn['execution_count'])
+
+
+def not_in_flash(paths):
+    """Names of functions defined RAMFUNC or inline in the given sources"""
+    names = set()
+    # Definition head at column 0: "static RAMFUNC int name(" and the like
+    head_re = re.compile(r'^([A-Za-z_][^;{}()=]*?)\b(\w+)\s*\(')
+    for path in paths:
+        try:
+            text = open(path).read()
+        except OSError:
+            continue
+        for line in text.splitlines():
+            m = head_re.match(line)
+            if m and re.search(r'\b(RAMFUNC|inline|__inline__)\b', m.group(1)):
+                names.add(m.group(2))
+    return names
+
+
+excluded = not_in_flash(sources)
+hottest = max(counts.values(), default=0)
+hot = {name: count for name, count in counts.items()
+       if name not in excluded and count >= hottest * HOT_FRACTION}
+
+print('/* Generated by host/hot_functions.py from the host training run.')
+print(' * Regenerate with: make -C host profile')
+print(' * Order: execution count, highest first. Only hot flash-resident')
+print(' * functions; RAMFUNC and inline ones have no .text.<fn> section. */')
+for name, count in sorted(hot.items(), key=lambda kv: (-kv[1], kv[0])):
+    print(f'*(.text.{name} .text.{name}.*)  /* {count} */')
+if not hot:
+    print('/* (none: the whole sample path is RAMFUNC) */')
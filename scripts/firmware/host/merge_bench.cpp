@@ -0,0 +1,449 @@
+/**
+ * @file merge_bench.cpp
+ * @brief Alignment, throughput and latency of stream_merge.hpp
+ *
+ * Simulates N devices streaming the sketch's frames to one receiver. Each
+ * device has its own clock offset and crystal error (up to +/-80 ppm) and
+ * sends Q/M/A frames at 200 Hz each; frames wait for the next 7.5 ms
+ * connection event, some events are missed and retried, the receiver adds
+ * scheduling delay, and an occasional frame is lost, so some samples come
+ * without a timestamp. Notifications from all devices are decoded with
+ * sf::decoder and merged in arrival order.
+ *
+ * For each device count it checks that the output is time-ordered and
+ * accounts for every sample, and that sensor-time alignment puts samples
+ * within SF_BENCH_MAX_SPREAD of their true time, then reports:
+ *   - alignment error against the true sample time, with sensor
+ *     timestamps and the skew estimate (samples that have one) and with
+ *     arrival times alone, as the median (a delay every packet has looks
+ *     like clock offset and shifts all devices alike) and the p99 spread
+ *     around it;
+ *   - latency the merge adds (release time minus arrival);
+ *   - merge throughput alone and with decoding.
+ *
+ * Usage: merge_bench [--logs dir] [seconds [devices...]]
+ *
+ * --logs writes each device of the last run as a notification log
+ * (dir/devN.sflog), as input for stream_merge.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "stream_merge.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <vector>
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+#define BENCH_DEFAULT_SECONDS   60
+#define BENCH_SEED              0x2545F491UL
+
+#define FRAME_INTERVAL_US       1667        /* Q, M, A in turn, 200 Hz each */
+#define FRAME_JITTER_US         200
+#define CONN_INTERVAL_US        7500
+#define PROCESS_MAX_US          1000        /* Sensor read to notify queue */
+#define MISSED_EVENT_EVERY      50          /* Events retried, 1 to 3 intervals */
+#define HOST_MIN_DELAY_US       200         /* Radio to application, fixed part */
+#define HOST_MEAN_DELAY_US      500         /* Exponential part */
+#define DROP_EVERY              997
+#define MAX_PPM                 80
+#define NOTIFY_MAX              244
+
+#define WARMUP_US               2000000     /* Excluded from alignment error */
+#define SF_BENCH_MAX_SPREAD     1000        /* p99 |error - bias|, sensor mode, us */
+
+/**
+ * @brief One notification: bytes [begin, end) of a device's capture
+ */
+struct notification {
+    int64_t  arrival_us;
+    uint16_t device;
+    uint32_t begin;
+    uint32_t end;
+};
+
+/**
+ * @brief What a device sent, and when each frame was really sampled
+ */
+struct device_capture {
+    std::vector<uint8_t> bytes;
+    std::vector<int64_t> true_us;       /* By frame index (payload value 0) */
+};
+
+/**
+ * @brief A decoded sample waiting to be pushed, for merge-only timing
+ */
+struct pending_sample {
+    int64_t  arrival_us;
+    uint32_t sensor_us;
+    uint16_t device;
+    uint8_t  type;
+    uint8_t  timed;
+    float    v[4];
+};
+
+struct run_result {
+    uint64_t           samples;
+    sf::merge_stats    stats;
+    double             bias_us;         /* Median alignment error */
+    double             spread_p99_us;   /* p99 |error - bias| */
+    std::vector<int64_t> latency_us;
+    bool               ordered;
+};
+
+/*******************************************************************************
+ * Private Variables
+ ******************************************************************************/
+
+static uint32_t s_rng = BENCH_SEED;
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+static uint32_t bench_rand(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+static double bench_uniform(void)
+{
+    return (bench_rand() >> 8) / 16777216.0;
+}
+
+static uint64_t bench_time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* One device's frames and the notifications that carry them */
+static void bench_device(uint16_t device, int64_t seconds, device_capture &cap,
+                         std::vector<notification> &notes)
+{
+    static const uint8_t types[] = {
+        SF_TYPE_QUATERNION, SF_TYPE_MAGNETOMETER, SF_TYPE_LINEAR_ACCEL
+    };
+    const double rate = 1 + (bench_uniform() * 2 - 1) * MAX_PPM * 1e-6;
+    const uint32_t sensor0 = bench_rand();
+    const int64_t phase = bench_rand() % CONN_INTERVAL_US;
+    const int64_t end_us = seconds * 1000000;
+    sf_encoder_t enc;
+    uint8_t out[SF_MAX_ENCODED];
+    int64_t t = bench_rand() % 20000;
+    int64_t last_event = INT64_MIN;
+    int64_t last_arrival = INT64_MIN;
+
+    sf_encoder_init(&enc);
+    cap.bytes.clear();
+    cap.true_us.clear();
+
+    for (uint32_t n = 0; t < end_us; n++) {
+        uint8_t type = types[n % 3];
+        uint8_t count = (type == SF_TYPE_QUATERNION) ? 4 : 3;
+        float values[4] = {(float)n, 0, 0, 0};
+
+        for (uint8_t i = 1; i < count; i++) {
+            values[i] = (float)((int32_t)bench_rand()) / 2147483648.0f;
+        }
+        uint32_t sensor_us = sensor0 + (uint32_t)std::llround((double)t * rate);
+        size_t len = sf_encode(&enc, type, sensor_us, values, (uint8_t)(count * sizeof(float)),
+                               out);
+        cap.true_us.push_back(t);
+
+        if (n % DROP_EVERY != DROP_EVERY - 1) {
+            /* Next connection event after the frame is queued, in order */
+            int64_t ready = t + bench_rand() % PROCESS_MAX_US;
+            int64_t event = ready + CONN_INTERVAL_US - 1 -
+                            ((ready - phase) % CONN_INTERVAL_US + CONN_INTERVAL_US) %
+                            CONN_INTERVAL_US;
+            if (event <= last_event) {
+                event = last_event;
+            } else if (bench_rand() % MISSED_EVENT_EVERY == 0) {
+                event += CONN_INTERVAL_US * (1 + bench_rand() % 3);
+            }
+
+            uint32_t begin = (uint32_t)cap.bytes.size();
+            cap.bytes.insert(cap.bytes.end(), out, out + len);
+            if (event == last_event && !notes.empty() && notes.back().device == device &&
+                notes.back().end - notes.back().begin + len <= NOTIFY_MAX) {
+                notes.back().end = (uint32_t)cap.bytes.size();
+            } else {
+                int64_t arrival = event + HOST_MIN_DELAY_US +
+                                  (int64_t)(-std::log(1 - bench_uniform()) * HOST_MEAN_DELAY_US);
+                if (arrival < last_arrival) {
+                    arrival = last_arrival;
+                }
+                last_arrival = arrival;
+                notes.push_back({arrival, device, begin, (uint32_t)cap.bytes.size()});
+            }
+            last_event = event;
+        }
+        t += FRAME_INTERVAL_US + (int64_t)(bench_rand() % (2 * FRAME_JITTER_US + 1)) -
+             FRAME_JITTER_US;
+    }
+}
+
+static void bench_generate(unsigned devices, int64_t seconds, std::vector<device_capture> &caps,
+                           std::vector<notification> &notes)
+{
+    caps.assign(devices, device_capture());
+    notes.clear();
+    for (unsigned d = 0; d < devices; d++) {
+        bench_device((uint16_t)d, seconds, caps[d], notes);
+    }
+    std::stable_sort(notes.begin(), notes.end(),
+                     [](const notification &a, const notification &b) {
+                         return a.arrival_us < b.arrival_us;
+                     });
+}
+
+static int64_t bench_percentile(std::vector<int64_t> &v, double p)
+{
+    if (v.empty()) {
+        return 0;
+    }
+    size_t k = (size_t)(p * (double)(v.size() - 1));
+    std::nth_element(v.begin(), v.begin() + (ptrdiff_t)k, v.end());
+    return v[k];
+}
+
+/* Decode and merge in arrival order, checking the output as it comes */
+static void bench_check(const std::vector<device_capture> &caps,
+                        const std::vector<notification> &notes, sf::align_mode mode,
+                        run_result &r)
+{
+    sf::merge_options opts;
+    opts.mode = mode;
+    sf::merger merge(opts);
+    std::vector<sf::decoder> dec(caps.size());
+    std::vector<int64_t> errors;
+    std::vector<sf::merged_sample> out;
+    sf::columns cols;
+    int64_t last_t = INT64_MIN;
+
+    for (size_t d = 0; d < caps.size(); d++) {
+        merge.add_device();
+    }
+    r.samples = 0;
+    r.ordered = true;
+    r.latency_us.clear();
+
+    auto consume = [&](int64_t now_us) {
+        for (const sf::merged_sample &s : out) {
+            int64_t truth = caps[s.device].true_us[(uint32_t)s.v[0]];
+            r.ordered = r.ordered && s.t_us >= last_t;
+            last_t = s.t_us;
+            r.latency_us.push_back(now_us - s.arrival_us);
+            if (truth >= WARMUP_US &&
+                (mode == sf::align_mode::arrival || (s.flags & SF_MERGED_SENSOR_TIME))) {
+                errors.push_back(s.t_us - truth);
+            }
+        }
+        out.clear();
+    };
+
+    for (const notification &n : notes) {
+        (void)dec[n.device].feed(&caps[n.device].bytes[n.begin], n.end - n.begin, cols);
+        r.samples += cols.quat.size() + cols.mag.size() + cols.linear_accel.size();
+        merge.push_columns(n.device, cols, n.arrival_us, out);
+        cols.clear();
+        consume(n.arrival_us);
+    }
+    merge.flush(out);
+    consume(notes.empty() ? 0 : notes.back().arrival_us);
+
+    r.stats = merge.stats();
+    r.bias_us = (double)bench_percentile(errors, 0.5);
+    for (int64_t &e : errors) {
+        e = std::llabs(e - (int64_t)r.bias_us);
+    }
+    r.spread_p99_us = (double)bench_percentile(errors, 0.99);
+}
+
+/* ns per sample: decode + merge, then merge alone on pre-decoded samples */
+static void bench_time(const std::vector<device_capture> &caps,
+                       const std::vector<notification> &notes, double &full_ns,
+                       double &merge_ns)
+{
+    sf::merger merge;
+    std::vector<sf::decoder> dec(caps.size());
+    std::vector<sf::merged_sample> out;
+    std::vector<pending_sample> pending;
+    sf::columns cols;
+    uint64_t samples = 0;
+
+    for (size_t d = 0; d < caps.size(); d++) {
+        merge.add_device();
+    }
+    out.reserve(4096);
+
+    uint64_t start_ns = bench_time_ns();
+    for (const notification &n : notes) {
+        (void)dec[n.device].feed(&caps[n.device].bytes[n.begin], n.end - n.begin, cols);
+        samples += cols.quat.size() + cols.mag.size() + cols.linear_accel.size();
+        merge.push_columns(n.device, cols, n.arrival_us, out);
+        cols.clear();
+        out.clear();
+    }
+    merge.flush(out);
+    full_ns = (double)(bench_time_ns() - start_ns) / (double)(samples ? samples : 1);
+
+    /* Same pushes without the decoder */
+    for (sf::decoder &d : dec) {
+        d.reset();
+    }
+    for (const notification &n : notes) {
+        (void)dec[n.device].feed(&caps[n.device].bytes[n.begin], n.end - n.begin, cols);
+        for (size_t i = 0; i < cols.quat.size(); i++) {
+            pending.push_back({n.arrival_us, cols.quat.timestamp_us[i], n.device,
+                               SF_TYPE_QUATERNION, cols.quat.timed[i],
+                               {cols.quat.w[i], cols.quat.x[i], cols.quat.y[i], cols.quat.z[i]}});
+        }
+        const sf::vec3_columns *vc[2] = {&cols.mag, &cols.linear_accel};
+        const uint8_t vt[2] = {SF_TYPE_MAGNETOMETER, SF_TYPE_LINEAR_ACCEL};
+        for (int k = 0; k < 2; k++) {
+            for (size_t i = 0; i < vc[k]->size(); i++) {
+                pending.push_back({n.arrival_us, vc[k]->timestamp_us[i], n.device, vt[k],
+                                   vc[k]->timed[i], {vc[k]->x[i], vc[k]->y[i], vc[k]->z[i], 0}});
+            }
+        }
+        cols.clear();
+    }
+
+    merge.reset();
+    out.clear();
+    start_ns = bench_time_ns();
+    for (const pending_sample &p : pending) {
+        merge.push(p.device, p.type, p.timed != 0, p.sensor_us, p.arrival_us, p.v, 4, out);
+        out.clear();
+    }
+    merge.flush(out);
+    merge_ns = (double)(bench_time_ns() - start_ns) /
+               (double)(pending.empty() ? 1 : pending.size());
+}
+
+static bool bench_write_logs(const std::string &dir, const std::vector<device_capture> &caps,
+                             const std::vector<notification> &notes)
+{
+    std::vector<std::vector<uint8_t>> logs(caps.size());
+
+    for (std::vector<uint8_t> &log : logs) {
+        sf::log_begin(log);
+    }
+    for (const notification &n : notes) {
+        sf::log_append(logs[n.device], n.arrival_us, SF_LOG_STREAM, &caps[n.device].bytes[n.begin],
+                       (uint16_t)(n.end - n.begin));
+    }
+    for (size_t d = 0; d < logs.size(); d++) {
+        std::string path = dir + "/dev" + std::to_string(d) + ".sflog";
+        FILE *f = fopen(path.c_str(), "wb");
+        if (!f || fwrite(logs[d].data(), 1, logs[d].size(), f) != logs[d].size()) {
+            perror(path.c_str());
+            if (f) {
+                fclose(f);
+            }
+            return false;
+        }
+        fclose(f);
+    }
+    return true;
+}
+
+/*******************************************************************************
+ * Main
+ ******************************************************************************/
+
+int main(int argc, char **argv)
+{
+    std::vector<unsigned> counts;
+    std::vector<device_capture> caps;
+    std::vector<notification> notes;
+    const char *logs = NULL;
+    int64_t seconds = BENCH_DEFAULT_SECONDS;
+    int arg = 1;
+    bool ok = true;
+
+    if (argc > 2 && strcmp(argv[1], "--logs") == 0) {
+        logs = argv[2];
+        arg = 3;
+    }
+    if (arg < argc) {
+        seconds = strtol(argv[arg++], NULL, 0);
+    }
+    for (; arg < argc; arg++) {
+        counts.push_back((unsigned)strtoul(argv[arg], NULL, 0));
+    }
+    if (counts.empty()) {
+        counts = {1, 4, 10, 16, 32};
+    }
+    if (seconds <= 0) {
+        fprintf(stderr, "seconds must be positive\n");
+        return 1;
+    }
+
+    printf("%lld s per device, 600 samples/s, max delay %d ms, ring %d samples\n\n",
+           (long long)seconds, SF_MERGE_DEFAULT_MAX_DELAY / 1000, SF_MERGE_DEFAULT_CAPACITY);
+    printf("devices   samples   late  forced  timed-out | align bias/p99 us: sensor  arrival"
+           " | latency ms p50   p99   max | ns/sample merge  +decode\n");
+
+    for (unsigned devices : counts) {
+        run_result sensor, arrival;
+        double full_ns, merge_ns;
+
+        if (devices == 0 || devices > 65535) {
+            fprintf(stderr, "device count out of range: %u\n", devices);
+            return 1;
+        }
+        bench_generate(devices, seconds, caps, notes);
+        bench_check(caps, notes, sf::align_mode::sensor, sensor);
+        bench_check(caps, notes, sf::align_mode::arrival, arrival);
+        bench_time(caps, notes, full_ns, merge_ns);
+
+        int64_t p50 = bench_percentile(sensor.latency_us, 0.5);
+        int64_t p99 = bench_percentile(sensor.latency_us, 0.99);
+        int64_t max = bench_percentile(sensor.latency_us, 1.0);
+
+        printf("%7u %9llu %6llu %7llu %10llu | %12.0f/%-5.0f %8.0f/%-5.0f | %14.1f %5.1f %5.1f |"
+               " %15.1f %8.1f\n",
+               devices, (unsigned long long)sensor.samples, (unsigned long long)sensor.stats.late,
+               (unsigned long long)sensor.stats.forced, (unsigned long long)sensor.stats.timed_out,
+               sensor.bias_us, sensor.spread_p99_us, arrival.bias_us, arrival.spread_p99_us,
+               p50 / 1000.0, p99 / 1000.0, max / 1000.0, merge_ns, full_ns);
+
+        const run_result *runs[2] = {&sensor, &arrival};
+        for (const run_result *r : runs) {
+            if (!r->ordered || r->stats.in != r->samples ||
+                r->stats.out + r->stats.late != r->stats.in) {
+                fprintf(stderr, "%u devices: merged stream out of order or samples unaccounted "
+                        "(in %llu, out %llu, late %llu)\n", devices,
+                        (unsigned long long)r->stats.in, (unsigned long long)r->stats.out,
+                        (unsigned long long)r->stats.late);
+                ok = false;
+            }
+        }
+        if (!(sensor.spread_p99_us <= SF_BENCH_MAX_SPREAD)) {
+            fprintf(stderr, "%u devices: sensor alignment p99 %.0f us above %d us\n", devices,
+                    sensor.spread_p99_us, SF_BENCH_MAX_SPREAD);
+            ok = false;
+        }
+    }
+
+    if (logs && !bench_write_logs(logs, caps, notes)) {
+        return 1;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,231 @@
+/**
+ * @file passthrough_decoder.c
+ * @brief Host-side decoder for the raw SHTP passthrough characteristic
+ *
+ * Citations:
+ * - FIRMWARE_DESIGN.md Section "BNO085 Report Types Available"
+ * - BNO08x Datasheet: SH-2 input report formats and Q-points
+ */
+
+#include "passthrough_decoder.h"
+#include "shtp.h"
+#include "shtp_passthrough.h"
+#include <string.h>
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+/* Timebase records that may precede reports on channel 3 */
+#define SH2_BASE_TIMESTAMP          0xFB
+#define SH2_TIMESTAMP_REBASE        0xFA
+#define SH2_TIMEBASE_LEN            5
+
+/* Gyro-integrated rotation vector on channel 5: bare i,j,k,real (Q14) and
+ * angular velocity x,y,z (Q10), no report header */
+#define GIRV_LEN                    14
+#define GIRV_Q_ANGVEL               10
+
+/**
+ * @brief Payload layout of a report
+ */
+typedef struct {
+    uint8_t len;                /* Bytes including the 5-byte header */
+    uint8_t q;                  /* Q-point of the 16-bit values */
+    uint8_t count;              /* 16-bit values after the header */
+} pt_layout_t;
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+static inline int16_t pt_s16(const uint8_t *p)
+{
+    return (int16_t)(p[0] | (p[1] << 8));
+}
+
+static bool pt_layout(uint8_t report_id, pt_layout_t *layout)
+{
+    switch (report_id) {
+        case SH2_ROTATION_VECTOR:
+        case SH2_GEOMAGNETIC_ROTATION:
+        case SH2_ARVR_STABILIZED_RV:
+            *layout = (pt_layout_t){ 15, SHTP_Q_ROTATION_VECTOR, 4 };   /* + accuracy */
+            return true;
+        case SH2_GAME_ROTATION_VECTOR:
+        case SH2_ARVR_STABILIZED_GRV:
+            *layout = (pt_layout_t){ 13, SHTP_Q_ROTATION_VECTOR, 4 };
+            return true;
+        case SH2_ACCELEROMETER:
+        case SH2_LINEAR_ACCELERATION:
+        case SH2_GRAVITY:
+            *layout = (pt_layout_t){ 11, SHTP_Q_ACCELEROMETER, 3 };
+            return true;
+        case SH2_GYROSCOPE:
+            *layout = (pt_layout_t){ 11, SHTP_Q_GYROSCOPE, 3 };
+            return true;
+        case SH2_MAGNETOMETER:
+            *layout = (pt_layout_t){ 11, SHTP_Q_MAGNETOMETER, 3 };
+            return true;
+        case SH2_STEP_COUNTER:
+            *layout = (pt_layout_t){ 12, 0, 0 };
+            return true;
+        case SH2_STABILITY_CLASSIFIER:
+            *layout = (pt_layout_t){ 6, 0, 0 };
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Decode one report at p (length already checked)
+ */
+static void pt_decode_report(const uint8_t *p, const pt_layout_t *layout,
+                             pt_report_t *report)
+{
+    report->report_id = p[0];
+    report->sequence = p[1];
+    report->accuracy = p[2] & 0x03;
+    report->value_count = layout->count;
+
+    for (uint8_t i = 0; i < layout->count; i++) {
+        report->value[i] = SHTP_Q_TO_FLOAT(pt_s16(&p[5 + 2 * i]), layout->q);
+    }
+
+    switch (report->report_id) {
+        case SH2_ROTATION_VECTOR:
+        case SH2_GEOMAGNETIC_ROTATION:
+        case SH2_ARVR_STABILIZED_RV:
+            report->value[4] = SHTP_Q_TO_FLOAT(pt_s16(&p[13]), SHTP_Q_ACCURACY);
+            report->value_count = 5;
+            break;
+        case SH2_STEP_COUNTER:
+            report->value[0] = (float)((uint32_t)p[5] | ((uint32_t)p[6] << 8) |
+                                       ((uint32_t)p[7] << 16) | ((uint32_t)p[8] << 24));
+            report->value_count = 1;
+            break;
+        case SH2_STABILITY_CLASSIFIER:
+            report->value[0] = (float)p[5];
+            report->value_count = 1;
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Walk the reports in one record's cargo
+ * @return Reports delivered
+ */
+static int pt_decode_cargo(const uint8_t *cargo, uint8_t len, pt_report_t *report,
+                           pt_report_cb_t cb, void *ctx, pt_decoder_stats_t *stats)
+{
+    int count = 0;
+    uint16_t pos = 0;
+
+    if (report->channel == SHTP_CHANNEL_GYRO_RV) {
+        if (len < GIRV_LEN) {
+            return 0;
+        }
+        report->report_id = SH2_GYRO_INTEGRATED_RV;
+        report->sequence = 0;
+        report->accuracy = 0;
+        report->value_count = 7;
+        for (uint8_t i = 0; i < 4; i++) {
+            report->value[i] = SHTP_Q_TO_FLOAT(pt_s16(&cargo[2 * i]), SHTP_Q_ROTATION_VECTOR);
+        }
+        for (uint8_t i = 0; i < 3; i++) {
+            report->value[4 + i] = SHTP_Q_TO_FLOAT(pt_s16(&cargo[8 + 2 * i]), GIRV_Q_ANGVEL);
+        }
+        if (cb != NULL) {
+            cb(report, ctx);
+        }
+        return 1;
+    }
+
+    while (pos < len) {
+        uint8_t id = cargo[pos];
+        pt_layout_t layout;
+
+        if (id == SH2_BASE_TIMESTAMP || id == SH2_TIMESTAMP_REBASE) {
+            pos += SH2_TIMEBASE_LEN;
+            continue;
+        }
+
+        if (!pt_layout(id, &layout) || pos + layout.len > len) {
+            if (stats != NULL) {
+                stats->unknown++;
+            }
+            break;
+        }
+
+        pt_decode_report(&cargo[pos], &layout, report);
+        if (cb != NULL) {
+            cb(report, ctx);
+        }
+        count++;
+        pos += layout.len;
+    }
+
+    return count;
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+int pt_decode(const uint8_t *data, uint16_t len, pt_report_cb_t cb, void *ctx,
+              pt_decoder_stats_t *stats)
+{
+    pt_report_t report;
+    uint16_t pos = 0;
+    int count = 0;
+
+    if (stats != NULL) {
+        stats->notifications++;
+    }
+
+    while (pos + SHTP_PT_RECORD_HEADER_SIZE <= len) {
+        const uint8_t *record = &data[pos];
+        uint8_t cargo_len = record[SHTP_PT_LENGTH];
+
+        if (pos + SHTP_PT_RECORD_HEADER_SIZE + cargo_len > len) {
+            break;
+        }
+
+        memset(&report, 0, sizeof(report));
+        report.channel = record[SHTP_PT_CHANNEL];
+        report.timestamp_us = shtp_pt_get_timestamp(record);
+
+        count += pt_decode_cargo(&record[SHTP_PT_RECORD_HEADER_SIZE], cargo_len,
+                                 &report, cb, ctx, stats);
+        if (stats != NULL) {
+            stats->records++;
+        }
+        pos += SHTP_PT_RECORD_HEADER_SIZE + cargo_len;
+    }
+
+    if (stats != NULL) {
+        stats->reports += (uint32_t)count;
+    }
+
+    if (pos != len) {
+        if (stats != NULL) {
+            stats->truncated++;
+        }
+        return PT_DECODE_ERR_TRUNCATED;
+    }
+
+    return count;
+}
+
+uint8_t pt_report_length(uint8_t report_id)
+{
+    pt_layout_t layout;
+
+    if (report_id == SH2_BASE_TIMESTAMP || report_id == SH2_TIMESTAMP_REBASE) {
+        return SH2_TIMEBASE_LEN;
+    }
+    return pt_layout(report_id, &layout) ? layout.len : 0;
+}
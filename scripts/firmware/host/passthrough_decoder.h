@@ -0,0 +1,101 @@
+/**
+ * @file passthrough_decoder.h
+ * @brief Host-side decoder for the raw SHTP passthrough characteristic
+ *
+ * Takes notification payloads in the format of shtp_passthrough.h and
+ * turns the forwarded SHTP cargo into SH-2 reports with the Q-points
+ * applied. Plain C with no firmware dependencies beyond shtp.h and
+ * shtp_passthrough.h, so it can be linked into any host tool.
+ *
+ * Report offsets follow bno085.c: values start after the common 5-byte
+ * report header (report ID, sequence, status, delay). Timebase records
+ * (0xFB base timestamp, 0xFA rebase) are skipped; a report ID the decoder
+ * has no length for ends the walk of that record, as the remaining bytes
+ * cannot be delimited.
+ *
+ * Citations:
+ * - FIRMWARE_DESIGN.md Section "BNO085 Report Types Available"
+ * - BNO08x Datasheet: SH-2 input report formats and Q-points
+ */
+
+#ifndef PASSTHROUGH_DECODER_H
+#define PASSTHROUGH_DECODER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define PT_DECODE_OK                0
+#define PT_DECODE_ERR_TRUNCATED     -1      /* Record runs past the payload */
+
+#define PT_REPORT_MAX_VALUES        7
+
+/*******************************************************************************
+ * Data Structures
+ ******************************************************************************/
+
+/**
+ * @brief One decoded SH-2 report
+ */
+typedef struct {
+    uint32_t timestamp_us;      /* Device receive time of the SHTP packet */
+    uint8_t  channel;           /* SHTP channel */
+    uint8_t  report_id;         /* SH-2 report ID */
+    uint8_t  sequence;          /* Report sequence number */
+    uint8_t  accuracy;          /* Status bits 1:0 */
+    uint8_t  value_count;       /* Entries used in value[] */
+    float    value[PT_REPORT_MAX_VALUES]; /* Quaternion i,j,k,real[,acc] or x,y,z */
+} pt_report_t;
+
+/**
+ * @brief Decoder counters (accumulated across calls)
+ */
+typedef struct {
+    uint32_t notifications;     /* Payloads passed to pt_decode() */
+    uint32_t records;           /* Passthrough records */
+    uint32_t reports;           /* Reports delivered to the callback */
+    uint32_t unknown;           /* Records cut short by an unknown report ID */
+    uint32_t truncated;         /* Payloads with a record past the end */
+} pt_decoder_stats_t;
+
+/**
+ * @brief Called once per decoded report
+ */
+typedef void (*pt_report_cb_t)(const pt_report_t *report, void *ctx);
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Decode one passthrough notification
+ * @param data  Notification payload
+ * @param len   Payload length
+ * @param cb    Report callback (may be NULL to only count)
+ * @param ctx   Passed to cb
+ * @param stats Counters to update (may be NULL)
+ * @return Number of reports decoded, or PT_DECODE_ERR_TRUNCATED (reports
+ *         before the bad record have already been delivered)
+ */
+int pt_decode(const uint8_t *data, uint16_t len, pt_report_cb_t cb, void *ctx,
+              pt_decoder_stats_t *stats);
+
+/**
+ * @brief Length of an SH-2 report including its 5-byte header
+ * @param report_id SH-2 report ID
+ * @return Length in bytes, 0 if unknown
+ */
+uint8_t pt_report_length(uint8_t report_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PASSTHROUGH_DECODER_H */
@@ -0,0 +1,220 @@
+/**
+ * @file pipeline_bench.c
+ * @brief Host benchmark for the per-sample firmware path
+ *
+ * Runs bno085_init, the IMU GATT service and imu_pipeline against the
+ * simulated sensor and SoftDevice stand-in, then times the loop main.c
+ * runs per sample: imu_pipeline_poll + imu_pipeline_notify.
+ *
+ * Usage: pipeline_bench [samples] [raw]
+ *
+ * With "raw" the central enables the passthrough characteristic instead of
+ * the sensor characteristics, so the loop forwards SHTP cargo undecoded.
+ * The warm-up notifications are run through passthrough_decoder to check
+ * that every forwarded record decodes.
+ *
+ * Host timings compare build configurations (-O2 / LTO / PGO) with each
+ * other; they are not Cortex-M4 cycle counts. On target, read the
+ * s_sample_cycles statistics of a PERF=1 build (CONFIG_PERF_CYCLE_STATS).
+ */
+
+#include "host_hal.h"
+#include "bno085.h"
+#include "ble_imu_service.h"
+#include "imu_pipeline.h"
+#include "dma_pool.h"
+#include "passthrough_decoder.h"
+#include "config.h"
+#include "nrf_error.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+#define BENCH_DEFAULT_SAMPLES   2000000UL
+#define BENCH_WARMUP_SAMPLES    10000UL
+
+/*******************************************************************************
+ * Private Variables
+ ******************************************************************************/
+
+static bno085_t s_imu;
+static ble_imu_service_t s_imu_service;
+static imu_pipeline_t s_pipeline;
+
+static bool s_raw_mode = false;
+static pt_decoder_stats_t s_decode_stats;
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+static void imu_service_evt_handler(const ble_imu_evt_t *p_evt)
+{
+    (void)p_evt;
+}
+
+static void bench_hvx_hook(uint16_t handle, const uint8_t *p_data, uint16_t len)
+{
+    if (handle == s_imu_service.raw_handles.value_handle) {
+        (void)pt_decode(p_data, len, NULL, NULL, &s_decode_stats);
+    }
+}
+
+static void bench_connect(void)
+{
+    ble_evt_t evt;
+
+    memset(&evt, 0, sizeof(evt));
+    evt.header.evt_id = BLE_GAP_EVT_CONNECTED;
+    evt.evt.gap_evt.conn_handle = 0;
+    host_ble_evt_dispatch(&evt);
+
+    memset(&evt, 0, sizeof(evt));
+    evt.header.evt_id = BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST;
+    evt.evt.gatts_evt.conn_handle = 0;
+    evt.evt.gatts_evt.params.exchange_mtu_request.client_rx_mtu = BLE_GATT_ATT_MTU_MAX;
+    host_ble_evt_dispatch(&evt);
+
+    if (s_raw_mode) {
+        /* As if the central wrote 0x0001 to the passthrough CCCD */
+        s_imu_service.raw_notify_enabled = true;
+        return;
+    }
+
+    /* As if the central wrote 0x0001 to every sensor CCCD */
+    for (uint32_t i = 0; i < BLE_IMU_SENSOR_COUNT; i++) {
+        s_imu_service.sensor_notify_enabled[i] = true;
+        imu_pipeline_mark_dirty(&s_pipeline, (ble_imu_sensor_t)i);
+    }
+}
+
+/**
+ * @brief Check that every record forwarded during warm-up was decoded
+ * @return 0 if the decoder saw every record not still being coalesced
+ */
+static int bench_check_raw(void)
+{
+    const imu_pipeline_raw_stats_t *raw = &s_pipeline.raw_stats;
+    pt_decoder_stats_t pending;
+
+    memset(&pending, 0, sizeof(pending));
+    (void)pt_decode(s_pipeline.raw, s_pipeline.raw_len, NULL, NULL, &pending);
+
+    printf("passthrough: %lu records in %lu notifications, %lu dropped, %lu skipped\n",
+           (unsigned long)raw->records, (unsigned long)raw->notifications,
+           (unsigned long)raw->dropped, (unsigned long)raw->skipped);
+    printf("decoder: %lu records, %lu reports, %lu unknown, %lu truncated\n",
+           (unsigned long)s_decode_stats.records, (unsigned long)s_decode_stats.reports,
+           (unsigned long)s_decode_stats.unknown, (unsigned long)s_decode_stats.truncated);
+
+    if (s_decode_stats.records + pending.records != raw->records ||
+        s_decode_stats.reports != s_decode_stats.records ||
+        s_decode_stats.truncated != 0) {
+        fprintf(stderr, "passthrough decode mismatch\n");
+        return 1;
+    }
+    return 0;
+}
+
+static int bench_run(unsigned long samples, unsigned long *reports)
+{
+    unsigned long count = 0;
+
+    for (unsigned long i = 0; i < samples; i++) {
+        int report = imu_pipeline_poll(&s_pipeline);
+
+        if (report < 0) {
+            fprintf(stderr, "imu_pipeline_poll failed: %d\n", report);
+            return report;
+        }
+        if (report > 0) {
+            imu_pipeline_notify(&s_pipeline);
+            count++;
+        }
+    }
+
+    *reports = count;
+    return 0;
+}
+
+/*******************************************************************************
+ * Main
+ ******************************************************************************/
+
+int main(int argc, char **argv)
+{
+    unsigned long samples = BENCH_DEFAULT_SAMPLES;
+    unsigned long reports;
+    uint64_t start_ns, elapsed_ns;
+    const host_sd_stats_t *stats;
+    uint32_t err_code;
+    int result;
+
+    if (argc > 1) {
+        samples = strtoul(argv[1], NULL, 0);
+    }
+    if (argc > 2 && strcmp(argv[2], "raw") == 0) {
+        s_raw_mode = true;
+    }
+
+    dma_pool_init();
+
+    result = imu_pipeline_init(&s_pipeline, &s_imu, &s_imu_service);
+    if (result != BNO085_OK) {
+        fprintf(stderr, "imu_pipeline_init failed: %d\n", result);
+        return 1;
+    }
+
+    result = bno085_init(&s_imu);
+    if (result != BNO085_OK) {
+        fprintf(stderr, "bno085_init failed: %d\n", result);
+        return 1;
+    }
+
+    result = imu_pipeline_enable_reports(&s_pipeline, CONFIG_BNO085_REPORT_RATE_US);
+    if (result != BNO085_OK) {
+        fprintf(stderr, "imu_pipeline_enable_reports failed: %d\n", result);
+        return 1;
+    }
+
+    err_code = ble_imu_service_init(&s_imu_service, NULL, imu_service_evt_handler);
+    if (err_code != NRF_SUCCESS) {
+        fprintf(stderr, "ble_imu_service_init failed: 0x%08lX\n",
+                (unsigned long)err_code);
+        return 1;
+    }
+
+    bench_connect();
+
+    if (s_raw_mode) {
+        host_sd_hvx_hook_set(bench_hvx_hook);
+    }
+    if (bench_run(BENCH_WARMUP_SAMPLES, &reports) != 0) {
+        return 1;
+    }
+    if (s_raw_mode) {
+        host_sd_hvx_hook_set(NULL);
+        if (bench_check_raw() != 0) {
+            return 1;
+        }
+    }
+
+    start_ns = host_time_ns();
+    if (bench_run(samples, &reports) != 0) {
+        return 1;
+    }
+    elapsed_ns = host_time_ns() - start_ns;
+
+    stats = host_sd_stats();
+    printf("sensor fw %u.%u.%u, %lu reports, %lu notifications (checksum %08lX)\n",
+           s_imu.sw_version_major, s_imu.sw_version_minor, s_imu.sw_version_patch,
+           reports, (unsigned long)stats->notifications,
+           (unsigned long)stats->notify_checksum);
+    printf("%.2f ns/sample\n", (double)elapsed_ns / (double)samples);
+
+    return 0;
+}
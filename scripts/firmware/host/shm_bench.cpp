@@ -0,0 +1,381 @@
+/**
+ * @file shm_bench.cpp
+ * @brief Reader latency and throughput of the shared-memory ring (stream_shm.hpp)
+ *
+ * One publisher and R subscriber processes share a segment. Each sample
+ * carries its own index, so subscribers check every copy for tearing
+ * (payload not matching the index), order and loss against lost().
+ * Every SAMPLE_LATEST_EVERY samples they also read a latest-value slot
+ * and check it is intact. For each reader count it runs:
+ *   - paced: BENCH_RATE samples/s (10 devices x Q/M/A at 200 Hz), idle
+ *     and again with one busy-looping process per CPU. Readers spin
+ *     READER_SPINS polls, then sleep READER_SLEEP_NS between polls.
+ *     Latency is the time from publish to copied out. Nothing may be
+ *     lost at this rate;
+ *   - burst: BENCH_BURST samples as fast as the publisher can write,
+ *     readers spinning. Reports publisher and reader ns/sample, and how
+ *     much readers lost when they could not keep up (on fewer CPUs than
+ *     processes they get lapped; that is allowed, tearing is not).
+ *
+ * Usage: shm_bench [seconds [readers...]]
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "stream_shm.hpp"
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <sys/wait.h>
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+#define BENCH_DEFAULT_SECONDS   5           /* Per paced run */
+#define BENCH_DEVICES           10
+#define BENCH_RATE              6000        /* Samples/s, paced */
+#define BENCH_BURST             (1u << 22)  /* Samples, burst */
+#define BENCH_SLOTS             65536
+
+#define READER_SPINS            20000
+#define READER_SLEEP_NS         20000
+#define READER_BATCH            256
+#define SAMPLE_LATEST_EVERY     64
+#define VALUE_MASK              0xFFFFF     /* Exact in a float */
+
+/**
+ * @brief What a subscriber process reports back
+ */
+struct reader_result {
+    uint64_t samples;
+    uint64_t lost;
+    uint64_t errors;            /* Torn, out of order or loss not reported */
+    uint64_t latest_reads;
+    uint64_t latest_errors;
+    uint64_t elapsed_ns;        /* First sample to end */
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+    uint64_t max_ns;
+};
+
+/*******************************************************************************
+ * Private Variables
+ ******************************************************************************/
+
+static const uint8_t s_types[3] = {SF_TYPE_QUATERNION, SF_TYPE_MAGNETOMETER,
+                                   SF_TYPE_LINEAR_ACCEL};
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+static sf::merged_sample bench_sample(uint64_t i)
+{
+    sf::merged_sample s;
+
+    s.t_us = (int64_t)i;
+    s.arrival_us = (int64_t)i;
+    s.device = (uint16_t)(i % BENCH_DEVICES);
+    s.type = s_types[(i / BENCH_DEVICES) % 3];
+    s.flags = SF_MERGED_SENSOR_TIME;
+    for (unsigned k = 0; k < 4; k++) {
+        s.v[k] = (float)((i + k) & VALUE_MASK);
+    }
+    return s;
+}
+
+static bool bench_intact(const sf::merged_sample &s)
+{
+    uint64_t i = (uint64_t)s.t_us;
+
+    if (s.arrival_us != s.t_us || s.device != i % BENCH_DEVICES ||
+        s.type != s_types[(i / BENCH_DEVICES) % 3]) {
+        return false;
+    }
+    for (unsigned k = 0; k < 4; k++) {
+        if (s.v[k] != (float)((i + k) & VALUE_MASK)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint64_t bench_percentile(std::vector<uint64_t> &v, double p)
+{
+    if (v.empty()) {
+        return 0;
+    }
+    size_t k = (size_t)(p * (double)(v.size() - 1));
+    std::nth_element(v.begin(), v.begin() + (long)k, v.end());
+    return v[k];
+}
+
+/* Subscriber process: read until the publisher closes, report, exit */
+static void bench_reader(const char *name, bool paced, int ready_fd, int result_fd)
+{
+    sf::shm_subscriber sub;
+    reader_result r = {};
+    std::vector<uint64_t> latency;
+    sf::merged_sample buf[READER_BATCH];
+    uint64_t ns[READER_BATCH];
+    uint64_t expected = 0, gaps = 0, first_ns = 0, last_ns = 0;
+
+    if (!sub.open(name)) {
+        perror("shm_bench: subscriber");
+        _exit(1);
+    }
+    if (paced) {
+        latency.reserve((size_t)BENCH_RATE * 64);
+    }
+    if (write(ready_fd, "r", 1) != 1) {
+        _exit(1);
+    }
+
+    for (;;) {
+        if (!sub.wait(paced ? READER_SPINS : ~0u, READER_SLEEP_NS)) {
+            if (sub.ended()) {
+                break;
+            }
+            continue;
+        }
+        size_t n = sub.read(buf, READER_BATCH, ns);
+        uint64_t now = sf::detail::monotonic_ns();
+        if (n == 0) {
+            continue;
+        }
+        if (first_ns == 0) {
+            first_ns = now;
+        }
+        last_ns = now;
+
+        /* Indices only go up; every skip must be counted in lost() */
+        for (size_t k = 0; k < n; k++) {
+            if (!bench_intact(buf[k]) || (uint64_t)buf[k].t_us < expected) {
+                r.errors++;
+            } else {
+                gaps += (uint64_t)buf[k].t_us - expected;
+                expected = (uint64_t)buf[k].t_us + 1;
+            }
+            if (paced) {
+                latency.push_back(now - ns[k]);
+            }
+            if (++r.samples % SAMPLE_LATEST_EVERY == 0) {
+                sf::merged_sample s;
+                unsigned d = (unsigned)(r.samples / SAMPLE_LATEST_EVERY) % BENCH_DEVICES;
+                uint8_t t = s_types[(r.samples / SAMPLE_LATEST_EVERY / BENCH_DEVICES) % 3];
+                if (sub.latest(d, t, s)) {
+                    r.latest_reads++;
+                    if (!bench_intact(s) || s.device != d || s.type != t) {
+                        r.latest_errors++;
+                    }
+                }
+            }
+        }
+    }
+    if (gaps != sub.lost()) {
+        r.errors++;
+    }
+
+    r.lost = sub.lost();
+    r.elapsed_ns = last_ns - first_ns;
+    r.p50_ns = bench_percentile(latency, 0.50);
+    r.p99_ns = bench_percentile(latency, 0.99);
+    r.p999_ns = bench_percentile(latency, 0.999);
+    r.max_ns = latency.empty() ? 0 : *std::max_element(latency.begin(), latency.end());
+    if (write(result_fd, &r, sizeof(r)) != (ssize_t)sizeof(r)) {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+/* Busy loop until killed */
+static void bench_load(void)
+{
+    volatile uint64_t x = 0;
+
+    for (;;) {
+        x = x * 6364136223846793005ULL + 1;
+    }
+}
+
+/**
+ * @brief One run: publish, collect every reader's result
+ * @return false if a reader found a torn or misordered sample, or lost
+ *         samples in a paced run
+ */
+static bool bench_run(unsigned readers, bool paced, bool loaded, double seconds)
+{
+    char name[64];
+    int ready[2], result[2];
+    std::vector<pid_t> children;
+    sf::shm_publisher pub;
+
+    snprintf(name, sizeof(name), "/sf_shm_bench.%d", (int)getpid());
+    if (!pub.open(name, BENCH_SLOTS, BENCH_DEVICES)) {
+        perror("shm_bench: publisher");
+        return false;
+    }
+    if (pipe(ready) != 0 || pipe(result) != 0) {
+        perror("shm_bench: pipe");
+        return false;
+    }
+    fflush(stdout);
+
+    for (unsigned r = 0; r < readers; r++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            bench_reader(name, paced, ready[1], result[1]);
+        }
+        children.push_back(pid);
+    }
+    for (unsigned r = 0; r < readers; r++) {
+        char c;
+        if (read(ready[0], &c, 1) != 1) {
+            perror("shm_bench: reader start");
+            return false;
+        }
+    }
+    std::vector<pid_t> load;
+    long cpus = loaded ? sysconf(_SC_NPROCESSORS_ONLN) : 0;
+    for (long c = 0; c < cpus; c++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            bench_load();
+        }
+        load.push_back(pid);
+    }
+
+    uint64_t total = paced ? (uint64_t)(seconds * BENCH_RATE) : BENCH_BURST;
+    uint64_t start = sf::detail::monotonic_ns();
+    if (paced) {
+        struct timespec next;
+        clock_gettime(CLOCK_MONOTONIC, &next);
+        for (uint64_t i = 0; i < total; i++) {
+            next.tv_nsec += 1000000000L / BENCH_RATE;
+            if (next.tv_nsec >= 1000000000L) {
+                next.tv_nsec -= 1000000000L;
+                next.tv_sec++;
+            }
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+            pub.publish(bench_sample(i));
+        }
+    } else {
+        for (uint64_t i = 0; i < total; i++) {
+            pub.publish(bench_sample(i));
+        }
+    }
+    double pub_ns = (double)(sf::detail::monotonic_ns() - start) / (double)total;
+    pub.close();
+
+    for (pid_t pid : load) {
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+    }
+    bool ok = true;
+    reader_result sum = {};
+    std::vector<uint64_t> p50, p99, p999, max;
+    double read_ns = 0;
+    for (unsigned r = 0; r < readers; r++) {
+        reader_result rr;
+        if (read(result[0], &rr, sizeof(rr)) != (ssize_t)sizeof(rr)) {
+            fprintf(stderr, "shm_bench: reader failed\n");
+            ok = false;
+            break;
+        }
+        sum.samples += rr.samples;
+        sum.lost += rr.lost;
+        sum.errors += rr.errors;
+        sum.latest_reads += rr.latest_reads;
+        sum.latest_errors += rr.latest_errors;
+        p50.push_back(rr.p50_ns);
+        p99.push_back(rr.p99_ns);
+        p999.push_back(rr.p999_ns);
+        max.push_back(rr.max_ns);
+        if (rr.samples) {
+            read_ns += (double)rr.elapsed_ns / (double)rr.samples / readers;
+        }
+    }
+    for (pid_t pid : children) {
+        waitpid(pid, NULL, 0);
+    }
+    close(ready[0]);
+    close(ready[1]);
+    close(result[0]);
+    close(result[1]);
+
+    /* Worst reader's percentiles */
+    const char *mode = paced ? "paced" : "burst";
+    if (paced) {
+        printf("%7u  %-4s  %-5s  %9llu  %6llu  %8.1f  %8.1f  %9.1f  %8.1f\n", readers,
+               loaded ? "busy" : "idle", mode, (unsigned long long)sum.samples,
+               (unsigned long long)sum.lost,
+               *std::max_element(p50.begin(), p50.end()) / 1e3,
+               *std::max_element(p99.begin(), p99.end()) / 1e3,
+               *std::max_element(p999.begin(), p999.end()) / 1e3,
+               *std::max_element(max.begin(), max.end()) / 1e3);
+    } else {
+        printf("%7u  %-4s  %-5s  %9llu  %6llu  publish %.1f ns/sample, read %.1f ns/sample\n",
+               readers, "idle", mode, (unsigned long long)sum.samples,
+               (unsigned long long)sum.lost, pub_ns, read_ns);
+    }
+
+    if (sum.samples + sum.lost != (uint64_t)readers * total) {
+        fprintf(stderr, "FAIL: %llu read + %llu lost != %llu published x %u readers\n",
+                (unsigned long long)sum.samples, (unsigned long long)sum.lost,
+                (unsigned long long)total, readers);
+        ok = false;
+    }
+    if (sum.errors || sum.latest_errors) {
+        fprintf(stderr, "FAIL: %llu torn or misordered samples, %llu torn latest values\n",
+                (unsigned long long)sum.errors, (unsigned long long)sum.latest_errors);
+        ok = false;
+    }
+    if (paced && sum.lost) {
+        fprintf(stderr, "FAIL: readers lost %llu samples at %d samples/s\n",
+                (unsigned long long)sum.lost, BENCH_RATE);
+        ok = false;
+    }
+    return ok;
+}
+
+/*******************************************************************************
+ * Main
+ ******************************************************************************/
+
+int main(int argc, char **argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : BENCH_DEFAULT_SECONDS;
+    std::vector<unsigned> readers;
+    bool ok = true;
+
+    for (int i = 2; i < argc; i++) {
+        readers.push_back((unsigned)strtoul(argv[i], NULL, 0));
+    }
+    if (readers.empty()) {
+        readers = {1, 2, 4, 8};
+    }
+    if (seconds <= 0) {
+        fprintf(stderr, "usage: shm_bench [seconds [readers...]]\n");
+        return 1;
+    }
+
+    printf("%ld CPUs, %u slots of %zu bytes, %d samples/s paced\n",
+           sysconf(_SC_NPROCESSORS_ONLN), (unsigned)BENCH_SLOTS, sizeof(sf::shm_slot),
+           BENCH_RATE);
+    printf("readers  load  mode     samples    lost    p50 us    p99 us  p99.9 us    max us\n");
+    for (unsigned r : readers) {
+        if (r == 0) {
+            continue;
+        }
+        ok &= bench_run(r, true, false, seconds);
+        ok &= bench_run(r, true, true, seconds);
+        ok &= bench_run(r, false, false, seconds);
+    }
+    return ok ? 0 : 1;
+}
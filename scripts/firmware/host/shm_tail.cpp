@@ -0,0 +1,107 @@
+/**
+ * @file shm_tail.cpp
+ * @brief Print samples from a stream_merge --shm segment (stream_shm.hpp)
+ *
+ * Usage: shm_tail [--latest MS] NAME
+ *
+ * Without options, follows the ring and writes every sample published
+ * from now on as CSV (the same columns as stream_merge) until the
+ * publisher exits; samples it was too slow for are counted on stderr.
+ * With --latest, prints each device's latest quaternion every MS
+ * milliseconds instead, as a renderer would poll it.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "stream_shm.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+#define TAIL_BATCH              256
+#define TAIL_SPINS              1000
+#define TAIL_SLEEP_NS           200000
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+static void tail_follow(sf::shm_subscriber &sub)
+{
+    sf::merged_sample buf[TAIL_BATCH];
+
+    printf("t_us,device,type,sensor_time,v0,v1,v2,v3\n");
+    while (sub.wait(TAIL_SPINS, TAIL_SLEEP_NS)) {
+        size_t n;
+        while ((n = sub.read(buf, TAIL_BATCH)) > 0) {
+            for (size_t k = 0; k < n; k++) {
+                const sf::merged_sample &s = buf[k];
+                printf("%lld,%u,%c,%d,%.9g,%.9g,%.9g,%.9g\n", (long long)s.t_us, s.device,
+                       s.type, (s.flags & SF_MERGED_SENSOR_TIME) ? 1 : 0, s.v[0], s.v[1],
+                       s.v[2], s.v[3]);
+            }
+        }
+        fflush(stdout);
+    }
+}
+
+static void tail_latest(sf::shm_subscriber &sub, long period_ms)
+{
+    unsigned devices = sub.header()->devices;
+
+    while (!sub.header()->closed.load(std::memory_order_acquire)) {
+        for (unsigned d = 0; d < devices; d++) {
+            sf::merged_sample s;
+            uint64_t ns;
+            if (sub.latest(d, SF_TYPE_QUATERNION, s, &ns)) {
+                printf("device %u: t %lld us, q %+.4f %+.4f %+.4f %+.4f, %.1f ms old\n", d,
+                       (long long)s.t_us, s.v[0], s.v[1], s.v[2], s.v[3],
+                       (double)(sf::detail::monotonic_ns() - ns) / 1e6);
+            }
+        }
+        fflush(stdout);
+        struct timespec ts = {period_ms / 1000, (period_ms % 1000) * 1000000L};
+        nanosleep(&ts, nullptr);
+    }
+}
+
+/*******************************************************************************
+ * Main
+ ******************************************************************************/
+
+int main(int argc, char **argv)
+{
+    sf::shm_subscriber sub;
+    long latest_ms = 0;
+    const char *name = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--latest") == 0 && i + 1 < argc) {
+            latest_ms = strtol(argv[++i], NULL, 0);
+        } else {
+            name = argv[i];
+        }
+    }
+    if (!name || latest_ms < 0) {
+        fprintf(stderr, "usage: shm_tail [--latest MS] NAME\n");
+        return 1;
+    }
+    if (!sub.open(name)) {
+        fprintf(stderr, "shm_tail: %s: %s\n", name, strerror(errno));
+        return 1;
+    }
+
+    if (latest_ms > 0) {
+        tail_latest(sub, latest_ms);
+    } else {
+        tail_follow(sub);
+        fprintf(stderr, "shm_tail: publisher exited, %llu samples lost\n",
+                (unsigned long long)sub.lost());
+    }
+    return 0;
+}
@@ -0,0 +1,282 @@
+/**
+ * @file sim_bno085.c
+ * @brief Simulated BNO085 behind the TWIM API
+ *
+ * Implements twim_read/twim_write for the host build. The simulated sensor
+ * follows the exchange bno085.c performs on hardware:
+ * - RESET_COMPLETE advertisement on channel 0 after power-on or reset
+ * - Product ID response (0xF8) to a Product ID request (0xF9), channel 2
+ * - SET_FEATURE (0xFD) enables a report; enabled reports are then streamed
+ *   round-robin on channel 3 with the common 5-byte report header
+ *
+ * Each packet is read in two transfers, 4-byte header then payload, matching
+ * bno085_receive_packet(). Report values follow a slow deterministic ramp so
+ * runs are reproducible. Each report advances the simulated cycle counter by
+ * its share of CONFIG_BNO085_REPORT_RATE_US, so timestamps look like sensor
+ * time.
+ *
+ * Citations:
+ * - FIRMWARE_DESIGN.md Section "Initialization Sequence"
+ * - FIRMWARE_DESIGN.md Section "BNO085 Report Types Available"
+ */
+
+#include "host_hal.h"
+#include "twim.h"
+#include "bno085.h"
+#include "shtp.h"
+#include "board.h"
+#include "config.h"
+#include <string.h>
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+#define SIM_MAX_PACKET      64
+#define SIM_MAX_REPORTS     32
+
+typedef struct {
+    uint8_t  packet[SIM_MAX_PACKET];     /* Pending packet incl. SHTP header */
+    uint16_t packet_len;                /* 0 when nothing is pending */
+    bool     header_sent;               /* Header phase of two-phase read done */
+    uint8_t  seq[6];                    /* Outgoing sequence per channel */
+    uint8_t  reports[SIM_MAX_REPORTS];  /* Enabled report IDs */
+    uint8_t  report_count;
+    uint8_t  next_report;               /* Round-robin position */
+    uint8_t  report_seq;                /* Report header sequence number */
+    uint32_t reports_sent;
+    int16_t  ramp;                      /* Value generator */
+} sim_bno085_t;
+
+/*******************************************************************************
+ * Private Variables
+ ******************************************************************************/
+
+static sim_bno085_t s_sim;
+static bool s_sim_powered = false;
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+static void sim_queue(uint8_t channel, const uint8_t *payload, uint16_t len)
+{
+    uint16_t total = len + SHTP_HEADER_SIZE;
+
+    s_sim.packet[0] = total & 0xFF;
+    s_sim.packet[1] = (total >> 8) & 0x7F;
+    s_sim.packet[2] = channel;
+    s_sim.packet[3] = s_sim.seq[channel]++;
+    memcpy(&s_sim.packet[SHTP_HEADER_SIZE], payload, len);
+    s_sim.packet_len = total;
+    s_sim.header_sent = false;
+}
+
+static void sim_put_s16(uint8_t *p, int16_t value)
+{
+    p[0] = (uint8_t)(value & 0xFF);
+    p[1] = (uint8_t)((value >> 8) & 0xFF);
+}
+
+/**
+ * @brief Report length for an input report, including the 5-byte header
+ */
+static uint16_t sim_report_len(uint8_t report_id)
+{
+    switch (report_id) {
+        case SH2_ROTATION_VECTOR:
+        case SH2_GEOMAGNETIC_ROTATION:
+            return 15;  /* i, j, k, real, accuracy */
+        case SH2_GAME_ROTATION_VECTOR:
+            return 13;  /* i, j, k, real */
+        case SH2_STEP_COUNTER:
+            return 12;
+        case SH2_STABILITY_CLASSIFIER:
+            return 6;
+        default:
+            return 11;  /* x, y, z */
+    }
+}
+
+static void sim_queue_next_report(void)
+{
+    uint8_t report[SIM_MAX_PACKET];
+    uint8_t report_id = s_sim.reports[s_sim.next_report];
+    uint16_t len = sim_report_len(report_id);
+
+    if (++s_sim.next_report >= s_sim.report_count) {
+        s_sim.next_report = 0;
+    }
+
+    memset(report, 0, sizeof(report));
+    report[0] = report_id;
+    report[1] = s_sim.report_seq++;
+    report[2] = 0x03;   /* Status: high accuracy */
+    report[3] = 0;      /* Delay */
+    report[4] = 0;
+
+    /* Values: ramp with a per-field offset */
+    for (uint16_t i = 5; i + 1 < len; i += 2) {
+        sim_put_s16(&report[i], (int16_t)(s_sim.ramp + (int16_t)(i * 64)));
+    }
+    if (report_id == SH2_STABILITY_CLASSIFIER) {
+        report[5] = (uint8_t)(s_sim.ramp & 0x03);
+    }
+    s_sim.ramp += 7;
+
+    sim_queue(SHTP_CHANNEL_REPORTS, report, len);
+    s_sim.reports_sent++;
+
+    /* Enabled reports share one report interval */
+    host_cycles_advance(CONFIG_BNO085_REPORT_RATE_US / s_sim.report_count *
+                        (BOARD_MCU_FREQUENCY_HZ / 1000000UL));
+}
+
+static void sim_queue_reset_complete(void)
+{
+    uint8_t adv[1] = { SH2_RESET_COMPLETE };
+
+    sim_queue(SHTP_CHANNEL_COMMAND, adv, sizeof(adv));
+}
+
+static void sim_handle_control(const uint8_t *payload, uint16_t len)
+{
+    if (len < 1) {
+        return;
+    }
+
+    switch (payload[0]) {
+        case SH2_CMD_PRODUCT_ID_REQ: {
+            uint8_t resp[16] = {
+                SH2_CMD_PRODUCT_ID_RESP,
+                0x01,               /* Reset cause: power-on */
+                3, 2,               /* SW version 3.2 */
+                0x4E, 0x20, 0x00, 0x00,   /* Part number */
+                0x10, 0x01, 0x00, 0x00,   /* Build number */
+                0x07, 0x00,         /* Patch */
+                0, 0
+            };
+            sim_queue(SHTP_CHANNEL_CONTROL, resp, sizeof(resp));
+            break;
+        }
+
+        case SH2_CMD_SET_FEATURE:
+            if (len >= 2 && s_sim.report_count < SIM_MAX_REPORTS) {
+                for (uint8_t i = 0; i < s_sim.report_count; i++) {
+                    if (s_sim.reports[i] == payload[1]) {
+                        return;
+                    }
+                }
+                s_sim.reports[s_sim.report_count++] = payload[1];
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*******************************************************************************
+ * Public Functions - Simulation Control
+ ******************************************************************************/
+
+void sim_bno085_reset(void)
+{
+    memset(&s_sim, 0, sizeof(s_sim));
+    s_sim_powered = true;
+    sim_queue_reset_complete();
+}
+
+uint32_t sim_bno085_reports_sent(void)
+{
+    return s_sim.reports_sent;
+}
+
+/*******************************************************************************
+ * Public Functions - TWIM
+ ******************************************************************************/
+
+bool twim_device_present(twim_t *twim, uint8_t addr)
+{
+    (void)twim;
+
+    if (addr != BNO085_DEFAULT_ADDR) {
+        return false;
+    }
+    if (!s_sim_powered) {
+        sim_bno085_reset();
+    }
+    return true;
+}
+
+int twim_write(twim_t *twim, uint8_t addr, const uint8_t *data,
+               uint16_t len, bool stop)
+{
+    uint16_t packet_len;
+
+    (void)twim;
+    (void)stop;
+
+    if (addr != BNO085_DEFAULT_ADDR) {
+        return TWIM_ERR_ANACK;
+    }
+    if (len < SHTP_HEADER_SIZE) {
+        return TWIM_OK;
+    }
+
+    packet_len = data[0] | ((data[1] & 0x7F) << 8);
+    if (packet_len > len) {
+        packet_len = len;
+    }
+
+    switch (data[2]) {
+        case SHTP_CHANNEL_EXECUTABLE:
+            if (packet_len > SHTP_HEADER_SIZE && data[4] == 1) {
+                sim_bno085_reset();
+            }
+            break;
+
+        case SHTP_CHANNEL_CONTROL:
+            sim_handle_control(&data[SHTP_HEADER_SIZE],
+                               packet_len - SHTP_HEADER_SIZE);
+            break;
+
+        default:
+            break;
+    }
+
+    return TWIM_OK;
+}
+
+int twim_read(twim_t *twim, uint8_t addr, uint8_t *data, uint16_t len)
+{
+    (void)twim;
+
+    if (addr != BNO085_DEFAULT_ADDR) {
+        return TWIM_ERR_ANACK;
+    }
+
+    if (s_sim.packet_len == 0 && s_sim.report_count > 0) {
+        sim_queue_next_report();
+    }
+
+    if (s_sim.packet_len == 0) {
+        memset(data, 0, len);   /* Empty packet: length 0 */
+        return TWIM_OK;
+    }
+
+    if (!s_sim.header_sent) {
+        memcpy(data, s_sim.packet, len < SHTP_HEADER_SIZE ? len : SHTP_HEADER_SIZE);
+        s_sim.header_sent = true;
+        if (s_sim.packet_len == SHTP_HEADER_SIZE) {
+            s_sim.packet_len = 0;
+        }
+        return TWIM_OK;
+    }
+
+    /* Payload phase */
+    uint16_t avail = s_sim.packet_len - SHTP_HEADER_SIZE;
+    memcpy(data, &s_sim.packet[SHTP_HEADER_SIZE], len < avail ? len : avail);
+    s_sim.packet_len = 0;
+    return TWIM_OK;
+}
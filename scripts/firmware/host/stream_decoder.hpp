@@ -0,0 +1,881 @@
+/**
+ * @file stream_decoder.hpp
+ * @brief Header-only bulk decoder for QuatStream frames and IMU GATT values
+ *
+ * Decodes the sketch's COBS/CRC-16 frames (stream_frame.h), its legacy
+ * '!' packets (BLE UART path, legacy_decoder) and the bare-metal IMU
+ * service characteristic values (ble_imu_service.h) into
+ * structure-of-arrays columns, for gateways and offline tools that handle
+ * whole captures rather than one notification at a time.
+ *
+ * Differences from the reference decoder in stream_frame.c:
+ *   - Delimiters are found 64 bytes at a time: SIMD compares build a
+ *     64-bit mask of zero bytes (AVX2, SSE2 or AArch64 NEON, picked at
+ *     compile time, scalar otherwise) and segments are walked with ctz.
+ *   - A segment whose first COBS code covers all of it (no zero in the
+ *     frame body, the usual case) is validated in place without a copy.
+ *   - CRC-16 is table driven, four bytes per step (slice-by-4).
+ *   - Samples are appended to per-type columns instead of a callback.
+ *
+ * Accept/reject decisions, sequence and timestamp tracking and all
+ * counters match stream_frame.c exactly; decoder_bench checks this on
+ * every run.
+ */
+
+#ifndef STREAM_DECODER_HPP
+#define STREAM_DECODER_HPP
+
+#include "stream_frame.h"
+#include "ble_imu_service.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SF_SIMD_NAME "avx2"
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SF_SIMD_NAME "sse2"
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SF_SIMD_NAME "neon"
+#else
+#define SF_SIMD_NAME "scalar"
+#endif
+
+namespace sf {
+
+/*******************************************************************************
+ * Columns
+ ******************************************************************************/
+
+/**
+ * @brief Per-sample fields shared by every report type
+ */
+struct sample_columns {
+    std::vector<uint8_t>  seq;          /* Frame sequence number */
+    std::vector<uint8_t>  timed;        /* 0 if timestamp_us is unknown */
+    std::vector<uint32_t> timestamp_us; /* Sensor time (0 if untimed) */
+
+    size_t size() const { return seq.size(); }
+
+    void push(uint8_t s, bool has_ts, uint32_t ts)
+    {
+        timestamp_us.push_back(ts);
+        seq.push_back(s);
+        timed.push_back(has_ts ? 1 : 0);
+    }
+
+    void reserve(size_t n)
+    {
+        seq.reserve(n);
+        timed.reserve(n);
+        timestamp_us.reserve(n);
+    }
+
+    void clear()
+    {
+        seq.clear();
+        timed.clear();
+        timestamp_us.clear();
+    }
+};
+
+struct quat_columns : sample_columns {
+    std::vector<float> w, x, y, z;
+
+    void reserve(size_t n)
+    {
+        sample_columns::reserve(n);
+        w.reserve(n);
+        x.reserve(n);
+        y.reserve(n);
+        z.reserve(n);
+    }
+
+    void clear()
+    {
+        sample_columns::clear();
+        w.clear();
+        x.clear();
+        y.clear();
+        z.clear();
+    }
+};
+
+struct vec3_columns : sample_columns {
+    std::vector<float> x, y, z;
+
+    void reserve(size_t n)
+    {
+        sample_columns::reserve(n);
+        x.reserve(n);
+        y.reserve(n);
+        z.reserve(n);
+    }
+
+    void clear()
+    {
+        sample_columns::clear();
+        x.clear();
+        y.clear();
+        z.clear();
+    }
+};
+
+struct battery_columns : sample_columns {
+    std::vector<uint8_t>  percent;
+    std::vector<uint16_t> millivolts;
+
+    void clear()
+    {
+        sample_columns::clear();
+        percent.clear();
+        millivolts.clear();
+    }
+};
+
+/**
+ * @brief Decoded samples, one column set per report type
+ */
+struct columns {
+    quat_columns    quat;
+    vec3_columns    mag;            /* uT */
+    vec3_columns    linear_accel;   /* m/s^2 */
+    battery_columns battery;
+    uint32_t        ignored = 0;    /* Valid frames of unknown type or size */
+
+    /* Room for a capture of about `bytes` bytes at the sketch's 1:1:1 mix */
+    void reserve_for(size_t bytes)
+    {
+        size_t n = bytes / 64 + 1;
+
+        quat.reserve(n);
+        mag.reserve(n);
+        linear_accel.reserve(n);
+    }
+
+    void clear()
+    {
+        quat.clear();
+        mag.clear();
+        linear_accel.clear();
+        battery.clear();
+        ignored = 0;
+    }
+};
+
+/*******************************************************************************
+ * Private Helpers
+ ******************************************************************************/
+
+namespace detail {
+
+/* t[k][i]: CRC of byte i followed by k zero bytes, for slice-by-4 */
+struct crc16_tables {
+    uint16_t t[4][256];
+
+    constexpr crc16_tables() : t()
+    {
+        for (unsigned i = 0; i < 256; i++) {
+            uint16_t crc = (uint16_t)(i << 8);
+            for (int b = 0; b < 8; b++) {
+                crc = (uint16_t)((crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1);
+            }
+            t[0][i] = crc;
+        }
+        for (unsigned k = 1; k < 4; k++) {
+            for (unsigned i = 0; i < 256; i++) {
+                uint16_t prev = t[k - 1][i];
+                t[k][i] = (uint16_t)((prev << 8) ^ t[0][prev >> 8]);
+            }
+        }
+    }
+};
+
+inline constexpr crc16_tables k_crc16{};
+
+inline uint16_t crc16(const uint8_t *data, size_t len)
+{
+    uint16_t crc = SF_CRC16_INIT;
+    size_t i = 0;
+
+    for (; i + 4 <= len; i += 4) {
+        uint16_t x = (uint16_t)(crc ^ ((data[i] << 8) | data[i + 1]));
+        crc = (uint16_t)(k_crc16.t[3][x >> 8] ^ k_crc16.t[2][x & 0xFF] ^
+                         k_crc16.t[1][data[i + 2]] ^ k_crc16.t[0][data[i + 3]]);
+    }
+    for (; i < len; i++) {
+        crc = (uint16_t)((crc << 8) ^ k_crc16.t[0][(crc >> 8) ^ data[i]]);
+    }
+    return crc;
+}
+
+inline float load_f32(const uint8_t *p)
+{
+    float f;
+    std::memcpy(&f, p, sizeof(f));
+    return f;
+}
+
+inline unsigned ctz64(uint64_t m)
+{
+    return (unsigned)__builtin_ctzll(m);
+}
+
+/* Bit i set where p[i] == c, i in [0, 64) */
+inline uint64_t eq_mask64_scalar(const uint8_t *p, uint8_t c)
+{
+    uint64_t m = 0;
+
+    for (unsigned i = 0; i < 64; i++) {
+        m |= (uint64_t)(p[i] == c) << i;
+    }
+    return m;
+}
+
+inline uint64_t eq_mask64_simd(const uint8_t *p, uint8_t c)
+{
+#if defined(__AVX2__)
+    const __m256i cv = _mm256_set1_epi8((char)c);
+    __m256i a = _mm256_loadu_si256((const __m256i *)p);
+    __m256i b = _mm256_loadu_si256((const __m256i *)(p + 32));
+    uint32_t lo = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, cv));
+    uint32_t hi = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(b, cv));
+    return (uint64_t)lo | ((uint64_t)hi << 32);
+#elif defined(__SSE2__)
+    const __m128i cv = _mm_set1_epi8((char)c);
+    uint64_t m = 0;
+    for (unsigned i = 0; i < 4; i++) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + 16 * i));
+        m |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, cv)) << (16 * i);
+    }
+    return m;
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+    /* No movemask: weight each lane by its bit and add across halves */
+    static const uint8_t weights[16] = {1, 2, 4, 8, 16, 32, 64, 128,
+                                        1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t w = vld1q_u8(weights);
+    const uint8x16_t cv = vdupq_n_u8(c);
+    uint64_t m = 0;
+    for (unsigned i = 0; i < 4; i++) {
+        uint8x16_t bits = vandq_u8(vceqq_u8(vld1q_u8(p + 16 * i), cv), w);
+        uint64_t lo = vaddv_u8(vget_low_u8(bits));
+        uint64_t hi = vaddv_u8(vget_high_u8(bits));
+        m |= (lo | (hi << 8)) << (16 * i);
+    }
+    return m;
+#else
+    return eq_mask64_scalar(p, c);
+#endif
+}
+
+/* Mask of c in the 64 bytes at p, SIMD or portable */
+template <bool Simd>
+inline uint64_t eq_mask64(const uint8_t *p, uint8_t c)
+{
+    return Simd ? eq_mask64_simd(p, c) : eq_mask64_scalar(p, c);
+}
+
+/* Mask of c in the n < 64 bytes at p; the rest never matches */
+template <bool Simd>
+inline uint64_t eq_mask_tail(const uint8_t *p, size_t n, uint8_t c)
+{
+    uint8_t block[64];
+
+    std::memcpy(block, p, n);
+    std::memset(block + n, (uint8_t)~c, sizeof(block) - n);
+    return eq_mask64<Simd>(block, c);
+}
+
+} /* namespace detail */
+
+/*******************************************************************************
+ * Frame Decoder
+ ******************************************************************************/
+
+/**
+ * @brief Name of the compiled-in delimiter scanner ("avx2", "sse2", ...)
+ */
+inline const char *simd_name()
+{
+    return SF_SIMD_NAME;
+}
+
+/**
+ * @brief Streaming frame decoder producing columns
+ *
+ * Like sf_decoder_t, input may be split anywhere; a frame spanning feeds
+ * is reassembled from the tail kept in the decoder.
+ */
+class decoder {
+public:
+    decoder() { reset(); }
+
+    void reset()
+    {
+        std::memset(&stats_, 0, sizeof(stats_));
+        partial_len_ = 0;
+        discarding_ = false;
+        have_seq_ = false;
+        next_seq_ = 0;
+        have_ts_ = false;
+        last_ts_ = 0;
+    }
+
+    /* Same counters as the reference decoder */
+    const sf_decoder_stats_t &stats() const { return stats_; }
+
+    /**
+     * @brief Decode bytes into out using the SIMD scanner
+     * @return Frames delivered by this call
+     */
+    uint32_t feed(const uint8_t *data, size_t len, columns &out)
+    {
+        return feed_impl<true>(data, len, out);
+    }
+
+    /**
+     * @brief Same as feed() with the portable scanner (for comparison)
+     */
+    uint32_t feed_scalar(const uint8_t *data, size_t len, columns &out)
+    {
+        return feed_impl<false>(data, len, out);
+    }
+
+private:
+    template <bool Simd>
+    uint32_t feed_impl(const uint8_t *data, size_t len, columns &out)
+    {
+        const uint32_t before = stats_.frames;
+        const uint8_t *seg = data;
+        size_t i = 0;
+
+        stats_.bytes += len;
+
+        for (; i + 64 <= len; i += 64) {
+            uint64_t m = detail::eq_mask64<Simd>(data + i, 0);
+            while (m) {
+                const uint8_t *zero = data + i + detail::ctz64(m);
+                m &= m - 1;
+                end_segment(seg, zero, out);
+                seg = zero + 1;
+            }
+        }
+
+        /* Tail: padded with non-zero bytes so the padding never matches */
+        if (i < len) {
+            uint64_t m = detail::eq_mask_tail<Simd>(data + i, len - i, 0);
+            while (m) {
+                const uint8_t *zero = data + i + detail::ctz64(m);
+                m &= m - 1;
+                end_segment(seg, zero, out);
+                seg = zero + 1;
+            }
+        }
+
+        keep_tail(seg, data + len);
+        return stats_.frames - before;
+    }
+
+    /* Segment [begin, zero) ends at a delimiter */
+    void end_segment(const uint8_t *begin, const uint8_t *zero, columns &out)
+    {
+        size_t chunk = (size_t)(zero - begin);
+
+        if (discarding_) {
+            /* Oversize segment: this delimiter ends it */
+            discarding_ = false;
+        } else if (partial_len_ + chunk > SF_MAX_ENCODED) {
+            stats_.oversize++;
+            partial_len_ = 0;
+        } else if (partial_len_ == 0) {
+            segment(begin, chunk, out);
+        } else {
+            std::memcpy(&partial_[partial_len_], begin, chunk);
+            segment(partial_.data(), partial_len_ + chunk, out);
+            partial_len_ = 0;
+        }
+    }
+
+    /* Bytes after the last delimiter wait for the next feed */
+    void keep_tail(const uint8_t *begin, const uint8_t *end)
+    {
+        size_t chunk = (size_t)(end - begin);
+
+        if (discarding_ || chunk == 0) {
+            return;
+        }
+        if (partial_len_ + chunk > SF_MAX_ENCODED) {
+            stats_.oversize++;
+            discarding_ = true;
+            partial_len_ = 0;
+            return;
+        }
+        std::memcpy(&partial_[partial_len_], begin, chunk);
+        partial_len_ += chunk;
+    }
+
+    void segment(const uint8_t *seg, size_t len, columns &out)
+    {
+        const uint8_t *raw;
+        size_t raw_len;
+
+        /* Back-to-back delimiters: idle fill, not a frame */
+        if (len == 0) {
+            return;
+        }
+
+        if (seg[0] == len) {
+            /* One COBS block, no zero in the body: use it in place */
+            raw = seg + 1;
+            raw_len = len - 1;
+        } else {
+            int n = cobs_decode(seg, len);
+            if (n < 0) {
+                stats_.cobs_errors++;
+                return;
+            }
+            raw = scratch_.data();
+            raw_len = (size_t)n;
+        }
+
+        if (raw_len < SF_HEADER_LEN + 1 + SF_CRC_LEN) {
+            stats_.runts++;
+            return;
+        }
+
+        uint16_t crc = detail::crc16(raw, raw_len - SF_CRC_LEN);
+        if ((uint8_t)crc != raw[raw_len - 2] || (uint8_t)(crc >> 8) != raw[raw_len - 1]) {
+            stats_.crc_errors++;
+            return;
+        }
+
+        /* Timestamp varint */
+        size_t avail = raw_len - SF_HEADER_LEN - SF_CRC_LEN;
+        size_t ts_len = 0;
+        uint32_t ts_field = 0;
+        for (size_t k = 0; k < avail && k < SF_TS_MAX_LEN; k++) {
+            uint8_t b = raw[SF_HEADER_LEN + k];
+            ts_field |= (uint32_t)(b & 0x7F) << (7 * k);
+            if ((b & 0x80) == 0) {
+                ts_len = k + 1;
+                break;
+            }
+        }
+        if (ts_len == 0) {
+            stats_.runts++;
+            return;
+        }
+
+        uint8_t seq = raw[1];
+        if (have_seq_ && seq != next_seq_) {
+            stats_.seq_gaps++;
+            stats_.lost += (uint8_t)(seq - next_seq_);
+            /* The delta is relative to a frame we never saw */
+            have_ts_ = false;
+        }
+        have_seq_ = true;
+        next_seq_ = (uint8_t)(seq + 1);
+
+        if (raw[0] & SF_TYPE_ABS_TS) {
+            last_ts_ = ts_field;
+            have_ts_ = true;
+        } else if (have_ts_) {
+            last_ts_ += (ts_field >> 1) ^ (uint32_t)-(int32_t)(ts_field & 1);
+        }
+        if (!have_ts_) {
+            stats_.no_timestamp++;
+        }
+        stats_.frames++;
+
+        const uint8_t *p = raw + SF_HEADER_LEN + ts_len;
+        size_t plen = raw_len - SF_HEADER_LEN - ts_len - SF_CRC_LEN;
+        uint32_t ts = have_ts_ ? last_ts_ : 0;
+
+        switch (raw[0] & SF_TYPE_MASK) {
+        case SF_TYPE_QUATERNION:
+            if (plen != 4 * sizeof(float)) {
+                break;
+            }
+            /* Byte columns last: a uint8_t store may alias the vectors'
+             * own pointers and forces them to be reloaded */
+            out.quat.w.push_back(detail::load_f32(p));
+            out.quat.x.push_back(detail::load_f32(p + 4));
+            out.quat.y.push_back(detail::load_f32(p + 8));
+            out.quat.z.push_back(detail::load_f32(p + 12));
+            out.quat.push(seq, have_ts_, ts);
+            return;
+        case SF_TYPE_MAGNETOMETER:
+        case SF_TYPE_LINEAR_ACCEL: {
+            if (plen != 3 * sizeof(float)) {
+                break;
+            }
+            vec3_columns &v = ((raw[0] & SF_TYPE_MASK) == SF_TYPE_MAGNETOMETER)
+                                  ? out.mag : out.linear_accel;
+            v.x.push_back(detail::load_f32(p));
+            v.y.push_back(detail::load_f32(p + 4));
+            v.z.push_back(detail::load_f32(p + 8));
+            v.push(seq, have_ts_, ts);
+            return;
+        }
+        case SF_TYPE_BATTERY:
+            if (plen < 3) {
+                break;
+            }
+            out.battery.push(seq, have_ts_, ts);
+            out.battery.percent.push_back(p[0]);
+            out.battery.millivolts.push_back((uint16_t)(p[1] | (p[2] << 8)));
+            return;
+        default:
+            break;
+        }
+        out.ignored++;
+    }
+
+    /* sf_cobs_decode() into scratch_, so the header needs no library */
+    int cobs_decode(const uint8_t *in, size_t len)
+    {
+        size_t in_pos = 0;
+        size_t out_pos = 0;
+
+        while (in_pos < len) {
+            uint8_t code = in[in_pos++];
+
+            if (code == 0 || in_pos + code - 1 > len) {
+                return -1;
+            }
+            std::memcpy(&scratch_[out_pos], &in[in_pos], (size_t)code - 1);
+            in_pos += (size_t)code - 1;
+            out_pos += (size_t)code - 1;
+
+            /* A code below 0xFF stands for a zero, except at the very end */
+            if (code != 0xFF && in_pos < len) {
+                scratch_[out_pos++] = 0;
+            }
+        }
+        return (int)out_pos;
+    }
+
+    sf_decoder_stats_t stats_;
+    std::array<uint8_t, SF_MAX_ENCODED> partial_;
+    std::array<uint8_t, SF_MAX_ENCODED> scratch_;
+    size_t   partial_len_;
+    bool     discarding_;
+    bool     have_seq_;
+    uint8_t  next_seq_;
+    bool     have_ts_;
+    uint32_t last_ts_;
+};
+
+/*******************************************************************************
+ * Legacy Packets
+ ******************************************************************************/
+
+#define SF_LEGACY_MARKER        '!'
+#define SF_LEGACY_NEWLINE       '\n'
+#define SF_LEGACY_MAX_PACKET    20      /* 'Q' */
+
+/**
+ * @brief legacy_decoder counters
+ */
+struct legacy_stats {
+    uint64_t bytes;
+    uint64_t packets;       /* Delivered */
+    uint64_t bad_packets;   /* '!' and a known type, checksum or '\n' wrong */
+};
+
+/**
+ * @brief Streaming decoder for the legacy '!' packets of the BLE UART path
+ *
+ * Packet: '!', type, payload, ~(8-bit sum of the bytes before), then
+ * '\n' except after 'B':
+ *   'Q' w, x, y, z floats (20 bytes); 'M', 'A' x, y, z floats (16 bytes);
+ *   'B' percent u8, millivolts u16 (6 bytes)
+ *
+ * Packets have no sequence number or sensor time, so samples get seq 0
+ * and are untimed. Back-to-back packets are parsed in sequence; after a
+ * bad or cut-off one the next '!' is found with the same 64-byte masks
+ * as the frame decoder's delimiters. Resynchronization matches the web
+ * client's parser (LegacyPacketIngest in lib/streamIngest.ts): a bad
+ * packet is skipped one byte at a time, a good one as a whole, so a '!'
+ * inside its payload is not a marker. Input may be split anywhere; a
+ * packet spanning feeds waits in the decoder.
+ */
+class legacy_decoder {
+public:
+    legacy_decoder() { reset(); }
+
+    void reset()
+    {
+        std::memset(&stats_, 0, sizeof(stats_));
+        partial_len_ = 0;
+    }
+
+    const legacy_stats &stats() const { return stats_; }
+
+    /* Packet length for a type byte, 0 if it is not a packet type */
+    static size_t packet_len(uint8_t type)
+    {
+        switch (type) {
+        case SF_TYPE_QUATERNION:
+            return 20;
+        case SF_TYPE_MAGNETOMETER:
+        case SF_TYPE_LINEAR_ACCEL:
+            return 16;
+        case SF_TYPE_BATTERY:
+            return 6;
+        default:
+            return 0;
+        }
+    }
+
+    /**
+     * @brief Decode bytes into out using the SIMD scanner
+     * @return Packets delivered by this call
+     */
+    uint64_t feed(const uint8_t *data, size_t len, columns &out)
+    {
+        return feed_impl<true>(data, len, out);
+    }
+
+    /**
+     * @brief Same as feed() with the portable scanner (for comparison)
+     */
+    uint64_t feed_scalar(const uint8_t *data, size_t len, columns &out)
+    {
+        return feed_impl<false>(data, len, out);
+    }
+
+private:
+    /* What parse() made of the bytes at a marker */
+    enum class result { packet, bad, skip, incomplete };
+
+    template <bool Simd>
+    uint64_t feed_impl(const uint8_t *data, size_t len, columns &out)
+    {
+        const uint64_t before = stats_.packets;
+        size_t pos = 0;
+
+        stats_.bytes += len;
+        if (partial_len_ > 0 && !resume(data, len, pos, out)) {
+            return stats_.packets - before;
+        }
+
+        /* Packets usually follow each other directly; the scan is only
+         * for getting back in step after a bad or cut-off one */
+        while (pos < len) {
+            if (data[pos] != SF_LEGACY_MARKER) {
+                pos = find_marker<Simd>(data, len, pos + 1);
+                continue;
+            }
+            size_t n = 0;
+            switch (parse(data + pos, len - pos, n, out)) {
+            case result::packet:
+                pos += n;
+                break;
+            case result::incomplete:
+                keep(data + pos, len - pos);
+                return stats_.packets - before;
+            default:
+                pos++;
+                break;
+            }
+        }
+        return stats_.packets - before;
+    }
+
+    /* First '!' in data[from, len), or len */
+    template <bool Simd>
+    static size_t find_marker(const uint8_t *data, size_t len, size_t from)
+    {
+        size_t i = from;
+
+        for (; i + 64 <= len; i += 64) {
+            uint64_t m = detail::eq_mask64<Simd>(data + i, SF_LEGACY_MARKER);
+            if (m) {
+                return i + detail::ctz64(m);
+            }
+        }
+        if (i < len) {
+            uint64_t m = detail::eq_mask_tail<Simd>(data + i, len - i, SF_LEGACY_MARKER);
+            if (m) {
+                return i + detail::ctz64(m);
+            }
+        }
+        return len;
+    }
+
+    /**
+     * Markers in the kept tail, joined with the start of data. Returns
+     * false if data was not enough to finish them (all of it is kept);
+     * otherwise next is where parsing of data goes on.
+     */
+    bool resume(const uint8_t *data, size_t len, size_t &next, columns &out)
+    {
+        uint8_t join[2 * SF_LEGACY_MAX_PACKET];
+        size_t kept = partial_len_;
+        size_t add = len < SF_LEGACY_MAX_PACKET ? len : SF_LEGACY_MAX_PACKET;
+        size_t i = 0;
+
+        std::memcpy(join, partial_.data(), kept);
+        std::memcpy(join + kept, data, add);
+        partial_len_ = 0;
+
+        while (i < kept) {
+            if (join[i] != SF_LEGACY_MARKER) {
+                i++;
+                continue;
+            }
+            size_t n = 0;
+            switch (parse(join + i, kept + add - i, n, out)) {
+            case result::packet:
+                i += n;
+                break;
+            case result::incomplete:
+                /* Fewer than a packet's bytes arrived: all of data is here */
+                keep(join + i, kept + add - i);
+                return false;
+            default:
+                i++;
+                break;
+            }
+        }
+        next = i - kept;
+        return true;
+    }
+
+    /* The candidate packet at p, with avail bytes from p on */
+    result parse(const uint8_t *p, size_t avail, size_t &n, columns &out)
+    {
+        if (avail < 2) {
+            return result::incomplete;
+        }
+        n = packet_len(p[1]);
+        if (n == 0) {
+            return result::skip;
+        }
+        if (n > avail) {
+            return result::incomplete;
+        }
+
+        bool newline = p[1] != SF_TYPE_BATTERY;
+        size_t sum_at = n - (newline ? 2 : 1);
+        uint8_t sum = 0;
+        for (size_t k = 0; k < sum_at; k++) {
+            sum = (uint8_t)(sum + p[k]);
+        }
+        if (p[sum_at] != (uint8_t)~sum || (newline && p[sum_at + 1] != SF_LEGACY_NEWLINE)) {
+            stats_.bad_packets++;
+            return result::bad;
+        }
+
+        const uint8_t *v = p + 2;
+        switch (p[1]) {
+        case SF_TYPE_QUATERNION:
+            out.quat.w.push_back(detail::load_f32(v));
+            out.quat.x.push_back(detail::load_f32(v + 4));
+            out.quat.y.push_back(detail::load_f32(v + 8));
+            out.quat.z.push_back(detail::load_f32(v + 12));
+            out.quat.push(0, false, 0);
+            break;
+        case SF_TYPE_BATTERY:
+            out.battery.push(0, false, 0);
+            out.battery.percent.push_back(v[0]);
+            out.battery.millivolts.push_back((uint16_t)(v[1] | (v[2] << 8)));
+            break;
+        default: {
+            vec3_columns &c = (p[1] == SF_TYPE_MAGNETOMETER) ? out.mag : out.linear_accel;
+            c.x.push_back(detail::load_f32(v));
+            c.y.push_back(detail::load_f32(v + 4));
+            c.z.push_back(detail::load_f32(v + 8));
+            c.push(0, false, 0);
+            break;
+        }
+        }
+        stats_.packets++;
+        return result::packet;
+    }
+
+    /* An unfinished packet, shorter than SF_LEGACY_MAX_PACKET */
+    void keep(const uint8_t *p, size_t n)
+    {
+        std::memcpy(partial_.data(), p, n);
+        partial_len_ = n;
+    }
+
+    legacy_stats stats_;
+    std::array<uint8_t, SF_LEGACY_MAX_PACKET> partial_;
+    size_t partial_len_;
+};
+
+/*******************************************************************************
+ * IMU Service Values
+ ******************************************************************************/
+
+/**
+ * @brief Append IMU service characteristic values to out
+ *
+ * `value` holds one or more back-to-back values of the characteristic
+ * (one per notification, as a gateway logs them). GATT values carry no
+ * sequence number or sensor time, so every sample gets seq 0 and the
+ * caller's receive time.
+ *
+ * @param char_uuid    BLE_IMU_CHAR_*_UUID
+ * @param timestamp_us Receive time of the notification
+ * @return Samples appended; 0 for other characteristics or a length that
+ *         is not a multiple of the value size
+ */
+inline size_t decode_gatt(uint16_t char_uuid, const uint8_t *value, size_t len,
+                          uint32_t timestamp_us, columns &out)
+{
+    static_assert(sizeof(ble_imu_quat_t) == BLE_IMU_QUAT_SIZE, "ble_imu_quat_t layout");
+    static_assert(sizeof(ble_imu_vector_t) == BLE_IMU_ACCEL_SIZE, "ble_imu_vector_t layout");
+
+    if (char_uuid == BLE_IMU_CHAR_QUATERNION_UUID ||
+        char_uuid == BLE_IMU_CHAR_GAME_ROTATION_UUID ||
+        char_uuid == BLE_IMU_CHAR_GEOMAG_ROTATION_UUID) {
+        if (len % BLE_IMU_QUAT_SIZE != 0) {
+            return 0;
+        }
+        size_t n = len / BLE_IMU_QUAT_SIZE;
+        for (size_t k = 0; k < n; k++, value += BLE_IMU_QUAT_SIZE) {
+            /* Wire order is i, j, k, real */
+            out.quat.push(0, true, timestamp_us);
+            out.quat.x.push_back(detail::load_f32(value + offsetof(ble_imu_quat_t, i)));
+            out.quat.y.push_back(detail::load_f32(value + offsetof(ble_imu_quat_t, j)));
+            out.quat.z.push_back(detail::load_f32(value + offsetof(ble_imu_quat_t, k)));
+            out.quat.w.push_back(detail::load_f32(value + offsetof(ble_imu_quat_t, real)));
+        }
+        return n;
+    }
+
+    vec3_columns *v;
+    if (char_uuid == BLE_IMU_CHAR_MAG_UUID) {
+        v = &out.mag;
+    } else if (char_uuid == BLE_IMU_CHAR_LINEAR_ACCEL_UUID) {
+        v = &out.linear_accel;
+    } else {
+        return 0;
+    }
+    if (len % BLE_IMU_ACCEL_SIZE != 0) {
+        return 0;
+    }
+
+    size_t n = len / BLE_IMU_ACCEL_SIZE;
+    for (size_t k = 0; k < n; k++, value += BLE_IMU_ACCEL_SIZE) {
+        v->push(0, true, timestamp_us);
+        v->x.push_back(detail::load_f32(value + offsetof(ble_imu_vector_t, x)));
+        v->y.push_back(detail::load_f32(value + offsetof(ble_imu_vector_t, y)));
+        v->z.push_back(detail::load_f32(value + offsetof(ble_imu_vector_t, z)));
+    }
+    return n;
+}
+
+} /* namespace sf */
+
+#endif /* STREAM_DECODER_HPP */
@@ -0,0 +1,276 @@
+/**
+ * @file stream_frame.c
+ * @brief Reference codec for the QuatStream sketch's COBS/CRC-16 frames
+ */
+
+#include "stream_frame.h"
+#include <string.h>
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+static size_t sf_varint_put(uint32_t value, uint8_t *out)
+{
+    size_t n = 0;
+
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+/**
+ * @return Bytes consumed, 0 if the varint is truncated or too long
+ */
+static size_t sf_varint_get(const uint8_t *in, size_t len, uint32_t *value)
+{
+    uint32_t v = 0;
+
+    for (size_t i = 0; i < len && i < SF_TS_MAX_LEN; i++) {
+        v |= (uint32_t)(in[i] & 0x7F) << (7 * i);
+        if ((in[i] & 0x80) == 0) {
+            *value = v;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Validate and deliver one COBS segment
+ */
+static uint32_t sf_segment(sf_decoder_t *dec, const uint8_t *seg, size_t len,
+                           sf_frame_cb_t cb, void *ctx)
+{
+    uint8_t raw[SF_MAX_ENCODED];
+    sf_frame_t frame;
+    int raw_len;
+    uint16_t crc;
+    uint32_t ts_field;
+    size_t ts_len;
+
+    /* Back-to-back delimiters: idle fill, not a frame */
+    if (len == 0) {
+        return 0;
+    }
+
+    raw_len = sf_cobs_decode(seg, len, raw);
+    if (raw_len < 0) {
+        dec->stats.cobs_errors++;
+        return 0;
+    }
+    if (raw_len < SF_HEADER_LEN + 1 + SF_CRC_LEN) {
+        dec->stats.runts++;
+        return 0;
+    }
+
+    crc = sf_crc16(SF_CRC16_INIT, raw, (size_t)raw_len - SF_CRC_LEN);
+    if ((uint8_t)crc != raw[raw_len - 2] || (uint8_t)(crc >> 8) != raw[raw_len - 1]) {
+        dec->stats.crc_errors++;
+        return 0;
+    }
+
+    ts_len = sf_varint_get(&raw[SF_HEADER_LEN],
+                           (size_t)raw_len - SF_HEADER_LEN - SF_CRC_LEN, &ts_field);
+    if (ts_len == 0) {
+        dec->stats.runts++;
+        return 0;
+    }
+
+    frame.type = raw[0] & SF_TYPE_MASK;
+    frame.seq = raw[1];
+    frame.len = (uint8_t)((size_t)raw_len - SF_HEADER_LEN - ts_len - SF_CRC_LEN);
+    frame.payload = &raw[SF_HEADER_LEN + ts_len];
+
+    if (dec->have_seq && frame.seq != dec->next_seq) {
+        dec->stats.seq_gaps++;
+        dec->stats.lost += (uint8_t)(frame.seq - dec->next_seq);
+        /* The delta is relative to a frame we never saw */
+        dec->have_ts = false;
+    }
+    dec->have_seq = true;
+    dec->next_seq = (uint8_t)(frame.seq + 1);
+
+    if (raw[0] & SF_TYPE_ABS_TS) {
+        dec->last_ts = ts_field;
+        dec->have_ts = true;
+    } else if (dec->have_ts) {
+        /* Undo zigzag; unsigned wrap keeps 32-bit time arithmetic exact */
+        dec->last_ts += (ts_field >> 1) ^ (uint32_t)-(int32_t)(ts_field & 1);
+    }
+    frame.has_timestamp = dec->have_ts;
+    frame.timestamp_us = dec->have_ts ? dec->last_ts : 0;
+    if (!dec->have_ts) {
+        dec->stats.no_timestamp++;
+    }
+
+    dec->stats.frames++;
+    if (cb) {
+        cb(&frame, ctx);
+    }
+    return 1;
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+uint16_t sf_crc16(uint16_t crc, const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        uint8_t x = (uint8_t)((crc >> 8) ^ data[i]);
+        x ^= x >> 4;
+        crc = (uint16_t)((crc << 8) ^ ((uint16_t)x << 12) ^ ((uint16_t)x << 5) ^ x);
+    }
+    return crc;
+}
+
+size_t sf_build(uint8_t type, uint8_t seq, uint32_t ts_field,
+                const void *payload, uint8_t len, uint8_t *out)
+{
+    size_t pos;
+    uint16_t crc;
+
+    if (len > SF_MAX_PAYLOAD) {
+        return 0;
+    }
+
+    out[0] = type;
+    out[1] = seq;
+    pos = SF_HEADER_LEN + sf_varint_put(ts_field, &out[SF_HEADER_LEN]);
+    if (len > 0) {
+        memcpy(&out[pos], payload, len);
+        pos += len;
+    }
+
+    crc = sf_crc16(SF_CRC16_INIT, out, pos);
+    out[pos++] = (uint8_t)crc;
+    out[pos++] = (uint8_t)(crc >> 8);
+
+    return pos;
+}
+
+size_t sf_cobs_encode(const uint8_t *in, size_t len, uint8_t *out)
+{
+    size_t code_pos = 0;
+    size_t out_pos = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < len; i++) {
+        if (in[i] != 0) {
+            out[out_pos++] = in[i];
+            code++;
+        }
+        if (in[i] == 0 || code == 0xFF) {
+            out[code_pos] = code;
+            code_pos = out_pos++;
+            code = 1;
+        }
+    }
+
+    out[code_pos] = code;
+    out[out_pos++] = SF_DELIMITER;
+    return out_pos;
+}
+
+int sf_cobs_decode(const uint8_t *in, size_t len, uint8_t *out)
+{
+    size_t in_pos = 0;
+    size_t out_pos = 0;
+
+    while (in_pos < len) {
+        uint8_t code = in[in_pos++];
+
+        if (code == 0 || in_pos + code - 1 > len) {
+            return -1;
+        }
+
+        memcpy(&out[out_pos], &in[in_pos], (size_t)code - 1);
+        in_pos += (size_t)code - 1;
+        out_pos += (size_t)code - 1;
+
+        /* A code below 0xFF stands for a zero, except at the very end */
+        if (code != 0xFF && in_pos < len) {
+            out[out_pos++] = 0;
+        }
+    }
+
+    return (int)out_pos;
+}
+
+void sf_encoder_init(sf_encoder_t *enc)
+{
+    memset(enc, 0, sizeof(*enc));
+}
+
+size_t sf_encode(sf_encoder_t *enc, uint8_t type, uint32_t timestamp_us,
+                 const void *payload, uint8_t len, uint8_t *out)
+{
+    uint8_t raw[SF_MAX_RAW];
+    uint32_t ts_field;
+    size_t raw_len;
+
+    if (!enc->have_ts || (enc->seq % SF_ABS_TS_INTERVAL) == 0) {
+        type |= SF_TYPE_ABS_TS;
+        ts_field = timestamp_us;
+    } else {
+        ts_field = sf_zigzag((int32_t)(timestamp_us - enc->last_ts));
+    }
+    enc->have_ts = true;
+    enc->last_ts = timestamp_us;
+
+    raw_len = sf_build(type, enc->seq++, ts_field, payload, len, raw);
+
+    if (raw_len == 0) {
+        return 0;
+    }
+    return sf_cobs_encode(raw, raw_len, out);
+}
+
+void sf_decoder_init(sf_decoder_t *dec)
+{
+    memset(dec, 0, sizeof(*dec));
+}
+
+uint32_t sf_decoder_feed(sf_decoder_t *dec, const uint8_t *data, size_t len,
+                         sf_frame_cb_t cb, void *ctx)
+{
+    const uint8_t *end = data + len;
+    uint32_t delivered = 0;
+
+    dec->stats.bytes += len;
+
+    while (data < end) {
+        const uint8_t *zero = memchr(data, SF_DELIMITER, (size_t)(end - data));
+        size_t chunk = (size_t)((zero ? zero : end) - data);
+
+        if (dec->discarding) {
+            /* Oversize segment: drop everything up to the next delimiter */
+        } else if (dec->partial_len + chunk > SF_MAX_ENCODED) {
+            dec->stats.oversize++;
+            dec->discarding = true;
+            dec->partial_len = 0;
+        } else if (zero && dec->partial_len == 0) {
+            /* Whole segment inside this chunk: decode in place */
+            delivered += sf_segment(dec, data, chunk, cb, ctx);
+        } else {
+            memcpy(&dec->partial[dec->partial_len], data, chunk);
+            dec->partial_len = (uint16_t)(dec->partial_len + chunk);
+            if (zero) {
+                delivered += sf_segment(dec, dec->partial, dec->partial_len, cb, ctx);
+                dec->partial_len = 0;
+            }
+        }
+
+        if (!zero) {
+            break;
+        }
+        dec->discarding = false;
+        data = zero + 1;
+    }
+
+    return delivered;
+}
@@ -0,0 +1,215 @@
+/**
+ * @file stream_frame.h
+ * @brief Reference codec for the QuatStream sketch's COBS/CRC-16 frames
+ *
+ * Wire format (see quaternion_ble_stream/README.md):
+ *
+ *   frame   = COBS(type | seq | ts | payload | crc16_le) 0x00
+ *
+ *   type    - 'Q' quaternion, 'M' magnetometer, 'A' linear acceleration,
+ *             'B' battery; bit 7 (SF_TYPE_ABS_TS) set when ts is absolute
+ *   seq     - 8-bit sequence number, +1 per frame across all types
+ *   ts      - sensor timestamp in microseconds, LEB128 varint. Absolute
+ *             (low 32 bits) when SF_TYPE_ABS_TS is set, otherwise the
+ *             zigzag-encoded signed delta from the previous frame's
+ *             timestamp. Deltas are 2 bytes at 200 Hz.
+ *   crc16   - CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) over type,
+ *             seq, ts and payload, little-endian
+ *
+ * COBS removes every zero byte from the frame body, so 0x00 only ever
+ * appears as the delimiter. A receiver that loses sync discards bytes up
+ * to the next zero and is aligned again, whatever the payload contains.
+ *
+ * The decoder is streaming: feed it notification payloads of any size and
+ * it delivers whole frames through a callback. Segments that fit in one
+ * input chunk are decoded straight from the input; only frames split
+ * across chunks are copied into the decoder's reassembly buffer.
+ *
+ * A delta only means something if the previous frame arrived, so after a
+ * sequence gap the decoder reports frames without a timestamp until the
+ * next absolute one (the sketch sends one every SF_ABS_TS_INTERVAL frames).
+ *
+ * Plain C with no firmware dependencies, so it can be linked into any
+ * host tool.
+ */
+
+#ifndef STREAM_FRAME_H
+#define STREAM_FRAME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SF_DELIMITER                0x00
+
+#define SF_TYPE_QUATERNION          'Q'     /* w, x, y, z (float32) */
+#define SF_TYPE_MAGNETOMETER        'M'     /* x, y, z (float32, uT) */
+#define SF_TYPE_LINEAR_ACCEL        'A'     /* x, y, z (float32, m/s^2) */
+#define SF_TYPE_BATTERY             'B'     /* percent (u8), millivolts (u16) */
+#define SF_TYPE_ABS_TS              0x80    /* Flag: ts field is absolute */
+#define SF_TYPE_MASK                0x7F
+
+#define SF_ABS_TS_INTERVAL          64      /* Frames between absolute ts */
+
+#define SF_HEADER_LEN               2       /* type, seq */
+#define SF_TS_MAX_LEN               5       /* 32-bit LEB128 */
+#define SF_CRC_LEN                  2
+#define SF_MAX_PAYLOAD              32
+
+/* Largest frame before and after COBS (+1 code byte per 254, +1 delimiter) */
+#define SF_MAX_RAW                  (SF_HEADER_LEN + SF_TS_MAX_LEN + SF_MAX_PAYLOAD + SF_CRC_LEN)
+#define SF_MAX_ENCODED              (SF_MAX_RAW + (SF_MAX_RAW / 254) + 2)
+
+#define SF_CRC16_INIT               0xFFFF
+
+/*******************************************************************************
+ * Data Structures
+ ******************************************************************************/
+
+/**
+ * @brief One decoded frame; payload points into decoder storage
+ */
+typedef struct {
+    uint8_t        type;        /* SF_TYPE_* (SF_TYPE_ABS_TS cleared) */
+    uint8_t        seq;         /* Sequence number */
+    bool           has_timestamp; /* False after a gap until an absolute ts */
+    uint32_t       timestamp_us; /* Sensor time (valid if has_timestamp) */
+    uint8_t        len;         /* Payload length */
+    const uint8_t *payload;     /* Valid for the duration of the callback */
+} sf_frame_t;
+
+/**
+ * @brief Decoder counters (accumulated across calls)
+ */
+typedef struct {
+    uint64_t bytes;             /* Bytes passed to sf_decoder_feed() */
+    uint32_t frames;            /* Frames delivered to the callback */
+    uint32_t crc_errors;        /* Frames rejected by CRC */
+    uint32_t cobs_errors;       /* Segments that are not valid COBS */
+    uint32_t oversize;          /* Segments longer than SF_MAX_ENCODED */
+    uint32_t runts;             /* Segments too short for header + ts + CRC */
+    uint32_t seq_gaps;          /* Sequence discontinuities */
+    uint32_t lost;              /* Frames missing according to seq */
+    uint32_t no_timestamp;      /* Frames delivered without a timestamp */
+} sf_decoder_stats_t;
+
+/**
+ * @brief Called once per frame that passes the CRC
+ */
+typedef void (*sf_frame_cb_t)(const sf_frame_t *frame, void *ctx);
+
+/**
+ * @brief Streaming decoder state
+ */
+typedef struct {
+    uint8_t            partial[SF_MAX_ENCODED]; /* Segment split across feeds */
+    uint16_t           partial_len;
+    bool               discarding;  /* Dropping an oversize segment */
+    bool               have_seq;    /* next_seq is valid */
+    uint8_t            next_seq;
+    bool               have_ts;     /* last_ts is a valid delta base */
+    uint32_t           last_ts;
+    sf_decoder_stats_t stats;
+} sf_decoder_t;
+
+/**
+ * @brief Encoder state (sequence and timestamp base)
+ */
+typedef struct {
+    uint8_t  seq;
+    bool     have_ts;           /* last_ts sent; deltas allowed */
+    uint32_t last_ts;
+} sf_encoder_t;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief CRC-16/CCITT-FALSE
+ * @param crc  Running value (SF_CRC16_INIT to start)
+ * @param data Bytes to add
+ * @param len  Number of bytes
+ * @return Updated CRC
+ */
+uint16_t sf_crc16(uint16_t crc, const uint8_t *data, size_t len);
+
+/**
+ * @brief Build an unencoded frame (header, ts, payload, CRC)
+ * @param type     SF_TYPE_*, with SF_TYPE_ABS_TS if ts_field is absolute
+ * @param ts_field Absolute timestamp, or zigzag delta (sf_zigzag)
+ * @param out      Buffer of at least SF_MAX_RAW bytes
+ * @return Frame length, 0 if len exceeds SF_MAX_PAYLOAD
+ */
+size_t sf_build(uint8_t type, uint8_t seq, uint32_t ts_field,
+                const void *payload, uint8_t len, uint8_t *out);
+
+/**
+ * @brief Map a signed delta to an unsigned varint value (0,-1,1,-2 -> 0,1,2,3)
+ */
+static inline uint32_t sf_zigzag(int32_t delta)
+{
+    return ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+}
+
+/**
+ * @brief COBS-encode a frame and append the delimiter
+ * @param out Buffer of at least len + len / 254 + 2 bytes
+ * @return Encoded length including the delimiter
+ */
+size_t sf_cobs_encode(const uint8_t *in, size_t len, uint8_t *out);
+
+/**
+ * @brief COBS-decode one segment (without its delimiter)
+ * @param out Buffer of at least len bytes
+ * @return Decoded length, or -1 if the segment is not valid COBS
+ */
+int sf_cobs_decode(const uint8_t *in, size_t len, uint8_t *out);
+
+/**
+ * @brief Reset an encoder (on connect)
+ */
+void sf_encoder_init(sf_encoder_t *enc);
+
+/**
+ * @brief Build and COBS-encode the next frame, as the sketch does
+ *
+ * Picks an absolute timestamp for the first frame and every
+ * SF_ABS_TS_INTERVAL-th frame, a delta otherwise, and advances seq.
+ *
+ * @param out Buffer of at least SF_MAX_ENCODED bytes
+ * @return Bytes written including the delimiter, 0 on error
+ */
+size_t sf_encode(sf_encoder_t *enc, uint8_t type, uint32_t timestamp_us,
+                 const void *payload, uint8_t len, uint8_t *out);
+
+/**
+ * @brief Reset a decoder
+ */
+void sf_decoder_init(sf_decoder_t *dec);
+
+/**
+ * @brief Feed received bytes
+ * @param dec  Decoder
+ * @param data Received bytes (any split; frames may span calls)
+ * @param len  Number of bytes
+ * @param cb   Frame callback (may be NULL to only count)
+ * @param ctx  Passed to cb
+ * @return Number of frames delivered by this call
+ */
+uint32_t sf_decoder_feed(sf_decoder_t *dec, const uint8_t *data, size_t len,
+                         sf_frame_cb_t cb, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STREAM_FRAME_H */
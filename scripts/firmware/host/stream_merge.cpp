@@ -0,0 +1,696 @@
+/**
+ * @file stream_merge.cpp
+ * @brief Merge several devices' streams onto one timeline (stream_merge.hpp)
+ *
+ * Usage: stream_merge [options] input...
+ *
+ * Each input is one device:
+ *   path            Notification log (sf::log_*, told apart by its
+ *                   header): frames or IMU service values with the times
+ *                   they were received. Otherwise a raw capture of the
+ *                   sketch's stream bytes; a FIFO or character device
+ *                   (UART, pty) is read live, a terminal in raw mode
+ *   -               Stream bytes on stdin, live
+ *   unix:path       Stream bytes from a Unix socket, live
+ *   tcp:host:port   Stream bytes from a TCP connection, live
+ *
+ * Live inputs are stamped with the monotonic clock as bytes are read and
+ * merged as they arrive. Logs and captures are merged offline in receive
+ * order; a raw capture has no receive times, so its samples are placed
+ * by sensor time with its first sample at 0. Offline and live inputs
+ * cannot be mixed. With --speed, offline inputs are replayed at the pace
+ * they were received instead of as fast as possible.
+ *
+ * Options:
+ *   --mode sensor|arrival  Align on sensor timestamps (default) or arrival
+ *   --ring N               Reorder ring per device (samples)
+ *   --max-delay MS         Longest a sample is held
+ *   --idle MS              Silence before a device stops holding others back
+ *   --quiet                Statistics only, no samples
+ *   --shm NAME             Also publish samples to shared memory
+ *                          (stream_shm.hpp), e.g. /sf_stream
+ *   --shm-slots N          Its ring size (samples)
+ *   --ws [HOST:]PORT       Also serve samples over WebSocket (stream_ws.hpp)
+ *                          on 127.0.0.1 unless HOST is given
+ *   --ws-origin ORIGIN     Refuse WebSocket clients from other pages
+ *   --flush-hz N           WebSocket batches per second (default 60; 0
+ *                          sends each release from the merge at once)
+ *   --speed X              Replay offline inputs at X times real time
+ *                          (default 1 with --ws, else as fast as possible)
+ *
+ * Writes CSV to stdout: t_us,device,type,sensor_time,v0,v1,v2,v3 with
+ * type Q, M, A or B. Per-device clock estimates and merge counters go to
+ * stderr at the end. The shared-memory segment is removed on exit,
+ * including on SIGINT and SIGTERM; subscribers then see the stream end.
+ * With --ws, an offline replay waits for the first WebSocket client.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "stream_merge.hpp"
+#include "stream_shm.hpp"
+#include "stream_ws.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <unistd.h>
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+#define READ_CHUNK              4096
+#define CAPTURE_CHUNK           244         /* Raw captures, one notification at a time */
+#define POLL_MS                 10          /* Live: advance the merge at least this often */
+#define DEFAULT_FLUSH_HZ        60          /* WebSocket batches, one per display frame */
+
+/**
+ * @brief One device's input
+ */
+struct input {
+    std::string          spec;
+    bool                 live;
+    int                  fd;            /* Live */
+    bool                 is_log;        /* Offline */
+    std::vector<uint8_t> data;
+    size_t               pos;           /* Raw capture: bytes fed */
+    sf::log_reader       log;
+    sf::decoder          dec;
+    sf::columns          cols;          /* Next batch, offline */
+    int64_t              next_us;       /* Its receive time */
+    bool                 pending;
+    bool                 have_base;     /* Raw capture: first sensor time seen */
+    int64_t              base;
+    uint32_t             last_ts;
+    int64_t              unwrapped;
+
+    input() : live(false), fd(-1), is_log(false), pos(0), log(nullptr, 0), next_us(0),
+              pending(false), have_base(false), base(0), last_ts(0), unwrapped(0) {}
+};
+
+/*******************************************************************************
+ * Private Variables
+ ******************************************************************************/
+
+static bool s_quiet;
+static sf::shm_publisher s_shm;
+static volatile sig_atomic_t s_stop;
+static sf::ws_server s_ws;
+static bool s_ws_on;
+static int64_t s_flush_us;                  /* 0: flush on every release */
+static int64_t s_next_flush;
+static double s_speed;                      /* Offline pacing, 0: none */
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int fail(const char *fmt, const char *arg)
+{
+    fprintf(stderr, "stream_merge: ");
+    fprintf(stderr, fmt, arg);
+    fprintf(stderr, "\n");
+    return 1;
+}
+
+static bool load_file(const char *path, std::vector<uint8_t> &buf)
+{
+    FILE *f = fopen(path, "rb");
+    uint8_t chunk[READ_CHUNK];
+    size_t n;
+
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        buf.insert(buf.end(), chunk, chunk + n);
+    }
+    bool ok = !ferror(f);
+    fclose(f);
+    if (!ok) {
+        fprintf(stderr, "%s: read failed\n", path);
+    }
+    return ok;
+}
+
+static int connect_unix(const char *path)
+{
+    struct sockaddr_un addr;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (fd < 0 || strlen(path) >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int connect_tcp(const std::string &host_port)
+{
+    size_t colon = host_port.rfind(':');
+    struct addrinfo hints, *res, *ai;
+    int fd = -1;
+
+    if (colon == std::string::npos) {
+        return -1;
+    }
+    std::string host = host_port.substr(0, colon);
+    std::string port = host_port.substr(colon + 1);
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0) {
+        return -1;
+    }
+    for (ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            break;
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+/* UART or pty: pass every byte through (COBS uses 0x00, CR and LF) */
+static void raw_terminal(int fd)
+{
+    struct termios t;
+
+    if (tcgetattr(fd, &t) != 0) {
+        return;
+    }
+    t.c_iflag &= ~(tcflag_t)(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON);
+    t.c_oflag &= ~(tcflag_t)OPOST;
+    t.c_lflag &= ~(tcflag_t)(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+    t.c_cflag &= ~(tcflag_t)(CSIZE | PARENB);
+    t.c_cflag |= CS8 | CREAD | CLOCAL;
+    t.c_cc[VMIN] = 1;
+    t.c_cc[VTIME] = 0;
+    (void)tcsetattr(fd, TCSANOW, &t);
+}
+
+static bool open_input(input &in)
+{
+    const std::string &s = in.spec;
+    struct stat st;
+
+    if (s == "-") {
+        in.live = true;
+        in.fd = STDIN_FILENO;
+    } else if (s.compare(0, 5, "unix:") == 0) {
+        in.live = true;
+        in.fd = connect_unix(s.c_str() + 5);
+    } else if (s.compare(0, 4, "tcp:") == 0) {
+        in.live = true;
+        in.fd = connect_tcp(s.substr(4));
+    } else if (stat(s.c_str(), &st) == 0 && !S_ISREG(st.st_mode)) {
+        in.live = true;
+        in.fd = open(s.c_str(), O_RDONLY | O_NOCTTY);
+        if (in.fd >= 0 && isatty(in.fd)) {
+            raw_terminal(in.fd);
+        }
+    } else {
+        if (!load_file(s.c_str(), in.data)) {
+            return false;
+        }
+        in.log = sf::log_reader(in.data.data(), in.data.size());
+        in.is_log = in.log.begin();
+        return true;
+    }
+    if (in.fd < 0) {
+        fail("%s: cannot open", s.c_str());
+        return false;
+    }
+    return true;
+}
+
+/* Raise latest to the batch's latest sensor time, unwrapped, relative to
+ * the capture's first */
+static void capture_time(input &in, const sf::sample_columns &c, int64_t &latest)
+{
+    for (size_t i = 0; i < c.size(); i++) {
+        if (!c.timed[i]) {
+            continue;
+        }
+        if (!in.have_base) {
+            in.have_base = true;
+            in.unwrapped = c.timestamp_us[i];
+            in.base = in.unwrapped;
+        } else {
+            in.unwrapped += (int32_t)(c.timestamp_us[i] - in.last_ts);
+        }
+        in.last_ts = c.timestamp_us[i];
+        if (in.unwrapped - in.base > latest) {
+            latest = in.unwrapped - in.base;
+        }
+    }
+}
+
+/* Decode the next batch of an offline input; false at its end */
+static bool next_batch(input &in)
+{
+    in.cols.clear();
+    if (in.is_log) {
+        sf::log_record rec;
+        if (!in.log.next(rec)) {
+            return false;
+        }
+        if (rec.char_uuid == SF_LOG_STREAM) {
+            (void)in.dec.feed(rec.value, rec.len, in.cols);
+        } else {
+            (void)sf::decode_gatt(rec.char_uuid, rec.value, rec.len,
+                                  (uint32_t)rec.receive_us, in.cols);
+        }
+        in.next_us = rec.receive_us;
+        return true;
+    }
+
+    if (in.pos >= in.data.size()) {
+        return false;
+    }
+    size_t n = in.data.size() - in.pos < CAPTURE_CHUNK ? in.data.size() - in.pos : CAPTURE_CHUNK;
+    (void)in.dec.feed(&in.data[in.pos], n, in.cols);
+    in.pos += n;
+
+    /* Samples of one chunk are taken close together: stamp them with the
+     * latest; untimed ones keep the previous stamp */
+    int64_t latest = in.next_us;
+    capture_time(in, in.cols.quat, latest);
+    capture_time(in, in.cols.mag, latest);
+    capture_time(in, in.cols.linear_accel, latest);
+    capture_time(in, in.cols.battery, latest);
+    in.next_us = latest;
+    return true;
+}
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    s_stop = 1;
+}
+
+/* Serve WebSocket clients; send the batch when its period is up */
+static void ws_tick(int64_t now)
+{
+    if (!s_ws_on) {
+        return;
+    }
+    s_ws.service();
+    if (s_flush_us && now >= s_next_flush) {
+        s_ws.flush();
+        s_next_flush += s_flush_us;
+        if (s_next_flush <= now) {
+            s_next_flush = now + s_flush_us;
+        }
+    }
+}
+
+/* Poll timeout: no later than the next batch */
+static int wait_ms(int64_t now)
+{
+    if (!s_ws_on || !s_flush_us) {
+        return POLL_MS;
+    }
+    int64_t ms = (s_next_flush - now + 999) / 1000;
+    return ms < 0 ? 0 : (ms < POLL_MS ? (int)ms : POLL_MS);
+}
+
+static void sleep_us(int64_t us)
+{
+    struct timespec ts = {(time_t)(us / 1000000), (long)(us % 1000000) * 1000};
+
+    nanosleep(&ts, NULL);
+}
+
+/* Offline replay: wait until data time t is due, serving clients meanwhile */
+static void pace(int64_t t)
+{
+    static bool started;
+    static int64_t data0, wall0;
+
+    if (s_speed <= 0) {
+        return;
+    }
+    int64_t now = now_us();
+    if (!started) {
+        started = true;
+        data0 = t;
+        wall0 = now;
+    }
+    int64_t due = wall0 + (int64_t)((double)(t - data0) / s_speed);
+    while (now < due && !s_stop) {
+        int64_t until = due;
+        if (s_ws_on && s_flush_us && s_next_flush < until) {
+            until = s_next_flush;
+        }
+        if (s_ws_on && until - now > POLL_MS * 1000) {
+            until = now + POLL_MS * 1000;
+        }
+        if (until > now) {
+            sleep_us(until - now);
+        }
+        now = now_us();
+        ws_tick(now);
+    }
+}
+
+static void emit(std::vector<sf::merged_sample> &out)
+{
+    if (s_shm.is_open()) {
+        for (const sf::merged_sample &s : out) {
+            s_shm.publish(s);
+        }
+    }
+    if (s_ws_on) {
+        for (const sf::merged_sample &s : out) {
+            s_ws.add(s);
+        }
+        if (!s_flush_us) {
+            s_ws.flush();
+        }
+    }
+    if (!s_quiet) {
+        for (const sf::merged_sample &s : out) {
+            printf("%lld,%u,%c,%d,%.9g,%.9g,%.9g,%.9g\n", (long long)s.t_us, s.device, s.type,
+                   (s.flags & SF_MERGED_SENSOR_TIME) ? 1 : 0, s.v[0], s.v[1], s.v[2], s.v[3]);
+        }
+    }
+    out.clear();
+}
+
+static void run_offline(std::vector<input> &inputs, sf::merger &merge)
+{
+    std::vector<sf::merged_sample> out;
+
+    for (input &in : inputs) {
+        in.pending = next_batch(in);
+    }
+    while (!s_stop) {
+        /* Earliest pending batch; few devices, so a scan */
+        input *next = nullptr;
+        unsigned device = 0;
+        for (unsigned d = 0; d < inputs.size(); d++) {
+            if (inputs[d].pending && (!next || inputs[d].next_us < next->next_us)) {
+                next = &inputs[d];
+                device = d;
+            }
+        }
+        if (!next) {
+            break;
+        }
+        pace(next->next_us);
+        merge.push_columns(device, next->cols, next->next_us, out);
+        emit(out);
+        if (s_speed > 0) {
+            fflush(stdout);
+        }
+        next->pending = next_batch(*next);
+    }
+    merge.flush(out);
+    emit(out);
+}
+
+static int run_live(std::vector<input> &inputs, sf::merger &merge)
+{
+    std::vector<struct pollfd> fds(inputs.size());
+    std::vector<sf::merged_sample> out;
+    uint8_t buf[READ_CHUNK];
+    size_t open_fds = inputs.size();
+
+    for (size_t d = 0; d < inputs.size(); d++) {
+        fds[d].fd = inputs[d].fd;
+        fds[d].events = POLLIN;
+    }
+    while (open_fds > 0 && !s_stop) {
+        int n = poll(fds.data(), fds.size(), wait_ms(now_us()));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll");
+            return 1;
+        }
+        for (size_t d = 0; n > 0 && d < fds.size(); d++) {
+            if (!(fds[d].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            ssize_t len = read(fds[d].fd, buf, sizeof(buf));
+            if (len <= 0) {
+                if (len < 0 && errno == EINTR) {
+                    continue;
+                }
+                close(fds[d].fd);
+                fds[d].fd = -1;
+                open_fds--;
+                continue;
+            }
+            input &in = inputs[d];
+            in.cols.clear();
+            (void)in.dec.feed(buf, (size_t)len, in.cols);
+            merge.push_columns((unsigned)d, in.cols, now_us(), out);
+            emit(out);
+        }
+        merge.advance(now_us(), out);
+        emit(out);
+        ws_tick(now_us());
+        fflush(stdout);
+    }
+    merge.flush(out);
+    emit(out);
+    return 0;
+}
+
+/* Hello message for WebSocket clients: what each device index is */
+static std::string ws_hello(const std::vector<input> &inputs, const sf::merge_options &opts,
+                            double flush_hz)
+{
+    char buf[64];
+    std::string s = "{\"version\":1,\"mode\":\"";
+
+    s += opts.mode == sf::align_mode::sensor ? "sensor" : "arrival";
+    snprintf(buf, sizeof(buf), "\",\"flushHz\":%g,\"devices\":[", flush_hz);
+    s += buf;
+    for (size_t d = 0; d < inputs.size(); d++) {
+        s += d ? ",\"" : "\"";
+        for (char c : inputs[d].spec) {
+            if (c == '"' || c == '\\') {
+                s += '\\';
+                s += c;
+            } else if ((unsigned char)c < 0x20) {
+                snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)c);
+                s += buf;
+            } else {
+                s += c;
+            }
+        }
+        s += '"';
+    }
+    return s + "]}";
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: stream_merge [--mode sensor|arrival] [--ring N] [--max-delay MS]\n"
+            "                    [--idle MS] [--quiet] [--shm NAME [--shm-slots N]]\n"
+            "                    [--ws [HOST:]PORT [--ws-origin ORIGIN] [--flush-hz N]]\n"
+            "                    [--speed X] input...\n"
+            "input: path | - | unix:path | tcp:host:port\n");
+}
+
+/*******************************************************************************
+ * Main
+ ******************************************************************************/
+
+int main(int argc, char **argv)
+{
+    sf::merge_options opts;
+    std::vector<input> inputs;
+    size_t live = 0;
+    const char *shm_name = nullptr;
+    unsigned long shm_slots = SF_SHM_DEFAULT_CAPACITY;
+    sf::ws_options ws_opts;
+    double flush_hz = DEFAULT_FLUSH_HZ;
+    s_speed = -1;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (strcmp(a, "--mode") == 0 && has_value) {
+            const char *m = argv[++i];
+            if (strcmp(m, "sensor") == 0) {
+                opts.mode = sf::align_mode::sensor;
+            } else if (strcmp(m, "arrival") == 0) {
+                opts.mode = sf::align_mode::arrival;
+            } else {
+                return fail("--mode must be sensor or arrival, not %s", m);
+            }
+        } else if (strcmp(a, "--ring") == 0 && has_value) {
+            opts.capacity = strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(a, "--max-delay") == 0 && has_value) {
+            opts.max_delay_us = (int64_t)(strtod(argv[++i], NULL) * 1000);
+        } else if (strcmp(a, "--idle") == 0 && has_value) {
+            opts.idle_us = (int64_t)(strtod(argv[++i], NULL) * 1000);
+        } else if (strcmp(a, "--quiet") == 0) {
+            s_quiet = true;
+        } else if (strcmp(a, "--shm") == 0 && has_value) {
+            shm_name = argv[++i];
+        } else if (strcmp(a, "--shm-slots") == 0 && has_value) {
+            shm_slots = strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(a, "--ws") == 0 && has_value) {
+            std::string hp = argv[++i];
+            size_t colon = hp.rfind(':');
+            if (colon != std::string::npos) {
+                ws_opts.host = hp.substr(0, colon);
+            }
+            size_t port = colon == std::string::npos ? 0 : colon + 1;
+            ws_opts.port = (uint16_t)strtoul(hp.c_str() + port, NULL, 0);
+            s_ws_on = true;
+        } else if (strcmp(a, "--ws-origin") == 0 && has_value) {
+            ws_opts.origin = argv[++i];
+        } else if (strcmp(a, "--flush-hz") == 0 && has_value) {
+            flush_hz = strtod(argv[++i], NULL);
+        } else if (strcmp(a, "--speed") == 0 && has_value) {
+            s_speed = strtod(argv[++i], NULL);
+        } else if (a[0] == '-' && a[1] == '-') {
+            usage();
+            return 1;
+        } else {
+            inputs.emplace_back();
+            inputs.back().spec = a;
+        }
+    }
+    if (inputs.empty() || opts.capacity == 0 || inputs.size() > 65535 ||
+        shm_slots == 0 || shm_slots > (1UL << 30) || flush_hz < 0) {
+        usage();
+        return 1;
+    }
+
+    sf::merger merge(opts);
+    for (input &in : inputs) {
+        if (!open_input(in)) {
+            return 1;
+        }
+        live += in.live ? 1 : 0;
+        merge.add_device();
+    }
+    if (live != 0 && live != inputs.size()) {
+        return fail("%s", "offline and live inputs cannot be mixed");
+    }
+    if (s_speed < 0) {
+        s_speed = s_ws_on && !live ? 1.0 : 0.0;
+    }
+    if (shm_name || s_ws_on) {
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = on_signal;
+        sigaction(SIGINT, &sa, NULL);
+        sigaction(SIGTERM, &sa, NULL);
+    }
+    if (s_ws_on) {
+        if (!s_ws.listen(ws_opts)) {
+            fprintf(stderr, "stream_merge: --ws %s:%u: %s\n", ws_opts.host.c_str(),
+                    (unsigned)ws_opts.port, strerror(errno));
+            return 1;
+        }
+        s_ws.set_hello(ws_hello(inputs, opts, flush_hz));
+        s_flush_us = flush_hz > 0 ? (int64_t)(1e6 / flush_hz) : 0;
+        s_next_flush = now_us() + s_flush_us;
+        fprintf(stderr, "stream_merge: serving ws://%s:%u\n", ws_opts.host.c_str(),
+                (unsigned)s_ws.port());
+    }
+    if (shm_name) {
+        if (!s_shm.open(shm_name, (uint32_t)shm_slots, (uint32_t)inputs.size())) {
+            fprintf(stderr, "stream_merge: %s: %s\n", shm_name, strerror(errno));
+            return 1;
+        }
+    }
+
+    if (!s_quiet) {
+        printf("t_us,device,type,sensor_time,v0,v1,v2,v3\n");
+    }
+    int rc = 0;
+    if (live) {
+        rc = run_live(inputs, merge);
+    } else {
+        /* A replay nobody sees is pointless: wait for the page */
+        if (s_ws_on) {
+            fprintf(stderr, "stream_merge: waiting for a WebSocket client\n");
+        }
+        while (s_ws_on && s_ws.clients() == 0 && !s_stop) {
+            ws_tick(now_us());
+            sleep_us(POLL_MS * 1000);
+        }
+        run_offline(inputs, merge);
+    }
+    fflush(stdout);
+    if (s_ws_on) {
+        /* Let slow clients take the last batches, for a second at most */
+        s_ws.flush();
+        for (int i = 0; i < 1000 / POLL_MS && s_ws.queued() && !s_stop; i++) {
+            s_ws.service();
+            sleep_us(POLL_MS * 1000);
+        }
+    }
+
+    for (unsigned d = 0; d < inputs.size(); d++) {
+        const sf_decoder_stats_t &st = inputs[d].dec.stats();
+        fprintf(stderr, "device %u %s: %lu frames, %lu lost, offset %.0f us, skew %+.1f ppm\n",
+                d, inputs[d].spec.c_str(), (unsigned long)st.frames, (unsigned long)st.lost,
+                merge.clock(d).offset_us(), merge.clock(d).skew_ppm());
+    }
+    const sf::merge_stats &ms = merge.stats();
+    fprintf(stderr, "merged %llu of %llu samples: %llu late, %llu forced, %llu timed out\n",
+            (unsigned long long)ms.out, (unsigned long long)ms.in, (unsigned long long)ms.late,
+            (unsigned long long)ms.forced, (unsigned long long)ms.timed_out);
+    if (s_shm.is_open()) {
+        fprintf(stderr, "published %llu samples to %s\n",
+                (unsigned long long)s_shm.published(), shm_name);
+        s_shm.close();
+    }
+    if (s_ws_on) {
+        const sf::ws_stats &ws = s_ws.stats();
+        fprintf(stderr, "served %llu samples in %llu batches to %llu clients: %llu bytes, "
+                "%llu batches dropped\n", (unsigned long long)ws.samples,
+                (unsigned long long)ws.batches, (unsigned long long)ws.connections,
+                (unsigned long long)ws.bytes, (unsigned long long)ws.dropped);
+        s_ws.close();
+    }
+    return rc;
+}
@@ -0,0 +1,739 @@
+/**
+ * @file stream_merge.hpp
+ * @brief Header-only aggregator merging several devices' streams onto one
+ *        timeline
+ *
+ * Each device's samples (decoded by sf::decoder or sf::decode_gatt from
+ * stream_decoder.hpp) carry a sensor timestamp on that device's own clock
+ * and an arrival time on the receiver's clock. The merger maps every
+ * sample onto the receiver's clock and emits all devices' samples in one
+ * time-ordered stream.
+ *
+ * Alignment (clock_aligner): the transport delay, arrival - sensor time,
+ * is never below the true clock offset, so the smallest delay seen over a
+ * window bounds the offset from above and is reached whenever a packet
+ * goes out without queueing. The minima of consecutive windows are fitted
+ * with a line, so the estimate follows the crystal drift (rate skew)
+ * between the device and the receiver as well as the offset. With
+ * align_mode::arrival, or for samples without a sensor timestamp (after
+ * a sequence gap), the arrival time less the device's usual delay is used
+ * instead, but never earlier than the device's latest sample, so they
+ * keep their place in its order.
+ *
+ * Merge (merger): each device has a bounded reorder ring kept sorted by
+ * aligned time, and an indexed binary heap over the ring heads yields the
+ * earliest sample across devices (a k-way merge). A head is released
+ * once every active device has sent something later (the watermark), so
+ * the output is time-ordered. Three things bound the added latency: a
+ * device silent for idle_us no longer holds the others back, a sample
+ * held for max_delay_us is released regardless, and a device whose ring
+ * is full releases the earliest held sample. Samples that would land before
+ * something already released are counted as late and dropped, so the
+ * output never goes backwards.
+ *
+ * The notification log (sf::log_*) stores what a gateway received, with
+ * receive times, so captures can be merged offline exactly as they
+ * arrived: sketch stream bytes and IMU service values alike.
+ */
+
+#ifndef STREAM_MERGE_HPP
+#define STREAM_MERGE_HPP
+
+#include "stream_decoder.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace sf {
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SF_MERGE_DEFAULT_CAPACITY   256         /* Samples per device ring */
+#define SF_MERGE_DEFAULT_MAX_DELAY  100000      /* us */
+#define SF_MERGE_DEFAULT_IDLE       250000      /* us */
+#define SF_MERGE_DEFAULT_SLACK      2000        /* us */
+
+#define SF_ALIGN_WINDOW_US          500000      /* Sensor time per delay minimum */
+#define SF_ALIGN_WINDOWS            32          /* Minima in the drift fit */
+#define SF_ALIGN_MAX_SKEW           1e-3        /* Crystal tolerance, clamped */
+
+#define SF_MERGED_SENSOR_TIME       0x01        /* merged_sample.flags */
+
+#define SF_LOG_MAGIC                "SFLOG1\n"  /* 8 bytes with the NUL */
+#define SF_LOG_HEADER_LEN           8
+#define SF_LOG_RECORD_LEN           12          /* Before the value bytes */
+#define SF_LOG_STREAM               0           /* char_uuid of sketch stream bytes */
+
+/*******************************************************************************
+ * Data Structures
+ ******************************************************************************/
+
+enum class align_mode {
+    sensor,         /* Sensor timestamps, mapped with the skew estimate */
+    arrival,        /* Arrival times only */
+};
+
+/**
+ * @brief One sample of the merged stream
+ */
+struct merged_sample {
+    int64_t  t_us;          /* Receiver clock */
+    int64_t  arrival_us;
+    uint16_t device;
+    uint8_t  type;          /* SF_TYPE_* */
+    uint8_t  flags;         /* SF_MERGED_* */
+    float    v[4];          /* w, x, y, z / x, y, z / percent, millivolts */
+};
+
+struct merge_options {
+    align_mode mode = align_mode::sensor;
+    size_t  capacity = SF_MERGE_DEFAULT_CAPACITY;       /* Per device, rounded up to 2^n */
+    int64_t max_delay_us = SF_MERGE_DEFAULT_MAX_DELAY;  /* Longest a sample is held */
+    int64_t idle_us = SF_MERGE_DEFAULT_IDLE;            /* Silence before a device stops
+                                                           holding back the others */
+    int64_t slack_us = SF_MERGE_DEFAULT_SLACK;          /* Watermark margin for estimate
+                                                           updates */
+    int64_t window_us = SF_ALIGN_WINDOW_US;
+};
+
+struct merge_stats {
+    uint64_t in;            /* Samples pushed */
+    uint64_t out;           /* Released in order */
+    uint64_t late;          /* Dropped: earlier than the last release */
+    uint64_t forced;        /* Released because a ring was full */
+    uint64_t timed_out;     /* Released after max_delay_us */
+};
+
+/**
+ * @brief One notification log record; value points into the log
+ */
+struct log_record {
+    int64_t        receive_us;
+    uint16_t       char_uuid;   /* SF_LOG_STREAM or BLE_IMU_CHAR_*_UUID */
+    uint16_t       len;
+    const uint8_t *value;
+};
+
+/*******************************************************************************
+ * Clock Alignment
+ ******************************************************************************/
+
+/**
+ * @brief Maps one device's sensor clock onto the receiver's clock
+ */
+class clock_aligner {
+public:
+    explicit clock_aligner(int64_t window_us = SF_ALIGN_WINDOW_US) : window_us_(window_us)
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        have_ts_ = false;
+        last_ts_ = 0;
+        sensor_ = 0;
+        window_end_ = 0;
+        window_min_ = 0;
+        n_ = 0;
+        fit_x0_ = 0;
+        fit_a_ = 0;
+        fit_b_ = 0;
+        fitted_ = false;
+        delay_ = 0;
+    }
+
+    /**
+     * @brief Receiver time at which a sample was taken
+     * @param sensor_us  Sensor timestamp (32-bit, wraps)
+     * @param arrival_us Receive time
+     *
+     * Never later than arrival_us. Updates the estimate first.
+     */
+    int64_t map(uint32_t sensor_us, int64_t arrival_us)
+    {
+        if (!have_ts_) {
+            have_ts_ = true;
+            sensor_ = sensor_us;
+            window_end_ = sensor_ + window_us_;
+            window_min_ = arrival_us - sensor_;
+        } else {
+            sensor_ += (int32_t)(sensor_us - last_ts_);
+        }
+        last_ts_ = sensor_us;
+
+        int64_t d = arrival_us - sensor_;
+        if (sensor_ >= window_end_) {
+            commit(window_end_ - window_us_ / 2, window_min_);
+            window_end_ = sensor_ + window_us_;
+            window_min_ = d;
+        } else if (d < window_min_) {
+            window_min_ = d;
+        }
+
+        int64_t t = sensor_ + offset_at(sensor_);
+        if (t > arrival_us) {
+            t = arrival_us;
+        }
+        /* Usual delay, for samples that have no sensor time */
+        delay_ += ((double)(arrival_us - t) - delay_) / 64;
+        return t;
+    }
+
+    /* Arrival time less the usual delay */
+    int64_t map_untimed(int64_t arrival_us) const { return arrival_us - (int64_t)delay_; }
+
+    /* Receiver time minus sensor time, and its drift rate */
+    double offset_us() const { return have_ts_ ? (double)offset_at(sensor_) : 0; }
+    double skew_ppm() const { return fitted_ ? fit_b_ * 1e6 : 0; }
+
+private:
+    void commit(int64_t x, int64_t y)
+    {
+        if (n_ == SF_ALIGN_WINDOWS) {
+            std::memmove(&xs_[0], &xs_[1], (SF_ALIGN_WINDOWS - 1) * sizeof(xs_[0]));
+            std::memmove(&ys_[0], &ys_[1], (SF_ALIGN_WINDOWS - 1) * sizeof(ys_[0]));
+            n_--;
+        }
+        xs_[n_] = x;
+        ys_[n_] = y;
+        n_++;
+        if (n_ < 2) {
+            return;
+        }
+
+        /* Least squares through the window minima, x relative to the first */
+        double sx = 0, sy = 0, sxx = 0, sxy = 0;
+        for (unsigned i = 0; i < n_; i++) {
+            double dx = (double)(xs_[i] - xs_[0]);
+            double dy = (double)(ys_[i] - ys_[0]);
+            sx += dx;
+            sy += dy;
+            sxx += dx * dx;
+            sxy += dx * dy;
+        }
+        double n = (double)n_;
+        double den = n * sxx - sx * sx;
+        double b = den > 0 ? (n * sxy - sx * sy) / den : 0;
+        if (b > SF_ALIGN_MAX_SKEW) {
+            b = SF_ALIGN_MAX_SKEW;
+        } else if (b < -SF_ALIGN_MAX_SKEW) {
+            b = -SF_ALIGN_MAX_SKEW;
+        }
+        fit_x0_ = xs_[0];
+        fit_a_ = (double)ys_[0] + (sy - b * sx) / n;
+        fit_b_ = b;
+        fitted_ = true;
+    }
+
+    /* The fit, but never above the current window's minimum */
+    int64_t offset_at(int64_t sensor) const
+    {
+        if (!fitted_) {
+            return n_ > 0 && ys_[0] < window_min_ ? ys_[0] : window_min_;
+        }
+        int64_t fit = (int64_t)(fit_a_ + fit_b_ * (double)(sensor - fit_x0_));
+        return fit < window_min_ ? fit : window_min_;
+    }
+
+    int64_t  window_us_;
+    bool     have_ts_;
+    uint32_t last_ts_;
+    int64_t  sensor_;           /* Unwrapped sensor time */
+    int64_t  window_end_;
+    int64_t  window_min_;       /* Smallest arrival - sensor this window */
+    int64_t  xs_[SF_ALIGN_WINDOWS];
+    int64_t  ys_[SF_ALIGN_WINDOWS];
+    unsigned n_;
+    int64_t  fit_x0_;
+    double   fit_a_;            /* Offset at fit_x0_ */
+    double   fit_b_;            /* Offset change per us of sensor time */
+    bool     fitted_;
+    double   delay_;
+};
+
+/*******************************************************************************
+ * Private Helpers
+ ******************************************************************************/
+
+namespace detail {
+
+/**
+ * @brief Binary min-heap of small ids that knows where each id sits, so
+ *        an id's key can change in place
+ *
+ * Less compares two ids by their current keys.
+ */
+template <class Less>
+class index_heap {
+public:
+    explicit index_heap(Less less) : less_(less) {}
+
+    void resize(size_t ids) { pos_.resize(ids, NONE); }
+
+    void clear()
+    {
+        for (unsigned id : heap_) {
+            pos_[id] = NONE;
+        }
+        heap_.clear();
+    }
+
+    bool empty() const { return heap_.empty(); }
+    unsigned top() const { return heap_[0]; }
+    bool contains(unsigned id) const { return pos_[id] != NONE; }
+
+    void push(unsigned id)
+    {
+        heap_.push_back(id);
+        sift_up((unsigned)heap_.size() - 1, id);
+    }
+
+    void pop()
+    {
+        unsigned last = heap_.back();
+
+        pos_[heap_[0]] = NONE;
+        heap_.pop_back();
+        if (!heap_.empty()) {
+            sift_down(0, last);
+        }
+    }
+
+    /* The key of id went down (or up) */
+    void decreased(unsigned id) { sift_up(pos_[id], id); }
+    void increased(unsigned id) { sift_down(pos_[id], id); }
+
+private:
+    static constexpr unsigned NONE = ~0u;
+
+    void place(unsigned pos, unsigned id)
+    {
+        heap_[pos] = id;
+        pos_[id] = pos;
+    }
+
+    void sift_up(unsigned pos, unsigned id)
+    {
+        while (pos > 0) {
+            unsigned parent = (pos - 1) / 2;
+            if (!less_(id, heap_[parent])) {
+                break;
+            }
+            place(pos, heap_[parent]);
+            pos = parent;
+        }
+        place(pos, id);
+    }
+
+    void sift_down(unsigned pos, unsigned id)
+    {
+        unsigned n = (unsigned)heap_.size();
+
+        for (;;) {
+            unsigned child = 2 * pos + 1;
+            if (child >= n) {
+                break;
+            }
+            if (child + 1 < n && less_(heap_[child + 1], heap_[child])) {
+                child++;
+            }
+            if (!less_(heap_[child], id)) {
+                break;
+            }
+            place(pos, heap_[child]);
+            pos = child;
+        }
+        place(pos, id);
+    }
+
+    Less                  less_;
+    std::vector<unsigned> heap_;
+    std::vector<unsigned> pos_;     /* Index in heap_, NONE if absent */
+};
+
+} /* namespace detail */
+
+/*******************************************************************************
+ * Merger
+ ******************************************************************************/
+
+/**
+ * @brief k-way merge of per-device reorder rings onto one timeline
+ *
+ * push(), push_columns() and advance() append released samples to out,
+ * earliest first. Not copyable: the heaps point back at it.
+ */
+class merger {
+public:
+    explicit merger(const merge_options &opts = merge_options())
+        : opts_(opts), heads_(head_less{this}), horizons_(horizon_less{this})
+    {
+        capacity_ = 1;
+        while (capacity_ < opts_.capacity) {
+            capacity_ <<= 1;
+        }
+        reset();
+    }
+
+    merger(const merger &) = delete;
+    merger &operator=(const merger &) = delete;
+
+    /* Forget every device's samples and clock, keep the devices */
+    void reset()
+    {
+        std::memset(&stats_, 0, sizeof(stats_));
+        heads_.clear();
+        horizons_.clear();
+        now_ = INT64_MIN;
+        last_out_ = INT64_MIN;
+        for (device_state &d : devices_) {
+            d.clock.reset();
+            d.head = 0;
+            d.count = 0;
+            d.seen = false;
+        }
+    }
+
+    /**
+     * @brief Add a device
+     * @return Its index, used with push()
+     */
+    unsigned add_device()
+    {
+        devices_.emplace_back();
+        device_state &d = devices_.back();
+        d.clock = clock_aligner(opts_.window_us);
+        d.ring.resize(capacity_);
+        d.head = 0;
+        d.count = 0;
+        d.seen = false;
+        heads_.resize(devices_.size());
+        horizons_.resize(devices_.size());
+        return (unsigned)devices_.size() - 1;
+    }
+
+    size_t devices() const { return devices_.size(); }
+    const merge_stats &stats() const { return stats_; }
+    const clock_aligner &clock(unsigned device) const { return devices_[device].clock; }
+
+    /**
+     * @brief Add one sample of a device
+     * @param timed     False if sensor_us is unknown
+     * @param v, n      Values (n <= 4)
+     */
+    void push(unsigned device, uint8_t type, bool timed, uint32_t sensor_us, int64_t arrival_us,
+              const float *v, unsigned n, std::vector<merged_sample> &out)
+    {
+        add(device, type, timed, sensor_us, arrival_us, v, n, out);
+        release(out);
+    }
+
+    /**
+     * @brief Push every sample a decoder feed produced
+     *
+     * One notification may hold frames from several connection events;
+     * nothing is released until all of them are in, so the types pushed
+     * last are not late behind the types pushed first.
+     */
+    void push_columns(unsigned device, const columns &c, int64_t arrival_us,
+                      std::vector<merged_sample> &out)
+    {
+        float v[4];
+
+        for (size_t i = 0; i < c.quat.size(); i++) {
+            v[0] = c.quat.w[i];
+            v[1] = c.quat.x[i];
+            v[2] = c.quat.y[i];
+            v[3] = c.quat.z[i];
+            add(device, SF_TYPE_QUATERNION, c.quat.timed[i] != 0, c.quat.timestamp_us[i],
+                arrival_us, v, 4, out);
+        }
+        add_vec3(device, SF_TYPE_MAGNETOMETER, c.mag, arrival_us, out);
+        add_vec3(device, SF_TYPE_LINEAR_ACCEL, c.linear_accel, arrival_us, out);
+        for (size_t i = 0; i < c.battery.size(); i++) {
+            v[0] = c.battery.percent[i];
+            v[1] = c.battery.millivolts[i];
+            add(device, SF_TYPE_BATTERY, c.battery.timed[i] != 0, c.battery.timestamp_us[i],
+                arrival_us, v, 2, out);
+        }
+        release(out);
+    }
+
+    /**
+     * @brief Release what the receiver clock reaching now_us allows
+     *
+     * Call when no input arrived for a while, so silent devices and held
+     * samples time out.
+     */
+    void advance(int64_t now_us, std::vector<merged_sample> &out)
+    {
+        if (now_us > now_) {
+            now_ = now_us;
+        }
+        release(out);
+    }
+
+    /* Release everything held, in order (end of input) */
+    void flush(std::vector<merged_sample> &out)
+    {
+        while (!heads_.empty()) {
+            pop(out);
+        }
+    }
+
+private:
+    struct device_state {
+        clock_aligner              clock;
+        std::vector<merged_sample> ring;    /* Sorted by t_us from head */
+        size_t                     head;
+        size_t                     count;
+        int64_t                    horizon;         /* Latest t_us pushed */
+        int64_t                    last_arrival;
+        bool                       seen;
+    };
+
+    /* Ring heads, earliest first; ties by device index */
+    struct head_less {
+        merger *m;
+        bool operator()(unsigned a, unsigned b) const
+        {
+            int64_t ta = m->at(m->devices_[a], 0).t_us;
+            int64_t tb = m->at(m->devices_[b], 0).t_us;
+            return ta < tb || (ta == tb && a < b);
+        }
+    };
+
+    /* Active devices by horizon: the top bounds what may still arrive */
+    struct horizon_less {
+        merger *m;
+        bool operator()(unsigned a, unsigned b) const
+        {
+            int64_t ha = m->devices_[a].horizon;
+            int64_t hb = m->devices_[b].horizon;
+            return ha < hb || (ha == hb && a < b);
+        }
+    };
+
+    void add(unsigned device, uint8_t type, bool timed, uint32_t sensor_us, int64_t arrival_us,
+             const float *v, unsigned n, std::vector<merged_sample> &out)
+    {
+        device_state &d = devices_[device];
+        merged_sample s;
+
+        stats_.in++;
+        if (arrival_us > now_) {
+            now_ = arrival_us;
+        }
+        d.last_arrival = arrival_us;
+
+        s.arrival_us = arrival_us;
+        s.device = (uint16_t)device;
+        s.type = type;
+        if (timed && opts_.mode == align_mode::sensor) {
+            s.t_us = d.clock.map(sensor_us, arrival_us);
+            s.flags = SF_MERGED_SENSOR_TIME;
+        } else {
+            s.t_us = d.clock.map_untimed(arrival_us);
+            s.flags = 0;
+            if (d.seen && s.t_us < d.horizon) {
+                s.t_us = d.horizon;
+            }
+        }
+        for (unsigned i = 0; i < 4; i++) {
+            s.v[i] = i < n ? v[i] : 0;
+        }
+
+        if (!horizons_.contains(device)) {
+            d.horizon = d.seen && d.horizon > s.t_us ? d.horizon : s.t_us;
+            horizons_.push(device);
+        } else if (s.t_us > d.horizon) {
+            d.horizon = s.t_us;
+            horizons_.increased(device);
+        }
+        d.seen = true;
+
+        if (s.t_us < last_out_) {
+            stats_.late++;
+            return;
+        }
+        while (d.count == capacity_) {
+            stats_.forced++;
+            pop(out);
+        }
+        insert(device, s);
+    }
+
+    void add_vec3(unsigned device, uint8_t type, const vec3_columns &c, int64_t arrival_us,
+                  std::vector<merged_sample> &out)
+    {
+        float v[3];
+
+        for (size_t i = 0; i < c.size(); i++) {
+            v[0] = c.x[i];
+            v[1] = c.y[i];
+            v[2] = c.z[i];
+            add(device, type, c.timed[i] != 0, c.timestamp_us[i], arrival_us, v, 3, out);
+        }
+    }
+
+    merged_sample &at(device_state &d, size_t k) { return d.ring[(d.head + k) & (capacity_ - 1)]; }
+
+    /* Insertion from the back: a device's samples are nearly in order */
+    void insert(unsigned device, const merged_sample &s)
+    {
+        device_state &d = devices_[device];
+        size_t k = d.count;
+
+        while (k > 0 && at(d, k - 1).t_us > s.t_us) {
+            at(d, k) = at(d, k - 1);
+            k--;
+        }
+        at(d, k) = s;
+        d.count++;
+
+        if (!heads_.contains(device)) {
+            heads_.push(device);
+        } else if (k == 0) {
+            heads_.decreased(device);
+        }
+    }
+
+    /* Earliest held sample of all devices to out */
+    void pop(std::vector<merged_sample> &out)
+    {
+        unsigned device = heads_.top();
+        device_state &d = devices_[device];
+
+        out.push_back(at(d, 0));
+        last_out_ = at(d, 0).t_us;
+        stats_.out++;
+        d.head = (d.head + 1) & (capacity_ - 1);
+        d.count--;
+
+        if (d.count > 0) {
+            heads_.increased(device);
+        } else {
+            heads_.pop();
+        }
+    }
+
+    void release(std::vector<merged_sample> &out)
+    {
+        /* Devices silent for idle_us rejoin with their next sample */
+        while (!horizons_.empty() &&
+               now_ - devices_[horizons_.top()].last_arrival > opts_.idle_us) {
+            horizons_.pop();
+        }
+        int64_t watermark = horizons_.empty() ? INT64_MAX
+                                              : devices_[horizons_.top()].horizon - opts_.slack_us;
+
+        while (!heads_.empty()) {
+            const merged_sample &s = at(devices_[heads_.top()], 0);
+            if (s.t_us <= watermark) {
+                pop(out);
+            } else if (now_ - s.arrival_us >= opts_.max_delay_us) {
+                stats_.timed_out++;
+                pop(out);
+            } else {
+                break;
+            }
+        }
+    }
+
+    merge_options                        opts_;
+    size_t                               capacity_;
+    std::vector<device_state>            devices_;
+    detail::index_heap<head_less>        heads_;        /* Devices with held samples */
+    detail::index_heap<horizon_less>     horizons_;     /* Devices not idle */
+    int64_t                              now_;          /* Latest receiver time seen */
+    int64_t                              last_out_;
+    merge_stats                          stats_;
+};
+
+/*******************************************************************************
+ * Notification Log
+ *
+ * SF_LOG_MAGIC, then records of
+ *   receive_us (u64) | char_uuid (u16) | len (u16) | value (len bytes)
+ * little-endian. char_uuid is SF_LOG_STREAM for sketch stream bytes
+ * (frames may span records) or the IMU service characteristic the value
+ * was notified on.
+ ******************************************************************************/
+
+inline void log_begin(std::vector<uint8_t> &log)
+{
+    log.insert(log.end(), SF_LOG_MAGIC, SF_LOG_MAGIC + SF_LOG_HEADER_LEN);
+}
+
+inline void log_append(std::vector<uint8_t> &log, int64_t receive_us, uint16_t char_uuid,
+                       const uint8_t *value, uint16_t len)
+{
+    uint8_t rec[SF_LOG_RECORD_LEN];
+    uint64_t t = (uint64_t)receive_us;
+
+    for (unsigned i = 0; i < 8; i++) {
+        rec[i] = (uint8_t)(t >> (8 * i));
+    }
+    rec[8] = (uint8_t)char_uuid;
+    rec[9] = (uint8_t)(char_uuid >> 8);
+    rec[10] = (uint8_t)len;
+    rec[11] = (uint8_t)(len >> 8);
+    log.insert(log.end(), rec, rec + sizeof(rec));
+    log.insert(log.end(), value, value + len);
+}
+
+/**
+ * @brief Iterates the records of a log held in memory
+ */
+class log_reader {
+public:
+    log_reader(const uint8_t *data, size_t len) : data_(data), len_(len), pos_(0) {}
+
+    /* False if the header is not SF_LOG_MAGIC */
+    bool begin()
+    {
+        if (len_ < SF_LOG_HEADER_LEN || std::memcmp(data_, SF_LOG_MAGIC, SF_LOG_HEADER_LEN) != 0) {
+            return false;
+        }
+        pos_ = SF_LOG_HEADER_LEN;
+        return true;
+    }
+
+    /* False at the end; a truncated last record also ends the log */
+    bool next(log_record &rec)
+    {
+        if (len_ - pos_ < SF_LOG_RECORD_LEN) {
+            return false;
+        }
+        const uint8_t *p = data_ + pos_;
+        uint64_t t = 0;
+        for (unsigned i = 0; i < 8; i++) {
+            t |= (uint64_t)p[i] << (8 * i);
+        }
+        rec.receive_us = (int64_t)t;
+        rec.char_uuid = (uint16_t)(p[8] | (p[9] << 8));
+        rec.len = (uint16_t)(p[10] | (p[11] << 8));
+        if (len_ - pos_ - SF_LOG_RECORD_LEN < rec.len) {
+            return false;
+        }
+        rec.value = p + SF_LOG_RECORD_LEN;
+        pos_ += SF_LOG_RECORD_LEN + rec.len;
+        return true;
+    }
+
+    bool at_end() const { return pos_ == len_; }
+
+private:
+    const uint8_t *data_;
+    size_t         len_;
+    size_t         pos_;
+};
+
+} /* namespace sf */
+
+#endif /* STREAM_MERGE_HPP */
@@ -0,0 +1,464 @@
+/**
+ * @file stream_shm.hpp
+ * @brief Shared-memory ring publishing merged samples to local processes
+ *
+ * One publisher (stream_merge --shm) writes every merged sample
+ * (stream_merge.hpp) into a POSIX shared-memory segment; any number of
+ * subscribers in other processes map it read-only and read at memory
+ * speed, with no copy through the kernel and no system call per sample.
+ *
+ * The segment holds:
+ *   - a ring of 2^n slots, one cache line each. Slot i % capacity holds
+ *     sample i; its sequence word is 2i + 1 while the publisher writes
+ *     it and 2i + 2 once it is complete, so a reader that copies a slot
+ *     and sees the same even sequence before and after got an intact
+ *     sample, and a larger sequence means the publisher lapped it.
+ *     Each subscriber keeps its own cursor: a slow one loses the oldest
+ *     samples (and is told how many) but never slows the publisher or
+ *     other subscribers.
+ *   - a latest-value slot per device and sample type under the same
+ *     seqlock, for consumers such as a renderer that only want the
+ *     current orientation.
+ *
+ * Slot contents are copied as relaxed 64-bit atomics between the
+ * sequence loads and stores, so concurrent access is well defined;
+ * 64-bit atomics are address-free wherever they are lock-free, which is
+ * checked at compile time.
+ */
+
+#ifndef STREAM_SHM_HPP
+#define STREAM_SHM_HPP
+
+#include "stream_merge.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sf {
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SF_SHM_MAGIC                "SFSHM1\n"  /* 8 bytes with the NUL */
+#define SF_SHM_VERSION              1
+#define SF_SHM_DEFAULT_CAPACITY     65536       /* Slots, about 11 s of 10 devices */
+#define SF_SHM_DEFAULT_DEVICES      64          /* Latest-value slots */
+#define SF_SHM_TYPES                4           /* Q, M, A, B */
+#define SF_SHM_LINE                 64
+#define SF_SHM_WORDS                5           /* merged_sample as 64-bit words */
+
+/*******************************************************************************
+ * Data Structures
+ ******************************************************************************/
+
+static_assert(sizeof(merged_sample) == SF_SHM_WORDS * 8, "merged_sample layout");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared 64-bit atomics");
+
+/**
+ * @brief One sample and its seqlock, one cache line
+ */
+struct alignas(SF_SHM_LINE) shm_slot {
+    std::atomic<uint64_t> seq;                  /* Odd while written */
+    std::atomic<uint64_t> words[SF_SHM_WORDS];  /* merged_sample */
+    std::atomic<uint64_t> publish_ns;           /* CLOCK_MONOTONIC when published */
+};
+
+/**
+ * @brief Start of the segment; the ring and latest-value slots follow
+ */
+struct shm_header {
+    char     magic[8];
+    uint32_t version;
+    uint32_t capacity;          /* Ring slots, 2^n */
+    uint32_t devices;           /* Latest-value slots: devices x SF_SHM_TYPES */
+    uint32_t slot_size;
+    uint64_t size;              /* Whole segment */
+    int32_t  publisher_pid;
+
+    /* Written per sample: a line of their own */
+    alignas(SF_SHM_LINE) std::atomic<uint64_t> write_index;     /* Samples published */
+    std::atomic<uint32_t> closed;                               /* Publisher has exited */
+};
+
+/*******************************************************************************
+ * Private Helpers
+ ******************************************************************************/
+
+namespace detail {
+
+inline uint64_t monotonic_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+inline int shm_type_index(uint8_t type)
+{
+    switch (type) {
+    case SF_TYPE_QUATERNION:   return 0;
+    case SF_TYPE_MAGNETOMETER: return 1;
+    case SF_TYPE_LINEAR_ACCEL: return 2;
+    case SF_TYPE_BATTERY:      return 3;
+    default:                   return -1;
+    }
+}
+
+inline size_t shm_size(uint32_t capacity, uint32_t devices)
+{
+    return sizeof(shm_header) +
+           ((size_t)capacity + (size_t)devices * SF_SHM_TYPES) * sizeof(shm_slot);
+}
+
+inline void slot_write(shm_slot &slot, uint64_t seq, const merged_sample &s, uint64_t ns)
+{
+    uint64_t w[SF_SHM_WORDS];
+
+    std::memcpy(w, &s, sizeof(w));
+    slot.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (unsigned i = 0; i < SF_SHM_WORDS; i++) {
+        slot.words[i].store(w[i], std::memory_order_relaxed);
+    }
+    slot.publish_ns.store(ns, std::memory_order_relaxed);
+    slot.seq.store(seq + 2, std::memory_order_release);
+}
+
+/* Sequence the slot had throughout the copy, or odd if it changed */
+inline uint64_t slot_read(const shm_slot &slot, merged_sample &s, uint64_t &ns)
+{
+    uint64_t w[SF_SHM_WORDS];
+    uint64_t before = slot.seq.load(std::memory_order_acquire);
+
+    for (unsigned i = 0; i < SF_SHM_WORDS; i++) {
+        w[i] = slot.words[i].load(std::memory_order_relaxed);
+    }
+    ns = slot.publish_ns.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) != before) {
+        return 1;
+    }
+    std::memcpy(&s, w, sizeof(w));
+    return before;
+}
+
+} /* namespace detail */
+
+/*******************************************************************************
+ * Publisher
+ ******************************************************************************/
+
+/**
+ * @brief Creates the segment and writes samples into it
+ *
+ * Calls return false with errno set on failure.
+ */
+class shm_publisher {
+public:
+    shm_publisher() : hdr_(nullptr), size_(0) {}
+    ~shm_publisher() { close(); }
+
+    shm_publisher(const shm_publisher &) = delete;
+    shm_publisher &operator=(const shm_publisher &) = delete;
+
+    /**
+     * @brief Create (or replace) the segment
+     * @param name     shm_open() name, "/..."
+     * @param capacity Ring slots, rounded up to 2^n
+     * @param devices  Devices with latest-value slots
+     */
+    bool open(const char *name, uint32_t capacity = SF_SHM_DEFAULT_CAPACITY,
+              uint32_t devices = SF_SHM_DEFAULT_DEVICES)
+    {
+        uint32_t cap = 1;
+
+        close();
+        while (cap < capacity) {
+            cap <<= 1;
+        }
+        size_t size = detail::shm_size(cap, devices);
+
+        /* Replace, not reuse: subscribers of an old one keep their mapping */
+        (void)shm_unlink(name);
+        int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        if (ftruncate(fd, (off_t)size) != 0) {
+            int e = errno;
+            ::close(fd);
+            (void)shm_unlink(name);
+            errno = e;
+            return false;
+        }
+        void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) {
+            int e = errno;
+            (void)shm_unlink(name);
+            errno = e;
+            return false;
+        }
+
+        /* ftruncate() zero-fills: every sequence starts at 0 (never written) */
+        hdr_ = static_cast<shm_header *>(p);
+        size_ = size;
+        std::strncpy(name_, name, sizeof(name_) - 1);
+        name_[sizeof(name_) - 1] = '\0';
+        hdr_->version = SF_SHM_VERSION;
+        hdr_->capacity = cap;
+        hdr_->devices = devices;
+        hdr_->slot_size = sizeof(shm_slot);
+        hdr_->size = size;
+        hdr_->publisher_pid = (int32_t)getpid();
+        ring_ = reinterpret_cast<shm_slot *>(hdr_ + 1);
+        latest_ = ring_ + cap;
+        mask_ = cap - 1;
+        next_ = 0;
+
+        /* Magic last: a subscriber that sees it sees the rest */
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(hdr_->magic, SF_SHM_MAGIC, sizeof(hdr_->magic));
+        return true;
+    }
+
+    /* Mark the stream ended and remove the name; mappings stay valid */
+    void close()
+    {
+        if (!hdr_) {
+            return;
+        }
+        hdr_->closed.store(1, std::memory_order_release);
+        (void)shm_unlink(name_);
+        munmap(hdr_, size_);
+        hdr_ = nullptr;
+    }
+
+    bool is_open() const { return hdr_ != nullptr; }
+    uint64_t published() const { return next_; }
+
+    /* Append to the ring and update the device's latest value */
+    void publish(const merged_sample &s)
+    {
+        uint64_t ns = detail::monotonic_ns();
+        int type = detail::shm_type_index(s.type);
+
+        detail::slot_write(ring_[next_ & mask_], 2 * next_, s, ns);
+        next_++;
+        hdr_->write_index.store(next_, std::memory_order_release);
+
+        if (type >= 0 && s.device < hdr_->devices) {
+            shm_slot &slot = latest_[s.device * SF_SHM_TYPES + type];
+            detail::slot_write(slot, slot.seq.load(std::memory_order_relaxed), s, ns);
+        }
+    }
+
+private:
+    shm_header *hdr_;
+    shm_slot   *ring_;
+    shm_slot   *latest_;
+    size_t      size_;
+    uint64_t    mask_;
+    uint64_t    next_;          /* Index of the next sample */
+    char        name_[256];
+};
+
+/*******************************************************************************
+ * Subscriber
+ ******************************************************************************/
+
+/**
+ * @brief Read-only view of a publisher's segment
+ *
+ * Starts at the newest sample; read() returns what was published since.
+ */
+class shm_subscriber {
+public:
+    shm_subscriber() : hdr_(nullptr), size_(0), cursor_(0), lost_(0) {}
+    ~shm_subscriber() { close(); }
+
+    shm_subscriber(const shm_subscriber &) = delete;
+    shm_subscriber &operator=(const shm_subscriber &) = delete;
+
+    /**
+     * @brief Map a publisher's segment
+     * @return false with errno set (EPROTO if it is not one)
+     */
+    bool open(const char *name)
+    {
+        struct stat st;
+
+        close();
+        int fd = shm_open(name, O_RDONLY, 0);
+        if (fd < 0) {
+            return false;
+        }
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(shm_header)) {
+            ::close(fd);
+            errno = EPROTO;
+            return false;
+        }
+        void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) {
+            return false;
+        }
+
+        const shm_header *h = static_cast<const shm_header *>(p);
+        if (std::memcmp(h->magic, SF_SHM_MAGIC, sizeof(h->magic)) != 0 ||
+            h->version != SF_SHM_VERSION || h->slot_size != sizeof(shm_slot) ||
+            h->size != (uint64_t)st.st_size ||
+            h->size != detail::shm_size(h->capacity, h->devices)) {
+            munmap(p, (size_t)st.st_size);
+            errno = EPROTO;
+            return false;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        hdr_ = h;
+        size_ = (size_t)st.st_size;
+        ring_ = reinterpret_cast<const shm_slot *>(hdr_ + 1);
+        latest_ = ring_ + hdr_->capacity;
+        mask_ = hdr_->capacity - 1;
+        cursor_ = hdr_->write_index.load(std::memory_order_acquire);
+        lost_ = 0;
+        return true;
+    }
+
+    void close()
+    {
+        if (hdr_) {
+            munmap(const_cast<shm_header *>(hdr_), size_);
+            hdr_ = nullptr;
+        }
+    }
+
+    const shm_header *header() const { return hdr_; }
+
+    /* Samples skipped because the publisher lapped this subscriber */
+    uint64_t lost() const { return lost_; }
+
+    /* The publisher has exited and everything it wrote has been read */
+    bool ended() const
+    {
+        return hdr_->closed.load(std::memory_order_acquire) &&
+               cursor_ == hdr_->write_index.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Copy up to max samples published since the last call
+     * @param publish_ns If not null, when each was published
+     * @return Samples copied; 0 if there is nothing new
+     */
+    size_t read(merged_sample *out, size_t max, uint64_t *publish_ns = nullptr)
+    {
+        uint64_t end = hdr_->write_index.load(std::memory_order_acquire);
+        size_t n = 0;
+
+        while (n < max && cursor_ < end) {
+            /* Lapped: the oldest capacity samples are all that remain */
+            if (end - cursor_ > mask_ + 1) {
+                lost_ += end - cursor_ - (mask_ + 1);
+                cursor_ = end - (mask_ + 1);
+            }
+            uint64_t ns;
+            uint64_t seq = detail::slot_read(ring_[cursor_ & mask_], out[n], ns);
+            if (seq != 2 * cursor_ + 2) {
+                /* Overwritten while copying: resume at the oldest intact slot */
+                end = hdr_->write_index.load(std::memory_order_acquire);
+                uint64_t resume = end > mask_ + 1 ? end - (mask_ + 1) : 0;
+                if (resume <= cursor_) {
+                    resume = cursor_ + 1;
+                }
+                lost_ += resume - cursor_;
+                cursor_ = resume;
+                continue;
+            }
+            if (publish_ns) {
+                publish_ns[n] = ns;
+            }
+            cursor_++;
+            n++;
+        }
+        return n;
+    }
+
+    /**
+     * @brief Wait until read() has something, spinning first, then sleeping
+     * @param spins     Polls before the first sleep (no system calls)
+     * @param sleep_ns  Sleep between later polls
+     * @param timeout_ns Give up after this long (0: wait for ever)
+     * @return false on timeout or when the stream has ended
+     */
+    bool wait(unsigned spins, long sleep_ns, uint64_t timeout_ns = 0)
+    {
+        uint64_t start = 0;
+
+        for (unsigned i = 0;; i++) {
+            if (hdr_->write_index.load(std::memory_order_acquire) != cursor_) {
+                return true;
+            }
+            if (hdr_->closed.load(std::memory_order_acquire)) {
+                return false;
+            }
+            if (i < spins) {
+                continue;
+            }
+            if (start == 0) {
+                start = detail::monotonic_ns();
+            } else if (timeout_ns && detail::monotonic_ns() - start >= timeout_ns) {
+                return false;
+            }
+            struct timespec ts = {0, sleep_ns};
+            nanosleep(&ts, nullptr);
+        }
+    }
+
+    /**
+     * @brief Latest sample of one device and type
+     * @return false if none was published yet
+     */
+    bool latest(unsigned device, uint8_t type, merged_sample &out,
+                uint64_t *publish_ns = nullptr) const
+    {
+        int t = detail::shm_type_index(type);
+        uint64_t ns, seq;
+
+        if (t < 0 || device >= hdr_->devices) {
+            return false;
+        }
+        const shm_slot &slot = latest_[device * SF_SHM_TYPES + t];
+        while ((seq = detail::slot_read(slot, out, ns)) & 1) {
+        }
+        if (seq == 0) {
+            return false;
+        }
+        if (publish_ns) {
+            *publish_ns = ns;
+        }
+        return true;
+    }
+
+private:
+    const shm_header *hdr_;
+    const shm_slot   *ring_;
+    const shm_slot   *latest_;
+    size_t            size_;
+    uint64_t          mask_;
+    uint64_t          cursor_;      /* Next sample index to read */
+    uint64_t          lost_;
+};
+
+} /* namespace sf */
+
+#endif /* STREAM_SHM_HPP */
@@ -0,0 +1,731 @@
+/**
+ * @file stream_ws.hpp
+ * @brief Local WebSocket server sending merged samples in binary batches
+ *
+ * The web client (lib/streamBridge.ts) gets one JS callback per BLE
+ * notification from Web Bluetooth, and only Chromium has Web Bluetooth.
+ * stream_merge --ws serves any of its inputs (UART, pty, capture or log
+ * replay) to the browser through this server instead. Samples collect in
+ * a batch that is sent every flush period as a single binary message,
+ * so at 60 Hz the page handles one message per animation frame however
+ * many samples it carries.
+ *
+ * Batch message, little-endian:
+ *   Header (SF_WS_HEADER_SIZE bytes)
+ *     u8  version         SF_WS_BATCH_VERSION
+ *     u8  record_size     SF_WS_RECORD_SIZE
+ *     u16 count
+ *     u32 seq             Per client; a gap means batches were dropped
+ *                         because the client fell behind
+ *     f64 base_us         t_us of the first record (receiver clock)
+ *   count records (SF_WS_RECORD_SIZE bytes, 4-byte aligned)
+ *     u16 device
+ *     u8  type            SF_TYPE_* ('Q', 'M', 'A', 'B')
+ *     u8  flags           SF_MERGED_*
+ *     u32 dt_us           t_us - base_us
+ *     f32 v[4]            As merged_sample.v
+ *
+ * After the handshake the server sends one text message, the hello
+ * string given to set_hello() (stream_merge sends its inputs as JSON).
+ *
+ * The server is single-threaded and non-blocking: service() accepts,
+ * completes handshakes, answers ping and close and drains queued output;
+ * the owner calls it from its own loop. A client that cannot keep up
+ * has whole batches dropped once SF_WS_MAX_QUEUED bytes are waiting for
+ * it, never part of one, and never holds up the other clients.
+ */
+
+#ifndef STREAM_WS_HPP
+#define STREAM_WS_HPP
+
+#include "stream_merge.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace sf {
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SF_WS_BATCH_VERSION         1
+#define SF_WS_HEADER_SIZE           16
+#define SF_WS_RECORD_SIZE           24
+#define SF_WS_MAX_BATCH             4096        /* Records; sent early when full */
+#define SF_WS_MAX_QUEUED            (1u << 20)  /* Bytes per client before dropping */
+#define SF_WS_MAX_REQUEST           8192        /* Handshake request */
+#define SF_WS_MAX_CONTROL           125         /* Client frames we keep */
+#define SF_WS_DEFAULT_PORT          8765
+#define SF_WS_FRAME_ROOM            10          /* Largest server frame header */
+
+#define SF_WS_OP_TEXT               0x1
+#define SF_WS_OP_BINARY             0x2
+#define SF_WS_OP_CLOSE              0x8
+#define SF_WS_OP_PING               0x9
+#define SF_WS_OP_PONG               0xA
+
+/*******************************************************************************
+ * Data Structures
+ ******************************************************************************/
+
+struct ws_options {
+    std::string host = "127.0.0.1";     /* Loopback unless asked otherwise */
+    uint16_t    port = SF_WS_DEFAULT_PORT;
+    std::string origin;                 /* If set, refuse other Origin headers */
+    size_t      max_queued = SF_WS_MAX_QUEUED;
+};
+
+struct ws_stats {
+    uint64_t connections;       /* Completed handshakes */
+    uint64_t rejected;          /* Bad or refused handshakes */
+    uint64_t batches;           /* Flushed, whoever received them */
+    uint64_t samples;
+    uint64_t bytes;             /* Handed to the kernel, all clients */
+    uint64_t dropped;           /* Batches dropped for slow clients */
+};
+
+/*******************************************************************************
+ * Private Helpers
+ ******************************************************************************/
+
+namespace detail {
+
+inline uint32_t rol32(uint32_t x, unsigned n) { return (x << n) | (x >> (32 - n)); }
+
+/* SHA-1, for Sec-WebSocket-Accept only */
+inline void sha1(const uint8_t *data, size_t len, uint8_t out[20])
+{
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    std::vector<uint8_t> msg(data, data + len);
+    uint64_t bits = (uint64_t)len * 8;
+
+    msg.push_back(0x80);
+    while (msg.size() % 64 != 56) {
+        msg.push_back(0);
+    }
+    for (int i = 7; i >= 0; i--) {
+        msg.push_back((uint8_t)(bits >> (i * 8)));
+    }
+
+    for (size_t block = 0; block < msg.size(); block += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            const uint8_t *p = &msg[block + i * 4];
+            w[i] = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+        }
+        for (int i = 16; i < 80; i++) {
+            w[i] = rol32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t t = rol32(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rol32(b, 30);
+            b = a;
+            a = t;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+    for (int i = 0; i < 5; i++) {
+        out[i * 4 + 0] = (uint8_t)(h[i] >> 24);
+        out[i * 4 + 1] = (uint8_t)(h[i] >> 16);
+        out[i * 4 + 2] = (uint8_t)(h[i] >> 8);
+        out[i * 4 + 3] = (uint8_t)h[i];
+    }
+}
+
+inline std::string base64(const uint8_t *data, size_t len)
+{
+    static const char digits[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = (uint32_t)data[i] << 16;
+        if (i + 1 < len) v |= (uint32_t)data[i + 1] << 8;
+        if (i + 2 < len) v |= data[i + 2];
+        out += digits[(v >> 18) & 63];
+        out += digits[(v >> 12) & 63];
+        out += i + 1 < len ? digits[(v >> 6) & 63] : '=';
+        out += i + 2 < len ? digits[v & 63] : '=';
+    }
+    return out;
+}
+
+/* Sec-WebSocket-Accept for a client's Sec-WebSocket-Key */
+inline std::string ws_accept(const std::string &key)
+{
+    std::string s = key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    uint8_t digest[20];
+
+    sha1(reinterpret_cast<const uint8_t *>(s.data()), s.size(), digest);
+    return base64(digest, sizeof(digest));
+}
+
+/* Value of a header in a request, "" if absent; names are case-insensitive */
+inline std::string http_header(const std::string &req, const char *name)
+{
+    size_t n = strlen(name);
+    size_t pos = req.find("\r\n");
+
+    while (pos != std::string::npos && pos + 2 < req.size()) {
+        size_t line = pos + 2;
+        size_t end = req.find("\r\n", line);
+        if (end == std::string::npos || end == line) {
+            break;
+        }
+        if (end - line > n && req[line + n] == ':' &&
+            strncasecmp(req.c_str() + line, name, n) == 0) {
+            size_t v = line + n + 1;
+            while (v < end && (req[v] == ' ' || req[v] == '\t')) {
+                v++;
+            }
+            size_t e = end;
+            while (e > v && (req[e - 1] == ' ' || req[e - 1] == '\t')) {
+                e--;
+            }
+            return req.substr(v, e - v);
+        }
+        pos = end;
+    }
+    return std::string();
+}
+
+/* Whether a comma-separated header value lists token, ignoring case */
+inline bool http_has_token(const std::string &value, const char *token)
+{
+    size_t n = strlen(token);
+
+    for (size_t pos = 0; pos < value.size();) {
+        while (pos < value.size() && (value[pos] == ' ' || value[pos] == ',')) {
+            pos++;
+        }
+        size_t end = value.find(',', pos);
+        if (end == std::string::npos) {
+            end = value.size();
+        }
+        size_t e = end;
+        while (e > pos && value[e - 1] == ' ') {
+            e--;
+        }
+        if (e - pos == n && strncasecmp(value.c_str() + pos, token, n) == 0) {
+            return true;
+        }
+        pos = end;
+    }
+    return false;
+}
+
+/* Write a server frame header just before end; returns its length */
+inline size_t ws_frame_header(uint8_t *end, uint8_t opcode, size_t len)
+{
+    if (len < 126) {
+        end[-2] = (uint8_t)(0x80 | opcode);
+        end[-1] = (uint8_t)len;
+        return 2;
+    }
+    if (len <= 0xFFFF) {
+        end[-4] = (uint8_t)(0x80 | opcode);
+        end[-3] = 126;
+        end[-2] = (uint8_t)(len >> 8);
+        end[-1] = (uint8_t)len;
+        return 4;
+    }
+    end[-10] = (uint8_t)(0x80 | opcode);
+    end[-9] = 127;
+    for (int i = 0; i < 8; i++) {
+        end[-1 - i] = (uint8_t)((uint64_t)len >> (i * 8));
+    }
+    return 10;
+}
+
+} /* namespace detail */
+
+/*******************************************************************************
+ * Server
+ ******************************************************************************/
+
+class ws_server {
+public:
+    ws_server() : listen_fd_(-1), count_(0), base_us_(0), stats_() { reset_batch(); }
+    ~ws_server() { close(); }
+
+    ws_server(const ws_server &) = delete;
+    ws_server &operator=(const ws_server &) = delete;
+
+    /**
+     * @brief Listen on opts.host:opts.port
+     * @return false with errno set
+     */
+    bool listen(const ws_options &opts)
+    {
+        struct sockaddr_in addr;
+        int one = 1;
+
+        opts_ = opts;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(opts.port);
+        if (inet_pton(AF_INET, opts.host.c_str(), &addr.sin_addr) != 1) {
+            errno = EINVAL;
+            return false;
+        }
+        listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        if (listen_fd_ < 0) {
+            return false;
+        }
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(listen_fd_, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+            ::listen(listen_fd_, 16) != 0) {
+            int e = errno;
+            ::close(listen_fd_);
+            listen_fd_ = -1;
+            errno = e;
+            return false;
+        }
+        set_nonblocking(listen_fd_);
+        return true;
+    }
+
+    /* Port actually bound (for port 0) */
+    uint16_t port() const
+    {
+        struct sockaddr_in addr;
+        socklen_t len = sizeof(addr);
+
+        if (getsockname(listen_fd_, (struct sockaddr *)&addr, &len) != 0) {
+            return 0;
+        }
+        return ntohs(addr.sin_port);
+    }
+
+    /* Text message each client gets after its handshake */
+    void set_hello(const std::string &hello) { hello_ = hello; }
+
+    /* Clients past the handshake */
+    size_t clients() const
+    {
+        size_t n = 0;
+        for (const client &c : clients_) {
+            n += c.open ? 1 : 0;
+        }
+        return n;
+    }
+
+    const ws_stats &stats() const { return stats_; }
+
+    /* Pending records in the current batch */
+    size_t pending() const { return count_; }
+
+    /* Bytes waiting for slow clients */
+    size_t queued() const
+    {
+        size_t n = 0;
+        for (const client &c : clients_) {
+            n += c.fd >= 0 ? c.queued() : 0;
+        }
+        return n;
+    }
+
+    /**
+     * @brief Accept, handshake, answer control frames, drain queues
+     *
+     * Never blocks; call it at least as often as flush().
+     */
+    void service()
+    {
+        std::vector<struct pollfd> fds(clients_.size() + 1);
+
+        fds[0].fd = listen_fd_;
+        fds[0].events = POLLIN;
+        for (size_t i = 0; i < clients_.size(); i++) {
+            fds[i + 1].fd = clients_[i].fd;
+            fds[i + 1].events = (short)(POLLIN | (clients_[i].queued() ? POLLOUT : 0));
+        }
+        if (poll(fds.data(), fds.size(), 0) <= 0) {
+            return;
+        }
+        for (size_t i = 0; i < clients_.size(); i++) {
+            short rev = fds[i + 1].revents;
+            client &c = clients_[i];
+            if (rev & (POLLIN | POLLHUP | POLLERR)) {
+                receive(c);
+            }
+            if (c.fd >= 0 && (rev & POLLOUT)) {
+                drain(c);
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            accept_all();
+        }
+        /* Drop closed clients */
+        size_t kept = 0;
+        for (size_t i = 0; i < clients_.size(); i++) {
+            if (clients_[i].fd >= 0) {
+                if (kept != i) {
+                    clients_[kept] = std::move(clients_[i]);
+                }
+                kept++;
+            }
+        }
+        clients_.resize(kept);
+    }
+
+    /* Append a sample to the batch; a full batch is sent at once */
+    void add(const merged_sample &s)
+    {
+        if (count_ == 0) {
+            base_us_ = s.t_us;
+        }
+        uint8_t *r = &batch_[SF_WS_FRAME_ROOM + SF_WS_HEADER_SIZE + count_ * SF_WS_RECORD_SIZE];
+        uint32_t dt = (uint32_t)(s.t_us - base_us_);
+
+        put16(r, s.device);
+        r[2] = s.type;
+        r[3] = s.flags;
+        put32(r + 4, dt);
+        for (unsigned k = 0; k < 4; k++) {
+            uint32_t bits;
+            memcpy(&bits, &s.v[k], sizeof(bits));
+            put32(r + 8 + k * 4, bits);
+        }
+        if (++count_ == SF_WS_MAX_BATCH) {
+            flush();
+        }
+    }
+
+    /* Send the batch to every client, if it has any records */
+    void flush()
+    {
+        if (count_ == 0) {
+            return;
+        }
+        uint8_t *payload = &batch_[SF_WS_FRAME_ROOM];
+        size_t len = SF_WS_HEADER_SIZE + count_ * SF_WS_RECORD_SIZE;
+        double base = (double)base_us_;
+
+        payload[0] = SF_WS_BATCH_VERSION;
+        payload[1] = SF_WS_RECORD_SIZE;
+        put16(payload + 2, (uint16_t)count_);
+        uint64_t bits;
+        memcpy(&bits, &base, sizeof(bits));
+        put32(payload + 8, (uint32_t)bits);
+        put32(payload + 12, (uint32_t)(bits >> 32));
+        size_t hdr = detail::ws_frame_header(payload, SF_WS_OP_BINARY, len);
+
+        for (client &c : clients_) {
+            if (!c.open) {
+                continue;
+            }
+            /* Sequence is per client, so drops show up as gaps */
+            put32(payload + 4, c.seq++);
+            send_frame(c, payload - hdr, hdr + len);
+        }
+        stats_.batches++;
+        stats_.samples += count_;
+        count_ = 0;
+    }
+
+    /* Send close frames (best effort) and stop listening */
+    void close()
+    {
+        static const uint8_t close_frame[4] = {0x80 | SF_WS_OP_CLOSE, 2, 0x03, 0xE9}; /* 1001 */
+
+        for (client &c : clients_) {
+            if (c.open && !c.queued()) {
+                (void)::send(c.fd, close_frame, sizeof(close_frame), MSG_NOSIGNAL | MSG_DONTWAIT);
+            }
+            ::close(c.fd);
+        }
+        clients_.clear();
+        if (listen_fd_ >= 0) {
+            ::close(listen_fd_);
+            listen_fd_ = -1;
+        }
+    }
+
+private:
+    struct client {
+        int                  fd = -1;
+        bool                 open = false;     /* Handshake done */
+        uint32_t             seq = 0;
+        std::string          in;                /* Request, then client frames */
+        std::vector<uint8_t> out;               /* Waiting for the socket */
+        size_t               out_pos = 0;
+
+        size_t queued() const { return out.size() - out_pos; }
+    };
+
+    static void set_nonblocking(int fd)
+    {
+        int flags = fcntl(fd, F_GETFL, 0);
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    }
+
+    static void put16(uint8_t *p, uint16_t v)
+    {
+        p[0] = (uint8_t)v;
+        p[1] = (uint8_t)(v >> 8);
+    }
+
+    static void put32(uint8_t *p, uint32_t v)
+    {
+        p[0] = (uint8_t)v;
+        p[1] = (uint8_t)(v >> 8);
+        p[2] = (uint8_t)(v >> 16);
+        p[3] = (uint8_t)(v >> 24);
+    }
+
+    void reset_batch()
+    {
+        batch_.assign(SF_WS_FRAME_ROOM + SF_WS_HEADER_SIZE +
+                      SF_WS_MAX_BATCH * SF_WS_RECORD_SIZE, 0);
+        count_ = 0;
+    }
+
+    void accept_all()
+    {
+        for (;;) {
+            int fd = accept(listen_fd_, nullptr, nullptr);
+            if (fd < 0) {
+                return;
+            }
+            int one = 1;
+            set_nonblocking(fd);
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            clients_.emplace_back();
+            clients_.back().fd = fd;
+        }
+    }
+
+    void drop(client &c)
+    {
+        ::close(c.fd);
+        c.fd = -1;
+        c.open = false;
+    }
+
+    /* Queue or send; whole frames only, dropped if too much is waiting */
+    void send_frame(client &c, const uint8_t *data, size_t len)
+    {
+        size_t sent = 0;
+
+        if (c.queued() == 0) {
+            c.out.clear();
+            c.out_pos = 0;
+            ssize_t n = ::send(c.fd, data, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                drop(c);
+                return;
+            }
+            sent = n > 0 ? (size_t)n : 0;
+            stats_.bytes += sent;
+        } else if (c.queued() + len > opts_.max_queued) {
+            stats_.dropped++;
+            return;
+        }
+        c.out.insert(c.out.end(), data + sent, data + len);
+    }
+
+    void drain(client &c)
+    {
+        while (c.queued()) {
+            ssize_t n = ::send(c.fd, &c.out[c.out_pos], c.queued(),
+                               MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n <= 0) {
+                if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                    drop(c);
+                }
+                return;
+            }
+            c.out_pos += (size_t)n;
+            stats_.bytes += (uint64_t)n;
+        }
+        c.out.clear();
+        c.out_pos = 0;
+    }
+
+    void receive(client &c)
+    {
+        char buf[4096];
+        ssize_t n = ::recv(c.fd, buf, sizeof(buf), MSG_DONTWAIT);
+
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            drop(c);
+            return;
+        }
+        if (n < 0) {
+            return;
+        }
+        c.in.append(buf, (size_t)n);
+        if (!c.open) {
+            handshake(c);
+        }
+        if (c.open) {
+            client_frames(c);
+        }
+    }
+
+    void refuse(client &c, const char *status)
+    {
+        std::string resp = std::string("HTTP/1.1 ") + status +
+                           "\r\nConnection: close\r\nContent-Length: 0\r\n\r\n";
+        (void)::send(c.fd, resp.data(), resp.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        stats_.rejected++;
+        drop(c);
+    }
+
+    void handshake(client &c)
+    {
+        size_t end = c.in.find("\r\n\r\n");
+
+        if (end == std::string::npos) {
+            if (c.in.size() > SF_WS_MAX_REQUEST) {
+                refuse(c, "431 Request Header Fields Too Large");
+            }
+            return;
+        }
+        std::string req = c.in.substr(0, end + 2);
+        c.in.erase(0, end + 4);
+
+        std::string key = detail::http_header(req, "Sec-WebSocket-Key");
+        if (req.compare(0, 4, "GET ") != 0 ||
+            !detail::http_has_token(detail::http_header(req, "Upgrade"), "websocket") ||
+            !detail::http_has_token(detail::http_header(req, "Connection"), "upgrade") ||
+            detail::http_header(req, "Sec-WebSocket-Version") != "13" || key.empty()) {
+            refuse(c, "400 Bad Request");
+            return;
+        }
+        if (!opts_.origin.empty() && detail::http_header(req, "Origin") != opts_.origin) {
+            refuse(c, "403 Forbidden");
+            return;
+        }
+
+        std::string resp = "HTTP/1.1 101 Switching Protocols\r\n"
+                           "Upgrade: websocket\r\n"
+                           "Connection: Upgrade\r\n"
+                           "Sec-WebSocket-Accept: " + detail::ws_accept(key) + "\r\n\r\n";
+        send_frame(c, reinterpret_cast<const uint8_t *>(resp.data()), resp.size());
+        if (c.fd < 0) {
+            return;
+        }
+        c.open = true;
+        stats_.connections++;
+        if (!hello_.empty()) {
+            send_control(c, SF_WS_OP_TEXT, reinterpret_cast<const uint8_t *>(hello_.data()),
+                         hello_.size());
+        }
+    }
+
+    void send_control(client &c, uint8_t opcode, const uint8_t *data, size_t len)
+    {
+        std::vector<uint8_t> frame(SF_WS_FRAME_ROOM + len);
+        size_t hdr = detail::ws_frame_header(&frame[SF_WS_FRAME_ROOM], opcode, len);
+
+        if (len) {
+            memcpy(&frame[SF_WS_FRAME_ROOM], data, len);
+        }
+        send_frame(c, &frame[SF_WS_FRAME_ROOM - hdr], hdr + len);
+    }
+
+    /* Client frames: answer ping and close, ignore data */
+    void client_frames(client &c)
+    {
+        for (;;) {
+            const uint8_t *p = reinterpret_cast<const uint8_t *>(c.in.data());
+            size_t avail = c.in.size();
+            if (avail < 2) {
+                return;
+            }
+            uint8_t opcode = p[0] & 0x0F;
+            bool masked = (p[1] & 0x80) != 0;
+            uint64_t len = p[1] & 0x7F;
+            size_t hdr = 2;
+            if (len == 126) {
+                if (avail < 4) return;
+                len = (uint64_t)p[2] << 8 | p[3];
+                hdr = 4;
+            } else if (len == 127) {
+                if (avail < 10) return;
+                len = 0;
+                for (int i = 0; i < 8; i++) {
+                    len = len << 8 | p[2 + i];
+                }
+                hdr = 10;
+            }
+            /* Clients must mask; we only expect small frames */
+            if (!masked || len > SF_WS_MAX_REQUEST) {
+                drop(c);
+                return;
+            }
+            if (avail < hdr + 4 + len) {
+                return;
+            }
+            uint8_t payload[SF_WS_MAX_REQUEST];
+            const uint8_t *mask = p + hdr;
+            for (size_t i = 0; i < len; i++) {
+                payload[i] = p[hdr + 4 + i] ^ mask[i & 3];
+            }
+            c.in.erase(0, hdr + 4 + (size_t)len);
+
+            if (opcode == SF_WS_OP_PING && len <= SF_WS_MAX_CONTROL) {
+                send_control(c, SF_WS_OP_PONG, payload, (size_t)len);
+            } else if (opcode == SF_WS_OP_CLOSE) {
+                send_control(c, SF_WS_OP_CLOSE, payload, len >= 2 ? 2 : 0);
+                drain(c);
+                if (c.fd >= 0) {
+                    drop(c);
+                }
+                return;
+            }
+            if (c.fd < 0) {
+                return;
+            }
+        }
+    }
+
+    ws_options           opts_;
+    int                  listen_fd_;
+    std::vector<client>  clients_;
+    std::string          hello_;
+    std::vector<uint8_t> batch_;        /* Frame room, header, records */
+    size_t               count_;
+    int64_t              base_us_;
+    ws_stats             stats_;
+};
+
+} /* namespace sf */
+
+#endif /* STREAM_WS_HPP */
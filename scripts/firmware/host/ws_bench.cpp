@@ -0,0 +1,500 @@
+/**
+ * @file ws_bench.cpp
+ * @brief CPU cost of the WebSocket bridge (stream_ws.hpp) on both ends
+ *
+ * The bridge process generates samples the way a headset link delivers
+ * them, in a burst every BLE connection event (CONN_INTERVAL_US), and
+ * serves them through sf::ws_server. Client processes connect over
+ * loopback, complete the handshake and decode every batch into per-type
+ * value arrays, the work lib/streamBridge.ts does in the page. Both
+ * sides measure their own CPU time with getrusage().
+ *
+ * For each sample rate it runs batched (BENCH_FLUSH_HZ, one message per
+ * display frame) and unbatched (one message per sample, the callback
+ * rate the page gets from Web Bluetooth today), and reports messages/s,
+ * CPU % of one core on each side and the same per 1,000 samples/s, and
+ * generate-to-decoded latency. Clients check every record and the batch
+ * sequence, and each run fails if a sample is lost, corrupted or
+ * misordered.
+ *
+ * Usage: ws_bench [--clients N] [seconds [rates...]]
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "stream_ws.hpp"
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+#define BENCH_DEFAULT_SECONDS   5
+#define BENCH_FLUSH_HZ          60
+#define BENCH_DEVICES           4
+#define CONN_INTERVAL_US        7500
+#define VALUE_MASK              0xFFFFF     /* Exact in a float */
+#define CLIENT_BUFFER           (1 << 20)
+
+/**
+ * @brief What a client process reports back
+ */
+struct client_result {
+    uint64_t samples;
+    uint64_t messages;
+    uint64_t errors;            /* Bad handshake, record, order or seq gap */
+    uint64_t cpu_us;            /* User + system, first message to close */
+    uint64_t p50_us;
+    uint64_t p99_us;
+};
+
+/**
+ * @brief Decoded values by type, as the page keeps them
+ */
+struct client_columns {
+    std::vector<float> quat, mag, accel, battery;
+    std::vector<double> t_us;
+};
+
+/*******************************************************************************
+ * Private Variables
+ ******************************************************************************/
+
+static uint32_t s_rng = 0x2545F491UL;
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+static uint32_t bench_rand(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+static int64_t bench_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint64_t bench_cpu_us(void)
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+    return (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000 +
+           (uint64_t)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
+}
+
+static const uint8_t s_types[3] = {SF_TYPE_QUATERNION, SF_TYPE_MAGNETOMETER,
+                                   SF_TYPE_LINEAR_ACCEL};
+
+/* Sample i: values and type follow from its index in v[0] */
+static sf::merged_sample bench_sample(uint64_t i, int64_t t_us)
+{
+    sf::merged_sample s;
+
+    s.t_us = t_us;
+    s.arrival_us = t_us;
+    s.device = (uint16_t)(i % BENCH_DEVICES);
+    s.type = s_types[(i / BENCH_DEVICES) % 3];
+    s.flags = SF_MERGED_SENSOR_TIME;
+    for (unsigned k = 0; k < 4; k++) {
+        s.v[k] = (float)((i + k) & VALUE_MASK);
+    }
+    return s;
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static bool client_send_all(int fd, const void *data, size_t len)
+{
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+
+    while (len) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+/* Connect and upgrade; leaves anything after the response in buf */
+static int client_connect(uint16_t port, std::vector<uint8_t> &buf, size_t &len)
+{
+    struct sockaddr_in addr;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    uint8_t nonce[16];
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        return -1;
+    }
+    for (uint8_t &b : nonce) {
+        b = (uint8_t)bench_rand();
+    }
+    std::string key = sf::detail::base64(nonce, sizeof(nonce));
+    std::string req = "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\nUpgrade: websocket\r\n"
+                      "Connection: keep-alive, Upgrade\r\nSec-WebSocket-Version: 13\r\n"
+                      "Sec-WebSocket-Key: " + key + "\r\n\r\n";
+    if (!client_send_all(fd, req.data(), req.size())) {
+        close(fd);
+        return -1;
+    }
+
+    std::string resp;
+    for (;;) {
+        ssize_t n = recv(fd, buf.data(), buf.size(), 0);
+        if (n <= 0) {
+            close(fd);
+            return -1;
+        }
+        resp.append(reinterpret_cast<char *>(buf.data()), (size_t)n);
+        size_t end = resp.find("\r\n\r\n");
+        if (end == std::string::npos) {
+            continue;
+        }
+        if (resp.compare(0, 12, "HTTP/1.1 101") != 0 ||
+            sf::detail::http_header(resp.substr(0, end + 2), "Sec-WebSocket-Accept") !=
+                sf::detail::ws_accept(key)) {
+            close(fd);
+            return -1;
+        }
+        len = resp.size() - (end + 4);
+        memcpy(buf.data(), resp.data() + end + 4, len);
+        return fd;
+    }
+}
+
+/* Decode one batch message; false if anything in it is wrong */
+static bool client_batch(const uint8_t *p, size_t len, uint32_t &next_seq, uint64_t &next_i,
+                         client_columns &cols, std::vector<uint32_t> &latency)
+{
+    if (len < SF_WS_HEADER_SIZE || p[0] != SF_WS_BATCH_VERSION || p[1] != SF_WS_RECORD_SIZE) {
+        return false;
+    }
+    size_t count = (size_t)p[2] | (size_t)p[3] << 8;
+    uint32_t seq = get32(p + 4);
+    uint64_t bits = (uint64_t)get32(p + 8) | (uint64_t)get32(p + 12) << 32;
+    double base;
+    memcpy(&base, &bits, sizeof(base));
+    if (len != SF_WS_HEADER_SIZE + count * SF_WS_RECORD_SIZE || seq != next_seq) {
+        return false;
+    }
+    next_seq = seq + 1;
+
+    int64_t now = bench_now_us();
+    bool ok = true;
+    for (size_t k = 0; k < count; k++) {
+        const uint8_t *r = p + SF_WS_HEADER_SIZE + k * SF_WS_RECORD_SIZE;
+        float v[4];
+        for (unsigned j = 0; j < 4; j++) {
+            uint32_t b = get32(r + 8 + j * 4);
+            memcpy(&v[j], &b, sizeof(float));
+        }
+        uint16_t device = (uint16_t)(r[0] | r[1] << 8);
+        uint8_t type = r[2];
+        double t = base + get32(r + 4);
+
+        std::vector<float> *col = type == SF_TYPE_QUATERNION     ? &cols.quat
+                                : type == SF_TYPE_MAGNETOMETER   ? &cols.mag
+                                : type == SF_TYPE_LINEAR_ACCEL   ? &cols.accel
+                                                                 : &cols.battery;
+        col->insert(col->end(), v, v + (type == SF_TYPE_QUATERNION ? 4 : 3));
+        cols.t_us.push_back(t);
+
+        uint64_t i = next_i++;
+        if (v[0] != (float)(i & VALUE_MASK) || v[3] != (float)((i + 3) & VALUE_MASK) ||
+            device != i % BENCH_DEVICES || type != s_types[(i / BENCH_DEVICES) % 3]) {
+            ok = false;
+        }
+        latency.push_back((uint32_t)(now - (int64_t)t));
+    }
+    return ok;
+}
+
+/* Client process: decode until the server closes, report, exit */
+static void bench_client(uint16_t port, int result_fd)
+{
+    std::vector<uint8_t> buf(CLIENT_BUFFER);
+    std::vector<uint32_t> latency;
+    client_columns cols;
+    client_result r = {};
+    size_t len = 0;
+    uint32_t next_seq = 0;
+    uint64_t next_i = 0, cpu0 = 0;
+    bool started = false;
+
+    int fd = client_connect(port, buf, len);
+    if (fd < 0) {
+        r.errors = 1;
+    }
+    while (fd >= 0) {
+        /* Whole frames at the front of buf */
+        size_t pos = 0;
+        bool closed = false;
+        while (len - pos >= 2) {
+            const uint8_t *p = &buf[pos];
+            uint8_t opcode = p[0] & 0x0F;
+            uint64_t n = p[1] & 0x7F;
+            size_t hdr = 2;
+            if (n == 126) {
+                if (len - pos < 4) break;
+                n = (uint64_t)p[2] << 8 | p[3];
+                hdr = 4;
+            } else if (n == 127) {
+                if (len - pos < 10) break;
+                n = 0;
+                for (int k = 0; k < 8; k++) {
+                    n = n << 8 | p[2 + k];
+                }
+                hdr = 10;
+            }
+            if (hdr + n > buf.size()) {
+                r.errors++;
+                closed = true;
+                break;
+            }
+            if (len - pos < hdr + n) {
+                break;
+            }
+            if (opcode == SF_WS_OP_BINARY) {
+                if (!started) {
+                    started = true;
+                    cpu0 = bench_cpu_us();
+                }
+                r.messages++;
+                if (!client_batch(p + hdr, (size_t)n, next_seq, next_i, cols, latency)) {
+                    r.errors++;
+                }
+            } else if (opcode == SF_WS_OP_CLOSE) {
+                closed = true;
+            }
+            pos += hdr + (size_t)n;
+        }
+        memmove(buf.data(), buf.data() + pos, len - pos);
+        len -= pos;
+        if (closed) {
+            break;
+        }
+        ssize_t n = recv(fd, buf.data() + len, buf.size() - len, 0);
+        if (n <= 0) {
+            break;
+        }
+        len += (size_t)n;
+
+        /* Columns only hold one display frame's worth, as in the page */
+        if (cols.t_us.size() > 4096) {
+            cols.quat.clear();
+            cols.mag.clear();
+            cols.accel.clear();
+            cols.battery.clear();
+            cols.t_us.clear();
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    r.samples = next_i;
+    r.cpu_us = started ? bench_cpu_us() - cpu0 : 0;
+    if (!latency.empty()) {
+        std::sort(latency.begin(), latency.end());
+        r.p50_us = latency[latency.size() / 2];
+        r.p99_us = latency[(latency.size() - 1) * 99 / 100];
+    }
+    if (write(result_fd, &r, sizeof(r)) != (ssize_t)sizeof(r)) {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+/**
+ * @brief One run: serve rate samples/s for seconds to clients
+ * @param flush_hz Batches per second, 0 for one message per sample
+ */
+static bool bench_run(unsigned clients, double seconds, unsigned rate, unsigned flush_hz)
+{
+    sf::ws_server server;
+    sf::ws_options opts;
+    int result[2];
+    std::vector<pid_t> children;
+
+    opts.port = 0;
+    if (!server.listen(opts) || pipe(result) != 0) {
+        perror("ws_bench: listen");
+        return false;
+    }
+    server.set_hello("{\"version\":1}");
+    uint16_t port = server.port();
+    fflush(stdout);
+    for (unsigned c = 0; c < clients; c++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            server.close();
+            bench_client(port, result[1]);
+        }
+        children.push_back(pid);
+    }
+    for (int i = 0; server.clients() < clients; i++) {
+        if (i == 5000) {
+            fprintf(stderr, "ws_bench: clients did not connect\n");
+            for (pid_t pid : children) {
+                kill(pid, SIGKILL);
+                waitpid(pid, NULL, 0);
+            }
+            return false;
+        }
+        server.service();
+        struct timespec ts = {0, 1000000};
+        nanosleep(&ts, NULL);
+    }
+
+    /* Paced: a burst every connection event, a batch every flush period */
+    uint64_t total = (uint64_t)(seconds * rate);
+    int64_t start = bench_now_us();
+    int64_t flush_us = flush_hz ? 1000000 / flush_hz : 0;
+    int64_t next_event = start, next_flush = start + flush_us;
+    uint64_t sent = 0;
+    uint64_t cpu0 = bench_cpu_us();
+    while (sent < total) {
+        int64_t now = bench_now_us();
+        if (now >= next_event) {
+            uint64_t due = std::min(total, (uint64_t)((double)(now - start) * rate / 1e6) + 1);
+            for (; sent < due; sent++) {
+                server.add(bench_sample(sent, bench_now_us()));
+                if (!flush_hz) {
+                    server.flush();
+                }
+            }
+            next_event += CONN_INTERVAL_US;
+        }
+        if (flush_hz && now >= next_flush) {
+            server.flush();
+            next_flush += flush_us;
+        }
+        server.service();
+        int64_t wake = flush_hz ? std::min(next_event, next_flush) : next_event;
+        now = bench_now_us();
+        if (wake > now) {
+            struct timespec ts = {(time_t)((wake - now) / 1000000),
+                                  (long)((wake - now) % 1000000) * 1000};
+            nanosleep(&ts, NULL);
+        }
+    }
+    server.flush();
+    int64_t elapsed = bench_now_us() - start;
+    uint64_t bridge_cpu = bench_cpu_us() - cpu0;
+    while (server.queued()) {
+        server.service();
+    }
+    uint64_t batches = server.stats().batches;
+    uint64_t dropped = server.stats().dropped;
+    server.close();
+
+    bool ok = dropped == 0;
+    client_result worst = {};
+    uint64_t client_cpu = 0, samples = 0, errors = 0;
+    for (unsigned c = 0; c < clients; c++) {
+        client_result r;
+        if (read(result[0], &r, sizeof(r)) != (ssize_t)sizeof(r)) {
+            ok = false;
+            break;
+        }
+        samples += r.samples;
+        errors += r.errors;
+        client_cpu = std::max(client_cpu, r.cpu_us);
+        worst.p50_us = std::max(worst.p50_us, r.p50_us);
+        worst.p99_us = std::max(worst.p99_us, r.p99_us);
+    }
+    for (pid_t pid : children) {
+        waitpid(pid, NULL, 0);
+    }
+    close(result[0]);
+    close(result[1]);
+
+    double secs = (double)elapsed / 1e6;
+    double bridge_pct = 100.0 * (double)bridge_cpu / (double)elapsed;
+    double client_pct = 100.0 * (double)client_cpu / (double)elapsed;
+    double per_k = 1000.0 / rate;
+    char flush[16];
+    snprintf(flush, sizeof(flush), flush_hz ? "%u Hz" : "each", flush_hz);
+    printf("%7u  %-6s  %8.0f  %8.2f  %8.3f  %8.2f  %8.3f  %7.1f  %7.1f\n", rate, flush,
+           (double)batches / secs, bridge_pct, bridge_pct * per_k, client_pct,
+           client_pct * per_k, worst.p50_us / 1e3, worst.p99_us / 1e3);
+
+    if (samples != (uint64_t)clients * total || errors || dropped) {
+        fprintf(stderr, "FAIL: %llu of %llu samples, %llu errors, %llu batches dropped\n",
+                (unsigned long long)samples, (unsigned long long)clients * total,
+                (unsigned long long)errors, (unsigned long long)dropped);
+        ok = false;
+    }
+    return ok;
+}
+
+/*******************************************************************************
+ * Main
+ ******************************************************************************/
+
+int main(int argc, char **argv)
+{
+    unsigned clients = 1;
+    double seconds = BENCH_DEFAULT_SECONDS;
+    std::vector<unsigned> rates;
+    int arg = 1;
+    bool ok = true;
+
+    if (arg + 1 < argc && strcmp(argv[arg], "--clients") == 0) {
+        clients = (unsigned)strtoul(argv[arg + 1], NULL, 0);
+        arg += 2;
+    }
+    if (arg < argc) {
+        seconds = atof(argv[arg++]);
+    }
+    for (; arg < argc; arg++) {
+        rates.push_back((unsigned)strtoul(argv[arg], NULL, 0));
+    }
+    if (rates.empty()) {
+        rates = {1000, 6000, 24000};
+    }
+    if (seconds <= 0 || clients == 0) {
+        fprintf(stderr, "usage: ws_bench [--clients N] [seconds [rates...]]\n");
+        return 1;
+    }
+
+    printf("%u client(s), %g s per run; CPU %% of one core, then per 1,000 samples/s\n",
+           clients, seconds);
+    printf("  rate/s  flush     msgs/s  bridge %%   per 1k  client %%   per 1k  p50 ms  p99 ms\n");
+    for (unsigned rate : rates) {
+        if (rate == 0) {
+            continue;
+        }
+        ok &= bench_run(clients, seconds, rate, BENCH_FLUSH_HZ);
+        ok &= bench_run(clients, seconds, rate, 0);
+    }
+    return ok ? 0 : 1;
+}
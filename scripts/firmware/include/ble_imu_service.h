@@ -18,6 +18,8 @@
 #include <stdbool.h>
 #include "ble.h"
 #include "ble_gatts.h"
+#include "sensor_reports.h"
+#include "config.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -31,7 +33,7 @@ extern "C" {
  * UUID Structure (128-bit, stored little-endian):
  *   Base:    12340000-1234-1234-1234-123456789ABC
  *   Service: 12340000-...
- *   Chars:   12340001-... through 12340005-...
+ *   Chars:   12340001-... through 1234000A-...
  ******************************************************************************/
 
 /* 128-bit UUID Base (stored in little-endian for SoftDevice) 
@@ -54,6 +56,12 @@ extern "C" {
 #define BLE_IMU_CHAR_GYRO_UUID          0x0003  /* Gyroscope data */
 #define BLE_IMU_CHAR_RATE_UUID          0x0004  /* Sample rate config */
 #define BLE_IMU_CHAR_STATUS_UUID        0x0005  /* Status flags */
+#define BLE_IMU_CHAR_MAG_UUID           0x0006  /* Magnetometer data */
+#define BLE_IMU_CHAR_LINEAR_ACCEL_UUID  0x0007  /* Linear acceleration data */
+#define BLE_IMU_CHAR_GRAVITY_UUID       0x0008  /* Gravity vector data */
+#define BLE_IMU_CHAR_GAME_ROTATION_UUID 0x0009  /* Game rotation vector data */
+#define BLE_IMU_CHAR_GEOMAG_ROTATION_UUID 0x000A /* Geomagnetic rotation data */
+#define BLE_IMU_CHAR_RAW_UUID           0x000B  /* Raw SHTP passthrough */
 
 /*******************************************************************************
  * Characteristic Data Sizes
@@ -64,6 +72,7 @@ extern "C" {
 #define BLE_IMU_GYRO_SIZE           12  /* 3x float32 (x, y, z) rad/s */
 #define BLE_IMU_RATE_SIZE           2   /* uint16 report interval (ms) */
 #define BLE_IMU_STATUS_SIZE         1   /* uint8 status flags */
+#define BLE_IMU_RAW_MAX_SIZE        (CONFIG_BLE_GATT_MTU - 3)  /* Records (shtp_passthrough.h) */
 
 /*******************************************************************************
  * Status Flags
@@ -97,6 +106,38 @@ typedef struct __attribute__((packed)) {
     float z;        /* Z-axis value */
 } ble_imu_vector_t;
 
+/* Wire type of each SENSOR_REPORT_TABLE payload layout */
+#define BLE_IMU_WIRE_TYPE(layout)       SENSOR_REPORT_CAT(BLE_IMU_WIRE_TYPE_, layout)
+#define BLE_IMU_WIRE_TYPE_quat_acc      ble_imu_quat_t
+#define BLE_IMU_WIRE_TYPE_quat          ble_imu_quat_t
+#define BLE_IMU_WIRE_TYPE_vec3          ble_imu_vector_t
+#define BLE_IMU_WIRE_TYPE_u32           uint32_t
+#define BLE_IMU_WIRE_TYPE_stability     uint8_t
+
+/**
+ * @brief Sensor characteristic index, one per enabled BLE report
+ *
+ * Expanded from SENSOR_REPORT_TABLE; disabled reports get no index, no
+ * characteristic and no handle storage.
+ */
+typedef enum {
+#define X(name, id, en, q, layout, field, ble, uuid) \
+    SENSOR_REPORT_IF(en, SENSOR_REPORT_IF(ble, BLE_IMU_SENSOR_##name,))
+    SENSOR_REPORT_TABLE(X)
+#undef X
+    BLE_IMU_SENSOR_COUNT
+} ble_imu_sensor_t;
+
+/**
+ * @brief Latest value of every enabled BLE report, in table order
+ */
+typedef struct __attribute__((packed)) {
+#define X(name, id, en, q, layout, field, ble, uuid) \
+    SENSOR_REPORT_IF(en, SENSOR_REPORT_IF(ble, BLE_IMU_WIRE_TYPE(layout) field;))
+    SENSOR_REPORT_TABLE(X)
+#undef X
+} ble_imu_frame_t;
+
 /**
  * @brief IMU service configuration
  */
@@ -111,16 +152,14 @@ typedef struct {
 typedef enum {
     BLE_IMU_EVT_CONNECTED,          /* Client connected */
     BLE_IMU_EVT_DISCONNECTED,       /* Client disconnected */
-    BLE_IMU_EVT_QUAT_NOTIFY_EN,     /* Quaternion notifications enabled */
-    BLE_IMU_EVT_QUAT_NOTIFY_DIS,    /* Quaternion notifications disabled */
-    BLE_IMU_EVT_ACCEL_NOTIFY_EN,    /* Accelerometer notifications enabled */
-    BLE_IMU_EVT_ACCEL_NOTIFY_DIS,   /* Accelerometer notifications disabled */
-    BLE_IMU_EVT_GYRO_NOTIFY_EN,     /* Gyroscope notifications enabled */
-    BLE_IMU_EVT_GYRO_NOTIFY_DIS,    /* Gyroscope notifications disabled */
+    BLE_IMU_EVT_SENSOR_NOTIFY_EN,   /* Sensor notifications enabled */
+    BLE_IMU_EVT_SENSOR_NOTIFY_DIS,  /* Sensor notifications disabled */
     BLE_IMU_EVT_STATUS_NOTIFY_EN,   /* Status notifications enabled */
     BLE_IMU_EVT_STATUS_NOTIFY_DIS,  /* Status notifications disabled */
     BLE_IMU_EVT_RATE_WRITE,         /* Sample rate written */
     BLE_IMU_EVT_TX_COMPLETE,        /* Notification TX complete */
+    BLE_IMU_EVT_RAW_NOTIFY_EN,      /* Raw passthrough notifications enabled */
+    BLE_IMU_EVT_RAW_NOTIFY_DIS,     /* Raw passthrough notifications disabled */
 } ble_imu_evt_type_t;
 
 /**
@@ -132,6 +171,7 @@ typedef struct {
     union {
         uint16_t rate_ms;           /* New sample rate (for RATE_WRITE) */
         uint8_t  tx_count;          /* TX complete count */
+        ble_imu_sensor_t sensor;    /* Sensor (for SENSOR_NOTIFY_EN/DIS) */
     } data;
 } ble_imu_evt_t;
 
@@ -148,17 +188,20 @@ typedef struct {
     uint16_t conn_handle;               /* Current connection handle */
     
     /* Characteristic value handles */
-    ble_gatts_char_handles_t quat_handles;    /* Quaternion characteristic handles */
-    ble_gatts_char_handles_t accel_handles;   /* Accelerometer characteristic handles */
-    ble_gatts_char_handles_t gyro_handles;    /* Gyroscope characteristic handles */
+    ble_gatts_char_handles_t sensor_handles[BLE_IMU_SENSOR_COUNT]; /* Sensor characteristics */
     ble_gatts_char_handles_t rate_handles;    /* Sample rate characteristic handles */
     ble_gatts_char_handles_t status_handles;  /* Status characteristic handles */
+#if CONFIG_BLE_RAW_PASSTHROUGH
+    ble_gatts_char_handles_t raw_handles;     /* Raw passthrough characteristic handles */
+#endif
     
     /* Notification enable flags (from CCCD writes) */
-    bool quat_notify_enabled;
-    bool accel_notify_enabled;
-    bool gyro_notify_enabled;
+    bool sensor_notify_enabled[BLE_IMU_SENSOR_COUNT];
     bool status_notify_enabled;
+    bool raw_notify_enabled;            /* Always false without CONFIG_BLE_RAW_PASSTHROUGH */
+    
+    /* ATT MTU of the current connection (from the MTU exchange) */
+    uint16_t att_mtu;
     
     /* Configuration */
     uint16_t sample_rate_ms;            /* Current sample rate */
@@ -204,43 +247,42 @@ uint32_t ble_imu_service_init(ble_imu_service_t *service,
 void ble_imu_service_on_ble_evt(ble_imu_service_t *service, const ble_evt_t *p_ble_evt);
 
 /**
- * @brief Send quaternion data notification
+ * @brief Send a sensor data notification
  * 
  * @param[in] service Pointer to service handle
- * @param[in] quat    Quaternion data to send
+ * @param[in] sensor  Sensor characteristic index
+ * @param[in] p_value Value in the sensor's wire format (BLE_IMU_WIRE_TYPE)
  * 
  * @retval NRF_SUCCESS             Notification sent/queued
  * @retval NRF_ERROR_INVALID_STATE Not connected or notifications disabled
  * @retval NRF_ERROR_RESOURCES     TX buffer full
  */
-uint32_t ble_imu_notify_quaternion(ble_imu_service_t *service, 
-                                   const ble_imu_quat_t *quat);
+uint32_t ble_imu_notify_sensor(ble_imu_service_t *service,
+                               ble_imu_sensor_t sensor,
+                               const void *p_value);
 
 /**
- * @brief Send accelerometer data notification
+ * @brief Send a raw passthrough notification
  * 
  * @param[in] service Pointer to service handle
- * @param[in] accel   Accelerometer data to send
+ * @param[in] p_data  Passthrough records (shtp_passthrough.h)
+ * @param[in] len     Length, at most ble_imu_raw_max_len()
  * 
- * @retval NRF_SUCCESS             Notification sent/queued
+ * @retval NRF_SUCCESS             Notification queued
  * @retval NRF_ERROR_INVALID_STATE Not connected or notifications disabled
  * @retval NRF_ERROR_RESOURCES     TX buffer full
  */
-uint32_t ble_imu_notify_accelerometer(ble_imu_service_t *service,
-                                      const ble_imu_vector_t *accel);
+uint32_t ble_imu_notify_raw(ble_imu_service_t *service,
+                            const uint8_t *p_data,
+                            uint16_t len);
 
 /**
- * @brief Send gyroscope data notification
+ * @brief Largest raw notification for the current connection
  * 
  * @param[in] service Pointer to service handle
- * @param[in] gyro    Gyroscope data to send
- * 
- * @retval NRF_SUCCESS             Notification sent/queued
- * @retval NRF_ERROR_INVALID_STATE Not connected or notifications disabled
- * @retval NRF_ERROR_RESOURCES     TX buffer full
+ * @return ATT MTU - 3, capped at BLE_IMU_RAW_MAX_SIZE
  */
-uint32_t ble_imu_notify_gyroscope(ble_imu_service_t *service,
-                                  const ble_imu_vector_t *gyro);
+uint16_t ble_imu_raw_max_len(const ble_imu_service_t *service);
 
 /**
  * @brief Send status notification
@@ -48,6 +48,7 @@ extern "C" {
 #define BNO085_ERR_NOT_READY        -5      /* Device not ready */
 #define BNO085_ERR_BUFFER_OVERFLOW  -6      /* Buffer too small */
 #define BNO085_ERR_INVALID_PARAM    -7      /* Invalid parameter */
+#define BNO085_ERR_NO_MEM           -8      /* DMA pool exhausted */
 
 /*******************************************************************************
  * Sensor Report Types
@@ -121,8 +122,9 @@ typedef struct {
     uint32_t sw_part_number;
     uint32_t sw_build_number;
     
-    /* Receive buffer */
-    uint8_t  rx_buffer[512];
+    /* Receive buffer - DMA_POOL_SHTP block owned by the device from init
+     * to deinit; TWIM writes into it and the parser decodes it in place */
+    uint8_t *rx_buffer;
     uint16_t rx_len;
     
     /* Enabled reports bitmask */
@@ -159,6 +161,7 @@ typedef struct {
 typedef struct {
     bno085_quaternion_t rotation_vector;    /* Fused orientation */
     bno085_quaternion_t game_rotation;      /* No magnetometer */
+    bno085_quaternion_t geomag_rotation;    /* Accel + magnetometer */
     bno085_vector_t     accelerometer;      /* m/s² */
     bno085_vector_t     gyroscope;          /* rad/s */
     bno085_vector_t     magnetometer;       /* µT */
@@ -298,6 +301,30 @@ bool bno085_data_available(bno085_t *dev);
  */
 int bno085_poll(bno085_t *dev, bno085_data_t *data);
 
+/**
+ * @brief Read the header of the next SHTP packet
+ *
+ * First half of bno085_poll() for callers that want the cargo somewhere
+ * other than the driver's receive buffer. The header is left in
+ * dev->rx_buffer[0..3] (channel at SHTP_HEADER_CHANNEL); the cargo must
+ * then be read with bno085_read_cargo() before the next header.
+ *
+ * @param dev Device handle
+ * @return Packet length including the header, 0 if no data, or negative
+ *         error code
+ */
+int bno085_read_header(bno085_t *dev);
+
+/**
+ * @brief Read the cargo of the packet whose header was just read
+ * @param dev  Device handle
+ * @param dest Destination for packet length - 4 bytes; must be in Data RAM
+ *             (EasyDMA target). NULL reads into dev->rx_buffer after the
+ *             header, as bno085_poll() does.
+ * @return Cargo length in bytes, or negative error code
+ */
+int bno085_read_cargo(bno085_t *dev, uint8_t *dest);
+
 /**
  * @brief Get the latest rotation vector (quaternion)
  * @param dev Pointer to device handle
@@ -176,6 +176,19 @@ void board_led_toggle(void);
  */
 void board_delay_ms(uint32_t ms);
 
+/**
+ * @brief Enable the DWT cycle counter
+ * 
+ * Citation: ARMv7-M Architecture Reference Manual Section C1.8 (DWT)
+ */
+void board_cycle_counter_init(void);
+
+/**
+ * @brief Read the DWT cycle counter (wraps every ~67 s at 64 MHz)
+ * @return Current CPU cycle count
+ */
+uint32_t board_cycle_counter_get(void);
+
 #ifdef __cplusplus
 }
 #endif
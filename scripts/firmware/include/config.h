@@ -60,12 +60,20 @@ extern "C" {
 #define CONFIG_BNO085_REPORT_RATE_US 5000       /* 5ms = 200 Hz */
 #define CONFIG_BNO085_REPORT_RATE_MS 5          /* 5ms = 200 Hz */
 
-/* Report Types - Citation: FIRMWARE_DESIGN.md Section "BNO085 Report Types" */
+/* Report Types - Citation: FIRMWARE_DESIGN.md Section "BNO085 Report Types"
+ * Each flag gates one row of SENSOR_REPORT_TABLE (sensor_reports.h) and must
+ * be a literal 0 or 1.
+ */
 #define CONFIG_ENABLE_ROTATION_VECTOR   1       /* Primary output */
 #define CONFIG_ENABLE_ACCELEROMETER     1       /* Raw accel data */
 #define CONFIG_ENABLE_GYROSCOPE         1       /* Raw gyro data */
 #define CONFIG_ENABLE_MAGNETOMETER      0       /* Disabled by default */
 #define CONFIG_ENABLE_GAME_ROTATION     0       /* No magnetometer fusion */
+#define CONFIG_ENABLE_GEOMAG_ROTATION   0       /* Accel + mag fusion only */
+#define CONFIG_ENABLE_LINEAR_ACCEL      0       /* Accel minus gravity */
+#define CONFIG_ENABLE_GRAVITY           0       /* Gravity vector */
+#define CONFIG_ENABLE_STEP_COUNTER      0       /* Step counter */
+#define CONFIG_ENABLE_STABILITY         0       /* Stability classifier */
 
 /*******************************************************************************
  * BLE Configuration
@@ -90,6 +98,11 @@ extern "C" {
 /* TX Power - Citation: "-20 to +8 dBm TX power" */
 #define CONFIG_BLE_TX_POWER             4       /* +4 dBm */
 
+/* Raw SHTP passthrough characteristic (shtp_passthrough.h). While its CCCD
+ * is enabled, sensor cargo is forwarded unparsed instead of decoded. */
+#define CONFIG_BLE_RAW_PASSTHROUGH      1
+#define CONFIG_BLE_RAW_FLUSH_US         15000   /* Max age of coalesced cargo */
+
 /*******************************************************************************
  * IMU Service UUIDs
  * Citation: FIRMWARE_DESIGN.md: "Custom IMU Service UUID: 12340000-1234-..."
@@ -104,6 +117,12 @@ extern "C" {
 #define IMU_CHAR_GYRO_UUID      0x0003  /* Gyroscope characteristic */
 #define IMU_CHAR_RATE_UUID      0x0004  /* Sample rate characteristic */
 #define IMU_CHAR_STATUS_UUID    0x0005  /* Status characteristic */
+#define IMU_CHAR_MAG_UUID       0x0006  /* Magnetometer characteristic */
+#define IMU_CHAR_LINEAR_UUID    0x0007  /* Linear acceleration characteristic */
+#define IMU_CHAR_GRAVITY_UUID   0x0008  /* Gravity characteristic */
+#define IMU_CHAR_GAME_RV_UUID   0x0009  /* Game rotation vector characteristic */
+#define IMU_CHAR_GEOMAG_RV_UUID 0x000A  /* Geomagnetic rotation characteristic */
+#define IMU_CHAR_RAW_UUID       0x000B  /* Raw SHTP passthrough characteristic */
 
 /*******************************************************************************
  * Debug Configuration
@@ -111,6 +130,16 @@ extern "C" {
 #define CONFIG_DEBUG_UART           1       /* Enable UART debug output */
 #define CONFIG_DEBUG_RTT            0       /* Disable SEGGER RTT */
 #define CONFIG_DEBUG_LEVEL          2       /* 0=off, 1=error, 2=warn, 3=info, 4=debug */
+#ifndef CONFIG_PERF_CYCLE_STATS
+#define CONFIG_PERF_CYCLE_STATS     0       /* Per-sample DWT cycle statistics (make PERF=1) */
+#endif
+
+/*******************************************************************************
+ * Code Placement
+ * Citation: nRF52840_PS_v1.11.pdf Section 4.4.2 - NVMC instruction cache
+ ******************************************************************************/
+#define CONFIG_ENABLE_RAMFUNC       1       /* Run RAMFUNC hot path from RAM */
+#define CONFIG_ENABLE_ICACHE        1       /* Enable flash instruction cache */
 
 /*******************************************************************************
  * Timing Configuration
@@ -120,10 +149,18 @@ extern "C" {
 
 /*******************************************************************************
  * Buffer Sizes
+ * Receive/notify buffers are DMA pool blocks (dma_pool.h); sizes are per block.
  ******************************************************************************/
 #define CONFIG_SHTP_RX_BUFFER_SIZE  512     /* SHTP receive buffer */
 #define CONFIG_SHTP_TX_BUFFER_SIZE  256     /* SHTP transmit buffer */
 #define CONFIG_BLE_TX_BUFFER_SIZE   256     /* BLE notification buffer */
+#define CONFIG_DMA_SMALL_BUFFER_SIZE 32     /* Short TWIM transfers, SHTP commands */
+
+#define CONFIG_SHTP_RX_BUFFER_COUNT 2       /* One per BNO085 + spare */
+#define CONFIG_BLE_TX_BUFFER_COUNT  4       /* Frames being packed/notified */
+#define CONFIG_DMA_SMALL_BUFFER_COUNT 4
+
+#define CONFIG_DMA_POOL_DEBUG       0       /* Owner checks without DEBUG=1 */
 
 /*******************************************************************************
  * Error Handling
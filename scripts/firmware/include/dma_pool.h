@@ -0,0 +1,175 @@
+/**
+ * @file dma_pool.h
+ * @brief Fixed-block RAM pool for EasyDMA buffers
+ *
+ * Every buffer handed to TWIM (and the BLE frame handed to the SoftDevice)
+ * comes from this pool, so all of them live in Data RAM, are word aligned
+ * and are accounted for in one place instead of as scattered static and
+ * stack arrays.
+ *
+ * Blocks come in three size classes (config.h "Buffer Sizes"):
+ *   DMA_POOL_SMALL - short TWIM transfers and SHTP commands
+ *   DMA_POOL_SHTP  - one full SHTP packet as received from the BNO085
+ *   DMA_POOL_BLE   - one BLE notification frame (up to ATT MTU)
+ *
+ * Allocation and free are O(1) (one free bitmap per class). Buffers are
+ * handed between modules by pointer; dma_pool_transfer() records the new
+ * owner so debug builds can check that only the owner frees a block.
+ *
+ * The pool is not interrupt-safe: allocate and free from the main context
+ * only, like the rest of the sample path.
+ *
+ * Citations:
+ * - nRF52840_PS_v1.11.pdf Section 4.6 EasyDMA:
+ *   "If TXD.PTR or RXD.PTR is not pointing to the Data RAM region, an EasyDMA
+ *    transfer may result in a HardFault and/or memory corruption."
+ */
+
+#ifndef DMA_POOL_H
+#define DMA_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/* Ownership tracking: on in debug builds or when forced in config.h */
+#if defined(DEBUG) || CONFIG_DMA_POOL_DEBUG
+#define DMA_POOL_TRACK_OWNERS       1
+#else
+#define DMA_POOL_TRACK_OWNERS       0
+#endif
+
+/* Fault reasons passed to dma_pool_fault_handler() */
+#define DMA_POOL_FAULT_NOT_A_BLOCK  1       /* Pointer is not a pool block */
+#define DMA_POOL_FAULT_DOUBLE_FREE  2       /* Block already free */
+#define DMA_POOL_FAULT_WRONG_OWNER  3       /* Caller does not own the block */
+
+/*******************************************************************************
+ * Data Structures
+ ******************************************************************************/
+
+/**
+ * @brief Block size classes
+ */
+typedef enum {
+    DMA_POOL_SMALL = 0,
+    DMA_POOL_SHTP,
+    DMA_POOL_BLE,
+    DMA_POOL_CLASS_COUNT
+} dma_pool_class_t;
+
+/**
+ * @brief Block owners (checked when DMA_POOL_TRACK_OWNERS is 1)
+ */
+typedef enum {
+    DMA_OWNER_NONE = 0,
+    DMA_OWNER_TWIM,
+    DMA_OWNER_BNO085,
+    DMA_OWNER_PIPELINE,
+    DMA_OWNER_BLE,
+    DMA_OWNER_TEST,
+    DMA_OWNER_COUNT
+} dma_pool_owner_t;
+
+/**
+ * @brief Per-class usage statistics
+ */
+typedef struct {
+    uint16_t block_size;        /* Bytes per block */
+    uint8_t  block_count;       /* Blocks in the class */
+    uint8_t  in_use;            /* Blocks currently allocated */
+    uint8_t  high_water;        /* Maximum in_use seen */
+    uint32_t alloc_failures;    /* Allocations refused: class exhausted */
+} dma_pool_stats_t;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Mark every block free and clear statistics
+ */
+void dma_pool_init(void);
+
+/**
+ * @brief Allocate a block from a size class
+ * @param cls   Size class
+ * @param owner Module taking ownership
+ * @return Word-aligned block in Data RAM, or NULL if the class is exhausted
+ */
+uint8_t *dma_pool_alloc(dma_pool_class_t cls, dma_pool_owner_t owner);
+
+/**
+ * @brief Allocate from the smallest class whose blocks hold len bytes
+ * @param len   Bytes needed
+ * @param owner Module taking ownership
+ * @return Block, or NULL if len is too large or the class is exhausted
+ */
+uint8_t *dma_pool_alloc_size(uint16_t len, dma_pool_owner_t owner);
+
+/**
+ * @brief Return a block to the pool
+ * @param block Block from dma_pool_alloc*() (NULL is ignored)
+ * @param owner Module releasing it; must be the current owner
+ */
+void dma_pool_free(uint8_t *block, dma_pool_owner_t owner);
+
+/**
+ * @brief Hand a block to another module without copying it
+ * @param block Block to hand over
+ * @param from  Current owner
+ * @param to    New owner
+ *
+ * Compiles to nothing unless DMA_POOL_TRACK_OWNERS is 1.
+ */
+#if DMA_POOL_TRACK_OWNERS
+void dma_pool_transfer(uint8_t *block, dma_pool_owner_t from, dma_pool_owner_t to);
+#else
+static inline void dma_pool_transfer(uint8_t *block, dma_pool_owner_t from,
+                                     dma_pool_owner_t to)
+{
+    (void)block;
+    (void)from;
+    (void)to;
+}
+#endif
+
+/**
+ * @brief Size of a pool block
+ * @return Block size in bytes, 0 if block is not the start of a pool block
+ */
+uint16_t dma_pool_block_size(const uint8_t *block);
+
+/**
+ * @brief Current owner of a block (DMA_OWNER_NONE if untracked or free)
+ */
+dma_pool_owner_t dma_pool_owner(const uint8_t *block);
+
+/**
+ * @brief Usage statistics for a size class
+ */
+const dma_pool_stats_t *dma_pool_stats(dma_pool_class_t cls);
+
+/**
+ * @brief Called on misuse of the pool (weak; override to log or reset)
+ * @param block  Pointer passed by the caller
+ * @param reason DMA_POOL_FAULT_* code
+ *
+ * The default implementation stops in a loop so the debugger shows the
+ * caller. Overridden by the host stress test to count faults.
+ */
+void dma_pool_fault_handler(const uint8_t *block, uint32_t reason);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DMA_POOL_H */
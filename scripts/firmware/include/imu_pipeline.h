@@ -0,0 +1,128 @@
+/**
+ * @file imu_pipeline.h
+ * @brief Per-sample acquisition path: BNO085 poll -> BLE frame -> notify
+ *
+ * Glue between the BNO085 driver and the IMU GATT service, expanded from
+ * SENSOR_REPORT_TABLE. Kept out of main.c so the same code runs on target
+ * and in the host build (scripts/firmware/host) used for benchmarks and
+ * profile collection.
+ *
+ * While the central has the raw passthrough characteristic enabled
+ * (CONFIG_BLE_RAW_PASSTHROUGH), poll/notify skip decoding entirely: sensor
+ * cargo is read by EasyDMA straight into the notification buffer and
+ * forwarded in the format of shtp_passthrough.h.
+ *
+ * Citations:
+ * - FIRMWARE_DESIGN.md Section "BLE Service Design"
+ * - FIRMWARE_DESIGN.md Section "BNO085 Report Types Available"
+ */
+
+#ifndef IMU_PIPELINE_H
+#define IMU_PIPELINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bno085.h"
+#include "ble_imu_service.h"
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*******************************************************************************
+ * Data Structures
+ ******************************************************************************/
+
+/**
+ * @brief Raw passthrough counters
+ */
+typedef struct {
+    uint32_t records;           /* SHTP packets forwarded */
+    uint32_t notifications;     /* Notifications queued */
+    uint32_t dropped;           /* Packets lost: notification still pending */
+    uint32_t skipped;           /* Packets too large for one notification */
+} imu_pipeline_raw_stats_t;
+
+/**
+ * @brief Pipeline state
+ */
+typedef struct {
+    bno085_t          *imu;         /* Sensor the reports come from */
+    ble_imu_service_t *service;     /* Service the frame is notified on */
+    bno085_data_t      data;        /* Decoded reports */
+    ble_imu_frame_t   *frame;       /* Latest values in wire format
+                                     * (DMA_POOL_BLE block, notified in place) */
+    uint32_t           dirty;       /* Bit per ble_imu_sensor_t with new data */
+#if CONFIG_BLE_RAW_PASSTHROUGH
+    uint8_t           *raw;         /* Passthrough records being coalesced
+                                     * (DMA_POOL_BLE block, notified in place) */
+    uint16_t           raw_len;     /* Bytes used in raw */
+    uint32_t           raw_first_us;/* Receive time of the oldest record */
+    uint32_t           time_us;     /* Receive clock, from the cycle counter */
+    uint32_t           time_cycles; /* Cycle count at the last time_us update */
+    imu_pipeline_raw_stats_t raw_stats;
+#endif
+} imu_pipeline_t;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Initialize the pipeline
+ * @param pipeline Pipeline state
+ * @param imu      BNO085 device (may not be initialized yet)
+ * @param service  IMU GATT service (may not be initialized yet)
+ * @return BNO085_OK, or BNO085_ERR_NO_MEM if no BLE frame block is free
+ *         (two with CONFIG_BLE_RAW_PASSTHROUGH)
+ */
+int imu_pipeline_init(imu_pipeline_t *pipeline, bno085_t *imu,
+                      ble_imu_service_t *service);
+
+/**
+ * @brief Enable every report in SENSOR_REPORT_TABLE that config.h turns on
+ * @param pipeline    Pipeline state
+ * @param interval_us Report interval in microseconds
+ * @return BNO085_OK on success, error code of the first failing report
+ */
+int imu_pipeline_enable_reports(imu_pipeline_t *pipeline, uint32_t interval_us);
+
+/**
+ * @brief Poll one report from the sensor and update the BLE frame
+ *
+ * In passthrough mode, forwards one SHTP packet instead.
+ *
+ * @param pipeline Pipeline state
+ * @return Report ID received (passthrough: SHTP channel forwarded), 0 if
+ *         none, or negative error code
+ */
+int imu_pipeline_poll(imu_pipeline_t *pipeline);
+
+/**
+ * @brief Notify every characteristic whose value changed since the last call
+ *
+ * A value that could not be queued (NRF_ERROR_RESOURCES) stays dirty and
+ * is retried on the next call. In passthrough mode, sends the coalesced
+ * records once the oldest is CONFIG_BLE_RAW_FLUSH_US old.
+ *
+ * @param pipeline Pipeline state
+ */
+void imu_pipeline_notify(imu_pipeline_t *pipeline);
+
+/**
+ * @brief Force a characteristic to be sent on the next notify
+ * @param pipeline Pipeline state
+ * @param sensor   Sensor characteristic index
+ */
+static inline void imu_pipeline_mark_dirty(imu_pipeline_t *pipeline,
+                                           ble_imu_sensor_t sensor)
+{
+    pipeline->dirty |= (1UL << sensor);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IMU_PIPELINE_H */
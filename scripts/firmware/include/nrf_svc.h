@@ -196,7 +196,11 @@ extern "C" {
  *
  * @param[in] number  SVC number
  */
-#ifdef __GNUC__
+#if defined(NRF_HOST_HAL)
+/* Host build (scripts/firmware/host): SoftDevice calls become plain
+ * prototypes, implemented by the host HAL. */
+#define SVCALL(number, return_type, signature) return_type signature;
+#elif defined(__GNUC__)
 #define SVCALL(number, return_type, signature) \
     _Pragma("GCC diagnostic push") \
     _Pragma("GCC diagnostic ignored \"-Wreturn-type\"") \
@@ -216,6 +220,9 @@ extern "C" {
 /**
  * @brief Alternative SVC call macro for functions returning void
  */
+#if defined(NRF_HOST_HAL)
+#define SVCALL_VOID(number, signature) void signature;
+#else
 #define SVCALL_VOID(number, signature) \
     __attribute__((naked, unused)) static void signature \
     { \
@@ -225,6 +232,7 @@ extern "C" {
             : : "I" ((uint8_t)(number)) \
         ); \
     }
+#endif
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,49 @@
+/**
+ * @file ramfunc.h
+ * @brief Placement annotation for hot-path functions executed from RAM
+ *
+ * Functions marked RAMFUNC are linked into the .ramfunc output section,
+ * stored in flash after .data and copied to RAM by Reset_Handler. Running the
+ * per-sample path (TWIM transfer, SHTP receive, report parse, BLE notify)
+ * from RAM keeps it off the flash bus and out of the flash cache, which are
+ * shared with the SoftDevice and stall during NVMC operations.
+ *
+ * .ramfunc is linked at the Code RAM alias (0x008xxxxx), not at its Data
+ * RAM address (0x200xxxxx): fetched from there, instructions use the ICODE
+ * bus and do not wait behind the loads and stores of the code itself. The
+ * alias is also within BL range of flash, so RAM <-> flash calls need no
+ * long-branch veneers (the placement report lists any the linker adds).
+ *
+ * Citations:
+ * - nRF52840_PS_v1.11.pdf Section 4.3: "Code RAM" and AHB bus matrix
+ * - nRF52840_PS_v1.11.pdf Section 4.4.2: NVMC instruction cache
+ * - GCC Manual: "section" and "noinline" function attributes
+ */
+
+#ifndef RAMFUNC_H
+#define RAMFUNC_H
+
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Place a function in the .ramfunc section
+ *
+ * noinline keeps the body from being duplicated into flash-resident callers.
+ * Has no effect when CONFIG_ENABLE_RAMFUNC is 0 or when building for a
+ * non-ARM host, so the same sources compile unchanged in both cases.
+ */
+#if CONFIG_ENABLE_RAMFUNC && defined(__arm__)
+#define RAMFUNC     __attribute__((section(".ramfunc"), noinline))
+#else
+#define RAMFUNC
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RAMFUNC_H */
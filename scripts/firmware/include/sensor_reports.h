@@ -0,0 +1,96 @@
+/**
+ * @file sensor_reports.h
+ * @brief Single descriptor table for all BNO085 sensor reports
+ *
+ * Every SH-2 input report the firmware understands is described by exactly
+ * one row of SENSOR_REPORT_TABLE. The BNO085 parser dispatch, the report
+ * enable sequence, the packed BLE frame and the GATT characteristic table
+ * are all expanded from this table at compile time, so a report whose
+ * CONFIG_ENABLE_* flag is 0 generates no code and no data anywhere.
+ *
+ * Adding a report type is one table row plus (if it needs a new payload
+ * layout) one decoder in bno085.c and one packer in main.c.
+ *
+ * Citations:
+ * - FIRMWARE_DESIGN.md Section "BNO085 Report Types Available"
+ * - BNO08x Datasheet: SH-2 input report formats and Q-points
+ */
+
+#ifndef SENSOR_REPORTS_H
+#define SENSOR_REPORTS_H
+
+#include "config.h"
+#include "shtp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*******************************************************************************
+ * Report Descriptor Table
+ *
+ * Columns:
+ *   name     Token used to build identifiers (e.g. BLE_IMU_SENSOR_<name>)
+ *   id       SH-2 report ID (channel 3 input report)
+ *   en       CONFIG_ENABLE_* flag - must expand to a literal 0 or 1
+ *   q        Q-point of the payload values (0 for integer reports)
+ *   layout   Payload layout after the 5-byte common header:
+ *              quat_acc  - i, j, k, real (Q14) + accuracy estimate (Q12)
+ *              quat      - i, j, k, real (Q14)
+ *              vec3      - x, y, z
+ *              u32       - 32-bit counter
+ *              stability - 8-bit classification
+ *   field    Output member of bno085_data_t
+ *   ble      1 to expose the report as a notify characteristic
+ *   uuid     16-bit characteristic UUID (relative to the IMU service base)
+ ******************************************************************************/
+#define SENSOR_REPORT_TABLE(X) \
+    X(ROTATION_VECTOR, SH2_ROTATION_VECTOR,      CONFIG_ENABLE_ROTATION_VECTOR, \
+      SHTP_Q_ROTATION_VECTOR, quat_acc,  rotation_vector, 1, BLE_IMU_CHAR_QUATERNION_UUID) \
+    X(GAME_ROTATION,   SH2_GAME_ROTATION_VECTOR, CONFIG_ENABLE_GAME_ROTATION,   \
+      SHTP_Q_ROTATION_VECTOR, quat,      game_rotation,   1, BLE_IMU_CHAR_GAME_ROTATION_UUID) \
+    X(GEOMAG_ROTATION, SH2_GEOMAGNETIC_ROTATION, CONFIG_ENABLE_GEOMAG_ROTATION, \
+      SHTP_Q_ROTATION_VECTOR, quat_acc,  geomag_rotation, 1, BLE_IMU_CHAR_GEOMAG_ROTATION_UUID) \
+    X(ACCELEROMETER,   SH2_ACCELEROMETER,        CONFIG_ENABLE_ACCELEROMETER,   \
+      SHTP_Q_ACCELEROMETER,   vec3,      accelerometer,   1, BLE_IMU_CHAR_ACCEL_UUID) \
+    X(GYROSCOPE,       SH2_GYROSCOPE,            CONFIG_ENABLE_GYROSCOPE,       \
+      SHTP_Q_GYROSCOPE,       vec3,      gyroscope,       1, BLE_IMU_CHAR_GYRO_UUID) \
+    X(MAGNETOMETER,    SH2_MAGNETOMETER,         CONFIG_ENABLE_MAGNETOMETER,    \
+      SHTP_Q_MAGNETOMETER,    vec3,      magnetometer,    1, BLE_IMU_CHAR_MAG_UUID) \
+    X(LINEAR_ACCEL,    SH2_LINEAR_ACCELERATION,  CONFIG_ENABLE_LINEAR_ACCEL,    \
+      SHTP_Q_ACCELEROMETER,   vec3,      linear_accel,    1, BLE_IMU_CHAR_LINEAR_ACCEL_UUID) \
+    X(GRAVITY,         SH2_GRAVITY,              CONFIG_ENABLE_GRAVITY,         \
+      SHTP_Q_ACCELEROMETER,   vec3,      gravity,         1, BLE_IMU_CHAR_GRAVITY_UUID) \
+    X(STEP_COUNTER,    SH2_STEP_COUNTER,         CONFIG_ENABLE_STEP_COUNTER,    \
+      0,                      u32,       step_count,      0, 0) \
+    X(STABILITY,       SH2_STABILITY_CLASSIFIER, CONFIG_ENABLE_STABILITY,       \
+      0,                      stability, stability,       0, 0)
+
+/*******************************************************************************
+ * Expansion Helpers
+ ******************************************************************************/
+
+#define SENSOR_REPORT_CAT_(a, b)    a##b
+#define SENSOR_REPORT_CAT(a, b)     SENSOR_REPORT_CAT_(a, b)
+
+/**
+ * @brief Emit the trailing tokens only when flag expands to 1
+ *
+ * Selection happens in the preprocessor rather than with if (flag), so a
+ * disabled row leaves nothing behind - not even a case label or a table
+ * entry for the optimizer to discard.
+ */
+#define SENSOR_REPORT_IF(flag, ...) SENSOR_REPORT_CAT(SENSOR_REPORT_IF_, flag)(__VA_ARGS__)
+#define SENSOR_REPORT_IF_0(...)
+#define SENSOR_REPORT_IF_1(...)     __VA_ARGS__
+
+/* Count of enabled reports, usable in #if-free array sizes */
+#define SENSOR_REPORT_COUNT_ONE_(name, id, en, q, layout, field, ble, uuid) \
+    SENSOR_REPORT_IF(en, + 1)
+#define SENSOR_REPORT_ENABLED_COUNT (0 SENSOR_REPORT_TABLE(SENSOR_REPORT_COUNT_ONE_))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SENSOR_REPORTS_H */
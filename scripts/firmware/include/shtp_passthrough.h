@@ -0,0 +1,83 @@
+/**
+ * @file shtp_passthrough.h
+ * @brief Wire format of the raw SHTP passthrough characteristic
+ *
+ * In passthrough mode the firmware does not decode sensor reports. The
+ * cargo of each SHTP packet on the sensor channels (everything after the
+ * 4-byte SHTP header) is read by EasyDMA straight into the BLE notification
+ * buffer and sent as is, behind a small record header:
+ *
+ *   Byte 0:    SHTP channel (3 = input reports, 5 = gyro rotation vector)
+ *   Byte 1:    Cargo length n
+ *   Bytes 2-5: Device receive timestamp in µs (little-endian, wraps)
+ *   Bytes 6..: n bytes of SHTP cargo, as read from the BNO085
+ *
+ * Records are packed back to back until the next one would exceed the ATT
+ * payload (MTU - 3), or the oldest record is CONFIG_BLE_RAW_FLUSH_US old.
+ * A notification always holds whole records.
+ *
+ * Decoding the cargo is left to the host (host/passthrough_decoder.h).
+ *
+ * Citations:
+ * - shtp.h: SHTP header and channel numbers
+ */
+
+#ifndef SHTP_PASSTHROUGH_H
+#define SHTP_PASSTHROUGH_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SHTP_PT_RECORD_HEADER_SIZE  6
+#define SHTP_PT_MAX_CARGO           255     /* Length field is one byte */
+
+/* Record header byte positions */
+#define SHTP_PT_CHANNEL             0
+#define SHTP_PT_LENGTH              1
+#define SHTP_PT_TIMESTAMP           2
+
+/*******************************************************************************
+ * Inline Functions
+ ******************************************************************************/
+
+/**
+ * @brief Write a record header
+ * @param record       Start of the record
+ * @param channel      SHTP channel the cargo arrived on
+ * @param cargo_len    Cargo bytes following the header
+ * @param timestamp_us Receive time
+ */
+static inline void shtp_pt_put_header(uint8_t *record, uint8_t channel,
+                                      uint8_t cargo_len, uint32_t timestamp_us)
+{
+    record[SHTP_PT_CHANNEL] = channel;
+    record[SHTP_PT_LENGTH] = cargo_len;
+    record[SHTP_PT_TIMESTAMP + 0] = (uint8_t)(timestamp_us);
+    record[SHTP_PT_TIMESTAMP + 1] = (uint8_t)(timestamp_us >> 8);
+    record[SHTP_PT_TIMESTAMP + 2] = (uint8_t)(timestamp_us >> 16);
+    record[SHTP_PT_TIMESTAMP + 3] = (uint8_t)(timestamp_us >> 24);
+}
+
+/**
+ * @brief Read the timestamp of a record
+ */
+static inline uint32_t shtp_pt_get_timestamp(const uint8_t *record)
+{
+    return (uint32_t)record[SHTP_PT_TIMESTAMP] |
+           ((uint32_t)record[SHTP_PT_TIMESTAMP + 1] << 8) |
+           ((uint32_t)record[SHTP_PT_TIMESTAMP + 2] << 16) |
+           ((uint32_t)record[SHTP_PT_TIMESTAMP + 3] << 24);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHTP_PASSTHROUGH_H */
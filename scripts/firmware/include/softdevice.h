@@ -143,10 +143,15 @@ bool softdevice_is_enabled(void);
 /**
  * @brief Get the application RAM base address
  *
- * Returns the start address of RAM available to the application
- * after SoftDevice and BLE stack RAM allocation.
+ * Returns the minimum application RAM start the SoftDevice requires for
+ * the configured BLE parameters, as reported by sd_ble_enable(). It is
+ * also kept after softdevice_init() fails with NRF_ERROR_NO_MEM.
  *
- * @return Application RAM base address
+ * The value must not exceed the linker script's RAM origin
+ * (__sd_ram_end__). `make stack SD_RAM_BASE=<value>` checks it against
+ * the .map file.
+ *
+ * @return Required application RAM base address
  */
 uint32_t softdevice_app_ram_base_get(void);
 
@@ -126,6 +126,21 @@ extern "C" {
 #define TWIM_ERR_TIMEOUT            -4          /* Transaction timeout */
 #define TWIM_ERR_BUSY               -5          /* Bus busy */
 #define TWIM_ERR_INVALID_PARAM      -6          /* Invalid parameter */
+#define TWIM_ERR_NOT_DMA_SAFE       -7          /* Buffer outside Data RAM */
+
+/*******************************************************************************
+ * EasyDMA Buffer Region
+ * Citation: nRF52840_PS_v1.11.pdf Section 4.6 EasyDMA:
+ *   "If TXD.PTR or RXD.PTR is not pointing to the Data RAM region, an EasyDMA
+ *    transfer may result in a HardFault and/or memory corruption."
+ ******************************************************************************/
+#define TWIM_DMA_RAM_START          0x20000000UL
+#define TWIM_DMA_RAM_END            0x20040000UL
+
+/* True if [ptr, ptr + len) lies in Data RAM */
+#define TWIM_IS_DMA_SAFE(ptr, len)                                          \
+    ((uint32_t)(ptr) >= TWIM_DMA_RAM_START &&                               \
+     (uint32_t)(ptr) + (len) <= TWIM_DMA_RAM_END)
 
 /*******************************************************************************
  * TWIM Frequency Enumeration
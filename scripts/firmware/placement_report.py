@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+"""Report where functions landed (RAM vs flash) and how large they are.
+
+Reads the symbol table printed by `arm-none-eabi-objdump -t <elf>` from a
+file argument or stdin. Used by `make placement`; the report is also written
+next to the .map file on every link.
+"""
+import re
+import sys
+
+# objdump -t line: address, 7 flag columns, section, size, name
+SYMBOL_RE = re.compile(r'^([0-9a-fA-F]{8})\s(.{7})\s(\S+)\s+([0-9a-fA-F]{8})\s+(\S+)$')
+
+# Code RAM alias of Data RAM, where .ramfunc is linked (see ramfunc.h)
+CODE_RAM_START = 0x00800000
+CODE_RAM_END = 0x00840000
+RAM_START = 0x20000000
+
+lines = open(sys.argv[1]).read().splitlines() if len(sys.argv) > 1 else sys.stdin.read().splitlines()
+
+functions = []
+veneers = []
+for line in lines:
+    m = SYMBOL_RE.match(line.strip())
+    if not m:
+        continue
+    addr, flags, section, size, name = m.groups()
+    addr = int(addr, 16)
+    size = int(size, 16)
+    if name.endswith('_veneer'):
+        veneers.append((addr, section, name))
+    elif 'F' in flags:
+        functions.append((addr, section, size, name))
+
+ram = sorted(f for f in functions if f[1] == '.ramfunc')
+flash = sorted((f for f in functions if f[1] != '.ramfunc'), key=lambda f: -f[2])
+
+print('Code placement report')
+print('=====================')
+print(f'RAM  (.ramfunc): {len(ram):4d} functions, {sum(f[2] for f in ram):6d} bytes')
+print(f'Flash (.text)  : {len(flash):4d} functions, {sum(f[2] for f in flash):6d} bytes')
+print()
+
+print('RAM-resident functions (by address)')
+print('-----------------------------------')
+for addr, section, size, name in ram:
+    if CODE_RAM_START <= addr < CODE_RAM_END:
+        where = 'CODE'
+    elif addr >= RAM_START:
+        where = 'DATA'  # Fetched over the system bus; check the linker script
+    else:
+        where = 'FLASH?'
+    print(f'  0x{addr:08X} {size:6d}  {where:6s} {name}')
+if not ram:
+    print('  (none - CONFIG_ENABLE_RAMFUNC is 0 or no RAMFUNC annotations)')
+print()
+
+print('Largest flash-resident functions')
+print('--------------------------------')
+for addr, section, size, name in flash[:25]:
+    print(f'  0x{addr:08X} {size:6d}  {section:10s} {name}')
+print()
+
+print('Long-branch veneers (RAM <-> flash calls)')
+print('-----------------------------------------')
+for addr, section, name in sorted(veneers):
+    region = 'RAM' if addr >= RAM_START or CODE_RAM_START <= addr < CODE_RAM_END else 'FLASH'
+    print(f'  0x{addr:08X} {region:6s} {name}')
+if not veneers:
+    print('  (none)')
@@ -6,9 +6,25 @@
  * for Adafruit LED Glasses Driver (nRF52840)
  * 
  * This sketch reads quaternion, magnetometer, and linear acceleration data from 
- * a BNO085 9-DoF IMU via I2C and streams it over BLE UART at the maximum possible rate.
+ * a BNO085 9-DoF IMU via I2C and streams it over BLE at the maximum possible rate.
  * The onboard LED blinks on each transmission.
  * 
+ * Each loop drains every pending BNO085 event and packs the frames for all
+ * new samples back to back into one TX buffer, flushed with a single write
+ * no larger than the negotiated ATT payload (MTU - 3). The receiver sees the
+ * same frame stream, just fewer and fuller notifications.
+ * 
+ * Two ways to receive the stream, chosen by which one the central subscribes to:
+ *   - Stream characteristic (custom service): each TX buffer is sent with one
+ *     direct notify, and a notification the SoftDevice could not queue is
+ *     counted instead of disappearing into a FIFO. On connect the sketch
+ *     requests a 247-byte MTU, the 2M PHY and data length extension.
+ *   - BLE UART (Nordic UART Service): the original path through BLEUart,
+ *     kept for Bluefruit Connect and other NUS clients. It carries the
+ *     original '!' packets (see Legacy Packet Format), not frames, since
+ *     that is what Bluefruit Connect parses.
+ *   If both are subscribed the stream characteristic wins.
+ * 
  * Hardware:
  *   - Adafruit LED Glasses Driver - nRF52840 BLE
  *   - Adafruit BNO085 9-DoF IMU (I2C connection)
@@ -24,33 +40,48 @@
  *   - SCL -> SCL pin
  *   - SDA -> SDA pin
  * 
- * Quaternion Packet Format (20 bytes):
- *   Byte 0:     '!'  (start marker)
- *   Byte 1:     'Q'  (quaternion identifier)
- *   Bytes 2-5:  w (float, 4 bytes)
- *   Bytes 6-9:  x (float, 4 bytes)
- *   Bytes 10-13: y (float, 4 bytes)
- *   Bytes 14-17: z (float, 4 bytes)
- *   Byte 18:    checksum (~sum of bytes 0-17)
- *   Byte 19:    newline '\n'
+ * Frame Format (stream characteristic):
+ *   Every sample is sent as one COBS-encoded frame terminated by 0x00:
+ *     COBS( type | seq | ts | payload | crc16 ) 0x00
+ *   Byte 0:      type ('Q', 'M' or 'A'); bit 7 set when ts is absolute
+ *   Byte 1:      seq (uint8, +1 per frame across all types)
+ *   Bytes 2..:   ts, the BNO085 sensor timestamp in microseconds as a
+ *                LEB128 varint: absolute (low 32 bits) on the first frame
+ *                after connect and every FRAME_ABS_TS_INTERVAL frames,
+ *                otherwise the zigzag-encoded signed delta from the
+ *                previous frame (2 bytes at 200 Hz)
+ *   Then:        payload (little-endian floats, see below)
+ *   Last 2:      CRC-16/CCITT-FALSE over everything before it (little-endian)
+ *   COBS removes every zero byte from the frame, so 0x00 only ever appears
+ *   as the delimiter and a receiver resyncs at the next zero whatever the
+ *   float bytes contain. A gap in seq means frames were lost; deltas after
+ *   a gap are meaningless until the next absolute timestamp.
+ * 
+ * Legacy Packet Format (BLE UART only):
+ *   '!', type ('Q', 'M' or 'A'), payload (same floats as the frames),
+ *   checksum (~sum of all bytes before it), '\n'. 20 bytes for 'Q', 16 for
+ *   'M' and 'A'. No sequence number or timestamp.
+ * 
+ * Interval Histogram:
+ *   Every HIST_DUMP_MS the sketch prints, per report type, a histogram of
+ *   the intervals between consecutive sensor timestamps, to check the
+ *   BNO085 really delivers REPORT_INTERVAL_US while BLE is busy.
+ * 
+ * Quaternion Payload ('Q', 16 bytes):
+ *   Bytes 0-3:   w (float, 4 bytes)
+ *   Bytes 4-7:   x (float, 4 bytes)
+ *   Bytes 8-11:  y (float, 4 bytes)
+ *   Bytes 12-15: z (float, 4 bytes)
  * 
- * Magnetometer Packet Format (16 bytes):
- *   Byte 0:     '!'  (start marker)
- *   Byte 1:     'M'  (magnetometer identifier)
- *   Bytes 2-5:  mag_x (float, 4 bytes) - micro Tesla (uT)
- *   Bytes 6-9:  mag_y (float, 4 bytes) - micro Tesla (uT)
- *   Bytes 10-13: mag_z (float, 4 bytes) - micro Tesla (uT)
- *   Byte 14:    checksum (~sum of bytes 0-13)
- *   Byte 15:    newline '\n'
+ * Magnetometer Payload ('M', 12 bytes):
+ *   Bytes 0-3:   mag_x (float, 4 bytes) - micro Tesla (uT)
+ *   Bytes 4-7:   mag_y (float, 4 bytes) - micro Tesla (uT)
+ *   Bytes 8-11:  mag_z (float, 4 bytes) - micro Tesla (uT)
  * 
- * Linear Acceleration Packet Format (16 bytes):
- *   Byte 0:     '!'  (start marker)
- *   Byte 1:     'A'  (linear acceleration identifier)
- *   Bytes 2-5:  accel_x (float, 4 bytes) - m/s^2
- *   Bytes 6-9:  accel_y (float, 4 bytes) - m/s^2
- *   Bytes 10-13: accel_z (float, 4 bytes) - m/s^2
- *   Byte 14:    checksum (~sum of bytes 0-13)
- *   Byte 15:    newline '\n'
+ * Linear Acceleration Payload ('A', 12 bytes):
+ *   Bytes 0-3:   accel_x (float, 4 bytes) - m/s^2
+ *   Bytes 4-7:   accel_y (float, 4 bytes) - m/s^2
+ *   Bytes 8-11:  accel_z (float, 4 bytes) - m/s^2
  * 
  * Magnetometer Units:
  *   The BNO085 SH2_MAGNETIC_FIELD_CALIBRATED report provides calibrated
@@ -83,6 +114,19 @@
 // BLE Configuration
 #define DEVICE_NAME       "QuatStream"
 #define TX_POWER          4               // dBm (-40 to +8)
+#define REQUESTED_MTU     247             // ATT MTU requested on connect
+
+// Stream service / characteristic, 128-bit UUIDs in little-endian byte order
+// 7b1e0001-5d2c-4a8f-9e61-3c0b9a7d4f12 (service)
+// 7b1e0002-5d2c-4a8f-9e61-3c0b9a7d4f12 (notify characteristic)
+const uint8_t STREAM_SERVICE_UUID[16] = {
+  0x12, 0x4F, 0x7D, 0x9A, 0x0B, 0x3C, 0x61, 0x9E,
+  0x8F, 0x4A, 0x2C, 0x5D, 0x01, 0x00, 0x1E, 0x7B
+};
+const uint8_t STREAM_CHAR_UUID[16] = {
+  0x12, 0x4F, 0x7D, 0x9A, 0x0B, 0x3C, 0x61, 0x9E,
+  0x8F, 0x4A, 0x2C, 0x5D, 0x02, 0x00, 0x1E, 0x7B
+};
 
 // BNO085 Configuration
 #define BNO085_I2C_ADDR   0x4A            // Default I2C address (0x4B if DI pin high)
@@ -91,6 +135,29 @@
 // Report Configuration - rotation_vector gives best quaternion fusion
 #define REPORT_INTERVAL_US 5000           // 5ms = 200Hz (fastest stable rate)
 
+// TX Framing Configuration
+#define TX_BUFFER_MAX     244             // ATT payload at the 247-byte MTU ceiling
+#define MAX_EVENTS_PER_LOOP 16            // Bound on BNO085 events drained per loop
+
+// Frame Configuration
+#define FRAME_TYPE_QUATERNION   'Q'
+#define FRAME_TYPE_MAGNETOMETER 'M'
+#define FRAME_TYPE_LINEAR_ACCEL 'A'
+#define FRAME_TYPE_ABS_TS 0x80            // Flag: ts field is absolute
+#define FRAME_ABS_TS_INTERVAL 64          // Frames between absolute timestamps
+#define FRAME_HEADER_LEN  2               // type, seq
+#define FRAME_TS_MAX_LEN  5               // 32-bit LEB128
+#define FRAME_CRC_LEN     2
+#define FRAME_MAX_PAYLOAD 16
+#define FRAME_MAX_RAW     (FRAME_HEADER_LEN + FRAME_TS_MAX_LEN + FRAME_MAX_PAYLOAD + FRAME_CRC_LEN)
+#define FRAME_MAX_ENCODED (FRAME_MAX_RAW + 2)  // + COBS code byte + delimiter
+#define LEGACY_MARKER     '!'             // BLE UART packets: '!', type, payload, checksum, '\n'
+
+// Interval Histogram Configuration
+#define HIST_BIN_US       250             // Bin width
+#define HIST_BINS         40              // 0-10 ms, plus one overflow bin
+#define HIST_DUMP_MS      10000           // Print and reset period
+
 // ============================================================================
 // GLOBAL VARIABLES
 // ============================================================================
@@ -102,13 +169,17 @@ bool imuReady = false;
 
 // BLE
 BLEUart bleuart;
+BLEService streamService(STREAM_SERVICE_UUID);
+BLECharacteristic streamChar(STREAM_CHAR_UUID);
 bool isConnected = false;
+uint16_t connHandle = BLE_CONN_HANDLE_INVALID;
 
 // Quaternion data
 float quat_w = 1.0f;
 float quat_x = 0.0f;
 float quat_y = 0.0f;
 float quat_z = 0.0f;
+uint32_t quat_ts = 0;                   // Sensor timestamp (us, low 32 bits)
 bool newQuatData = false;
 
 // Magnetometer data (in micro Tesla, uT)
@@ -116,6 +187,7 @@ bool newQuatData = false;
 float mag_x = 0.0f;
 float mag_y = 0.0f;
 float mag_z = 0.0f;
+uint32_t mag_ts = 0;
 bool newMagData = false;
 
 // Linear acceleration data (in m/s^2, gravity removed)
@@ -124,6 +196,7 @@ bool newMagData = false;
 float linaccel_x = 0.0f;
 float linaccel_y = 0.0f;
 float linaccel_z = 0.0f;
+uint32_t linaccel_ts = 0;
 bool newLinAccelData = false;
 
 // Statistics
@@ -134,11 +207,40 @@ uint32_t lastStatsTime = 0;
 uint32_t imuReadCount = 0;
 uint32_t magReadCount = 0;
 uint32_t linAccelReadCount = 0;
+uint32_t txWriteCount = 0;
+uint32_t txByteCount = 0;
+uint32_t notifyFailCount = 0;           // Direct notifies the stack refused (since connect)
+
+// Interval histogram of sensor timestamps, one per report type
+struct IntervalHist {
+  uint32_t bins[HIST_BINS + 1];         // Last bin: >= HIST_BINS * HIST_BIN_US
+  uint32_t count;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint32_t sumUs;
+  uint32_t lastTs;
+  bool haveLast;
+};
+IntervalHist quatHist;
+IntervalHist magHist;
+IntervalHist linAccelHist;
+uint32_t lastHistDumpTime = 0;
 
-// Packet buffers
-uint8_t quatPacket[20];
-uint8_t magPacket[16];
-uint8_t linAccelPacket[16];
+// Frame building
+uint8_t txSeq = 0;
+uint32_t txLastTs = 0;                  // Timestamp of the previous frame built
+bool txHaveTs = false;                  // txLastTs valid; deltas allowed
+uint8_t frameRaw[FRAME_MAX_RAW];
+uint8_t frameEncoded[FRAME_MAX_ENCODED];
+
+// TX buffer: frames queued since the last flush, plus how many of each type
+// it holds so the per-type counters only move when the write succeeds
+uint8_t txBuffer[TX_BUFFER_MAX];
+uint16_t txBufferLen = 0;
+uint16_t txBufferQuat = 0;
+uint16_t txBufferMag = 0;
+uint16_t txBufferLinAccel = 0;
+bool txBufferStream = false;            // Queued as frames (stream) or '!' packets (UART)
 
 // ============================================================================
 // LED CONTROL
@@ -246,104 +348,138 @@ bool setupIMU() {
 }
 
 // ============================================================================
-// PACKET BUILDING
+// FRAME BUILDING
 // ============================================================================
 
-void buildQuaternionPacket(float w, float x, float y, float z) {
-  uint8_t checksum = 0;
-  
-  // Start marker
-  quatPacket[0] = '!';
-  checksum += '!';
+/*
+ * CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), bytewise without a table.
+ * Unlike the old 8-bit additive checksum it catches swapped bytes and all
+ * burst errors up to 16 bits.
+ */
+uint16_t crc16(const uint8_t* data, uint8_t len) {
+  uint16_t crc = 0xFFFF;
   
-  // Quaternion identifier
-  quatPacket[1] = 'Q';
-  checksum += 'Q';
+  for (uint8_t i = 0; i < len; i++) {
+    uint8_t x = (crc >> 8) ^ data[i];
+    x ^= x >> 4;
+    crc = (crc << 8) ^ ((uint16_t)x << 12) ^ ((uint16_t)x << 5) ^ x;
+  }
   
-  // Copy float values (little-endian)
-  memcpy(&quatPacket[2], &w, 4);
-  memcpy(&quatPacket[6], &x, 4);
-  memcpy(&quatPacket[10], &y, 4);
-  memcpy(&quatPacket[14], &z, 4);
+  return crc;
+}
+
+/*
+ * COBS-encode len bytes from in and append the 0x00 delimiter.
+ * Frames are far shorter than 254 bytes, so there is never a 0xFF block.
+ * Returns the encoded length including the delimiter.
+ */
+uint8_t cobsEncode(const uint8_t* in, uint8_t len, uint8_t* out) {
+  uint8_t codePos = 0;
+  uint8_t outPos = 1;
+  uint8_t code = 1;
   
-  // Calculate checksum over float bytes
-  for (int i = 2; i < 18; i++) {
-    checksum += quatPacket[i];
+  for (uint8_t i = 0; i < len; i++) {
+    if (in[i] == 0) {
+      out[codePos] = code;
+      codePos = outPos++;
+      code = 1;
+    } else {
+      out[outPos++] = in[i];
+      code++;
+    }
   }
   
-  // Checksum (inverted sum)
-  quatPacket[18] = ~checksum;
-  
-  // Newline terminator
-  quatPacket[19] = '\n';
+  out[codePos] = code;
+  out[outPos++] = 0x00;
+  return outPos;
 }
 
 /*
- * Build magnetometer packet (16 bytes)
- * Values are in micro Tesla (uT) - already calibrated by BNO085
- * Citation: Adafruit BNO085 datasheet, Page 31
+ * Write value as a LEB128 varint (7 bits per byte, low bits first).
+ * Returns the number of bytes written (1-5).
  */
-void buildMagnetometerPacket(float mx, float my, float mz) {
-  uint8_t checksum = 0;
+uint8_t putVarint(uint32_t value, uint8_t* out) {
+  uint8_t n = 0;
   
-  // Start marker
-  magPacket[0] = '!';
-  checksum += '!';
+  while (value >= 0x80) {
+    out[n++] = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  out[n++] = value;
+  return n;
+}
+
+/*
+ * Build one frame (type, seq, timestamp, payload, CRC-16) into frameEncoded.
+ * The sequence number advances on every frame built, so a frame that is
+ * built but never sent shows up as a gap on the receiver.
+ * Returns the encoded length including the delimiter.
+ */
+uint8_t buildFrame(uint8_t type, uint32_t timestampUs, const float* values, uint8_t count) {
+  uint8_t len = count * sizeof(float);
+  uint32_t tsField;
   
-  // Magnetometer identifier
-  magPacket[1] = 'M';
-  checksum += 'M';
+  // Absolute timestamp periodically so a receiver can recover after a gap;
+  // otherwise a signed delta (reports of different types can arrive out of
+  // timestamp order), zigzag-mapped so small negatives stay small
+  if (!txHaveTs || (txSeq % FRAME_ABS_TS_INTERVAL) == 0) {
+    type |= FRAME_TYPE_ABS_TS;
+    tsField = timestampUs;
+  } else {
+    int32_t delta = (int32_t)(timestampUs - txLastTs);
+    tsField = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+  }
+  txHaveTs = true;
+  txLastTs = timestampUs;
   
-  // Copy float values (little-endian) - units: micro Tesla (uT)
-  memcpy(&magPacket[2], &mx, 4);
-  memcpy(&magPacket[6], &my, 4);
-  memcpy(&magPacket[10], &mz, 4);
+  frameRaw[0] = type;
+  frameRaw[1] = txSeq++;
+  uint8_t pos = FRAME_HEADER_LEN + putVarint(tsField, &frameRaw[FRAME_HEADER_LEN]);
   
-  // Calculate checksum over float bytes
-  for (int i = 2; i < 14; i++) {
-    checksum += magPacket[i];
-  }
+  // Copy float values (little-endian)
+  memcpy(&frameRaw[pos], values, len);
+  pos += len;
   
-  // Checksum (inverted sum)
-  magPacket[14] = ~checksum;
+  uint16_t crc = crc16(frameRaw, pos);
+  frameRaw[pos++] = crc & 0xFF;
+  frameRaw[pos++] = crc >> 8;
   
-  // Newline terminator
-  magPacket[15] = '\n';
+  return cobsEncode(frameRaw, pos, frameEncoded);
 }
 
 /*
- * Build linear acceleration packet (16 bytes)
- * Values are in m/s^2 - gravity has been removed by BNO085 sensor fusion
- * Citation: Adafruit BNO085 datasheet, Page 6 & 31:
- *   "Linear Acceleration Vector: Three axes of linear acceleration data
- *   (acceleration minus gravity) in m/s^2"
+ * Build one legacy '!' packet (BLE UART path) into frameEncoded, in the
+ * format Bluefruit Connect parses: '!', type, float payload, inverted
+ * 8-bit sum of all bytes before it, '\n'.
+ * Returns the packet length.
  */
-void buildLinearAccelPacket(float ax, float ay, float az) {
+uint8_t buildLegacyPacket(uint8_t type, const float* values, uint8_t count) {
+  uint8_t len = count * sizeof(float);
   uint8_t checksum = 0;
   
-  // Start marker
-  linAccelPacket[0] = '!';
-  checksum += '!';
-  
-  // Linear acceleration identifier ('A' for Acceleration)
-  linAccelPacket[1] = 'A';
-  checksum += 'A';
+  frameEncoded[0] = LEGACY_MARKER;
+  frameEncoded[1] = type;
+  memcpy(&frameEncoded[2], values, len);
   
-  // Copy float values (little-endian) - units: m/s^2
-  memcpy(&linAccelPacket[2], &ax, 4);
-  memcpy(&linAccelPacket[6], &ay, 4);
-  memcpy(&linAccelPacket[10], &az, 4);
-  
-  // Calculate checksum over float bytes
-  for (int i = 2; i < 14; i++) {
-    checksum += linAccelPacket[i];
+  uint8_t pos = 2 + len;
+  for (uint8_t i = 0; i < pos; i++) {
+    checksum += frameEncoded[i];
   }
-  
-  // Checksum (inverted sum)
-  linAccelPacket[14] = ~checksum;
-  
-  // Newline terminator
-  linAccelPacket[15] = '\n';
+  frameEncoded[pos++] = ~checksum;
+  frameEncoded[pos++] = '\n';
+  return pos;
+}
+
+/*
+ * Build one sample for the path it will be sent on: a frame for the stream
+ * characteristic, a legacy packet for BLE UART.
+ * Returns the length written to frameEncoded.
+ */
+uint8_t buildSample(uint8_t type, uint32_t timestampUs, const float* values, uint8_t count) {
+  if (txBufferStream) {
+    return buildFrame(type, timestampUs, values, count);
+  }
+  return buildLegacyPacket(type, values, count);
 }
 
 // ============================================================================
@@ -351,13 +487,33 @@ void buildLinearAccelPacket(float ax, float ay, float az) {
 // ============================================================================
 
 void connect_callback(uint16_t conn_handle) {
-  (void)conn_handle;
+  connHandle = conn_handle;
   isConnected = true;
   packetCount = 0;
   magPacketCount = 0;
   linAccelPacketCount = 0;
+  txWriteCount = 0;
+  txByteCount = 0;
+  notifyFailCount = 0;
+  txSeq = 0;
+  txHaveTs = false;
+  txBufferLen = 0;
+  txBufferQuat = 0;
+  txBufferMag = 0;
+  txBufferLinAccel = 0;
+  txBufferStream = false;
   lastStatsTime = millis();
   
+  // Ask for the fastest link the central will give us. These are requests:
+  // the central may refuse any of them, and the MTU exchange and PHY update
+  // complete after this callback, so txBufferLimit() reads the MTU live.
+  BLEConnection* conn = Bluefruit.Connection(conn_handle);
+  if (conn) {
+    conn->requestMtuExchange(REQUESTED_MTU);
+    conn->requestPHY(BLE_GAP_PHY_2MBPS);
+    conn->requestDataLengthUpdate();
+  }
+  
   Serial.println("BLE Connected!");
   Serial.println("Starting quaternion + magnetometer + linear acceleration stream...");
   
@@ -369,6 +525,7 @@ void disconnect_callback(uint16_t conn_handle, uint8_t reason) {
   (void)conn_handle;
   (void)reason;
   isConnected = false;
+  connHandle = BLE_CONN_HANDLE_INVALID;
   
   Serial.println("BLE Disconnected");
   Serial.print("Reason: 0x");
@@ -383,6 +540,9 @@ void setupBLE() {
   Serial.println("Initializing BLE...");
   
   // Initialize Bluefruit
+  // BANDWIDTH_MAX raises the MTU ceiling to 247 and lengthens the connection
+  // event so several notifications fit per interval; must precede begin()
+  Bluefruit.configPrphBandwidth(BANDWIDTH_MAX);
   Bluefruit.begin();
   Bluefruit.setTxPower(TX_POWER);
   Bluefruit.setName(DEVICE_NAME);
@@ -397,6 +557,14 @@ void setupBLE() {
   // Start BLE UART service
   bleuart.begin();
   
+  // Start stream service: one notify-only characteristic carrying up to
+  // one ATT payload per notification
+  streamService.begin();
+  streamChar.setProperties(CHR_PROPS_NOTIFY);
+  streamChar.setPermission(SECMODE_OPEN, SECMODE_NO_ACCESS);
+  streamChar.setMaxLen(TX_BUFFER_MAX);
+  streamChar.begin();
+  
   // Setup advertising
   startAdvertising();
   
@@ -408,7 +576,9 @@ void startAdvertising() {
   Bluefruit.Advertising.addTxPower();
   Bluefruit.Advertising.addService(bleuart);
   
-  // Add device name in scan response
+  // Add stream service and device name in scan response
+  // (the 128-bit UUID does not fit next to the UART one in the advert)
+  Bluefruit.ScanResponse.addService(streamService);
   Bluefruit.ScanResponse.addName();
   
   // Advertising configuration
@@ -425,23 +595,14 @@ void startAdvertising() {
 // ============================================================================
 
 /*
- * Read sensor data from BNO085. 
+ * Store one BNO085 event.
  * Handles quaternion, magnetometer, and linear acceleration reports.
- * Returns true if any new data is available.
+ * Returns true if the event carried one of them.
  */
-bool readSensors() {
-  if (!imuReady) {
-    return false;
-  }
-  
-  if (bno08x.wasReset()) {
-    Serial.println("BNO085 was reset, re-enabling reports...");
-    setReports();
-  }
-  
-  if (!bno08x.getSensorEvent(&sensorValue)) {
-    return false;
-  }
+bool handleSensorEvent() {
+  // SH-2 timestamp in microseconds; the low 32 bits wrap every ~71 minutes,
+  // which unsigned deltas handle
+  uint32_t ts = (uint32_t)sensorValue.timestamp;
   
   switch (sensorValue.sensorId) {
     case SH2_ROTATION_VECTOR:
@@ -450,6 +611,8 @@ bool readSensors() {
       quat_x = sensorValue.un.rotationVector.i;
       quat_y = sensorValue.un.rotationVector.j;
       quat_z = sensorValue.un.rotationVector.k;
+      quat_ts = ts;
+      histRecord(quatHist, ts);
       imuReadCount++;
       newQuatData = true;
       return true;
@@ -461,6 +624,8 @@ bool readSensors() {
       mag_x = sensorValue.un.magneticField.x;
       mag_y = sensorValue.un.magneticField.y;
       mag_z = sensorValue.un.magneticField.z;
+      mag_ts = ts;
+      histRecord(magHist, ts);
       magReadCount++;
       newMagData = true;
       return true;
@@ -475,6 +640,8 @@ bool readSensors() {
       linaccel_x = sensorValue.un.linearAcceleration.x;
       linaccel_y = sensorValue.un.linearAcceleration.y;
       linaccel_z = sensorValue.un.linearAcceleration.z;
+      linaccel_ts = ts;
+      histRecord(linAccelHist, ts);
       linAccelReadCount++;
       newLinAccelData = true;
       return true;
@@ -486,86 +653,266 @@ bool readSensors() {
   return false;
 }
 
-// ============================================================================
-// DATA STREAMING
-// ============================================================================
-
 /*
- * Stream quaternion data over BLE.
- * Returns true if packet was sent successfully.
+ * Drain pending BNO085 events.
+ * Every new sample is framed into the TX buffer as it is read, so a burst
+ * of several reports between loops is sent in full rather than only the
+ * latest value of each type. MAX_EVENTS_PER_LOOP keeps a stalled link
+ * from starving printStats() and the BLE stack.
+ * Returns the number of sensor events handled.
  */
-bool streamQuaternion() {
-  if (!isConnected) {
-    return false;
+uint16_t readSensors() {
+  if (!imuReady) {
+    return 0;
   }
   
-  // Build packet with current quaternion values
-  buildQuaternionPacket(quat_w, quat_x, quat_y, quat_z);
+  if (bno08x.wasReset()) {
+    Serial.println("BNO085 was reset, re-enabling reports...");
+    setReports();
+    // The sensor clock restarted; don't count the jump as an interval
+    quatHist.haveLast = false;
+    magHist.haveLast = false;
+    linAccelHist.haveLast = false;
+  }
   
-  // Send via BLE UART
-  uint16_t written = bleuart.write(quatPacket, 20);
+  uint16_t events = 0;
+  while (events < MAX_EVENTS_PER_LOOP && bno08x.getSensorEvent(&sensorValue)) {
+    if (handleSensorEvent()) {
+      events++;
+      queueNewData();
+    }
+  }
   
-  if (written == 20) {
-    packetCount++;
-    return true;
+  return events;
+}
+
+// ============================================================================
+// DATA STREAMING
+// ============================================================================
+
+/*
+ * Largest TX buffer a single write can carry as one notification:
+ * the negotiated ATT MTU minus the 3-byte notification header.
+ */
+uint16_t txBufferLimit() {
+  uint16_t mtu = BLE_GATT_ATT_MTU_DEFAULT;
+  BLEConnection* conn = Bluefruit.Connection(connHandle);
+  if (conn) {
+    mtu = conn->getMtu();
   }
   
-  return false;
+  uint16_t limit = mtu - 3;
+  return (limit < TX_BUFFER_MAX) ? limit : TX_BUFFER_MAX;
 }
 
 /*
- * Stream magnetometer data over BLE.
- * Values are in micro Tesla (uT) - already in physical units.
- * Returns true if packet was sent successfully.
+ * True if the central subscribed to the stream characteristic.
  */
-bool streamMagnetometer() {
-  if (!isConnected) {
-    return false;
+bool streamModeActive() {
+  return isConnected && streamChar.notifyEnabled(connHandle);
+}
+
+/*
+ * Send the queued TX buffer with one write: a direct notify on the stream
+ * characteristic if subscribed, otherwise bleuart.write().
+ * Returns true if the buffer was sent (or there was nothing to send).
+ */
+bool flushTxBuffer() {
+  if (txBufferLen == 0) {
+    return true;
   }
   
-  // Build packet with current magnetometer values (uT)
-  buildMagnetometerPacket(mag_x, mag_y, mag_z);
+  uint16_t len = txBufferLen;
+  bool sent = false;
   
-  // Send via BLE UART
-  uint16_t written = bleuart.write(magPacket, 16);
+  if (streamModeActive()) {
+    // notify() fails when no TX buffer frees up in time; count it rather
+    // than letting the frames vanish silently (seq shows the gap remotely)
+    sent = streamChar.notify(connHandle, txBuffer, len);
+    if (!sent) {
+      notifyFailCount++;
+    }
+  } else if (isConnected) {
+    sent = (bleuart.write(txBuffer, len) == len);
+  }
   
-  if (written == 16) {
-    magPacketCount++;
-    return true;
+  if (sent) {
+    txWriteCount++;
+    txByteCount += len;
+    packetCount += txBufferQuat;
+    magPacketCount += txBufferMag;
+    linAccelPacketCount += txBufferLinAccel;
+    if (txBufferQuat > 0) {
+      ledToggle();
+    }
   }
   
-  return false;
+  txBufferLen = 0;
+  txBufferQuat = 0;
+  txBufferMag = 0;
+  txBufferLinAccel = 0;
+  return sent;
 }
 
 /*
- * Stream linear acceleration data over BLE.
- * Values are in m/s^2 - gravity has been removed.
- * Citation: BNO085 datasheet - "acceleration minus gravity"
- * Returns true if packet was sent successfully.
+ * Append one encoded frame to the TX buffer, flushing first if it would
+ * not fit. With the default 23-byte MTU a quaternion frame (24 bytes) is
+ * larger than one notification; the write is split and the receiver
+ * reassembles on the delimiter.
  */
-bool streamLinearAccel() {
+void queueFrame(const uint8_t* frame, uint8_t len) {
+  if (txBufferLen > 0 && txBufferLen + len > txBufferLimit()) {
+    flushTxBuffer();
+  }
+  
+  memcpy(&txBuffer[txBufferLen], frame, len);
+  txBufferLen += len;
+}
+
+/*
+ * Build and queue frames (or legacy packets) for any new data, clearing
+ * the flags.
+ * Nothing is queued while disconnected.
+ */
+void queueNewData() {
   if (!isConnected) {
-    return false;
+    newQuatData = false;
+    newMagData = false;
+    newLinAccelData = false;
+    return;
   }
   
-  // Build packet with current linear acceleration values (m/s^2)
-  buildLinearAccelPacket(linaccel_x, linaccel_y, linaccel_z);
+  // The central switched paths: what is queued is in the other format,
+  // so drop it rather than send it where it can't be parsed
+  bool stream = streamModeActive();
+  if (stream != txBufferStream) {
+    txBufferLen = 0;
+    txBufferQuat = 0;
+    txBufferMag = 0;
+    txBufferLinAccel = 0;
+    txBufferStream = stream;
+  }
   
-  // Send via BLE UART
-  uint16_t written = bleuart.write(linAccelPacket, 16);
+  // Quaternion
+  if (newQuatData) {
+    const float values[4] = { quat_w, quat_x, quat_y, quat_z };
+    queueFrame(frameEncoded, buildSample(FRAME_TYPE_QUATERNION, quat_ts, values, 4));
+    txBufferQuat++;
+    newQuatData = false;
+  }
   
-  if (written == 16) {
-    linAccelPacketCount++;
-    return true;
+  // Magnetometer (uT)
+  if (newMagData) {
+    const float values[3] = { mag_x, mag_y, mag_z };
+    queueFrame(frameEncoded, buildSample(FRAME_TYPE_MAGNETOMETER, mag_ts, values, 3));
+    txBufferMag++;
+    newMagData = false;
   }
   
-  return false;
+  // Linear acceleration (m/s^2)
+  if (newLinAccelData) {
+    const float values[3] = { linaccel_x, linaccel_y, linaccel_z };
+    queueFrame(frameEncoded, buildSample(FRAME_TYPE_LINEAR_ACCEL, linaccel_ts, values, 3));
+    txBufferLinAccel++;
+    newLinAccelData = false;
+  }
 }
 
 // ============================================================================
 // STATISTICS
 // ============================================================================
 
+/*
+ * Add the interval since the previous sample of this type.
+ */
+void histRecord(IntervalHist& h, uint32_t ts) {
+  if (h.haveLast) {
+    uint32_t interval = ts - h.lastTs;
+    uint32_t bin = interval / HIST_BIN_US;
+    
+    h.bins[bin < HIST_BINS ? bin : HIST_BINS]++;
+    if (h.count == 0 || interval < h.minUs) {
+      h.minUs = interval;
+    }
+    if (interval > h.maxUs) {
+      h.maxUs = interval;
+    }
+    h.sumUs += interval;
+    h.count++;
+  }
+  
+  h.lastTs = ts;
+  h.haveLast = true;
+}
+
+/*
+ * Clear the counts, keeping lastTs so the next interval is still measured.
+ */
+void histReset(IntervalHist& h) {
+  memset(h.bins, 0, sizeof(h.bins));
+  h.count = 0;
+  h.minUs = 0;
+  h.maxUs = 0;
+  h.sumUs = 0;
+}
+
+/*
+ * Print one histogram: summary, then only the non-empty bins as
+ * "<bin start us>:<count>".
+ */
+void histPrint(const char* name, const IntervalHist& h) {
+  Serial.print("  ");
+  Serial.print(name);
+  Serial.print(": n=");
+  Serial.print(h.count);
+  
+  if (h.count > 0) {
+    Serial.print(" min=");
+    Serial.print(h.minUs);
+    Serial.print(" mean=");
+    Serial.print(h.sumUs / h.count);
+    Serial.print(" max=");
+    Serial.print(h.maxUs);
+    Serial.print(" |");
+    
+    for (uint8_t i = 0; i <= HIST_BINS; i++) {
+      if (h.bins[i] == 0) {
+        continue;
+      }
+      Serial.print(i < HIST_BINS ? " " : " >=");
+      Serial.print((uint32_t)i * HIST_BIN_US);
+      Serial.print(":");
+      Serial.print(h.bins[i]);
+    }
+  }
+  
+  Serial.println();
+}
+
+/*
+ * Dump the interval histograms every HIST_DUMP_MS, then start over.
+ */
+void printIntervalHistograms() {
+  uint32_t now = millis();
+  if (now - lastHistDumpTime < HIST_DUMP_MS) {
+    return;
+  }
+  
+  Serial.print("Sensor intervals (us, target ");
+  Serial.print(REPORT_INTERVAL_US);
+  Serial.print(", ");
+  Serial.print(isConnected ? "BLE connected" : "BLE idle");
+  Serial.println("):");
+  histPrint("Quat", quatHist);
+  histPrint("Mag", magHist);
+  histPrint("LinAccel", linAccelHist);
+  
+  histReset(quatHist);
+  histReset(magHist);
+  histReset(linAccelHist);
+  lastHistDumpTime = now;
+}
+
 void printStats() {
   uint32_t now = millis();
   if (now - lastStatsTime >= 1000) {
@@ -584,8 +931,25 @@ void printStats() {
       Serial.print(" | BLE Accel: ");
       Serial.print(linAccelPacketCount);
       Serial.print(" (");
-      Serial.print(packetCount * 20 + magPacketCount * 16 + linAccelPacketCount * 16);
-      Serial.print(" bytes/sec)");
+      Serial.print(txByteCount);
+      Serial.print(" bytes/sec in ");
+      Serial.print(txWriteCount);
+      Serial.print(" writes)");
+      
+      BLEConnection* conn = Bluefruit.Connection(connHandle);
+      Serial.println();
+      Serial.print("  Link: ");
+      Serial.print(streamModeActive() ? "stream notify" : "BLE UART");
+      if (conn) {
+        Serial.print(" | MTU ");
+        Serial.print(conn->getMtu());
+        Serial.print(" | PHY ");
+        Serial.print(conn->getPHY() == BLE_GAP_PHY_2MBPS ? "2M" : "1M");
+        Serial.print(" | DLE ");
+        Serial.print(conn->getDataLength());
+      }
+      Serial.print(" | Notify failures: ");
+      Serial.print(notifyFailCount);
     }
     
     Serial.println();
@@ -620,8 +984,12 @@ void printStats() {
     imuReadCount = 0;
     magReadCount = 0;
     linAccelReadCount = 0;
+    txWriteCount = 0;
+    txByteCount = 0;
     lastStatsTime = now;
   }
+  
+  printIntervalHistograms();
 }
 
 // ============================================================================
@@ -666,30 +1034,13 @@ void setup() {
 }
 
 void loop() {
-  // Always try to read sensors (even when not connected)
+  // Always drain sensor events (even when not connected); new samples are
+  // packed into the TX buffer as they are read
   readSensors();
   
-  // Stream over BLE when connected and we have new data
   if (isConnected) {
-    // Send quaternion data if available
-    if (newQuatData) {
-      if (streamQuaternion()) {
-        ledToggle();
-      }
-      newQuatData = false;
-    }
-    
-    // Send magnetometer data if available
-    if (newMagData) {
-      streamMagnetometer();
-      newMagData = false;
-    }
-    
-    // Send linear acceleration data if available
-    if (newLinAccelData) {
-      streamLinearAccel();
-      newLinAccelData = false;
-    }
+    // One write per loop for everything read since the last one
+    flushTxBuffer();
   } else {
     // Slow blink while waiting for connection
     static uint32_t lastBlink = 0;
@@ -697,10 +1048,6 @@ void loop() {
       ledToggle();
       lastBlink = millis();
     }
-    // Clear flags when not connected
-    newQuatData = false;
-    newMagData = false;
-    newLinAccelData = false;
   }
   
   // Print stats every second
@@ -14,6 +14,7 @@
 #include "ble_imu_service.h"
 #include "ble_stack.h"
 #include "nrf_error.h"
+#include "ramfunc.h"
 #include <string.h>
 
 /*******************************************************************************
@@ -32,6 +33,25 @@ static const ble_uuid128_t m_uuid_base = { BLE_IMU_UUID_BASE };
  */
 static ble_imu_service_t *mp_service_instance = NULL;
 
+/* Sensor characteristic table expanded from SENSOR_REPORT_TABLE
+ * Citation: FIRMWARE_DESIGN.md - "Quaternion (0x0001) - 16 bytes, notify",
+ *   "Accelerometer (0x0002) - 12 bytes, notify", "Gyroscope (0x0003) - 12 bytes, notify"
+ */
+typedef struct
+{
+    uint16_t uuid;      /* 16-bit characteristic UUID */
+    uint16_t len;       /* Value length (wire type size) */
+} sensor_char_desc_t;
+
+static const sensor_char_desc_t m_sensor_chars[BLE_IMU_SENSOR_COUNT] =
+{
+#define X(name, id, en, q, layout, field, ble, uuid) \
+    SENSOR_REPORT_IF(en, SENSOR_REPORT_IF(ble, \
+        [BLE_IMU_SENSOR_##name] = { uuid, sizeof(BLE_IMU_WIRE_TYPE(layout)) },))
+    SENSOR_REPORT_TABLE(X)
+#undef X
+};
+
 /*******************************************************************************
  * Private Helper Functions
  ******************************************************************************/
@@ -45,6 +65,7 @@ static ble_imu_service_t *mp_service_instance = NULL;
  * @param[in]  value_len     Length of the characteristic value
  * @param[in]  can_notify    True if characteristic supports notifications
  * @param[in]  can_write     True if characteristic is writable
+ * @param[in]  variable_len  True if value_len is a maximum, not a fixed length
  * @param[out] p_handles     Pointer to store characteristic handles
  */
 static uint32_t char_add(ble_imu_service_t *service,
@@ -53,6 +74,7 @@ static uint32_t char_add(ble_imu_service_t *service,
                          uint16_t value_len,
                          bool can_notify,
                          bool can_write,
+                         bool variable_len,
                          ble_gatts_char_handles_t *p_handles)
 {
     ble_gatts_char_md_t char_md;
@@ -95,7 +117,7 @@ static uint32_t char_add(ble_imu_service_t *service,
     }
     
     attr_md.vloc = BLE_GATTS_VLOC_STACK;  /* Value stored in SoftDevice */
-    attr_md.vlen = 0;  /* Fixed length attribute */
+    attr_md.vlen = variable_len ? 1 : 0;  /* Fixed length unless variable_len */
     
     /* Set up characteristic UUID */
     char_uuid.type = service->uuid_type;
@@ -129,47 +151,44 @@ static void on_write(ble_imu_service_t *service, const ble_gatts_evt_write_t *p_
      * Citation: Bluetooth Core Spec Vol 3, Part G, Section 3.3.3.3
      * CCCD value: 0x0000 = disabled, 0x0001 = notifications enabled */
     
-    /* Quaternion CCCD */
-    if (p_evt->handle == service->quat_handles.cccd_handle && p_evt->len == 2)
+    /* Sensor CCCDs */
+    for (uint32_t i = 0; i < BLE_IMU_SENSOR_COUNT; i++)
     {
-        bool enabled = (p_evt->data[0] & 0x01) != 0;
-        service->quat_notify_enabled = enabled;
-        
-        if (service->evt_handler != NULL)
+        if (p_evt->handle == service->sensor_handles[i].cccd_handle && p_evt->len == 2)
         {
-            evt.type = enabled ? BLE_IMU_EVT_QUAT_NOTIFY_EN : BLE_IMU_EVT_QUAT_NOTIFY_DIS;
-            evt.conn_handle = service->conn_handle;
-            service->evt_handler(&evt);
-        }
-    }
-    /* Accelerometer CCCD */
-    else if (p_evt->handle == service->accel_handles.cccd_handle && p_evt->len == 2)
-    {
-        bool enabled = (p_evt->data[0] & 0x01) != 0;
-        service->accel_notify_enabled = enabled;
-        
-        if (service->evt_handler != NULL)
-        {
-            evt.type = enabled ? BLE_IMU_EVT_ACCEL_NOTIFY_EN : BLE_IMU_EVT_ACCEL_NOTIFY_DIS;
-            evt.conn_handle = service->conn_handle;
-            service->evt_handler(&evt);
+            bool enabled = (p_evt->data[0] & 0x01) != 0;
+            service->sensor_notify_enabled[i] = enabled;
+            
+            if (service->evt_handler != NULL)
+            {
+                evt.type = enabled ? BLE_IMU_EVT_SENSOR_NOTIFY_EN : BLE_IMU_EVT_SENSOR_NOTIFY_DIS;
+                evt.conn_handle = service->conn_handle;
+                evt.data.sensor = (ble_imu_sensor_t)i;
+                service->evt_handler(&evt);
+            }
+            return;
         }
     }
-    /* Gyroscope CCCD */
-    else if (p_evt->handle == service->gyro_handles.cccd_handle && p_evt->len == 2)
+    
+#if CONFIG_BLE_RAW_PASSTHROUGH
+    /* Raw passthrough CCCD */
+    if (p_evt->handle == service->raw_handles.cccd_handle && p_evt->len == 2)
     {
         bool enabled = (p_evt->data[0] & 0x01) != 0;
-        service->gyro_notify_enabled = enabled;
+        service->raw_notify_enabled = enabled;
         
         if (service->evt_handler != NULL)
         {
-            evt.type = enabled ? BLE_IMU_EVT_GYRO_NOTIFY_EN : BLE_IMU_EVT_GYRO_NOTIFY_DIS;
+            evt.type = enabled ? BLE_IMU_EVT_RAW_NOTIFY_EN : BLE_IMU_EVT_RAW_NOTIFY_DIS;
             evt.conn_handle = service->conn_handle;
             service->evt_handler(&evt);
         }
+        return;
     }
+#endif
+    
     /* Status CCCD */
-    else if (p_evt->handle == service->status_handles.cccd_handle && p_evt->len == 2)
+    if (p_evt->handle == service->status_handles.cccd_handle && p_evt->len == 2)
     {
         bool enabled = (p_evt->data[0] & 0x01) != 0;
         service->status_notify_enabled = enabled;
@@ -219,7 +238,7 @@ static void imu_service_ble_evt_wrapper(const ble_evt_t *p_ble_evt)
 /**
  * @brief Send a notification for a characteristic
  */
-static uint32_t notify_send(uint16_t conn_handle, uint16_t value_handle,
+static RAMFUNC uint32_t notify_send(uint16_t conn_handle, uint16_t value_handle,
                             const uint8_t *p_data, uint16_t len)
 {
     ble_gatts_hvx_params_t hvx_params;
@@ -256,6 +275,7 @@ uint32_t ble_imu_service_init(ble_imu_service_t *service,
     /* Initialize service structure */
     memset(service, 0, sizeof(ble_imu_service_t));
     service->conn_handle = BLE_CONN_HANDLE_INVALID;
+    service->att_mtu = BLE_GATT_ATT_MTU_DEFAULT;
     service->evt_handler = evt_handler;
     
     /* Set default configuration */
@@ -290,44 +310,24 @@ uint32_t ble_imu_service_init(ble_imu_service_t *service,
         return err_code;
     }
     
-    /* Add Quaternion characteristic (Read, Notify)
-     * Citation: FIRMWARE_DESIGN.md - "Quaternion (0x0001) - 16 bytes, notify" */
-    err_code = char_add(service, BLE_IMU_CHAR_QUATERNION_UUID,
-                        NULL, BLE_IMU_QUAT_SIZE,
-                        true, false,
-                        &service->quat_handles);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-    
-    /* Add Accelerometer characteristic (Read, Notify)
-     * Citation: FIRMWARE_DESIGN.md - "Accelerometer (0x0002) - 12 bytes, notify" */
-    err_code = char_add(service, BLE_IMU_CHAR_ACCEL_UUID,
-                        NULL, BLE_IMU_ACCEL_SIZE,
-                        true, false,
-                        &service->accel_handles);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-    
-    /* Add Gyroscope characteristic (Read, Notify)
-     * Citation: FIRMWARE_DESIGN.md - "Gyroscope (0x0003) - 12 bytes, notify" */
-    err_code = char_add(service, BLE_IMU_CHAR_GYRO_UUID,
-                        NULL, BLE_IMU_GYRO_SIZE,
-                        true, false,
-                        &service->gyro_handles);
-    if (err_code != NRF_SUCCESS)
+    /* Add one sensor characteristic (Read, Notify) per enabled report */
+    for (uint32_t i = 0; i < BLE_IMU_SENSOR_COUNT; i++)
     {
-        return err_code;
+        err_code = char_add(service, m_sensor_chars[i].uuid,
+                            NULL, m_sensor_chars[i].len,
+                            true, false, false,
+                            &service->sensor_handles[i]);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
     }
     
     /* Add Sample Rate characteristic (Read, Write)
      * Citation: FIRMWARE_DESIGN.md - "Sample Rate (0x0004) - 2 bytes, read/write" */
     err_code = char_add(service, BLE_IMU_CHAR_RATE_UUID,
                         (const uint8_t *)&init_rate, BLE_IMU_RATE_SIZE,
-                        false, true,
+                        false, true, false,
                         &service->rate_handles);
     if (err_code != NRF_SUCCESS)
     {
@@ -338,13 +338,26 @@ uint32_t ble_imu_service_init(ble_imu_service_t *service,
      * Citation: FIRMWARE_DESIGN.md - "Status (0x0005) - 1 byte, notify/read" */
     err_code = char_add(service, BLE_IMU_CHAR_STATUS_UUID,
                         &init_status, BLE_IMU_STATUS_SIZE,
-                        true, false,
+                        true, false, false,
                         &service->status_handles);
     if (err_code != NRF_SUCCESS)
     {
         return err_code;
     }
     
+#if CONFIG_BLE_RAW_PASSTHROUGH
+    /* Add Raw passthrough characteristic (Notify, variable length up to
+     * the largest ATT payload) - see shtp_passthrough.h */
+    err_code = char_add(service, BLE_IMU_CHAR_RAW_UUID,
+                        NULL, BLE_IMU_RAW_MAX_SIZE,
+                        true, false, true,
+                        &service->raw_handles);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+#endif
+    
     /* Store service instance pointer for event handling wrapper */
     mp_service_instance = service;
     
@@ -375,10 +388,10 @@ void ble_imu_service_on_ble_evt(ble_imu_service_t *service, const ble_evt_t *p_b
             service->conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
             
             /* Reset notification flags on new connection */
-            service->quat_notify_enabled = false;
-            service->accel_notify_enabled = false;
-            service->gyro_notify_enabled = false;
+            memset(service->sensor_notify_enabled, 0, sizeof(service->sensor_notify_enabled));
             service->status_notify_enabled = false;
+            service->raw_notify_enabled = false;
+            service->att_mtu = BLE_GATT_ATT_MTU_DEFAULT;
             
             if (service->evt_handler != NULL)
             {
@@ -399,12 +412,27 @@ void ble_imu_service_on_ble_evt(ble_imu_service_t *service, const ble_evt_t *p_b
             service->conn_handle = BLE_CONN_HANDLE_INVALID;
             
             /* Disable all notifications */
-            service->quat_notify_enabled = false;
-            service->accel_notify_enabled = false;
-            service->gyro_notify_enabled = false;
+            memset(service->sensor_notify_enabled, 0, sizeof(service->sensor_notify_enabled));
             service->status_notify_enabled = false;
+            service->raw_notify_enabled = false;
             break;
             
+        case BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST:
+        {
+            /* Effective MTU is the smaller of the client's and ours; the
+             * reply itself is sent by ble_stack.c */
+            uint16_t client_rx_mtu =
+                p_ble_evt->evt.gatts_evt.params.exchange_mtu_request.client_rx_mtu;
+            
+            service->att_mtu = (client_rx_mtu < CONFIG_BLE_GATT_MTU)
+                               ? client_rx_mtu : CONFIG_BLE_GATT_MTU;
+            if (service->att_mtu < BLE_GATT_ATT_MTU_DEFAULT)
+            {
+                service->att_mtu = BLE_GATT_ATT_MTU_DEFAULT;
+            }
+            break;
+        }
+            
         case BLE_GATTS_EVT_WRITE:
             on_write(service, &p_ble_evt->evt.gatts_evt.params.write);
             break;
@@ -428,10 +456,11 @@ void ble_imu_service_on_ble_evt(ble_imu_service_t *service, const ble_evt_t *p_b
  * Public Functions - Notifications
  ******************************************************************************/
 
-uint32_t ble_imu_notify_quaternion(ble_imu_service_t *service, 
-                                   const ble_imu_quat_t *quat)
+RAMFUNC uint32_t ble_imu_notify_sensor(ble_imu_service_t *service,
+                               ble_imu_sensor_t sensor,
+                               const void *p_value)
 {
-    if (service == NULL || quat == NULL)
+    if (service == NULL || p_value == NULL || (uint32_t)sensor >= BLE_IMU_SENSOR_COUNT)
     {
         return NRF_ERROR_INVALID_PARAM;
     }
@@ -441,63 +470,52 @@ uint32_t ble_imu_notify_quaternion(ble_imu_service_t *service,
         return NRF_ERROR_INVALID_STATE;
     }
     
-    if (!service->quat_notify_enabled)
+    if (!service->sensor_notify_enabled[sensor])
     {
         return NRF_SUCCESS;  /* Silently succeed if notifications disabled */
     }
     
     return notify_send(service->conn_handle,
-                       service->quat_handles.value_handle,
-                       (const uint8_t *)quat,
-                       BLE_IMU_QUAT_SIZE);
+                       service->sensor_handles[sensor].value_handle,
+                       (const uint8_t *)p_value,
+                       m_sensor_chars[sensor].len);
 }
 
-uint32_t ble_imu_notify_accelerometer(ble_imu_service_t *service,
-                                      const ble_imu_vector_t *accel)
+#if CONFIG_BLE_RAW_PASSTHROUGH
+RAMFUNC uint32_t ble_imu_notify_raw(ble_imu_service_t *service,
+                            const uint8_t *p_data,
+                            uint16_t len)
 {
-    if (service == NULL || accel == NULL)
+    if (service == NULL || p_data == NULL || len > ble_imu_raw_max_len(service))
     {
         return NRF_ERROR_INVALID_PARAM;
     }
     
-    if (service->conn_handle == BLE_CONN_HANDLE_INVALID)
+    if (service->conn_handle == BLE_CONN_HANDLE_INVALID || !service->raw_notify_enabled)
     {
         return NRF_ERROR_INVALID_STATE;
     }
     
-    if (!service->accel_notify_enabled)
-    {
-        return NRF_SUCCESS;
-    }
-    
+    /* The SoftDevice copies the value into its TX queue, so the caller's
+     * buffer is free again as soon as this returns NRF_SUCCESS */
     return notify_send(service->conn_handle,
-                       service->accel_handles.value_handle,
-                       (const uint8_t *)accel,
-                       BLE_IMU_ACCEL_SIZE);
+                       service->raw_handles.value_handle,
+                       p_data,
+                       len);
 }
+#endif
 
-uint32_t ble_imu_notify_gyroscope(ble_imu_service_t *service,
-                                  const ble_imu_vector_t *gyro)
+uint16_t ble_imu_raw_max_len(const ble_imu_service_t *service)
 {
-    if (service == NULL || gyro == NULL)
-    {
-        return NRF_ERROR_INVALID_PARAM;
-    }
-    
-    if (service->conn_handle == BLE_CONN_HANDLE_INVALID)
-    {
-        return NRF_ERROR_INVALID_STATE;
-    }
+    uint16_t max_len;
     
-    if (!service->gyro_notify_enabled)
+    if (service == NULL || service->att_mtu < BLE_GATT_ATT_MTU_DEFAULT)
     {
-        return NRF_SUCCESS;
+        return BLE_GATT_ATT_MTU_DEFAULT - 3;
     }
     
-    return notify_send(service->conn_handle,
-                       service->gyro_handles.value_handle,
-                       (const uint8_t *)gyro,
-                       BLE_IMU_GYRO_SIZE);
+    max_len = service->att_mtu - 3;
+    return (max_len < BLE_IMU_RAW_MAX_SIZE) ? max_len : BLE_IMU_RAW_MAX_SIZE;
 }
 
 uint32_t ble_imu_notify_status(ble_imu_service_t *service, uint8_t status)
@@ -618,10 +636,15 @@ bool ble_imu_notifications_enabled(const ble_imu_service_t *service)
         return false;
     }
     
-    return service->quat_notify_enabled ||
-           service->accel_notify_enabled ||
-           service->gyro_notify_enabled ||
-           service->status_notify_enabled;
+    for (uint32_t i = 0; i < BLE_IMU_SENSOR_COUNT; i++)
+    {
+        if (service->sensor_notify_enabled[i])
+        {
+            return true;
+        }
+    }
+    
+    return service->status_notify_enabled;
 }
 
 bool ble_imu_is_connected(const ble_imu_service_t *service)
@@ -15,6 +15,9 @@
 #include "twim.h"
 #include "config.h"
 #include "board.h"
+#include "sensor_reports.h"
+#include "ramfunc.h"
+#include "dma_pool.h"
 #include <string.h>
 #include <math.h>
 
@@ -25,7 +28,9 @@
 /* External TWIM instance (initialized in board.c) */
 extern twim_t g_twim;
 
-/* Static data storage */
+/* Static data storage
+ * Also the scratch target for bno085_get_*(), so those no longer put a
+ * full bno085_data_t on the caller's stack. */
 static bno085_data_t s_sensor_data;
 
 /*******************************************************************************
@@ -43,14 +48,21 @@ static bno085_data_t s_sensor_data;
 static int bno085_send_packet(bno085_t *dev, uint8_t channel, 
                               const uint8_t *data, uint16_t len)
 {
-    uint8_t tx_buffer[256];
     uint16_t packet_len = len + SHTP_HEADER_SIZE;
+    uint8_t *tx_buffer;
     int result;
     
-    if (packet_len > sizeof(tx_buffer)) {
+    if (packet_len > CONFIG_SHTP_TX_BUFFER_SIZE) {
         return BNO085_ERR_BUFFER_OVERFLOW;
     }
     
+    /* EasyDMA reads the frame directly, so build it in a pool block
+     * Citation: nRF52840_PS_v1.11.pdf Section 4.6 EasyDMA */
+    tx_buffer = dma_pool_alloc_size(packet_len, DMA_OWNER_BNO085);
+    if (tx_buffer == NULL) {
+        return BNO085_ERR_NO_MEM;
+    }
+    
     /* Build SHTP header (4 bytes)
      * Citation: FIRMWARE_DESIGN.md:
      *   "Byte 0-1: Packet length (little-endian, includes header)"
@@ -69,6 +81,7 @@ static int bno085_send_packet(bno085_t *dev, uint8_t channel,
     
     /* Send via I2C */
     result = twim_write(&g_twim, dev->i2c_addr, tx_buffer, packet_len, true);
+    dma_pool_free(tx_buffer, DMA_OWNER_BNO085);
     
     if (result < 0) {
         return BNO085_ERR_I2C;
@@ -83,54 +96,23 @@ static int bno085_send_packet(bno085_t *dev, uint8_t channel,
  * @param timeout_ms Timeout in milliseconds
  * @return Packet length on success, negative error code on failure
  */
-static int bno085_receive_packet(bno085_t *dev, uint32_t timeout_ms)
+static RAMFUNC int bno085_receive_packet(bno085_t *dev, uint32_t timeout_ms)
 {
-    uint8_t header[4];
-    uint16_t packet_len;
-    uint16_t payload_len;
+    int packet_len;
     int result;
     
-    /* Read header first (4 bytes) */
-    result = twim_read(&g_twim, dev->i2c_addr, header, 4);
+    (void)timeout_ms;  /* TWIM transfers time out on their own (TWIM_TIMEOUT_LOOPS) */
     
-    if (result < 0) {
-        return BNO085_ERR_I2C;
+    packet_len = bno085_read_header(dev);
+    if (packet_len <= 0) {
+        return packet_len;
     }
     
-    /* Parse packet length
-     * Citation: SHTP protocol - length is 15 bits, bit 15 is continuation flag
-     */
-    packet_len = header[0] | ((header[1] & 0x7F) << 8);
-    
-    /* Check for empty packet or invalid length */
-    if (packet_len == 0 || packet_len == 0x7FFF) {
-        return 0;  /* No data available */
-    }
-    
-    if (packet_len < SHTP_HEADER_SIZE) {
-        return BNO085_ERR_INVALID_DATA;
-    }
-    
-    if (packet_len > sizeof(dev->rx_buffer)) {
-        return BNO085_ERR_BUFFER_OVERFLOW;
-    }
-    
-    /* Copy header to buffer */
-    memcpy(dev->rx_buffer, header, 4);
-    
-    /* Read remaining data if packet is larger than header */
-    payload_len = packet_len - SHTP_HEADER_SIZE;
-    if (payload_len > 0) {
-        result = twim_read(&g_twim, dev->i2c_addr, 
-                          &dev->rx_buffer[4], payload_len);
-        
-        if (result < 0) {
-            return BNO085_ERR_I2C;
-        }
+    result = bno085_read_cargo(dev, NULL);
+    if (result < 0) {
+        return result;
     }
     
-    dev->rx_len = packet_len;
-    
     return packet_len;
 }
 
@@ -167,17 +149,128 @@ static int bno085_wait_for_advertisement(bno085_t *dev, uint8_t advertisement,
     return BNO085_ERR_TIMEOUT;
 }
 
+/*******************************************************************************
+ * Private Functions - Report Decoders
+ *
+ * One decoder per payload layout in SENSOR_REPORT_TABLE. Offsets are relative
+ * to the start of the report, i.e. values begin after the common 5-byte header
+ * (report ID, sequence, status, delay).
+ * Citation: FIRMWARE_DESIGN.md Section "BNO085 Report Types Available"
+ * Citation: Adafruit BNO085 Guide - report data formats
+ ******************************************************************************/
+
+/**
+ * @brief Read a signed little-endian 16-bit value
+ */
+static inline int16_t report_s16(const uint8_t *p)
+{
+    return (int16_t)(p[0] | (p[1] << 8));
+}
+
+/**
+ * @brief Decode a quaternion report (i, j, k, real)
+ * @param payload Report payload
+ * @param len Payload length
+ * @param q Q-point of the quaternion components
+ * @param quat Output quaternion
+ * @return BNO085_OK on success, error code on failure
+ */
+static inline int report_decode_quat(const uint8_t *payload, uint16_t len,
+                                     uint8_t q, bno085_quaternion_t *quat)
+{
+    if (len < 13) {
+        return BNO085_ERR_INVALID_DATA;
+    }
+
+    quat->i = SHTP_Q_TO_FLOAT(report_s16(&payload[5]), q);
+    quat->j = SHTP_Q_TO_FLOAT(report_s16(&payload[7]), q);
+    quat->k = SHTP_Q_TO_FLOAT(report_s16(&payload[9]), q);
+    quat->real = SHTP_Q_TO_FLOAT(report_s16(&payload[11]), q);
+    quat->status = payload[2] & 0x03;  /* Status/accuracy in byte 2 */
+    quat->accuracy_rad = 0.0f;
+    return BNO085_OK;
+}
+
+/**
+ * @brief Decode a quaternion report with trailing accuracy estimate (Q12)
+ */
+static inline int report_decode_quat_acc(const uint8_t *payload, uint16_t len,
+                                         uint8_t q, bno085_quaternion_t *quat)
+{
+    int result = report_decode_quat(payload, len, q, quat);
+
+    if (result == BNO085_OK && len >= 15) {
+        quat->accuracy_rad = SHTP_Q_TO_FLOAT(report_s16(&payload[13]),
+                                             SHTP_Q_ACCURACY);
+    }
+    return result;
+}
+
+/**
+ * @brief Decode a 3-axis vector report (x, y, z)
+ */
+static inline int report_decode_vec3(const uint8_t *payload, uint16_t len,
+                                     uint8_t q, bno085_vector_t *vec)
+{
+    if (len < 11) {
+        return BNO085_ERR_INVALID_DATA;
+    }
+
+    vec->x = SHTP_Q_TO_FLOAT(report_s16(&payload[5]), q);
+    vec->y = SHTP_Q_TO_FLOAT(report_s16(&payload[7]), q);
+    vec->z = SHTP_Q_TO_FLOAT(report_s16(&payload[9]), q);
+    vec->accuracy = payload[2] & 0x03;
+    return BNO085_OK;
+}
+
+/**
+ * @brief Decode a 32-bit counter report (step counter)
+ */
+static inline int report_decode_u32(const uint8_t *payload, uint16_t len,
+                                    uint8_t q, uint32_t *value)
+{
+    (void)q;
+
+    if (len < 9) {
+        return BNO085_ERR_INVALID_DATA;
+    }
+
+    *value = (uint32_t)payload[5] | ((uint32_t)payload[6] << 8) |
+             ((uint32_t)payload[7] << 16) | ((uint32_t)payload[8] << 24);
+    return BNO085_OK;
+}
+
+/**
+ * @brief Decode a stability classification report
+ */
+static inline int report_decode_stability(const uint8_t *payload, uint16_t len,
+                                          uint8_t q, bno085_stability_t *stability)
+{
+    (void)q;
+
+    if (len < 6) {
+        return BNO085_ERR_INVALID_DATA;
+    }
+
+    *stability = (bno085_stability_t)payload[5];
+    return BNO085_OK;
+}
+
 /**
  * @brief Parse sensor report based on report ID
  * @param dev Device handle
  * @param data Complete sensor data structure to update
  * @return Report ID on success, negative error code on failure
+ *
+ * The dispatch is expanded from SENSOR_REPORT_TABLE; reports disabled in
+ * config.h have no case label and are ignored like unknown reports.
  */
-static int bno085_parse_sensor_report(bno085_t *dev, bno085_data_t *data)
+static RAMFUNC int bno085_parse_sensor_report(bno085_t *dev, bno085_data_t *data)
 {
     uint8_t channel = dev->rx_buffer[2];
-    uint8_t *payload = &dev->rx_buffer[SHTP_HEADER_SIZE];
+    const uint8_t *payload = &dev->rx_buffer[SHTP_HEADER_SIZE];
     uint16_t payload_len = dev->rx_len - SHTP_HEADER_SIZE;
+    int result;
     
     /* Only process reports on channel 3 (Input Sensor Reports) */
     if (channel != SHTP_CHANNEL_REPORTS) {
@@ -191,170 +284,25 @@ static int bno085_parse_sensor_report(bno085_t *dev, bno085_data_t *data)
     /* First byte of sensor report is the report ID */
     uint8_t report_id = payload[0];
     
-    /* Parse based on report type
-     * Citation: FIRMWARE_DESIGN.md Section "BNO085 Report Types Available"
-     * Citation: Adafruit BNO085 Guide - report data formats
-     */
     switch (report_id) {
-        case SH2_ROTATION_VECTOR:
-        case SH2_GAME_ROTATION_VECTOR:
-        case SH2_GEOMAGNETIC_ROTATION: {
-            /* Quaternion data format (after common 5-byte header):
-             *   Bytes 0-1: i (Q14)
-             *   Bytes 2-3: j (Q14)
-             *   Bytes 4-5: k (Q14)
-             *   Bytes 6-7: real (Q14)
-             *   Bytes 8-9: accuracy (Q12) - rotation vector only
-             */
-            if (payload_len < 14) {
-                return BNO085_ERR_INVALID_DATA;
-            }
-            
-            int16_t i = (int16_t)(payload[5] | (payload[6] << 8));
-            int16_t j = (int16_t)(payload[7] | (payload[8] << 8));
-            int16_t k = (int16_t)(payload[9] | (payload[10] << 8));
-            int16_t real = (int16_t)(payload[11] | (payload[12] << 8));
-            
-            bno085_quaternion_t *quat;
-            if (report_id == SH2_GAME_ROTATION_VECTOR) {
-                quat = &data->game_rotation;
-            } else {
-                quat = &data->rotation_vector;
-            }
-            
-            /* Convert from Q14 fixed-point to float
-             * Citation: SHTP_Q_ROTATION_VECTOR = 14
-             */
-            quat->i = SHTP_Q_TO_FLOAT(i, SHTP_Q_ROTATION_VECTOR);
-            quat->j = SHTP_Q_TO_FLOAT(j, SHTP_Q_ROTATION_VECTOR);
-            quat->k = SHTP_Q_TO_FLOAT(k, SHTP_Q_ROTATION_VECTOR);
-            quat->real = SHTP_Q_TO_FLOAT(real, SHTP_Q_ROTATION_VECTOR);
-            quat->status = payload[2] & 0x03;  /* Status/accuracy in byte 2 */
-            
-            /* Parse accuracy for rotation vector (not game rotation) */
-            if (report_id == SH2_ROTATION_VECTOR && payload_len >= 16) {
-                int16_t acc = (int16_t)(payload[13] | (payload[14] << 8));
-                quat->accuracy_rad = SHTP_Q_TO_FLOAT(acc, SHTP_Q_ACCURACY);
-            } else {
-                quat->accuracy_rad = 0.0f;
-            }
-            break;
-        }
-        
-        case SH2_ACCELEROMETER:
-        case SH2_LINEAR_ACCELERATION:
-        case SH2_GRAVITY: {
-            /* 3-axis vector format (after common 5-byte header):
-             *   Bytes 0-1: X (Q8)
-             *   Bytes 2-3: Y (Q8)
-             *   Bytes 4-5: Z (Q8)
-             */
-            if (payload_len < 10) {
-                return BNO085_ERR_INVALID_DATA;
-            }
-            
-            int16_t x = (int16_t)(payload[5] | (payload[6] << 8));
-            int16_t y = (int16_t)(payload[7] | (payload[8] << 8));
-            int16_t z = (int16_t)(payload[9] | (payload[10] << 8));
-            
-            bno085_vector_t *vec;
-            if (report_id == SH2_ACCELEROMETER) {
-                vec = &data->accelerometer;
-            } else if (report_id == SH2_LINEAR_ACCELERATION) {
-                vec = &data->linear_accel;
-            } else {
-                vec = &data->gravity;
-            }
-            
-            /* Convert from Q8 fixed-point to float (m/s²)
-             * Citation: SHTP_Q_ACCELEROMETER = 8
-             */
-            vec->x = SHTP_Q_TO_FLOAT(x, SHTP_Q_ACCELEROMETER);
-            vec->y = SHTP_Q_TO_FLOAT(y, SHTP_Q_ACCELEROMETER);
-            vec->z = SHTP_Q_TO_FLOAT(z, SHTP_Q_ACCELEROMETER);
-            vec->accuracy = payload[2] & 0x03;
-            break;
-        }
-        
-        case SH2_GYROSCOPE: {
-            /* Gyroscope format (after common 5-byte header):
-             *   Bytes 0-1: X (Q9)
-             *   Bytes 2-3: Y (Q9)
-             *   Bytes 4-5: Z (Q9)
-             */
-            if (payload_len < 10) {
-                return BNO085_ERR_INVALID_DATA;
-            }
-            
-            int16_t x = (int16_t)(payload[5] | (payload[6] << 8));
-            int16_t y = (int16_t)(payload[7] | (payload[8] << 8));
-            int16_t z = (int16_t)(payload[9] | (payload[10] << 8));
-            
-            /* Convert from Q9 fixed-point to float (rad/s)
-             * Citation: SHTP_Q_GYROSCOPE = 9
-             */
-            data->gyroscope.x = SHTP_Q_TO_FLOAT(x, SHTP_Q_GYROSCOPE);
-            data->gyroscope.y = SHTP_Q_TO_FLOAT(y, SHTP_Q_GYROSCOPE);
-            data->gyroscope.z = SHTP_Q_TO_FLOAT(z, SHTP_Q_GYROSCOPE);
-            data->gyroscope.accuracy = payload[2] & 0x03;
-            break;
-        }
-        
-        case SH2_MAGNETOMETER: {
-            /* Magnetometer format (after common 5-byte header):
-             *   Bytes 0-1: X (Q4)
-             *   Bytes 2-3: Y (Q4)
-             *   Bytes 4-5: Z (Q4)
-             */
-            if (payload_len < 10) {
-                return BNO085_ERR_INVALID_DATA;
-            }
-            
-            int16_t x = (int16_t)(payload[5] | (payload[6] << 8));
-            int16_t y = (int16_t)(payload[7] | (payload[8] << 8));
-            int16_t z = (int16_t)(payload[9] | (payload[10] << 8));
-            
-            /* Convert from Q4 fixed-point to float (µT)
-             * Citation: SHTP_Q_MAGNETOMETER = 4
-             */
-            data->magnetometer.x = SHTP_Q_TO_FLOAT(x, SHTP_Q_MAGNETOMETER);
-            data->magnetometer.y = SHTP_Q_TO_FLOAT(y, SHTP_Q_MAGNETOMETER);
-            data->magnetometer.z = SHTP_Q_TO_FLOAT(z, SHTP_Q_MAGNETOMETER);
-            data->magnetometer.accuracy = payload[2] & 0x03;
-            break;
-        }
-        
-        case SH2_STEP_COUNTER: {
-            /* Step counter format (after common 5-byte header):
-             *   Bytes 0-1: Step count (low 16 bits)
-             *   Bytes 2-3: Step count (high 16 bits)
-             */
-            if (payload_len < 9) {
-                return BNO085_ERR_INVALID_DATA;
-            }
-            
-            data->step_count = payload[5] | (payload[6] << 8) |
-                              (payload[7] << 16) | (payload[8] << 24);
-            break;
-        }
-        
-        case SH2_STABILITY_CLASSIFIER: {
-            /* Stability classification (after common 5-byte header):
-             *   Byte 0: Classification (0-4)
-             */
-            if (payload_len < 6) {
-                return BNO085_ERR_INVALID_DATA;
-            }
-            
-            data->stability = (bno085_stability_t)payload[5];
-            break;
-        }
+#define X(name, id, en, q, layout, field, ble, uuid)                         \
+        SENSOR_REPORT_IF(en,                                                \
+        case id:                                                            \
+            result = report_decode_##layout(payload, payload_len, q,        \
+                                            &data->field);                  \
+            break;)
+        SENSOR_REPORT_TABLE(X)
+#undef X
         
         default:
-            /* Unknown report type - ignore */
+            /* Unknown or disabled report type - ignore */
             return 0;
     }
     
+    if (result != BNO085_OK) {
+        return result;
+    }
+    
     data->report_id = report_id;
     return report_id;
 }
@@ -382,12 +330,21 @@ int bno085_init_config(bno085_t *dev, const bno085_config_t *config)
         return BNO085_ERR_INVALID_PARAM;
     }
     
-    /* Initialize device handle */
+    /* Initialize device handle, releasing the receive block of a previous
+     * init of the same handle */
+    if (dma_pool_block_size(dev->rx_buffer) != 0) {
+        dma_pool_free(dev->rx_buffer, DMA_OWNER_BNO085);
+    }
     memset(dev, 0, sizeof(bno085_t));
     dev->i2c_addr = config->i2c_addr;
     dev->int_pin = config->int_pin;
     dev->rst_pin = config->rst_pin;
     
+    dev->rx_buffer = dma_pool_alloc(DMA_POOL_SHTP, DMA_OWNER_BNO085);
+    if (dev->rx_buffer == NULL) {
+        return BNO085_ERR_NO_MEM;
+    }
+    
     /* Check if device is present
      * Citation: Adafruit BNO085 Guide: "The default I2C address for the BNO08x is 0x4A"
      */
@@ -440,6 +397,7 @@ int bno085_init_config(bno085_t *dev, const bno085_config_t *config)
 void bno085_deinit(bno085_t *dev)
 {
     if (dev != NULL) {
+        dma_pool_free(dev->rx_buffer, DMA_OWNER_BNO085);
         memset(dev, 0, sizeof(bno085_t));
     }
 }
@@ -539,7 +497,72 @@ bool bno085_data_available(bno085_t *dev)
     return true;
 }
 
-int bno085_poll(bno085_t *dev, bno085_data_t *data)
+RAMFUNC int bno085_read_header(bno085_t *dev)
+{
+    const uint8_t *header = dev->rx_buffer;
+    uint16_t packet_len;
+    int result;
+    
+    dev->rx_len = 0;
+    
+    /* Read header first (4 bytes), straight into the receive buffer so
+     * EasyDMA never targets the stack */
+    result = twim_read(&g_twim, dev->i2c_addr, dev->rx_buffer, SHTP_HEADER_SIZE);
+    
+    if (result < 0) {
+        return BNO085_ERR_I2C;
+    }
+    
+    /* Parse packet length
+     * Citation: SHTP protocol - length is 15 bits, bit 15 is continuation flag
+     */
+    packet_len = header[0] | ((header[1] & 0x7F) << 8);
+    
+    /* Check for empty packet or invalid length */
+    if (packet_len == 0 || packet_len == 0x7FFF) {
+        return 0;  /* No data available */
+    }
+    
+    if (packet_len < SHTP_HEADER_SIZE) {
+        return BNO085_ERR_INVALID_DATA;
+    }
+    
+    if (packet_len > CONFIG_SHTP_RX_BUFFER_SIZE) {
+        return BNO085_ERR_BUFFER_OVERFLOW;
+    }
+    
+    dev->rx_len = packet_len;
+    
+    return packet_len;
+}
+
+RAMFUNC int bno085_read_cargo(bno085_t *dev, uint8_t *dest)
+{
+    uint16_t cargo_len;
+    int result;
+    
+    if (dev->rx_len < SHTP_HEADER_SIZE) {
+        return BNO085_ERR_NOT_READY;
+    }
+    
+    /* Read remaining data if packet is larger than header */
+    cargo_len = dev->rx_len - SHTP_HEADER_SIZE;
+    if (cargo_len > 0) {
+        if (dest == NULL) {
+            dest = &dev->rx_buffer[SHTP_HEADER_SIZE];
+        }
+        
+        result = twim_read(&g_twim, dev->i2c_addr, dest, cargo_len);
+        
+        if (result < 0) {
+            return BNO085_ERR_I2C;
+        }
+    }
+    
+    return cargo_len;
+}
+
+RAMFUNC int bno085_poll(bno085_t *dev, bno085_data_t *data)
 {
     int result;
     
@@ -564,7 +587,6 @@ int bno085_poll(bno085_t *dev, bno085_data_t *data)
 
 int bno085_get_rotation_vector(bno085_t *dev, bno085_quaternion_t *quat)
 {
-    bno085_data_t data;
     int result;
     int report;
     int attempts = 10;
@@ -575,7 +597,7 @@ int bno085_get_rotation_vector(bno085_t *dev, bno085_quaternion_t *quat)
     
     /* Poll until we get a rotation vector report */
     while (attempts-- > 0) {
-        result = bno085_poll(dev, &data);
+        result = bno085_poll(dev, NULL);
         
         if (result < 0) {
             return result;
@@ -584,9 +606,9 @@ int bno085_get_rotation_vector(bno085_t *dev, bno085_quaternion_t *quat)
         report = result;
         if (report == SH2_ROTATION_VECTOR || report == SH2_GAME_ROTATION_VECTOR) {
             if (report == SH2_GAME_ROTATION_VECTOR) {
-                *quat = data.game_rotation;
+                *quat = s_sensor_data.game_rotation;
             } else {
-                *quat = data.rotation_vector;
+                *quat = s_sensor_data.rotation_vector;
             }
             return BNO085_OK;
         }
@@ -599,7 +621,6 @@ int bno085_get_rotation_vector(bno085_t *dev, bno085_quaternion_t *quat)
 
 int bno085_get_accelerometer(bno085_t *dev, bno085_vector_t *accel)
 {
-    bno085_data_t data;
     int result;
     int attempts = 10;
     
@@ -608,14 +629,14 @@ int bno085_get_accelerometer(bno085_t *dev, bno085_vector_t *accel)
     }
     
     while (attempts-- > 0) {
-        result = bno085_poll(dev, &data);
+        result = bno085_poll(dev, NULL);
         
         if (result < 0) {
             return result;
         }
         
         if (result == SH2_ACCELEROMETER) {
-            *accel = data.accelerometer;
+            *accel = s_sensor_data.accelerometer;
             return BNO085_OK;
         }
         
@@ -627,7 +648,6 @@ int bno085_get_accelerometer(bno085_t *dev, bno085_vector_t *accel)
 
 int bno085_get_gyroscope(bno085_t *dev, bno085_vector_t *gyro)
 {
-    bno085_data_t data;
     int result;
     int attempts = 10;
     
@@ -636,14 +656,14 @@ int bno085_get_gyroscope(bno085_t *dev, bno085_vector_t *gyro)
     }
     
     while (attempts-- > 0) {
-        result = bno085_poll(dev, &data);
+        result = bno085_poll(dev, NULL);
         
         if (result < 0) {
             return result;
         }
         
         if (result == SH2_GYROSCOPE) {
-            *gyro = data.gyroscope;
+            *gyro = s_sensor_data.gyroscope;
             return BNO085_OK;
         }
         
@@ -29,6 +29,20 @@
 #define __ISB() __asm volatile ("isb 0xF" ::: "memory")
 #define __NOP() __asm volatile ("nop")
 
+/*******************************************************************************
+ * Core Debug / NVMC Register Definitions
+ * Citation: ARMv7-M Architecture Reference Manual Section C1.8 (DWT)
+ * Citation: nRF52840_PS_v1.11.pdf Section 4.4.2 (NVMC ICACHECNF)
+ ******************************************************************************/
+#define CORE_DEMCR              (*(volatile uint32_t *)0xE000EDFCUL)
+#define CORE_DEMCR_TRCENA       (1UL << 24)
+#define DWT_CTRL                (*(volatile uint32_t *)0xE0001000UL)
+#define DWT_CTRL_CYCCNTENA      (1UL << 0)
+#define DWT_CYCCNT              (*(volatile uint32_t *)0xE0001004UL)
+
+#define NVMC_ICACHECNF          (*(volatile uint32_t *)0x4001E540UL)
+#define NVMC_ICACHECNF_CACHEEN  (1UL << 0)
+
 /*******************************************************************************
  * GPIO Register Definitions
  * Citation: nRF52840_PS_v1.11.pdf Section 6.9 (GPIO)
@@ -199,6 +213,22 @@ void board_delay_ms(uint32_t ms)
     }
 }
 
+/*******************************************************************************
+ * Public Functions - Cycle Counter
+ ******************************************************************************/
+
+void board_cycle_counter_init(void)
+{
+    CORE_DEMCR |= CORE_DEMCR_TRCENA;
+    DWT_CYCCNT = 0;
+    DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+}
+
+uint32_t board_cycle_counter_get(void)
+{
+    return DWT_CYCCNT;
+}
+
 /*******************************************************************************
  * Public Functions - Board Initialization
  ******************************************************************************/
@@ -207,6 +237,20 @@ int board_init(void)
 {
     int result;
     
+#if CONFIG_ENABLE_ICACHE
+    /* Enable the flash instruction cache - code left in flash (everything
+     * not marked RAMFUNC) then mostly hits the cache instead of waiting on
+     * the flash bus shared with the SoftDevice.
+     * Citation: nRF52840_PS_v1.11.pdf Section 4.4.2 ICACHECNF */
+    NVMC_ICACHECNF |= NVMC_ICACHECNF_CACHEEN;
+    __ISB();
+#endif
+
+#if CONFIG_PERF_CYCLE_STATS || CONFIG_BLE_RAW_PASSTHROUGH
+    /* Also the time base of passthrough record timestamps */
+    board_cycle_counter_init();
+#endif
+    
     /* Configure LED pin as output (off) */
     board_gpio_output(BOARD_LED_PORT, BOARD_LED_PIN);
     board_led_off();
@@ -0,0 +1,270 @@
+/**
+ * @file dma_pool.c
+ * @brief Fixed-block RAM pool for EasyDMA buffers
+ *
+ * Citations:
+ * - nRF52840_PS_v1.11.pdf Section 4.6 EasyDMA: buffers must be in Data RAM
+ */
+
+#include "dma_pool.h"
+#include <string.h>
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+_Static_assert(CONFIG_DMA_SMALL_BUFFER_SIZE % 4 == 0 &&
+               CONFIG_SHTP_RX_BUFFER_SIZE % 4 == 0 &&
+               CONFIG_BLE_TX_BUFFER_SIZE % 4 == 0,
+               "DMA pool block sizes must be multiples of 4");
+
+_Static_assert(CONFIG_DMA_SMALL_BUFFER_COUNT <= 32 &&
+               CONFIG_SHTP_RX_BUFFER_COUNT <= 32 &&
+               CONFIG_BLE_TX_BUFFER_COUNT <= 32,
+               "DMA pool free bitmap holds at most 32 blocks per class");
+
+#define DMA_POOL_MAX_BLOCKS     32
+
+/**
+ * @brief Size class descriptor
+ */
+typedef struct {
+    uint8_t  *base;             /* First block */
+    uint16_t  block_size;       /* Bytes per block */
+    uint8_t   block_count;      /* Number of blocks */
+} dma_pool_class_desc_t;
+
+/*******************************************************************************
+ * Private Variables
+ ******************************************************************************/
+
+/* Block storage - uint32_t arrays for word alignment, .bss is in Data RAM */
+static uint32_t s_small_blocks[CONFIG_DMA_SMALL_BUFFER_COUNT]
+                              [CONFIG_DMA_SMALL_BUFFER_SIZE / 4];
+static uint32_t s_shtp_blocks[CONFIG_SHTP_RX_BUFFER_COUNT]
+                             [CONFIG_SHTP_RX_BUFFER_SIZE / 4];
+static uint32_t s_ble_blocks[CONFIG_BLE_TX_BUFFER_COUNT]
+                            [CONFIG_BLE_TX_BUFFER_SIZE / 4];
+
+static const dma_pool_class_desc_t s_classes[DMA_POOL_CLASS_COUNT] = {
+    [DMA_POOL_SMALL] = { (uint8_t *)s_small_blocks, CONFIG_DMA_SMALL_BUFFER_SIZE,
+                         CONFIG_DMA_SMALL_BUFFER_COUNT },
+    [DMA_POOL_SHTP]  = { (uint8_t *)s_shtp_blocks, CONFIG_SHTP_RX_BUFFER_SIZE,
+                         CONFIG_SHTP_RX_BUFFER_COUNT },
+    [DMA_POOL_BLE]   = { (uint8_t *)s_ble_blocks, CONFIG_BLE_TX_BUFFER_SIZE,
+                         CONFIG_BLE_TX_BUFFER_COUNT },
+};
+
+/* Bit n set = block n free */
+static uint32_t s_free_map[DMA_POOL_CLASS_COUNT];
+
+static dma_pool_stats_t s_stats[DMA_POOL_CLASS_COUNT];
+
+#if DMA_POOL_TRACK_OWNERS
+static uint8_t s_owner[DMA_POOL_CLASS_COUNT][DMA_POOL_MAX_BLOCKS];
+#endif
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+/**
+ * @brief Find the class and index of a block
+ * @return true if block is the start of a pool block
+ */
+static bool dma_pool_locate(const uint8_t *block, dma_pool_class_t *cls,
+                            uint32_t *index)
+{
+    for (uint32_t c = 0; c < DMA_POOL_CLASS_COUNT; c++) {
+        const dma_pool_class_desc_t *desc = &s_classes[c];
+        uintptr_t offset = (uintptr_t)block - (uintptr_t)desc->base;
+
+        if ((uintptr_t)block >= (uintptr_t)desc->base &&
+            offset < (uintptr_t)desc->block_size * desc->block_count) {
+            if (offset % desc->block_size != 0) {
+                return false;   /* Points into the middle of a block */
+            }
+            *cls = (dma_pool_class_t)c;
+            *index = offset / desc->block_size;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+void dma_pool_init(void)
+{
+    for (uint32_t c = 0; c < DMA_POOL_CLASS_COUNT; c++) {
+        uint8_t count = s_classes[c].block_count;
+
+        s_free_map[c] = (count == 32) ? 0xFFFFFFFFUL : ((1UL << count) - 1);
+        memset(&s_stats[c], 0, sizeof(s_stats[c]));
+        s_stats[c].block_size = s_classes[c].block_size;
+        s_stats[c].block_count = count;
+    }
+
+#if DMA_POOL_TRACK_OWNERS
+    memset(s_owner, DMA_OWNER_NONE, sizeof(s_owner));
+#endif
+}
+
+uint8_t *dma_pool_alloc(dma_pool_class_t cls, dma_pool_owner_t owner)
+{
+    uint32_t index;
+
+    if (cls >= DMA_POOL_CLASS_COUNT) {
+        return NULL;
+    }
+
+    if (s_free_map[cls] == 0) {
+        s_stats[cls].alloc_failures++;
+        return NULL;
+    }
+
+    index = (uint32_t)__builtin_ctz(s_free_map[cls]);
+    s_free_map[cls] &= ~(1UL << index);
+
+    if (++s_stats[cls].in_use > s_stats[cls].high_water) {
+        s_stats[cls].high_water = s_stats[cls].in_use;
+    }
+
+#if DMA_POOL_TRACK_OWNERS
+    s_owner[cls][index] = (uint8_t)owner;
+#else
+    (void)owner;
+#endif
+
+    return s_classes[cls].base + index * s_classes[cls].block_size;
+}
+
+uint8_t *dma_pool_alloc_size(uint16_t len, dma_pool_owner_t owner)
+{
+    dma_pool_class_t best = DMA_POOL_CLASS_COUNT;
+    uint8_t *block;
+
+    /* Try classes from smallest fitting upwards, so an exhausted small
+     * class falls back to a larger block */
+    for (;;) {
+        best = DMA_POOL_CLASS_COUNT;
+        for (uint32_t c = 0; c < DMA_POOL_CLASS_COUNT; c++) {
+            if (s_classes[c].block_size >= len &&
+                (best == DMA_POOL_CLASS_COUNT ||
+                 s_classes[c].block_size < s_classes[best].block_size)) {
+                best = (dma_pool_class_t)c;
+            }
+        }
+        if (best == DMA_POOL_CLASS_COUNT) {
+            return NULL;
+        }
+
+        block = dma_pool_alloc(best, owner);
+        if (block != NULL) {
+            return block;
+        }
+        len = s_classes[best].block_size + 1;
+    }
+}
+
+void dma_pool_free(uint8_t *block, dma_pool_owner_t owner)
+{
+    dma_pool_class_t cls;
+    uint32_t index;
+
+    if (block == NULL) {
+        return;
+    }
+
+    if (!dma_pool_locate(block, &cls, &index)) {
+        dma_pool_fault_handler(block, DMA_POOL_FAULT_NOT_A_BLOCK);
+        return;
+    }
+
+    if (s_free_map[cls] & (1UL << index)) {
+        dma_pool_fault_handler(block, DMA_POOL_FAULT_DOUBLE_FREE);
+        return;
+    }
+
+#if DMA_POOL_TRACK_OWNERS
+    if (s_owner[cls][index] != (uint8_t)owner) {
+        dma_pool_fault_handler(block, DMA_POOL_FAULT_WRONG_OWNER);
+        return;
+    }
+    s_owner[cls][index] = DMA_OWNER_NONE;
+#else
+    (void)owner;
+#endif
+
+    s_free_map[cls] |= (1UL << index);
+    s_stats[cls].in_use--;
+}
+
+#if DMA_POOL_TRACK_OWNERS
+void dma_pool_transfer(uint8_t *block, dma_pool_owner_t from, dma_pool_owner_t to)
+{
+    dma_pool_class_t cls;
+    uint32_t index;
+
+    if (!dma_pool_locate(block, &cls, &index)) {
+        dma_pool_fault_handler(block, DMA_POOL_FAULT_NOT_A_BLOCK);
+        return;
+    }
+    if (s_free_map[cls] & (1UL << index)) {
+        dma_pool_fault_handler(block, DMA_POOL_FAULT_DOUBLE_FREE);
+        return;
+    }
+    if (s_owner[cls][index] != (uint8_t)from) {
+        dma_pool_fault_handler(block, DMA_POOL_FAULT_WRONG_OWNER);
+        return;
+    }
+    s_owner[cls][index] = (uint8_t)to;
+}
+#endif
+
+uint16_t dma_pool_block_size(const uint8_t *block)
+{
+    dma_pool_class_t cls;
+    uint32_t index;
+
+    if (!dma_pool_locate(block, &cls, &index)) {
+        return 0;
+    }
+    return s_classes[cls].block_size;
+}
+
+dma_pool_owner_t dma_pool_owner(const uint8_t *block)
+{
+#if DMA_POOL_TRACK_OWNERS
+    dma_pool_class_t cls;
+    uint32_t index;
+
+    if (!dma_pool_locate(block, &cls, &index)) {
+        return DMA_OWNER_NONE;
+    }
+    return (dma_pool_owner_t)s_owner[cls][index];
+#else
+    (void)block;
+    return DMA_OWNER_NONE;
+#endif
+}
+
+const dma_pool_stats_t *dma_pool_stats(dma_pool_class_t cls)
+{
+    if (cls >= DMA_POOL_CLASS_COUNT) {
+        return NULL;
+    }
+    return &s_stats[cls];
+}
+
+__attribute__((weak)) void dma_pool_fault_handler(const uint8_t *block, uint32_t reason)
+{
+    (void)block;
+    (void)reason;
+
+    /* Pool misuse - stop here for the debugger */
+    while (1) {
+    }
+}
@@ -0,0 +1,313 @@
+/**
+ * @file imu_pipeline.c
+ * @brief Per-sample acquisition path: BNO085 poll -> BLE frame -> notify
+ *
+ * Citations:
+ * - FIRMWARE_DESIGN.md Section "BLE Service Design"
+ * - FIRMWARE_DESIGN.md Section "BNO085 Report Types Available"
+ * - nRF52840_PS_v1.11.pdf Section 4.6 EasyDMA (passthrough reads into the
+ *   notification buffer directly)
+ */
+
+#include "imu_pipeline.h"
+#include "sensor_reports.h"
+#include "ramfunc.h"
+#include "dma_pool.h"
+#include "shtp_passthrough.h"
+#include "board.h"
+#include "nrf_error.h"
+#include <string.h>
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+_Static_assert(SENSOR_REPORT_ENABLED_COUNT > 0,
+               "SENSOR_REPORT_TABLE: enable at least one report in config.h");
+
+_Static_assert(BLE_IMU_SENSOR_COUNT <= 32,
+               "imu_pipeline_t.dirty holds one bit per BLE sensor");
+
+_Static_assert(sizeof(ble_imu_frame_t) <= CONFIG_BLE_TX_BUFFER_SIZE,
+               "ble_imu_frame_t must fit a DMA_POOL_BLE block");
+
+#if CONFIG_BLE_RAW_PASSTHROUGH
+_Static_assert(BLE_IMU_RAW_MAX_SIZE <= CONFIG_BLE_TX_BUFFER_SIZE,
+               "A raw notification must fit a DMA_POOL_BLE block");
+
+#define PIPELINE_CYCLES_PER_US  (BOARD_MCU_FREQUENCY_HZ / 1000000UL)
+#endif
+
+/*******************************************************************************
+ * Private Functions - Frame Packers
+ *
+ * One per SENSOR_REPORT_TABLE payload layout.
+ ******************************************************************************/
+
+static inline void frame_pack_quat(ble_imu_quat_t *out, const bno085_quaternion_t *in)
+{
+    out->i = in->i;
+    out->j = in->j;
+    out->k = in->k;
+    out->real = in->real;
+}
+
+static inline void frame_pack_quat_acc(ble_imu_quat_t *out, const bno085_quaternion_t *in)
+{
+    frame_pack_quat(out, in);
+}
+
+static inline void frame_pack_vec3(ble_imu_vector_t *out, const bno085_vector_t *in)
+{
+    out->x = in->x;
+    out->y = in->y;
+    out->z = in->z;
+}
+
+static inline void frame_pack_u32(uint32_t *out, const uint32_t *in)
+{
+    *out = *in;
+}
+
+static inline void frame_pack_stability(uint8_t *out, const bno085_stability_t *in)
+{
+    *out = (uint8_t)*in;
+}
+
+#if CONFIG_BLE_RAW_PASSTHROUGH
+/*******************************************************************************
+ * Private Functions - Raw Passthrough
+ ******************************************************************************/
+
+/**
+ * @brief Advance the receive clock from the cycle counter
+ * @return Current time in µs (wraps at 2^32)
+ *
+ * Called on every poll, far more often than the cycle counter wraps
+ * (~67 s), so elapsed cycles never alias.
+ */
+static inline uint32_t pipeline_time_us(imu_pipeline_t *pipeline)
+{
+    uint32_t elapsed = board_cycle_counter_get() - pipeline->time_cycles;
+    uint32_t us = elapsed / PIPELINE_CYCLES_PER_US;
+
+    /* Keep the sub-µs remainder in time_cycles so no time is lost */
+    pipeline->time_cycles += us * PIPELINE_CYCLES_PER_US;
+    pipeline->time_us += us;
+    return pipeline->time_us;
+}
+
+/**
+ * @brief Queue the coalesced records as one notification
+ * @return NRF_SUCCESS, or error from ble_imu_notify_raw()
+ *
+ * Records are discarded on any error except NRF_ERROR_RESOURCES, which
+ * keeps them for the next attempt.
+ */
+static RAMFUNC uint32_t pipeline_flush_raw(imu_pipeline_t *pipeline)
+{
+    uint32_t err_code = ble_imu_notify_raw(pipeline->service, pipeline->raw,
+                                           pipeline->raw_len);
+
+    if (err_code == NRF_SUCCESS) {
+        pipeline->raw_stats.notifications++;
+    }
+    if (err_code != NRF_ERROR_RESOURCES) {
+        pipeline->raw_len = 0;
+    }
+    return err_code;
+}
+
+/**
+ * @brief Forward one SHTP packet without decoding it
+ * @return SHTP channel forwarded, 0 if none, or negative error code
+ *
+ * The cargo goes from TWIM straight to its slot in the notification
+ * block; the only bytes the CPU writes are the 6-byte record header.
+ */
+static RAMFUNC int pipeline_poll_raw(imu_pipeline_t *pipeline)
+{
+    bno085_t *imu = pipeline->imu;
+    uint16_t max_len = ble_imu_raw_max_len(pipeline->service);
+    uint16_t cargo_len;
+    uint16_t record_len;
+    uint8_t channel;
+    uint8_t *record;
+    uint32_t now_us;
+    int result;
+
+    if (!imu->initialized) {
+        return BNO085_ERR_NOT_READY;
+    }
+
+    /* Once per loop, also the clock imu_pipeline_notify() ages records by */
+    now_us = pipeline_time_us(pipeline);
+
+    result = bno085_read_header(imu);
+    if (result <= 0) {
+        return result;
+    }
+
+    channel = imu->rx_buffer[SHTP_HEADER_CHANNEL];
+    cargo_len = (uint16_t)result - SHTP_HEADER_SIZE;
+    record_len = SHTP_PT_RECORD_HEADER_SIZE + cargo_len;
+
+    /* Not sensor data (late command responses): drain into the driver */
+    if ((channel != SHTP_CHANNEL_REPORTS && channel != SHTP_CHANNEL_GYRO_RV) ||
+        cargo_len == 0) {
+        result = bno085_read_cargo(imu, NULL);
+        return (result < 0) ? result : 0;
+    }
+
+    if (cargo_len > SHTP_PT_MAX_CARGO || record_len > max_len) {
+        pipeline->raw_stats.skipped++;
+        result = bno085_read_cargo(imu, NULL);
+        return (result < 0) ? result : 0;
+    }
+
+    /* No room behind the records already waiting: send them first */
+    if (pipeline->raw_len + record_len > max_len &&
+        pipeline_flush_raw(pipeline) == NRF_ERROR_RESOURCES) {
+        pipeline->raw_stats.dropped++;
+        result = bno085_read_cargo(imu, NULL);
+        return (result < 0) ? result : 0;
+    }
+
+    record = &pipeline->raw[pipeline->raw_len];
+    result = bno085_read_cargo(imu, &record[SHTP_PT_RECORD_HEADER_SIZE]);
+    if (result < 0) {
+        return result;
+    }
+
+    shtp_pt_put_header(record, channel, (uint8_t)cargo_len, now_us);
+    if (pipeline->raw_len == 0) {
+        pipeline->raw_first_us = now_us;
+    }
+    pipeline->raw_len += record_len;
+    pipeline->raw_stats.records++;
+
+    return channel;
+}
+#endif
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+int imu_pipeline_init(imu_pipeline_t *pipeline, bno085_t *imu,
+                      ble_imu_service_t *service)
+{
+    memset(pipeline, 0, sizeof(*pipeline));
+    pipeline->imu = imu;
+    pipeline->service = service;
+
+    /* The packers write wire-format values straight into this block and
+     * ble_imu_notify_sensor() hands them to the SoftDevice from there */
+    pipeline->frame = (ble_imu_frame_t *)dma_pool_alloc(DMA_POOL_BLE,
+                                                        DMA_OWNER_PIPELINE);
+    if (pipeline->frame == NULL) {
+        return BNO085_ERR_NO_MEM;
+    }
+    memset(pipeline->frame, 0, sizeof(*pipeline->frame));
+
+#if CONFIG_BLE_RAW_PASSTHROUGH
+    pipeline->raw = dma_pool_alloc(DMA_POOL_BLE, DMA_OWNER_PIPELINE);
+    if (pipeline->raw == NULL) {
+        dma_pool_free((uint8_t *)pipeline->frame, DMA_OWNER_PIPELINE);
+        pipeline->frame = NULL;
+        return BNO085_ERR_NO_MEM;
+    }
+    pipeline->time_cycles = board_cycle_counter_get();
+#endif
+
+    return BNO085_OK;
+}
+
+int imu_pipeline_enable_reports(imu_pipeline_t *pipeline, uint32_t interval_us)
+{
+    int result;
+
+    /* Citation: FIRMWARE_DESIGN.md:
+     *   "Report Type: Rotation Vector (0x05)"
+     *   "Report Interval: 5000 µs (5 ms) = 200 Hz"
+     */
+#define X(name, id, en, q, layout, field, ble, uuid)                         \
+    SENSOR_REPORT_IF(en,                                                    \
+    result = bno085_enable_report(pipeline->imu, (bno085_report_type_t)id,  \
+                                  interval_us);                             \
+    if (result != BNO085_OK) {                                              \
+        return result;                                                      \
+    })
+    SENSOR_REPORT_TABLE(X)
+#undef X
+
+    return BNO085_OK;
+}
+
+RAMFUNC int imu_pipeline_poll(imu_pipeline_t *pipeline)
+{
+    int report;
+
+#if CONFIG_BLE_RAW_PASSTHROUGH
+    if (pipeline->service->raw_notify_enabled) {
+        return pipeline_poll_raw(pipeline);
+    }
+    pipeline->raw_len = 0;  /* Records left from an earlier session */
+#endif
+
+    report = bno085_poll(pipeline->imu, &pipeline->data);
+
+    if (report <= 0) {
+        return report;  /* No data or error */
+    }
+
+    /* Update the BLE frame for reports that have a characteristic */
+    switch (report) {
+#define X(name, id, en, q, layout, field, ble, uuid)                         \
+        SENSOR_REPORT_IF(en, SENSOR_REPORT_IF(ble,                          \
+        case id:                                                            \
+            frame_pack_##layout(&pipeline->frame->field,                    \
+                                &pipeline->data.field);                     \
+            pipeline->dirty |= (1UL << BLE_IMU_SENSOR_##name);              \
+            break;))
+        SENSOR_REPORT_TABLE(X)
+#undef X
+
+        default:
+            break;
+    }
+
+    return report;
+}
+
+RAMFUNC void imu_pipeline_notify(imu_pipeline_t *pipeline)
+{
+    uint32_t err_code;
+
+#if CONFIG_BLE_RAW_PASSTHROUGH
+    if (pipeline->service->raw_notify_enabled) {
+        if (pipeline->raw_len > 0 &&
+            pipeline->time_us - pipeline->raw_first_us >= CONFIG_BLE_RAW_FLUSH_US) {
+            (void)pipeline_flush_raw(pipeline);
+        }
+        return;
+    }
+#endif
+
+    if (pipeline->dirty == 0) {
+        return;
+    }
+
+#define X(name, id, en, q, layout, field, ble, uuid)                         \
+    SENSOR_REPORT_IF(en, SENSOR_REPORT_IF(ble,                              \
+    if (pipeline->dirty & (1UL << BLE_IMU_SENSOR_##name)) {                 \
+        err_code = ble_imu_notify_sensor(pipeline->service,                 \
+                                         BLE_IMU_SENSOR_##name,             \
+                                         &pipeline->frame->field);          \
+        if (err_code != NRF_ERROR_RESOURCES) {                              \
+            pipeline->dirty &= ~(1UL << BLE_IMU_SENSOR_##name);             \
+        }                                                                   \
+    }))
+    SENSOR_REPORT_TABLE(X)
+#undef X
+}
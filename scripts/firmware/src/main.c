@@ -20,6 +20,8 @@
 #include "bno085.h"
 #include "twim.h"
 #include "shtp.h"
+#include "imu_pipeline.h"
+#include "dma_pool.h"
 
 /* BLE Stack Headers */
 #include "softdevice.h"
@@ -52,7 +54,6 @@ typedef enum {
 
 static app_state_t s_app_state = APP_STATE_INIT;
 static bno085_t s_imu;
-static bno085_data_t s_imu_data;
 static uint32_t s_led_timer = 0;
 static uint32_t s_sensor_timer = 0;
 static bool s_sensor_ok = false;
@@ -61,10 +62,22 @@ static bool s_sensor_ok = false;
 static ble_imu_service_t s_imu_service;
 static bool s_ble_connected = false;
 
-/* Latest sensor readings for BLE notifications */
-static ble_imu_quat_t s_quaternion;
-static ble_imu_vector_t s_accel;
-static ble_imu_vector_t s_gyro;
+/* Sensor -> BLE acquisition path */
+static imu_pipeline_t s_pipeline;
+
+#if CONFIG_PERF_CYCLE_STATS
+/* Per-sample cost of poll + parse + notify in CPU cycles (DWT CYCCNT).
+ * Read with a debugger; reset by writing count = 0. */
+typedef struct {
+    uint32_t count;         /* Samples measured */
+    uint32_t last;          /* Most recent sample */
+    uint32_t min;           /* Fastest sample */
+    uint32_t max;           /* Slowest sample */
+    uint64_t total;         /* Sum, for the mean */
+} perf_cycles_t;
+
+static volatile perf_cycles_t s_sample_cycles;
+#endif
 
 /*******************************************************************************
  * Private Functions - Error Handling
@@ -107,31 +120,11 @@ static int sensor_init(void)
         return result;
     }
     
-    /* Enable rotation vector at 200 Hz
-     * Citation: FIRMWARE_DESIGN.md:
-     *   "Report Type: Rotation Vector (0x05)"
-     *   "Report Interval: 5000 µs (5 ms) = 200 Hz"
-     */
-    result = bno085_enable_rotation_vector(&s_imu, CONFIG_BNO085_REPORT_RATE_US);
+    /* Enable all configured reports at 200 Hz */
+    result = imu_pipeline_enable_reports(&s_pipeline, CONFIG_BNO085_REPORT_RATE_US);
     if (result != BNO085_OK) {
         return result;
     }
-    
-#if CONFIG_ENABLE_ACCELEROMETER
-    /* Enable accelerometer at same rate */
-    result = bno085_enable_accelerometer(&s_imu, CONFIG_BNO085_REPORT_RATE_US);
-    if (result != BNO085_OK) {
-        return result;
-    }
-#endif
-
-#if CONFIG_ENABLE_GYROSCOPE
-    /* Enable gyroscope at same rate */
-    result = bno085_enable_gyroscope(&s_imu, CONFIG_BNO085_REPORT_RATE_US);
-    if (result != BNO085_OK) {
-        return result;
-    }
-#endif
 
     s_sensor_ok = true;
     return 0;
@@ -139,48 +132,15 @@ static int sensor_init(void)
 
 /**
  * @brief Poll sensor and update data
+ * @return Report ID received, 0 if none, or negative error code
  */
-static void sensor_poll(void)
+static int sensor_poll(void)
 {
-    int report;
-    
     if (!s_sensor_ok) {
-        return;
+        return 0;
     }
     
-    /* Poll for sensor data */
-    report = bno085_poll(&s_imu, &s_imu_data);
-    
-    if (report < 0) {
-        /* Error polling sensor */
-        return;
-    }
-    
-    /* Update cached data based on report type */
-    switch (report) {
-        case SH2_ROTATION_VECTOR:
-        case SH2_GAME_ROTATION_VECTOR:
-            s_quaternion.i = s_imu_data.rotation_vector.i;
-            s_quaternion.j = s_imu_data.rotation_vector.j;
-            s_quaternion.k = s_imu_data.rotation_vector.k;
-            s_quaternion.real = s_imu_data.rotation_vector.real;
-            break;
-            
-        case SH2_ACCELEROMETER:
-            s_accel.x = s_imu_data.accelerometer.x;
-            s_accel.y = s_imu_data.accelerometer.y;
-            s_accel.z = s_imu_data.accelerometer.z;
-            break;
-            
-        case SH2_GYROSCOPE:
-            s_gyro.x = s_imu_data.gyroscope.x;
-            s_gyro.y = s_imu_data.gyroscope.y;
-            s_gyro.z = s_imu_data.gyroscope.z;
-            break;
-            
-        default:
-            break;
-    }
+    return imu_pipeline_poll(&s_pipeline);
 }
 
 /*******************************************************************************
@@ -258,8 +218,9 @@ static void ble_imu_evt_handler(const ble_imu_evt_t *evt)
             /* Client disconnected */
             break;
             
-        case BLE_IMU_EVT_QUAT_NOTIFY_EN:
-            /* Start streaming quaternion data */
+        case BLE_IMU_EVT_SENSOR_NOTIFY_EN:
+            /* Start streaming this sensor - resend the latest value */
+            imu_pipeline_mark_dirty(&s_pipeline, evt->data.sensor);
             break;
             
         case BLE_IMU_EVT_RATE_WRITE:
@@ -267,7 +228,7 @@ static void ble_imu_evt_handler(const ble_imu_evt_t *evt)
              * Citation: FIRMWARE_DESIGN.md - "Report Interval: 5000 µs (5 ms) = 200 Hz" */
             if (s_sensor_ok && evt->data.rate_ms >= 1) {
                 uint32_t interval_us = (uint32_t)evt->data.rate_ms * 1000;
-                bno085_enable_rotation_vector(&s_imu, interval_us);
+                imu_pipeline_enable_reports(&s_pipeline, interval_us);
             }
             break;
             
@@ -457,35 +418,44 @@ static void led_update(void)
  * Citation: FIRMWARE_DESIGN.md - "BLE Service Design":
  *   - Notify quaternion, accelerometer, gyroscope data to connected clients
  *   - Only send when notifications are enabled and client is connected
+ * 
+ * Only characteristics whose value changed since the last call are sent.
+ * A value that could not be queued stays dirty and is retried next loop.
  */
 static void ble_notify_imu_data(void)
 {
-    uint32_t err_code;
-    
     /* Only send notifications if connected */
     if (!s_ble_connected) {
         return;
     }
     
-    /* Send quaternion notification (primary data) */
-    err_code = ble_imu_notify_quaternion(&s_imu_service, &s_quaternion);
-    if (err_code != NRF_SUCCESS && err_code != NRF_ERROR_INVALID_STATE) {
-        /* NRF_ERROR_INVALID_STATE means notifications not enabled - that's OK */
-        /* Other errors might indicate buffer full, etc. */
+    imu_pipeline_notify(&s_pipeline);
+}
+
+#if CONFIG_PERF_CYCLE_STATS
+/**
+ * @brief Accumulate the cycle cost of one sensor sample
+ * @param cycles Cycles from poll start to notify end
+ */
+static void perf_record_sample(uint32_t cycles)
+{
+    if (s_sample_cycles.count == 0) {
+        s_sample_cycles.min = UINT32_MAX;
+        s_sample_cycles.max = 0;
+        s_sample_cycles.total = 0;
     }
     
-#if CONFIG_ENABLE_ACCELEROMETER
-    /* Send accelerometer notification */
-    err_code = ble_imu_notify_accelerometer(&s_imu_service, &s_accel);
-    (void)err_code;  /* Ignore errors - best effort */
-#endif
-
-#if CONFIG_ENABLE_GYROSCOPE
-    /* Send gyroscope notification */
-    err_code = ble_imu_notify_gyroscope(&s_imu_service, &s_gyro);
-    (void)err_code;  /* Ignore errors - best effort */
-#endif
+    s_sample_cycles.count++;
+    s_sample_cycles.last = cycles;
+    s_sample_cycles.total += cycles;
+    if (cycles < s_sample_cycles.min) {
+        s_sample_cycles.min = cycles;
+    }
+    if (cycles > s_sample_cycles.max) {
+        s_sample_cycles.max = cycles;
+    }
 }
+#endif
 
 /**
  * @brief Main application loop iteration
@@ -525,12 +495,25 @@ static void app_main_loop(void)
      */
     softdevice_evt_process();
     
+#if CONFIG_PERF_CYCLE_STATS
+    uint32_t start = board_cycle_counter_get();
+#endif
+    
     /* Poll sensor data from BNO085 */
-    sensor_poll();
+    int report = sensor_poll();
     
     /* Send BLE notifications if enabled */
     ble_notify_imu_data();
     
+#if CONFIG_PERF_CYCLE_STATS
+    /* Only iterations that delivered a report count as a sample */
+    if (report > 0) {
+        perf_record_sample(board_cycle_counter_get() - start);
+    }
+#else
+    (void)report;
+#endif
+    
     /* Update status LED */
     led_update();
 }
@@ -557,6 +540,9 @@ int main(void)
     /* ========== Phase 1: Board Initialization ========== */
     s_app_state = APP_STATE_INIT;
     
+    /* DMA buffers first - TWIM and the BNO085 driver allocate from it */
+    dma_pool_init();
+    
     result = board_init();
     if (result != 0) {
         app_fatal_error(result);
@@ -570,6 +556,11 @@ int main(void)
     /* ========== Phase 2-3: Sensor Initialization ========== */
     s_app_state = APP_STATE_SENSOR_SETUP;
     
+    result = imu_pipeline_init(&s_pipeline, &s_imu, &s_imu_service);
+    if (result != 0) {
+        app_fatal_error(result);
+    }
+    
     result = sensor_init();
     if (result != 0) {
         /* Sensor init failed - continue anyway for debugging */
@@ -23,6 +23,11 @@
 /* Event buffer size - sized for maximum MTU plus event overhead */
 #define BLE_EVT_BUFFER_SIZE     256
 
+/* Application RAM start from the linker script (ORIGIN(RAM)). The
+ * SoftDevice owns everything below it. */
+extern uint32_t __sd_ram_end__;
+#define SD_APP_RAM_START        ((uint32_t)&__sd_ram_end__)
+
 /* Static variables */
 static bool m_softdevice_enabled = false;
 static uint32_t m_app_ram_base = 0;
@@ -51,9 +56,11 @@ static uint32_t ble_stack_configure(const softdevice_config_t *p_config, uint32_
     uint32_t err_code;
     ble_cfg_t ble_cfg;
     
-    /* Start with minimum required RAM base for S140 6.1.1 */
-    /* Citation: Nordic DevZone - "Minimum RAM Start 0x20001628" */
-    uint32_t ram_base = 0x20001628;
+    /* Configure against the RAM start the application is actually linked
+     * at, so sd_ble_enable() reports whether the configuration fits.
+     * Citation: Nordic DevZone - "Minimum RAM Start 0x20001628" is only the
+     * floor for a configuration with no BLE roles. */
+    uint32_t ram_base = SD_APP_RAM_START;
     
     /* Configure GAP connection count */
     memset(&ble_cfg, 0, sizeof(ble_cfg));
@@ -197,8 +204,14 @@ uint32_t softdevice_init(const softdevice_config_t *p_config)
      * Citation: Nordic SDK - sd_ble_enable() must be called after all
      * sd_ble_cfg_set() calls and before any other BLE API functions */
     err_code = sd_ble_enable(&m_app_ram_base);
+    if (err_code == NRF_SUCCESS && m_app_ram_base > SD_APP_RAM_START)
+    {
+        /* SoftDevice needs RAM the linker gave to .data/.bss */
+        err_code = NRF_ERROR_NO_MEM;
+    }
     if (err_code != NRF_SUCCESS)
     {
+        /* m_app_ram_base keeps the required base for diagnosis */
         sd_softdevice_disable();
         return err_code;
     }
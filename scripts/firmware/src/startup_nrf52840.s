@@ -169,6 +169,30 @@ LoopCopyDataInit:
     cmp r4, r1
     bcc CopyDataInit
 
+    /* Copy .ramfunc section (hot-path code) from flash to RAM, through the
+     * Data RAM address of the Code RAM alias it is linked at */
+    ldr r0, =_sramfunc_data   /* Destination start */
+    ldr r1, =_eramfunc_data   /* Destination end */
+    ldr r2, =_siramfunc       /* Source start */
+    
+    movs r3, #0
+    b LoopCopyRamfunc
+
+CopyRamfunc:
+    ldr r4, [r2, r3]
+    str r4, [r0, r3]
+    adds r3, r3, #4
+
+LoopCopyRamfunc:
+    adds r4, r0, r3
+    cmp r4, r1
+    bcc CopyRamfunc
+
+    /* Ensure the copied code is visible to instruction fetch
+     * Citation: ARM Cortex-M4 TRM - DSB/ISB after writing executable memory */
+    dsb
+    isb
+
     /* Zero fill .bss section */
     ldr r2, =_sbss        /* Start of BSS */
     ldr r4, =_ebss        /* End of BSS */
@@ -24,6 +24,8 @@
 
 #include "twim.h"
 #include "board.h"
+#include "ramfunc.h"
+#include "dma_pool.h"
 #include <string.h>
 
 /*******************************************************************************
@@ -47,12 +49,6 @@
 #define __ISB() __asm volatile ("isb 0xF" ::: "memory")
 #define __NOP() __asm volatile ("nop")
 
-/* EasyDMA buffer for single-byte operations - MUST be in RAM, not stack
- * Citation: nRF52840_PS_v1.11.pdf Section 4.6 EasyDMA:
- *   "PTR register must point to a valid memory region"
- *   "If PTR is not pointing to Data RAM region, transfer may result in HardFault"
- */
-static uint8_t s_easydma_buffer[4] __attribute__((aligned(4)));
 
 /*******************************************************************************
  * Private Functions
@@ -64,7 +60,7 @@ static uint8_t s_easydma_buffer[4] __attribute__((aligned(4)));
  * @param event_offset Event register offset
  * @return true if event occurred, false if timeout
  */
-static bool twim_wait_event(uint32_t base, uint32_t event_offset)
+static RAMFUNC bool twim_wait_event(uint32_t base, uint32_t event_offset)
 {
     uint32_t timeout = TWIM_TIMEOUT_LOOPS;
     
@@ -84,7 +80,7 @@ static bool twim_wait_event(uint32_t base, uint32_t event_offset)
  * @param twim Pointer to TWIM handle
  * @return Error code or TWIM_OK
  */
-static int twim_check_error(twim_t *twim)
+static RAMFUNC int twim_check_error(twim_t *twim)
 {
     uint32_t errorsrc = TWIM_REG_GET(twim->base, TWIM_ERRORSRC);
     
@@ -238,7 +234,7 @@ int twim_set_frequency(twim_t *twim, twim_frequency_t frequency)
     return TWIM_OK;
 }
 
-int twim_write(twim_t *twim, uint8_t addr, const uint8_t *data, 
+RAMFUNC int twim_write(twim_t *twim, uint8_t addr, const uint8_t *data, 
                uint16_t len, bool stop)
 {
     int result;
@@ -251,6 +247,11 @@ int twim_write(twim_t *twim, uint8_t addr, const uint8_t *data,
         return TWIM_ERR_INVALID_PARAM;
     }
     
+    /* Reject const/flash buffers instead of faulting inside EasyDMA */
+    if (!TWIM_IS_DMA_SAFE(data, len)) {
+        return TWIM_ERR_NOT_DMA_SAFE;
+    }
+    
     /* Clear events */
     TWIM_REG_SET(twim->base, TWIM_EVENTS_STOPPED, 0);
     TWIM_REG_SET(twim->base, TWIM_EVENTS_ERROR, 0);
@@ -316,7 +317,7 @@ int twim_write(twim_t *twim, uint8_t addr, const uint8_t *data,
     return (int)TWIM_REG_GET(twim->base, TWIM_TXD_AMOUNT);
 }
 
-int twim_read(twim_t *twim, uint8_t addr, uint8_t *data, uint16_t len)
+RAMFUNC int twim_read(twim_t *twim, uint8_t addr, uint8_t *data, uint16_t len)
 {
     int result;
     
@@ -328,6 +329,11 @@ int twim_read(twim_t *twim, uint8_t addr, uint8_t *data, uint16_t len)
         return TWIM_ERR_INVALID_PARAM;
     }
     
+    /* Reject const/flash buffers instead of faulting inside EasyDMA */
+    if (!TWIM_IS_DMA_SAFE(data, len)) {
+        return TWIM_ERR_NOT_DMA_SAFE;
+    }
+    
     /* Clear events */
     TWIM_REG_SET(twim->base, TWIM_EVENTS_STOPPED, 0);
     TWIM_REG_SET(twim->base, TWIM_EVENTS_ERROR, 0);
@@ -480,26 +486,33 @@ int twim_scan(twim_t *twim, uint8_t *found_addrs, uint8_t max_count)
 
 bool twim_device_present(twim_t *twim, uint8_t addr)
 {
+    uint8_t *rx_byte;
+    
     if (twim == NULL || !twim->initialized) {
         return false;
     }
     
-    /* Clear events and errors */
-    TWIM_REG_SET(twim->base, TWIM_EVENTS_STOPPED, 0);
-    TWIM_REG_SET(twim->base, TWIM_EVENTS_ERROR, 0);
-    TWIM_REG_SET(twim->base, TWIM_ERRORSRC, 
-                 TWIM_ERRORSRC_OVERRUN | TWIM_ERRORSRC_ANACK | TWIM_ERRORSRC_DNACK);
-    
     /* Try to read one byte - device will ACK address if present
      * 
-     * CRITICAL: Use static buffer for EasyDMA - NOT stack variable!
+     * CRITICAL: EasyDMA target must be in Data RAM - take it from the pool
      * Citation: nRF52840_PS_v1.11.pdf Section 4.6 EasyDMA:
      *   "If RXD.PTR is not pointing to the Data RAM region when reception 
      *    is enabled, an EasyDMA transfer may result in a HardFault and/or 
      *    memory corruption."
      */
+    rx_byte = dma_pool_alloc(DMA_POOL_SMALL, DMA_OWNER_TWIM);
+    if (rx_byte == NULL) {
+        return false;
+    }
+    
+    /* Clear events and errors */
+    TWIM_REG_SET(twim->base, TWIM_EVENTS_STOPPED, 0);
+    TWIM_REG_SET(twim->base, TWIM_EVENTS_ERROR, 0);
+    TWIM_REG_SET(twim->base, TWIM_ERRORSRC, 
+                 TWIM_ERRORSRC_OVERRUN | TWIM_ERRORSRC_ANACK | TWIM_ERRORSRC_DNACK);
+    
     TWIM_REG_SET(twim->base, TWIM_ADDRESS, addr);
-    TWIM_REG_SET(twim->base, TWIM_RXD_PTR, (uint32_t)&s_easydma_buffer[0]);
+    TWIM_REG_SET(twim->base, TWIM_RXD_PTR, (uint32_t)rx_byte);
     TWIM_REG_SET(twim->base, TWIM_RXD_MAXCNT, 1);
     TWIM_REG_SET(twim->base, TWIM_SHORTS, TWIM_SHORTS_LASTRX_STOP);
     
@@ -514,9 +527,11 @@ bool twim_device_present(twim_t *twim, uint8_t addr)
            TWIM_REG_GET(twim->base, TWIM_EVENTS_ERROR) == 0) {
         if (--timeout == 0) {
             TWIM_REG_SET(twim->base, TWIM_TASKS_STOP, 1);
+            dma_pool_free(rx_byte, DMA_OWNER_TWIM);
             return false;
         }
     }
+    dma_pool_free(rx_byte, DMA_OWNER_TWIM);
     
     /* Clear events */
     TWIM_REG_SET(twim->base, TWIM_EVENTS_STOPPED, 0);
@@ -0,0 +1,262 @@
+#!/usr/bin/env python3
+"""Worst-case stack depth per execution context, and RAM budget from the map.
+
+Inputs are produced by the normal build (see Makefile STACK_FLAGS):
+  <obj_dir>/*.ci   call graph with per-function frame sizes
+                   (-fcallgraph-info=su, GCC >= 10)
+  <map_file>       linker map, for RAM layout and __stack_size__
+
+Usage: stack_report.py <obj_dir> <map_file> [sd_ram_base]
+
+sd_ram_base is the value of softdevice_app_ram_base_get() read from the
+target (debugger or log). When given, it is checked against the RAM origin
+in the map.
+
+Contexts:
+  main      main() and everything it calls, plus the SoftDevice's own use of
+            the application stack during SVC calls
+  ISR/fault every C exception or IRQ handler (name ends in _Handler or
+            _IRQHandler), plus SoftDevice callbacks listed in SD_CALLBACKS
+Each preempting context costs an extended exception frame (FPU enabled).
+Worst case total = main + one frame and handler per IRQ root + the deepest
+fault handler.
+"""
+import glob
+import os
+import re
+import sys
+
+# Indirect calls, resolved by the source file of the call site. Function
+# pointers in this firmware are all registered event callbacks.
+INDIRECT_TARGETS = {
+    'softdevice.c': ['ble_stack_evt_handler'],
+    'ble_stack.c': ['ble_conn_evt_handler', 'imu_service_ble_evt_wrapper',
+                    'ble_advertising_on_ble_evt'],
+    'ble_imu_service.c': ['ble_imu_evt_handler'],
+    'ble_advertising.c': ['ble_adv_evt_handler'],
+}
+
+# Called by the SoftDevice from its own interrupt context
+SD_CALLBACKS = ['sd_fault_handler']
+
+# Worst-case application stack used by the SoftDevice itself.
+# Citation: S140 SoftDevice Specification, "Memory resource requirements"
+SD_STACK_BYTES = 1536
+
+# Cortex-M4F exception frame with FPU context (lazy stacking reserves it)
+EXCEPTION_FRAME_BYTES = 104
+
+# Allowance for library functions with no call-graph info (memcpy, libm)
+EXTERNAL_STACK_BYTES = 64
+
+NODE_RE = re.compile(r'^node: \{ title: "([^"]+)" label: "([^"]*)"')
+EDGE_RE = re.compile(r'^edge: \{ sourcename: "([^"]+)" targetname: "([^"]+)" label: "([^"]*)"')
+FRAME_RE = re.compile(r'\\n(\d+) bytes \(([^)]+)\)')
+
+
+def bare(title):
+    """Static functions are titled "src/file.c:name"; same-named statics in
+    different files are merged, which only over-estimates."""
+    return title.rsplit(':', 1)[-1]
+
+
+def load_callgraph(obj_dir):
+    frames = {}         # function -> (bytes, qualifier)
+    calls = {}          # function -> set of callees
+    external = set()
+    for path in sorted(glob.glob(os.path.join(obj_dir, '*.ci'))):
+        for line in open(path):
+            m = NODE_RE.match(line)
+            if m:
+                name, label = m.groups()
+                name = bare(name)
+                f = FRAME_RE.search(label)
+                if f:
+                    size = int(f.group(1))
+                    if name in frames and frames[name][0] != size:
+                        # Same-named static functions in two files: keep the larger
+                        size = max(size, frames[name][0])
+                    frames[name] = (size, f.group(2))
+                elif name != '__indirect_call':
+                    external.add(name)
+                continue
+            m = EDGE_RE.match(line)
+            if m:
+                src, dst, site = m.groups()
+                src, dst = bare(src), bare(dst)
+                if dst == '__indirect_call':
+                    site_file = os.path.basename(site.split(':')[0])
+                    targets = INDIRECT_TARGETS.get(site_file)
+                    if targets is None:
+                        calls.setdefault(src, set()).add('<unresolved indirect>')
+                        continue
+                    calls.setdefault(src, set()).update(targets)
+                else:
+                    calls.setdefault(src, set()).add(dst)
+    external -= set(frames)
+    return frames, calls, external
+
+
+def worst_case(root, frames, calls, external):
+    """Return (bytes, path, flags) of the deepest call chain from root."""
+    memo = {}
+
+    def visit(fn, stack):
+        if fn in stack:
+            return 0, [fn + ' (recursion)'], {'recursion'}
+        if fn in memo:
+            return memo[fn]
+        flags = set()
+        if fn in frames:
+            own, qual = frames[fn]
+            if qual == 'dynamic':
+                flags.add('dynamic')
+            elif qual != 'static':
+                flags.add('bounded')
+        elif fn.startswith('sd_'):
+            own = 0     # SVC into the SoftDevice: covered by SD_STACK_BYTES
+        elif fn in external:
+            own = EXTERNAL_STACK_BYTES
+        else:
+            own = 0
+            if fn.startswith('<'):
+                flags.add('unresolved')
+        best = (0, [], set())
+        for callee in sorted(calls.get(fn, ())):
+            depth = visit(callee, stack | {fn})
+            flags |= depth[2]
+            if depth[0] > best[0]:
+                best = depth
+        result = (own + best[0], [fn] + best[1], flags)
+        memo[fn] = result
+        return result
+
+    return visit(root, frozenset())
+
+
+def parse_map(map_file):
+    text = open(map_file).read().splitlines()
+    layout = {'regions': {}, 'sections': [], 'symbols': {}}
+    in_mem = False
+    pending = None
+    for line in text:
+        if line.startswith('Memory Configuration'):
+            in_mem = True
+            continue
+        if line.startswith('Linker script and memory map'):
+            in_mem = False
+            continue
+        if in_mem:
+            parts = line.split()
+            if len(parts) >= 3 and parts[1].startswith('0x'):
+                layout['regions'][parts[0]] = (int(parts[1], 16), int(parts[2], 16))
+            continue
+        # Output section: ".bss  0x...  0x..." at column 0; long names put
+        # address and size on the next line
+        m = re.match(r'^(\.\S+)(?:\s+(0x[0-9a-fA-F]+)\s+(0x[0-9a-fA-F]+))?', line)
+        if m:
+            if m.group(2):
+                layout['sections'].append((m.group(1), int(m.group(2), 16), int(m.group(3), 16)))
+                pending = None
+            else:
+                pending = m.group(1)
+            continue
+        if pending:
+            m = re.match(r'^\s+(0x[0-9a-fA-F]+)\s+(0x[0-9a-fA-F]+)', line)
+            if m:
+                layout['sections'].append((pending, int(m.group(1), 16), int(m.group(2), 16)))
+            pending = None
+        m = re.match(r'^\s+(0x[0-9a-fA-F]+)\s+(\w+) = ', line)
+        if m:
+            layout['symbols'][m.group(2)] = int(m.group(1), 16)
+    return layout
+
+
+def main():
+    if len(sys.argv) < 3:
+        print(__doc__)
+        return 1
+    obj_dir, map_file = sys.argv[1], sys.argv[2]
+    sd_ram_base = int(sys.argv[3], 0) if len(sys.argv) > 3 and sys.argv[3] else None
+
+    frames, calls, external = load_callgraph(obj_dir)
+    layout = parse_map(map_file) if os.path.exists(map_file) else None
+    stack_size = layout['symbols'].get('__stack_size__') if layout else None
+
+    print('Stack usage report')
+    print('==================')
+    if not frames:
+        print(f'No call-graph info in {obj_dir} (.ci files). Build without')
+        print('RELEASE=1 so -fstack-usage/-fcallgraph-info see the final code.')
+        return 0
+
+    # Execution contexts
+    handlers = sorted(f for f in frames
+                      if re.search(r'_(IRQ)?Handler(_C)?$', f) or f in SD_CALLBACKS)
+    faults = [h for h in handlers if 'Fault' in h or h.startswith('NMI')]
+
+    main_depth = worst_case('main', frames, calls, external)
+    print(f'{"Context":32s} {"Worst":>6s}  Flags')
+    print(f'{"main (+ SoftDevice SVC)":32s} {main_depth[0] + SD_STACK_BYTES:6d}  '
+          f'{",".join(sorted(main_depth[2]))}')
+    print(f'  path: {" -> ".join(main_depth[1])}')
+
+    irq_total = 0
+    fault_worst = 0
+    for h in handlers:
+        depth = worst_case(h, frames, calls, external)
+        cost = depth[0] + EXCEPTION_FRAME_BYTES
+        if h in faults:
+            fault_worst = max(fault_worst, cost)
+        else:
+            irq_total += cost
+        print(f'{h:32s} {cost:6d}  {",".join(sorted(depth[2]))}')
+        print(f'  path: {" -> ".join(depth[1])}')
+
+    total = main_depth[0] + SD_STACK_BYTES + irq_total + fault_worst
+    print()
+    print(f'Worst case total : {total} bytes '
+          f'(main {main_depth[0]} + SoftDevice {SD_STACK_BYTES} + IRQs {irq_total} '
+          f'+ fault {fault_worst})')
+    if stack_size is not None:
+        margin = stack_size - total
+        print(f'Stack reserved   : {stack_size} bytes (__stack_size__)')
+        print(f'Margin           : {margin} bytes{"  ** OVERFLOW RISK **" if margin < 0 else ""}')
+        if margin < 0:
+            return 2
+    print()
+
+    print('Largest stack frames')
+    print('--------------------')
+    for name, (size, qual) in sorted(frames.items(), key=lambda kv: -kv[1][0])[:15]:
+        print(f'  {size:6d}  {qual:18s} {name}')
+    print()
+
+    if not layout:
+        return 0
+
+    print('RAM budget (from map)')
+    print('---------------------')
+    ram_origin, ram_length = layout['regions'].get('RAM', (0, 0))
+    ram_end = ram_origin + ram_length
+    used_end = ram_origin
+    for name, addr, size in layout['sections']:
+        if ram_origin <= addr < ram_end and size > 0:
+            print(f'  {name:12s} 0x{addr:08X} {size:7d}')
+            used_end = max(used_end, addr + size)
+    print(f'  App RAM origin : 0x{ram_origin:08X}')
+    print(f'  Used up to     : 0x{used_end:08X} ({used_end - ram_origin} bytes)')
+    print(f'  Free           : {ram_end - used_end} bytes')
+    if sd_ram_base is None:
+        print('  SoftDevice base: not given (pass softdevice_app_ram_base_get())')
+    elif sd_ram_base > ram_origin:
+        print(f'  SoftDevice base: 0x{sd_ram_base:08X} ** exceeds RAM origin by '
+              f'{sd_ram_base - ram_origin} bytes - raise ORIGIN(RAM) **')
+    else:
+        print(f'  SoftDevice base: 0x{sd_ram_base:08X} '
+              f'({ram_origin - sd_ram_base} bytes spare below RAM origin)')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,315 @@
+/**
+ * @file ekf.cpp
+ * @brief Native port of the web app's EKFTracker (lib/EKFTracker.ts)
+ */
+
+#include "ekf.hpp"
+
+#include <cmath>
+
+namespace imurec {
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+namespace {
+
+/* invert3x3 in EKFTracker; false if singular */
+bool invert3x3(const double m[3][3], double out[3][3])
+{
+    double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+                 m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+                 m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+
+    if (std::fabs(det) < EKF_SINGULAR_DET) {
+        return false;
+    }
+
+    double inv = 1 / det;
+
+    out[0][0] = (m[1][1] * m[2][2] - m[1][2] * m[2][1]) * inv;
+    out[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * inv;
+    out[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * inv;
+    out[1][0] = (m[1][2] * m[2][0] - m[1][0] * m[2][2]) * inv;
+    out[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * inv;
+    out[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * inv;
+    out[2][0] = (m[1][0] * m[2][1] - m[1][1] * m[2][0]) * inv;
+    out[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * inv;
+    out[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * inv;
+    return true;
+}
+
+} /* namespace */
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+vec3 rotate(const vec3 &v, const quat &q)
+{
+    /* t = 2 * cross(q.xyz, v); v + q.w * t + cross(q.xyz, t) */
+    double tx = 2 * (q.y * v.z - q.z * v.y);
+    double ty = 2 * (q.z * v.x - q.x * v.z);
+    double tz = 2 * (q.x * v.y - q.y * v.x);
+
+    return {v.x + q.w * tx + q.y * tz - q.z * ty,
+            v.y + q.w * ty + q.z * tx - q.x * tz,
+            v.z + q.w * tz + q.x * ty - q.y * tx};
+}
+
+double magnetic_heading(const vec3 &mag, const quat &q)
+{
+    vec3 w = rotate(mag, q);
+    double heading = std::atan2(w.x, w.z);
+
+    return heading < 0 ? heading + 2 * EKF_PI : heading;
+}
+
+double normalize_angle(double a)
+{
+    while (a > EKF_PI) {
+        a -= 2 * EKF_PI;
+    }
+    while (a < -EKF_PI) {
+        a += 2 * EKF_PI;
+    }
+    return a;
+}
+
+ekf_tracker::ekf_tracker(const ekf_params &params, ekf_covariance covariance)
+    : p_(params), cov_(covariance)
+{
+    for (int i = 0; i < 3; i++) {
+        q_axes_[i] = ekf_vec4{p_.q[i * 3], p_.q[i * 3 + 1], p_.q[i * 3 + 2], 0};
+    }
+    reset();
+}
+
+void ekf_tracker::reset()
+{
+    for (int i = 0; i < 9; i++) {
+        x_[i] = 0;
+    }
+    for (int i = 0; i < 81; i++) {
+        P_[i] = 0;
+    }
+    for (int i = 0; i < 9; i++) {
+        P_[i * 9 + i] = p_.p0[i];
+    }
+    for (int i = 0; i < 3; i++) {
+        for (int j = i; j < 3; j++) {
+            axes_(i, j) = i == j ? ekf_vec4{p_.p0[i * 3], p_.p0[i * 3 + 1], p_.p0[i * 3 + 2], 0}
+                                 : ekf_vec4{};
+        }
+    }
+    last_quat_ = {1, 0, 0, 0};
+    have_quat_ = false;
+    reference_heading_ = 0;
+    have_reference_ = false;
+    stationary_frames_ = 0;
+    hpf_cutoff_ = p_.hpf_cutoff_stationary;
+    filtered_ = {0, 0, 0};
+    prev_raw_ = {0, 0, 0};
+    step_ = ekf_step();
+}
+
+vec3 ekf_tracker::predict(const vec3 &accel, const quat &q, double dt)
+{
+    last_quat_ = q;
+    have_quat_ = true;
+    step_ = ekf_step();
+
+    /* Skip if dt too large (prevents huge jumps after tab inactive) */
+    if (dt > p_.max_dt || dt <= 0) {
+        return position();
+    }
+    step_.predicted = true;
+
+    vec3 world = rotate(accel, q);
+    double ax = world.x - x_[6];
+    double ay = world.y - x_[7];
+    double az = world.z - x_[8];
+
+    double mag = std::sqrt(accel.x * accel.x + accel.y * accel.y + accel.z * accel.z);
+    if (mag < p_.zupt_accel_threshold) {
+        stationary_frames_++;
+    } else {
+        stationary_frames_ = 0;
+    }
+
+    /* p += v dt + a dt^2 / 2, v += a dt, bias constant */
+    double px = x_[0] + x_[3] * dt + 0.5 * ax * dt * dt;
+    double py = x_[1] + x_[4] * dt + 0.5 * ay * dt * dt;
+    double pz = x_[2] + x_[5] * dt + 0.5 * az * dt * dt;
+    double vx = x_[3] + ax * dt;
+    double vy = x_[4] + ay * dt;
+    double vz = x_[5] + az * dt;
+
+    x_[0] = px;
+    x_[1] = py;
+    x_[2] = pz;
+    x_[3] = vx;
+    x_[4] = vy;
+    x_[5] = vz;
+
+    /* P = F P F' + Q dt */
+    if (cov_ == ekf_covariance::joseph) {
+        const double F[3][3] = {{1, dt, -0.5 * dt * dt}, {0, 1, -dt}, {0, 0, 1}};
+        sym_propagate(axes_, F, q_axes_, dt);
+    } else {
+        double FPFt[81];
+        fpft_reference(P_, dt, FPFt);
+        for (int i = 0; i < 81; i++) {
+            P_[i] = FPFt[i] + (i % 10 == 0 ? p_.q[i / 10] : 0) * dt;
+        }
+    }
+
+    if (stationary_frames_ >= p_.zupt_frames_required) {
+        step_.zupt_speed = std::sqrt(vx * vx + vy * vy + vz * vz);
+        step_.zupt = cov_ == ekf_covariance::joseph ? apply_zupt_joseph() : apply_zupt();
+    }
+
+    apply_high_pass_filter(dt);
+    return position();
+}
+
+bool ekf_tracker::apply_zupt()
+{
+    /* Measure v = 0: innovation -v, H selects the velocity rows */
+    double innov[3] = {0 - x_[3], 0 - x_[4], 0 - x_[5]};
+    double R = p_.zupt_velocity_noise;
+    double S[3][3], Sinv[3][3], K[9][3];
+
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+            S[r][c] = r == c ? P_[(3 + r) * 9 + 3 + c] + R : P_[(3 + r) * 9 + 3 + c];
+        }
+    }
+    if (!invert3x3(S, Sinv)) {
+        return false;
+    }
+
+    /* K = P H' S^-1 */
+    for (int i = 0; i < 9; i++) {
+        const double *row = &P_[i * 9 + 3];
+        for (int c = 0; c < 3; c++) {
+            K[i][c] = row[0] * Sinv[0][c] + row[1] * Sinv[1][c] + row[2] * Sinv[2][c];
+        }
+    }
+
+    for (int i = 0; i < 9; i++) {
+        x_[i] = x_[i] + (K[i][0] * innov[0] + K[i][1] * innov[1] + K[i][2] * innov[2]);
+    }
+
+    /* P = (I - K H) P, in place as the TypeScript does it: rows 3-5 are
+     * already updated when later rows read them */
+    for (int i = 0; i < 9; i++) {
+        for (int j = 0; j < 9; j++) {
+            double sum = 0;
+            for (int k = 0; k < 3; k++) {
+                sum += K[i][k] * P_[(3 + k) * 9 + j];
+            }
+            P_[i * 9 + j] = P_[i * 9 + j] - sum;
+        }
+    }
+    return true;
+}
+
+/*
+ * The same measurement per axis: off-axis covariance is zero, so S is
+ * diagonal and each velocity is a scalar measurement of its own chain
+ */
+bool ekf_tracker::apply_zupt_joseph()
+{
+    ekf_vec4 r = ekf_vec4{} + p_.zupt_velocity_noise;
+    ekf_vec4 s = axes_(1, 1) + r;
+
+    if (std::fabs(s[0] * (s[1] * s[2])) < EKF_SINGULAR_DET) {
+        return false;
+    }
+
+    ekf_vec4 x[3];
+    for (int i = 0; i < 3; i++) {
+        x[i] = ekf_vec4{x_[i * 3], x_[i * 3 + 1], x_[i * 3 + 2], 0};
+    }
+    sym_joseph_update(axes_, x, 1, 0 - x[1], r, s);
+    for (int i = 0; i < 3; i++) {
+        for (int a = 0; a < 3; a++) {
+            x_[i * 3 + a] = x[i][a];
+        }
+    }
+    return true;
+}
+
+void ekf_tracker::update_magnetometer(const vec3 &mag)
+{
+    if (!have_quat_) {
+        return;
+    }
+
+    double heading = magnetic_heading(mag, last_quat_);
+    if (!have_reference_) {
+        reference_heading_ = heading;
+        have_reference_ = true;
+        return;
+    }
+
+    double error = normalize_angle(heading - reference_heading_);
+    double vx = x_[3];
+    double vz = x_[5];
+    if (std::sqrt(vx * vx + vz * vz) < EKF_HEADING_SPEED) {
+        return;
+    }
+
+    /* Rotate the horizontal velocity by a fraction of the heading error */
+    double correction = p_.heading_correction_gain * error;
+    double c = std::cos(correction);
+    double s = std::sin(correction);
+
+    x_[3] = vx * c - vz * s;
+    x_[5] = vx * s + vz * c;
+}
+
+void ekf_tracker::apply_high_pass_filter(double dt)
+{
+    double dx = x_[0] - prev_raw_.x;
+    double dy = x_[1] - prev_raw_.y;
+    double dz = x_[2] - prev_raw_.z;
+
+    prev_raw_ = {x_[0], x_[1], x_[2]};
+
+    /* Decay fast toward the origin when still, slowly when moving */
+    bool moving = std::sqrt(dx * dx + dy * dy + dz * dz) > EKF_MOVING_DELTA;
+    double target = moving ? p_.hpf_cutoff_moving : p_.hpf_cutoff_stationary;
+    hpf_cutoff_ += p_.hpf_transition_rate * (target - hpf_cutoff_);
+
+    double omega = 2 * EKF_PI * hpf_cutoff_;
+    double alpha = std::exp(-omega * std::fmin(dt, EKF_HPF_MAX_DT));
+
+    filtered_ = {alpha * (filtered_.x + dx), alpha * (filtered_.y + dy),
+                 alpha * (filtered_.z + dz)};
+}
+
+void ekf_tracker::covariance(double *out) const
+{
+    if (cov_ != ekf_covariance::joseph) {
+        for (int i = 0; i < 81; i++) {
+            out[i] = P_[i];
+        }
+        return;
+    }
+    for (int i = 0; i < 9; i++) {
+        for (int j = 0; j < 9; j++) {
+            out[i * 9 + j] = i % 3 == j % 3 ? axes_(i / 3, j / 3)[i % 3] : 0;
+        }
+    }
+}
+
+vec3 ekf_tracker::position() const
+{
+    return {filtered_.x * p_.position_gain, filtered_.y * p_.position_gain,
+            filtered_.z * p_.position_gain};
+}
+
+} /* namespace imurec */
@@ -0,0 +1,168 @@
+/**
+ * @file ekf.hpp
+ * @brief Native port of the web app's EKFTracker (lib/EKFTracker.ts)
+ *
+ * Same model and the same arithmetic, step for step: the state is
+ * [px, py, pz, vx, vy, vz, bax, bay, baz], predict() integrates world
+ * frame linear acceleration with ZUPT, update_magnetometer() nudges the
+ * horizontal velocity toward the reference heading, and the returned
+ * position is the high-pass filtered, gained output the app renders.
+ *
+ * Expressions are evaluated in the order the TypeScript evaluates them,
+ * including the in-place covariance update in the ZUPT step, so builds
+ * without floating-point contraction (-ffp-contract=off) reproduce the
+ * app's numbers up to the last bit of the libm functions used (exp,
+ * sin, cos, atan2). F P F' skips F's zero terms (ekf_kernels.hpp), which
+ * leaves those numbers unchanged.
+ *
+ * ekf_covariance::joseph swaps the covariance arithmetic for the
+ * symmetric per-axis kernels and a Joseph-form ZUPT: the same model,
+ * cheaper and numerically sturdier, but not the app's numbers. Besides
+ * rounding, the app's in-place update lets the bias rows of P read
+ * velocity rows it has already corrected, which Joseph form does not
+ * reproduce, so positions drift apart over a recording (ekfbench).
+ */
+
+#ifndef IMUREC_EKF_HPP
+#define IMUREC_EKF_HPP
+
+#include "ekf_kernels.hpp"
+
+#include <cstddef>
+
+namespace imurec {
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define EKF_PI              3.141592653589793       /* Math.PI */
+#define EKF_HPF_MAX_DT      0.1                     /* s */
+#define EKF_MOVING_DELTA    0.001                   /* m per step */
+#define EKF_HEADING_SPEED   0.1                     /* m/s */
+#define EKF_SINGULAR_DET    1e-10
+
+/*******************************************************************************
+ * Data Structures
+ ******************************************************************************/
+
+struct vec3 {
+    double x, y, z;
+};
+
+struct quat {
+    double w, x, y, z;
+};
+
+/**
+ * @brief EKFTracker constants, defaults as in lib/EKFTracker.ts
+ */
+struct ekf_params {
+    double   p0[9] = {0.1, 0.1, 0.1, 0.01, 0.01, 0.01, 0.01, 0.01, 0.01};
+    double   q[9] = {0.01, 0.01, 0.01, 0.5, 0.5, 0.5, 0.00001, 0.00001, 0.00001};
+    double   heading_correction_gain = 0.05;
+    double   zupt_accel_threshold = 0.5;    /* m/s^2 */
+    unsigned zupt_frames_required = 3;
+    double   zupt_velocity_noise = 0.0001;
+    double   max_dt = 1.0;                  /* s */
+    double   hpf_cutoff_stationary = 0.15;  /* Hz */
+    double   hpf_cutoff_moving = 0.01;      /* Hz */
+    double   hpf_transition_rate = 0.1;
+    double   position_gain = 8.0;
+};
+
+/**
+ * @brief Covariance arithmetic of an ekf_tracker
+ */
+enum class ekf_covariance {
+    reference,      /* EKFTracker's, bit for bit */
+    joseph,         /* Packed per-axis blocks, Joseph-form ZUPT */
+};
+
+/**
+ * @brief What the last predict() did, for tuning metrics (sweep.hpp)
+ */
+struct ekf_step {
+    bool   predicted = false;   /* dt was accepted */
+    bool   zupt = false;        /* The ZUPT update was applied */
+    double zupt_speed = 0;      /* |v| the ZUPT update started from */
+};
+
+/*******************************************************************************
+ * Tracker
+ ******************************************************************************/
+
+class ekf_tracker {
+public:
+    explicit ekf_tracker(const ekf_params &params = ekf_params(),
+                         ekf_covariance covariance = ekf_covariance::reference);
+
+    /**
+     * @brief EKFTracker.predictWithDt: one linear acceleration sample
+     * @param accel Calibrated linear acceleration, device frame
+     * @param q     Orientation at the sample (normalized)
+     * @param dt    Seconds since the previous sample
+     * @return Filtered position, as getPosition()
+     */
+    vec3 predict(const vec3 &accel, const quat &q, double dt);
+
+    /**
+     * @brief EKFTracker.updateMagnetometer
+     */
+    void update_magnetometer(const vec3 &mag);
+
+    vec3 position() const;
+    vec3 velocity() const { return {x_[3], x_[4], x_[5]}; }
+    void reset();
+
+    /* The integrated position before the high-pass filter */
+    vec3 raw_position() const { return {x_[0], x_[1], x_[2]}; }
+    const ekf_step &last_step() const { return step_; }
+
+    /* P as the row-major 9x9 EKFTracker keeps */
+    void covariance(double *out) const;
+
+private:
+    bool apply_zupt();      /* false if S is singular */
+    bool apply_zupt_joseph();
+    void apply_high_pass_filter(double dt);
+
+    ekf_params     p_;
+    ekf_covariance cov_;
+    double         x_[9];
+    double         P_[81];                  /* reference */
+    sym_matrix<3, ekf_vec4> axes_;          /* joseph: (p, v, b) per axis lane */
+    ekf_vec4       q_axes_[3];
+    quat           last_quat_;
+    bool           have_quat_;
+    double         reference_heading_;
+    bool           have_reference_;
+    unsigned       stationary_frames_;
+    double         hpf_cutoff_;
+    vec3           filtered_;
+    vec3           prev_raw_;
+    ekf_step       step_;
+};
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief three.js Vector3#applyQuaternion (r181 form)
+ */
+vec3 rotate(const vec3 &v, const quat &q);
+
+/**
+ * @brief calculateMagneticHeading: radians from +Z toward +X, 0 to 2 pi
+ */
+double magnetic_heading(const vec3 &mag, const quat &q);
+
+/**
+ * @brief normalizeAngle: wrap to [-pi, pi]
+ */
+double normalize_angle(double a);
+
+} /* namespace imurec */
+
+#endif /* IMUREC_EKF_HPP */
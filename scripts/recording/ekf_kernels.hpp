@@ -0,0 +1,236 @@
+/**
+ * @file ekf_kernels.hpp
+ * @brief Fixed-size covariance kernels for the EKF (ekf.hpp)
+ *
+ * EKFTracker propagates P with two dense 9x9 products, F P F', although
+ * F is the identity plus nine terms in three diagonal 3x3 blocks: dt and
+ * -dt^2 / 2 coupling position to velocity and bias, -dt coupling velocity to
+ * bias. Two kernel sets here exploit that:
+ *
+ * fpft_reference() computes F P F' as the dense product would, term for
+ * term in the same order, but only the terms where F is non-zero. A
+ * skipped term adds +/-0 to a sum that started at +0, so for finite P the
+ * result is the dense one bit for bit (fpft_dense() is kept as the check
+ * and the benchmark baseline). It is templated on the element type, so
+ * the sweep's SIMD lanes (sweep.hpp) run the same code as ekf_tracker.
+ *
+ * The symmetric kernels go further. P0 and Q are diagonal, and F and the
+ * ZUPT measurement act on each axis alone, so P never couples axes: it is
+ * one N x N block per axis over the chain (position, velocity, bias).
+ * sym_matrix keeps such a block in packed upper-triangular storage with
+ * the three axes as lanes of one ekf_vec4, a single 256-bit register on
+ * AVX builds. sym_propagate() applies an upper-triangular F and the
+ * diagonal Q, sym_joseph_update() a scalar measurement of one state in
+ * Joseph form, (I - K H) P (I - K H)' + K R K', which keeps P symmetric
+ * and positive semi-definite where the app's P - K H P does not. Loops run
+ * to compile-time bounds and are fully unrolled. ekfbench checks them
+ * against the app's formulas evaluated densely.
+ */
+
+#ifndef IMUREC_EKF_KERNELS_HPP
+#define IMUREC_EKF_KERNELS_HPP
+
+namespace imurec {
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/* What an ekf_vec4 operation compiles to */
+#if defined(__AVX__)
+#define EKF_KERNEL_SIMD_NAME    "avx"
+#elif defined(__SSE2__)
+#define EKF_KERNEL_SIMD_NAME    "sse2"
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define EKF_KERNEL_SIMD_NAME    "neon"
+#else
+#define EKF_KERNEL_SIMD_NAME    "scalar"
+#endif
+
+#define EKF_UNROLL              _Pragma("GCC unroll 16")
+
+/*******************************************************************************
+ * Data Structures
+ ******************************************************************************/
+
+/* x, y, z and an unused lane */
+typedef double ekf_vec4 __attribute__((vector_size(4 * sizeof(double))));
+
+/**
+ * @brief Symmetric N x N matrix, upper triangle packed row by row
+ */
+template <unsigned N, class T>
+struct sym_matrix {
+    static constexpr unsigned size = N * (N + 1) / 2;
+
+    T v[size];
+
+    static constexpr unsigned index(unsigned i, unsigned j)
+    {
+        return i <= j ? i * N - i * (i - 1) / 2 + (j - i) : index(j, i);
+    }
+
+    T &operator()(unsigned i, unsigned j) { return v[index(i, j)]; }
+    const T &operator()(unsigned i, unsigned j) const { return v[index(i, j)]; }
+};
+
+/*******************************************************************************
+ * Reference Kernels
+ ******************************************************************************/
+
+/**
+ * @brief out = F P F' for EKFTracker's F, as Matrix9.multiply computes it
+ *
+ * Row-major 9x9. F is the identity plus, for i < 3, dt at (i, i + 3),
+ * -dt^2 / 2 at (i, i + 6) and -dt at (i + 3, i + 6).
+ */
+template <class T>
+void fpft_dense(const T *P, double dt, T *out)
+{
+    double F[81] = {};
+    T FP[81];
+
+    for (int i = 0; i < 9; i++) {
+        F[i * 9 + i] = 1;
+    }
+    for (int i = 0; i < 3; i++) {
+        F[i * 9 + i + 3] = dt;
+        F[i * 9 + i + 6] = -0.5 * dt * dt;
+        F[(i + 3) * 9 + i + 6] = -dt;
+    }
+
+    for (int i = 0; i < 9; i++) {
+        for (int j = 0; j < 9; j++) {
+            T sum = T();
+            for (int k = 0; k < 9; k++) {
+                sum += F[i * 9 + k] * P[k * 9 + j];
+            }
+            FP[i * 9 + j] = sum;
+        }
+    }
+    for (int i = 0; i < 9; i++) {
+        for (int j = 0; j < 9; j++) {
+            T sum = T();
+            for (int k = 0; k < 9; k++) {
+                sum += FP[i * 9 + k] * F[j * 9 + k];
+            }
+            out[i * 9 + j] = sum;
+        }
+    }
+}
+
+/**
+ * @brief fpft_dense() without the zero terms: the same bits for finite P
+ */
+template <class T>
+void fpft_reference(const T *P, double dt, T *out)
+{
+    const double a = dt;                /* F(i, i + 3), i < 3 */
+    const double c = -0.5 * dt * dt;    /* F(i, i + 6) */
+    const double e = -dt;               /* F(i, i + 3), 3 <= i < 6 */
+    T FP[81];
+
+    /* Sums start at +0 as in the dense product, so -0 entries come out +0 */
+    EKF_UNROLL
+    for (int j = 0; j < 9; j++) {
+        EKF_UNROLL
+        for (int i = 0; i < 3; i++) {
+            FP[i * 9 + j] = T() + P[i * 9 + j] + a * P[(i + 3) * 9 + j] +
+                            c * P[(i + 6) * 9 + j];
+            FP[(i + 3) * 9 + j] = T() + P[(i + 3) * 9 + j] + e * P[(i + 6) * 9 + j];
+            FP[(i + 6) * 9 + j] = T() + P[(i + 6) * 9 + j];
+        }
+    }
+
+    EKF_UNROLL
+    for (int i = 0; i < 9; i++) {
+        const T *r = &FP[i * 9];
+        T *o = &out[i * 9];
+        EKF_UNROLL
+        for (int j = 0; j < 3; j++) {
+            o[j] = T() + r[j] + r[j + 3] * a + r[j + 6] * c;
+            o[j + 3] = T() + r[j + 3] + r[j + 6] * e;
+            o[j + 6] = T() + r[j + 6];
+        }
+    }
+}
+
+/*******************************************************************************
+ * Symmetric Kernels
+ ******************************************************************************/
+
+/**
+ * @brief P = F P F' + diag(q) dt, F upper triangular with a unit diagonal
+ *
+ * F is shared by every lane; only its strict upper triangle is read.
+ */
+template <unsigned N, class T>
+void sym_propagate(sym_matrix<N, T> &P, const double (&F)[N][N], const T *q, double dt)
+{
+    T FP[N][N];
+
+    /* (F P)(i, j) = P(i, j) + sum over k > i of F(i, k) P(k, j) */
+    EKF_UNROLL
+    for (unsigned i = 0; i < N; i++) {
+        EKF_UNROLL
+        for (unsigned j = 0; j < N; j++) {
+            T sum = P(i, j);
+            EKF_UNROLL
+            for (unsigned k = i + 1; k < N; k++) {
+                sum += F[i][k] * P(k, j);
+            }
+            FP[i][j] = sum;
+        }
+    }
+
+    /* (F P F')(i, j) for j >= i: FP(i, j) + sum over l > j of FP(i, l) F(j, l) */
+    EKF_UNROLL
+    for (unsigned i = 0; i < N; i++) {
+        EKF_UNROLL
+        for (unsigned j = i; j < N; j++) {
+            T sum = FP[i][j];
+            EKF_UNROLL
+            for (unsigned l = j + 1; l < N; l++) {
+                sum += FP[i][l] * F[j][l];
+            }
+            P(i, j) = i == j ? sum + q[i] * dt : sum;
+        }
+    }
+}
+
+/**
+ * @brief Measure state m with noise r, innovation innov, in Joseph form
+ * @param s P(m, m) + r, computed by the caller (it checks it first)
+ *
+ * K = P(:, m) / s, x += K innov, P = (I - K H) P (I - K H)' + r K K'.
+ */
+template <unsigned N, class T>
+void sym_joseph_update(sym_matrix<N, T> &P, T *x, unsigned m, const T &innov, const T &r, const T &s)
+{
+    T inv = 1 / s;
+    T K[N], Pm[N], APm[N];
+
+    EKF_UNROLL
+    for (unsigned i = 0; i < N; i++) {
+        Pm[i] = P(i, m);
+        K[i] = Pm[i] * inv;
+    }
+    EKF_UNROLL
+    for (unsigned i = 0; i < N; i++) {
+        x[i] += K[i] * innov;
+        APm[i] = Pm[i] - K[i] * Pm[m];      /* ((I - K H) P)(i, m) */
+    }
+
+    /* ((I - K H) P)(i, j) - ((I - K H) P)(i, m) K(j) + r K(i) K(j) */
+    EKF_UNROLL
+    for (unsigned i = 0; i < N; i++) {
+        EKF_UNROLL
+        for (unsigned j = i; j < N; j++) {
+            P(i, j) = P(i, j) - K[i] * Pm[j] - APm[i] * K[j] + r * K[i] * K[j];
+        }
+    }
+}
+
+} /* namespace imurec */
+
+#endif /* IMUREC_EKF_KERNELS_HPP */
@@ -0,0 +1,1462 @@
+/**
+ * @file imurec.cpp
+ * @brief Columnar IMU recordings: JSON conversion, .imurec writer and reader
+ */
+
+#include "imurec.hpp"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#ifdef IMUREC_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace imurec {
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+namespace {
+
+#define MS_PER_DAY      86400000LL
+#define IMUREC_COPY_BLOCK   (1u << 20)
+
+bool fail(std::string *err, const char *what)
+{
+    if (err) {
+        *err = what;
+    }
+    return false;
+}
+
+#ifdef IMUREC_HAVE_ZLIB
+class deflate_codec : public codec {
+public:
+    const char *name() const override { return "deflate"; }
+
+    bool compress(const uint8_t *in, size_t len, std::vector<uint8_t> &out) const override
+    {
+        uLongf dest_len = compressBound((uLong)len);
+        out.resize(dest_len);
+        if (compress2(out.data(), &dest_len, in, (uLong)len, 6) != Z_OK) {
+            return false;
+        }
+        out.resize(dest_len);
+        return true;
+    }
+
+    bool decompress(const uint8_t *in, size_t len, uint8_t *out, size_t raw_len) const override
+    {
+        uLongf dest_len = (uLongf)raw_len;
+        return uncompress(out, &dest_len, in, (uLong)len) == Z_OK && dest_len == raw_len;
+    }
+};
+#endif
+
+struct codec_registry {
+    const codec *codecs[IMUREC_CODEC_MAX + 1] = {};
+
+    codec_registry()
+    {
+#ifdef IMUREC_HAVE_ZLIB
+        static const deflate_codec s_deflate;
+        codecs[IMUREC_CODEC_DEFLATE] = &s_deflate;
+#endif
+    }
+};
+
+codec_registry &registry()
+{
+    static codec_registry s_registry;
+    return s_registry;
+}
+
+/*******************************************************************************
+ * Private Functions: Text Formatting
+ ******************************************************************************/
+
+/* Number.prototype.toFixed: the exact value rounded to `digits`
+ * decimals, ties away from zero. Integer arithmetic covers the messages;
+ * beyond that printf rounds ties to even, so exact ties are handled
+ * separately; x * 10^digits is exact in long double there. */
+void append_fixed(std::string &out, double x, int digits)
+{
+    char buf[400];
+
+    if (!std::isfinite(x) || std::fabs(x) >= 1e21) {
+        if (std::isnan(x)) {
+            out += "NaN";
+        } else if (std::isinf(x)) {
+            out += x < 0 ? "-Infinity" : "Infinity";
+        } else {
+            json::append_number(out, x);
+        }
+        return;
+    }
+
+    /* -0 is not below zero, so it formats as "0.00" */
+    if (x < 0) {
+        out += '-';
+    }
+    x = std::fabs(x);
+
+    /* Exact in 128-bit integers: below 2^53, x = m * 2^(e - 53) with a
+     * 53-bit m and e <= 53, and m * 10^20 < 2^120 */
+    if (digits <= 20 && x < 9007199254740992.0) {
+        int e;
+        double m = std::frexp(x, &e);
+        unsigned __int128 n = (unsigned __int128)(uint64_t)std::ldexp(m, 53);
+        unsigned __int128 pow10 = 1;
+        int shift = 53 - e;
+
+        for (int i = 0; i < digits; i++) {
+            pow10 *= 10;
+        }
+        n *= pow10;
+        if (shift == 0) {
+            /* Integer already */
+        } else if (shift < 128) {
+            unsigned __int128 half = (unsigned __int128)1 << (shift - 1);
+            n = (n + half) >> shift;                    /* Ties up */
+        } else {
+            n = 0;
+        }
+
+        char digs[48];
+        int k = 0;
+        do {
+            digs[k++] = (char)('0' + (int)(n % 10));
+            n /= 10;
+        } while (n != 0 || k <= digits);
+        while (k > digits) {
+            out += digs[--k];
+        }
+        if (digits > 0) {
+            out += '.';
+            while (k > 0) {
+                out += digs[--k];
+            }
+        }
+        return;
+    }
+
+    long double y = (long double)x * std::pow(10.0L, digits);
+    long double whole = std::floor(y);
+    if (y - whole == 0.5L) {
+        std::snprintf(buf, sizeof(buf), "%.0Lf", whole + 1);
+        size_t n = std::strlen(buf);
+        if (digits == 0) {
+            out += buf;
+            return;
+        }
+        /* Re-insert the decimal point into the scaled integer */
+        std::string s(buf, n);
+        if (s.size() <= (size_t)digits) {
+            s.insert(0, (size_t)digits + 1 - s.size(), '0');
+        }
+        s.insert(s.size() - (size_t)digits, 1, '.');
+        out += s;
+        return;
+    }
+
+    std::snprintf(buf, sizeof(buf), "%.*f", digits, x);
+    out += buf;
+}
+
+/* Days since 1970-01-01 <-> civil date (proleptic Gregorian) */
+int64_t days_from_civil(int64_t y, unsigned m, unsigned d)
+{
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned)(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int64_t)doe - 719468;
+}
+
+void civil_from_days(int64_t z, int64_t &y, unsigned &m, unsigned &d)
+{
+    z += 719468;
+    const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = (unsigned)(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = (int64_t)yoe + era * 400 + (m <= 2);
+}
+
+bool digits(std::string_view s, size_t pos, size_t n, unsigned &out)
+{
+    out = 0;
+    for (size_t i = pos; i < pos + n; i++) {
+        if (s[i] < '0' || s[i] > '9') {
+            return false;
+        }
+        out = out * 10 + (unsigned)(s[i] - '0');
+    }
+    return true;
+}
+
+/*******************************************************************************
+ * Private Functions: JSON -> recording
+ ******************************************************************************/
+
+bool is_number(const json::value *v)
+{
+    return v && v->is_number() && std::isfinite(v->n);
+}
+
+bool has_numbers(const json::value *v, const char *const *names, unsigned count)
+{
+    if (!v || !v->is_object()) {
+        return false;
+    }
+    for (unsigned i = 0; i < count; i++) {
+        if (!is_number(v->find(names[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int type_index(const std::string &s)
+{
+    for (unsigned t = 0; t < 3; t++) {
+        if (s == type_name(t)) {
+            return (int)t;
+        }
+    }
+    return -1;
+}
+
+/* Same acceptance rule as isIMURecordingV1 for one event */
+bool valid_event(const json::value &e, int &type)
+{
+    static const char *const k_quat[] = {"w", "x", "y", "z"};
+    static const char *const k_vec[] = {"x", "y", "z"};
+
+    if (!e.is_object()) {
+        return false;
+    }
+    const json::value *t = e.find("type");
+    const json::value *ts = e.find("timestamp");
+    const json::value *msg = e.find("message");
+    if (!is_number(e.find("tMs")) || !ts || !ts->is_string() || !t || !t->is_string() ||
+        !msg || !msg->is_string()) {
+        return false;
+    }
+    type = type_index(t->s);
+    if (type < 0) {
+        return false;
+    }
+
+    const json::value *q = e.find("quaternion");
+    const json::value *a = e.find("linearAccel");
+    const json::value *m = e.find("magnetometer");
+    return (!q || has_numbers(q, k_quat, 4)) && (!a || has_numbers(a, k_vec, 3)) &&
+           (!m || has_numbers(m, k_vec, 3));
+}
+
+/* Stream of an event that the columns reproduce exactly, -1 otherwise */
+int column_stream(const json::value &e)
+{
+    static const char *const k_head[] = {"tMs", "timestamp", "type", "message"};
+
+    if (e.o.size() < 4 || e.o.size() > 5) {
+        return -1;
+    }
+    for (unsigned i = 0; i < 4; i++) {
+        if (e.o[i].first != k_head[i]) {
+            return -1;
+        }
+    }
+    if (e.o.size() == 4) {
+        return IMUREC_STREAM_LOG;
+    }
+
+    for (unsigned s = 1; s < IMUREC_STREAM_COUNT; s++) {
+        const stream_desc &d = stream_info(s);
+        const json::value &v = e.o[4].second;
+        if (e.o[4].first != d.key) {
+            continue;
+        }
+        if (v.o.size() != d.components) {
+            return -1;
+        }
+        for (unsigned c = 0; c < d.components; c++) {
+            if (v.o[c].first != d.names[c]) {
+                return -1;
+            }
+        }
+        return (int)s;
+    }
+    return -1;
+}
+
+uint32_t add_string(recording &rec, std::string s)
+{
+    rec.strings.push_back(std::move(s));
+    return (uint32_t)rec.strings.size();   /* index + 1 */
+}
+
+/*******************************************************************************
+ * Private Functions: Chunk Encoding
+ ******************************************************************************/
+
+struct chunk_writer {
+    const recording &rec;
+    std::vector<uint8_t> body;
+    std::vector<uint8_t> col;
+    std::vector<uint32_t> local;        /* Global string -> local index + 1 */
+    std::vector<uint32_t> local_stamp;  /* Chunk that set local[] */
+    std::vector<uint32_t> chunk_strings;
+    uint32_t chunk_no = 0;
+
+    explicit chunk_writer(const recording &r)
+        : rec(r), local(r.strings.size(), 0), local_stamp(r.strings.size(), UINT32_MAX) {}
+
+    uint32_t local_id(uint32_t global)
+    {
+        if (local_stamp[global] != chunk_no) {
+            local_stamp[global] = chunk_no;
+            chunk_strings.push_back(global);
+            local[global] = (uint32_t)chunk_strings.size() - 1;
+        }
+        return local[global];
+    }
+
+    void put_column(const std::vector<uint8_t> &c)
+    {
+        put_u32(body, (uint32_t)c.size());
+        body.insert(body.end(), c.begin(), c.end());
+    }
+
+    static uint8_t pick_encoding(const double *v, size_t n, unsigned q)
+    {
+        bool q16 = true, q32 = true, f32 = true;
+
+        for (size_t i = 0; i < n && (q16 || q32 || f32); i++) {
+            double y = std::ldexp(v[i], (int)q);
+            bool integral = (y == std::floor(y)) && std::ldexp(y, -(int)q) == v[i];
+            q16 = q16 && integral && y >= -32768.0 && y <= 32767.0;
+            q32 = q32 && integral && y >= -2147483648.0 && y <= 2147483647.0;
+            f32 = f32 && (double)(float)v[i] == v[i];
+        }
+        return q16 ? IMUREC_ENC_Q16 : q32 ? IMUREC_ENC_Q32 : f32 ? IMUREC_ENC_F32 : IMUREC_ENC_F64;
+    }
+
+    void put_values(const double *v, size_t n, unsigned q, uint8_t enc)
+    {
+        for (size_t i = 0; i < n; i++) {
+            switch (enc) {
+            case IMUREC_ENC_Q16:
+                put_u16(body, (uint16_t)(int16_t)std::ldexp(v[i], (int)q));
+                break;
+            case IMUREC_ENC_Q32:
+                put_u32(body, (uint32_t)(int32_t)std::ldexp(v[i], (int)q));
+                break;
+            case IMUREC_ENC_F32: {
+                float f = (float)v[i];
+                uint32_t bits;
+                std::memcpy(&bits, &f, sizeof(bits));
+                put_u32(body, bits);
+                break;
+            }
+            default:
+                put_f64(body, v[i]);
+                break;
+            }
+        }
+    }
+
+    /* Rows [row0, row0 + rows) of stream s; returns min/max tMs */
+    void put_stream(unsigned s, size_t row0, size_t rows, double &t_min, double &t_max)
+    {
+        const stream_data &sd = rec.streams[s];
+        const stream_desc &d = stream_info(s);
+
+        put_u32(body, (uint32_t)rows);
+        if (rows == 0) {
+            return;
+        }
+
+        /* tMs */
+        col.clear();
+        int64_t prev = 0;
+        for (size_t r = row0; r < row0 + rows; r++) {
+            double t = sd.t_ms[r];
+            bool exact = std::fabs(t) < 1e12;
+            int64_t q = exact ? std::llround(t * IMUREC_TMS_SCALE) : 0;
+
+            exact = exact && (double)q / IMUREC_TMS_SCALE == t;
+            if (exact) {
+                put_varint(col, zigzag(q - prev) << 1);
+                prev = q;
+            } else {
+                put_varint(col, 1);
+                put_f64(col, t);
+            }
+            if (!(t >= t_min)) t_min = t;
+            if (!(t <= t_max)) t_max = t;
+        }
+        put_column(col);
+
+        /* ISO timestamp */
+        col.clear();
+        prev = 0;
+        for (size_t r = row0; r < row0 + rows; r++) {
+            if (sd.timestamp[r] != 0) {
+                put_varint(col, 1);
+                put_varint(col, local_id(sd.timestamp[r] - 1));
+            } else {
+                put_varint(col, zigzag(sd.wall_ms[r] - prev) << 1);
+                prev = sd.wall_ms[r];
+            }
+        }
+        put_column(col);
+
+        /* Message */
+        col.clear();
+        for (size_t r = row0; r < row0 + rows; r++) {
+            uint32_t m = sd.message[r];
+            put_varint(col, m == 0 ? 0 : local_id(m - 1) + 1);
+        }
+        put_column(col);
+
+        /* Values */
+        uint8_t enc[4];
+        for (unsigned c = 0; c < d.components; c++) {
+            enc[c] = pick_encoding(&sd.v[c][row0], rows, d.q);
+            body.push_back(enc[c]);
+        }
+        for (unsigned c = 0; c < d.components; c++) {
+            put_values(&sd.v[c][row0], rows, d.q, enc[c]);
+        }
+    }
+};
+
+/*******************************************************************************
+ * Private Functions: Chunk Decoding
+ ******************************************************************************/
+
+bool get_column(cursor &cur, cursor &col)
+{
+    uint32_t len = cur.u32();
+    const uint8_t *p = cur.take(len);
+    if (!p && len != 0) {
+        return false;
+    }
+    col = cursor(p, len);
+    return cur.ok;
+}
+
+bool decode_chunk(const uint8_t *data, size_t len, uint32_t event_count,
+                  recording &rec, std::string *err)
+{
+    cursor cur(data, len);
+    size_t rows_expected[IMUREC_STREAM_COUNT] = {};
+    size_t raw_expected = 0;
+    const uint32_t base = (uint32_t)rec.strings.size();
+    uint64_t max_local = 0;
+    bool any_local = false;
+
+    const uint8_t *kinds = cur.take(event_count);
+    if (!kinds) {
+        return fail(err, "chunk truncated (kinds)");
+    }
+    for (uint32_t i = 0; i < event_count; i++) {
+        unsigned kind = kinds[i] & IMUREC_KIND_MASK;
+        if (kind > IMUREC_KIND_RAW || (kinds[i] >> IMUREC_TYPE_SHIFT) > IMUREC_TYPE_ERROR) {
+            return fail(err, "invalid event kind");
+        }
+        if (kind == IMUREC_KIND_RAW) {
+            raw_expected++;
+        } else {
+            rows_expected[kind]++;
+        }
+    }
+    rec.kinds.insert(rec.kinds.end(), kinds, kinds + event_count);
+
+    for (unsigned s = 0; s < IMUREC_STREAM_COUNT; s++) {
+        stream_data &sd = rec.streams[s];
+        const stream_desc &d = stream_info(s);
+        uint32_t rows = cur.u32();
+        cursor tms(nullptr, 0), wall(nullptr, 0), msg(nullptr, 0);
+
+        if (!cur.ok || rows != rows_expected[s]) {
+            return fail(err, "stream row count does not match event kinds");
+        }
+        if (rows == 0) {
+            continue;
+        }
+        if (!get_column(cur, tms) || !get_column(cur, wall) || !get_column(cur, msg)) {
+            return fail(err, "chunk truncated (time columns)");
+        }
+
+        int64_t prev_t = 0;
+        int64_t prev_wall = 0;
+        for (uint32_t r = 0; r < rows; r++) {
+            uint64_t tok = tms.varint();
+            if (tok & 1) {
+                sd.t_ms.push_back(tms.f64());
+            } else {
+                prev_t += unzigzag(tok >> 1);
+                sd.t_ms.push_back((double)prev_t / IMUREC_TMS_SCALE);
+            }
+
+            tok = wall.varint();
+            if (tok & 1) {
+                uint64_t id = wall.varint();
+                max_local = id > max_local ? id : max_local;
+                any_local = true;
+                sd.wall_ms.push_back(0);
+                sd.timestamp.push_back(base + (uint32_t)id + 1);
+            } else {
+                prev_wall += unzigzag(tok >> 1);
+                sd.wall_ms.push_back(prev_wall);
+                sd.timestamp.push_back(0);
+            }
+
+            uint64_t m = msg.varint();
+            if (m != 0) {
+                max_local = (m - 1) > max_local ? (m - 1) : max_local;
+                any_local = true;
+                sd.message.push_back(base + (uint32_t)m);
+            } else if (s == IMUREC_STREAM_LOG) {
+                return fail(err, "log event without a message");
+            } else {
+                sd.message.push_back(0);
+            }
+        }
+        if (!tms.ok || !wall.ok || !msg.ok) {
+            return fail(err, "corrupt time or message column");
+        }
+
+        uint8_t enc[4];
+        for (unsigned c = 0; c < d.components; c++) {
+            enc[c] = cur.u8();
+            if (enc[c] > IMUREC_ENC_F64) {
+                return fail(err, "invalid value encoding");
+            }
+        }
+        for (unsigned c = 0; c < d.components; c++) {
+            static const size_t k_width[] = {2, 4, 4, 8};
+            const uint8_t *p = cur.take((size_t)rows * k_width[enc[c]]);
+            if (!p) {
+                return fail(err, "chunk truncated (values)");
+            }
+            std::vector<double> &out = sd.v[c];
+            size_t at = out.size();
+            out.resize(at + rows);
+            for (uint32_t r = 0; r < rows; r++) {
+                switch (enc[c]) {
+                case IMUREC_ENC_Q16:
+                    out[at + r] = std::ldexp((double)(int16_t)get_u16(p + 2 * r), -(int)d.q);
+                    break;
+                case IMUREC_ENC_Q32:
+                    out[at + r] = std::ldexp((double)(int32_t)get_u32(p + 4 * r), -(int)d.q);
+                    break;
+                case IMUREC_ENC_F32: {
+                    uint32_t bits = get_u32(p + 4 * r);
+                    float f;
+                    std::memcpy(&f, &bits, sizeof(f));
+                    out[at + r] = f;
+                    break;
+                }
+                default:
+                    out[at + r] = get_f64(p + 8 * r);
+                    break;
+                }
+            }
+        }
+    }
+
+    uint32_t raw_count = cur.u32();
+    if (!cur.ok || raw_count != raw_expected) {
+        return fail(err, "raw event count does not match event kinds");
+    }
+    for (uint32_t i = 0; i < raw_count; i++) {
+        uint64_t id = cur.varint();
+        max_local = id > max_local ? id : max_local;
+        any_local = true;
+        rec.raw.push_back(base + (uint32_t)id);
+    }
+
+    uint32_t string_count = cur.u32();
+    for (uint32_t i = 0; i < string_count && cur.ok; i++) {
+        uint64_t n = cur.varint();
+        const uint8_t *p = cur.take((size_t)n);
+        if (p || n == 0) {
+            rec.strings.emplace_back((const char *)p, (size_t)n);
+        }
+    }
+    if (!cur.ok) {
+        return fail(err, "chunk truncated (strings)");
+    }
+    if (any_local && max_local >= string_count) {
+        return fail(err, "string index out of range");
+    }
+    return true;
+}
+
+/*******************************************************************************
+ * Private Functions: File Assembly
+ ******************************************************************************/
+
+bool writer_codec(const write_options &opts, const codec *&cc, std::string *err)
+{
+    cc = nullptr;
+    if (opts.codec != IMUREC_CODEC_NONE) {
+        cc = find_codec(opts.codec);
+        if (!cc) {
+            return fail(err, "codec not available");
+        }
+    }
+    return true;
+}
+
+void put_file_header(std::vector<uint8_t> &out, std::string_view meta, uint32_t events_key)
+{
+    out.insert(out.end(), IMUREC_MAGIC, IMUREC_MAGIC + 8);
+    put_u16(out, IMUREC_VERSION);
+    put_u16(out, (uint16_t)events_key);
+    put_u32(out, (uint32_t)meta.size());
+    out.insert(out.end(), meta.begin(), meta.end());
+}
+
+/*
+ * Append all events of rec to out as chunks. `base` is the file offset of
+ * out[0] and `first_event` the index of rec's first event in the file;
+ * index entries are appended to index.
+ */
+void put_chunks(const recording &rec, const write_options &opts, const codec *cc,
+                uint64_t base, uint64_t first_event, std::vector<uint8_t> &out,
+                std::vector<uint8_t> &index, uint32_t &chunk_count)
+{
+    chunk_writer cw(rec);
+    std::vector<uint8_t> packed;
+    size_t rows[IMUREC_STREAM_COUNT] = {};
+    size_t raw = 0;
+    uint32_t chunk_events = opts.chunk_events ? opts.chunk_events : IMUREC_DEFAULT_CHUNK_EVENTS;
+
+    for (size_t e0 = 0; e0 < rec.kinds.size(); e0 += chunk_events, cw.chunk_no++) {
+        size_t e1 = e0 + chunk_events < rec.kinds.size() ? e0 + chunk_events : rec.kinds.size();
+        size_t count[IMUREC_STREAM_COUNT + 1] = {};
+        double t_min = NAN, t_max = NAN;
+
+        for (size_t e = e0; e < e1; e++) {
+            count[rec.kinds[e] & IMUREC_KIND_MASK]++;
+        }
+
+        cw.body.clear();
+        cw.chunk_strings.clear();
+        cw.body.insert(cw.body.end(), rec.kinds.begin() + (long)e0, rec.kinds.begin() + (long)e1);
+        for (unsigned s = 0; s < IMUREC_STREAM_COUNT; s++) {
+            cw.put_stream(s, rows[s], count[s], t_min, t_max);
+            rows[s] += count[s];
+        }
+
+        put_u32(cw.body, (uint32_t)count[IMUREC_KIND_RAW]);
+        for (size_t i = 0; i < count[IMUREC_KIND_RAW]; i++) {
+            put_varint(cw.body, cw.local_id(rec.raw[raw++]));
+        }
+
+        put_u32(cw.body, (uint32_t)cw.chunk_strings.size());
+        for (uint32_t g : cw.chunk_strings) {
+            const std::string &s = rec.strings[g];
+            put_varint(cw.body, s.size());
+            cw.body.insert(cw.body.end(), s.begin(), s.end());
+        }
+
+        /* Keep the body uncompressed if the codec does not help */
+        const std::vector<uint8_t> *stored = &cw.body;
+        uint8_t used = IMUREC_CODEC_NONE;
+        if (cc && cc->compress(cw.body.data(), cw.body.size(), packed) &&
+            packed.size() < cw.body.size()) {
+            stored = &packed;
+            used = opts.codec;
+        }
+
+        uint64_t offset = base + out.size();
+        out.insert(out.end(), IMUREC_CHUNK_MAGIC, IMUREC_CHUNK_MAGIC + 4);
+        out.push_back(used);
+        out.push_back(0);
+        out.push_back(0);
+        out.push_back(0);
+        put_u32(out, (uint32_t)stored->size());
+        put_u32(out, (uint32_t)cw.body.size());
+        put_u32(out, (uint32_t)(e1 - e0));
+        out.insert(out.end(), stored->begin(), stored->end());
+
+        put_u64(index, offset);
+        put_u32(index, (uint32_t)(IMUREC_CHUNK_HEADER_SIZE + stored->size()));
+        put_u32(index, (uint32_t)(e1 - e0));
+        put_u64(index, first_event + e0);
+        put_f64(index, t_min);
+        put_f64(index, t_max);
+        chunk_count++;
+    }
+}
+
+/* Index and footer; the index starts at file offset index_offset */
+void put_index(std::vector<uint8_t> &out, uint64_t index_offset,
+               const std::vector<uint8_t> &index, uint32_t chunk_count)
+{
+    out.insert(out.end(), index.begin(), index.end());
+    put_u64(out, index_offset);
+    put_u32(out, chunk_count);
+    out.insert(out.end(), IMUREC_FOOTER_MAGIC, IMUREC_FOOTER_MAGIC + 4);
+}
+
+/*******************************************************************************
+ * Private Functions: recording -> JSON
+ ******************************************************************************/
+
+void append_event(const recording &rec, unsigned kind, unsigned type, size_t row,
+                  std::string &out, std::string &tmp)
+{
+    const stream_data &sd = rec.streams[kind];
+    const stream_desc &d = stream_info(kind);
+
+    out += '{';
+    json::append_indent(out, 3);
+    out += "\"tMs\": ";
+    json::append_number(out, sd.t_ms[row]);
+    out += ',';
+    json::append_indent(out, 3);
+    out += "\"timestamp\": ";
+    if (sd.timestamp[row] != 0) {
+        json::append_string(out, rec.strings[sd.timestamp[row] - 1]);
+    } else {
+        tmp.clear();
+        format_iso(sd.wall_ms[row], tmp);
+        json::append_string(out, tmp);
+    }
+    out += ',';
+    json::append_indent(out, 3);
+    out += "\"type\": \"";
+    out += type_name(type);
+    out += "\",";
+    json::append_indent(out, 3);
+    out += "\"message\": ";
+    if (sd.message[row] != 0) {
+        json::append_string(out, rec.strings[sd.message[row] - 1]);
+    } else {
+        double v[4];
+        for (unsigned c = 0; c < d.components; c++) {
+            v[c] = sd.v[c][row];
+        }
+        tmp.clear();
+        format_message(kind, v, tmp);
+        json::append_string(out, tmp);
+    }
+
+    if (d.components > 0) {
+        out += ',';
+        json::append_indent(out, 3);
+        out += '"';
+        out += d.key;
+        out += "\": {";
+        for (unsigned c = 0; c < d.components; c++) {
+            if (c > 0) {
+                out += ',';
+            }
+            json::append_indent(out, 4);
+            out += '"';
+            out += d.names[c];
+            out += "\": ";
+            json::append_number(out, sd.v[c][row]);
+        }
+        json::append_indent(out, 3);
+        out += '}';
+    }
+
+    json::append_indent(out, 2);
+    out += '}';
+}
+
+} /* namespace */
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+void stream_data::clear()
+{
+    t_ms.clear();
+    wall_ms.clear();
+    timestamp.clear();
+    message.clear();
+    for (auto &c : v) {
+        c.clear();
+    }
+}
+
+void recording::clear()
+{
+    meta.clear();
+    events_key = 0;
+    kinds.clear();
+    for (auto &s : streams) {
+        s.clear();
+    }
+    raw.clear();
+    strings.clear();
+}
+
+void register_codec(uint8_t id, const codec *c)
+{
+    if (id != IMUREC_CODEC_NONE && id <= IMUREC_CODEC_MAX) {
+        registry().codecs[id] = c;
+    }
+}
+
+const codec *find_codec(uint8_t id)
+{
+    return id <= IMUREC_CODEC_MAX ? registry().codecs[id] : nullptr;
+}
+
+void format_message(unsigned stream, const double *v, std::string &out)
+{
+    const stream_desc &d = stream_info(stream);
+
+    out += d.prefix;
+    for (unsigned c = 0; c < d.components; c++) {
+        if (c > 0) {
+            out += ' ';
+        }
+        out += d.names[c];
+        out += '=';
+        append_fixed(out, v[c], d.decimals);
+    }
+    out += d.suffix;
+}
+
+void format_iso(int64_t epoch_ms, std::string &out)
+{
+    int64_t days = epoch_ms >= 0 ? epoch_ms / MS_PER_DAY : -((-epoch_ms + MS_PER_DAY - 1) / MS_PER_DAY);
+    int64_t ms = epoch_ms - days * MS_PER_DAY;
+    int64_t y;
+    unsigned m, d;
+    char buf[40];
+
+    civil_from_days(days, y, m, d);
+    std::snprintf(buf, sizeof(buf), "%04lld-%02u-%02uT%02u:%02u:%02u.%03uZ",
+                  (long long)y, m, d, (unsigned)(ms / 3600000), (unsigned)(ms / 60000 % 60),
+                  (unsigned)(ms / 1000 % 60), (unsigned)(ms % 1000));
+    out += buf;
+}
+
+bool parse_iso(std::string_view s, int64_t &epoch_ms)
+{
+    unsigned y, mo, d, h, mi, sec, ms;
+
+    if (s.size() != 24 || s[4] != '-' || s[7] != '-' || s[10] != 'T' || s[13] != ':' ||
+        s[16] != ':' || s[19] != '.' || s[23] != 'Z') {
+        return false;
+    }
+    if (!digits(s, 0, 4, y) || !digits(s, 5, 2, mo) || !digits(s, 8, 2, d) ||
+        !digits(s, 11, 2, h) || !digits(s, 14, 2, mi) || !digits(s, 17, 2, sec) ||
+        !digits(s, 20, 3, ms)) {
+        return false;
+    }
+    if (mo < 1 || mo > 12 || d < 1 || d > 31 || h > 23 || mi > 59 || sec > 59) {
+        return false;
+    }
+
+    epoch_ms = days_from_civil(y, mo, d) * MS_PER_DAY +
+               (int64_t)h * 3600000 + (int64_t)mi * 60000 + (int64_t)sec * 1000 + ms;
+
+    /* Reject dates that do not exist (Feb 30) by formatting them back */
+    std::string check;
+    format_iso(epoch_ms, check);
+    return check == s;
+}
+
+bool from_json(const json::value &doc, recording &rec, std::string *err)
+{
+    const json::value *events = nullptr;
+    json::value meta;
+
+    rec.clear();
+
+    if (!doc.is_object()) {
+        return fail(err, "not a JSON object");
+    }
+    const json::value *version = doc.find("schemaVersion");
+    const json::value *recorded = doc.find("recordedAt");
+    if (!version || !version->is_number() || version->n != 1) {
+        return fail(err, "unsupported schemaVersion (expected 1)");
+    }
+    if (!recorded || !recorded->is_string()) {
+        return fail(err, "recordedAt missing");
+    }
+
+    meta.k = json::kind::object;
+    for (size_t i = 0; i < doc.o.size(); i++) {
+        if (doc.o[i].first == "events") {
+            if (events) {
+                return fail(err, "duplicate events key");
+            }
+            events = &doc.o[i].second;
+            rec.events_key = (uint32_t)i;
+        } else {
+            meta.o.push_back(doc.o[i]);
+        }
+    }
+    if (!events || !events->is_array()) {
+        return fail(err, "events missing");
+    }
+    json::stringify_compact(meta, rec.meta);
+
+    rec.kinds.reserve(events->a.size());
+    for (const json::value &e : events->a) {
+        if (!add_event(e, rec, err)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool add_event(const json::value &e, recording &rec, std::string *err)
+{
+    int type;
+
+    if (!valid_event(e, type)) {
+        return fail(err, "invalid event (not an IMURecordingV1 event)");
+    }
+
+    int s = column_stream(e);
+    if (s < 0) {
+        std::string text;
+        json::stringify_compact(e, text);
+        rec.raw.push_back(add_string(rec, std::move(text)) - 1);
+        rec.kinds.push_back((uint8_t)(IMUREC_KIND_RAW | (type << IMUREC_TYPE_SHIFT)));
+        return true;
+    }
+
+    stream_data &sd = rec.streams[s];
+    const stream_desc &d = stream_info((unsigned)s);
+    const std::string &ts = e.o[1].second.s;
+    const std::string &msg = e.o[3].second.s;
+    int64_t wall;
+    double v[4];
+
+    rec.kinds.push_back((uint8_t)(s | (type << IMUREC_TYPE_SHIFT)));
+    sd.t_ms.push_back(e.o[0].second.n);
+
+    if (parse_iso(ts, wall)) {
+        sd.wall_ms.push_back(wall);
+        sd.timestamp.push_back(0);
+    } else {
+        sd.wall_ms.push_back(0);
+        sd.timestamp.push_back(add_string(rec, ts));
+    }
+
+    for (unsigned c = 0; c < d.components; c++) {
+        v[c] = e.o[4].second.o[c].second.n;
+        sd.v[c].push_back(v[c]);
+    }
+
+    if (s == IMUREC_STREAM_LOG) {
+        sd.message.push_back(add_string(rec, msg));
+    } else {
+        /* Most data messages are the derived template; compare in place */
+        thread_local std::string tmp;
+        tmp.clear();
+        format_message((unsigned)s, v, tmp);
+        sd.message.push_back(tmp == msg ? 0 : add_string(rec, msg));
+    }
+    return true;
+}
+
+bool from_json_text(std::string_view text, recording &out, std::string *err)
+{
+    json::value doc;
+
+    if (!json::parse(text, doc, err)) {
+        return false;
+    }
+    return from_json(doc, out, err);
+}
+
+bool to_json(const recording &rec, std::string &out, std::string *err)
+{
+    json::value meta;
+    size_t rows[IMUREC_STREAM_COUNT] = {};
+    size_t raw = 0;
+    std::string tmp;
+
+    if (!json::parse(rec.meta, meta, err)) {
+        return false;
+    }
+    if (!meta.is_object() || rec.events_key > meta.o.size()) {
+        return fail(err, "invalid recording metadata");
+    }
+
+    out += '{';
+    for (size_t i = 0; i <= meta.o.size(); i++) {
+        if (i == rec.events_key) {
+            if (i > 0) {
+                out += ',';
+            }
+            json::append_indent(out, 1);
+            out += "\"events\": ";
+            if (rec.kinds.empty()) {
+                out += "[]";
+            } else {
+                out += '[';
+                for (size_t e = 0; e < rec.kinds.size(); e++) {
+                    unsigned kind = rec.kinds[e] & IMUREC_KIND_MASK;
+                    unsigned type = rec.kinds[e] >> IMUREC_TYPE_SHIFT;
+
+                    if (e > 0) {
+                        out += ',';
+                    }
+                    json::append_indent(out, 2);
+                    if (kind == IMUREC_KIND_RAW) {
+                        json::value ev;
+                        if (!json::parse(rec.strings[rec.raw[raw++]], ev, err)) {
+                            return false;
+                        }
+                        json::stringify(ev, out, 2);
+                    } else {
+                        append_event(rec, kind, type, rows[kind]++, out, tmp);
+                    }
+                }
+                json::append_indent(out, 1);
+                out += ']';
+            }
+        }
+        if (i < meta.o.size()) {
+            if (i > 0 || rec.events_key == 0) {
+                out += ',';
+            }
+            json::append_indent(out, 1);
+            json::append_string(out, meta.o[i].first);
+            out += ": ";
+            json::stringify(meta.o[i].second, out, 1);
+        }
+    }
+    json::append_indent(out, 0);
+    out += '}';
+    return true;
+}
+
+bool write(const recording &rec, const write_options &opts,
+           std::vector<uint8_t> &out, std::string *err)
+{
+    const codec *cc = nullptr;
+    std::vector<uint8_t> index;
+    uint32_t chunk_count = 0;
+
+    if (!writer_codec(opts, cc, err)) {
+        return false;
+    }
+
+    out.clear();
+    put_file_header(out, rec.meta, rec.events_key);
+    put_chunks(rec, opts, cc, 0, 0, out, index, chunk_count);
+    put_index(out, out.size(), index, chunk_count);
+    return true;
+}
+
+bool read(const uint8_t *data, size_t len, recording &rec, std::string *err)
+{
+    std::vector<uint8_t> body;
+
+    rec.clear();
+
+    if (len < IMUREC_FILE_HEADER_SIZE + IMUREC_FOOTER_SIZE ||
+        std::memcmp(data, IMUREC_MAGIC, 8) != 0) {
+        return fail(err, "not an .imurec file");
+    }
+    if (get_u16(data + 8) != IMUREC_VERSION) {
+        return fail(err, "unsupported .imurec version");
+    }
+    rec.events_key = get_u16(data + 10);
+    uint32_t meta_len = get_u32(data + 12);
+    if (meta_len > len - IMUREC_FILE_HEADER_SIZE - IMUREC_FOOTER_SIZE) {
+        return fail(err, "metadata truncated");
+    }
+    rec.meta.assign((const char *)data + IMUREC_FILE_HEADER_SIZE, meta_len);
+
+    const uint8_t *footer = data + len - IMUREC_FOOTER_SIZE;
+    if (std::memcmp(footer + 12, IMUREC_FOOTER_MAGIC, 4) != 0) {
+        return fail(err, "footer missing (file truncated?)");
+    }
+    uint64_t index_offset = get_u64(footer);
+    uint32_t chunk_count = get_u32(footer + 8);
+    if (index_offset > len - IMUREC_FOOTER_SIZE ||
+        (uint64_t)chunk_count * IMUREC_INDEX_ENTRY_SIZE != len - IMUREC_FOOTER_SIZE - index_offset) {
+        return fail(err, "corrupt chunk index");
+    }
+
+    for (uint32_t c = 0; c < chunk_count; c++) {
+        const uint8_t *entry = data + index_offset + (size_t)c * IMUREC_INDEX_ENTRY_SIZE;
+        uint64_t offset = get_u64(entry);
+        uint32_t size = get_u32(entry + 8);
+
+        if (offset > index_offset || size < IMUREC_CHUNK_HEADER_SIZE || size > index_offset - offset) {
+            return fail(err, "chunk outside the file");
+        }
+        const uint8_t *hdr = data + offset;
+        uint8_t codec_id = hdr[4];
+        uint32_t stored_len = get_u32(hdr + 8);
+        uint32_t raw_len = get_u32(hdr + 12);
+        uint32_t event_count = get_u32(hdr + 16);
+        const uint8_t *stored = hdr + IMUREC_CHUNK_HEADER_SIZE;
+
+        if (std::memcmp(hdr, IMUREC_CHUNK_MAGIC, 4) != 0 ||
+            stored_len != size - IMUREC_CHUNK_HEADER_SIZE || event_count != get_u32(entry + 12)) {
+            return fail(err, "corrupt chunk header");
+        }
+
+        if (codec_id == IMUREC_CODEC_NONE) {
+            if (raw_len != stored_len) {
+                return fail(err, "corrupt chunk header");
+            }
+            if (!decode_chunk(stored, stored_len, event_count, rec, err)) {
+                return false;
+            }
+        } else {
+            const codec *cc = find_codec(codec_id);
+            if (!cc) {
+                return fail(err, "chunk uses a codec that is not available");
+            }
+            body.resize(raw_len);
+            if (!cc->decompress(stored, stored_len, body.data(), raw_len)) {
+                return fail(err, "chunk decompression failed");
+            }
+            if (!decode_chunk(body.data(), raw_len, event_count, rec, err)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+file_writer::~file_writer()
+{
+    if (file_) {
+        std::fclose(file_);
+    }
+}
+
+bool file_writer::open(const char *path, std::string_view meta, uint32_t events_key,
+                       const write_options &opts, std::string *err)
+{
+    std::vector<uint8_t> header;
+
+    if (file_) {
+        return fail(err, "writer already open");
+    }
+    if (!writer_codec(opts, codec_, err)) {
+        return false;
+    }
+    file_ = std::fopen(path, "wb");
+    if (!file_) {
+        if (err) {
+            *err = std::string(path) + ": " + std::strerror(errno);
+        }
+        return false;
+    }
+    path_ = path;
+    opts_ = opts;
+    meta_.assign(meta.data(), meta.size());
+    events_key_ = events_key;
+    meta_changed_ = false;
+    pending_.clear();
+    index_.clear();
+    chunk_count_ = 0;
+    events_written_ = 0;
+
+    put_file_header(header, meta, events_key);
+    offset_ = header.size();
+    chunks_start_ = offset_;
+    return put(header, err);
+}
+
+void file_writer::set_meta(std::string_view meta, uint32_t events_key)
+{
+    if (meta != meta_ || events_key != events_key_) {
+        meta_.assign(meta.data(), meta.size());
+        events_key_ = events_key;
+        meta_changed_ = true;
+    }
+}
+
+void file_writer::abort()
+{
+    if (file_) {
+        std::fclose(file_);
+        file_ = nullptr;
+        std::remove(path_.c_str());
+    }
+    pending_.clear();
+}
+
+bool file_writer::put(const std::vector<uint8_t> &bytes, std::string *err)
+{
+    if (std::fwrite(bytes.data(), 1, bytes.size(), file_) != bytes.size()) {
+        return fail(err, "write failed");
+    }
+    return true;
+}
+
+bool file_writer::flush(std::string *err)
+{
+    if (!file_) {
+        return fail(err, "writer not open");
+    }
+    if (pending_.event_count() == 0) {
+        return true;
+    }
+
+    buffer_.clear();
+    put_chunks(pending_, opts_, codec_, offset_, events_written_, buffer_, index_, chunk_count_);
+    events_written_ += pending_.event_count();
+    offset_ += buffer_.size();
+    pending_.clear();
+    return put(buffer_, err);
+}
+
+bool file_writer::finish(std::string *err)
+{
+    if (!flush(err)) {
+        return false;
+    }
+
+    buffer_.clear();
+    put_index(buffer_, offset_, index_, chunk_count_);
+    offset_ += buffer_.size();
+    bool ok = put(buffer_, err);
+    ok = (std::fclose(file_) == 0) && ok;
+    file_ = nullptr;
+    if (!ok) {
+        return fail(err, "write failed");
+    }
+    return !meta_changed_ || rewrite_meta(err);
+}
+
+/*
+ * The header was written with the metadata known at open(). Copy the
+ * file behind a new header, shifting the index offsets, and replace it;
+ * this streams, so it works for files of any size.
+ */
+bool file_writer::rewrite_meta(std::string *err)
+{
+    const std::string tmp_path = path_ + ".tmp";
+    const uint64_t index_offset = offset_ - index_.size() - IMUREC_FOOTER_SIZE;
+    std::vector<uint8_t> head, index = index_;
+    FILE *in = std::fopen(path_.c_str(), "rb");
+    FILE *out = in ? std::fopen(tmp_path.c_str(), "wb") : nullptr;
+    bool ok = in && out;
+
+    put_file_header(head, meta_, events_key_);
+    const int64_t shift = (int64_t)head.size() - (int64_t)chunks_start_;
+    for (size_t i = 0; i < index.size(); i += IMUREC_INDEX_ENTRY_SIZE) {
+        uint64_t offset = get_u64(&index[i]) + (uint64_t)shift;
+        for (int b = 0; b < 8; b++) {
+            index[i + (size_t)b] = (uint8_t)(offset >> (8 * b));
+        }
+    }
+
+    ok = ok && std::fwrite(head.data(), 1, head.size(), out) == head.size();
+    ok = ok && std::fseek(in, (long)chunks_start_, SEEK_SET) == 0;
+    buffer_.resize(IMUREC_COPY_BLOCK);
+    for (uint64_t left = index_offset - chunks_start_; ok && left > 0;) {
+        size_t n = left < buffer_.size() ? (size_t)left : buffer_.size();
+        ok = std::fread(buffer_.data(), 1, n, in) == n &&
+             std::fwrite(buffer_.data(), 1, n, out) == n;
+        left -= n;
+    }
+    head.clear();
+    put_index(head, index_offset + (uint64_t)shift, index, chunk_count_);
+    ok = ok && std::fwrite(head.data(), 1, head.size(), out) == head.size();
+
+    if (in) {
+        std::fclose(in);
+    }
+    if (out) {
+        ok = (std::fclose(out) == 0) && ok;
+    }
+    ok = ok && std::rename(tmp_path.c_str(), path_.c_str()) == 0;
+    if (!ok) {
+        std::remove(tmp_path.c_str());
+        return fail(err, "rewriting the header failed");
+    }
+    offset_ += (uint64_t)shift;
+    meta_changed_ = false;
+    return true;
+}
+
+bool ingest_json(json::stream_reader::source src, const char *out_path,
+                 const write_options &opts, ingest_stats *stats, std::string *err)
+{
+    uint64_t bytes_in = 0;
+    json::stream_reader r([&src, &bytes_in](char *buf, size_t len) {
+        size_t n = src(buf, len);
+        bytes_in += n;
+        return n;
+    });
+    const uint32_t chunk_events = opts.chunk_events ? opts.chunk_events : IMUREC_DEFAULT_CHUNK_EVENTS;
+    file_writer fw;
+    json::value meta, event;
+    std::string key, meta_text;
+    uint32_t key_no = 0;
+    uint32_t events_key = 0;
+    bool have_events = false;
+
+    auto abort = [&fw, err](const std::string &what) {
+        fw.abort();
+        if (err) {
+            *err = what;
+        }
+        return false;
+    };
+
+    /* One pass: metadata members are small and parsed whole; events are
+     * parsed, checked and appended one at a time, and written out every
+     * chunk_events */
+    meta.k = json::kind::object;
+    if (!r.enter_object()) {
+        return abort("not a JSON object");
+    }
+    while (r.next_key(key)) {
+        if (key != "events") {
+            meta.o.emplace_back(std::move(key), json::value());
+            key_no++;
+            if (!r.read(meta.o.back().second)) {
+                break;
+            }
+            continue;
+        }
+
+        if (have_events) {
+            return abort("duplicate events key");
+        }
+        have_events = true;
+        events_key = key_no++;
+        meta_text.clear();
+        json::stringify_compact(meta, meta_text);
+        if (!fw.open(out_path, meta_text, events_key, opts, err)) {
+            return false;
+        }
+        if (!r.enter_array()) {
+            return abort("events missing");
+        }
+        while (r.next_element() && r.read(event)) {
+            std::string why;
+            if (!add_event(event, fw.pending(), &why)) {
+                return abort(why + " (event " +
+                             std::to_string(fw.events_written() + fw.pending().event_count()) + ")");
+            }
+            if (fw.pending().event_count() >= chunk_events && !fw.flush(&why)) {
+                return abort(why);
+            }
+        }
+        if (!r.ok()) {
+            break;
+        }
+    }
+    if (!r.ok() || !r.finish()) {
+        return abort(r.error());
+    }
+
+    /* Top-level checks of isIMURecordingV1; members may follow "events" */
+    const json::value *version = meta.find("schemaVersion");
+    const json::value *recorded = meta.find("recordedAt");
+    if (!version || !version->is_number() || version->n != 1) {
+        return abort("unsupported schemaVersion (expected 1)");
+    }
+    if (!recorded || !recorded->is_string()) {
+        return abort("recordedAt missing");
+    }
+    if (!have_events) {
+        return abort("events missing");
+    }
+
+    meta_text.clear();
+    json::stringify_compact(meta, meta_text);
+    fw.set_meta(meta_text, events_key);
+    uint64_t events = fw.events_written() + fw.pending().event_count();
+    if (!fw.finish(err)) {
+        return false;
+    }
+
+    if (stats) {
+        stats->bytes_in = bytes_in;
+        stats->events = events;
+        stats->bytes_out = fw.bytes_written();
+        stats->peak_buffer = r.peak_buffer();
+    }
+    return true;
+}
+
+bool ingest_json_file(const char *in_path, const char *out_path, const write_options &opts,
+                      ingest_stats *stats, std::string *err)
+{
+    FILE *f = std::fopen(in_path, "rb");
+
+    if (!f) {
+        if (err) {
+            *err = std::string(in_path) + ": " + std::strerror(errno);
+        }
+        return false;
+    }
+    bool ok = ingest_json([f](char *buf, size_t len) { return std::fread(buf, 1, len, f); },
+                          out_path, opts, stats, err);
+    std::fclose(f);
+    return ok;
+}
+
+bool read_file(const char *path, std::vector<uint8_t> &out, std::string *err)
+{
+    FILE *f = std::fopen(path, "rb");
+    long size;
+
+    if (!f) {
+        if (err) {
+            *err = std::string(path) + ": " + std::strerror(errno);
+        }
+        return false;
+    }
+    std::fseek(f, 0, SEEK_END);
+    size = std::ftell(f);
+    std::fseek(f, 0, SEEK_SET);
+
+    out.resize(size > 0 ? (size_t)size : 0);
+    bool ok = out.empty() || std::fread(out.data(), 1, out.size(), f) == out.size();
+    std::fclose(f);
+    if (!ok && err) {
+        *err = std::string(path) + ": read failed";
+    }
+    return ok;
+}
+
+bool write_file(const char *path, const void *data, size_t len, std::string *err)
+{
+    FILE *f = std::fopen(path, "wb");
+
+    if (!f) {
+        if (err) {
+            *err = std::string(path) + ": " + std::strerror(errno);
+        }
+        return false;
+    }
+    bool ok = std::fwrite(data, 1, len, f) == len;
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok && err) {
+        *err = std::string(path) + ": write failed";
+    }
+    return ok;
+}
+
+} /* namespace imurec */
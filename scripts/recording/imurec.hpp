@@ -0,0 +1,232 @@
+/**
+ * @file imurec.hpp
+ * @brief Columnar IMU recordings: JSON conversion, .imurec writer and reader
+ *
+ * `recording` is the in-memory form of an IMURecordingV1 export with the
+ * events split into per-stream columns (layout: imurec_format.hpp). It
+ * converts losslessly in both directions:
+ *
+ *   JSON  -> from_json() -> recording -> write() -> .imurec
+ *   .imurec -> read()    -> recording -> to_json() -> JSON
+ *
+ * to_json() writes JSON.stringify(recording, null, 2), the format the web
+ * app downloads, so an export survives the round trip byte for byte. An
+ * event the columns cannot represent exactly (extra members, several
+ * vectors, unusual key order) is kept verbatim as a raw event.
+ */
+
+#ifndef IMUREC_HPP
+#define IMUREC_HPP
+
+#include "imurec_format.hpp"
+#include "json.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace imurec {
+
+/*******************************************************************************
+ * Data Structures
+ ******************************************************************************/
+
+/**
+ * @brief Rows of one stream, in event order
+ *
+ * `timestamp` and `message` are 0 when the value is implied (formatted
+ * from wall_ms, or from the sample values as the web app does), otherwise
+ * the index of the literal in recording::strings, plus one.
+ */
+struct stream_data {
+    std::vector<double>   t_ms;         /* tMs */
+    std::vector<int64_t>  wall_ms;      /* ISO timestamp as epoch ms */
+    std::vector<uint32_t> timestamp;    /* 0 = from wall_ms, else string + 1 */
+    std::vector<uint32_t> message;      /* 0 = derived, else string + 1 */
+    std::vector<double>   v[4];         /* Components, stream_info() order */
+
+    size_t size() const { return t_ms.size(); }
+    void clear();
+};
+
+/**
+ * @brief One recording, columnar
+ */
+struct recording {
+    std::string              meta;          /* Top-level object minus "events" */
+    uint32_t                 events_key = 0; /* Position of "events" in it */
+    std::vector<uint8_t>     kinds;         /* Per event: stream | type << 3 */
+    stream_data              streams[IMUREC_STREAM_COUNT];
+    std::vector<uint32_t>    raw;           /* String index per raw event */
+    std::vector<std::string> strings;       /* Literal strings */
+
+    size_t event_count() const { return kinds.size(); }
+    void clear();
+};
+
+/**
+ * @brief Per-chunk compression hook
+ *
+ * Register an implementation under a codec id to have the writer use it
+ * and the reader accept it. decompress() must produce exactly raw_len
+ * bytes.
+ */
+class codec {
+public:
+    virtual ~codec() = default;
+    virtual const char *name() const = 0;
+    virtual bool compress(const uint8_t *in, size_t len, std::vector<uint8_t> &out) const = 0;
+    virtual bool decompress(const uint8_t *in, size_t len, uint8_t *out, size_t raw_len) const = 0;
+};
+
+struct ingest_stats {
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+    uint64_t events = 0;
+    size_t   peak_buffer = 0;   /* Largest JSON read buffer */
+};
+
+struct write_options {
+    uint32_t chunk_events = IMUREC_DEFAULT_CHUNK_EVENTS;
+    uint8_t  codec = IMUREC_CODEC_NONE;
+};
+
+/**
+ * @brief Incremental .imurec writer, for recordings larger than memory
+ *
+ * Append events to pending() and call flush() every chunk or so: each
+ * flush writes the pending events as chunks and empties pending(), string
+ * table included. finish() adds the chunk index and footer; a file that
+ * was never finished has no footer (mapped_recording still opens it).
+ *
+ * Metadata goes into the file header at open(). If set_meta() changes it
+ * later (top-level keys after "events"), finish() rewrites the file once
+ * with the new header.
+ */
+class file_writer {
+public:
+    file_writer() = default;
+    file_writer(const file_writer &) = delete;
+    file_writer &operator=(const file_writer &) = delete;
+    ~file_writer();
+
+    bool open(const char *path, std::string_view meta, uint32_t events_key,
+              const write_options &opts, std::string *err);
+    recording &pending() { return pending_; }
+    void set_meta(std::string_view meta, uint32_t events_key);
+    bool flush(std::string *err);
+    bool finish(std::string *err);
+
+    /* Close and delete the partial file */
+    void abort();
+
+    uint64_t events_written() const { return events_written_; }
+    uint64_t bytes_written() const { return offset_; }
+
+private:
+    bool put(const std::vector<uint8_t> &bytes, std::string *err);
+    bool rewrite_meta(std::string *err);
+
+    FILE                *file_ = nullptr;
+    std::string          path_;
+    const codec         *codec_ = nullptr;
+    write_options        opts_;
+    std::string          meta_;
+    uint32_t             events_key_ = 0;
+    bool                 meta_changed_ = false;
+    recording            pending_;
+    std::vector<uint8_t> buffer_;
+    std::vector<uint8_t> index_;
+    uint32_t             chunk_count_ = 0;
+    uint64_t             events_written_ = 0;
+    uint64_t             offset_ = 0;
+    uint64_t             chunks_start_ = 0;
+};
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Register a codec (nullptr removes it); id 0 is always "none"
+ */
+void register_codec(uint8_t id, const codec *c);
+
+/**
+ * @brief Registered codec, nullptr if none
+ */
+const codec *find_codec(uint8_t id);
+
+/**
+ * @brief Convert a parsed IMURecordingV1 document
+ * @return false if it is not a schemaVersion 1 recording (same checks as
+ *         isIMURecordingV1 in lib/recording.ts)
+ */
+bool from_json(const json::value &doc, recording &out, std::string *err);
+
+/**
+ * @brief Append one parsed event (an element of "events") to rec
+ * @return false if it fails the isIMURecordingV1 event checks
+ */
+bool add_event(const json::value &event, recording &rec, std::string *err);
+
+/**
+ * @brief Parse and convert IMURecordingV1 JSON text
+ */
+bool from_json_text(std::string_view text, recording &out, std::string *err);
+
+/**
+ * @brief Append the recording as JSON.stringify(recording, null, 2)
+ */
+bool to_json(const recording &rec, std::string &out, std::string *err);
+
+/**
+ * @brief Serialize to .imurec
+ */
+bool write(const recording &rec, const write_options &opts,
+           std::vector<uint8_t> &out, std::string *err);
+
+/**
+ * @brief Parse a whole .imurec image
+ */
+bool read(const uint8_t *data, size_t len, recording &out, std::string *err);
+
+/**
+ * @brief Convert IMURecordingV1 JSON to a .imurec file in one streaming pass
+ *
+ * Applies the same checks as from_json() (isIMURecordingV1) while
+ * parsing, without building the document: memory is one chunk of events
+ * plus the largest single event or metadata member, whatever the input
+ * size. Produces the same file as from_json() + write(). On failure the
+ * partial output is deleted.
+ */
+bool ingest_json(json::stream_reader::source src, const char *out_path,
+                 const write_options &opts, ingest_stats *stats, std::string *err);
+bool ingest_json_file(const char *in_path, const char *out_path, const write_options &opts,
+                      ingest_stats *stats, std::string *err);
+
+/**
+ * @brief The message the web app logs for a sample (Q/A/M templates)
+ */
+void format_message(unsigned stream, const double *v, std::string &out);
+
+/**
+ * @brief Date#toISOString() for epoch milliseconds
+ */
+void format_iso(int64_t epoch_ms, std::string &out);
+
+/**
+ * @brief Parse the Date#toISOString() form "YYYY-MM-DDTHH:MM:SS.sssZ"
+ * @return false for anything format_iso() would not produce
+ */
+bool parse_iso(std::string_view s, int64_t &epoch_ms);
+
+bool read_file(const char *path, std::vector<uint8_t> &out, std::string *err);
+bool write_file(const char *path, const void *data, size_t len, std::string *err);
+
+} /* namespace imurec */
+
+#endif /* IMUREC_HPP */
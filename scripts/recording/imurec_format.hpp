@@ -0,0 +1,297 @@
+/**
+ * @file imurec_format.hpp
+ * @brief On-disk layout of .imurec, the binary columnar IMU recording
+ *
+ * A .imurec file holds the same information as an IMURecordingV1 JSON
+ * export (lib/recording.ts), split into chunks of events stored column by
+ * column. All integers are little-endian. The web app can also download
+ * its recording in this form directly (lib/recorder.ts).
+ *
+ *   file header     IMUREC_FILE_HEADER_SIZE bytes
+ *     magic[8]          "IMUREC\r\n"
+ *     u16 version       IMUREC_VERSION
+ *     u16 events_key    Position of "events" among the top-level keys
+ *     u32 meta_len
+ *   meta            meta_len bytes: the top-level JSON object without
+ *                   "events" (recordedAt, deviceName, calibration, ...),
+ *                   compact JSON, key order preserved
+ *   chunk 0..n-1    see below
+ *   chunk index     chunk_count entries of IMUREC_INDEX_ENTRY_SIZE bytes
+ *   footer          IMUREC_FOOTER_SIZE bytes
+ *     u64 index_offset
+ *     u32 chunk_count
+ *     magic[4]          "IRIX"
+ *
+ * Chunk: a fixed header followed by the body, compressed as a whole when
+ * codec != IMUREC_CODEC_NONE.
+ *
+ *   chunk header    IMUREC_CHUNK_HEADER_SIZE bytes
+ *     magic[4]          "IRCK"
+ *     u8  codec, u8[3] reserved
+ *     u32 stored_len    Body bytes in the file
+ *     u32 raw_len       Body bytes after decompression
+ *     u32 event_count
+ *   body
+ *     kind[event_count]  u8 per event, in event order:
+ *                        bits 0-2 stream (IMUREC_STREAM_*, or IMUREC_KIND_RAW)
+ *                        bits 3-4 type (IMUREC_TYPE_*)
+ *     per stream, IMUREC_STREAM_COUNT times:
+ *       u32 rows
+ *       u32 len, tms[len]    tMs deltas (below)
+ *       u32 len, wall[len]   ISO timestamp deltas (below)
+ *       u32 len, msg[len]    varint per row: 0 = message derived from the
+ *                            values, else string index + 1
+ *       u8  enc[components]  IMUREC_ENC_* per value column
+ *       values               one fixed-width column per component
+ *     u32 raw_count, varint string index per raw event
+ *     u32 string_count, then varint length + UTF-8 bytes per string
+ *
+ * Every chunk decodes on its own: deltas restart from 0 and the string
+ * table is local.
+ *
+ * Time columns hold one token per row, token = zigzag(delta) * 2 + escape.
+ * tMs is stored in fixed point (1 / IMUREC_TMS_SCALE ms) when that
+ * reproduces the double exactly; otherwise the token is 1 and the raw
+ * double follows. The ISO "timestamp" string is stored as epoch ms when
+ * re-formatting gives back the same string; otherwise the token is 1 and
+ * a varint string index follows.
+ *
+ * Value columns are fixed point with the BNO085 report's Q point (Q14
+ * quaternion, Q8 acceleration, Q4 magnetometer, see shtp.h) when every
+ * value in the chunk is exact at that scale, otherwise float32 or
+ * float64, whichever is exact. Values read from the sensor always fit
+ * the fixed-point form; edited or resampled files still round-trip.
+ *
+ * Index entry (one per chunk, for seeking without reading chunks):
+ *   u64 offset         Chunk header position
+ *   u32 size           Header + stored body
+ *   u32 event_count
+ *   u64 first_event    Index of the chunk's first event in the recording
+ *   f64 t_first_ms     Smallest tMs in the chunk (NaN if none)
+ *   f64 t_last_ms      Largest tMs in the chunk (NaN if none)
+ */
+
+#ifndef IMUREC_FORMAT_HPP
+#define IMUREC_FORMAT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define IMUREC_MAGIC                "IMUREC\r\n"
+#define IMUREC_CHUNK_MAGIC          "IRCK"
+#define IMUREC_FOOTER_MAGIC         "IRIX"
+#define IMUREC_VERSION              1
+
+#define IMUREC_FILE_HEADER_SIZE     16
+#define IMUREC_CHUNK_HEADER_SIZE    20
+#define IMUREC_INDEX_ENTRY_SIZE     40
+#define IMUREC_FOOTER_SIZE          16
+
+/* Event streams; a row belongs to exactly one */
+#define IMUREC_STREAM_LOG           0   /* system/error/data without values */
+#define IMUREC_STREAM_QUAT          1   /* quaternion: w, x, y, z */
+#define IMUREC_STREAM_LINEAR_ACCEL  2   /* linearAccel: x, y, z */
+#define IMUREC_STREAM_MAG           3   /* magnetometer: x, y, z */
+#define IMUREC_STREAM_COUNT         4
+#define IMUREC_KIND_RAW             4   /* Event kept verbatim as JSON */
+#define IMUREC_KIND_MASK            0x07
+
+#define IMUREC_TYPE_SHIFT           3
+#define IMUREC_TYPE_SYSTEM          0
+#define IMUREC_TYPE_DATA            1
+#define IMUREC_TYPE_ERROR           2
+
+/* Value column encodings */
+#define IMUREC_ENC_Q16              0   /* int16, value * 2^q */
+#define IMUREC_ENC_Q32              1   /* int32, value * 2^q */
+#define IMUREC_ENC_F32              2
+#define IMUREC_ENC_F64              3
+
+/* Chunk codecs */
+#define IMUREC_CODEC_NONE           0
+#define IMUREC_CODEC_DEFLATE        1   /* zlib, if built with IMUREC_HAVE_ZLIB */
+#define IMUREC_CODEC_MAX            15
+
+#define IMUREC_TMS_SCALE            1000.0  /* tMs fixed point: microseconds */
+#define IMUREC_DEFAULT_CHUNK_EVENTS 8192
+
+namespace imurec {
+
+/*******************************************************************************
+ * Stream Descriptions
+ ******************************************************************************/
+
+struct stream_desc {
+    const char *key;        /* Event member name, NULL for the log stream */
+    const char *prefix;     /* Derived message, e.g. "Q: " */
+    const char *suffix;     /* Unit after the last value, e.g. " µT" */
+    uint8_t     components;
+    uint8_t     q;          /* Fixed-point fraction bits */
+    uint8_t     decimals;   /* toFixed() digits in the derived message */
+    const char *names[4];   /* Member names of the value object */
+};
+
+inline const stream_desc &stream_info(unsigned stream)
+{
+    /* Keys, message templates and Q points as the web app writes them
+     * (hooks/useBluetooth.ts) and the BNO085 reports them (shtp.h) */
+    static const stream_desc k_streams[IMUREC_STREAM_COUNT] = {
+        {nullptr,        "",    "",        0, 0,  0, {}},
+        {"quaternion",   "Q: ", "",        4, 14, 4, {"w", "x", "y", "z"}},
+        {"linearAccel",  "A: ", " m/s\xC2\xB2", 3, 8, 2, {"x", "y", "z"}},
+        {"magnetometer", "M: ", " \xC2\xB5T",   3, 4, 2, {"x", "y", "z"}},
+    };
+    return k_streams[stream];
+}
+
+inline const char *type_name(unsigned type)
+{
+    static const char *const k_types[] = {"system", "data", "error"};
+    return type < 3 ? k_types[type] : nullptr;
+}
+
+/*******************************************************************************
+ * Encoding Helpers
+ ******************************************************************************/
+
+inline void put_u16(std::vector<uint8_t> &out, uint16_t v)
+{
+    out.push_back((uint8_t)v);
+    out.push_back((uint8_t)(v >> 8));
+}
+
+inline void put_u32(std::vector<uint8_t> &out, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) {
+        out.push_back((uint8_t)(v >> (8 * i)));
+    }
+}
+
+inline void put_u64(std::vector<uint8_t> &out, uint64_t v)
+{
+    for (int i = 0; i < 8; i++) {
+        out.push_back((uint8_t)(v >> (8 * i)));
+    }
+}
+
+inline void put_f64(std::vector<uint8_t> &out, double v)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    put_u64(out, bits);
+}
+
+inline void put_varint(std::vector<uint8_t> &out, uint64_t v)
+{
+    while (v >= 0x80) {
+        out.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+inline uint64_t zigzag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+inline int64_t unzigzag(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+inline uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+inline uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+inline uint64_t get_u64(const uint8_t *p)
+{
+    return (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+inline double get_f64(const uint8_t *p)
+{
+    uint64_t bits = get_u64(p);
+    double v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+/**
+ * @brief Bounds-checked cursor over a chunk body
+ *
+ * Reads past the end set `ok` to false and return zeros, so a decoder can
+ * check once per column instead of once per byte.
+ */
+struct cursor {
+    const uint8_t *p;
+    const uint8_t *end;
+    bool           ok = true;
+
+    cursor(const uint8_t *data, size_t len) : p(data), end(data + len) {}
+
+    size_t left() const { return (size_t)(end - p); }
+
+    const uint8_t *take(size_t n)
+    {
+        if (!ok || left() < n) {
+            ok = false;
+            return nullptr;
+        }
+        const uint8_t *r = p;
+        p += n;
+        return r;
+    }
+
+    uint8_t u8()
+    {
+        const uint8_t *b = take(1);
+        return b ? b[0] : 0;
+    }
+
+    uint32_t u32()
+    {
+        const uint8_t *b = take(4);
+        return b ? get_u32(b) : 0;
+    }
+
+    double f64()
+    {
+        const uint8_t *b = take(8);
+        return b ? get_f64(b) : 0.0;
+    }
+
+    uint64_t varint()
+    {
+        uint64_t v = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            if (p >= end) {
+                break;
+            }
+            uint8_t b = *p++;
+            v |= (uint64_t)(b & 0x7F) << shift;
+            if ((b & 0x80) == 0) {
+                return v;
+            }
+        }
+        ok = false;
+        return 0;
+    }
+};
+
+} /* namespace imurec */
+
+#endif /* IMUREC_FORMAT_HPP */
@@ -0,0 +1,471 @@
+/**
+ * @file imurec_map.cpp
+ * @brief Memory-mapped random access to .imurec recordings
+ */
+
+#include "imurec_map.hpp"
+#include "imurec.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace imurec {
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+/* Linux fault-around window (fault_around_bytes) */
+#define MAP_RELEASE_ALIGN   65536
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+namespace {
+
+bool fail(std::string *err, const char *what)
+{
+    if (err) {
+        *err = what;
+    }
+    return false;
+}
+
+/* Length-prefixed column; false if it runs past the body */
+bool take_column(cursor &cur, const uint8_t *&p, uint32_t &len)
+{
+    len = cur.u32();
+    p = cur.take(len);
+    return cur.ok;
+}
+
+} /* namespace */
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+mapped_recording::~mapped_recording()
+{
+    close();
+}
+
+bool mapped_recording::open(const char *path, std::string *err)
+{
+    struct stat st;
+
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        if (err) {
+            *err = std::string(path) + ": " + std::strerror(errno);
+        }
+        return false;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return fail(err, "not an .imurec file");
+    }
+
+    void *map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        if (err) {
+            *err = std::string(path) + ": mmap: " + std::strerror(errno);
+        }
+        return false;
+    }
+    data_ = (const uint8_t *)map;
+    size_ = (size_t)st.st_size;
+
+    /* Seeks touch one chunk; read-ahead past it only costs page cache */
+    madvise(map, size_, MADV_RANDOM);
+
+    if (!load_index(err)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void mapped_recording::close()
+{
+    if (data_) {
+        munmap((void *)data_, size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    meta_ = {};
+    events_key_ = 0;
+    rebuilt_ = false;
+    index_.clear();
+    upper_.clear();
+    for (cache_slot &slot : cache_) {
+        slot = cache_slot();
+    }
+}
+
+uint64_t mapped_recording::event_count() const
+{
+    return index_.empty() ? 0 : index_.back().first_event + index_.back().event_count;
+}
+
+void mapped_recording::set_cache_chunks(size_t n)
+{
+    cache_.assign(n ? n : 1, cache_slot());
+}
+
+bool mapped_recording::load_index(std::string *err)
+{
+    if (size_ < IMUREC_FILE_HEADER_SIZE || std::memcmp(data_, IMUREC_MAGIC, 8) != 0) {
+        return fail(err, "not an .imurec file");
+    }
+    if (get_u16(data_ + 8) != IMUREC_VERSION) {
+        return fail(err, "unsupported .imurec version");
+    }
+    events_key_ = get_u16(data_ + 10);
+    uint32_t meta_len = get_u32(data_ + 12);
+    if (meta_len > size_ - IMUREC_FILE_HEADER_SIZE) {
+        return fail(err, "metadata truncated");
+    }
+    meta_ = std::string_view((const char *)data_ + IMUREC_FILE_HEADER_SIZE, meta_len);
+    const uint64_t chunks_start = IMUREC_FILE_HEADER_SIZE + (uint64_t)meta_len;
+
+    /* Footer and index as written by finish()/write() */
+    const uint8_t *footer = data_ + size_ - IMUREC_FOOTER_SIZE;
+    bool valid = size_ >= chunks_start + IMUREC_FOOTER_SIZE &&
+                 std::memcmp(footer + 12, IMUREC_FOOTER_MAGIC, 4) == 0;
+    uint64_t index_offset = valid ? get_u64(footer) : 0;
+    uint32_t count = valid ? get_u32(footer + 8) : 0;
+
+    valid = valid && index_offset >= chunks_start && index_offset <= size_ - IMUREC_FOOTER_SIZE &&
+            (uint64_t)count * IMUREC_INDEX_ENTRY_SIZE == size_ - IMUREC_FOOTER_SIZE - index_offset;
+
+    index_.clear();
+    for (uint32_t c = 0; valid && c < count; c++) {
+        const uint8_t *p = data_ + index_offset + (size_t)c * IMUREC_INDEX_ENTRY_SIZE;
+        chunk_entry e;
+
+        e.offset = get_u64(p);
+        e.size = get_u32(p + 8);
+        e.event_count = get_u32(p + 12);
+        e.first_event = get_u64(p + 16);
+        e.t_first_ms = get_f64(p + 24);
+        e.t_last_ms = get_f64(p + 32);
+        valid = e.offset >= chunks_start && e.size >= IMUREC_CHUNK_HEADER_SIZE &&
+                e.offset <= index_offset && e.size <= index_offset - e.offset;
+        index_.push_back(e);
+    }
+
+    if (!valid && !rebuild_index(err)) {
+        return false;
+    }
+
+    /* Running maximum of t_last_ms: the first chunk whose value reaches t
+     * is the first that can hold a row at or after t */
+    double upper = -INFINITY;
+    upper_.clear();
+    for (const chunk_entry &e : index_) {
+        if (e.t_last_ms > upper) {
+            upper = e.t_last_ms;
+        }
+        upper_.push_back(upper);
+    }
+    return true;
+}
+
+bool mapped_recording::rebuild_index(std::string *err)
+{
+    uint64_t offset = IMUREC_FILE_HEADER_SIZE + meta_.size();
+    uint64_t first_event = 0;
+    chunk_data scratch;
+
+    rebuilt_ = true;
+    index_.clear();
+
+    while (size_ - offset >= IMUREC_CHUNK_HEADER_SIZE) {
+        const uint8_t *hdr = data_ + offset;
+        uint64_t stored_len = get_u32(hdr + 8);
+
+        if (std::memcmp(hdr, IMUREC_CHUNK_MAGIC, 4) != 0 ||
+            stored_len > size_ - offset - IMUREC_CHUNK_HEADER_SIZE) {
+            break;
+        }
+
+        chunk_entry e = {offset, (uint32_t)(IMUREC_CHUNK_HEADER_SIZE + stored_len),
+                         get_u32(hdr + 16), first_event, NAN, NAN};
+        if (!decode((uint32_t)index_.size(), e, scratch, nullptr)) {
+            break;
+        }
+        for (const chunk_data::rows &r : scratch.streams) {
+            for (double t : r.t_ms) {
+                if (!(t >= e.t_first_ms)) e.t_first_ms = t;
+                if (!(t <= e.t_last_ms)) e.t_last_ms = t;
+            }
+        }
+
+        release(e);
+        index_.push_back(e);
+        first_event += e.event_count;
+        offset += e.size;
+    }
+
+    if (index_.empty() && offset != size_) {
+        return fail(err, "no readable chunks");
+    }
+    return true;
+}
+
+bool mapped_recording::decode(uint32_t c, const chunk_entry &e, chunk_data &out,
+                              std::string *err) const
+{
+    static const size_t k_width[] = {2, 4, 4, 8};
+    const uint8_t *hdr = data_ + e.offset;
+    uint8_t codec_id = hdr[4];
+    uint32_t stored_len = get_u32(hdr + 8);
+    uint32_t raw_len = get_u32(hdr + 12);
+    const uint8_t *body = hdr + IMUREC_CHUNK_HEADER_SIZE;
+
+    if (std::memcmp(hdr, IMUREC_CHUNK_MAGIC, 4) != 0 ||
+        stored_len != e.size - IMUREC_CHUNK_HEADER_SIZE || get_u32(hdr + 16) != e.event_count) {
+        return fail(err, "corrupt chunk header");
+    }
+
+    out.index = c;
+    out.body.clear();
+    if (codec_id != IMUREC_CODEC_NONE) {
+        const codec *cc = find_codec(codec_id);
+        if (!cc) {
+            return fail(err, "chunk uses a codec that is not available");
+        }
+        out.body.resize(raw_len);
+        if (!cc->decompress(body, stored_len, out.body.data(), raw_len)) {
+            return fail(err, "chunk decompression failed");
+        }
+        body = out.body.data();
+    } else if (raw_len != stored_len) {
+        return fail(err, "corrupt chunk header");
+    }
+
+    /* Event kinds are only needed to interleave streams (read() does
+     * that); every column below is bounds-checked on its own */
+    cursor cur(body, raw_len);
+    if (!cur.take(e.event_count) && e.event_count != 0) {
+        return fail(err, "chunk truncated (kinds)");
+    }
+
+    for (unsigned s = 0; s < IMUREC_STREAM_COUNT; s++) {
+        const stream_desc &d = stream_info(s);
+        chunk_data::rows &r = out.streams[s];
+        uint32_t rows = cur.u32();
+        const uint8_t *col;
+        uint32_t len;
+
+        r.t_ms.clear();
+        r.sorted = true;
+        if (!cur.ok || rows > e.event_count) {
+            return fail(err, "invalid stream row count");
+        }
+        if (rows == 0) {
+            continue;
+        }
+
+        /* tMs is the only column expanded; wall time and messages are
+         * skipped by length */
+        if (!take_column(cur, col, len)) {
+            return fail(err, "chunk truncated (time columns)");
+        }
+        cursor tms(col, len);
+        int64_t prev = 0;
+        r.t_ms.resize(rows);
+        double *t = r.t_ms.data();
+        double last = -INFINITY;
+        bool sorted = true;
+        for (uint32_t i = 0; i < rows; i++) {
+            uint64_t tok = tms.varint();
+            if (tok & 1) {
+                t[i] = tms.f64();
+            } else {
+                prev += unzigzag(tok >> 1);
+                t[i] = (double)prev / IMUREC_TMS_SCALE;
+            }
+            sorted &= (t[i] >= last);
+            last = t[i];
+        }
+        r.sorted = sorted;
+        if (!tms.ok || !take_column(cur, col, len) || !take_column(cur, col, len)) {
+            return fail(err, "corrupt time or message column");
+        }
+
+        uint8_t enc[4];
+        for (unsigned k = 0; k < d.components; k++) {
+            enc[k] = cur.u8();
+            if (enc[k] > IMUREC_ENC_F64) {
+                return fail(err, "invalid value encoding");
+            }
+        }
+        for (unsigned k = 0; k < d.components; k++) {
+            r.v[k].data = cur.take((size_t)rows * k_width[enc[k]]);
+            r.v[k].enc = enc[k];
+            r.v[k].q = d.q;
+            if (!r.v[k].data) {
+                return fail(err, "chunk truncated (values)");
+            }
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<const chunk_data> mapped_recording::chunk(uint32_t c, std::string *err)
+{
+    cache_slot *victim = &cache_[0];
+
+    if (c >= index_.size()) {
+        fail(err, "chunk out of range");
+        return nullptr;
+    }
+    for (cache_slot &slot : cache_) {
+        if (slot.chunk && slot.chunk->index == c) {
+            slot.used = ++clock_;
+            return slot.chunk;
+        }
+        if (slot.used < victim->used) {
+            victim = &slot;
+        }
+    }
+
+    auto data = std::make_shared<chunk_data>();
+    if (!decode(c, index_[c], *data, err)) {
+        return nullptr;
+    }
+    if (victim->chunk) {
+        release(index_[victim->chunk->index]);
+    }
+    victim->chunk = data;
+    victim->used = ++clock_;
+    return data;
+}
+
+void mapped_recording::release(const chunk_entry &e) const
+{
+    /* Drop the evicted chunk's pages from the mapping so resident memory
+     * follows the cache, not the file. The window is widened to the
+     * kernel's fault-around granule, which maps neighbouring pages along
+     * with the ones touched. The file is mapped read-only: a later access
+     * (a row_span still holding a chunk, or a cached neighbour) faults the
+     * pages back in. */
+    const uintptr_t base = (uintptr_t)data_;
+    uintptr_t begin = (base + e.offset) & ~(uintptr_t)(MAP_RELEASE_ALIGN - 1);
+    uintptr_t end = (base + e.offset + e.size + MAP_RELEASE_ALIGN - 1) &
+                    ~(uintptr_t)(MAP_RELEASE_ALIGN - 1);
+
+    begin = begin < base ? base : begin;
+    end = end > base + size_ ? base + size_ : end;
+    end &= ~(uintptr_t)(sysconf(_SC_PAGESIZE) - 1);
+    if (end > begin) {
+        madvise((void *)begin, end - begin, MADV_DONTNEED);
+    }
+}
+
+uint32_t mapped_recording::first_chunk_at(double t_ms) const
+{
+    if (std::isnan(t_ms)) {
+        return 0;
+    }
+    return (uint32_t)(std::lower_bound(upper_.begin(), upper_.end(), t_ms) - upper_.begin());
+}
+
+bool mapped_recording::seek(unsigned stream, double t_ms, row_pos &pos, std::string *err)
+{
+    const uint32_t count = chunk_count();
+
+    if (stream >= IMUREC_STREAM_COUNT) {
+        return fail(err, "invalid stream");
+    }
+
+    for (uint32_t c = first_chunk_at(t_ms); c < count; c++) {
+        /* Every row of a chunk that ends before t is before t */
+        if (index_[c].t_last_ms < t_ms) {
+            continue;
+        }
+
+        std::shared_ptr<const chunk_data> ch = chunk(c, err);
+        if (!ch) {
+            return false;
+        }
+        const std::vector<double> &t = ch->streams[stream].t_ms;
+        size_t i = 0;
+        if (ch->streams[stream].sorted) {
+            i = (size_t)(std::lower_bound(t.begin(), t.end(), t_ms) - t.begin());
+        } else {
+            while (i < t.size() && !(t[i] >= t_ms)) {
+                i++;
+            }
+        }
+        if (i < t.size()) {
+            pos.chunk = c;
+            pos.row = (uint32_t)i;
+            return true;
+        }
+    }
+
+    pos.chunk = count;
+    pos.row = 0;
+    return true;
+}
+
+bool mapped_recording::range(unsigned stream, double t0, double t1, std::vector<row_span> &out,
+                             std::string *err)
+{
+    row_pos pos;
+
+    out.clear();
+    if (!seek(stream, t0, pos, err)) {
+        return false;
+    }
+
+    for (uint32_t c = pos.chunk, row = pos.row; c < chunk_count(); c++, row = 0) {
+        /* No row of a chunk that starts at or after t1 is before t1 */
+        if (row == 0 && index_[c].t_first_ms >= t1) {
+            break;
+        }
+
+        std::shared_ptr<const chunk_data> ch = chunk(c, err);
+        if (!ch) {
+            return false;
+        }
+        const std::vector<double> &t = ch->streams[stream].t_ms;
+        size_t end = row;
+        if (ch->streams[stream].sorted) {
+            end = (size_t)(std::lower_bound(t.begin() + row, t.end(), t1) - t.begin());
+        } else {
+            while (end < t.size() && t[end] < t1) {
+                end++;
+            }
+        }
+
+        if (end > row) {
+            row_span span;
+            span.chunk = ch;
+            span.stream = stream;
+            span.begin = row;
+            span.end = (uint32_t)end;
+            out.push_back(std::move(span));
+        }
+        if (end < t.size()) {
+            break;
+        }
+    }
+    return true;
+}
+
+} /* namespace imurec */
@@ -0,0 +1,205 @@
+/**
+ * @file imurec_map.hpp
+ * @brief Memory-mapped random access to .imurec recordings
+ *
+ * mapped_recording maps a .imurec file and keeps only its chunk index in
+ * memory: one entry per chunk (IMUREC_DEFAULT_CHUNK_EVENTS events) with
+ * the chunk's tMs range. A seek binary-searches the index for the chunk,
+ * then the chunk's decoded tMs column for the row, so it touches one
+ * chunk of the file however long the recording is. Chunks are decoded on
+ * demand into a small LRU cache.
+ *
+ * Value columns are not copied: row_span reads them in place from the
+ * mapping (from the decompressed body for compressed chunks). Only the
+ * varint-coded tMs column of a chunk is expanded to doubles. Pages of a
+ * chunk leaving the cache are dropped from the mapping, so resident
+ * memory stays around cache size for files larger than RAM.
+ *
+ * Seeks assume tMs does not decrease along a stream, which holds for
+ * recordings made by the web app (tMs is performance.now() on receipt).
+ * Otherwise seek() still returns the first row, in file order, whose tMs
+ * is at or after the target.
+ *
+ * A file without a valid footer (recording cut short) still opens: the
+ * index is rebuilt by walking the chunk headers, and chunks after the
+ * first damaged one are dropped.
+ */
+
+#ifndef IMUREC_MAP_HPP
+#define IMUREC_MAP_HPP
+
+#include "imurec_format.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace imurec {
+
+/*******************************************************************************
+ * Data Structures
+ ******************************************************************************/
+
+/**
+ * @brief One chunk index entry (imurec_format.hpp)
+ */
+struct chunk_entry {
+    uint64_t offset;
+    uint32_t size;
+    uint32_t event_count;
+    uint64_t first_event;
+    double   t_first_ms;    /* NaN if the chunk has no stream rows */
+    double   t_last_ms;
+};
+
+/**
+ * @brief Fixed-width value column, read in place
+ */
+struct value_column {
+    const uint8_t *data = nullptr;
+    uint8_t        enc = IMUREC_ENC_F64;
+    uint8_t        q = 0;
+
+    double operator[](size_t i) const
+    {
+        switch (enc) {
+        case IMUREC_ENC_Q16:
+            return std::ldexp((double)(int16_t)get_u16(data + 2 * i), -(int)q);
+        case IMUREC_ENC_Q32:
+            return std::ldexp((double)(int32_t)get_u32(data + 4 * i), -(int)q);
+        case IMUREC_ENC_F32: {
+            uint32_t bits = get_u32(data + 4 * i);
+            float f;
+            std::memcpy(&f, &bits, sizeof(f));
+            return f;
+        }
+        default:
+            return get_f64(data + 8 * i);
+        }
+    }
+};
+
+/**
+ * @brief One decoded chunk
+ */
+struct chunk_data {
+    uint32_t             index = 0;
+    std::vector<uint8_t> body;      /* Decompressed body, empty if stored raw */
+
+    struct rows {
+        std::vector<double> t_ms;
+        value_column        v[4];
+        bool                sorted = true;  /* tMs non-decreasing */
+    } streams[IMUREC_STREAM_COUNT];
+};
+
+/**
+ * @brief Rows [begin, end) of one stream in one chunk
+ *
+ * Holds a reference to the chunk, so it stays valid after the chunk
+ * leaves the cache.
+ */
+struct row_span {
+    std::shared_ptr<const chunk_data> chunk;
+    unsigned stream = 0;
+    uint32_t begin = 0;
+    uint32_t end = 0;
+
+    size_t size() const { return end - begin; }
+    double t_ms(size_t i) const { return chunk->streams[stream].t_ms[begin + i]; }
+    double value(unsigned c, size_t i) const { return chunk->streams[stream].v[c][begin + i]; }
+};
+
+/**
+ * @brief A row of one stream: chunk number and row within the chunk
+ *
+ * chunk == chunk count means past the end.
+ */
+struct row_pos {
+    uint32_t chunk = 0;
+    uint32_t row = 0;
+};
+
+/*******************************************************************************
+ * Mapped Recording
+ ******************************************************************************/
+
+class mapped_recording {
+public:
+    mapped_recording() = default;
+    mapped_recording(const mapped_recording &) = delete;
+    mapped_recording &operator=(const mapped_recording &) = delete;
+    ~mapped_recording();
+
+    /**
+     * @brief Map a file and load (or rebuild) its chunk index
+     */
+    bool open(const char *path, std::string *err);
+    void close();
+
+    std::string_view meta() const { return meta_; }
+    uint32_t events_key() const { return events_key_; }
+    const std::vector<chunk_entry> &index() const { return index_; }
+    uint32_t chunk_count() const { return (uint32_t)index_.size(); }
+    uint64_t event_count() const;
+    size_t file_size() const { return size_; }
+
+    /**
+     * @brief True if the footer was missing or damaged and the index was
+     *        rebuilt from the chunk headers
+     */
+    bool index_rebuilt() const { return rebuilt_; }
+
+    /**
+     * @brief Number of decoded chunks kept (default 4, at least 1)
+     */
+    void set_cache_chunks(size_t n);
+
+    /**
+     * @brief Decode chunk c, or return it from the cache
+     */
+    std::shared_ptr<const chunk_data> chunk(uint32_t c, std::string *err);
+
+    /**
+     * @brief First row of `stream` with tMs >= t_ms
+     */
+    bool seek(unsigned stream, double t_ms, row_pos &pos, std::string *err);
+
+    /**
+     * @brief Rows of `stream` from seek(t0) up to the first row with
+     *        tMs >= t1, one span per chunk
+     */
+    bool range(unsigned stream, double t0, double t1, std::vector<row_span> &out,
+               std::string *err);
+
+private:
+    struct cache_slot {
+        std::shared_ptr<const chunk_data> chunk;
+        uint64_t                          used = 0;
+    };
+
+    bool load_index(std::string *err);
+    bool rebuild_index(std::string *err);
+    bool decode(uint32_t c, const chunk_entry &e, chunk_data &out, std::string *err) const;
+    void release(const chunk_entry &e) const;
+    uint32_t first_chunk_at(double t_ms) const;
+
+    const uint8_t           *data_ = nullptr;
+    size_t                   size_ = 0;
+    std::string_view         meta_;
+    uint32_t                 events_key_ = 0;
+    bool                     rebuilt_ = false;
+    std::vector<chunk_entry> index_;
+    std::vector<double>      upper_;            /* Running max of t_last_ms */
+    std::vector<cache_slot>  cache_ = std::vector<cache_slot>(4);
+    uint64_t                 clock_ = 0;
+};
+
+} /* namespace imurec */
+
+#endif /* IMUREC_MAP_HPP */
@@ -0,0 +1,1580 @@
+/**
+ * @file imurec_tool.cpp
+ * @brief Convert, inspect and benchmark IMU recordings
+ *
+ * Usage:
+ *   imurec encode in.json out.imurec [--deflate] [--chunk N]
+ *   imurec ingest in.json out.imurec [--deflate] [--chunk N]
+ *   imurec ingestbench in.json
+ *   imurec decode in.imurec out.json
+ *   imurec info in.imurec
+ *   imurec synth out.json|out.imurec [seconds]
+ *   imurec compare in.json
+ *   imurec seek in.imurec stream t_ms
+ *   imurec seekbench in.imurec [seeks]
+ *   imurec replay out_dir in... [--threads N] [--rate R] [--block N]
+ *                 [--covariance reference|joseph]
+ *   imurec replaybench out_dir in... [--max-threads N]
+ *   imurec replaycmp a.replay.json b.replay.json [tolerance]
+ *   imurec sweep in... --param name=v1,v2|name=lo:hi:n... [--random N]
+ *                [--seed S] [--threads N] [--sort key] [--top N] [--csv out.csv]
+ *                [--scalar] [--verify]
+ *   imurec ekfbench [steps]
+ *
+ * `synth` writes an IMURecordingV1 export like the web app produces one
+ * (200 Hz quaternion, magnetometer and linear acceleration, sensor Q
+ * points, 100 us performance.now() resolution, a calibration block), for
+ * benchmarking without a device. `compare` prints size and conversion
+ * speed of JSON against .imurec and fails unless JSON -> .imurec -> JSON
+ * gives back the input byte for byte.
+ *
+ * `ingest` converts like `encode` but streams the JSON (json::stream_reader)
+ * with memory bounded by one chunk, for archives of large exports;
+ * `ingestbench` runs both in child processes and compares speed and peak
+ * RSS.
+ *
+ * `synth` to a .imurec path streams the recording out chunk by chunk, for
+ * files larger than memory. `seek` and `seekbench` use the memory-mapped
+ * reader (imurec_map.hpp): seekbench times random seeks and 1 s range
+ * reads and reports peak RSS next to the file size.
+ *
+ * `replay` runs the web app's upload preprocessing (replay.hpp) over a
+ * batch of .json or .imurec recordings on a work-stealing pool and writes
+ * out_dir/<name>.replay.json for each. `replaybench` times the same batch
+ * at 1, 2, 4... threads and fails unless every thread count writes the
+ * same files. `replaycmp` compares two ReplaySessionV1 files number by
+ * number, e.g. a batch output against one the app produced.
+ *
+ * `sweep` replays a corpus under many EKF parameter sets (sweep.hpp):
+ * every combination of the --param values, or --random N sets drawn from
+ * their ranges. It prints the best --top sets by --sort (drift, residual,
+ * rest or peak, lowest first) with their drift and ZUPT metrics, and
+ * writes every set to --csv. --scalar runs ekf_tracker per set instead of
+ * the SIMD lanes; --verify runs both and fails unless they agree bit for
+ * bit.
+ *
+ * `replay --covariance joseph` runs the EKF on the symmetric Joseph-form
+ * kernels (ekf_kernels.hpp) instead of the app's arithmetic. `ekfbench`
+ * checks the sparse F P F' against the dense product bit for bit and the
+ * symmetric kernels against the app's formulas, times the kernels and
+ * both trackers on a synthetic walk, and reports how far the Joseph
+ * tracker's positions stray from the app's.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "imurec.hpp"
+#include "imurec_map.hpp"
+#include "replay.hpp"
+#include "sweep.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace imurec;
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+#define SYNTH_DEFAULT_SECONDS   60
+#define SYNTH_RATE_HZ           200
+#define SYNTH_EPOCH_MS          1767225600000LL     /* 2026-01-01T00:00:00Z */
+#define SYNTH_PERF_START_MS     4321.7              /* performance.now() at connect */
+#define SYNTH_SEED              0x2545F491u
+#define SYNTH_EVENTS_KEY        6                   /* "events" after calibration */
+#define SEEKBENCH_DEFAULT_SEEKS 10000
+#define REPLAYCMP_DEFAULT_TOL   1e-9                /* Relative, floor 1 */
+#define SWEEP_DEFAULT_TOP       20
+#define SWEEP_DEFAULT_SEED      1
+#define EKFBENCH_DEFAULT_STEPS  200000
+#define EKFBENCH_PHASE_STEPS    400                 /* 2 s still, 2 s walking */
+#define EKFBENCH_KERNEL_TRIALS  10000
+#define EKFBENCH_TOL            1e-9                /* Relative to the largest entry */
+
+/*******************************************************************************
+ * Private Variables
+ ******************************************************************************/
+
+static uint32_t s_rng = SYNTH_SEED;
+static double   s_quat[4];
+static double   s_mag[3];
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+static uint32_t tool_rand(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+/* Uniform in [-1, 1) */
+static double tool_noise(void)
+{
+    return (double)(int32_t)tool_rand() / 2147483648.0;
+}
+
+static double tool_time_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+/* Round to the sensor's fixed-point resolution, as the BNO085 reports it */
+static double tool_quantize(double v, unsigned q)
+{
+    return std::ldexp(std::nearbyint(std::ldexp(v, (int)q)), -(int)q);
+}
+
+static bool ends_with(const char *s, const char *suffix)
+{
+    size_t n = std::strlen(s), k = std::strlen(suffix);
+    return n >= k && std::strcmp(s + n - k, suffix) == 0;
+}
+
+static int stream_by_name(const char *name)
+{
+    if (std::strcmp(name, "log") == 0) {
+        return IMUREC_STREAM_LOG;
+    }
+    for (unsigned s = 1; s < IMUREC_STREAM_COUNT; s++) {
+        if (std::strcmp(name, stream_info(s).key) == 0) {
+            return (int)s;
+        }
+    }
+    return -1;
+}
+
+static double percentile(std::vector<double> &v, double p)
+{
+    if (v.empty()) {
+        return 0;
+    }
+    size_t k = (size_t)(p * (double)(v.size() - 1));
+    std::nth_element(v.begin(), v.begin() + (long)k, v.end());
+    return v[k];
+}
+
+static long peak_rss_kb(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+}
+
+/* Field of /proc/self/status in kB, -1 where there is none */
+static long proc_status_kb(const char *key)
+{
+    FILE *f = std::fopen("/proc/self/status", "r");
+    size_t n = std::strlen(key);
+    char line[256];
+    long kb = -1;
+
+    if (!f) {
+        return -1;
+    }
+    while (std::fgets(line, sizeof(line), f)) {
+        if (std::strncmp(line, key, n) == 0 && line[n] == ':') {
+            kb = std::strtol(line + n + 1, nullptr, 10);
+            break;
+        }
+    }
+    std::fclose(f);
+    return kb;
+}
+
+static int tool_fail(const std::string &err)
+{
+    std::fprintf(stderr, "imurec: %s\n", err.c_str());
+    return 1;
+}
+
+static void synth_log(recording &rec, unsigned type, double t_ms, int64_t wall, const char *msg)
+{
+    stream_data &sd = rec.streams[IMUREC_STREAM_LOG];
+
+    rec.kinds.push_back((uint8_t)(IMUREC_STREAM_LOG | (type << IMUREC_TYPE_SHIFT)));
+    sd.t_ms.push_back(t_ms);
+    sd.wall_ms.push_back(wall);
+    sd.timestamp.push_back(0);
+    rec.strings.emplace_back(msg);
+    sd.message.push_back((uint32_t)rec.strings.size());
+}
+
+static void synth_sample(recording &rec, unsigned s, double t_ms, int64_t wall, const double *v)
+{
+    stream_data &sd = rec.streams[s];
+
+    rec.kinds.push_back((uint8_t)(s | (IMUREC_TYPE_DATA << IMUREC_TYPE_SHIFT)));
+    sd.t_ms.push_back(t_ms);
+    sd.wall_ms.push_back(wall);
+    sd.timestamp.push_back(0);
+    sd.message.push_back(0);
+    for (unsigned c = 0; c < stream_info(s).components; c++) {
+        sd.v[c].push_back(v[c]);
+    }
+}
+
+static void synth_meta(unsigned seconds, std::string &meta)
+{
+    std::string iso_start, iso_connect, iso_end;
+
+    format_iso(SYNTH_EPOCH_MS, iso_start);
+    format_iso(SYNTH_EPOCH_MS + 1800, iso_connect);
+    format_iso(SYNTH_EPOCH_MS + 2000 + (int64_t)seconds * 1000, iso_end);
+
+    meta = "{\"schemaVersion\":1,\"recordedAt\":\"" + iso_start +
+           "\",\"deviceName\":\"QuatStream\",\"connectedAt\":\"" + iso_connect +
+           "\",\"disconnectedAt\":\"" + iso_end + "\",\"calibration\":{"
+           "\"posX\":{\"x\":1.203125,\"y\":0.08203125,\"z\":-0.0390625},"
+           "\"negX\":{\"x\":-1.1171875,\"y\":-0.046875,\"z\":0.03125},"
+           "\"posY\":{\"x\":0.0625,\"y\":1.31640625,\"z\":0.01171875},"
+           "\"negY\":{\"x\":-0.0234375,\"y\":-1.24609375,\"z\":-0.0703125},"
+           "\"posZ\":{\"x\":0.04296875,\"y\":-0.01953125,\"z\":1.1484375},"
+           "\"negZ\":{\"x\":-0.0546875,\"y\":0.02734375,\"z\":-1.2265625},"
+           "\"timestamp\":1767139200000,\"deviceName\":\"QuatStream\"}}";
+}
+
+static void synth_begin(recording &rec)
+{
+    s_rng = SYNTH_SEED;
+    s_quat[0] = 1;
+    s_quat[1] = s_quat[2] = s_quat[3] = 0;
+    s_mag[0] = 25.5;
+    s_mag[1] = -12.3;
+    s_mag[2] = 42.1;
+
+    synth_log(rec, IMUREC_TYPE_SYSTEM, 0.1, SYNTH_EPOCH_MS, "Scanning for QuatStream device...");
+    synth_log(rec, IMUREC_TYPE_SYSTEM, 1203.4, SYNTH_EPOCH_MS + 1203, "Found device: QuatStream");
+    synth_log(rec, IMUREC_TYPE_SYSTEM, 1800.2, SYNTH_EPOCH_MS + 1800,
+              "Connected to stream service (direct notify)");
+}
+
+/* Samples [n0, n1), three events each */
+static void synth_samples(recording &rec, uint64_t n0, uint64_t n1)
+{
+    for (uint64_t n = n0; n < n1; n++) {
+        /* Sensor time of the sample and the receive time the app sees:
+         * BLE jitter, then performance.now() at 100 us resolution */
+        double true_ms = 2000.0 + (double)n * (1000.0 / SYNTH_RATE_HZ);
+        double perf = std::nearbyint((SYNTH_PERF_START_MS + true_ms + 3.0 + 2.0 * tool_noise()) * 10) / 10;
+        double t_ms = perf - SYNTH_PERF_START_MS;
+        int64_t wall = SYNTH_EPOCH_MS + (int64_t)std::floor(t_ms);
+        double v[4];
+
+        /* Slow random rotation */
+        for (unsigned c = 1; c < 4; c++) {
+            s_quat[c] += 0.002 * tool_noise();
+        }
+        double len = std::sqrt(s_quat[0] * s_quat[0] + s_quat[1] * s_quat[1] +
+                               s_quat[2] * s_quat[2] + s_quat[3] * s_quat[3]);
+        for (unsigned c = 0; c < 4; c++) {
+            s_quat[c] /= len;
+            v[c] = tool_quantize(s_quat[c], 14);
+        }
+        synth_sample(rec, IMUREC_STREAM_QUAT, t_ms, wall, v);
+
+        for (unsigned c = 0; c < 3; c++) {
+            s_mag[c] += 0.05 * tool_noise();
+            v[c] = tool_quantize(s_mag[c] + 0.4 * tool_noise(), 4);
+        }
+        synth_sample(rec, IMUREC_STREAM_MAG, t_ms + 0.1, wall, v);
+
+        for (unsigned c = 0; c < 3; c++) {
+            v[c] = tool_quantize(0.3 * tool_noise(), 8);
+        }
+        synth_sample(rec, IMUREC_STREAM_LINEAR_ACCEL, t_ms + 0.2, wall, v);
+    }
+}
+
+static void synth_end(recording &rec, unsigned seconds)
+{
+    synth_log(rec, IMUREC_TYPE_SYSTEM, (double)seconds * 1000 + 2000.3,
+              SYNTH_EPOCH_MS + (int64_t)seconds * 1000 + 2000, "Disconnected");
+}
+
+static int cmd_encode(int argc, char **argv)
+{
+    write_options opts;
+    std::vector<uint8_t> in, out;
+    recording rec;
+    std::string err;
+
+    for (int i = 4; i < argc; i++) {
+        if (std::strcmp(argv[i], "--deflate") == 0) {
+            opts.codec = IMUREC_CODEC_DEFLATE;
+        } else if (std::strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) {
+            opts.chunk_events = (uint32_t)std::strtoul(argv[++i], nullptr, 0);
+        } else {
+            return tool_fail(std::string("unknown option ") + argv[i]);
+        }
+    }
+
+    if (!read_file(argv[2], in, &err) ||
+        !from_json_text(std::string_view((const char *)in.data(), in.size()), rec, &err) ||
+        !write(rec, opts, out, &err) || !write_file(argv[3], out.data(), out.size(), &err)) {
+        return tool_fail(err);
+    }
+    std::printf("%s: %zu events, %zu -> %zu bytes (%.1f%%)\n", argv[3], rec.event_count(),
+                in.size(), out.size(), 100.0 * (double)out.size() / (double)in.size());
+    return 0;
+}
+
+static int cmd_ingest(int argc, char **argv)
+{
+    write_options opts;
+    ingest_stats st;
+    std::string err;
+    double t0;
+
+    for (int i = 4; i < argc; i++) {
+        if (std::strcmp(argv[i], "--deflate") == 0) {
+            opts.codec = IMUREC_CODEC_DEFLATE;
+        } else if (std::strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) {
+            opts.chunk_events = (uint32_t)std::strtoul(argv[++i], nullptr, 0);
+        } else {
+            return tool_fail(std::string("unknown option ") + argv[i]);
+        }
+    }
+
+    t0 = tool_time_ms();
+    if (!ingest_json_file(argv[2], argv[3], opts, &st, &err)) {
+        return tool_fail(err);
+    }
+    double ms = tool_time_ms() - t0;
+    std::printf("%s: %llu events, %llu -> %llu bytes, %.0f MB/s\n", argv[3],
+                (unsigned long long)st.events, (unsigned long long)st.bytes_in,
+                (unsigned long long)st.bytes_out, (double)st.bytes_in / 1e3 / ms);
+    return 0;
+}
+
+struct ingest_job {
+    const char *in;
+    const char *out;
+    bool        streaming;
+};
+
+static int ingest_child(const ingest_job &job)
+{
+    write_options opts;
+    std::string err;
+
+    if (job.streaming) {
+        return ingest_json_file(job.in, job.out, opts, nullptr, &err) ? 0 : tool_fail(err);
+    }
+
+    /* Whole-document path: read, parse to a DOM, validate, convert */
+    std::vector<uint8_t> text, bin;
+    recording rec;
+    if (!read_file(job.in, text, &err) ||
+        !from_json_text(std::string_view((const char *)text.data(), text.size()), rec, &err) ||
+        !write(rec, opts, bin, &err) || !write_file(job.out, bin.data(), bin.size(), &err)) {
+        return tool_fail(err);
+    }
+    return 0;
+}
+
+/* Run a job in a child process, so that its peak RSS is its own */
+static bool run_measured(const ingest_job &job, double &ms, long &rss_kb)
+{
+    struct rusage ru;
+    int status = 0;
+    double t0 = tool_time_ms();
+
+    std::fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        _exit(ingest_child(job));
+    }
+    if (pid < 0 || wait4(pid, &status, 0, &ru) != pid) {
+        return false;
+    }
+    ms = tool_time_ms() - t0;
+    rss_kb = ru.ru_maxrss;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static bool same_file(const char *a, const char *b)
+{
+    FILE *fa = std::fopen(a, "rb");
+    FILE *fb = std::fopen(b, "rb");
+    bool same = fa && fb;
+    static char s_ba[1 << 16], s_bb[1 << 16];
+
+    while (same) {
+        size_t na = std::fread(s_ba, 1, sizeof(s_ba), fa);
+        size_t nb = std::fread(s_bb, 1, sizeof(s_bb), fb);
+        same = na == nb && std::memcmp(s_ba, s_bb, na) == 0;
+        if (na == 0) {
+            break;
+        }
+    }
+    if (fa) {
+        std::fclose(fa);
+    }
+    if (fb) {
+        std::fclose(fb);
+    }
+    return same;
+}
+
+/*
+ * Streaming ingest against the whole-document path on the same input,
+ * each in its own process. Both must produce the same .imurec.
+ */
+static int cmd_ingestbench(char **argv)
+{
+    const std::string stream_out = std::string(argv[2]) + ".stream.imurec";
+    const std::string dom_out = std::string(argv[2]) + ".dom.imurec";
+    const ingest_job jobs[2] = {{argv[2], stream_out.c_str(), true},
+                                {argv[2], dom_out.c_str(), false}};
+    static const char *const k_names[2] = {"streaming", "parse whole"};
+    struct stat st;
+
+    if (stat(argv[2], &st) != 0) {
+        return tool_fail(std::string(argv[2]) + ": " + std::strerror(errno));
+    }
+    double mb = (double)st.st_size / 1e6;
+
+    std::printf("%s: %.1f MB\n", argv[2], mb);
+    std::printf("%-12s %10s %8s %14s\n", "mode", "ms", "MB/s", "peak RSS MB");
+    for (unsigned i = 0; i < 2; i++) {
+        double ms;
+        long rss_kb;
+        if (!run_measured(jobs[i], ms, rss_kb)) {
+            return tool_fail(std::string(k_names[i]) + " ingest failed");
+        }
+        std::printf("%-12s %10.1f %8.0f %14.1f\n", k_names[i], ms, mb * 1e3 / ms,
+                    (double)rss_kb / 1024);
+    }
+
+    if (!same_file(stream_out.c_str(), dom_out.c_str())) {
+        std::fprintf(stderr, "streaming and whole-document outputs differ\n");
+        return 1;
+    }
+    std::printf("outputs identical\n");
+    std::remove(stream_out.c_str());
+    std::remove(dom_out.c_str());
+    return 0;
+}
+
+static int cmd_decode(char **argv)
+{
+    std::vector<uint8_t> in;
+    std::string out, err;
+    recording rec;
+
+    if (!read_file(argv[2], in, &err) || !read(in.data(), in.size(), rec, &err) ||
+        !to_json(rec, out, &err) || !write_file(argv[3], out.data(), out.size(), &err)) {
+        return tool_fail(err);
+    }
+    std::printf("%s: %zu events, %zu bytes\n", argv[3], rec.event_count(), out.size());
+    return 0;
+}
+
+static int cmd_info(char **argv)
+{
+    std::vector<uint8_t> in;
+    std::string err;
+    recording rec;
+
+    if (!read_file(argv[2], in, &err) || !read(in.data(), in.size(), rec, &err)) {
+        return tool_fail(err);
+    }
+
+    const uint8_t *footer = in.data() + in.size() - IMUREC_FOOTER_SIZE;
+    std::printf("%s: %zu bytes, %u chunks, %zu events, %zu raw, %zu strings\n", argv[2],
+                in.size(), get_u32(footer + 8), rec.event_count(), rec.raw.size(),
+                rec.strings.size());
+    std::printf("meta: %s\n", rec.meta.c_str());
+    static const char *const k_names[] = {"log", "quaternion", "linearAccel", "magnetometer"};
+    for (unsigned s = 0; s < IMUREC_STREAM_COUNT; s++) {
+        const stream_data &sd = rec.streams[s];
+        if (sd.size() == 0) {
+            continue;
+        }
+        std::printf("  %-12s %8zu rows, tMs %.1f .. %.1f\n", k_names[s], sd.size(),
+                    sd.t_ms.front(), sd.t_ms.back());
+    }
+    return 0;
+}
+
+static int cmd_synth(int argc, char **argv)
+{
+    unsigned seconds = argc > 3 ? (unsigned)std::strtoul(argv[3], nullptr, 0) : SYNTH_DEFAULT_SECONDS;
+    const uint64_t samples = (uint64_t)seconds * SYNTH_RATE_HZ;
+    std::string meta, out, err;
+
+    synth_meta(seconds, meta);
+
+    if (ends_with(argv[2], ".imurec")) {
+        /* Written chunk by chunk, so memory stays flat for any length */
+        const uint64_t step = IMUREC_DEFAULT_CHUNK_EVENTS / 3 - 1;
+        write_options opts;
+        file_writer fw;
+
+        if (!fw.open(argv[2], meta, SYNTH_EVENTS_KEY, opts, &err)) {
+            return tool_fail(err);
+        }
+        synth_begin(fw.pending());
+        for (uint64_t n = 0; n < samples; n += step) {
+            synth_samples(fw.pending(), n, n + step < samples ? n + step : samples);
+            if (!fw.flush(&err)) {
+                return tool_fail(err);
+            }
+        }
+        synth_end(fw.pending(), seconds);
+        uint64_t events = fw.events_written() + fw.pending().event_count();
+        if (!fw.finish(&err)) {
+            return tool_fail(err);
+        }
+        std::printf("%s: %u s, %llu events, %llu bytes\n", argv[2], seconds,
+                    (unsigned long long)events, (unsigned long long)fw.bytes_written());
+        return 0;
+    }
+
+    recording rec;
+    rec.meta = meta;
+    rec.events_key = SYNTH_EVENTS_KEY;
+    synth_begin(rec);
+    synth_samples(rec, 0, samples);
+    synth_end(rec, seconds);
+    if (!to_json(rec, out, &err) || !write_file(argv[2], out.data(), out.size(), &err)) {
+        return tool_fail(err);
+    }
+    std::printf("%s: %u s, %zu events, %zu bytes\n", argv[2], seconds, rec.event_count(), out.size());
+    return 0;
+}
+
+static int cmd_seek(char **argv)
+{
+    mapped_recording map;
+    std::string err;
+    row_pos pos;
+    int s = stream_by_name(argv[3]);
+
+    if (s < 0) {
+        return tool_fail(std::string("unknown stream ") + argv[3]);
+    }
+    if (!map.open(argv[2], &err) || !map.seek((unsigned)s, std::strtod(argv[4], nullptr), pos, &err)) {
+        return tool_fail(err);
+    }
+    if (pos.chunk == map.chunk_count()) {
+        std::printf("past the end\n");
+        return 0;
+    }
+
+    std::shared_ptr<const chunk_data> ch = map.chunk(pos.chunk, &err);
+    if (!ch) {
+        return tool_fail(err);
+    }
+    const chunk_data::rows &r = ch->streams[s];
+    std::printf("chunk %u row %u: tMs %.3f", pos.chunk, pos.row, r.t_ms[pos.row]);
+    for (unsigned c = 0; c < stream_info((unsigned)s).components; c++) {
+        std::printf(" %s=%.6g", stream_info((unsigned)s).names[c], r.v[c][pos.row]);
+    }
+    std::printf("\n");
+    return 0;
+}
+
+/*
+ * Random seeks and 1 s range reads over a mapped file. Each seek is
+ * checked: the row found is at or after the target and the row before it
+ * is not.
+ */
+static int cmd_seekbench(int argc, char **argv)
+{
+    const unsigned seeks = argc > 3 ? (unsigned)std::strtoul(argv[3], nullptr, 0) : SEEKBENCH_DEFAULT_SEEKS;
+    const unsigned stream = IMUREC_STREAM_QUAT;
+    mapped_recording map;
+    std::vector<double> lat;
+    std::vector<row_span> spans;
+    std::string err;
+    double t0, t_open, t_min = INFINITY, t_max = -INFINITY;
+    unsigned bad = 0;
+
+    t0 = tool_time_ms();
+    if (!map.open(argv[2], &err)) {
+        return tool_fail(err);
+    }
+    t_open = tool_time_ms() - t0;
+
+    for (const chunk_entry &e : map.index()) {
+        t_min = e.t_first_ms < t_min ? e.t_first_ms : t_min;
+        t_max = e.t_last_ms > t_max ? e.t_last_ms : t_max;
+    }
+    if (!(t_max >= t_min)) {
+        return tool_fail("recording has no timed rows");
+    }
+
+    std::printf("%s: %.1f MB, %llu events, %u chunks, index %s in %.2f ms\n", argv[2],
+                (double)map.file_size() / 1e6, (unsigned long long)map.event_count(),
+                map.chunk_count(), map.index_rebuilt() ? "rebuilt" : "loaded", t_open);
+
+    /* Seeks */
+    for (unsigned i = 0; i < seeks; i++) {
+        double t = t_min + (t_max - t_min) * (0.5 + 0.5 * tool_noise());
+        row_pos pos;
+
+        t0 = tool_time_ms();
+        if (!map.seek(stream, t, pos, &err)) {
+            return tool_fail(err);
+        }
+        lat.push_back((tool_time_ms() - t0) * 1e3);
+
+        if (pos.chunk == map.chunk_count()) {
+            continue;
+        }
+        std::shared_ptr<const chunk_data> ch = map.chunk(pos.chunk, &err);
+        if (!ch) {
+            return tool_fail(err);
+        }
+        const std::vector<double> &ts = ch->streams[stream].t_ms;
+        double before = -INFINITY;
+        if (pos.row > 0) {
+            before = ts[pos.row - 1];
+        } else {
+            for (uint32_t c = pos.chunk; c-- > 0;) {
+                std::shared_ptr<const chunk_data> prev = map.chunk(c, &err);
+                if (!prev) {
+                    return tool_fail(err);
+                }
+                if (!prev->streams[stream].t_ms.empty()) {
+                    before = prev->streams[stream].t_ms.back();
+                    break;
+                }
+            }
+        }
+        bad += !(ts[pos.row] >= t) || !(before < t);
+    }
+    std::printf("seek:  %u x, us p50 %.1f  p99 %.1f  max %.1f\n", seeks,
+                percentile(lat, 0.5), percentile(lat, 0.99), percentile(lat, 1.0));
+
+    /* 1 s windows, touching every value in place */
+    lat.clear();
+    size_t rows = 0;
+    double sum = 0;
+    for (unsigned i = 0; i < seeks / 10 + 1; i++) {
+        double t = t_min + (t_max - t_min - 1000) * (0.5 + 0.5 * tool_noise());
+
+        t0 = tool_time_ms();
+        if (!map.range(stream, t, t + 1000, spans, &err)) {
+            return tool_fail(err);
+        }
+        for (const row_span &sp : spans) {
+            for (size_t r = 0; r < sp.size(); r++) {
+                sum += sp.value(0, r);
+            }
+            rows += sp.size();
+        }
+        lat.push_back((tool_time_ms() - t0) * 1e3);
+    }
+    std::printf("range: %zu x 1 s, %.0f rows avg, us p50 %.1f  p99 %.1f (checksum %.3f)\n",
+                lat.size(), (double)rows / (double)lat.size(), percentile(lat, 0.5),
+                percentile(lat, 0.99), sum);
+    std::printf("peak RSS %.1f MB for a %.1f MB file (now %.1f MB anonymous, %.1f MB file-backed)\n",
+                (double)peak_rss_kb() / 1024, (double)map.file_size() / 1e6,
+                (double)proc_status_kb("RssAnon") / 1024, (double)proc_status_kb("RssFile") / 1024);
+
+    if (bad) {
+        std::fprintf(stderr, "%u seeks returned the wrong row\n", bad);
+        return 1;
+    }
+    return 0;
+}
+
+static int cmd_compare(char **argv)
+{
+    std::vector<uint8_t> in, bin, zbin;
+    std::string json_out, err;
+    recording rec, back;
+    write_options opts;
+    double t0, t_parse, t_write, t_read, t_json, t_zwrite = 0, t_zread = 0;
+
+    if (!read_file(argv[2], in, &err)) {
+        return tool_fail(err);
+    }
+    std::string_view text((const char *)in.data(), in.size());
+
+    t0 = tool_time_ms();
+    if (!from_json_text(text, rec, &err)) {
+        return tool_fail(err);
+    }
+    t_parse = tool_time_ms() - t0;
+
+    t0 = tool_time_ms();
+    write(rec, opts, bin, &err);
+    t_write = tool_time_ms() - t0;
+
+    t0 = tool_time_ms();
+    if (!read(bin.data(), bin.size(), back, &err)) {
+        return tool_fail(err);
+    }
+    t_read = tool_time_ms() - t0;
+
+    t0 = tool_time_ms();
+    if (!to_json(back, json_out, &err)) {
+        return tool_fail(err);
+    }
+    t_json = tool_time_ms() - t0;
+
+    bool have_zlib = find_codec(IMUREC_CODEC_DEFLATE) != nullptr;
+    if (have_zlib) {
+        recording zback;
+        opts.codec = IMUREC_CODEC_DEFLATE;
+        t0 = tool_time_ms();
+        write(rec, opts, zbin, &err);
+        t_zwrite = tool_time_ms() - t0;
+        t0 = tool_time_ms();
+        if (!read(zbin.data(), zbin.size(), zback, &err)) {
+            return tool_fail(err);
+        }
+        t_zread = tool_time_ms() - t0;
+    }
+
+    size_t events = rec.event_count() ? rec.event_count() : 1;
+    size_t exact = 0, rows = 0;
+    for (const stream_data &sd : rec.streams) {
+        for (double t : sd.t_ms) {
+            exact += (double)std::llround(t * IMUREC_TMS_SCALE) / IMUREC_TMS_SCALE == t;
+        }
+        rows += sd.size();
+    }
+
+    std::printf("%zu events, tMs exact in fixed point: %.1f%%\n", rec.event_count(),
+                rows ? 100.0 * (double)exact / (double)rows : 0.0);
+    std::printf("%-16s %12s %9s %12s %12s\n", "format", "bytes", "B/event", "encode ms", "decode ms");
+    std::printf("%-16s %12zu %9.1f %12s %12.1f\n", "json", in.size(),
+                (double)in.size() / (double)events, "-", t_parse);
+    std::printf("%-16s %12zu %9.1f %12.1f %12.1f\n", "imurec", bin.size(),
+                (double)bin.size() / (double)events, t_write, t_read);
+    if (have_zlib) {
+        std::printf("%-16s %12zu %9.1f %12.1f %12.1f\n", "imurec+deflate", zbin.size(),
+                    (double)zbin.size() / (double)events, t_zwrite, t_zread);
+    }
+    std::printf("json parse %.0f MB/s, imurec read %.0f MB/s of JSON equivalent, "
+                "imurec -> json %.1f ms\n",
+                (double)in.size() / 1e3 / t_parse, (double)in.size() / 1e3 / t_read, t_json);
+
+    if (json_out.size() != in.size() || std::memcmp(json_out.data(), in.data(), in.size()) != 0) {
+        size_t i = 0;
+        while (i < json_out.size() && i < in.size() && json_out[i] == (char)in[i]) {
+            i++;
+        }
+        std::fprintf(stderr, "round trip differs from the input at byte %zu\n", i);
+        return 1;
+    }
+    std::printf("round trip: byte-identical\n");
+    return 0;
+}
+
+/* Options and inputs of replay/replaybench: everything after out_dir */
+static bool replay_args(int argc, char **argv, replay_options &opts, unsigned &threads,
+                        std::vector<std::string> &inputs, std::string &err)
+{
+    for (int i = 3; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+
+        if ((std::strcmp(argv[i], "--threads") == 0 ||
+             std::strcmp(argv[i], "--max-threads") == 0) && has_value) {
+            threads = (unsigned)std::strtoul(argv[++i], nullptr, 0);
+        } else if (std::strcmp(argv[i], "--rate") == 0 && has_value) {
+            opts.frame_rate = std::strtod(argv[++i], nullptr);
+        } else if (std::strcmp(argv[i], "--block") == 0 && has_value) {
+            opts.block_frames = (uint32_t)std::strtoul(argv[++i], nullptr, 0);
+        } else if (std::strcmp(argv[i], "--covariance") == 0 && has_value) {
+            const char *c = argv[++i];
+            if (std::strcmp(c, "reference") != 0 && std::strcmp(c, "joseph") != 0) {
+                err = "--covariance must be reference or joseph";
+                return false;
+            }
+            opts.covariance = c[0] == 'j' ? ekf_covariance::joseph : ekf_covariance::reference;
+        } else if (std::strncmp(argv[i], "--", 2) == 0) {
+            err = std::string("unknown option ") + argv[i];
+            return false;
+        } else {
+            inputs.emplace_back(argv[i]);
+        }
+    }
+    if (!(opts.frame_rate > 0) || !std::isfinite(opts.frame_rate) || opts.block_frames == 0) {
+        err = "invalid --rate or --block";
+        return false;
+    }
+    if (inputs.empty()) {
+        err = "no input files";
+        return false;
+    }
+    return true;
+}
+
+static bool make_dir(const std::string &dir, std::string &err)
+{
+    if (mkdir(dir.c_str(), 0777) != 0 && errno != EEXIST) {
+        err = dir + ": " + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+/* threads 0 = one per core; set to the count used */
+static double run_batch(const std::vector<std::string> &inputs, const std::string &out_dir,
+                        const replay_options &opts, unsigned &threads, batch_stats &stats,
+                        uint64_t &steals)
+{
+    thread_pool pool(threads);
+    double t0 = tool_time_ms();
+
+    preprocess_batch(inputs, out_dir, opts, pool, stats);
+    threads = pool.size();
+    steals = pool.steals();
+    for (const std::string &e : stats.errors) {
+        std::fprintf(stderr, "imurec: %s\n", e.c_str());
+    }
+    return tool_time_ms() - t0;
+}
+
+static int cmd_replay(int argc, char **argv)
+{
+    replay_options opts;
+    unsigned threads = 0;
+    std::vector<std::string> inputs;
+    batch_stats stats;
+    std::string err;
+    uint64_t steals;
+
+    if (!replay_args(argc, argv, opts, threads, inputs, err) || !make_dir(argv[2], err)) {
+        return tool_fail(err);
+    }
+
+    double ms = run_batch(inputs, argv[2], opts, threads, stats, steals);
+
+    std::printf("%llu files (%llu failed), %llu events -> %llu frames, %.1f -> %.1f MB, "
+                "%.0f ms on %u threads, %.2f M events/s\n",
+                (unsigned long long)stats.files, (unsigned long long)stats.failed,
+                (unsigned long long)stats.events, (unsigned long long)stats.frames,
+                (double)stats.bytes_in / 1e6, (double)stats.bytes_out / 1e6, ms, threads,
+                (double)stats.events / 1e3 / ms);
+    return stats.failed > 0 ? 1 : 0;
+}
+
+/*
+ * The batch at 1, 2, 4... threads up to the core count (or
+ * --max-threads). Every run must write the same files as the
+ * single-threaded one; the extra copies are removed afterwards.
+ */
+static int cmd_replaybench(int argc, char **argv)
+{
+    replay_options opts;
+    unsigned max_threads = 0;
+    std::vector<std::string> inputs;
+    std::vector<unsigned> counts;
+    std::string err;
+    const std::string out_dir = argv[2];
+    double base_ms = 0;
+
+    if (!replay_args(argc, argv, opts, max_threads, inputs, err) || !make_dir(out_dir, err)) {
+        return tool_fail(err);
+    }
+    if (max_threads == 0) {
+        max_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned t = 1; t < max_threads; t *= 2) {
+        counts.push_back(t);
+    }
+    counts.push_back(max_threads);
+
+    std::printf("%zu files\n", inputs.size());
+    std::printf("%8s %10s %14s %8s %11s %8s\n", "threads", "ms", "M events/s", "speedup",
+                "efficiency", "steals");
+    for (unsigned t : counts) {
+        const std::string dir = out_dir + "/t" + std::to_string(t);
+        batch_stats stats;
+        uint64_t steals;
+
+        unsigned threads = t;
+
+        if (!make_dir(dir, err)) {
+            return tool_fail(err);
+        }
+        double ms = run_batch(inputs, dir, opts, threads, stats, steals);
+        if (stats.failed > 0) {
+            return tool_fail("batch failed");
+        }
+        if (t == 1) {
+            base_ms = ms;
+        }
+        std::printf("%8u %10.1f %14.2f %7.2fx %10.0f%% %8llu\n", t, ms,
+                    (double)stats.events / 1e3 / ms, base_ms / ms,
+                    100.0 * base_ms / ms / t, (unsigned long long)steals);
+
+        if (t == 1) {
+            continue;
+        }
+        for (const std::string &in : inputs) {
+            std::string name = replay_output_name(in);
+            std::string a = out_dir + "/t1/" + name;
+            std::string b = dir + "/" + name;
+            if (!same_file(a.c_str(), b.c_str())) {
+                std::fprintf(stderr, "%s differs from the single-threaded output\n", b.c_str());
+                return 1;
+            }
+            std::remove(b.c_str());
+        }
+        rmdir(dir.c_str());
+    }
+    std::printf("outputs identical at every thread count\n");
+    return 0;
+}
+
+/* Largest |a - b| / max(1, |a|) seen for one group of fields */
+struct replay_diff {
+    const char *name;
+    double      worst = 0;
+    uint64_t    at = 0;
+
+    void add(double a, double b, uint64_t frame)
+    {
+        double d = std::fabs(a - b) / std::max(1.0, std::fabs(a));
+        if (!(d <= worst)) {
+            worst = std::isnan(d) ? INFINITY : d;
+            at = frame;
+        }
+    }
+};
+
+static const json::value *replay_number(const json::value &obj, const char *key)
+{
+    const json::value *v = obj.find(key);
+    return v && v->is_number() ? v : nullptr;
+}
+
+static int cmd_replaycmp(int argc, char **argv)
+{
+    const double tol = argc > 4 ? std::strtod(argv[4], nullptr) : REPLAYCMP_DEFAULT_TOL;
+    static const char *const k_pos[3] = {"x", "y", "z"};
+    static const char *const k_quat[4] = {"w", "x", "y", "z"};
+    json::value doc[2];
+    std::string err;
+
+    for (unsigned i = 0; i < 2; i++) {
+        std::vector<uint8_t> text;
+        if (!read_file(argv[2 + i], text, &err) ||
+            !json::parse(std::string_view((const char *)text.data(), text.size()), doc[i], &err)) {
+            return tool_fail(std::string(argv[2 + i]) + ": " + err);
+        }
+        const json::value *frames = doc[i].find("frames");
+        if (!replay_number(doc[i], "durationMs") || !frames || !frames->is_array()) {
+            return tool_fail(std::string(argv[2 + i]) + ": not a ReplaySessionV1");
+        }
+    }
+
+    const json::value *name[2] = {doc[0].find("deviceName"), doc[1].find("deviceName")};
+    std::string names[2];
+    for (unsigned i = 0; i < 2; i++) {
+        if (name[i]) {
+            json::stringify_compact(*name[i], names[i]);
+        }
+    }
+    if (names[0] != names[1]) {
+        std::fprintf(stderr, "deviceName differs: %s vs %s\n", names[0].c_str(), names[1].c_str());
+        return 1;
+    }
+
+    const std::vector<json::value> &fa = doc[0].find("frames")->a;
+    const std::vector<json::value> &fb = doc[1].find("frames")->a;
+    if (fa.size() != fb.size()) {
+        std::fprintf(stderr, "frame count differs: %zu vs %zu\n", fa.size(), fb.size());
+        return 1;
+    }
+
+    replay_diff diffs[3] = {{"tMs"}, {"position"}, {"quaternion"}};
+    diffs[0].add(replay_number(doc[0], "durationMs")->n, replay_number(doc[1], "durationMs")->n, 0);
+    for (size_t f = 0; f < fa.size(); f++) {
+        const json::value *ta = replay_number(fa[f], "tMs");
+        const json::value *tb = replay_number(fb[f], "tMs");
+        const json::value *pa = fa[f].find("position");
+        const json::value *pb = fb[f].find("position");
+        const json::value *qa = fa[f].find("quaternion");
+        const json::value *qb = fb[f].find("quaternion");
+        if (!ta || !tb || !pa || !pb || !qa || !qb) {
+            return tool_fail("frame " + std::to_string(f) + " is incomplete");
+        }
+        diffs[0].add(ta->n, tb->n, f);
+        for (unsigned c = 0; c < 3; c++) {
+            const json::value *a = replay_number(*pa, k_pos[c]);
+            const json::value *b = replay_number(*pb, k_pos[c]);
+            diffs[1].add(a ? a->n : NAN, b ? b->n : NAN, f);
+        }
+        for (unsigned c = 0; c < 4; c++) {
+            const json::value *a = replay_number(*qa, k_quat[c]);
+            const json::value *b = replay_number(*qb, k_quat[c]);
+            diffs[2].add(a ? a->n : NAN, b ? b->n : NAN, f);
+        }
+    }
+
+    bool ok = true;
+    std::printf("%zu frames\n", fa.size());
+    for (const replay_diff &d : diffs) {
+        std::printf("%-12s max diff %.3g (frame %llu)\n", d.name, d.worst,
+                    (unsigned long long)d.at);
+        ok = ok && d.worst <= tol;
+    }
+    if (!ok) {
+        std::fprintf(stderr, "differences above %g\n", tol);
+        return 1;
+    }
+    std::printf("within %g\n", tol);
+    return 0;
+}
+
+/* Per-set figures of sweep_metrics, as reported */
+struct sweep_row {
+    size_t set;
+    double zupt_percent;
+    double episodes_per_min;
+    double residual;        /* Mean |v| entering a ZUPT episode */
+    double rest;            /* Mean |position| while ZUPT holds */
+    double drift;           /* Mean |raw position| at the end */
+    double peak;
+};
+
+static double ratio(double a, double b)
+{
+    return b > 0 ? a / b : 0;
+}
+
+static double sweep_key(const sweep_row &r, const std::string &key)
+{
+    if (key == "residual") {
+        return r.residual;
+    }
+    if (key == "rest") {
+        return r.rest;
+    }
+    if (key == "peak") {
+        return r.peak;
+    }
+    return r.drift;
+}
+
+static bool write_sweep_csv(const char *path, const std::vector<sweep_axis> &axes,
+                            const std::vector<ekf_params> &sets,
+                            const std::vector<sweep_metrics> &metrics,
+                            const std::vector<sweep_row> &rows)
+{
+    FILE *f = std::fopen(path, "w");
+    if (!f) {
+        return false;
+    }
+    for (const sweep_axis &a : axes) {
+        std::fprintf(f, "%s,", sweep_field_name(a.field));
+    }
+    std::fprintf(f, "recordings,predicts,zupt_steps,zupt_episodes,zupt_percent,"
+                    "episodes_per_min,mean_residual,mean_rest_offset,mean_end_drift,"
+                    "peak_speed\n");
+    for (const sweep_row &r : rows) {
+        const sweep_metrics &m = metrics[r.set];
+        for (const sweep_axis &a : axes) {
+            std::fprintf(f, "%.17g,", axis_value(sets[r.set], a));
+        }
+        std::fprintf(f, "%llu,%llu,%llu,%llu,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g\n",
+                     (unsigned long long)m.recordings, (unsigned long long)m.predicts,
+                     (unsigned long long)m.zupt_steps, (unsigned long long)m.zupt_episodes,
+                     r.zupt_percent, r.episodes_per_min, r.residual, r.rest, r.drift, r.peak);
+    }
+    return std::fclose(f) == 0;
+}
+
+static int cmd_sweep(int argc, char **argv)
+{
+    std::vector<std::string> inputs;
+    std::vector<sweep_axis> axes;
+    sweep_options opts;
+    unsigned threads = 0;
+    uint64_t random = 0;
+    uint64_t seed = SWEEP_DEFAULT_SEED;
+    size_t top = SWEEP_DEFAULT_TOP;
+    std::string key = "drift";
+    const char *csv = nullptr;
+    std::string err;
+
+    for (int i = 2; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+
+        if (std::strcmp(argv[i], "--param") == 0 && has_value) {
+            sweep_axis a;
+            if (!parse_axis(argv[++i], a, &err)) {
+                return tool_fail(err);
+            }
+            axes.push_back(a);
+        } else if (std::strcmp(argv[i], "--random") == 0 && has_value) {
+            random = std::strtoull(argv[++i], nullptr, 0);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && has_value) {
+            seed = std::strtoull(argv[++i], nullptr, 0);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && has_value) {
+            threads = (unsigned)std::strtoul(argv[++i], nullptr, 0);
+        } else if (std::strcmp(argv[i], "--sort") == 0 && has_value) {
+            key = argv[++i];
+        } else if (std::strcmp(argv[i], "--top") == 0 && has_value) {
+            top = (size_t)std::strtoull(argv[++i], nullptr, 0);
+        } else if (std::strcmp(argv[i], "--csv") == 0 && has_value) {
+            csv = argv[++i];
+        } else if (std::strcmp(argv[i], "--scalar") == 0) {
+            opts.scalar = true;
+        } else if (std::strcmp(argv[i], "--verify") == 0) {
+            opts.verify = true;
+        } else if (std::strncmp(argv[i], "--", 2) == 0) {
+            return tool_fail(std::string("unknown option ") + argv[i]);
+        } else {
+            inputs.emplace_back(argv[i]);
+        }
+    }
+    if (inputs.empty()) {
+        return tool_fail("no input files");
+    }
+    if (key != "drift" && key != "residual" && key != "rest" && key != "peak") {
+        return tool_fail("--sort must be drift, residual, rest or peak");
+    }
+
+    std::vector<ekf_params> sets;
+    if (random > 0) {
+        random_sets(ekf_params(), axes, random, seed, sets);
+    } else {
+        grid_sets(ekf_params(), axes, sets);
+    }
+
+    thread_pool pool(threads);
+    std::vector<sweep_metrics> metrics;
+    sweep_stats stats;
+    double t0 = tool_time_ms();
+
+    sweep_corpus(inputs, sets, opts, pool, metrics, stats);
+    double ms = tool_time_ms() - t0;
+    for (const std::string &e : stats.errors) {
+        std::fprintf(stderr, "imurec: %s\n", e.c_str());
+    }
+
+    std::printf("%llu files (%llu failed), %llu events, %zu sets on %s\n",
+                (unsigned long long)stats.files, (unsigned long long)stats.failed,
+                (unsigned long long)stats.events, sets.size(),
+                opts.scalar ? "ekf_tracker" : sweep_simd_name());
+    std::printf("%llu filter steps in %.0f ms on %u threads, %.2f M steps/s%s\n",
+                (unsigned long long)stats.steps, ms, pool.size(),
+                (double)stats.steps / 1e3 / ms, opts.verify ? " (verified)" : "");
+    if (stats.files == 0) {
+        return 1;
+    }
+
+    std::vector<sweep_row> rows;
+    for (size_t s = 0; s < sets.size(); s++) {
+        const sweep_metrics &m = metrics[s];
+        rows.push_back({s, 100 * ratio((double)m.zupt_steps, (double)m.predicts),
+                        ratio((double)m.zupt_episodes, m.duration_ms / 60000),
+                        ratio(m.zupt_residual, (double)m.zupt_episodes),
+                        ratio(m.rest_offset, (double)m.zupt_steps),
+                        ratio(m.end_drift, (double)m.recordings), m.peak_speed});
+    }
+    std::stable_sort(rows.begin(), rows.end(), [&key](const sweep_row &a, const sweep_row &b) {
+        return sweep_key(a, key) < sweep_key(b, key);
+    });
+
+    if (top > 0) {
+        std::printf("%5s", "rank");
+        for (const sweep_axis &a : axes) {
+            std::printf(" %22s", sweep_field_name(a.field));
+        }
+        std::printf(" %7s %10s %10s %10s %10s %10s\n", "zupt%", "episode/m", "residual",
+                    "rest", "drift", "peak");
+    }
+    for (size_t r = 0; r < rows.size() && r < top; r++) {
+        const sweep_row &row = rows[r];
+        std::printf("%5zu", r + 1);
+        for (const sweep_axis &a : axes) {
+            std::printf(" %22.6g", axis_value(sets[row.set], a));
+        }
+        std::printf(" %7.2f %10.2f %10.4f %10.4f %10.4f %10.4f\n", row.zupt_percent,
+                    row.episodes_per_min, row.residual, row.rest, row.drift, row.peak);
+    }
+
+    if (csv && !write_sweep_csv(csv, axes, sets, metrics, rows)) {
+        return tool_fail(std::string("cannot write ") + csv);
+    }
+    if (stats.mismatches > 0) {
+        std::fprintf(stderr, "%llu (recording, set) results differ between lanes and "
+                             "ekf_tracker\n",
+                     (unsigned long long)stats.mismatches);
+        return 1;
+    }
+    return stats.failed > 0 ? 1 : 0;
+}
+
+/* One step of the ekfbench walk */
+struct ekf_sample {
+    vec3   accel;
+    quat   q;
+    double dt;
+    vec3   mag;
+};
+
+static void ekfbench_walk(uint64_t steps, std::vector<ekf_sample> &out)
+{
+    out.resize(steps);
+    for (uint64_t i = 0; i < steps; i++) {
+        ekf_sample &s = out[i];
+        bool walking = (i / EKFBENCH_PHASE_STEPS) % 2 == 1;
+        double t = (double)i / SYNTH_RATE_HZ;
+        double yaw = 0.3 * std::sin(0.2 * t);
+
+        s.dt = 1.0 / SYNTH_RATE_HZ + 0.0005 * tool_noise();
+        s.q = {std::cos(yaw / 2), 0, std::sin(yaw / 2), 0};
+        s.accel = {0.05 * tool_noise(), 0.05 * tool_noise(), 0.05 * tool_noise()};
+        if (walking) {
+            s.accel.x += 1.5 * std::sin(2 * 3.141592653589793 * 1.8 * t);
+            s.accel.z += 0.8 * std::cos(2 * 3.141592653589793 * 0.9 * t);
+        }
+        s.mag = {0.2 + 0.01 * tool_noise(), -0.4, 0.3 + 0.01 * tool_noise()};
+    }
+}
+
+/* ns per call of kernel(P, dt) run back to back, each on the last result */
+template <class Fn>
+static double ekfbench_kernel(Fn kernel, uint64_t calls)
+{
+    double t0 = tool_time_ms();
+
+    for (uint64_t i = 0; i < calls; i++) {
+        kernel(1.0 / SYNTH_RATE_HZ);
+    }
+    return (tool_time_ms() - t0) * 1e6 / (double)calls;
+}
+
+/* Random P of the shape the filter keeps: one SPD 3x3 block per axis */
+static void ekfbench_random_p(double *P, sym_matrix<3, ekf_vec4> &axes)
+{
+    std::memset(P, 0, 81 * sizeof(double));
+    for (int a = 0; a < 3; a++) {
+        double L[3][3] = {};
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j <= i; j++) {
+                L[i][j] = i == j ? 0.1 + std::fabs(tool_noise()) : tool_noise();
+            }
+        }
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                double sum = 0;
+                for (int k = 0; k < 3; k++) {
+                    sum += L[i][k] * L[j][k];
+                }
+                P[(i * 3 + a) * 9 + j * 3 + a] = sum;
+                axes(i, j)[a] = sum;
+            }
+        }
+    }
+}
+
+/*
+ * EKFTracker's ZUPT as written, P = P - K H P with K = P H' S^-1, but out
+ * of place: the app updates P in place, so its rows 4..8 read rows it has
+ * already corrected (ekf.hpp)
+ */
+static void ekfbench_zupt_dense(double *P, double *x, double r)
+{
+    double S[3][3], Si[3][3], K[9][3], P0[81];
+
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            S[i][j] = P[(i + 3) * 9 + j + 3] + (i == j ? r : 0);
+        }
+    }
+    double det = S[0][0] * (S[1][1] * S[2][2] - S[1][2] * S[2][1]) -
+                 S[0][1] * (S[1][0] * S[2][2] - S[1][2] * S[2][0]) +
+                 S[0][2] * (S[1][0] * S[2][1] - S[1][1] * S[2][0]);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            int i1 = (j + 1) % 3, i2 = (j + 2) % 3, j1 = (i + 1) % 3, j2 = (i + 2) % 3;
+            Si[i][j] = (S[i1][j1] * S[i2][j2] - S[i1][j2] * S[i2][j1]) / det;
+        }
+    }
+    for (int i = 0; i < 9; i++) {
+        for (int j = 0; j < 3; j++) {
+            K[i][j] = 0;
+            for (int k = 0; k < 3; k++) {
+                K[i][j] += P[i * 9 + k + 3] * Si[k][j];
+            }
+        }
+    }
+    double v[3] = {x[3], x[4], x[5]};
+    for (int i = 0; i < 9; i++) {
+        x[i] -= K[i][0] * v[0] + K[i][1] * v[1] + K[i][2] * v[2];
+    }
+    std::memcpy(P0, P, sizeof(P0));
+    for (int i = 0; i < 9; i++) {
+        for (int j = 0; j < 9; j++) {
+            P[i * 9 + j] = P0[i * 9 + j] - (K[i][0] * P0[27 + j] + K[i][1] * P0[36 + j] +
+                                            K[i][2] * P0[45 + j]);
+        }
+    }
+}
+
+/* Largest |a - b| over the 9x9, relative to the largest |a| */
+static double ekfbench_diff(const double *a, const double *b)
+{
+    double scale = 0, worst = 0;
+
+    for (int i = 0; i < 81; i++) {
+        scale = std::max(scale, std::fabs(a[i]));
+        worst = std::max(worst, std::fabs(a[i] - b[i]));
+    }
+    return worst / std::max(scale, 1e-300);
+}
+
+/* ns per step of one tracker on the walk; positions kept if asked */
+static double ekfbench_run(const std::vector<ekf_sample> &walk, ekf_covariance cov, bool mag,
+                           std::vector<vec3> *positions)
+{
+    ekf_tracker tracker(ekf_params(), cov);
+    double t0 = tool_time_ms();
+
+    for (size_t i = 0; i < walk.size(); i++) {
+        vec3 p = tracker.predict(walk[i].accel, walk[i].q, walk[i].dt);
+        if (mag) {
+            tracker.update_magnetometer(walk[i].mag);
+        }
+        if (positions) {
+            (*positions)[i] = p;
+        }
+    }
+    return (tool_time_ms() - t0) * 1e6 / (double)walk.size();
+}
+
+static int cmd_ekfbench(int argc, char **argv)
+{
+    const uint64_t steps = argc > 2 ? std::strtoull(argv[2], nullptr, 0) : EKFBENCH_DEFAULT_STEPS;
+    const double r = ekf_params().zupt_velocity_noise;
+    double P[81], out[81], dense[81];
+    sym_matrix<3, ekf_vec4> axes = {};
+
+    if (steps == 0) {
+        return tool_fail("steps must be positive");
+    }
+
+    /* The sparse product must be the dense one, -0 entries included */
+    for (unsigned n = 0; n < EKFBENCH_KERNEL_TRIALS; n++) {
+        double dt = (tool_rand() >> 8) / 16777216.0 + 1e-6;
+        for (int i = 0; i < 81; i++) {
+            uint32_t u = tool_rand();
+            P[i] = u % 8 == 0 ? (u & 8 ? -0.0 : 0.0)
+                              : tool_noise() * std::ldexp(1, (int)(u % 40) - 20);
+        }
+        fpft_dense(P, dt, dense);
+        fpft_reference(P, dt, out);
+        if (std::memcmp(dense, out, sizeof(out)) != 0) {
+            std::fprintf(stderr, "fpft_reference differs from fpft_dense (trial %u)\n", n);
+            return 1;
+        }
+    }
+    std::printf("fpft_reference: identical to the dense product on %u random P\n",
+                EKFBENCH_KERNEL_TRIALS);
+
+    /* The symmetric kernels against the app's formulas, evaluated densely */
+    const ekf_params params;
+    ekf_vec4 q[3];
+    for (int i = 0; i < 3; i++) {
+        q[i] = ekf_vec4{params.q[i * 3], params.q[i * 3 + 1], params.q[i * 3 + 2], 0};
+    }
+    double worst_prop = 0, worst_zupt = 0;
+    for (unsigned n = 0; n < EKFBENCH_KERNEL_TRIALS; n++) {
+        double dt = 1.0 / SYNTH_RATE_HZ * (1 + 0.5 * tool_noise());
+        double x[9], sym[81];
+
+        ekfbench_random_p(P, axes);
+        fpft_dense(P, dt, dense);
+        for (int i = 0; i < 9; i++) {
+            dense[i * 10] += params.q[i] * dt;
+        }
+        const double F[3][3] = {{1, dt, -0.5 * dt * dt}, {0, 1, -dt}, {0, 0, 1}};
+        sym_propagate(axes, F, q, dt);
+        for (int i = 0; i < 81; i++) {
+            sym[i] = i / 9 % 3 == i % 9 % 3 ? axes(i / 27, i % 9 / 3)[i % 3] : 0;
+        }
+        worst_prop = std::max(worst_prop, ekfbench_diff(dense, sym));
+
+        ekf_vec4 xv[3];
+        for (int i = 0; i < 9; i++) {
+            x[i] = tool_noise();
+            xv[i / 3][i % 3] = x[i];
+        }
+        ekfbench_zupt_dense(dense, x, r);
+        sym_joseph_update(axes, xv, 1, 0 - xv[1], ekf_vec4{} + r, axes(1, 1) + r);
+        for (int i = 0; i < 81; i++) {
+            sym[i] = i / 9 % 3 == i % 9 % 3 ? axes(i / 27, i % 9 / 3)[i % 3] : 0;
+        }
+        worst_zupt = std::max(worst_zupt, ekfbench_diff(dense, sym));
+        for (int i = 0; i < 9; i++) {
+            worst_zupt = std::max(worst_zupt, std::fabs(x[i] - xv[i / 3][i % 3]) /
+                                                  std::max(1.0, std::fabs(x[i])));
+        }
+    }
+    std::printf("sym_propagate: max diff %.3g from F P F' + Q dt\n", worst_prop);
+    std::printf("sym_joseph_update: max diff %.3g from P - K H P\n", worst_zupt);
+    if (!(worst_prop <= EKFBENCH_TOL && worst_zupt <= EKFBENCH_TOL)) {
+        std::fprintf(stderr, "symmetric kernels: above %g\n", EKFBENCH_TOL);
+        return 1;
+    }
+
+    /* Kernels alone */
+    ekf_tracker init;
+    volatile double sink = 0;
+
+    init.covariance(P);
+    double dense_ns = ekfbench_kernel([&](double dt) {
+        fpft_dense(P, dt, out);
+        std::memcpy(P, out, sizeof(P));
+    }, steps);
+    init.covariance(P);
+    double sparse_ns = ekfbench_kernel([&](double dt) {
+        fpft_reference(P, dt, out);
+        std::memcpy(P, out, sizeof(P));
+    }, steps);
+    double sym_ns = ekfbench_kernel([&](double dt) {
+        const double F[3][3] = {{1, dt, -0.5 * dt * dt}, {0, 1, -dt}, {0, 0, 1}};
+        sym_propagate(axes, F, q, dt);
+    }, steps);
+    sink = P[0] + axes.v[0][0];
+    (void)sink;
+
+    std::printf("\nF P F' kernel (%s)          ns/call\n", EKF_KERNEL_SIMD_NAME);
+    std::printf("  fpft_dense (app)          %8.1f\n", dense_ns);
+    std::printf("  fpft_reference (sparse)   %8.1f\n", sparse_ns);
+    std::printf("  sym_propagate (per axis)  %8.1f\n", sym_ns);
+
+    /*
+     * Whole trackers on a walk: ZUPT while still, heading updates while
+     * moving. The heading gate depends on the filter's velocity, so the
+     * magnetometer column also counts the libm calls each filter triggers.
+     */
+    std::vector<ekf_sample> walk;
+    std::vector<vec3> ref(steps), jos(steps);
+    ekfbench_walk(steps, walk);
+
+    double ref_ns = ekfbench_run(walk, ekf_covariance::reference, false, nullptr);
+    double jos_ns = ekfbench_run(walk, ekf_covariance::joseph, false, nullptr);
+    double ref_mag_ns = ekfbench_run(walk, ekf_covariance::reference, true, &ref);
+    double jos_mag_ns = ekfbench_run(walk, ekf_covariance::joseph, true, &jos);
+
+    std::printf("\n%llu steps                   ns/predict  +magnetometer\n",
+                (unsigned long long)steps);
+    std::printf("  reference                 %8.1f  %13.1f\n", ref_ns, ref_mag_ns);
+    std::printf("  joseph                    %8.1f  %13.1f\n", jos_ns, jos_mag_ns);
+
+    /* Not a failure: the app's in-place ZUPT is a different update */
+    double worst = 0;
+    uint64_t at = 0;
+    for (uint64_t i = 0; i < steps; i++) {
+        const double a[3] = {ref[i].x, ref[i].y, ref[i].z};
+        const double b[3] = {jos[i].x, jos[i].y, jos[i].z};
+        for (int c = 0; c < 3; c++) {
+            double d = std::fabs(a[c] - b[c]) / std::max(1.0, std::fabs(a[c]));
+            if (!(d <= worst)) {
+                worst = d;
+                at = i;
+            }
+        }
+    }
+    std::printf("\njoseph against the app's in-place ZUPT: max position diff %.3g (step %llu)\n",
+                worst, (unsigned long long)at);
+    return 0;
+}
+
+static void usage(void)
+{
+    std::fprintf(stderr,
+                 "usage: imurec encode in.json out.imurec [--deflate] [--chunk N]\n"
+                 "       imurec ingest in.json out.imurec [--deflate] [--chunk N]\n"
+                 "       imurec ingestbench in.json\n"
+                 "       imurec decode in.imurec out.json\n"
+                 "       imurec info in.imurec\n"
+                 "       imurec synth out.json|out.imurec [seconds]\n"
+                 "       imurec compare in.json\n"
+                 "       imurec seek in.imurec stream t_ms\n"
+                 "       imurec seekbench in.imurec [seeks]\n"
+                 "       imurec replay out_dir in... [--threads N] [--rate R] [--block N]\n"
+                 "                     [--covariance reference|joseph]\n"
+                 "       imurec replaybench out_dir in... [--max-threads N]\n"
+                 "       imurec replaycmp a.replay.json b.replay.json [tolerance]\n"
+                 "       imurec sweep in... --param name=v1,v2|name=lo:hi:n... [--random N]\n"
+                 "                    [--seed S] [--threads N] [--sort key] [--top N]\n"
+                 "                    [--csv out.csv] [--scalar] [--verify]\n"
+                 "       imurec ekfbench [steps]\n");
+}
+
+/*******************************************************************************
+ * Main
+ ******************************************************************************/
+
+int main(int argc, char **argv)
+{
+    if (argc >= 4 && std::strcmp(argv[1], "encode") == 0) {
+        return cmd_encode(argc, argv);
+    }
+    if (argc >= 4 && std::strcmp(argv[1], "ingest") == 0) {
+        return cmd_ingest(argc, argv);
+    }
+    if (argc == 3 && std::strcmp(argv[1], "ingestbench") == 0) {
+        return cmd_ingestbench(argv);
+    }
+    if (argc == 4 && std::strcmp(argv[1], "decode") == 0) {
+        return cmd_decode(argv);
+    }
+    if (argc == 3 && std::strcmp(argv[1], "info") == 0) {
+        return cmd_info(argv);
+    }
+    if ((argc == 3 || argc == 4) && std::strcmp(argv[1], "synth") == 0) {
+        return cmd_synth(argc, argv);
+    }
+    if (argc == 3 && std::strcmp(argv[1], "compare") == 0) {
+        return cmd_compare(argv);
+    }
+    if (argc == 5 && std::strcmp(argv[1], "seek") == 0) {
+        return cmd_seek(argv);
+    }
+    if ((argc == 3 || argc == 4) && std::strcmp(argv[1], "seekbench") == 0) {
+        return cmd_seekbench(argc, argv);
+    }
+    if (argc >= 4 && std::strcmp(argv[1], "replay") == 0) {
+        return cmd_replay(argc, argv);
+    }
+    if (argc >= 4 && std::strcmp(argv[1], "replaybench") == 0) {
+        return cmd_replaybench(argc, argv);
+    }
+    if ((argc == 4 || argc == 5) && std::strcmp(argv[1], "replaycmp") == 0) {
+        return cmd_replaycmp(argc, argv);
+    }
+    if (argc >= 3 && std::strcmp(argv[1], "sweep") == 0) {
+        return cmd_sweep(argc, argv);
+    }
+    if ((argc == 2 || argc == 3) && std::strcmp(argv[1], "ekfbench") == 0) {
+        return cmd_ekfbench(argc, argv);
+    }
+    usage();
+    return 2;
+}
@@ -0,0 +1,797 @@
+/**
+ * @file json.cpp
+ * @brief Minimal order-preserving JSON reader/writer for recording files
+ */
+
+#include "json.hpp"
+
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace imurec {
+namespace json {
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+#define JSON_MAX_DEPTH      64
+#define JSON_STREAM_BLOCK   (1u << 20)
+
+namespace {
+
+struct parser {
+    const char *begin;
+    const char *p;
+    const char *end;
+    std::string *err;
+    uint64_t base = 0;      /* File offset of begin, for messages */
+
+    bool fail(const char *what)
+    {
+        if (err) {
+            char buf[96];
+            std::snprintf(buf, sizeof(buf), "%s at byte %llu", what,
+                          (unsigned long long)(base + (uint64_t)(p - begin)));
+            *err = buf;
+        }
+        return false;
+    }
+
+    void skip_ws()
+    {
+        while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) {
+            p++;
+        }
+    }
+
+    bool literal(const char *word, size_t len)
+    {
+        if ((size_t)(end - p) < len || std::memcmp(p, word, len) != 0) {
+            return fail("invalid literal");
+        }
+        p += len;
+        return true;
+    }
+
+    bool hex4(uint32_t &cp)
+    {
+        cp = 0;
+        if (end - p < 4) {
+            return fail("truncated \\u escape");
+        }
+        for (int i = 0; i < 4; i++, p++) {
+            char c = *p;
+            cp <<= 4;
+            if (c >= '0' && c <= '9') {
+                cp |= (uint32_t)(c - '0');
+            } else if (c >= 'a' && c <= 'f') {
+                cp |= (uint32_t)(c - 'a' + 10);
+            } else if (c >= 'A' && c <= 'F') {
+                cp |= (uint32_t)(c - 'A' + 10);
+            } else {
+                return fail("invalid \\u escape");
+            }
+        }
+        return true;
+    }
+
+    /* UTF-8; a lone surrogate is kept as its 3-byte (WTF-8) form so that
+     * stringify can escape it again */
+    static void put_utf8(std::string &out, uint32_t cp)
+    {
+        if (cp < 0x80) {
+            out += (char)cp;
+        } else if (cp < 0x800) {
+            out += (char)(0xC0 | (cp >> 6));
+            out += (char)(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += (char)(0xE0 | (cp >> 12));
+            out += (char)(0x80 | ((cp >> 6) & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+        } else {
+            out += (char)(0xF0 | (cp >> 18));
+            out += (char)(0x80 | ((cp >> 12) & 0x3F));
+            out += (char)(0x80 | ((cp >> 6) & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+        }
+    }
+
+    bool string(std::string &out)
+    {
+        p++; /* opening quote */
+        out.clear();
+
+        for (;;) {
+            const char *run = p;
+            while (p < end && *p != '"' && *p != '\\' && (unsigned char)*p >= 0x20) {
+                p++;
+            }
+            out.append(run, (size_t)(p - run));
+
+            if (p >= end) {
+                return fail("unterminated string");
+            }
+            if (*p == '"') {
+                p++;
+                return true;
+            }
+            if (*p != '\\') {
+                return fail("control character in string");
+            }
+
+            p++;
+            if (p >= end) {
+                return fail("unterminated string");
+            }
+            char c = *p++;
+            switch (c) {
+            case '"':  out += '"';  break;
+            case '\\': out += '\\'; break;
+            case '/':  out += '/';  break;
+            case 'b':  out += '\b'; break;
+            case 'f':  out += '\f'; break;
+            case 'n':  out += '\n'; break;
+            case 'r':  out += '\r'; break;
+            case 't':  out += '\t'; break;
+            case 'u': {
+                uint32_t cp;
+                if (!hex4(cp)) {
+                    return false;
+                }
+                if (cp >= 0xD800 && cp < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                    const char *save = p;
+                    uint32_t lo;
+                    p += 2;
+                    if (!hex4(lo)) {
+                        return false;
+                    }
+                    if (lo >= 0xDC00 && lo < 0xE000) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                    } else {
+                        p = save;
+                    }
+                }
+                put_utf8(out, cp);
+                break;
+            }
+            default:
+                return fail("invalid escape");
+            }
+        }
+    }
+
+    bool number(double &out)
+    {
+        const char *start = p;
+
+        if (p < end && *p == '-') {
+            p++;
+        }
+        if (p < end && *p == '0') {
+            p++;
+        } else if (p < end && *p >= '1' && *p <= '9') {
+            while (p < end && *p >= '0' && *p <= '9') {
+                p++;
+            }
+        } else {
+            return fail("invalid number");
+        }
+        if (p < end && *p == '.') {
+            p++;
+            if (p >= end || *p < '0' || *p > '9') {
+                return fail("invalid number");
+            }
+            while (p < end && *p >= '0' && *p <= '9') {
+                p++;
+            }
+        }
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            p++;
+            if (p < end && (*p == '+' || *p == '-')) {
+                p++;
+            }
+            if (p >= end || *p < '0' || *p > '9') {
+                return fail("invalid number");
+            }
+            while (p < end && *p >= '0' && *p <= '9') {
+                p++;
+            }
+        }
+
+        /* from_chars rounds correctly; out-of-range values become +-inf
+         * like JSON.parse */
+        auto res = std::from_chars(start, p, out);
+        if (res.ec == std::errc::result_out_of_range) {
+            bool neg = (*start == '-');
+            const char *e = start;
+            while (e < p && *e != 'e' && *e != 'E') {
+                e++;
+            }
+            bool tiny = (e < p && e[1] == '-');
+            out = tiny ? (neg ? -0.0 : 0.0) : (neg ? -HUGE_VAL : HUGE_VAL);
+        } else if (res.ec != std::errc() || res.ptr != p) {
+            return fail("invalid number");
+        }
+        return true;
+    }
+
+    bool parse_value(value &v, int depth)
+    {
+        if (depth > JSON_MAX_DEPTH) {
+            return fail("nesting too deep");
+        }
+        skip_ws();
+        if (p >= end) {
+            return fail("unexpected end of input");
+        }
+
+        switch (*p) {
+        case '{': {
+            v.k = kind::object;
+            v.o.reserve(4);     /* Events and vectors have 3-7 members */
+            p++;
+            skip_ws();
+            if (p < end && *p == '}') {
+                p++;
+                return true;
+            }
+            for (;;) {
+                skip_ws();
+                if (p >= end || *p != '"') {
+                    return fail("expected object key");
+                }
+                v.o.emplace_back();
+                if (!string(v.o.back().first)) {
+                    return false;
+                }
+                skip_ws();
+                if (p >= end || *p != ':') {
+                    return fail("expected ':'");
+                }
+                p++;
+                if (!parse_value(v.o.back().second, depth + 1)) {
+                    return false;
+                }
+                skip_ws();
+                if (p < end && *p == ',') {
+                    p++;
+                    continue;
+                }
+                if (p < end && *p == '}') {
+                    p++;
+                    return true;
+                }
+                return fail("expected ',' or '}'");
+            }
+        }
+        case '[': {
+            v.k = kind::array;
+            p++;
+            skip_ws();
+            if (p < end && *p == ']') {
+                p++;
+                return true;
+            }
+            for (;;) {
+                v.a.emplace_back();
+                if (!parse_value(v.a.back(), depth + 1)) {
+                    return false;
+                }
+                skip_ws();
+                if (p < end && *p == ',') {
+                    p++;
+                    continue;
+                }
+                if (p < end && *p == ']') {
+                    p++;
+                    return true;
+                }
+                return fail("expected ',' or ']'");
+            }
+        }
+        case '"':
+            v.k = kind::string;
+            return string(v.s);
+        case 't':
+            v.k = kind::boolean;
+            v.b = true;
+            return literal("true", 4);
+        case 'f':
+            v.k = kind::boolean;
+            v.b = false;
+            return literal("false", 5);
+        case 'n':
+            v.k = kind::null;
+            return literal("null", 4);
+        default:
+            v.k = kind::number;
+            return number(v.n);
+        }
+    }
+};
+
+} /* namespace */
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+const value *value::find(std::string_view key) const
+{
+    if (k != kind::object) {
+        return nullptr;
+    }
+    for (const auto &kv : o) {
+        if (kv.first == key) {
+            return &kv.second;
+        }
+    }
+    return nullptr;
+}
+
+bool parse(std::string_view text, value &out, std::string *err)
+{
+    parser ps{text.data(), text.data(), text.data() + text.size(), err};
+
+    out = value();
+    if (!ps.parse_value(out, 0)) {
+        return false;
+    }
+    ps.skip_ws();
+    if (ps.p != ps.end) {
+        return ps.fail("trailing characters");
+    }
+    return true;
+}
+
+stream_reader::stream_reader(source src, size_t block)
+    : src_(std::move(src)), block_(block ? block : JSON_STREAM_BLOCK)
+{
+}
+
+bool stream_reader::fail(const char *what)
+{
+    if (error_.empty()) {
+        char buf[96];
+        std::snprintf(buf, sizeof(buf), "%s at byte %llu", what, (unsigned long long)offset());
+        error_ = buf;
+    }
+    return false;
+}
+
+bool stream_reader::more()
+{
+    if (eof_) {
+        return false;
+    }
+
+    /* Drop consumed bytes, then append a block */
+    if (pos_ > 0) {
+        buf_.erase(buf_.begin(), buf_.begin() + (long)pos_);
+        base_ += pos_;
+        pos_ = 0;
+    }
+    size_t have = buf_.size();
+    buf_.resize(have + block_);
+    size_t n = src_(buf_.data() + have, block_);
+    buf_.resize(have + n);
+    peak_ = buf_.capacity() > peak_ ? buf_.capacity() : peak_;
+    if (n == 0) {
+        eof_ = true;
+    }
+    return n != 0;
+}
+
+int stream_reader::peek()
+{
+    for (;;) {
+        while (pos_ < buf_.size()) {
+            char c = buf_[pos_];
+            if (c != ' ' && c != '\n' && c != '\r' && c != '\t') {
+                return (unsigned char)c;
+            }
+            pos_++;
+        }
+        if (!more()) {
+            return -1;
+        }
+    }
+}
+
+/*
+ * Length of the value at pos_ once all of it is buffered: strings and
+ * containers up to their closing character, scalars up to the next
+ * delimiter. The scan resumes where it stopped after each refill.
+ */
+bool stream_reader::extent(size_t &len)
+{
+    /* Byte classes outside strings: 1 quote, 2 open, 3 close, 4 ends a
+     * scalar (',' and whitespace; closers end one too) */
+    static const struct classes {
+        uint8_t c[256] = {};
+        classes()
+        {
+            c['"'] = 1;
+            c['{'] = c['['] = 2;
+            c['}'] = c[']'] = 3;
+            c[','] = c[' '] = c['\n'] = c['\r'] = c['\t'] = 4;
+        }
+    } k_cls;
+    size_t i = 0;
+    int depth = 0;
+    bool in_str = false;
+    const bool scalar = buf_[pos_] != '"' && buf_[pos_] != '{' && buf_[pos_] != '[';
+
+    for (;;) {
+        const char *b = buf_.data() + pos_;
+        const size_t n = buf_.size() - pos_;
+
+        while (i < n) {
+            if (in_str) {
+                /* Next unescaped quote: one preceded by an even run of
+                 * backslashes */
+                const char *q = (const char *)std::memchr(b + i, '"', n - i);
+                if (!q) {
+                    i = n;
+                    break;
+                }
+                size_t k = (size_t)(q - b);
+                size_t bs = 0;
+                while (k - bs > 0 && b[k - bs - 1] == '\\') {
+                    bs++;
+                }
+                i = k + 1;
+                if (bs & 1) {
+                    continue;
+                }
+                in_str = false;
+                if (depth == 0) {
+                    len = i;
+                    return true;
+                }
+                continue;
+            }
+
+            uint8_t cls = k_cls.c[(unsigned char)b[i]];
+            if (cls == 0) {
+                i++;
+                continue;
+            }
+            if (scalar) {
+                if (cls >= 3) {
+                    len = i;
+                    return true;
+                }
+                i++;
+            } else if (cls == 1) {
+                in_str = true;
+                i++;
+            } else if (cls == 2) {
+                if (++depth > JSON_MAX_DEPTH) {
+                    return fail("nesting too deep");
+                }
+                i++;
+            } else if (cls == 3) {
+                i++;
+                if (--depth == 0) {
+                    len = i;
+                    return true;
+                }
+            } else {
+                i++;
+            }
+        }
+        if (!more()) {
+            /* A scalar may end the document; anything else is cut short */
+            if (scalar) {
+                len = buf_.size() - pos_;
+                return true;
+            }
+            return fail("unexpected end of input");
+        }
+    }
+}
+
+bool stream_reader::expect_value_start()
+{
+    int c = peek();
+    if (c < 0) {
+        return fail("unexpected end of input");
+    }
+    return true;
+}
+
+bool stream_reader::enter_object()
+{
+    if (peek() != '{') {
+        return fail("expected '{'");
+    }
+    pos_++;
+    stack_.push_back({true, true});
+    return true;
+}
+
+bool stream_reader::enter_array()
+{
+    if (peek() != '[') {
+        return fail("expected '['");
+    }
+    pos_++;
+    stack_.push_back({false, true});
+    return true;
+}
+
+bool stream_reader::next(bool object)
+{
+    if (!error_.empty() || stack_.empty() || stack_.back().object != object) {
+        return fail("reader misuse");
+    }
+
+    int c = peek();
+    if (c == (object ? '}' : ']')) {
+        pos_++;
+        stack_.pop_back();
+        return false;
+    }
+    if (!stack_.back().first) {
+        if (c != ',') {
+            return fail(object ? "expected ',' or '}'" : "expected ',' or ']'");
+        }
+        pos_++;
+    }
+    stack_.back().first = false;
+    return expect_value_start();
+}
+
+bool stream_reader::next_key(std::string &key)
+{
+    value k;
+
+    if (!next(true)) {
+        return false;
+    }
+    if (peek() != '"') {
+        return fail("expected object key");
+    }
+    if (!read(k)) {
+        return false;
+    }
+    key = std::move(k.s);
+    if (peek() != ':') {
+        return fail("expected ':'");
+    }
+    pos_++;
+    return expect_value_start();
+}
+
+bool stream_reader::next_element()
+{
+    return next(false);
+}
+
+bool stream_reader::read(value &v)
+{
+    size_t len;
+
+    if (!expect_value_start() || !extent(len)) {
+        return false;
+    }
+
+    const char *b = buf_.data() + pos_;
+    parser ps{b, b, b + len, &error_, offset()};
+    v = value();
+    if (!ps.parse_value(v, (int)stack_.size())) {
+        return false;
+    }
+    ps.skip_ws();
+    if (ps.p != ps.end) {
+        return ps.fail("invalid value");
+    }
+    pos_ += len;
+    return true;
+}
+
+bool stream_reader::finish()
+{
+    if (!error_.empty()) {
+        return false;
+    }
+    if (!stack_.empty()) {
+        return fail("document not closed");
+    }
+    if (peek() >= 0) {
+        return fail("trailing characters");
+    }
+    return true;
+}
+
+void append_number(std::string &out, double v)
+{
+    char sci[32];
+    char digits[20];
+    int k = 0;
+    int n;
+
+    if (!std::isfinite(v)) {
+        out += "null";
+        return;
+    }
+    if (v == 0) {
+        out += '0';   /* Including -0 */
+        return;
+    }
+    if (v < 0) {
+        out += '-';
+        v = -v;
+    }
+
+    /* Shortest round-trip digits and exponent: "d.ddde+XX" */
+    auto res = std::to_chars(sci, sci + sizeof(sci) - 1, v, std::chars_format::scientific);
+    *res.ptr = '\0';
+    const char *s = sci;
+    for (; s < res.ptr && *s != 'e'; s++) {
+        if (*s != '.') {
+            digits[k++] = *s;
+        }
+    }
+    n = std::atoi(s + 1) + 1;   /* ECMAScript's n: value = 0.digits * 10^n */
+
+    /* Number::toString (ECMA-262 6.1.6.1.20) */
+    if (k <= n && n <= 21) {
+        out.append(digits, (size_t)k);
+        out.append((size_t)(n - k), '0');
+    } else if (0 < n && n <= 21) {
+        out.append(digits, (size_t)n);
+        out += '.';
+        out.append(digits + n, (size_t)(k - n));
+    } else if (-6 < n && n <= 0) {
+        out += "0.";
+        out.append((size_t)(-n), '0');
+        out.append(digits, (size_t)k);
+    } else {
+        char exp[16];
+        out += digits[0];
+        if (k > 1) {
+            out += '.';
+            out.append(digits + 1, (size_t)(k - 1));
+        }
+        std::snprintf(exp, sizeof(exp), "e%c%d", n - 1 >= 0 ? '+' : '-', std::abs(n - 1));
+        out += exp;
+    }
+}
+
+void append_string(std::string &out, std::string_view s)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    out += '"';
+    for (size_t i = 0; i < s.size(); i++) {
+        unsigned char c = (unsigned char)s[i];
+
+        switch (c) {
+        case '"':  out += "\\\""; continue;
+        case '\\': out += "\\\\"; continue;
+        case '\b': out += "\\b";  continue;
+        case '\f': out += "\\f";  continue;
+        case '\n': out += "\\n";  continue;
+        case '\r': out += "\\r";  continue;
+        case '\t': out += "\\t";  continue;
+        default:   break;
+        }
+
+        if (c < 0x20) {
+            out += "\\u00";
+            out += hex[c >> 4];
+            out += hex[c & 0xF];
+        } else if (c == 0xED && i + 2 < s.size() &&
+                   ((unsigned char)s[i + 1] & 0xE0) == 0xA0) {
+            /* Lone surrogate (from a parsed \ud8xx): escape it again */
+            uint32_t cp = 0xD000 | (((unsigned char)s[i + 1] & 0x3F) << 6) |
+                          ((unsigned char)s[i + 2] & 0x3F);
+            out += "\\u";
+            out += hex[(cp >> 12) & 0xF];
+            out += hex[(cp >> 8) & 0xF];
+            out += hex[(cp >> 4) & 0xF];
+            out += hex[cp & 0xF];
+            i += 2;
+        } else {
+            out += (char)c;
+        }
+    }
+    out += '"';
+}
+
+void append_indent(std::string &out, int depth)
+{
+    out += '\n';
+    out.append((size_t)depth * 2, ' ');
+}
+
+void stringify(const value &v, std::string &out, int depth)
+{
+    switch (v.k) {
+    case kind::null:
+        out += "null";
+        break;
+    case kind::boolean:
+        out += v.b ? "true" : "false";
+        break;
+    case kind::number:
+        append_number(out, v.n);
+        break;
+    case kind::string:
+        append_string(out, v.s);
+        break;
+    case kind::array:
+        if (v.a.empty()) {
+            out += "[]";
+            break;
+        }
+        out += '[';
+        for (size_t i = 0; i < v.a.size(); i++) {
+            if (i > 0) {
+                out += ',';
+            }
+            append_indent(out, depth + 1);
+            stringify(v.a[i], out, depth + 1);
+        }
+        append_indent(out, depth);
+        out += ']';
+        break;
+    case kind::object:
+        if (v.o.empty()) {
+            out += "{}";
+            break;
+        }
+        out += '{';
+        for (size_t i = 0; i < v.o.size(); i++) {
+            if (i > 0) {
+                out += ',';
+            }
+            append_indent(out, depth + 1);
+            append_string(out, v.o[i].first);
+            out += ": ";
+            stringify(v.o[i].second, out, depth + 1);
+        }
+        append_indent(out, depth);
+        out += '}';
+        break;
+    }
+}
+
+void stringify_compact(const value &v, std::string &out)
+{
+    switch (v.k) {
+    case kind::array:
+        out += '[';
+        for (size_t i = 0; i < v.a.size(); i++) {
+            if (i > 0) {
+                out += ',';
+            }
+            stringify_compact(v.a[i], out);
+        }
+        out += ']';
+        break;
+    case kind::object:
+        out += '{';
+        for (size_t i = 0; i < v.o.size(); i++) {
+            if (i > 0) {
+                out += ',';
+            }
+            append_string(out, v.o[i].first);
+            out += ':';
+            stringify_compact(v.o[i].second, out);
+        }
+        out += '}';
+        break;
+    default:
+        stringify(v, out, 0);
+        break;
+    }
+}
+
+} /* namespace json */
+} /* namespace imurec */
@@ -0,0 +1,166 @@
+/**
+ * @file json.hpp
+ * @brief Minimal order-preserving JSON reader/writer for recording files
+ *
+ * Just enough JSON for IMURecordingV1 exports: objects keep their key
+ * order, numbers are doubles (parsed with correct rounding), and
+ * stringify() reproduces JavaScript's JSON.stringify(value, null, 2)
+ * byte for byte, including its number formatting. That is what lets the
+ * binary converter promise a JSON -> binary -> JSON round trip that gives
+ * back the file the web app downloaded.
+ */
+
+#ifndef IMUREC_JSON_HPP
+#define IMUREC_JSON_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace imurec {
+namespace json {
+
+/*******************************************************************************
+ * Data Structures
+ ******************************************************************************/
+
+enum class kind : uint8_t {
+    null,
+    boolean,
+    number,
+    string,
+    array,
+    object,
+};
+
+/**
+ * @brief Parsed JSON value; objects are key/value pairs in file order
+ */
+struct value {
+    json::kind                                 k = kind::null;
+    bool                                       b = false;
+    double                                     n = 0.0;
+    std::string                                s;
+    std::vector<value>                         a;
+    std::vector<std::pair<std::string, value>> o;
+
+    bool is_number() const { return k == kind::number; }
+    bool is_string() const { return k == kind::string; }
+    bool is_object() const { return k == kind::object; }
+    bool is_array() const { return k == kind::array; }
+
+    /* Member lookup, nullptr if absent or not an object */
+    const value *find(std::string_view key) const;
+};
+
+/**
+ * @brief Incremental reader for documents too large to hold in memory
+ *
+ * Walks the outer objects and arrays of a document read from `source`
+ * in blocks, and parses one member value or array element at a time with
+ * the same rules as parse(). Memory is bounded by the largest single
+ * value read, not by the document:
+ *
+ *   r.enter_object();
+ *   while (r.next_key(key)) {
+ *       if (key == "events") {
+ *           r.enter_array();
+ *           while (r.next_element()) r.read(event);
+ *       } else {
+ *           r.read(v);
+ *       }
+ *   }
+ *   ok = r.ok() && r.finish();
+ *
+ * next_key() and next_element() return false both at the closing
+ * bracket and on errors; ok() tells them apart.
+ */
+class stream_reader {
+public:
+    /* Fill buf with up to len bytes; 0 at end of input */
+    using source = std::function<size_t(char *buf, size_t len)>;
+
+    explicit stream_reader(source src, size_t block = 0);
+
+    bool enter_object();
+    bool enter_array();
+    bool next_key(std::string &key);
+    bool next_element();
+    bool read(value &v);
+    bool finish();
+
+    bool ok() const { return error_.empty(); }
+    const std::string &error() const { return error_; }
+    uint64_t offset() const { return base_ + pos_; }
+    size_t peak_buffer() const { return peak_; }
+
+private:
+    struct level {
+        bool object;
+        bool first;
+    };
+
+    bool fail(const char *what);
+    bool more();
+    int peek();
+    bool extent(size_t &len);
+    bool expect_value_start();
+    bool next(bool object);
+
+    source             src_;
+    size_t             block_;
+    std::vector<char>  buf_;
+    size_t             pos_ = 0;
+    uint64_t           base_ = 0;
+    bool               eof_ = false;
+    size_t             peak_ = 0;
+    std::vector<level> stack_;
+    std::string        error_;
+};
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Parse a complete JSON document held in memory
+ * @param err Set to a message with the byte offset on failure (may be NULL)
+ * @return false on a syntax error
+ */
+bool parse(std::string_view text, value &out, std::string *err);
+
+/**
+ * @brief Append JSON.stringify(v, null, 2), starting at nesting `depth`
+ */
+void stringify(const value &v, std::string &out, int depth = 0);
+
+/**
+ * @brief Append JSON.stringify(v) (no whitespace)
+ */
+void stringify_compact(const value &v, std::string &out);
+
+/**
+ * @brief Append a number as JavaScript's Number#toString formats it
+ *
+ * Non-finite values are written as `null`, like JSON.stringify does.
+ */
+void append_number(std::string &out, double v);
+
+/**
+ * @brief Append a quoted string escaped the way JSON.stringify escapes it
+ */
+void append_string(std::string &out, std::string_view s);
+
+/**
+ * @brief Append newline plus 2 * depth spaces (JSON.stringify indent)
+ */
+void append_indent(std::string &out, int depth);
+
+} /* namespace json */
+} /* namespace imurec */
+
+#endif /* IMUREC_JSON_HPP */
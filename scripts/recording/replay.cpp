@@ -0,0 +1,733 @@
+/**
+ * @file replay.cpp
+ * @brief Native preprocessRecordingToReplay (lib/preprocessRecording.ts)
+ */
+
+#include "replay.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <set>
+
+namespace imurec {
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+#define REPLAY_DT_SAMPLES       12          /* estimateAccelDtSeconds */
+#define REPLAY_DT_MAX_S         0.2
+#define REPLAY_DEFAULT_DT_S     (1.0 / 60)
+#define REPLAY_SLERP_LERP_DOT   0.9995
+#define REPLAY_FRAME_BYTES      300         /* Formatted frame, for reserve() */
+
+/*******************************************************************************
+ * Data Structures
+ ******************************************************************************/
+
+namespace {
+
+/* A raw event's tMs and vectors (bit s of `has` for stream s) */
+struct raw_event {
+    double  t_ms;
+    uint8_t has;
+    double  v[IMUREC_STREAM_COUNT][4];
+};
+
+struct event_ref {
+    double   t_ms;
+    uint32_t row;
+    uint8_t  kind;
+};
+
+/* transformAccelerationWithCalibration, normalized axes precomputed */
+struct calibration {
+    bool        present = false;
+    bool        invalid = false;
+    vec3        axis[3];
+};
+
+struct file_job {
+    std::string              path;
+    std::string              out_path;
+    std::string              source_name;
+    replay_track             track;
+    std::vector<std::string> blocks;
+    std::atomic<size_t>      remaining{0};
+    uint64_t                 frames = 0;
+    uint64_t                 bytes_in = 0;
+};
+
+struct batch_state {
+    const replay_options *opts;
+    thread_pool          *pool;
+    batch_stats          *stats;
+    std::mutex            lock;
+};
+
+/* build_track(): the EKF and the keyframes */
+class track_sink : public event_sink {
+public:
+    track_sink(const ekf_params &ekf, ekf_covariance covariance, replay_track &out)
+        : tracker_(ekf, covariance), out_(out)
+    {
+    }
+
+    void quaternion(double t_ms, const quat &q) override
+    {
+        out_.q_t.push_back(t_ms);
+        out_.q.push_back(q);
+    }
+
+    void linear_accel(double t_ms, const vec3 &accel, const quat &q, double dt) override
+    {
+        out_.p_t.push_back(t_ms);
+        out_.p.push_back(tracker_.predict(accel, q, dt));
+    }
+
+    void magnetometer(double, const vec3 &mag) override { tracker_.update_magnetometer(mag); }
+
+private:
+    ekf_tracker   tracker_;
+    replay_track &out_;
+};
+
+} /* namespace */
+
+/*******************************************************************************
+ * Private Functions: Event Pass
+ ******************************************************************************/
+
+namespace {
+
+bool fail(std::string *err, const std::string &what)
+{
+    if (err) {
+        *err = what;
+    }
+    return false;
+}
+
+bool ends_with(const std::string &s, const char *suffix)
+{
+    size_t n = std::strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+bool read_vector(const json::value *v, unsigned n, double *out)
+{
+    static const char *const k_names[2][4] = {{"x", "y", "z", ""}, {"w", "x", "y", "z"}};
+
+    if (!v || !v->is_object()) {
+        return false;
+    }
+    for (unsigned c = 0; c < n; c++) {
+        const json::value *m = v->find(k_names[n == 4][c]);
+        if (!m || !m->is_number()) {
+            return false;
+        }
+        out[c] = m->n;
+    }
+    return true;
+}
+
+bool parse_raw_events(const recording &rec, std::vector<raw_event> &out, std::string *err)
+{
+    out.resize(rec.raw.size());
+    for (size_t i = 0; i < rec.raw.size(); i++) {
+        json::value e;
+        raw_event &r = out[i];
+
+        if (!json::parse(rec.strings[rec.raw[i]], e, err)) {
+            return false;
+        }
+        const json::value *t = e.find("tMs");
+        if (!t || !t->is_number()) {
+            return fail(err, "raw event without tMs");
+        }
+        r.t_ms = t->n;
+        r.has = 0;
+        for (unsigned s = 1; s < IMUREC_STREAM_COUNT; s++) {
+            const stream_desc &d = stream_info(s);
+            if (read_vector(e.find(d.key), d.components, r.v[s])) {
+                r.has |= (uint8_t)(1u << s);
+            }
+        }
+    }
+    return true;
+}
+
+/* Values of stream s carried by an event, if any */
+bool event_values(const recording &rec, const std::vector<raw_event> &raws, unsigned kind,
+                  uint32_t row, unsigned s, double *v)
+{
+    if (kind == IMUREC_KIND_RAW) {
+        if (!(raws[row].has & (1u << s))) {
+            return false;
+        }
+        std::memcpy(v, raws[row].v[s], sizeof(raws[row].v[s]));
+        return true;
+    }
+    if (kind != s) {
+        return false;
+    }
+    for (unsigned c = 0; c < stream_info(s).components; c++) {
+        v[c] = rec.streams[s].v[c][row];
+    }
+    return true;
+}
+
+/* fn(t_ms, kind, row) per event in file order, until it returns false */
+template <class Fn>
+void walk_events(const recording &rec, const std::vector<raw_event> &raws, Fn fn)
+{
+    uint32_t rows[IMUREC_STREAM_COUNT] = {};
+    uint32_t raw = 0;
+
+    for (uint8_t k : rec.kinds) {
+        unsigned kind = k & IMUREC_KIND_MASK;
+        uint32_t row;
+        double t;
+
+        if (kind == IMUREC_KIND_RAW) {
+            row = raw++;
+            t = raws[row].t_ms;
+        } else {
+            row = rows[kind]++;
+            t = rec.streams[kind].t_ms[row];
+        }
+        if (!fn(t, kind, row)) {
+            return;
+        }
+    }
+}
+
+vec3 normalize_axis(double x, double y, double z)
+{
+    double len = std::sqrt(x * x + y * y + z * z);
+
+    if (len == 0) {
+        return {0, 0, 0};
+    }
+    return {x / len, y / len, z / len};
+}
+
+/* recording.calibration: falsy means none; otherwise the six averages */
+void load_calibration(const json::value *cal, calibration &out)
+{
+    static const char *const k_pos[3] = {"posX", "posY", "posZ"};
+    static const char *const k_neg[3] = {"negX", "negY", "negZ"};
+
+    if (!cal || cal->k == json::kind::null || (cal->k == json::kind::boolean && !cal->b) ||
+        (cal->is_number() && cal->n == 0) || (cal->is_string() && cal->s.empty())) {
+        return;
+    }
+
+    out.present = true;
+    for (unsigned a = 0; a < 3; a++) {
+        double pos[3], neg[3];
+        if (!cal->is_object() || !read_vector(cal->find(k_pos[a]), 3, pos) ||
+            !read_vector(cal->find(k_neg[a]), 3, neg)) {
+            out.invalid = true;
+            return;
+        }
+        out.axis[a] = normalize_axis(pos[0] - neg[0], pos[1] - neg[1], pos[2] - neg[2]);
+    }
+}
+
+vec3 calibrate(const calibration &cal, const vec3 &a)
+{
+    if (!cal.present) {
+        return a;
+    }
+    return {a.x * cal.axis[0].x + a.y * cal.axis[0].y + a.z * cal.axis[0].z,
+            a.x * cal.axis[1].x + a.y * cal.axis[1].y + a.z * cal.axis[1].z,
+            a.x * cal.axis[2].x + a.y * cal.axis[2].y + a.z * cal.axis[2].z};
+}
+
+quat normalize_quat(const quat &q)
+{
+    double len = std::sqrt(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+
+    if (!std::isfinite(len) || len == 0) {
+        return {1, 0, 0, 0};
+    }
+    return {q.w / len, q.x / len, q.y / len, q.z / len};
+}
+
+} /* namespace */
+
+/*******************************************************************************
+ * Private Functions: Resampling
+ ******************************************************************************/
+
+namespace {
+
+double clamp01(double v)
+{
+    if (v < 0) {
+        return 0;
+    }
+    if (v > 1) {
+        return 1;
+    }
+    return v;
+}
+
+quat slerp(const quat &a_in, const quat &b_in, double t)
+{
+    quat a = normalize_quat(a_in);
+    quat b = normalize_quat(b_in);
+
+    double dot = a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
+    if (dot < 0) {
+        dot = -dot;
+        b = {-b.w, -b.x, -b.y, -b.z};
+    }
+
+    if (dot > REPLAY_SLERP_LERP_DOT) {
+        return normalize_quat({a.w + t * (b.w - a.w), a.x + t * (b.x - a.x),
+                               a.y + t * (b.y - a.y), a.z + t * (b.z - a.z)});
+    }
+
+    double theta0 = std::acos(clamp01(dot));
+    double sin_theta0 = std::sin(theta0);
+    if (sin_theta0 == 0) {
+        return a;
+    }
+
+    double theta = theta0 * t;
+    double sin_theta = std::sin(theta);
+    double s0 = std::cos(theta) - dot * (sin_theta / sin_theta0);
+    double s1 = sin_theta / sin_theta0;
+
+    return normalize_quat({s0 * a.w + s1 * b.w, s0 * a.x + s1 * b.x, s0 * a.y + s1 * b.y,
+                           s0 * a.z + s1 * b.z});
+}
+
+double lerp(double a, double b, double t)
+{
+    return a + (b - a) * t;
+}
+
+/* Keyframe the frame loop has reached at time t: the last at or before
+ * t, or the first */
+size_t keyframe_at(const std::vector<double> &times, double t)
+{
+    size_t n = (size_t)(std::upper_bound(times.begin(), times.end(), t) - times.begin());
+    return n > 0 ? n - 1 : 0;
+}
+
+/* Interpolation weight between keyframes i and j */
+double alpha(const std::vector<double> &times, size_t i, size_t j, double t)
+{
+    double t0 = times.empty() ? 0 : times[i];
+    double t1 = times.empty() ? t0 : times[j];
+
+    return t1 == t0 ? 0 : clamp01((t - t0) / (t1 - t0));
+}
+
+void append_member(std::string &out, const char *indent_key, double v)
+{
+    out += indent_key;
+    json::append_number(out, v);
+}
+
+} /* namespace */
+
+/*******************************************************************************
+ * Private Functions: Batch
+ ******************************************************************************/
+
+namespace {
+
+void report(batch_state &st, const std::string &path, const std::string &err)
+{
+    std::lock_guard<std::mutex> g(st.lock);
+    st.stats->failed++;
+    st.stats->errors.push_back(path + ": " + err);
+}
+
+void write_job(batch_state &st, file_job &job)
+{
+    std::string head, tail;
+    bool has_frames = job.frames > 0;
+    uint64_t bytes = 0;
+    bool ok;
+
+    append_session_head(job.track, job.source_name, has_frames, head);
+    append_session_tail(has_frames, tail);
+
+    FILE *f = std::fopen(job.out_path.c_str(), "wb");
+    if (!f) {
+        report(st, job.path, "cannot create " + job.out_path);
+        return;
+    }
+    ok = std::fwrite(head.data(), 1, head.size(), f) == head.size();
+    bytes += head.size();
+    for (std::string &b : job.blocks) {
+        ok = ok && std::fwrite(b.data(), 1, b.size(), f) == b.size();
+        bytes += b.size();
+        std::string().swap(b);
+    }
+    ok = ok && std::fwrite(tail.data(), 1, tail.size(), f) == tail.size();
+    bytes += tail.size();
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok) {
+        std::remove(job.out_path.c_str());
+        report(st, job.path, "write failed: " + job.out_path);
+        return;
+    }
+
+    std::lock_guard<std::mutex> g(st.lock);
+    st.stats->files++;
+    st.stats->events += job.track.events;
+    st.stats->frames += job.frames;
+    st.stats->bytes_in += job.bytes_in;
+    st.stats->bytes_out += bytes;
+}
+
+void render_block(batch_state &st, const std::shared_ptr<file_job> &job, size_t b)
+{
+    uint64_t block = st.opts->block_frames;
+    uint64_t first = b * block;
+    uint64_t count = std::min<uint64_t>(block, job->frames - first);
+    std::string &out = job->blocks[b];
+
+    out.reserve((size_t)count * REPLAY_FRAME_BYTES);
+    append_frames(job->track, st.opts->frame_rate, first, count, out);
+
+    if (job->remaining.fetch_sub(1) == 1) {
+        write_job(st, *job);
+    }
+}
+
+void run_file(batch_state &st, const std::shared_ptr<file_job> &job)
+{
+    std::string err;
+
+    {
+        recording rec;
+        if (!load_recording(job->path, rec, job->bytes_in, &err) ||
+            !build_track(rec, st.opts->ekf, st.opts->covariance, job->track, &err)) {
+            report(st, job->path, err);
+            return;
+        }
+    }
+
+    job->frames = frame_count(job->track, st.opts->frame_rate);
+    if (job->frames == 0) {
+        write_job(st, *job);
+        return;
+    }
+
+    /* Later blocks go to this worker's deque for idle workers to steal;
+     * the first is formatted here */
+    size_t blocks = (size_t)((job->frames + st.opts->block_frames - 1) / st.opts->block_frames);
+    job->blocks.resize(blocks);
+    job->remaining = blocks;
+    for (size_t b = 1; b < blocks; b++) {
+        st.pool->submit([&st, job, b] { render_block(st, job, b); });
+    }
+    render_block(st, job, 0);
+}
+
+} /* namespace */
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+bool replay_events(const recording &rec, const json::value &meta, event_sink &sink,
+                   double *last_t_ms, std::string *err)
+{
+    std::vector<raw_event> raws;
+    std::vector<event_ref> order;
+    calibration cal;
+    bool sorted = true;
+    double prev = -INFINITY;
+
+    if (!parse_raw_events(rec, raws, err)) {
+        return false;
+    }
+    load_calibration(meta.find("calibration"), cal);
+
+    /* Array#sort is stable: only reorder if tMs goes backwards */
+    walk_events(rec, raws, [&](double t, unsigned, uint32_t) {
+        sorted = sorted && t >= prev;
+        prev = t;
+        return sorted;
+    });
+    if (!sorted) {
+        order.reserve(rec.event_count());
+        walk_events(rec, raws, [&](double t, unsigned kind, uint32_t row) {
+            order.push_back({t, row, (uint8_t)kind});
+            return true;
+        });
+        std::stable_sort(order.begin(), order.end(),
+                         [](const event_ref &a, const event_ref &b) { return a.t_ms < b.t_ms; });
+    }
+    auto each = [&](auto fn) {
+        if (sorted) {
+            walk_events(rec, raws, fn);
+            return;
+        }
+        for (const event_ref &r : order) {
+            if (!fn(r.t_ms, r.kind, r.row)) {
+                return;
+            }
+        }
+    };
+
+    /* estimateAccelDtSeconds: mean plausible gap of the first samples */
+    double times[REPLAY_DT_SAMPLES];
+    unsigned n = 0;
+    double v[4];
+    each([&](double t, unsigned kind, uint32_t row) {
+        if (event_values(rec, raws, kind, row, IMUREC_STREAM_LINEAR_ACCEL, v)) {
+            times[n++] = t;
+        }
+        return n < REPLAY_DT_SAMPLES;
+    });
+    double default_dt = REPLAY_DEFAULT_DT_S;
+    if (n >= 2) {
+        double sum = 0;
+        unsigned count = 0;
+        for (unsigned i = 1; i < n; i++) {
+            double dt = (times[i] - times[i - 1]) / 1000;
+            if (dt > 0 && dt < REPLAY_DT_MAX_S) {
+                sum += dt;
+                count++;
+            }
+        }
+        if (count > 0) {
+            default_dt = sum / count;
+        }
+    }
+
+    quat last_q = {1, 0, 0, 0};
+    bool have_q = false;
+    double last_accel_t = 0;
+    bool have_accel = false;
+    double last_t = 0;
+    bool cal_error = false;
+
+    each([&](double t, unsigned kind, uint32_t row) {
+        last_t = t;
+
+        if (event_values(rec, raws, kind, row, IMUREC_STREAM_QUAT, v)) {
+            last_q = normalize_quat({v[0], v[1], v[2], v[3]});
+            have_q = true;
+            sink.quaternion(t, last_q);
+        }
+
+        if (have_q && event_values(rec, raws, kind, row, IMUREC_STREAM_LINEAR_ACCEL, v)) {
+            if (cal.invalid) {
+                cal_error = true;
+                return false;
+            }
+            vec3 accel = calibrate(cal, {v[0], v[1], v[2]});
+            double dt = have_accel ? (t - last_accel_t) / 1000 : default_dt;
+            last_accel_t = t;
+            have_accel = true;
+            sink.linear_accel(t, accel, last_q, dt);
+        }
+
+        if (event_values(rec, raws, kind, row, IMUREC_STREAM_MAG, v)) {
+            sink.magnetometer(t, {v[0], v[1], v[2]});
+        }
+        return true;
+    });
+    if (cal_error) {
+        return fail(err, "invalid calibration block");
+    }
+    if (last_t_ms) {
+        *last_t_ms = last_t;
+    }
+    return true;
+}
+
+bool build_track(const recording &rec, const ekf_params &ekf, ekf_covariance covariance,
+                 replay_track &out, std::string *err)
+{
+    json::value meta;
+    double last_t = 0;
+
+    out = replay_track();
+    out.events = rec.event_count();
+
+    if (!json::parse(rec.meta, meta, err)) {
+        return false;
+    }
+
+    const json::value *name = meta.find("deviceName");
+    if (name && name->k != json::kind::null) {
+        json::stringify(*name, out.device_name, 1);
+    } else {
+        out.device_name = "null";
+    }
+
+    out.q_t.reserve(rec.streams[IMUREC_STREAM_QUAT].size());
+    out.q.reserve(rec.streams[IMUREC_STREAM_QUAT].size());
+    out.p_t.reserve(rec.streams[IMUREC_STREAM_LINEAR_ACCEL].size());
+    out.p.reserve(rec.streams[IMUREC_STREAM_LINEAR_ACCEL].size());
+
+    track_sink sink(ekf, covariance, out);
+    if (!replay_events(rec, meta, sink, &last_t, err)) {
+        return false;
+    }
+
+    /* Keyframes are events, so none is later than the last one */
+    out.duration_ms = out.events > 0 ? std::max(0.0, last_t) : 0;
+    return true;
+}
+
+bool load_recording(const std::string &path, recording &rec, uint64_t &bytes, std::string *err)
+{
+    std::vector<uint8_t> data;
+
+    if (!read_file(path.c_str(), data, err)) {
+        return false;
+    }
+    bytes = data.size();
+    if (ends_with(path, ".imurec")) {
+        return read(data.data(), data.size(), rec, err);
+    }
+    return from_json_text(std::string_view((const char *)data.data(), data.size()), rec, err);
+}
+
+uint64_t frame_count(const replay_track &track, double frame_rate)
+{
+    double interval = 1000 / frame_rate;
+
+    return (uint64_t)std::floor(track.duration_ms / interval) + 1;
+}
+
+void append_frames(const replay_track &track, double frame_rate, uint64_t first,
+                   uint64_t count, std::string &out)
+{
+    static const quat k_identity = {1, 0, 0, 0};
+    static const vec3 k_origin = {0, 0, 0};
+    double interval = 1000 / frame_rate;
+    size_t nq = track.q.size();
+    size_t np = track.p.size();
+    size_t qi = keyframe_at(track.q_t, (double)first * interval);
+    size_t pi = keyframe_at(track.p_t, (double)first * interval);
+
+    for (uint64_t f = 0; f < count; f++) {
+        double t = (double)(first + f) * interval;
+
+        while (qi + 1 < nq && track.q_t[qi + 1] <= t) {
+            qi++;
+        }
+        while (pi + 1 < np && track.p_t[pi + 1] <= t) {
+            pi++;
+        }
+
+        size_t qj = nq > 0 ? std::min(qi + 1, nq - 1) : 0;
+        const quat &q0 = nq > 0 ? track.q[qi] : k_identity;
+        const quat &q1 = nq > 0 ? track.q[qj] : q0;
+        quat q = slerp(q0, q1, alpha(track.q_t, qi, qj, t));
+
+        size_t pj = np > 0 ? std::min(pi + 1, np - 1) : 0;
+        const vec3 &p0 = np > 0 ? track.p[pi] : k_origin;
+        const vec3 &p1 = np > 0 ? track.p[pj] : p0;
+        double pa = alpha(track.p_t, pi, pj, t);
+
+        if (first + f > 0) {
+            out += ',';
+        }
+        append_member(out, "\n    {\n      \"tMs\": ", t);
+        append_member(out, ",\n      \"position\": {\n        \"x\": ", lerp(p0.x, p1.x, pa));
+        append_member(out, ",\n        \"y\": ", lerp(p0.y, p1.y, pa));
+        append_member(out, ",\n        \"z\": ", lerp(p0.z, p1.z, pa));
+        append_member(out, "\n      },\n      \"quaternion\": {\n        \"w\": ", q.w);
+        append_member(out, ",\n        \"x\": ", q.x);
+        append_member(out, ",\n        \"y\": ", q.y);
+        append_member(out, ",\n        \"z\": ", q.z);
+        out += "\n      }\n    }";
+    }
+}
+
+void append_session_head(const replay_track &track, const std::string &source_name,
+                         bool has_frames, std::string &out)
+{
+    out += "{\n  \"schemaVersion\": 1,";
+    if (!source_name.empty()) {
+        out += "\n  \"sourceFileName\": ";
+        json::append_string(out, source_name);
+        out += ',';
+    }
+    out += "\n  \"deviceName\": ";
+    out += track.device_name;
+    append_member(out, ",\n  \"durationMs\": ", track.duration_ms);
+    out += has_frames ? ",\n  \"frames\": [" : ",\n  \"frames\": []";
+}
+
+void append_session_tail(bool has_frames, std::string &out)
+{
+    out += has_frames ? "\n  ]\n}" : "\n}";
+}
+
+bool preprocess(const recording &rec, const replay_options &opts,
+                const std::string &source_name, std::string &out, std::string *err)
+{
+    replay_track track;
+
+    if (!build_track(rec, opts.ekf, opts.covariance, track, err)) {
+        return false;
+    }
+    uint64_t frames = frame_count(track, opts.frame_rate);
+
+    append_session_head(track, source_name, frames > 0, out);
+    append_frames(track, opts.frame_rate, 0, frames, out);
+    append_session_tail(frames > 0, out);
+    return true;
+}
+
+std::string replay_output_name(const std::string &path)
+{
+    size_t slash = path.find_last_of('/');
+    std::string stem = slash == std::string::npos ? path : path.substr(slash + 1);
+
+    if (ends_with(stem, ".imurec")) {
+        stem.resize(stem.size() - 7);
+    } else if (ends_with(stem, ".json")) {
+        stem.resize(stem.size() - 5);
+    }
+    return stem + ".replay.json";
+}
+
+void preprocess_batch(const std::vector<std::string> &inputs, const std::string &out_dir,
+                      const replay_options &opts, thread_pool &pool, batch_stats &stats)
+{
+    batch_state st;
+
+    st.opts = &opts;
+    st.pool = &pool;
+    st.stats = &stats;
+
+    std::set<std::string> names;
+    for (const std::string &path : inputs) {
+        auto job = std::make_shared<file_job>();
+        size_t slash = path.find_last_of('/');
+
+        if (!names.insert(replay_output_name(path)).second) {
+            report(st, path, "same output name as an earlier input, skipped");
+            continue;
+        }
+
+        job->path = path;
+        job->source_name = slash == std::string::npos ? path : path.substr(slash + 1);
+        job->out_path = out_dir + "/" + replay_output_name(path);
+        pool.submit([&st, job] { run_file(st, job); });
+    }
+    pool.wait();
+}
+
+} /* namespace imurec */
@@ -0,0 +1,171 @@
+/**
+ * @file replay.hpp
+ * @brief Native preprocessRecordingToReplay (lib/preprocessRecording.ts)
+ *
+ * Turns recordings into ReplaySessionV1 files the way the web app does
+ * on upload: events sorted by tMs, quaternions normalized, linear
+ * acceleration through the recording's calibration transform into an
+ * EKF pass (ekf.hpp) with magnetometer heading updates, then quaternion
+ * slerp and position lerp onto a fixed frame rate. The output is a
+ * ReplaySessionV1 (lib/replay.ts), laid out as JSON.stringify(v, null, 2).
+ *
+ * The EKF pass is sequential, so a file is processed in two steps:
+ * build_track() collects the quaternion and position keyframes in one
+ * pass over the events, then the frames are resampled and formatted in
+ * independent blocks of block_frames frames. preprocess_batch() runs
+ * files on a thread_pool and splits each file's frame blocks into pool
+ * tasks, so a batch of one long recording still uses every core for the
+ * resampling half. Frame i is at i * 1000 / rate, as in the app, so each
+ * block computes its own frame times.
+ *
+ * The app keeps frame positions and quaternions in Float32Arrays while
+ * this writes doubles, so the two agree to float32 rounding (relative
+ * 6e-8), not bit for bit.
+ */
+
+#ifndef IMUREC_REPLAY_HPP
+#define IMUREC_REPLAY_HPP
+
+#include "ekf.hpp"
+#include "imurec.hpp"
+#include "thread_pool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace imurec {
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define REPLAY_DEFAULT_FRAME_RATE   60
+#define REPLAY_BLOCK_FRAMES         4096    /* Frames per resampling task */
+
+/*******************************************************************************
+ * Data Structures
+ ******************************************************************************/
+
+struct replay_options {
+    double         frame_rate = REPLAY_DEFAULT_FRAME_RATE;
+    uint32_t       block_frames = REPLAY_BLOCK_FRAMES;
+    ekf_params     ekf;
+    ekf_covariance covariance = ekf_covariance::reference;
+};
+
+/**
+ * @brief Keyframes of one recording, ready for resampling
+ */
+struct replay_track {
+    std::vector<double> q_t;            /* Quaternion keyframes */
+    std::vector<quat>   q;
+    std::vector<double> p_t;            /* Position keyframes (EKF output) */
+    std::vector<vec3>   p;
+    double              duration_ms = 0;
+    std::string         device_name;    /* JSON text of deviceName ?? null */
+    uint64_t            events = 0;
+};
+
+/**
+ * @brief Receiver of replay_events(), called in tMs order
+ */
+class event_sink {
+public:
+    virtual ~event_sink() = default;
+
+    /* A normalized quaternion sample */
+    virtual void quaternion(double t_ms, const quat &q) = 0;
+
+    /* A calibrated linear acceleration sample once a quaternion has been
+     * seen, with the orientation and dt predictWithDt gets */
+    virtual void linear_accel(double t_ms, const vec3 &accel, const quat &q, double dt) = 0;
+
+    virtual void magnetometer(double t_ms, const vec3 &mag) = 0;
+};
+
+struct batch_stats {
+    uint64_t                 files = 0;     /* Written */
+    uint64_t                 failed = 0;
+    uint64_t                 events = 0;
+    uint64_t                 frames = 0;
+    uint64_t                 bytes_in = 0;
+    uint64_t                 bytes_out = 0;
+    std::vector<std::string> errors;        /* "path: message" */
+};
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Read a .imurec file, or IMURecordingV1 JSON by any other name
+ * @param bytes File size
+ */
+bool load_recording(const std::string &path, recording &rec, uint64_t &bytes, std::string *err);
+
+/**
+ * @brief The event pass without the EKF: sort, normalize, calibrate
+ * @param meta      rec.meta, parsed
+ * @param last_t_ms tMs of the last event, 0 if none (may be null)
+ * @return false as build_track()
+ */
+bool replay_events(const recording &rec, const json::value &meta, event_sink &sink,
+                   double *last_t_ms, std::string *err);
+
+/**
+ * @brief The event pass: sort, calibrate, EKF, keyframes
+ * @return false if the calibration block cannot be applied (the app
+ *         would throw on it)
+ */
+bool build_track(const recording &rec, const ekf_params &ekf, ekf_covariance covariance,
+                 replay_track &out, std::string *err);
+
+/**
+ * @brief Frame count: floor(durationMs / interval) + 1
+ */
+uint64_t frame_count(const replay_track &track, double frame_rate);
+
+/**
+ * @brief Append frames [first, first + count)
+ *
+ * Frames after the very first are preceded by a comma, so blocks
+ * appended in order form the "frames" array body.
+ */
+void append_frames(const replay_track &track, double frame_rate, uint64_t first,
+                   uint64_t count, std::string &out);
+
+/**
+ * @brief ReplaySessionV1 text around the frames
+ * @param source_name sourceFileName, omitted if empty
+ */
+void append_session_head(const replay_track &track, const std::string &source_name,
+                         bool has_frames, std::string &out);
+void append_session_tail(bool has_frames, std::string &out);
+
+/**
+ * @brief preprocessRecordingToReplay, single-threaded
+ */
+bool preprocess(const recording &rec, const replay_options &opts,
+                const std::string &source_name, std::string &out, std::string *err);
+
+/**
+ * @brief "<name>.replay.json" for an input path: the file name without
+ *        its directory and .json/.imurec extension
+ */
+std::string replay_output_name(const std::string &path);
+
+/**
+ * @brief Preprocess files (.json or .imurec) into out_dir, in parallel
+ *
+ * Writes out_dir/replay_output_name(input) per input. A file that fails
+ * is counted and reported in stats.errors; the others are still written.
+ * Returns when the pool is idle, so it must not run inside a pool task.
+ */
+void preprocess_batch(const std::vector<std::string> &inputs, const std::string &out_dir,
+                      const replay_options &opts, thread_pool &pool, batch_stats &stats);
+
+} /* namespace imurec */
+
+#endif /* IMUREC_REPLAY_HPP */
@@ -0,0 +1,812 @@
+/**
+ * @file sweep.cpp
+ * @brief EKF parameter sweeps over a corpus of recordings
+ */
+
+#include "sweep.hpp"
+
+#include "replay.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+namespace imurec {
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+/* Filters per lane group: one double lane each in the widest vector the
+ * build targets */
+#if defined(__AVX512F__)
+#define SWEEP_LANES         8
+#define SWEEP_SIMD_NAME     "avx512"
+#elif defined(__AVX__)
+#define SWEEP_LANES         4
+#define SWEEP_SIMD_NAME     "avx"
+#elif defined(__SSE2__)
+#define SWEEP_LANES         2
+#define SWEEP_SIMD_NAME     "sse2"
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define SWEEP_LANES         2
+#define SWEEP_SIMD_NAME     "neon"
+#else
+#define SWEEP_LANES         1
+#define SWEEP_SIMD_NAME     "scalar"
+#endif
+
+/* Accessors of a sweepable field: a scalar, or a diagonal block of three */
+#define SWEEP_FIELD(f, type)                                                         \
+    {#f, false, [](const ekf_params &p) { return (double)p.f; },                     \
+     [](ekf_params &p, double v) { p.f = (type)v; }}
+#define SWEEP_COUNT(f)                                                               \
+    {#f, true, [](const ekf_params &p) { return (double)p.f; },                      \
+     [](ekf_params &p, double v) { p.f = (unsigned)v; }}
+#define SWEEP_BLOCK(name, a, first)                                                  \
+    {name, false, [](const ekf_params &p) { return p.a[first]; },                    \
+     [](ekf_params &p, double v) { p.a[first] = p.a[first + 1] = p.a[first + 2] = v; }}
+
+/*******************************************************************************
+ * Data Structures
+ ******************************************************************************/
+
+namespace {
+
+typedef double  lane_d __attribute__((vector_size(SWEEP_LANES * sizeof(double))));
+typedef int64_t lane_m __attribute__((vector_size(SWEEP_LANES * sizeof(int64_t))));
+
+struct field {
+    const char *name;
+    bool        integer;
+    double      (*get)(const ekf_params &);
+    void        (*set)(ekf_params &, double);
+};
+
+/* SWEEP_LANES ekf_trackers, lane l of every vector being filter l */
+struct lane_filter {
+    /* ekf_params */
+    lane_d q[9];
+    lane_d heading_gain;
+    lane_d zupt_threshold;
+    lane_d zupt_frames;
+    lane_d zupt_noise;
+    lane_d max_dt;
+    lane_d hpf_stationary;
+    lane_d hpf_moving;
+    lane_d hpf_rate;
+    lane_d position_gain;
+
+    /* Tracker state; orientation and heading reference do not depend on
+     * the parameters, so every lane shares them */
+    lane_d x[9];
+    lane_d P[81];
+    lane_d stationary;
+    lane_d hpf_cutoff;
+    lane_d filtered[3];
+    lane_d prev_raw[3];
+    quat   last_quat;
+    bool   have_quat;
+    double reference_heading;
+    bool   have_reference;
+
+    /* sweep_metrics, counts kept as doubles */
+    lane_d predicts;
+    lane_d zupt_steps;
+    lane_d zupt_episodes;
+    lane_d zupt_residual;
+    lane_d rest_offset;
+    lane_d peak_speed;
+    lane_m in_zupt;
+};
+
+/* ekf_input from the replay event pass */
+class input_sink : public event_sink {
+public:
+    explicit input_sink(ekf_input &out) : out_(out) {}
+
+    void quaternion(double, const quat &) override {}
+
+    void linear_accel(double, const vec3 &accel, const quat &q, double dt) override
+    {
+        out_.ops.push_back(SWEEP_OP_PREDICT);
+        out_.dt.push_back(dt);
+        out_.accel.push_back(accel);
+        out_.q.push_back(q);
+    }
+
+    void magnetometer(double, const vec3 &mag) override
+    {
+        out_.ops.push_back(SWEEP_OP_MAG);
+        out_.mag.push_back(mag);
+    }
+
+private:
+    ekf_input &out_;
+};
+
+struct corpus_state {
+    const std::vector<ekf_params>          *sets;
+    const sweep_options                    *opts;
+    thread_pool                            *pool;
+    sweep_stats                            *stats;
+    std::vector<std::vector<sweep_metrics>> per_file;   /* [file][set], empty if failed */
+    std::mutex                              lock;
+};
+
+} /* namespace */
+
+/*******************************************************************************
+ * Private Variables
+ ******************************************************************************/
+
+namespace {
+
+const field k_fields[] = {
+    SWEEP_FIELD(heading_correction_gain, double),
+    SWEEP_FIELD(zupt_accel_threshold, double),
+    SWEEP_COUNT(zupt_frames_required),
+    SWEEP_FIELD(zupt_velocity_noise, double),
+    SWEEP_FIELD(max_dt, double),
+    SWEEP_FIELD(hpf_cutoff_stationary, double),
+    SWEEP_FIELD(hpf_cutoff_moving, double),
+    SWEEP_FIELD(hpf_transition_rate, double),
+    SWEEP_FIELD(position_gain, double),
+    SWEEP_BLOCK("q_pos", q, 0),
+    SWEEP_BLOCK("q_vel", q, 3),
+    SWEEP_BLOCK("q_bias", q, 6),
+    SWEEP_BLOCK("p0_pos", p0, 0),
+    SWEEP_BLOCK("p0_vel", p0, 3),
+    SWEEP_BLOCK("p0_bias", p0, 6),
+};
+
+const unsigned k_field_count = sizeof(k_fields) / sizeof(k_fields[0]);
+
+} /* namespace */
+
+/*******************************************************************************
+ * Private Functions: Lanes
+ ******************************************************************************/
+
+namespace {
+
+lane_d splat(double v)
+{
+    lane_d r;
+
+    for (unsigned l = 0; l < SWEEP_LANES; l++) {
+        r[l] = v;
+    }
+    return r;
+}
+
+bool any(lane_m m)
+{
+    for (unsigned l = 0; l < SWEEP_LANES; l++) {
+        if (m[l]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* libm per lane, so each lane rounds as ekf_tracker does */
+template <double (*Fn)(double)>
+lane_d per_lane(lane_d v)
+{
+    for (unsigned l = 0; l < SWEEP_LANES; l++) {
+        v[l] = Fn(v[l]);
+    }
+    return v;
+}
+
+double lane_sqrt_1(double v) { return std::sqrt(v); }
+double lane_exp_1(double v) { return std::exp(v); }
+double lane_sin_1(double v) { return std::sin(v); }
+double lane_cos_1(double v) { return std::cos(v); }
+
+/* Lane l of every vector from sets[l], the last set repeated past n */
+void lanes_init(lane_filter &f, const ekf_params *sets, size_t n)
+{
+    std::memset(&f, 0, sizeof(f));
+    for (unsigned l = 0; l < SWEEP_LANES; l++) {
+        const ekf_params &p = sets[std::min<size_t>(l, n - 1)];
+
+        for (int i = 0; i < 9; i++) {
+            f.q[i][l] = p.q[i];
+            f.P[i * 9 + i][l] = p.p0[i];
+        }
+        f.heading_gain[l] = p.heading_correction_gain;
+        f.zupt_threshold[l] = p.zupt_accel_threshold;
+        f.zupt_frames[l] = p.zupt_frames_required;
+        f.zupt_noise[l] = p.zupt_velocity_noise;
+        f.max_dt[l] = p.max_dt;
+        f.hpf_stationary[l] = p.hpf_cutoff_stationary;
+        f.hpf_moving[l] = p.hpf_cutoff_moving;
+        f.hpf_rate[l] = p.hpf_transition_rate;
+        f.position_gain[l] = p.position_gain;
+        f.hpf_cutoff[l] = p.hpf_cutoff_stationary;
+    }
+    f.last_quat = {1, 0, 0, 0};
+}
+
+/* ekf_tracker::apply_zupt on lanes z; returns the lanes updated */
+lane_m lanes_zupt(lane_filter &f, lane_m z)
+{
+    lane_d innov[3] = {0 - f.x[3], 0 - f.x[4], 0 - f.x[5]};
+    lane_d S[3][3], Sinv[3][3], K[9][3];
+
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+            S[r][c] = r == c ? f.P[(3 + r) * 9 + 3 + c] + f.zupt_noise : f.P[(3 + r) * 9 + 3 + c];
+        }
+    }
+
+    /* invert3x3 */
+    lane_d det = S[0][0] * (S[1][1] * S[2][2] - S[1][2] * S[2][1]) -
+                 S[0][1] * (S[1][0] * S[2][2] - S[1][2] * S[2][0]) +
+                 S[0][2] * (S[1][0] * S[2][1] - S[1][1] * S[2][0]);
+    lane_m ok = z & ~((det < EKF_SINGULAR_DET) & (det > -EKF_SINGULAR_DET));
+    if (!any(ok)) {
+        return ok;
+    }
+
+    lane_d inv = 1 / det;
+
+    Sinv[0][0] = (S[1][1] * S[2][2] - S[1][2] * S[2][1]) * inv;
+    Sinv[0][1] = (S[0][2] * S[2][1] - S[0][1] * S[2][2]) * inv;
+    Sinv[0][2] = (S[0][1] * S[1][2] - S[0][2] * S[1][1]) * inv;
+    Sinv[1][0] = (S[1][2] * S[2][0] - S[1][0] * S[2][2]) * inv;
+    Sinv[1][1] = (S[0][0] * S[2][2] - S[0][2] * S[2][0]) * inv;
+    Sinv[1][2] = (S[0][2] * S[1][0] - S[0][0] * S[1][2]) * inv;
+    Sinv[2][0] = (S[1][0] * S[2][1] - S[1][1] * S[2][0]) * inv;
+    Sinv[2][1] = (S[0][1] * S[2][0] - S[0][0] * S[2][1]) * inv;
+    Sinv[2][2] = (S[0][0] * S[1][1] - S[0][1] * S[1][0]) * inv;
+
+    for (int i = 0; i < 9; i++) {
+        const lane_d *row = &f.P[i * 9 + 3];
+        for (int c = 0; c < 3; c++) {
+            K[i][c] = row[0] * Sinv[0][c] + row[1] * Sinv[1][c] + row[2] * Sinv[2][c];
+        }
+    }
+
+    for (int i = 0; i < 9; i++) {
+        lane_d x = f.x[i] + (K[i][0] * innov[0] + K[i][1] * innov[1] + K[i][2] * innov[2]);
+        f.x[i] = ok ? x : f.x[i];
+    }
+
+    /* In place, as ekf_tracker: lanes left alone keep their rows */
+    for (int i = 0; i < 9; i++) {
+        for (int j = 0; j < 9; j++) {
+            lane_d sum = {};
+            for (int k = 0; k < 3; k++) {
+                sum += K[i][k] * f.P[(3 + k) * 9 + j];
+            }
+            lane_d p = f.P[i * 9 + j] - sum;
+            f.P[i * 9 + j] = ok ? p : f.P[i * 9 + j];
+        }
+    }
+    return ok;
+}
+
+/* ekf_tracker::apply_high_pass_filter on lanes run */
+void lanes_high_pass(lane_filter &f, lane_m run, double dt)
+{
+    lane_d d[3];
+
+    for (int c = 0; c < 3; c++) {
+        d[c] = f.x[c] - f.prev_raw[c];
+        f.prev_raw[c] = run ? f.x[c] : f.prev_raw[c];
+    }
+
+    lane_m moving = per_lane<lane_sqrt_1>(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) >
+                    EKF_MOVING_DELTA;
+    lane_d target = moving ? f.hpf_moving : f.hpf_stationary;
+    lane_d cutoff = f.hpf_cutoff + f.hpf_rate * (target - f.hpf_cutoff);
+
+    lane_d omega = 2 * EKF_PI * cutoff;
+    lane_d alpha = per_lane<lane_exp_1>(-omega * std::fmin(dt, EKF_HPF_MAX_DT));
+
+    f.hpf_cutoff = run ? cutoff : f.hpf_cutoff;
+    for (int c = 0; c < 3; c++) {
+        lane_d v = alpha * (f.filtered[c] + d[c]);
+        f.filtered[c] = run ? v : f.filtered[c];
+    }
+}
+
+/* ekf_tracker::predict, plus the metrics of the step */
+void lanes_predict(lane_filter &f, const vec3 &accel, const quat &q, double dt)
+{
+    const lane_d zero = {};
+    const lane_d one = splat(1);
+
+    f.last_quat = q;
+    f.have_quat = true;
+
+    lane_m run = ~((dt > f.max_dt) | (splat(dt) <= zero));
+    if (!any(run)) {
+        return;
+    }
+
+    vec3 world = rotate(accel, q);
+    lane_d ax = world.x - f.x[6];
+    lane_d ay = world.y - f.x[7];
+    lane_d az = world.z - f.x[8];
+
+    double mag = std::sqrt(accel.x * accel.x + accel.y * accel.y + accel.z * accel.z);
+    lane_m still = mag < f.zupt_threshold;
+    f.stationary = run ? (still ? f.stationary + 1 : zero) : f.stationary;
+
+    lane_d p[3] = {f.x[0] + f.x[3] * dt + 0.5 * ax * dt * dt,
+                   f.x[1] + f.x[4] * dt + 0.5 * ay * dt * dt,
+                   f.x[2] + f.x[5] * dt + 0.5 * az * dt * dt};
+    lane_d v[3] = {f.x[3] + ax * dt, f.x[4] + ay * dt, f.x[5] + az * dt};
+
+    for (int c = 0; c < 3; c++) {
+        f.x[c] = run ? p[c] : f.x[c];
+        f.x[3 + c] = run ? v[c] : f.x[3 + c];
+    }
+
+    /* P = F P F' + Q dt; F is the same for every lane */
+    lane_d FPFt[81];
+    fpft_reference(f.P, dt, FPFt);
+    for (int i = 0; i < 81; i++) {
+        lane_d P = FPFt[i] + (i % 10 == 0 ? f.q[i / 10] * dt : splat(0 * dt));
+        f.P[i] = run ? P : f.P[i];
+    }
+
+    lane_m zupt = run & (f.stationary >= f.zupt_frames);
+    lane_m applied = {};
+    lane_d speed_in = zero;
+    if (any(zupt)) {
+        speed_in = per_lane<lane_sqrt_1>(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        applied = lanes_zupt(f, zupt);
+    }
+
+    lanes_high_pass(f, run, dt);
+
+    lane_m start = applied & ~f.in_zupt;
+    f.predicts += run ? one : zero;
+    f.zupt_steps += applied ? one : zero;
+    f.zupt_episodes += start ? one : zero;
+    f.zupt_residual += start ? speed_in : zero;
+    if (any(applied)) {
+        lane_d px = f.filtered[0] * f.position_gain;
+        lane_d py = f.filtered[1] * f.position_gain;
+        lane_d pz = f.filtered[2] * f.position_gain;
+        lane_d r = per_lane<lane_sqrt_1>(px * px + py * py + pz * pz);
+        f.rest_offset += applied ? r : zero;
+    }
+    f.in_zupt = run ? applied : f.in_zupt;
+
+    lane_d speed = per_lane<lane_sqrt_1>(f.x[3] * f.x[3] + f.x[4] * f.x[4] + f.x[5] * f.x[5]);
+    f.peak_speed = run & (speed > f.peak_speed) ? speed : f.peak_speed;
+}
+
+/* ekf_tracker::update_magnetometer */
+void lanes_magnetometer(lane_filter &f, const vec3 &mag)
+{
+    if (!f.have_quat) {
+        return;
+    }
+
+    double heading = magnetic_heading(mag, f.last_quat);
+    if (!f.have_reference) {
+        f.reference_heading = heading;
+        f.have_reference = true;
+        return;
+    }
+
+    double error = normalize_angle(heading - f.reference_heading);
+    lane_d vx = f.x[3];
+    lane_d vz = f.x[5];
+    lane_m go = ~(per_lane<lane_sqrt_1>(vx * vx + vz * vz) < EKF_HEADING_SPEED);
+    if (!any(go)) {
+        return;
+    }
+
+    lane_d correction = f.heading_gain * error;
+    lane_d c = per_lane<lane_cos_1>(correction);
+    lane_d s = per_lane<lane_sin_1>(correction);
+
+    f.x[3] = go ? vx * c - vz * s : vx;
+    f.x[5] = go ? vx * s + vz * c : vz;
+}
+
+/* One lane group over the input, n <= SWEEP_LANES sets */
+void run_group(const ekf_input &in, const ekf_params *sets, size_t n, sweep_metrics *out)
+{
+    std::unique_ptr<lane_filter> f(new lane_filter);
+    size_t pi = 0, mi = 0;
+
+    lanes_init(*f, sets, n);
+    for (uint8_t op : in.ops) {
+        if (op == SWEEP_OP_PREDICT) {
+            lanes_predict(*f, in.accel[pi], in.q[pi], in.dt[pi]);
+            pi++;
+        } else {
+            lanes_magnetometer(*f, in.mag[mi++]);
+        }
+    }
+
+    lane_d drift = per_lane<lane_sqrt_1>(f->x[0] * f->x[0] + f->x[1] * f->x[1] +
+                                         f->x[2] * f->x[2]);
+    for (size_t l = 0; l < n; l++) {
+        sweep_metrics m;
+
+        m.recordings = 1;
+        m.duration_ms = in.duration_ms;
+        m.predicts = (uint64_t)f->predicts[l];
+        m.zupt_steps = (uint64_t)f->zupt_steps[l];
+        m.zupt_episodes = (uint64_t)f->zupt_episodes[l];
+        m.zupt_residual = f->zupt_residual[l];
+        m.rest_offset = f->rest_offset[l];
+        m.end_drift = drift[l];
+        m.peak_speed = f->peak_speed[l];
+        out[l].add(m);
+    }
+}
+
+} /* namespace */
+
+/*******************************************************************************
+ * Private Functions: Corpus
+ ******************************************************************************/
+
+namespace {
+
+bool fail(std::string *err, const std::string &what)
+{
+    if (err) {
+        *err = what;
+    }
+    return false;
+}
+
+bool parse_number(const std::string &s, double &out)
+{
+    char *end;
+
+    out = std::strtod(s.c_str(), &end);
+    return !s.empty() && *end == '\0' && std::isfinite(out);
+}
+
+void report(corpus_state &st, const std::string &path, const std::string &err)
+{
+    std::lock_guard<std::mutex> g(st.lock);
+    st.stats->failed++;
+    st.stats->errors.push_back(path + ": " + err);
+}
+
+void run_group_task(corpus_state &st, size_t file, const std::shared_ptr<const ekf_input> &in,
+                    size_t first)
+{
+    const std::vector<ekf_params> &sets = *st.sets;
+    size_t n = std::min<size_t>(SWEEP_LANES, sets.size() - first);
+    sweep_metrics *out = &st.per_file[file][first];
+
+    if (st.opts->scalar) {
+        run_sets_scalar(*in, &sets[first], n, out);
+    } else {
+        run_sets(*in, &sets[first], n, out);
+    }
+    if (!st.opts->verify) {
+        return;
+    }
+
+    sweep_metrics check[SWEEP_LANES];
+    uint64_t bad = 0;
+    if (st.opts->scalar) {
+        run_sets(*in, &sets[first], n, check);
+    } else {
+        run_sets_scalar(*in, &sets[first], n, check);
+    }
+    for (size_t i = 0; i < n; i++) {
+        bad += !out[i].same(check[i]);
+    }
+    if (bad > 0) {
+        std::lock_guard<std::mutex> g(st.lock);
+        st.stats->mismatches += bad;
+    }
+}
+
+void run_file(corpus_state &st, size_t file, const std::string &path)
+{
+    auto in = std::make_shared<ekf_input>();
+    std::string err;
+    uint64_t events;
+
+    {
+        recording rec;
+        uint64_t bytes;
+        if (!load_recording(path, rec, bytes, &err) || !load_input(rec, *in, &err)) {
+            report(st, path, err);
+            return;
+        }
+        events = rec.event_count();
+    }
+
+    size_t sets = st.sets->size();
+    {
+        std::lock_guard<std::mutex> g(st.lock);
+        st.stats->files++;
+        st.stats->events += events;
+        st.stats->steps += (uint64_t)in->dt.size() * sets;
+    }
+
+    /* Every lane group reads the same decoded input */
+    std::shared_ptr<const ekf_input> shared = in;
+    st.per_file[file].resize(sets);
+    for (size_t first = SWEEP_LANES; first < sets; first += SWEEP_LANES) {
+        st.pool->submit([&st, file, shared, first] { run_group_task(st, file, shared, first); });
+    }
+    run_group_task(st, file, shared, 0);
+}
+
+} /* namespace */
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+void sweep_metrics::add(const sweep_metrics &o)
+{
+    recordings += o.recordings;
+    duration_ms += o.duration_ms;
+    predicts += o.predicts;
+    zupt_steps += o.zupt_steps;
+    zupt_episodes += o.zupt_episodes;
+    zupt_residual += o.zupt_residual;
+    rest_offset += o.rest_offset;
+    end_drift += o.end_drift;
+    if (o.peak_speed > peak_speed) {
+        peak_speed = o.peak_speed;
+    }
+}
+
+bool sweep_metrics::same(const sweep_metrics &o) const
+{
+    auto bits = [](double a, double b) { return std::memcmp(&a, &b, sizeof(a)) == 0; };
+
+    return recordings == o.recordings && bits(duration_ms, o.duration_ms) &&
+           predicts == o.predicts && zupt_steps == o.zupt_steps &&
+           zupt_episodes == o.zupt_episodes && bits(zupt_residual, o.zupt_residual) &&
+           bits(rest_offset, o.rest_offset) && bits(end_drift, o.end_drift) &&
+           bits(peak_speed, o.peak_speed);
+}
+
+const char *sweep_field_name(unsigned i)
+{
+    return i < k_field_count ? k_fields[i].name : nullptr;
+}
+
+bool parse_axis(const std::string &spec, sweep_axis &out, std::string *err)
+{
+    size_t eq = spec.find('=');
+    std::string name = spec.substr(0, eq);
+
+    out = sweep_axis();
+    while (out.field < k_field_count && name != k_fields[out.field].name) {
+        out.field++;
+    }
+    if (eq == std::string::npos || out.field == k_field_count) {
+        return fail(err, "unknown parameter in " + spec);
+    }
+
+    std::string list = spec.substr(eq + 1);
+    size_t colon = list.find(':');
+    if (colon != std::string::npos) {
+        size_t colon2 = list.find(':', colon + 1);
+        double lo, hi, n;
+        if (colon2 == std::string::npos || !parse_number(list.substr(0, colon), lo) ||
+            !parse_number(list.substr(colon + 1, colon2 - colon - 1), hi) ||
+            !parse_number(list.substr(colon2 + 1), n) || n < 1 || n != std::floor(n)) {
+            return fail(err, "expected name=lo:hi:n in " + spec);
+        }
+        for (double i = 0; i < n; i++) {
+            out.values.push_back(n == 1 ? lo : lo + (hi - lo) * (i / (n - 1)));
+        }
+    } else {
+        size_t start = 0;
+        for (;;) {
+            size_t comma = list.find(',', start);
+            double v;
+            if (!parse_number(list.substr(start, comma - start), v)) {
+                return fail(err, "expected name=v1,v2,... in " + spec);
+            }
+            out.values.push_back(v);
+            if (comma == std::string::npos) {
+                break;
+            }
+            start = comma + 1;
+        }
+    }
+
+    for (double &v : out.values) {
+        if (k_fields[out.field].integer) {
+            v = std::round(v);
+            if (v < 0) {
+                return fail(err, "negative count in " + spec);
+            }
+        }
+    }
+    out.lo = *std::min_element(out.values.begin(), out.values.end());
+    out.hi = *std::max_element(out.values.begin(), out.values.end());
+    return true;
+}
+
+double axis_value(const ekf_params &p, const sweep_axis &axis)
+{
+    return k_fields[axis.field].get(p);
+}
+
+void grid_sets(const ekf_params &base, const std::vector<sweep_axis> &axes,
+               std::vector<ekf_params> &out)
+{
+    std::vector<size_t> at(axes.size(), 0);
+
+    out.clear();
+    for (;;) {
+        ekf_params p = base;
+        for (size_t a = 0; a < axes.size(); a++) {
+            k_fields[axes[a].field].set(p, axes[a].values[at[a]]);
+        }
+        out.push_back(p);
+
+        /* Odometer, last axis fastest */
+        size_t a = axes.size();
+        while (a > 0 && ++at[a - 1] == axes[a - 1].values.size()) {
+            at[--a] = 0;
+        }
+        if (a == 0) {
+            return;
+        }
+    }
+}
+
+void random_sets(const ekf_params &base, const std::vector<sweep_axis> &axes, uint64_t n,
+                 uint64_t seed, std::vector<ekf_params> &out)
+{
+    uint64_t state = seed;
+
+    out.clear();
+    for (uint64_t i = 0; i < n; i++) {
+        ekf_params p = base;
+        for (const sweep_axis &axis : axes) {
+            /* splitmix64 */
+            uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            z ^= z >> 31;
+
+            double u = (double)(z >> 11) * 0x1.0p-53;
+            double v = axis.lo + (axis.hi - axis.lo) * u;
+            k_fields[axis.field].set(p, k_fields[axis.field].integer ? std::round(v) : v);
+        }
+        out.push_back(p);
+    }
+}
+
+bool load_input(const recording &rec, ekf_input &out, std::string *err)
+{
+    json::value meta;
+    double last_t = 0;
+
+    out = ekf_input();
+    if (!json::parse(rec.meta, meta, err)) {
+        return false;
+    }
+
+    size_t accel = rec.streams[IMUREC_STREAM_LINEAR_ACCEL].size();
+    out.ops.reserve(accel + rec.streams[IMUREC_STREAM_MAG].size());
+    out.dt.reserve(accel);
+    out.accel.reserve(accel);
+    out.q.reserve(accel);
+    out.mag.reserve(rec.streams[IMUREC_STREAM_MAG].size());
+
+    input_sink sink(out);
+    if (!replay_events(rec, meta, sink, &last_t, err)) {
+        return false;
+    }
+    out.duration_ms = last_t;
+    return true;
+}
+
+void run_sets(const ekf_input &in, const ekf_params *sets, size_t n, sweep_metrics *out)
+{
+    for (size_t first = 0; first < n; first += SWEEP_LANES) {
+        run_group(in, sets + first, std::min<size_t>(SWEEP_LANES, n - first), out + first);
+    }
+}
+
+void run_sets_scalar(const ekf_input &in, const ekf_params *sets, size_t n,
+                     sweep_metrics *out)
+{
+    for (size_t s = 0; s < n; s++) {
+        ekf_tracker tracker(sets[s]);
+        sweep_metrics m;
+        bool in_zupt = false;
+        size_t pi = 0, mi = 0;
+
+        m.recordings = 1;
+        m.duration_ms = in.duration_ms;
+        for (uint8_t op : in.ops) {
+            if (op != SWEEP_OP_PREDICT) {
+                tracker.update_magnetometer(in.mag[mi++]);
+                continue;
+            }
+
+            vec3 p = tracker.predict(in.accel[pi], in.q[pi], in.dt[pi]);
+            const ekf_step &step = tracker.last_step();
+            pi++;
+            if (!step.predicted) {
+                continue;
+            }
+
+            m.predicts++;
+            if (step.zupt) {
+                m.zupt_steps++;
+                if (!in_zupt) {
+                    m.zupt_episodes++;
+                    m.zupt_residual += step.zupt_speed;
+                }
+                m.rest_offset += std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+            }
+            in_zupt = step.zupt;
+
+            vec3 v = tracker.velocity();
+            double speed = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+            if (speed > m.peak_speed) {
+                m.peak_speed = speed;
+            }
+        }
+
+        vec3 raw = tracker.raw_position();
+        m.end_drift = std::sqrt(raw.x * raw.x + raw.y * raw.y + raw.z * raw.z);
+        out[s].add(m);
+    }
+}
+
+void sweep_corpus(const std::vector<std::string> &inputs, const std::vector<ekf_params> &sets,
+                  const sweep_options &opts, thread_pool &pool,
+                  std::vector<sweep_metrics> &out, sweep_stats &stats)
+{
+    corpus_state st;
+
+    st.sets = &sets;
+    st.opts = &opts;
+    st.pool = &pool;
+    st.stats = &stats;
+    st.per_file.resize(inputs.size());
+
+    out.assign(sets.size(), sweep_metrics());
+    if (sets.empty()) {
+        return;
+    }
+    for (size_t i = 0; i < inputs.size(); i++) {
+        pool.submit([&st, &inputs, i] { run_file(st, i, inputs[i]); });
+    }
+    pool.wait();
+
+    /* In input order, whatever order the tasks finished in */
+    for (const std::vector<sweep_metrics> &file : st.per_file) {
+        for (size_t s = 0; s < file.size(); s++) {
+            out[s].add(file[s]);
+        }
+    }
+}
+
+unsigned sweep_lanes()
+{
+    return SWEEP_LANES;
+}
+
+const char *sweep_simd_name()
+{
+    return SWEEP_SIMD_NAME;
+}
+
+} /* namespace imurec */
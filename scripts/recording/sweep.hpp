@@ -0,0 +1,175 @@
+/**
+ * @file sweep.hpp
+ * @brief EKF parameter sweeps over a corpus of recordings
+ *
+ * Tuning the EKF means replaying the same recordings under many
+ * ekf_params. A sweep decodes each recording once, through the replay
+ * event pass (replay_events()), into an ekf_input: the predict and
+ * magnetometer steps the app would feed EKFTracker, as columns. Every
+ * parameter set then runs against that one input.
+ *
+ * The sets run sweep_lanes() at a time, one set per SIMD lane: each
+ * filter's state is a column of the interleaved state vectors, so one
+ * pass over the input steps all of them in lockstep. Branches that depend
+ * on the parameters (the dt limit, ZUPT, the high-pass cutoff, the
+ * heading speed gate) become per-lane masks, and each lane does
+ * ekf_tracker's arithmetic in ekf_tracker's order, so a lane reproduces
+ * the scalar tracker bit for bit; sweep_options.verify runs both and
+ * counts any difference.
+ *
+ * sweep_corpus() runs on a thread_pool: one task per recording decodes it
+ * and splits the lane groups into further tasks. Metrics are kept per
+ * recording and set, and summed in input order, so the report does not
+ * depend on the thread count.
+ */
+
+#ifndef IMUREC_SWEEP_HPP
+#define IMUREC_SWEEP_HPP
+
+#include "ekf.hpp"
+#include "imurec.hpp"
+#include "thread_pool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace imurec {
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define SWEEP_OP_PREDICT    0       /* ekf_input.ops */
+#define SWEEP_OP_MAG        1
+
+/*******************************************************************************
+ * Data Structures
+ ******************************************************************************/
+
+/**
+ * @brief One recording's EKF input: ops in event order, then the columns
+ *        each kind of op reads in turn
+ */
+struct ekf_input {
+    std::vector<uint8_t> ops;
+    std::vector<double>  dt;            /* SWEEP_OP_PREDICT */
+    std::vector<vec3>    accel;
+    std::vector<quat>    q;
+    std::vector<vec3>    mag;           /* SWEEP_OP_MAG */
+    double               duration_ms = 0;
+};
+
+/**
+ * @brief Drift and ZUPT behaviour of one parameter set, summed over
+ *        recordings
+ */
+struct sweep_metrics {
+    uint64_t recordings = 0;
+    double   duration_ms = 0;
+    uint64_t predicts = 0;          /* Steps with an accepted dt */
+    uint64_t zupt_steps = 0;        /* Steps ending in a ZUPT update */
+    uint64_t zupt_episodes = 0;     /* Runs of consecutive ZUPT steps */
+    double   zupt_residual = 0;     /* Sum of |v| entering each episode, m/s */
+    double   rest_offset = 0;       /* Sum of |position| over ZUPT steps */
+    double   end_drift = 0;         /* Sum of |raw position| at the end, m */
+    double   peak_speed = 0;        /* Largest |v| after a step, m/s */
+
+    void add(const sweep_metrics &o);
+    bool same(const sweep_metrics &o) const;    /* Bit for bit */
+};
+
+/**
+ * @brief A swept ekf_params field and its values
+ */
+struct sweep_axis {
+    unsigned            field = 0;      /* Index into the sweep_field_name() table */
+    std::vector<double> values;         /* Grid points */
+    double              lo = 0;         /* Range for random search */
+    double              hi = 0;
+};
+
+struct sweep_options {
+    bool scalar = false;    /* ekf_tracker per set instead of lanes */
+    bool verify = false;    /* Run both, count metrics that differ */
+};
+
+struct sweep_stats {
+    uint64_t                 files = 0;         /* Swept */
+    uint64_t                 failed = 0;
+    uint64_t                 events = 0;
+    uint64_t                 steps = 0;         /* Filter steps, all sets */
+    uint64_t                 mismatches = 0;    /* verify: (recording, set) pairs */
+    std::vector<std::string> errors;            /* "path: message" */
+};
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Name of sweepable field i, or null past the last
+ *
+ * The scalar ekf_params fields by name, plus q_pos, q_vel, q_bias,
+ * p0_pos, p0_vel and p0_bias for the three diagonal entries of Q and P0
+ * each block covers.
+ */
+const char *sweep_field_name(unsigned i);
+
+/**
+ * @brief Parse "name=v1,v2,..." or "name=lo:hi:n" (n points, both ends)
+ */
+bool parse_axis(const std::string &spec, sweep_axis &out, std::string *err);
+
+/**
+ * @brief Value of an axis's field in a set
+ */
+double axis_value(const ekf_params &p, const sweep_axis &axis);
+
+/**
+ * @brief Every combination of the axes' values over base, last axis
+ *        fastest
+ */
+void grid_sets(const ekf_params &base, const std::vector<sweep_axis> &axes,
+               std::vector<ekf_params> &out);
+
+/**
+ * @brief n sets drawn uniformly from each axis's [lo, hi], the same for
+ *        the same seed
+ */
+void random_sets(const ekf_params &base, const std::vector<sweep_axis> &axes, uint64_t n,
+                 uint64_t seed, std::vector<ekf_params> &out);
+
+/**
+ * @brief Decode a recording into EKF input
+ * @return false as build_track()
+ */
+bool load_input(const recording &rec, ekf_input &out, std::string *err);
+
+/**
+ * @brief Run sets[0..n) on one input, adding to out[0..n)
+ */
+void run_sets(const ekf_input &in, const ekf_params *sets, size_t n, sweep_metrics *out);
+void run_sets_scalar(const ekf_input &in, const ekf_params *sets, size_t n,
+                     sweep_metrics *out);
+
+/**
+ * @brief Sweep files (.json or .imurec) with every set, in parallel
+ * @param out Metrics per set, summed over the files that loaded
+ *
+ * Returns when the pool is idle, so it must not run inside a pool task.
+ */
+void sweep_corpus(const std::vector<std::string> &inputs, const std::vector<ekf_params> &sets,
+                  const sweep_options &opts, thread_pool &pool,
+                  std::vector<sweep_metrics> &out, sweep_stats &stats);
+
+/**
+ * @brief Sets per lane group, and the instruction set it was built for
+ */
+unsigned sweep_lanes();
+const char *sweep_simd_name();
+
+} /* namespace imurec */
+
+#endif /* IMUREC_SWEEP_HPP */
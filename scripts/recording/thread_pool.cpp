@@ -0,0 +1,134 @@
+/**
+ * @file thread_pool.cpp
+ * @brief Work-stealing thread pool for batch jobs
+ */
+
+#include "thread_pool.hpp"
+
+namespace imurec {
+
+/*******************************************************************************
+ * Private Variables
+ ******************************************************************************/
+
+namespace {
+
+/* The pool and worker the current thread belongs to, if any */
+thread_local const thread_pool *s_pool = nullptr;
+thread_local unsigned           s_self = 0;
+
+} /* namespace */
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+/* Own deque newest first, then the others oldest first */
+bool thread_pool::take(unsigned self, task &t)
+{
+    unsigned n = (unsigned)queues_.size();
+
+    for (unsigned i = 0; i < n; i++) {
+        queue &q = *queues_[(self + i) % n];
+        std::lock_guard<std::mutex> g(q.lock);
+
+        if (q.tasks.empty()) {
+            continue;
+        }
+        if (i == 0) {
+            t = std::move(q.tasks.back());
+            q.tasks.pop_back();
+        } else {
+            t = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            steals_++;
+        }
+        queued_--;
+        return true;
+    }
+    return false;
+}
+
+void thread_pool::run(unsigned self)
+{
+    s_pool = this;
+    s_self = self;
+
+    for (;;) {
+        task t;
+
+        if (take(self, t)) {
+            t();
+            if (pending_.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> g(sleep_lock_);
+                idle_.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> g(sleep_lock_);
+        wake_.wait(g, [this] { return stop_ || queued_.load() > 0; });
+        if (stop_ && queued_.load() == 0) {
+            return;
+        }
+    }
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+thread_pool::thread_pool(unsigned threads)
+{
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    for (unsigned i = 0; i < threads; i++) {
+        queues_.push_back(std::make_unique<queue>());
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        threads_.emplace_back(&thread_pool::run, this, i);
+    }
+}
+
+thread_pool::~thread_pool()
+{
+    {
+        std::lock_guard<std::mutex> g(sleep_lock_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread &t : threads_) {
+        t.join();
+    }
+}
+
+void thread_pool::submit(task t)
+{
+    unsigned q = s_pool == this ? s_self : next_++ % (unsigned)queues_.size();
+
+    pending_++;
+    {
+        std::lock_guard<std::mutex> g(queues_[q]->lock);
+        queues_[q]->tasks.push_back(std::move(t));
+    }
+    queued_++;
+
+    /* Taking the lock orders this against a worker checking queued_ */
+    {
+        std::lock_guard<std::mutex> g(sleep_lock_);
+    }
+    wake_.notify_one();
+}
+
+void thread_pool::wait()
+{
+    std::unique_lock<std::mutex> g(sleep_lock_);
+    idle_.wait(g, [this] { return pending_.load() == 0; });
+}
+
+} /* namespace imurec */
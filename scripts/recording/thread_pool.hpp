@@ -0,0 +1,72 @@
+/**
+ * @file thread_pool.hpp
+ * @brief Work-stealing thread pool for batch jobs
+ *
+ * Each worker owns a deque. A task submitted from inside a worker goes to
+ * that worker's deque and is taken back newest first, so a task that
+ * splits its work keeps the pieces on its own core while they are hot;
+ * idle workers steal the oldest task from the other deques. Tasks
+ * submitted from outside the pool are spread round-robin.
+ *
+ * Tasks may submit more tasks. wait() returns once every task submitted
+ * so far, and every task those submitted, has run; it must not be called
+ * from a task. Tasks must not throw.
+ */
+
+#ifndef IMUREC_THREAD_POOL_HPP
+#define IMUREC_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace imurec {
+
+class thread_pool {
+public:
+    using task = std::function<void()>;
+
+    /**
+     * @param threads Worker count, 0 for one per hardware thread
+     */
+    explicit thread_pool(unsigned threads = 0);
+    thread_pool(const thread_pool &) = delete;
+    thread_pool &operator=(const thread_pool &) = delete;
+    ~thread_pool();
+
+    void submit(task t);
+    void wait();
+
+    unsigned size() const { return (unsigned)threads_.size(); }
+    uint64_t steals() const { return steals_.load(); }
+
+private:
+    struct queue {
+        std::mutex       lock;
+        std::deque<task> tasks;
+    };
+
+    void run(unsigned self);
+    bool take(unsigned self, task &t);
+
+    std::vector<std::unique_ptr<queue>> queues_;
+    std::vector<std::thread>            threads_;
+    std::mutex                          sleep_lock_;
+    std::condition_variable             wake_;      /* Work queued or stopping */
+    std::condition_variable             idle_;      /* pending_ reached 0 */
+    std::atomic<size_t>                 queued_{0}; /* Tasks in the deques */
+    std::atomic<size_t>                 pending_{0};/* Queued or running */
+    std::atomic<unsigned>               next_{0};
+    std::atomic<uint64_t>               steals_{0};
+    bool                                stop_ = false;
+};
+
+} /* namespace imurec */
+
+#endif /* IMUREC_THREAD_POOL_HPP */